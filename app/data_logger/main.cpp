@@ -13,11 +13,17 @@
 #include <stdlib.h>
 #include <signal.h>
 #include <string.h>
-#include <fstream>
 #include <ctime>
+#include <vector>
+#include <string>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
 
 #include "sl_lidar.h" 
 #include "sl_lidar_driver.h"
+#include "sl_lidar_record.h"
+#include "sl_lidar_fastconnect.h"
 #ifndef _countof
 #define _countof(_Array) (int)(sizeof(_Array) / sizeof(_Array[0]))
 #endif
@@ -39,6 +45,164 @@ static inline void delay(sl_word_size_t ms){
 
 using namespace sl;
 
+// Which samples go to the CSV file, everything by default
+// (the decimation, the angular ranges and the quality are left to the driver, see LidarAcquisitionFilter)
+struct CsvFilterOptions {
+    int maxPointsPerDegree; // per degree and per scan, 0 for no limit
+    bool validOnly;         // skip the samples without a measurement (distance 0)
+
+    CsvFilterOptions() : maxPointsPerDegree(0), validOnly(false) {}
+};
+
+// Formats the scans into CSV text on its own thread and writes it in large blocks.
+// pushScan only copies the scan into one of the queued slots, so it can be called from
+// the driver's scan callback. The scan is dropped (and counted) when every slot is taken.
+class CsvScanWriter {
+public:
+    enum {
+        QUEUE_DEPTH = 64,
+        WRITE_BLOCK_SIZE = 1024 * 1024,
+        MAX_LINE_SIZE = 64,
+        BARCOUNT = 360,
+    };
+
+    CsvScanWriter(ILidarDriver * drv, const CsvFilterOptions & filter)
+        : _drv(drv), _filter(filter), _file(NULL), _working(false)
+        , _queuedCount(0), _head(0), _scanCount(0), _sampleCount(0), _droppedCount(0)
+        , _blockSize(0)
+    {
+        _slots.resize(QUEUE_DEPTH);
+    }
+
+    ~CsvScanWriter() { close(); }
+
+    bool open(const char * filename) {
+        _file = fopen(filename, "w");
+        if (!_file) return false;
+
+        _block.resize(WRITE_BLOCK_SIZE + MAX_LINE_SIZE);
+        _blockSize = (size_t)sprintf(&_block[0], "timestamp,angle,distance,quality,scan_number\n");
+        _working = true;
+        _thread = std::thread(&CsvScanWriter::writerProc, this);
+        return true;
+    }
+
+    void close() {
+        if (!_file) return;
+
+        {
+            std::lock_guard<std::mutex> l(_lock);
+            _working = false;
+        }
+        _queueCond.notify_one();
+        _thread.join();
+
+        flushBlock();
+        fclose(_file);
+        _file = NULL;
+    }
+
+    void pushScan(const sl_lidar_response_measurement_node_hq_t * nodes, size_t count) {
+        std::unique_lock<std::mutex> l(_lock);
+        if (_queuedCount == QUEUE_DEPTH) {
+            ++_droppedCount;
+            return;
+        }
+
+        ScanSlot & slot = _slots[(_head + _queuedCount) % QUEUE_DEPTH];
+        l.unlock();
+        // the writer never touches the slots past the queued ones
+        slot.nodes.assign(nodes, nodes + count);
+        slot.time = time(NULL);
+        l.lock();
+
+        ++_queuedCount;
+        l.unlock();
+        _queueCond.notify_one();
+    }
+
+    unsigned long long getScanCount() { std::lock_guard<std::mutex> l(_lock); return _scanCount; }
+    unsigned long long getSampleCount() { std::lock_guard<std::mutex> l(_lock); return _sampleCount; }
+    unsigned long long getDroppedCount() { std::lock_guard<std::mutex> l(_lock); return _droppedCount; }
+
+private:
+    struct ScanSlot {
+        std::vector<sl_lidar_response_measurement_node_hq_t> nodes;
+        time_t time;
+    };
+
+    void writerProc() {
+        std::unique_lock<std::mutex> l(_lock);
+        for (;;) {
+            _queueCond.wait(l, [this] { return _queuedCount || !_working; });
+            if (!_queuedCount) break;
+
+            ScanSlot & slot = _slots[_head];
+            l.unlock();
+            size_t written = formatScan(slot);
+            l.lock();
+
+            _head = (_head + 1) % QUEUE_DEPTH;
+            --_queuedCount;
+            ++_scanCount;
+            _sampleCount += written;
+        }
+    }
+
+    size_t formatScan(ScanSlot & slot) {
+        size_t count = slot.nodes.size();
+        if (!count) return 0;
+
+        int points_per_degree[BARCOUNT] = {0};
+        size_t written = 0;
+        unsigned long long scan_number = _scanCount + 1;
+
+        _drv->ascendScanData(&slot.nodes[0], count);
+        for (size_t pos = 0; pos < count; ++pos) {
+            const sl_lidar_response_measurement_node_hq_t & node = slot.nodes[pos];
+
+            if (_filter.validOnly && !node.dist_mm_q2) continue;
+
+            float angle = (node.angle_z_q14 * 90.f) / 16384.f;
+            if (_filter.maxPointsPerDegree) {
+                int degree = (int)angle;
+                if (degree < 0 || degree >= BARCOUNT || points_per_degree[degree] >= _filter.maxPointsPerDegree) continue;
+                points_per_degree[degree]++;
+            }
+
+            _blockSize += (size_t)snprintf(&_block[_blockSize], MAX_LINE_SIZE, "%lld,%.4f,%.2f,%d,%llu\n"
+                , (long long)slot.time, angle, node.dist_mm_q2 / 4.0f, (int)node.quality, scan_number);
+            if (_blockSize >= WRITE_BLOCK_SIZE) flushBlock();
+            ++written;
+        }
+        return written;
+    }
+
+    void flushBlock() {
+        if (_blockSize) fwrite(&_block[0], 1, _blockSize, _file);
+        _blockSize = 0;
+    }
+
+    ILidarDriver * _drv;
+    CsvFilterOptions _filter;
+    FILE * _file;
+    std::thread _thread;
+
+    std::mutex _lock;
+    std::condition_variable _queueCond;
+    bool _working;
+    std::vector<ScanSlot> _slots;
+    size_t _queuedCount;
+    size_t _head;
+    unsigned long long _scanCount;
+    unsigned long long _sampleCount;
+    unsigned long long _droppedCount;
+
+    // owned by the writer thread
+    std::vector<char> _block;
+    size_t _blockSize;
+};
+
 void print_usage(int argc, const char * argv[])
 {
     printf("Usage:\n"
@@ -48,6 +212,15 @@ void print_usage(int argc, const char * argv[])
            "A3(256000),S1(256000),S2(1000000),S3(1000000)\n"
            " For udp channel\n %s --channel --udp <ipaddr> [port NO.] [output_file]\n"
            " The T1 default ipaddr is 192.168.11.2,and the port NO.is 8089. Please refer to the datasheet for details.\n"
+           " If output_file ends with .slr, every scan is recorded losslessly in the binary format of sl_lidar_record.h\n"
+           " Every sample is written unless filtered by the options (anywhere on the command line):\n"
+           "  --decimate <n>        keep one sample out of n\n"
+           "  --roi <from> <to>     keep the samples from one angle to another (in degree), up to 4 times\n"
+           "  --min-quality <n>     keep the samples of a quality from n\n"
+           " these ones are applied by the driver as the samples are decoded, the .slr recordings included\n"
+           "  --max-per-degree <n>  keep at most n samples per degree and per scan in the CSV file\n"
+           "  --valid-only          skip the samples without a measurement in the CSV file\n"
+           " --profile-cache <dir> keeps the capability profile of the device and the baudrate of the port for a faster startup\n"
            , argv[0], argv[0]);
 }
 
@@ -82,6 +255,7 @@ int main(int argc, const char * argv[]) {
     const char * opt_channel = NULL;
     const char * opt_channel_param_first = NULL;
     const char * output_file = NULL;
+    const char * opt_profile_cache = NULL;
     sl_u32         opt_channel_param_second = 0;
     sl_u32         baudrateArray[2] = {115200, 256000};
     sl_result     op_result;
@@ -91,41 +265,60 @@ int main(int argc, const char * argv[]) {
     time_t now = 0;
     char* dt = NULL;
     char filename[100] = {0};
-    time_t current_time = 0;
-    std::ofstream outFile;
     ILidarDriver * drv = NULL;
     sl_lidar_response_device_info_t devinfo;
     bool connectSuccess = false;
-
-    // Scan data variables
-    sl_lidar_response_measurement_node_hq_t nodes[8192];
-    size_t count = 0;
-    float last_angle = 0;
-    bool scan_complete = false;
-    const int BARCOUNT = 360;  // One bar per degree
-    bool angle_histogram[BARCOUNT] = {false};  // Track which angles we've seen
-    int points_per_degree[BARCOUNT] = {0};  // Track number of points per degree
-    const int MAX_POINTS_PER_DEGREE = 5;  // Maximum points to save per degree
-    int scan_count = 0;
-    bool first_scan = true;
-    bool skip_next = false;  // Flag to skip every other point
+    LidarScanMode scanMode;
+    bool binaryOutput = false;
+    ILidarScanRecorder * recorder = NULL;
+    CsvScanWriter * csvWriter = NULL;
+    CsvFilterOptions csvFilter;
+    LidarAcquisitionFilter acquisitionFilter;
+    bool badFilter = false;
+    std::vector<const char *> args;
 
     printf("RPLidar S2 Data Logger\n"
            "Version: %s\n", SL_LIDAR_SDK_VERSION);
 
-    if (argc < 4) {
+    // the filter options may appear anywhere, the rest is positional
+    args.push_back(argv[0]);
+    for (int pos = 1; pos < argc; ++pos) {
+        if (strcmp(argv[pos], "--decimate") == 0 && pos + 1 < argc) {
+            int decimation = atoi(argv[++pos]);
+            badFilter |= decimation < 1;
+            acquisitionFilter.decimation = decimation;
+        } else if (strcmp(argv[pos], "--roi") == 0 && pos + 2 < argc) {
+            float fromAngle = (float)atof(argv[++pos]);
+            float toAngle = (float)atof(argv[++pos]);
+            badFilter |= SL_IS_FAIL(acquisitionFilter.addRange(fromAngle, toAngle));
+        } else if (strcmp(argv[pos], "--min-quality") == 0 && pos + 1 < argc) {
+            int quality = atoi(argv[++pos]);
+            badFilter |= quality < 0 || quality > 255;
+            acquisitionFilter.minQuality = (sl_u8)quality;
+        } else if (strcmp(argv[pos], "--max-per-degree") == 0 && pos + 1 < argc) {
+            csvFilter.maxPointsPerDegree = atoi(argv[++pos]);
+        } else if (strcmp(argv[pos], "--valid-only") == 0) {
+            csvFilter.validOnly = true;
+        } else if (strcmp(argv[pos], "--profile-cache") == 0 && pos + 1 < argc) {
+            opt_profile_cache = argv[++pos];
+        } else {
+            args.push_back(argv[pos]);
+        }
+    }
+
+    if (args.size() < 4 || badFilter || csvFilter.maxPointsPerDegree < 0) {
         print_usage(argc, argv);
         return -1;
     }
 
-    opt_is_channel = argv[1];
-    opt_channel = argv[2];
-    opt_channel_param_first = argv[3];
-    if (argc > 4) {
-        opt_channel_param_second = strtoul(argv[4], NULL, 10);
+    opt_is_channel = args[1];
+    opt_channel = args[2];
+    opt_channel_param_first = args[3];
+    if (args.size() > 4) {
+        opt_channel_param_second = strtoul(args[4], NULL, 10);
     }
-    if (argc > 5) {
-        output_file = argv[5];
+    if (args.size() > 5) {
+        output_file = args[5];
     } else {
         // Generate default filename with timestamp
         time(&now);
@@ -172,35 +365,24 @@ int main(int argc, const char * argv[]) {
     }
 
     if(opt_channel_type == CHANNEL_TYPE_SERIALPORT) {
-        if(useArgcBaudrate) {
-            _channel = (*createSerialPortChannel(opt_channel_param_first, opt_channel_param_second));
-            if (SL_IS_OK((drv)->connect(_channel))) {
-                op_result = drv->getDeviceInfo(devinfo);
-                if (SL_IS_OK(op_result)) {
-                    connectSuccess = true;
-                }
-                else {
-                    delete drv;
-                    drv = NULL;
-                }
-            }
+        // short probes (the baudrate which worked last time first), and no discovery query once the device profile is cached
+        LidarFastConnectOptions fastConnect;
+        LidarFastConnectInfo fastConnectInfo;
+        if (opt_profile_cache) fastConnect.cacheDir = opt_profile_cache;
+        if (useArgcBaudrate && opt_channel_param_second) {
+            fastConnect.baudRates.assign(1, opt_channel_param_second);
         }
         else {
-            size_t baudRateArraySize = (sizeof(baudrateArray))/ (sizeof(baudrateArray[0]));
-            for(size_t i = 0; i < baudRateArraySize; ++i) {
-                _channel = (*createSerialPortChannel(opt_channel_param_first, baudrateArray[i]));
-                if (SL_IS_OK((drv)->connect(_channel))) {
-                    op_result = drv->getDeviceInfo(devinfo);
-                    if (SL_IS_OK(op_result)) {
-                        connectSuccess = true;
-                        break;
-                    }
-                    else {
-                        delete drv;
-                        drv = NULL;
-                    }
-                }
-            }
+            fastConnect.baudRates.assign(baudrateArray, baudrateArray + _countof(baudrateArray));
+        }
+
+        Result<IChannel*> channel = connectLidarSerialFast(drv, opt_channel_param_first, fastConnect, &fastConnectInfo);
+        if (channel) {
+            _channel = *channel;
+            devinfo = fastConnectInfo.devInfo;
+            connectSuccess = true;
+            printf("Connected at %u bps%s\n", fastConnectInfo.baudRate
+                , fastConnectInfo.profileCached ? ", device profile loaded from the cache" : "");
         }
     }
     else if(opt_channel_type == CHANNEL_TYPE_UDP) {
@@ -244,76 +426,82 @@ int main(int argc, const char * argv[]) {
 
     signal(SIGINT, ctrlc);
 
-    drv->setMotorSpeed();
-    // start scan...
-    drv->startScan(0,1);
+    binaryOutput = strlen(output_file) > 4 && strcmp(output_file + strlen(output_file) - 4, ".slr") == 0;
 
-    printf("Successfully started scan. Saving data to %s\n", output_file);
-    outFile.open(output_file);
-    if (!outFile.is_open()) {
-        fprintf(stderr, "Error, cannot open output file %s.\n", output_file);
+    // scanMode is only known once the scan has started, the CSV writer is ready before
+    if (!binaryOutput) {
+        csvWriter = new CsvScanWriter(drv, csvFilter);
+        if (!csvWriter->open(output_file)) {
+            fprintf(stderr, "Error, cannot open output file %s.\n", output_file);
+            goto on_finished;
+        }
+    }
+
+    // the samples filtered out are dropped by the driver right after decoding, before they are stored
+    if (SL_IS_FAIL(drv->setAcquisitionFilter(acquisitionFilter))) {
+        fprintf(stderr, "Error, invalid sample filter.\n");
         goto on_finished;
     }
 
-    // Write header to file
-    outFile << "timestamp,angle,distance,quality,scan_number\n";
-
-    // fetch result and print it out...
-    while (1) {
-        count = _countof(nodes);
-        op_result = drv->grabScanDataHq(nodes, count, 0);  // Added timeout parameter
-        
-        if (SL_IS_OK(op_result)) {
-            drv->ascendScanData(nodes, count);
-            scan_count++;  // Increment scan count for each batch of data
-            
-            for (int pos = 0; pos < (int)count ; ++pos) {
-                float current_angle = (nodes[pos].angle_z_q14 * 90.f) / 16384.f;
-                float current_distance = nodes[pos].dist_mm_q2/4.0f;
-                
-                // Only record data points with valid measurements
-                if (current_distance > 0 && !skip_next) {
-                    // Convert angle to integer degree (0-359)
-                    int degree = (int)current_angle;
-                    if (degree >= 0 && degree < BARCOUNT) {
-                        // Only save if we haven't reached max points for this degree
-                        if (points_per_degree[degree] < MAX_POINTS_PER_DEGREE) {
-                            time(&current_time);
-                            outFile << current_time << "," 
-                                   << current_angle << ","
-                                   << current_distance << ","
-                                   << (int)nodes[pos].quality << ","
-                                   << scan_count << "\n";
-                            points_per_degree[degree]++;
-                        }
-                    }
-                }
-                skip_next = !skip_next;  // Toggle skip flag
-                
-                // Reset points per degree counter when we complete a full scan
-                if (current_angle < last_angle) {  // We've wrapped around
-                    memset(points_per_degree, 0, sizeof(points_per_degree));
-                    scan_count++;
-                }
-                last_angle = current_angle;
-            }
-            
-            // Print progress
-            printf("Scan #%d - Collected %d data points\n", scan_count, (int)count);
+    drv->setMotorSpeed();
+    // start scan...
+    memset(&scanMode, 0, sizeof(scanMode));
+    drv->startScan(0,1,0,&scanMode);
+
+    if (binaryOutput) {
+        recorder = *createLidarScanRecorder();
+        if (!recorder || SL_IS_FAIL(recorder->open(output_file, devinfo, scanMode))) {
+            fprintf(stderr, "Error, cannot open output file %s.\n", output_file);
+            drv->stop();
+            goto on_finished;
         }
+    }
+
+    printf("Successfully started scan. Saving data to %s\n", output_file);
 
-        if (ctrl_c_pressed) {
-            break;
+    // every scan is pushed from the driver's decoding thread as soon as it is complete,
+    // both writers only queue it there and do the formatting and the I/O on their own thread
+    drv->setScanCallback([recorder, csvWriter](const sl_lidar_response_measurement_node_hq_t * nodes, size_t count, sl_u64 timestamp_uS) {
+        if (recorder) {
+            recorder->pushScan(nodes, count, timestamp_uS);
+        } else {
+            csvWriter->pushScan(nodes, count);
         }
-        
-        delay(50);  // Add small delay between scans
+    });
+
+    while (!ctrl_c_pressed) {
+        delay(1000);
+
+        LidarRuntimeStats stats;
+        drv->getRuntimeStats(stats);
+        printf("Scan #%llu - %llu samples received\n"
+            , (unsigned long long)stats.scanCount, (unsigned long long)stats.nodeCount);
     }
 
+    drv->setScanCallback(LidarScanCallback());
     drv->stop();
-    outFile.close();
-    printf("Scan stopped. Data saved to %s\n", output_file);
+
+    if (recorder) {
+        recorder->close();
+        printf("Scan stopped. %llu scans saved to %s, %llu dropped\n"
+            , (unsigned long long)recorder->getRecordedScanCount(), output_file
+            , (unsigned long long)recorder->getDroppedScanCount());
+    } else {
+        csvWriter->close();
+        printf("Scan stopped. %llu scans (%llu samples) saved to %s, %llu dropped\n"
+            , csvWriter->getScanCount(), csvWriter->getSampleCount(), output_file
+            , csvWriter->getDroppedCount());
+    }
 
 on_finished:
+    if(csvWriter) {
+        delete csvWriter;
+        csvWriter = NULL;
+    }
+    if(recorder) {
+        delete recorder;
+        recorder = NULL;
+    }
     if(drv) {
         delete drv;
         drv = NULL;
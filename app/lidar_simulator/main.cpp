@@ -0,0 +1,1160 @@
+/*
+ *  SLAMTEC LIDAR
+ *  Virtual LIDAR simulator
+ *
+ *  Copyright (c) 2014 - 2023 Shanghai Slamtec Co., Ltd.
+ *  http://www.slamtec.com
+ *
+ */
+
+// Serves one or more virtual devices speaking the device side of the wire protocol
+// (sl_lidar_protocol.h / sl_lidar_cmd.h) over tcp, udp or a pseudo terminal, so the sdk
+// and the applications can be exercised without hardware. A synthetic room is scanned in
+// every answer type the unpacker knows, and the sample rate can be scaled past the real
+// hardware to load-test many sensors on one host.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <signal.h>
+#include <string.h>
+#include <math.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <termios.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+
+#include <vector>
+#include <string>
+#include <thread>
+#include <atomic>
+#include <chrono>
+#include <algorithm>
+
+#include "sl_lidar.h"
+#include "sl_crc.h"
+
+#ifndef _countof
+#define _countof(_Array) (int)(sizeof(_Array) / sizeof(_Array[0]))
+#endif
+
+using namespace sl;
+
+enum SimTransport {
+    SIM_TRANSPORT_TCP,
+    SIM_TRANSPORT_UDP,
+    SIM_TRANSPORT_PTY,
+};
+
+struct SimulatorOptions {
+    SimTransport transport;
+    int port;                 // first port, the devices use consecutive ports
+    int deviceCount;
+    double rateMultiplier;    // 1 is the real hardware rate
+    double scanFrequency;     // revolutions per second at the real rate
+    int tickPeriod_uS;        // how often the due samples are sent
+    sl_u8 model;
+    sl_u16 firmwareVersion;
+    sl_u8 hardwareVersion;
+
+    SimulatorOptions()
+        : transport(SIM_TRANSPORT_TCP), port(20108), deviceCount(1), rateMultiplier(1.0), scanFrequency(10.0)
+        , tickPeriod_uS(1000), model(0x31), firmwareVersion(0x0120), hardwareVersion(7)
+    {}
+};
+
+struct SimScanMode {
+    sl_u16 id;
+    const char* name;
+    sl_u8 ansType;
+    float usPerSample;
+    float maxDistance;      // in meters
+};
+
+// Mode 0 must be the standard scan, it is what SCAN and FORCE_SCAN start
+static const SimScanMode SCAN_MODES[] = {
+    { 0, "Standard",    SL_LIDAR_ANS_TYPE_MEASUREMENT,                      250.0f,  12.0f },
+    { 1, "Express",     SL_LIDAR_ANS_TYPE_MEASUREMENT_CAPSULED,             125.0f,  12.0f },
+    { 2, "Boost",       SL_LIDAR_ANS_TYPE_MEASUREMENT_CAPSULED_ULTRA,        62.5f,  25.0f },
+    { 3, "Sensitivity", SL_LIDAR_ANS_TYPE_MEASUREMENT_DENSE_CAPSULED,        62.5f,  25.0f },
+    { 4, "DenseBoost",  SL_LIDAR_ANS_TYPE_MEASUREMENT_ULTRA_DENSE_CAPSULED,  31.25f, 40.0f },
+    { 5, "HQ",          SL_LIDAR_ANS_TYPE_MEASUREMENT_HQ,                    62.5f,  25.0f },
+};
+static const sl_u16 TYPICAL_SCAN_MODE = 2;
+
+static const sl_u16 MIN_MOTOR_RPM = 300;
+static const sl_u16 MAX_MOTOR_RPM = 1200;
+static const sl_u16 DEFAULT_MOTOR_PWM = 660;
+
+struct SimSample {
+    double angle;       // degrees
+    sl_u32 distance;    // mm, 0 for no measurement
+    sl_u8 quality;      // hq scale
+    bool sync;          // first sample of a revolution
+};
+
+// A 8m x 5m room with a pillar slowly circling around the sensor. The samples are a pure
+// function of their index so the encoders can look ahead (the ultra capsules predict from
+// the next capsule).
+class SimulatedScene
+{
+public:
+    SimulatedScene(const SimScanMode& mode, double scanFrequency, int deviceIndex)
+        : _degPerSample(360.0 * scanFrequency * mode.usPerSample / 1000000.0)
+        , _secondsPerSample(mode.usPerSample / 1000000.0)
+        , _maxDistance((sl_u32)(mode.maxDistance * 1000))
+        , _seed((sl_u32)deviceIndex * 2654435761u)
+        , _opticalOffset(mode.ansType == SL_LIDAR_ANS_TYPE_MEASUREMENT_CAPSULED_ULTRA)
+    {
+    }
+
+    SimSample sampleAt(sl_u64 idx) const
+    {
+        SimSample sample;
+        // a fraction of a sample off zero, so the capsules do not start exactly on the
+        // revolution boundary every turn
+        double turns = (idx + 0.37) * _degPerSample / 360.0;
+        sample.angle = (turns - floor(turns)) * 360.0;
+        sample.sync = (idx == 0) || (floor(turns) != floor((idx - 0.63) * _degPerSample / 360.0));
+
+        // the pillar, radius 250mm, orbits at 1.8m every 20 seconds of device time
+        const double orbit = idx * _secondsPerSample * 2 * M_PI / 20.0;
+        double range;
+        if (_opticalOffset) {
+            // the ultra capsule decoder corrects the angle by the distance dependent offset
+            // of the optics, measure where the corrected angle points to
+            range = _rangeAt(sample.angle - 7.5, orbit);
+            range = _rangeAt(sample.angle - _opticalOffsetAt(range), orbit);
+        }
+        else {
+            range = _rangeAt(sample.angle, orbit);
+        }
+
+        // a few millimeters of repeatable noise
+        sl_u32 hash = (sl_u32)(idx * 2246822519u) ^ _seed;
+        hash ^= hash >> 15; hash *= 2654435761u; hash ^= hash >> 13;
+        range += (int)(hash % 9) - 4;
+
+        sample.distance = (range > 0 && range < _maxDistance) ? (sl_u32)range : 0;
+        sample.quality = sample.distance ? (47 << SL_LIDAR_RESP_MEASUREMENT_QUALITY_SHIFT) : 0;
+        return sample;
+    }
+
+private:
+    static double _rangeAt(double angle, double orbit)
+    {
+        const double rad = angle * M_PI / 180.0;
+        const double dx = cos(rad), dy = sin(rad);
+
+        // sensor at (1500, 2000) in a room spanning (0, 0) - (8000, 5000)
+        const double sx = 1500, sy = 2000;
+        double range = 1e9;
+        if (dx > 1e-9) range = std::min(range, (8000 - sx) / dx);
+        if (dx < -1e-9) range = std::min(range, -sx / dx);
+        if (dy > 1e-9) range = std::min(range, (5000 - sy) / dy);
+        if (dy < -1e-9) range = std::min(range, -sy / dy);
+
+        const double px = 1800 * cos(orbit), py = 1800 * sin(orbit);
+        const double along = px * dx + py * dy;
+        const double across2 = px * px + py * py - along * along;
+        if (along > 0 && across2 < 250.0 * 250.0) {
+            range = std::min(range, along - sqrt(250.0 * 250.0 - across2));
+        }
+        return range;
+    }
+
+    // in degrees, the same model as the ultra capsule decoder
+    static double _opticalOffsetAt(double range)
+    {
+        const int dist_q2 = (int)range << 2;
+        double offset_q16 = 7.5 * M_PI * (1 << 16) / 180.0;
+        if (dist_q2 >= (50 * 4)) {
+            const int k2 = 98361 / dist_q2;
+            offset_q16 = (int)(8 * M_PI * (1 << 16) / 180) - (k2 << 6) - (k2 * k2 * k2) / 98304;
+        }
+        return offset_q16 * 180.0 / M_PI / (1 << 16);
+    }
+
+    double _degPerSample;
+    double _secondsPerSample;
+    sl_u32 _maxDistance;
+    sl_u32 _seed;
+    bool _opticalOffset;
+};
+
+static sl_u16 toAngleQ6(double angle)
+{
+    return (sl_u16)(((sl_u32)(angle * 64.0 + 0.5)) % (360 << 6));
+}
+
+static sl_u16 toStartAngleSync(double angle, bool firstCapsule)
+{
+    return (sl_u16)(toAngleQ6(angle) | (firstCapsule ? SL_LIDAR_RESP_MEASUREMENT_EXP_SYNCBIT : 0));
+}
+
+// the checksum covers the bytes from checksumStart to the end of the capsule
+static void sealCapsule(sl_u8* capsule, size_t checksumStart, size_t size)
+{
+    sl_u8 checksum = 0;
+    for (size_t pos = checksumStart; pos < size; ++pos) checksum ^= capsule[pos];
+    capsule[0] = (sl_u8)((SL_LIDAR_RESP_MEASUREMENT_EXP_SYNC_1 << 4) | (checksum & 0xF));
+    capsule[1] = (sl_u8)((SL_LIDAR_RESP_MEASUREMENT_EXP_SYNC_2 << 4) | (checksum >> 4));
+}
+
+static sl_u32 varbitscaleEncode(sl_u32 value, sl_u32& scaleLevel)
+{
+    static const sl_u32 SRC_BASE[] = {
+        (0x1 << SL_LIDAR_VARBITSCALE_X16_SRC_BIT),
+        (0x1 << SL_LIDAR_VARBITSCALE_X8_SRC_BIT),
+        (0x1 << SL_LIDAR_VARBITSCALE_X4_SRC_BIT),
+        (0x1 << SL_LIDAR_VARBITSCALE_X2_SRC_BIT),
+    };
+    static const sl_u32 DEST_BASE[] = {
+        SL_LIDAR_VARBITSCALE_X16_DEST_VAL,
+        SL_LIDAR_VARBITSCALE_X8_DEST_VAL,
+        SL_LIDAR_VARBITSCALE_X4_DEST_VAL,
+        SL_LIDAR_VARBITSCALE_X2_DEST_VAL,
+    };
+
+    for (int i = 0; i < _countof(SRC_BASE); ++i) {
+        if (value >= SRC_BASE[i]) {
+            scaleLevel = 4 - i;
+            return std::min<sl_u32>(DEST_BASE[i] + ((value - SRC_BASE[i]) >> scaleLevel), 0xFFF);
+        }
+    }
+    scaleLevel = 0;
+    return value;
+}
+
+static sl_u32 varbitscaleDecode(sl_u32 scaled, sl_u32 scaleLevel)
+{
+    static const sl_u32 SRC_BASE[] = { 0, (0x1 << SL_LIDAR_VARBITSCALE_X2_SRC_BIT), (0x1 << SL_LIDAR_VARBITSCALE_X4_SRC_BIT)
+        , (0x1 << SL_LIDAR_VARBITSCALE_X8_SRC_BIT), (0x1 << SL_LIDAR_VARBITSCALE_X16_SRC_BIT) };
+    static const sl_u32 DEST_BASE[] = { 0, SL_LIDAR_VARBITSCALE_X2_DEST_VAL, SL_LIDAR_VARBITSCALE_X4_DEST_VAL
+        , SL_LIDAR_VARBITSCALE_X8_DEST_VAL, SL_LIDAR_VARBITSCALE_X16_DEST_VAL };
+    return SRC_BASE[scaleLevel] + ((scaled - DEST_BASE[scaleLevel]) << scaleLevel);
+}
+
+// the 10 bit prediction, 0x1FF marks a sample without measurement
+static sl_u32 ultraPredict(sl_u32 distance, sl_u32 base, sl_u32 scaleLevel)
+{
+    if (!distance || !base) return 0x1FF;
+    int predict = ((int)distance - (int)base) >> scaleLevel;
+    if (predict < -511 || predict > 510) return 0x1FF;
+    return (sl_u32)predict & 0x3FF;
+}
+
+static sl_u32 ultraDenseEncode(sl_u32 distance, sl_u8 quality)
+{
+    static const sl_u32 SCALE_BASE_Q2[] = { 0, 2046 << 2, 8187 << 2, 24567 << 2 };
+    if (!distance) return 0;
+
+    const sl_u32 dist_q2 = distance << 2;
+    for (sl_u32 scale = 0; scale < 4; ++scale) {
+        if (scale < 3 && dist_q2 >= SCALE_BASE_Q2[scale + 1]) continue;
+        const sl_u32 mask = (0x1000u << scale) - 4;
+        sl_u32 field = ((dist_q2 - SCALE_BASE_Q2[scale]) / (scale + 2)) & ~0x3u;
+        if (field > mask) return 0;
+        return scale | field | ((sl_u32)(quality >> scale) << (12 + scale));
+    }
+    return 0;
+}
+
+// Encodes the samples of one scan mode into its answer packets
+class SimPacketEncoder
+{
+public:
+    SimPacketEncoder(const SimScanMode& mode, const SimulatedScene& scene)
+        : _mode(mode), _scene(scene), _sampleIdx(0), _packetCount(0)
+    {
+        switch (mode.ansType) {
+        case SL_LIDAR_ANS_TYPE_MEASUREMENT:
+            _packetSize = sizeof(sl_lidar_response_measurement_node_t);
+            _samplesPerPacket = 1;
+            break;
+        case SL_LIDAR_ANS_TYPE_MEASUREMENT_CAPSULED:
+            _packetSize = sizeof(sl_lidar_response_capsule_measurement_nodes_t);
+            _samplesPerPacket = 32;
+            break;
+        case SL_LIDAR_ANS_TYPE_MEASUREMENT_CAPSULED_ULTRA:
+            _packetSize = sizeof(sl_lidar_response_ultra_capsule_measurement_nodes_t);
+            _samplesPerPacket = 96;
+            break;
+        case SL_LIDAR_ANS_TYPE_MEASUREMENT_DENSE_CAPSULED:
+            _packetSize = sizeof(sl_lidar_response_dense_capsule_measurement_nodes_t);
+            _samplesPerPacket = 40;
+            break;
+        case SL_LIDAR_ANS_TYPE_MEASUREMENT_ULTRA_DENSE_CAPSULED:
+            _packetSize = sizeof(sl_lidar_response_ultra_dense_capsule_measurement_nodes_t);
+            _samplesPerPacket = 64;
+            break;
+        default:
+            _packetSize = sizeof(sl_lidar_response_hq_capsule_measurement_nodes_t);
+            _samplesPerPacket = 96;
+            break;
+        }
+    }
+
+    size_t getPacketSize() const { return _packetSize; }
+    size_t getSamplesPerPacket() const { return _samplesPerPacket; }
+
+    void encode(sl_u8* out, sl_u64 timestamp_uS)
+    {
+        memset(out, 0, _packetSize);
+        switch (_mode.ansType) {
+        case SL_LIDAR_ANS_TYPE_MEASUREMENT:
+            _encodeNormal(out);
+            break;
+        case SL_LIDAR_ANS_TYPE_MEASUREMENT_CAPSULED:
+            _encodeCapsule(out);
+            break;
+        case SL_LIDAR_ANS_TYPE_MEASUREMENT_CAPSULED_ULTRA:
+            _encodeUltraCapsule(out);
+            break;
+        case SL_LIDAR_ANS_TYPE_MEASUREMENT_DENSE_CAPSULED:
+            _encodeDenseCapsule(out);
+            break;
+        case SL_LIDAR_ANS_TYPE_MEASUREMENT_ULTRA_DENSE_CAPSULED:
+            _encodeUltraDenseCapsule(out, timestamp_uS);
+            break;
+        default:
+            _encodeHQCapsule(out, timestamp_uS);
+            break;
+        }
+        _sampleIdx += _samplesPerPacket;
+        ++_packetCount;
+    }
+
+private:
+    void _encodeNormal(sl_u8* out)
+    {
+        sl_lidar_response_measurement_node_t* node = reinterpret_cast<sl_lidar_response_measurement_node_t*>(out);
+        SimSample sample = _scene.sampleAt(_sampleIdx);
+        node->sync_quality = (sl_u8)((sample.quality & ~0x3) | (sample.sync ? SL_LIDAR_RESP_MEASUREMENT_SYNCBIT : SL_LIDAR_RESP_MEASUREMENT_SYNCBIT << 1));
+        node->angle_q6_checkbit = (sl_u16)((toAngleQ6(sample.angle) << SL_LIDAR_RESP_MEASUREMENT_ANGLE_SHIFT) | SL_LIDAR_RESP_MEASUREMENT_CHECKBIT);
+        node->distance_q2 = (sl_u16)std::min<sl_u32>(sample.distance << 2, 0xFFFC);
+    }
+
+    void _encodeCapsule(sl_u8* out)
+    {
+        sl_lidar_response_capsule_measurement_nodes_t* capsule = reinterpret_cast<sl_lidar_response_capsule_measurement_nodes_t*>(out);
+        for (int pos = 0; pos < _countof(capsule->cabins); ++pos) {
+            capsule->cabins[pos].distance_angle_1 = (sl_u16)std::min<sl_u32>(_scene.sampleAt(_sampleIdx + pos * 2).distance << 2, 0xFFFC);
+            capsule->cabins[pos].distance_angle_2 = (sl_u16)std::min<sl_u32>(_scene.sampleAt(_sampleIdx + pos * 2 + 1).distance << 2, 0xFFFC);
+        }
+        capsule->start_angle_sync_q6 = toStartAngleSync(_scene.sampleAt(_sampleIdx).angle, _packetCount == 0);
+        sealCapsule(out, offsetof(sl_lidar_response_capsule_measurement_nodes_t, start_angle_sync_q6), _packetSize);
+    }
+
+    void _encodeUltraCapsule(sl_u8* out)
+    {
+        sl_lidar_response_ultra_capsule_measurement_nodes_t* capsule = reinterpret_cast<sl_lidar_response_ultra_capsule_measurement_nodes_t*>(out);
+        for (int pos = 0; pos < _countof(capsule->ultra_cabins); ++pos) {
+            const sl_u64 idx = _sampleIdx + pos * 3;
+            sl_u32 level, nextLevel;
+            sl_u32 major = varbitscaleEncode(_scene.sampleAt(idx).distance, level);
+            sl_u32 nextMajor = varbitscaleEncode(_scene.sampleAt(idx + 3).distance, nextLevel);
+
+            // the decoder predicts from the next major when this one has no measurement
+            sl_u32 base1 = varbitscaleDecode(major, level);
+            if (!base1) {
+                base1 = varbitscaleDecode(nextMajor, nextLevel);
+                level = nextLevel;
+            }
+            sl_u32 predict1 = ultraPredict(_scene.sampleAt(idx + 1).distance, base1, level);
+            sl_u32 predict2 = ultraPredict(_scene.sampleAt(idx + 2).distance, varbitscaleDecode(nextMajor, nextLevel), nextLevel);
+            capsule->ultra_cabins[pos].combined_x3 = major | (predict1 << 12) | (predict2 << 22);
+        }
+        capsule->start_angle_sync_q6 = toStartAngleSync(_scene.sampleAt(_sampleIdx).angle, _packetCount == 0);
+        sealCapsule(out, offsetof(sl_lidar_response_ultra_capsule_measurement_nodes_t, start_angle_sync_q6), _packetSize);
+    }
+
+    void _encodeDenseCapsule(sl_u8* out)
+    {
+        sl_lidar_response_dense_capsule_measurement_nodes_t* capsule = reinterpret_cast<sl_lidar_response_dense_capsule_measurement_nodes_t*>(out);
+        for (int pos = 0; pos < _countof(capsule->cabins); ++pos) {
+            capsule->cabins[pos].distance = (sl_u16)std::min<sl_u32>(_scene.sampleAt(_sampleIdx + pos).distance, 0xFFFF);
+        }
+        capsule->start_angle_sync_q6 = toStartAngleSync(_scene.sampleAt(_sampleIdx).angle, _packetCount == 0);
+        sealCapsule(out, offsetof(sl_lidar_response_dense_capsule_measurement_nodes_t, start_angle_sync_q6), _packetSize);
+    }
+
+    void _encodeUltraDenseCapsule(sl_u8* out, sl_u64 timestamp_uS)
+    {
+        sl_lidar_response_ultra_dense_capsule_measurement_nodes_t* capsule = reinterpret_cast<sl_lidar_response_ultra_dense_capsule_measurement_nodes_t*>(out);
+        capsule->time_stamp = (sl_u32)timestamp_uS;
+        for (int pos = 0; pos < _countof(capsule->cabins); ++pos) {
+            SimSample first = _scene.sampleAt(_sampleIdx + pos * 2);
+            SimSample second = _scene.sampleAt(_sampleIdx + pos * 2 + 1);
+            sl_u32 encoded1 = ultraDenseEncode(first.distance, first.quality);
+            sl_u32 encoded2 = ultraDenseEncode(second.distance, second.quality);
+            capsule->cabins[pos].qualityl_distance_scale[0] = (sl_u16)encoded1;
+            capsule->cabins[pos].qualityl_distance_scale[1] = (sl_u16)encoded2;
+            capsule->cabins[pos].qualityh_array = (sl_u8)(((encoded1 >> 16) & 0xF) | ((encoded2 >> 16) << 4));
+        }
+        capsule->start_angle_sync_q6 = toStartAngleSync(_scene.sampleAt(_sampleIdx).angle, _packetCount == 0);
+        sealCapsule(out, offsetof(sl_lidar_response_ultra_dense_capsule_measurement_nodes_t, time_stamp), _packetSize);
+    }
+
+    void _encodeHQCapsule(sl_u8* out, sl_u64 timestamp_uS)
+    {
+        sl_lidar_response_hq_capsule_measurement_nodes_t* capsule = reinterpret_cast<sl_lidar_response_hq_capsule_measurement_nodes_t*>(out);
+        capsule->sync_byte = SL_LIDAR_RESP_MEASUREMENT_HQ_SYNC;
+        capsule->time_stamp = timestamp_uS;
+        for (int pos = 0; pos < _countof(capsule->node_hq); ++pos) {
+            SimSample sample = _scene.sampleAt(_sampleIdx + pos);
+            capsule->node_hq[pos].angle_z_q14 = (sl_u16)((sl_u32)(sample.angle * 16384.0 / 90.0) & 0xFFFF);
+            capsule->node_hq[pos].dist_mm_q2 = sample.distance << 2;
+            capsule->node_hq[pos].quality = sample.quality;
+            capsule->node_hq[pos].flag = sample.sync ? SL_LIDAR_RESP_HQ_FLAG_SYNCBIT : 0;
+        }
+        capsule->crc32 = crc32::getResult(out, (sl_u32)(_packetSize - sizeof(capsule->crc32)));
+    }
+
+    const SimScanMode& _mode;
+    const SimulatedScene& _scene;
+    size_t _packetSize;
+    size_t _samplesPerPacket;
+    sl_u64 _sampleIdx;
+    sl_u64 _packetCount;
+};
+
+// The byte pipe to one client. Reads never block, writes block on tcp only: a serial line
+// or a udp socket drops what the other end does not take in time.
+class SimLink
+{
+public:
+    virtual ~SimLink() {}
+
+    virtual bool open(int index, const SimulatorOptions& options) = 0;
+    virtual std::string describe() const = 0;
+    virtual int getPollFd() const = 0;
+    // called when getPollFd() is readable, returns the bytes received (0 for none)
+    virtual size_t onReadable(sl_u8* buffer, size_t size) = 0;
+    virtual bool isConnected() const = 0;
+    // returns false if the data could not be delivered completely
+    virtual bool write(const sl_u8* data, size_t size) = 0;
+};
+
+class TcpSimLink : public SimLink
+{
+public:
+    TcpSimLink() : _listenSocket(-1), _clientSocket(-1), _port(0) {}
+
+    virtual ~TcpSimLink()
+    {
+        if (_clientSocket >= 0) close(_clientSocket);
+        if (_listenSocket >= 0) close(_listenSocket);
+    }
+
+    virtual bool open(int index, const SimulatorOptions& options)
+    {
+        _port = options.port + index;
+        _listenSocket = socket(AF_INET, SOCK_STREAM, 0);
+        if (_listenSocket < 0) return false;
+
+        int reuse = 1;
+        setsockopt(_listenSocket, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+
+        sockaddr_in addr;
+        memset(&addr, 0, sizeof(addr));
+        addr.sin_family = AF_INET;
+        addr.sin_addr.s_addr = htonl(INADDR_ANY);
+        addr.sin_port = htons((sl_u16)_port);
+        if (bind(_listenSocket, (sockaddr*)&addr, sizeof(addr)) < 0) return false;
+        return listen(_listenSocket, 1) == 0;
+    }
+
+    virtual std::string describe() const
+    {
+        char buffer[32];
+        sprintf(buffer, "tcp:%d", _port);
+        return buffer;
+    }
+
+    virtual int getPollFd() const
+    {
+        return _clientSocket >= 0 ? _clientSocket : _listenSocket;
+    }
+
+    virtual size_t onReadable(sl_u8* buffer, size_t size)
+    {
+        if (_clientSocket < 0) {
+            _clientSocket = accept(_listenSocket, NULL, NULL);
+            if (_clientSocket >= 0) {
+                // the answer headers are tiny, do not let them wait for the delayed acks
+                int noDelay = 1;
+                setsockopt(_clientSocket, IPPROTO_TCP, TCP_NODELAY, &noDelay, sizeof(noDelay));
+            }
+            return 0;
+        }
+
+        ssize_t received = recv(_clientSocket, buffer, size, MSG_DONTWAIT);
+        if (received == 0 || (received < 0 && errno != EAGAIN && errno != EINTR)) {
+            _disconnect();
+            return 0;
+        }
+        return received > 0 ? (size_t)received : 0;
+    }
+
+    virtual bool isConnected() const
+    {
+        return _clientSocket >= 0;
+    }
+
+    virtual bool write(const sl_u8* data, size_t size)
+    {
+        while (size && _clientSocket >= 0) {
+            ssize_t sent = ::send(_clientSocket, data, size, MSG_NOSIGNAL);
+            if (sent <= 0) {
+                if (sent < 0 && errno == EINTR) continue;
+                _disconnect();
+                return false;
+            }
+            data += sent;
+            size -= sent;
+        }
+        return size == 0;
+    }
+
+private:
+    void _disconnect()
+    {
+        close(_clientSocket);
+        _clientSocket = -1;
+    }
+
+    int _listenSocket;
+    int _clientSocket;
+    int _port;
+};
+
+class UdpSimLink : public SimLink
+{
+public:
+    enum {
+        MAX_DATAGRAM_SIZE = 1400,
+    };
+
+    UdpSimLink() : _socket(-1), _port(0), _hasPeer(false) {}
+
+    virtual ~UdpSimLink()
+    {
+        if (_socket >= 0) close(_socket);
+    }
+
+    virtual bool open(int index, const SimulatorOptions& options)
+    {
+        _port = options.port + index;
+        _socket = socket(AF_INET, SOCK_DGRAM, 0);
+        if (_socket < 0) return false;
+
+        sockaddr_in addr;
+        memset(&addr, 0, sizeof(addr));
+        addr.sin_family = AF_INET;
+        addr.sin_addr.s_addr = htonl(INADDR_ANY);
+        addr.sin_port = htons((sl_u16)_port);
+        return bind(_socket, (sockaddr*)&addr, sizeof(addr)) == 0;
+    }
+
+    virtual std::string describe() const
+    {
+        char buffer[32];
+        sprintf(buffer, "udp:%d", _port);
+        return buffer;
+    }
+
+    virtual int getPollFd() const
+    {
+        return _socket;
+    }
+
+    virtual size_t onReadable(sl_u8* buffer, size_t size)
+    {
+        // the last sender becomes the client
+        socklen_t peerLen = sizeof(_peer);
+        ssize_t received = recvfrom(_socket, buffer, size, MSG_DONTWAIT, (sockaddr*)&_peer, &peerLen);
+        if (received <= 0) return 0;
+        _hasPeer = true;
+        return (size_t)received;
+    }
+
+    virtual bool isConnected() const
+    {
+        return _hasPeer;
+    }
+
+    virtual bool write(const sl_u8* data, size_t size)
+    {
+        bool delivered = true;
+        while (size && _hasPeer) {
+            size_t chunkSize = std::min<size_t>(size, MAX_DATAGRAM_SIZE);
+            if (sendto(_socket, data, chunkSize, MSG_DONTWAIT, (const sockaddr*)&_peer, sizeof(_peer)) != (ssize_t)chunkSize) {
+                delivered = false;
+            }
+            data += chunkSize;
+            size -= chunkSize;
+        }
+        return delivered;
+    }
+
+private:
+    int _socket;
+    int _port;
+    bool _hasPeer;
+    sockaddr_in _peer;
+};
+
+class PtySimLink : public SimLink
+{
+public:
+    PtySimLink() : _master(-1), _slave(-1) {}
+
+    virtual ~PtySimLink()
+    {
+        if (_slave >= 0) close(_slave);
+        if (_master >= 0) close(_master);
+    }
+
+    virtual bool open(int index, const SimulatorOptions& options)
+    {
+        _master = posix_openpt(O_RDWR | O_NOCTTY | O_NONBLOCK);
+        if (_master < 0) return false;
+        if (grantpt(_master) || unlockpt(_master)) return false;
+
+        const char* slaveName = ptsname(_master);
+        if (!slaveName) return false;
+        _slaveName = slaveName;
+
+        // keep a slave handle so the master does not see a hangup between the clients,
+        // and make the line raw until the client configures it
+        _slave = ::open(slaveName, O_RDWR | O_NOCTTY);
+        if (_slave < 0) return false;
+        termios tio;
+        if (tcgetattr(_slave, &tio) == 0) {
+            cfmakeraw(&tio);
+            tcsetattr(_slave, TCSANOW, &tio);
+        }
+        return true;
+    }
+
+    virtual std::string describe() const
+    {
+        return _slaveName;
+    }
+
+    virtual int getPollFd() const
+    {
+        return _master;
+    }
+
+    virtual size_t onReadable(sl_u8* buffer, size_t size)
+    {
+        ssize_t received = read(_master, buffer, size);
+        return received > 0 ? (size_t)received : 0;
+    }
+
+    virtual bool isConnected() const
+    {
+        return true;
+    }
+
+    virtual bool write(const sl_u8* data, size_t size)
+    {
+        while (size) {
+            ssize_t sent = ::write(_master, data, size);
+            if (sent <= 0) {
+                if (sent < 0 && errno == EINTR) continue;
+                return false;
+            }
+            data += sent;
+            size -= sent;
+        }
+        return true;
+    }
+
+private:
+    int _master;
+    int _slave;
+    std::string _slaveName;
+};
+
+class VirtualLidar
+{
+public:
+    VirtualLidar(int index, const SimulatorOptions& options, SimLink* link)
+        : _index(index), _options(options), _link(link), _running(false), _scanning(false)
+        , _currentMode(0), _samplesSent(0), _bytesSent(0), _bytesDropped(0), _commandCount(0)
+        , _encoder(NULL), _scene(NULL), _packetsSent(0)
+    {
+    }
+
+    ~VirtualLidar()
+    {
+        stop();
+        _stopStreaming();
+        delete _link;
+    }
+
+    bool start()
+    {
+        _running = true;
+        _thread = std::thread(&VirtualLidar::_proc, this);
+        return true;
+    }
+
+    void stop()
+    {
+        _running = false;
+        if (_thread.joinable()) _thread.join();
+    }
+
+    std::string describe() const { return _link->describe(); }
+    bool isScanning() const { return _scanning; }
+    const char* getModeName() const { return SCAN_MODES[_currentMode].name; }
+    sl_u64 getSamplesSent() const { return _samplesSent; }
+    sl_u64 getBytesSent() const { return _bytesSent; }
+    sl_u64 getBytesDropped() const { return _bytesDropped; }
+    sl_u64 getCommandCount() const { return _commandCount; }
+
+private:
+    enum {
+        RX_BUFFER_SIZE = 4096,
+        // do not catch up more than this after a stall (a blocked tcp client)
+        MAX_BURST_SAMPLES = 100000,
+    };
+
+    void _proc()
+    {
+        std::vector<sl_u8> rxBuffer(RX_BUFFER_SIZE);
+        std::chrono::steady_clock::time_point nextTick = std::chrono::steady_clock::now();
+
+        while (_running) {
+            int timeout = 100;
+            if (_scanning) {
+                auto remain = std::chrono::duration_cast<std::chrono::milliseconds>(nextTick - std::chrono::steady_clock::now()).count();
+                timeout = (int)std::max<long long>(0, std::min<long long>(remain, 100));
+            }
+
+            pollfd pfd;
+            pfd.fd = _link->getPollFd();
+            pfd.events = POLLIN;
+            pfd.revents = 0;
+            if (poll(&pfd, 1, timeout) > 0 && (pfd.revents & (POLLIN | POLLHUP | POLLERR))) {
+                bool wasConnected = _link->isConnected();
+                size_t received = _link->onReadable(&rxBuffer[0], rxBuffer.size());
+                if (received) {
+                    _rxPending.insert(_rxPending.end(), &rxBuffer[0], &rxBuffer[0] + received);
+                    _handleCommands();
+                }
+                if (wasConnected && !_link->isConnected()) {
+                    // the client went away, a real device keeps spinning but nobody listens
+                    _stopStreaming();
+                    _rxPending.clear();
+                }
+            }
+
+            if (_scanning && std::chrono::steady_clock::now() >= nextTick) {
+                _streamDueSamples();
+                nextTick += std::chrono::microseconds(_options.tickPeriod_uS);
+                if (nextTick < std::chrono::steady_clock::now()) nextTick = std::chrono::steady_clock::now();
+            }
+        }
+    }
+
+    void _handleCommands()
+    {
+        size_t pos = 0;
+        while (pos < _rxPending.size()) {
+            if (_rxPending[pos] != SL_LIDAR_CMD_SYNC_BYTE) {
+                ++pos;
+                continue;
+            }
+            if (pos + 2 > _rxPending.size()) break;
+
+            const sl_u8 cmd = _rxPending[pos + 1];
+            const sl_u8* payload = NULL;
+            size_t payloadSize = 0;
+            size_t packetSize = 2;
+
+            if (cmd & SL_LIDAR_CMDFLAG_HAS_PAYLOAD) {
+                if (pos + 3 > _rxPending.size()) break;
+                payloadSize = _rxPending[pos + 2];
+                packetSize = 3 + payloadSize + 1;
+                if (pos + packetSize > _rxPending.size()) break;
+
+                sl_u8 checksum = 0;
+                for (size_t i = 0; i < packetSize - 1; ++i) checksum ^= _rxPending[pos + i];
+                if (checksum != _rxPending[pos + packetSize - 1]) {
+                    ++pos;
+                    continue;
+                }
+                payload = &_rxPending[pos + 3];
+            }
+
+            ++_commandCount;
+            _onCommand(cmd, payload, payloadSize);
+            pos += packetSize;
+        }
+        _rxPending.erase(_rxPending.begin(), _rxPending.begin() + pos);
+    }
+
+    void _sendAnswer(sl_u8 ansType, const void* payload, sl_u32 size, bool loop = false)
+    {
+        std::vector<sl_u8> buffer(sizeof(sl_lidar_ans_header_t) + (loop ? 0 : size));
+        sl_lidar_ans_header_t* header = reinterpret_cast<sl_lidar_ans_header_t*>(&buffer[0]);
+        header->syncByte1 = SL_LIDAR_ANS_SYNC_BYTE1;
+        header->syncByte2 = SL_LIDAR_ANS_SYNC_BYTE2;
+        header->size_q30_subtype = size | (loop ? ((sl_u32)SL_LIDAR_ANS_PKTFLAG_LOOP << SL_LIDAR_ANS_HEADER_SUBTYPE_SHIFT) : 0);
+        header->type = ansType;
+        if (!loop && size) memcpy(&buffer[sizeof(sl_lidar_ans_header_t)], payload, size);
+        _link->write(&buffer[0], buffer.size());
+    }
+
+    void _sendConfAnswer(sl_u32 type, const void* payload, size_t size)
+    {
+        std::vector<sl_u8> buffer(sizeof(sl_u32) + size);
+        memcpy(&buffer[0], &type, sizeof(type));
+        if (size) memcpy(&buffer[sizeof(sl_u32)], payload, size);
+        _sendAnswer(SL_LIDAR_ANS_TYPE_GET_LIDAR_CONF, &buffer[0], (sl_u32)buffer.size());
+    }
+
+    void _onGetLidarConf(const sl_u8* payload, size_t payloadSize)
+    {
+        if (payloadSize < sizeof(sl_u32)) return;
+        sl_u32 type;
+        memcpy(&type, payload, sizeof(type));
+
+        sl_u16 modeId = 0;
+        if (payloadSize >= sizeof(sl_u32) + sizeof(sl_u16)) memcpy(&modeId, payload + sizeof(sl_u32), sizeof(modeId));
+        if (modeId >= _countof(SCAN_MODES)) modeId = 0;
+        const SimScanMode& mode = SCAN_MODES[modeId];
+
+        switch (type) {
+        case SL_LIDAR_CONF_SCAN_MODE_COUNT:
+        {
+            sl_u16 count = _countof(SCAN_MODES);
+            _sendConfAnswer(type, &count, sizeof(count));
+            break;
+        }
+        case SL_LIDAR_CONF_SCAN_MODE_US_PER_SAMPLE:
+        {
+            sl_u32 us_q8 = (sl_u32)(mode.usPerSample * 256);
+            _sendConfAnswer(type, &us_q8, sizeof(us_q8));
+            break;
+        }
+        case SL_LIDAR_CONF_SCAN_MODE_MAX_DISTANCE:
+        {
+            sl_u32 distance_q8 = (sl_u32)(mode.maxDistance * 256);
+            _sendConfAnswer(type, &distance_q8, sizeof(distance_q8));
+            break;
+        }
+        case SL_LIDAR_CONF_SCAN_MODE_ANS_TYPE:
+            _sendConfAnswer(type, &mode.ansType, sizeof(mode.ansType));
+            break;
+        case SL_LIDAR_CONF_SCAN_MODE_TYPICAL:
+            _sendConfAnswer(type, &TYPICAL_SCAN_MODE, sizeof(TYPICAL_SCAN_MODE));
+            break;
+        case SL_LIDAR_CONF_SCAN_MODE_NAME:
+            _sendConfAnswer(type, mode.name, strlen(mode.name) + 1);
+            break;
+        case SL_LIDAR_CONF_MIN_ROT_FREQ:
+            _sendConfAnswer(type, &MIN_MOTOR_RPM, sizeof(MIN_MOTOR_RPM));
+            break;
+        case SL_LIDAR_CONF_MAX_ROT_FREQ:
+            _sendConfAnswer(type, &MAX_MOTOR_RPM, sizeof(MAX_MOTOR_RPM));
+            break;
+        case SL_LIDAR_CONF_DESIRED_ROT_FREQ:
+        {
+            sl_lidar_response_desired_rot_speed_t speed;
+            speed.rpm = (sl_u16)(_options.scanFrequency * 60);
+            speed.pwm_ref = DEFAULT_MOTOR_PWM;
+            _sendConfAnswer(type, &speed, sizeof(speed));
+            break;
+        }
+        default:
+            // unknown to this device: an empty answer, the sdk falls back to its defaults
+            _sendConfAnswer(type, NULL, 0);
+            break;
+        }
+    }
+
+    void _onCommand(sl_u8 cmd, const sl_u8* payload, size_t payloadSize)
+    {
+        switch (cmd) {
+        case SL_LIDAR_CMD_GET_DEVICE_INFO:
+        {
+            sl_lidar_response_device_info_t info;
+            info.model = _options.model;
+            info.firmware_version = _options.firmwareVersion;
+            info.hardware_version = _options.hardwareVersion;
+            for (size_t pos = 0; pos < sizeof(info.serialnum); ++pos) info.serialnum[pos] = (sl_u8)(pos == 0 ? 0x5A : pos == 1 ? _index : pos);
+            _sendAnswer(SL_LIDAR_ANS_TYPE_DEVINFO, &info, sizeof(info));
+            break;
+        }
+        case SL_LIDAR_CMD_GET_DEVICE_HEALTH:
+        {
+            sl_lidar_response_device_health_t health;
+            health.status = SL_LIDAR_STATUS_OK;
+            health.error_code = 0;
+            _sendAnswer(SL_LIDAR_ANS_TYPE_DEVHEALTH, &health, sizeof(health));
+            break;
+        }
+        case SL_LIDAR_CMD_GET_SAMPLERATE:
+        {
+            sl_lidar_response_sample_rate_t rate;
+            rate.std_sample_duration_us = (sl_u16)SCAN_MODES[0].usPerSample;
+            rate.express_sample_duration_us = (sl_u16)SCAN_MODES[1].usPerSample;
+            _sendAnswer(SL_LIDAR_ANS_TYPE_SAMPLE_RATE, &rate, sizeof(rate));
+            break;
+        }
+        case SL_LIDAR_CMD_GET_LIDAR_CONF:
+            _onGetLidarConf(payload, payloadSize);
+            break;
+        case SL_LIDAR_CMD_SET_LIDAR_CONF:
+        {
+            sl_lidar_response_set_lidar_conf_t ans;
+            ans.type = 0;
+            if (payloadSize >= sizeof(sl_u32)) memcpy(&ans.type, payload, sizeof(sl_u32));
+            ans.result = 0;
+            _sendAnswer(SL_LIDAR_ANS_TYPE_SET_LIDAR_CONF, &ans, sizeof(ans));
+            break;
+        }
+        case SL_LIDAR_CMD_GET_ACC_BOARD_FLAG:
+        {
+            sl_lidar_response_acc_board_flag_t flag;
+            flag.support_flag = SL_LIDAR_RESP_ACC_BOARD_FLAG_MOTOR_CTRL_SUPPORT_MASK;
+            _sendAnswer(SL_LIDAR_ANS_TYPE_ACC_BOARD_FLAG, &flag, sizeof(flag));
+            break;
+        }
+        case SL_LIDAR_CMD_SCAN:
+        case SL_LIDAR_CMD_FORCE_SCAN:
+            _startStreaming(0);
+            break;
+        case SL_LIDAR_CMD_EXPRESS_SCAN:
+        {
+            sl_lidar_payload_express_scan_t req;
+            memset(&req, 0, sizeof(req));
+            memcpy(&req, payload, std::min(payloadSize, sizeof(req)));
+            _startStreaming(req.working_mode < _countof(SCAN_MODES) ? req.working_mode : 1);
+            break;
+        }
+        case SL_LIDAR_CMD_HQ_SCAN:
+            _startStreaming(5);
+            break;
+        case SL_LIDAR_CMD_STOP:
+        case SL_LIDAR_CMD_RESET:
+            _stopStreaming();
+            break;
+        default:
+            // SET_MOTOR_PWM, HQ_MOTOR_SPEED_CTRL and the rest need no answer
+            break;
+        }
+    }
+
+    void _startStreaming(int modeId)
+    {
+        _stopStreaming();
+
+        _currentMode = modeId;
+        const SimScanMode& mode = SCAN_MODES[modeId];
+        _scene = new SimulatedScene(mode, _options.scanFrequency, _index);
+        _encoder = new SimPacketEncoder(mode, *_scene);
+        _packetsSent = 0;
+        _streamStart = std::chrono::steady_clock::now();
+
+        _sendAnswer(mode.ansType, NULL, (sl_u32)_encoder->getPacketSize(), true);
+        _scanning = true;
+    }
+
+    void _stopStreaming()
+    {
+        _scanning = false;
+        delete _encoder;
+        _encoder = NULL;
+        delete _scene;
+        _scene = NULL;
+    }
+
+    void _streamDueSamples()
+    {
+        const SimScanMode& mode = SCAN_MODES[_currentMode];
+        auto elapsed_uS = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - _streamStart).count();
+
+        sl_u64 samplesDue = (sl_u64)(elapsed_uS * _options.rateMultiplier / mode.usPerSample);
+        sl_u64 packetsDue = samplesDue / _encoder->getSamplesPerPacket();
+        if (packetsDue <= _packetsSent) return;
+
+        sl_u64 packetCount = packetsDue - _packetsSent;
+        const sl_u64 maxPackets = std::max<sl_u64>(1, MAX_BURST_SAMPLES / _encoder->getSamplesPerPacket());
+        if (packetCount > maxPackets) {
+            // fell behind, the skipped samples are lost as they would be on a real device
+            _packetsSent += packetCount - maxPackets;
+            packetCount = maxPackets;
+        }
+
+        const size_t packetSize = _encoder->getPacketSize();
+        _txBuffer.resize((size_t)packetCount * packetSize);
+        for (sl_u64 pos = 0; pos < packetCount; ++pos) {
+            // the device clock runs at the scaled rate as well
+            sl_u64 deviceTime_uS = (sl_u64)((_packetsSent + pos) * _encoder->getSamplesPerPacket() * mode.usPerSample);
+            _encoder->encode(&_txBuffer[(size_t)pos * packetSize], deviceTime_uS);
+        }
+        _packetsSent += packetCount;
+
+        if (_link->write(&_txBuffer[0], _txBuffer.size())) {
+            _bytesSent += _txBuffer.size();
+            _samplesSent += packetCount * _encoder->getSamplesPerPacket();
+        }
+        else {
+            _bytesDropped += _txBuffer.size();
+        }
+    }
+
+    int _index;
+    const SimulatorOptions& _options;
+    SimLink* _link;
+    std::thread _thread;
+    std::atomic<bool> _running;
+    std::atomic<bool> _scanning;
+    std::atomic<int> _currentMode;
+    std::atomic<sl_u64> _samplesSent;
+    std::atomic<sl_u64> _bytesSent;
+    std::atomic<sl_u64> _bytesDropped;
+    std::atomic<sl_u64> _commandCount;
+
+    // owned by the device thread
+    std::vector<sl_u8> _rxPending;
+    std::vector<sl_u8> _txBuffer;
+    SimPacketEncoder* _encoder;
+    SimulatedScene* _scene;
+    sl_u64 _packetsSent;
+    std::chrono::steady_clock::time_point _streamStart;
+};
+
+void print_usage(int argc, const char * argv[])
+{
+    printf("Usage:\n"
+           " %s [--tcp <port> | --udp <port> | --pty] [options]\n"
+           " Serves virtual lidars speaking the SLAMTEC wire protocol, tcp port 20108 by default.\n"
+           " Every device uses the next port (tcp/udp) or its own pseudo terminal (pty).\n"
+           "  --count <n>          number of virtual devices, 1 by default\n"
+           "  --rate <x>           sample rate multiplier over the real hardware, 1 by default\n"
+           "  --frequency <hz>     scan frequency at the real rate, 10 by default\n"
+           "  --tick <us>          send period in microseconds, 1000 by default\n"
+           "  --model <id>         reported model id (e.g. 0x31 for A3, 0x71 for S2), 0x31 by default\n"
+           "  --firmware <ver>     reported firmware version (e.g. 0x0120 for 1.32), 0x0120 by default\n"
+           " Scan modes:\n"
+           , argv[0]);
+    for (int pos = 0; pos < _countof(SCAN_MODES); ++pos) {
+        printf("  %d %-12s answer 0x%02X  %.2fus per sample\n", SCAN_MODES[pos].id, SCAN_MODES[pos].name
+            , SCAN_MODES[pos].ansType, SCAN_MODES[pos].usPerSample);
+    }
+}
+
+bool ctrl_c_pressed;
+void ctrlc(int)
+{
+    ctrl_c_pressed = true;
+}
+
+int main(int argc, const char * argv[]) {
+    SimulatorOptions options;
+
+    for (int pos = 1; pos < argc; ++pos) {
+        if (strcmp(argv[pos], "--tcp") == 0 && pos + 1 < argc) {
+            options.transport = SIM_TRANSPORT_TCP;
+            options.port = atoi(argv[++pos]);
+        } else if (strcmp(argv[pos], "--udp") == 0 && pos + 1 < argc) {
+            options.transport = SIM_TRANSPORT_UDP;
+            options.port = atoi(argv[++pos]);
+        } else if (strcmp(argv[pos], "--pty") == 0) {
+            options.transport = SIM_TRANSPORT_PTY;
+        } else if (strcmp(argv[pos], "--count") == 0 && pos + 1 < argc) {
+            options.deviceCount = atoi(argv[++pos]);
+        } else if (strcmp(argv[pos], "--rate") == 0 && pos + 1 < argc) {
+            options.rateMultiplier = atof(argv[++pos]);
+        } else if (strcmp(argv[pos], "--frequency") == 0 && pos + 1 < argc) {
+            options.scanFrequency = atof(argv[++pos]);
+        } else if (strcmp(argv[pos], "--tick") == 0 && pos + 1 < argc) {
+            options.tickPeriod_uS = atoi(argv[++pos]);
+        } else if (strcmp(argv[pos], "--model") == 0 && pos + 1 < argc) {
+            options.model = (sl_u8)strtoul(argv[++pos], NULL, 0);
+        } else if (strcmp(argv[pos], "--firmware") == 0 && pos + 1 < argc) {
+            options.firmwareVersion = (sl_u16)strtoul(argv[++pos], NULL, 0);
+        } else {
+            print_usage(argc, argv);
+            return -1;
+        }
+    }
+
+    if (options.deviceCount < 1 || options.rateMultiplier <= 0 || options.scanFrequency <= 0 || options.tickPeriod_uS <= 0) {
+        print_usage(argc, argv);
+        return -1;
+    }
+
+    std::vector<VirtualLidar*> devices;
+    for (int index = 0; index < options.deviceCount; ++index) {
+        SimLink* link;
+        switch (options.transport) {
+        case SIM_TRANSPORT_UDP: link = new UdpSimLink(); break;
+        case SIM_TRANSPORT_PTY: link = new PtySimLink(); break;
+        default: link = new TcpSimLink(); break;
+        }
+
+        if (!link->open(index, options)) {
+            fprintf(stderr, "Error, cannot open the link of virtual device %d: %s\n", index, strerror(errno));
+            delete link;
+            for (size_t pos = 0; pos < devices.size(); ++pos) delete devices[pos];
+            return -2;
+        }
+        devices.push_back(new VirtualLidar(index, options, link));
+        printf("virtual device %d on %s\n", index, devices.back()->describe().c_str());
+    }
+    fflush(stdout);
+
+    signal(SIGINT, ctrlc);
+    signal(SIGPIPE, SIG_IGN);
+
+    for (size_t pos = 0; pos < devices.size(); ++pos) devices[pos]->start();
+
+    std::vector<sl_u64> lastSamples(devices.size(), 0);
+    std::vector<sl_u64> lastBytes(devices.size(), 0);
+    std::chrono::steady_clock::time_point lastReport = std::chrono::steady_clock::now();
+
+    while (!ctrl_c_pressed) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+        std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+        double interval = std::chrono::duration<double>(now - lastReport).count();
+        if (interval < 1.0) continue;
+        lastReport = now;
+
+        double totalSamples = 0, totalBytes = 0;
+        for (size_t pos = 0; pos < devices.size(); ++pos) {
+            sl_u64 samples = devices[pos]->getSamplesSent();
+            sl_u64 bytes = devices[pos]->getBytesSent();
+            double sampleRate = (samples - lastSamples[pos]) / interval;
+            double byteRate = (bytes - lastBytes[pos]) / interval;
+            lastSamples[pos] = samples;
+            lastBytes[pos] = bytes;
+            totalSamples += sampleRate;
+            totalBytes += byteRate;
+
+            if (devices[pos]->isScanning()) {
+                printf("[%d] %-12s %10.0f samples/s %10.1f KB/s  dropped %llu bytes\n", (int)pos, devices[pos]->getModeName()
+                    , sampleRate, byteRate / 1024, (unsigned long long)devices[pos]->getBytesDropped());
+            }
+        }
+        if (devices.size() > 1) {
+            printf("total %10.0f samples/s %10.1f KB/s\n", totalSamples, totalBytes / 1024);
+        }
+        fflush(stdout);
+    }
+
+    for (size_t pos = 0; pos < devices.size(); ++pos) delete devices[pos];
+    return 0;
+}
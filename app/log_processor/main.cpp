@@ -0,0 +1,166 @@
+/*
+ *  SLAMTEC LIDAR
+ *  Offline processor for the logs of data_logger
+ *
+ *  Copyright (c) 2014 - 2020 Shanghai Slamtec Co., Ltd.
+ *  http://www.slamtec.com
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+#include <algorithm>
+#include <thread>
+
+#include "sl_lidar.h"
+#include "sl_lidar_driver.h"
+#include "sl_lidar_offline.h"
+
+using namespace sl;
+
+// One line of the summary file
+struct ScanSummary {
+    unsigned long long scanNumber;
+    unsigned long long timestamp_uS;
+    size_t rawCount;
+    size_t count;
+    size_t segmentCount;
+    float minRange;
+
+    bool operator<(const ScanSummary & other) const { return scanNumber < other.scanNumber; }
+};
+
+void print_usage(int argc, const char * argv[])
+{
+    printf("Usage:\n"
+           " %s [options] <log file> [log file ...]\n"
+           " The logs are the CSV files (lidar_data_*.csv) or the .slr recordings of data_logger.\n"
+           " Options:\n"
+           "  --threads <n>            worker threads, one per hardware thread by default\n"
+           "  --range <min> <max>      keep the ranges within [min, max] mm\n"
+           "  --quality <q>            keep the nodes with quality >= q\n"
+           "  --median <window>        median filter of the ranges (odd window, 3 to 15)\n"
+           "  --shadow                 remove the veiling points\n"
+           "  --downsample <degree>    keep the nearest node per angular bin\n"
+           "  --bins <n>               bin the filtered scans into n bins (the min range of each)\n"
+           "  --lines                  extract the line segments\n"
+           "  --summary <file>         write one CSV line per scan, in the scan order:\n"
+           "                           scan_number,timestamp_us,raw_nodes,nodes,segments,min_range\n"
+           , argv[0]);
+}
+
+int main(int argc, const char * argv[])
+{
+    LidarOfflineOptions options;
+    const char * summaryPath = NULL;
+    std::vector<const char *> logs;
+
+    for (int pos = 1; pos < argc; ++pos) {
+        if (strcmp(argv[pos], "--threads") == 0 && pos + 1 < argc) {
+            options.threadCount = (size_t)atoi(argv[++pos]);
+        } else if (strcmp(argv[pos], "--range") == 0 && pos + 2 < argc) {
+            float minRange = (float)atof(argv[++pos]);
+            float maxRange = (float)atof(argv[++pos]);
+            options.filters.addRangeGate(minRange, maxRange);
+        } else if (strcmp(argv[pos], "--quality") == 0 && pos + 1 < argc) {
+            options.filters.addQualityThreshold((sl_u8)atoi(argv[++pos]));
+        } else if (strcmp(argv[pos], "--median") == 0 && pos + 1 < argc) {
+            options.filters.addMedian((size_t)atoi(argv[++pos]));
+        } else if (strcmp(argv[pos], "--shadow") == 0) {
+            options.filters.addShadowRemoval();
+        } else if (strcmp(argv[pos], "--downsample") == 0 && pos + 1 < argc) {
+            options.filters.addAngularDownsample((float)atof(argv[++pos]));
+        } else if (strcmp(argv[pos], "--bins") == 0 && pos + 1 < argc) {
+            options.binCount = (size_t)atoi(argv[++pos]);
+        } else if (strcmp(argv[pos], "--lines") == 0) {
+            options.extractLines = true;
+        } else if (strcmp(argv[pos], "--summary") == 0 && pos + 1 < argc) {
+            summaryPath = argv[++pos];
+        } else if (argv[pos][0] == '-') {
+            print_usage(argc, argv);
+            return -1;
+        } else {
+            logs.push_back(argv[pos]);
+        }
+    }
+
+    if (logs.empty()) {
+        print_usage(argc, argv);
+        return -1;
+    }
+
+    if (!options.threadCount) options.threadCount = std::thread::hardware_concurrency();
+    if (!options.threadCount) options.threadCount = 1;
+
+    FILE * summaryFile = NULL;
+    if (summaryPath) {
+        summaryFile = fopen(summaryPath, "w");
+        if (!summaryFile) {
+            fprintf(stderr, "Error, cannot open output file %s.\n", summaryPath);
+            return -1;
+        }
+        fprintf(summaryFile, "log,scan_number,timestamp_us,raw_nodes,nodes,segments,min_range\n");
+    }
+
+    int exitCode = 0;
+    for (size_t logIndex = 0; logIndex < logs.size(); ++logIndex) {
+        // every worker appends to its own list, they are merged in the scan order once the log is done
+        std::vector<std::vector<ScanSummary> > summaries(options.threadCount);
+
+        LidarOfflineScanCallback callback;
+        if (summaryFile) {
+            callback = [&summaries](const LidarOfflineScan & scan) {
+                ScanSummary summary;
+                summary.scanNumber = scan.scanNumber;
+                summary.timestamp_uS = scan.timestamp_uS;
+                summary.rawCount = scan.rawNodeCount;
+                summary.count = scan.count;
+                summary.segmentCount = scan.segments ? scan.segments->size() : 0;
+                summary.minRange = 0;
+                if (scan.binned) {
+                    summary.minRange = scan.binned->minRange(0, 360);
+                } else {
+                    for (size_t pos = 0; pos < scan.frame->size(); ++pos) {
+                        float range = scan.frame->range()[pos];
+                        if (range > 0 && (summary.minRange == 0 || range < summary.minRange)) summary.minRange = range;
+                    }
+                }
+                summaries[scan.workerIndex].push_back(summary);
+            };
+        }
+
+        LidarOfflineStats stats;
+        sl_result ans = processLidarLog(logs[logIndex], options, callback, &stats);
+        if (SL_IS_FAIL(ans)) {
+            fprintf(stderr, "Error, cannot process %s: %s\n", logs[logIndex]
+                , ans == SL_RESULT_FORMAT_NOT_SUPPORT ? "not a log of data_logger" : "cannot read the file");
+            exitCode = -1;
+            continue;
+        }
+
+        printf("%s: %llu scans, %llu nodes (%llu after filtering), %llu segments, %llu malformed lines"
+               " in %.2fs with %d threads (%.0f scans/s)\n"
+            , logs[logIndex], (unsigned long long)stats.scanCount, (unsigned long long)stats.rawNodeCount
+            , (unsigned long long)stats.filteredNodeCount, (unsigned long long)stats.segmentCount
+            , (unsigned long long)stats.malformedLineCount, stats.elapsed_s, (int)stats.threadCount
+            , stats.elapsed_s > 0 ? stats.scanCount / stats.elapsed_s : 0.0);
+
+        if (summaryFile) {
+            std::vector<ScanSummary> merged;
+            for (size_t pos = 0; pos < summaries.size(); ++pos) {
+                merged.insert(merged.end(), summaries[pos].begin(), summaries[pos].end());
+            }
+            std::sort(merged.begin(), merged.end());
+            for (size_t pos = 0; pos < merged.size(); ++pos) {
+                const ScanSummary & summary = merged[pos];
+                fprintf(summaryFile, "%s,%llu,%llu,%d,%d,%d,%.2f\n", logs[logIndex], summary.scanNumber, summary.timestamp_uS
+                    , (int)summary.rawCount, (int)summary.count, (int)summary.segmentCount, summary.minRange);
+            }
+        }
+    }
+
+    if (summaryFile) fclose(summaryFile);
+    return exitCode;
+}
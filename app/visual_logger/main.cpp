@@ -16,12 +16,15 @@
 #include <fstream>
 #include <ctime>
 #include <vector>
+#include <atomic>
+#include <thread>
 #include <cmath>  // Add this for cos and sin functions
 #include <GL/glew.h>
 #include <GLFW/glfw3.h>
 
 #include "sl_lidar.h" 
 #include "sl_lidar_driver.h"
+#include "sl_lidar_occupancygrid.h"
 
 #ifndef _countof
 #define _countof(_Array) (int)(sizeof(_Array) / sizeof(_Array[0]))
@@ -44,13 +47,15 @@ static inline void delay(sl_word_size_t ms){
 
 using namespace sl;
 
-// Add shader source code
+// The points are uploaded as they come from the lidar (angle in degrees, distance in mm)
+// and projected in the vertex shader
 const char* vertexShaderSource = R"(
     #version 330 core
-    layout (location = 0) in vec2 aPos;
+    layout (location = 0) in vec2 aPolar;
     uniform mat4 projection;
     void main() {
-        gl_Position = projection * vec4(aPos.x, aPos.y, 0.0, 1.0);
+        float rad = radians(aPolar.x);
+        gl_Position = projection * vec4(aPolar.y * cos(rad), aPolar.y * sin(rad), 0.0, 1.0);
         gl_PointSize = 5.0;
     }
 )";
@@ -64,26 +69,496 @@ const char* fragmentShaderSource = R"(
     }
 )";
 
+// History of the last scans, kept in a texture buffer (one slot of MAX_POINTS per scan) and drawn
+// with one instance per scan, fading out with the age of the scan
+const char* historyVertexShaderSource = R"(
+    #version 330 core
+    #define HISTORY_SLOTS 64
+    #define SLOT_STRIDE 8192
+    uniform samplerBuffer history;
+    uniform int scanCounts[HISTORY_SLOTS];
+    uniform float scanTimes[HISTORY_SLOTS];
+    uniform int slotCount;
+    uniform int firstSlot;
+    uniform float now;
+    uniform float fadeTime;
+    uniform mat4 projection;
+    out float alpha;
+    void main() {
+        int slot = (firstSlot + gl_InstanceID) % slotCount;
+        if (gl_VertexID >= scanCounts[slot]) {
+            // culled
+            gl_Position = vec4(2.0, 2.0, 2.0, 1.0);
+            alpha = 0.0;
+            return;
+        }
+        vec2 polar = texelFetch(history, slot * SLOT_STRIDE + gl_VertexID).xy;
+        float rad = radians(polar.x);
+        gl_Position = projection * vec4(polar.y * cos(rad), polar.y * sin(rad), 0.0, 1.0);
+        alpha = fadeTime > 0.0 ? clamp(1.0 - (now - scanTimes[slot]) / fadeTime, 0.0, 1.0) : 1.0;
+    }
+)";
+
+const char* historyFragmentShaderSource = R"(
+    #version 330 core
+    in float alpha;
+    out vec4 FragColor;
+    uniform vec3 color;
+    void main() {
+        FragColor = vec4(color, alpha);
+    }
+)";
+
+// Occupancy grid map, a quad covering the extent of the grid (in mm) with the probabilities as a texture
+const char* mapVertexShaderSource = R"(
+    #version 330 core
+    uniform mat4 projection;
+    uniform vec4 extent;
+    out vec2 uv;
+    void main() {
+        uv = vec2((gl_VertexID & 1) != 0 ? 1.0 : 0.0, (gl_VertexID & 2) != 0 ? 1.0 : 0.0);
+        gl_Position = projection * vec4(extent.xy + uv * extent.zw, 0.0, 1.0);
+    }
+)";
+
+const char* mapFragmentShaderSource = R"(
+    #version 330 core
+    in vec2 uv;
+    out vec4 FragColor;
+    uniform sampler2D occupancy;
+    void main() {
+        float p = texture(occupancy, uv).r;
+        FragColor = vec4(vec3(p * p), 1.0);
+    }
+)";
+
+// Full screen passes over the occupancy texture, the quad is generated from gl_VertexID
+const char* quadVertexShaderSource = R"(
+    #version 330 core
+    out vec2 uv;
+    void main() {
+        vec2 pos = vec2((gl_VertexID & 1) != 0 ? 1.0 : -1.0, (gl_VertexID & 2) != 0 ? 1.0 : -1.0);
+        uv = pos * 0.5 + 0.5;
+        gl_Position = vec4(pos, 0.0, 1.0);
+    }
+)";
+
+// multiplies the occupancy by the decay factor (blended with GL_DST_COLOR, GL_ZERO)
+const char* decayFragmentShaderSource = R"(
+    #version 330 core
+    out vec4 FragColor;
+    uniform float decay;
+    void main() {
+        FragColor = vec4(decay);
+    }
+)";
+
+const char* heatFragmentShaderSource = R"(
+    #version 330 core
+    in vec2 uv;
+    out vec4 FragColor;
+    uniform sampler2D occupancy;
+    void main() {
+        float v = 1.0 - exp(-texture(occupancy, uv).r * 0.1);
+        FragColor = vec4(smoothstep(0.0, 0.4, v), smoothstep(0.3, 0.7, v), smoothstep(0.6, 1.0, v), 1.0);
+    }
+)";
+
+struct ScanPoint {
+    float angle;
+    float distance;
+};
+
+const int MAX_POINTS = 8192;
+
+// Hands the latest scan from the acquisition thread over to the render loop without locking:
+// the producer fills its back slot and swaps it with the shared one, the consumer swaps the
+// shared one with its front slot whenever it has been refreshed. Neither side ever waits.
+class ScanTripleBuffer {
+public:
+    struct Slot {
+        std::vector<ScanPoint> points;
+        int scanNumber;
+        Slot() : scanNumber(0) { points.reserve(MAX_POINTS); }
+    };
+
+    ScanTripleBuffer() : _shared(1), _back(0), _front(2) {}
+
+    Slot& backSlot() { return _slots[_back]; }
+
+    void publish() {
+        _back = _shared.exchange(_back | FRESH_BIT, std::memory_order_acq_rel) & INDEX_MASK;
+    }
+
+    // NULL if nothing has been published since the last call
+    const Slot* acquire() {
+        if (!(_shared.load(std::memory_order_relaxed) & FRESH_BIT)) return NULL;
+        _front = _shared.exchange(_front, std::memory_order_acq_rel) & INDEX_MASK;
+        return &_slots[_front];
+    }
+
+private:
+    enum { INDEX_MASK = 0x3, FRESH_BIT = 0x4 };
+    Slot _slots[3];
+    std::atomic<int> _shared;
+    int _back;
+    int _front;
+};
+
+// Streams the scans into a GPU buffer allocated once. With ARB_buffer_storage the buffer is
+// persistently mapped and split into segments written in turn, a fence guards each segment
+// until the GPU is done drawing from it. Otherwise the points go through glBufferSubData.
+class PointUploader {
+public:
+    enum { SEGMENT_COUNT = 3 };
+
+    PointUploader() : vao(0), vbo(0), _mapped(NULL), _segment(0), _count(0) {
+        memset(_fences, 0, sizeof(_fences));
+    }
+
+    void init() {
+        glGenVertexArrays(1, &vao);
+        glGenBuffers(1, &vbo);
+        glBindVertexArray(vao);
+        glBindBuffer(GL_ARRAY_BUFFER, vbo);
+
+        if (GLEW_ARB_buffer_storage) {
+            const GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+            GLsizeiptr size = SEGMENT_COUNT * MAX_POINTS * sizeof(ScanPoint);
+            glBufferStorage(GL_ARRAY_BUFFER, size, NULL, flags);
+            _mapped = reinterpret_cast<ScanPoint*>(glMapBufferRange(GL_ARRAY_BUFFER, 0, size, flags));
+        }
+        if (!_mapped) {
+            glBufferData(GL_ARRAY_BUFFER, MAX_POINTS * sizeof(ScanPoint), NULL, GL_DYNAMIC_DRAW);
+        }
+
+        glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, sizeof(ScanPoint), (void*)0);
+        glEnableVertexAttribArray(0);
+    }
+
+    void upload(const std::vector<ScanPoint>& points) {
+        _count = points.size() < (size_t)MAX_POINTS ? (int)points.size() : MAX_POINTS;
+
+        if (_mapped) {
+            _segment = (_segment + 1) % SEGMENT_COUNT;
+            if (_fences[_segment]) {
+                glClientWaitSync(_fences[_segment], GL_SYNC_FLUSH_COMMANDS_BIT, 1000000000);
+                glDeleteSync(_fences[_segment]);
+                _fences[_segment] = 0;
+            }
+            memcpy(_mapped + _segment * MAX_POINTS, points.data(), _count * sizeof(ScanPoint));
+        } else {
+            glBindBuffer(GL_ARRAY_BUFFER, vbo);
+            glBufferSubData(GL_ARRAY_BUFFER, 0, _count * sizeof(ScanPoint), points.data());
+        }
+    }
+
+    void draw() {
+        if (!_count) return;
+
+        glBindVertexArray(vao);
+        glDrawArrays(GL_POINTS, _mapped ? _segment * MAX_POINTS : 0, _count);
+
+        if (_mapped) {
+            if (_fences[_segment]) glDeleteSync(_fences[_segment]);
+            _fences[_segment] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+        }
+    }
+
+    void cleanup() {
+        for (int i = 0; i < SEGMENT_COUNT; i++) {
+            if (_fences[i]) glDeleteSync(_fences[i]);
+        }
+        if (_mapped) {
+            glBindBuffer(GL_ARRAY_BUFFER, vbo);
+            glUnmapBuffer(GL_ARRAY_BUFFER);
+        }
+        glDeleteVertexArrays(1, &vao);
+        glDeleteBuffers(1, &vbo);
+    }
+
+    GLuint vao, vbo;
+
+private:
+    ScanPoint* _mapped;
+    GLsync _fences[SEGMENT_COUNT];
+    int _segment;
+    int _count;
+};
+
+GLuint createProgram(const char* vertexSource, const char* fragmentSource);
+
+// Keeps the last scans on the GPU: every scan is uploaded once into its slot of the history ring
+// and accumulated once into the occupancy texture, drawing the trails or the heat map afterwards
+// costs no upload at all.
+class HistoryRenderer {
+public:
+    enum {
+        HISTORY_SLOTS = 64,     // as in historyVertexShaderSource
+        OCCUPANCY_SIZE = 1024,
+    };
+
+    HistoryRenderer()
+        : _historyProgram(0), _decayProgram(0), _heatProgram(0)
+        , _historyBuffer(0), _historyTexture(0), _occupancyTexture(0), _occupancyFBO(0), _emptyVAO(0)
+        , _slotCount(HISTORY_SLOTS), _nextSlot(0), _maxCount(0) {
+        memset(_scanCounts, 0, sizeof(_scanCounts));
+        memset(_scanTimes, 0, sizeof(_scanTimes));
+    }
+
+    void init() {
+        _historyProgram = createProgram(historyVertexShaderSource, historyFragmentShaderSource);
+        _decayProgram = createProgram(quadVertexShaderSource, decayFragmentShaderSource);
+        _heatProgram = createProgram(quadVertexShaderSource, heatFragmentShaderSource);
+
+        // GL 3.3 only guarantees 64K texels in a texture buffer
+        GLint maxTexels = 0;
+        glGetIntegerv(GL_MAX_TEXTURE_BUFFER_SIZE, &maxTexels);
+        _slotCount = maxTexels / MAX_POINTS;
+        if (_slotCount > HISTORY_SLOTS) _slotCount = HISTORY_SLOTS;
+        if (_slotCount < 1) _slotCount = 1;
+
+        glGenBuffers(1, &_historyBuffer);
+        glBindBuffer(GL_TEXTURE_BUFFER, _historyBuffer);
+        glBufferData(GL_TEXTURE_BUFFER, _slotCount * MAX_POINTS * sizeof(ScanPoint), NULL, GL_DYNAMIC_DRAW);
+        glGenTextures(1, &_historyTexture);
+        glBindTexture(GL_TEXTURE_BUFFER, _historyTexture);
+        glTexBuffer(GL_TEXTURE_BUFFER, GL_RG32F, _historyBuffer);
+
+        glGenTextures(1, &_occupancyTexture);
+        glBindTexture(GL_TEXTURE_2D, _occupancyTexture);
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_R16F, OCCUPANCY_SIZE, OCCUPANCY_SIZE, 0, GL_RED, GL_FLOAT, NULL);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+
+        glGenFramebuffers(1, &_occupancyFBO);
+        glBindFramebuffer(GL_FRAMEBUFFER, _occupancyFBO);
+        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, _occupancyTexture, 0);
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+        // the passes read everything from uniforms and textures
+        glGenVertexArrays(1, &_emptyVAO);
+
+        glUseProgram(_historyProgram);
+        glUniform1i(glGetUniformLocation(_historyProgram, "history"), 0);
+        glUniform1i(glGetUniformLocation(_historyProgram, "slotCount"), _slotCount);
+        glUseProgram(_heatProgram);
+        glUniform1i(glGetUniformLocation(_heatProgram, "occupancy"), 0);
+
+        clear();
+    }
+
+    void clear() {
+        memset(_scanCounts, 0, sizeof(_scanCounts));
+        _maxCount = 0;
+
+        glBindFramebuffer(GL_FRAMEBUFFER, _occupancyFBO);
+        glClearColor(0.0f, 0.0f, 0.0f, 0.0f);
+        glClear(GL_COLOR_BUFFER_BIT);
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+        glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
+    }
+
+    void addScan(const std::vector<ScanPoint>& points, float now, const float* projection, float occupancyDecay) {
+        int slot = _nextSlot;
+        _nextSlot = (_nextSlot + 1) % _slotCount;
+
+        int count = points.size() < (size_t)MAX_POINTS ? (int)points.size() : MAX_POINTS;
+        glBindBuffer(GL_TEXTURE_BUFFER, _historyBuffer);
+        glBufferSubData(GL_TEXTURE_BUFFER, slot * MAX_POINTS * sizeof(ScanPoint), count * sizeof(ScanPoint), points.data());
+
+        _scanCounts[slot] = count;
+        _scanTimes[slot] = now;
+        _maxCount = 0;
+        for (int i = 0; i < _slotCount; i++) {
+            if (_scanCounts[i] > _maxCount) _maxCount = _scanCounts[i];
+        }
+
+        glUseProgram(_historyProgram);
+        glUniform1iv(glGetUniformLocation(_historyProgram, "scanCounts"), _slotCount, _scanCounts);
+        glUniform1fv(glGetUniformLocation(_historyProgram, "scanTimes"), _slotCount, _scanTimes);
+
+        // decay the occupancy, then add the new scan on top
+        GLint viewport[4];
+        glGetIntegerv(GL_VIEWPORT, viewport);
+        glBindFramebuffer(GL_FRAMEBUFFER, _occupancyFBO);
+        glViewport(0, 0, OCCUPANCY_SIZE, OCCUPANCY_SIZE);
+        glEnable(GL_BLEND);
+        glBindVertexArray(_emptyVAO);
+
+        glBlendFunc(GL_DST_COLOR, GL_ZERO);
+        glUseProgram(_decayProgram);
+        glUniform1f(glGetUniformLocation(_decayProgram, "decay"), occupancyDecay);
+        glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+
+        glBlendFunc(GL_ONE, GL_ONE);
+        _drawScans(projection, slot, 1, count, now, 0.0f, 1.0f, 1.0f, 1.0f);
+
+        glDisable(GL_BLEND);
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+        glViewport(viewport[0], viewport[1], viewport[2], viewport[3]);
+    }
+
+    void drawTrails(const float* projection, float now, float fadeTime) {
+        if (!_maxCount) return;
+
+        glEnable(GL_BLEND);
+        glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+        // oldest first, so the recent scans are drawn on top
+        _drawScans(projection, _nextSlot, _slotCount, _maxCount, now, fadeTime, 1.0f, 0.6f, 0.0f);
+        glDisable(GL_BLEND);
+    }
+
+    void drawHeat() {
+        glUseProgram(_heatProgram);
+        glActiveTexture(GL_TEXTURE0);
+        glBindTexture(GL_TEXTURE_2D, _occupancyTexture);
+        glBindVertexArray(_emptyVAO);
+        glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+    }
+
+    void cleanup() {
+        glDeleteFramebuffers(1, &_occupancyFBO);
+        glDeleteTextures(1, &_occupancyTexture);
+        glDeleteTextures(1, &_historyTexture);
+        glDeleteBuffers(1, &_historyBuffer);
+        glDeleteVertexArrays(1, &_emptyVAO);
+        glDeleteProgram(_historyProgram);
+        glDeleteProgram(_decayProgram);
+        glDeleteProgram(_heatProgram);
+    }
+
+    int getSlotCount() const { return _slotCount; }
+
+private:
+    void _drawScans(const float* projection, int firstSlot, int instanceCount, int vertexCount, float now, float fadeTime, float r, float g, float b) {
+        glUseProgram(_historyProgram);
+        glUniformMatrix4fv(glGetUniformLocation(_historyProgram, "projection"), 1, GL_FALSE, projection);
+        glUniform1i(glGetUniformLocation(_historyProgram, "firstSlot"), firstSlot);
+        glUniform1f(glGetUniformLocation(_historyProgram, "now"), now);
+        glUniform1f(glGetUniformLocation(_historyProgram, "fadeTime"), fadeTime);
+        glUniform3f(glGetUniformLocation(_historyProgram, "color"), r, g, b);
+
+        glActiveTexture(GL_TEXTURE0);
+        glBindTexture(GL_TEXTURE_BUFFER, _historyTexture);
+        glBindVertexArray(_emptyVAO);
+        glDrawArraysInstanced(GL_POINTS, 0, vertexCount, instanceCount);
+    }
+
+    GLuint _historyProgram, _decayProgram, _heatProgram;
+    GLuint _historyBuffer, _historyTexture;
+    GLuint _occupancyTexture, _occupancyFBO;
+    GLuint _emptyVAO;
+    int _slotCount;
+    int _nextSlot;
+    int _maxCount;
+    GLint _scanCounts[HISTORY_SLOTS];
+    GLfloat _scanTimes[HISTORY_SLOTS];
+};
+
+// Mirrors an occupancy grid in a texture, only the tiles changed since the previous refresh are uploaded
+class MapRenderer {
+public:
+    MapRenderer() : _program(0), _texture(0), _emptyVAO(0), _grid(NULL) {}
+
+    void init(ILidarOccupancyGrid* grid) {
+        _grid = grid;
+        _program = createProgram(mapVertexShaderSource, mapFragmentShaderSource);
+
+        glGenTextures(1, &_texture);
+        glBindTexture(GL_TEXTURE_2D, _texture);
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_R8, (GLsizei)grid->getWidth(), (GLsizei)grid->getHeight(), 0, GL_RED, GL_UNSIGNED_BYTE, NULL);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+
+        glGenVertexArrays(1, &_emptyVAO);
+
+        glUseProgram(_program);
+        glUniform1i(glGetUniformLocation(_program, "occupancy"), 0);
+        glUniform4f(glGetUniformLocation(_program, "extent"), grid->getOriginX(), grid->getOriginY(),
+                    grid->getWidth() * grid->getResolution(), grid->getHeight() * grid->getResolution());
+
+        // every tile is uploaded once, unknown at first
+        _grid->clear();
+        refresh();
+    }
+
+    void refresh() {
+        _tiles.clear();
+        if (!_grid->fetchDirtyTiles(_tiles)) return;
+
+        glBindTexture(GL_TEXTURE_2D, _texture);
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+        for (size_t pos = 0; pos < _tiles.size(); ++pos) {
+            size_t tile = _tiles[pos];
+            if (SL_IS_FAIL(_grid->copyTile(tile, _pixels))) continue;
+            GLint x = (GLint)((tile % _grid->getTileColumns()) * ILidarOccupancyGrid::TILE_SIZE);
+            GLint y = (GLint)((tile / _grid->getTileColumns()) * ILidarOccupancyGrid::TILE_SIZE);
+            glTexSubImage2D(GL_TEXTURE_2D, 0, x, y, ILidarOccupancyGrid::TILE_SIZE, ILidarOccupancyGrid::TILE_SIZE,
+                            GL_RED, GL_UNSIGNED_BYTE, _pixels);
+        }
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+    }
+
+    void draw(const float* projection) {
+        glUseProgram(_program);
+        glUniformMatrix4fv(glGetUniformLocation(_program, "projection"), 1, GL_FALSE, projection);
+        glActiveTexture(GL_TEXTURE0);
+        glBindTexture(GL_TEXTURE_2D, _texture);
+        glBindVertexArray(_emptyVAO);
+        glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+    }
+
+    void cleanup() {
+        glDeleteTextures(1, &_texture);
+        glDeleteVertexArrays(1, &_emptyVAO);
+        glDeleteProgram(_program);
+    }
+
+private:
+    GLuint _program, _texture, _emptyVAO;
+    ILidarOccupancyGrid* _grid;
+    std::vector<size_t> _tiles;
+    sl_u8 _pixels[ILidarOccupancyGrid::TILE_SIZE * ILidarOccupancyGrid::TILE_SIZE];
+};
+
 // OpenGL variables
 GLFWwindow* window = nullptr;
 GLuint shaderProgram;
-GLuint VBO, VAO;
+GLint projLoc, colorLoc;
 GLuint circleVBO, circleVAO;
-std::vector<float> pointData;
-std::vector<float> circleData;
-const int MAX_POINTS = 1800;
-bool shouldClose = false;
+PointUploader pointUploader;
+HistoryRenderer historyRenderer;
+MapRenderer mapRenderer;
+std::vector<ScanPoint> circleData;
+std::atomic<bool> shouldClose(false);
+
+// History views, toggled from the keyboard
+bool showTrails = false;
+bool showHeat = false;
+bool showMap = false;
+const float TRAIL_FADE_TIME = 5.0f;     // seconds
+const float OCCUPANCY_DECAY = 0.99f;    // per scan
+
+// 8m x 8m view centered on the lidar
+const float projection[16] = {
+    2.0f/8000.0f, 0.0f, 0.0f, 0.0f,
+    0.0f, 2.0f/8000.0f, 0.0f, 0.0f,
+    0.0f, 0.0f, 1.0f, 0.0f,
+    0.0f, 0.0f, 0.0f, 1.0f
+};
 
 // LIDAR data variables
 ILidarDriver* drv = nullptr;
-sl_lidar_response_measurement_node_hq_t nodes[8192];
-size_t count = 0;
-float last_angle = 0;
+ScanTripleBuffer scanBuffer;
+ILidarOccupancyGrid* occupancyGrid = nullptr;
+std::ofstream outFile;
 const int BARCOUNT = 360;
-int points_per_degree[BARCOUNT] = {0};
 const int MAX_POINTS_PER_DEGREE = 5;
-int scan_count = 0;
-bool skip_next = false;
 
 // Function declarations
 void print_usage(int argc, const char * argv[]);
@@ -92,6 +567,7 @@ void ctrlc(int);
 void initOpenGL();
 void renderFrame();
 void cleanupOpenGL();
+void acquisitionThread();
 
 // Add shader compilation function
 GLuint compileShader(GLenum type, const char* source) {
@@ -110,6 +586,49 @@ GLuint compileShader(GLenum type, const char* source) {
     return shader;
 }
 
+GLuint createProgram(const char* vertexSource, const char* fragmentSource) {
+    GLuint vertexShader = compileShader(GL_VERTEX_SHADER, vertexSource);
+    GLuint fragmentShader = compileShader(GL_FRAGMENT_SHADER, fragmentSource);
+    
+    GLuint program = glCreateProgram();
+    glAttachShader(program, vertexShader);
+    glAttachShader(program, fragmentShader);
+    glLinkProgram(program);
+
+    GLint success;
+    glGetProgramiv(program, GL_LINK_STATUS, &success);
+    if (!success) {
+        char infoLog[512];
+        glGetProgramInfoLog(program, 512, NULL, infoLog);
+        fprintf(stderr, "Shader program linking failed: %s\n", infoLog);
+        exit(-1);
+    }
+
+    glDeleteShader(vertexShader);
+    glDeleteShader(fragmentShader);
+    return program;
+}
+
+void onKey(GLFWwindow*, int key, int, int action, int) {
+    if (action != GLFW_PRESS) return;
+
+    switch (key) {
+    case GLFW_KEY_H:
+        showTrails = !showTrails;
+        break;
+    case GLFW_KEY_O:
+        showHeat = !showHeat;
+        break;
+    case GLFW_KEY_M:
+        showMap = !showMap;
+        break;
+    case GLFW_KEY_C:
+        historyRenderer.clear();
+        occupancyGrid->clear();
+        break;
+    }
+}
+
 // Modified OpenGL initialization
 void initOpenGL() {
     if (!glfwInit()) {
@@ -129,55 +648,43 @@ void initOpenGL() {
     }
 
     glfwMakeContextCurrent(window);
+    // the render rate follows the display, the scans arrive on their own thread
+    glfwSwapInterval(1);
 
+    glewExperimental = GL_TRUE;
     if (glewInit() != GLEW_OK) {
         fprintf(stderr, "Failed to initialize GLEW\n");
         exit(-1);
     }
 
-    // Create and compile shaders
-    GLuint vertexShader = compileShader(GL_VERTEX_SHADER, vertexShaderSource);
-    GLuint fragmentShader = compileShader(GL_FRAGMENT_SHADER, fragmentShaderSource);
-    
-    shaderProgram = glCreateProgram();
-    glAttachShader(shaderProgram, vertexShader);
-    glAttachShader(shaderProgram, fragmentShader);
-    glLinkProgram(shaderProgram);
+    shaderProgram = createProgram(vertexShaderSource, fragmentShaderSource);
 
-    GLint success;
-    glGetProgramiv(shaderProgram, GL_LINK_STATUS, &success);
-    if (!success) {
-        char infoLog[512];
-        glGetProgramInfoLog(shaderProgram, 512, NULL, infoLog);
-        fprintf(stderr, "Shader program linking failed: %s\n", infoLog);
-        exit(-1);
-    }
-
-    glDeleteShader(vertexShader);
-    glDeleteShader(fragmentShader);
+    projLoc = glGetUniformLocation(shaderProgram, "projection");
+    colorLoc = glGetUniformLocation(shaderProgram, "color");
 
     // Create buffers for points
-    glGenVertexArrays(1, &VAO);
-    glGenBuffers(1, &VBO);
+    pointUploader.init();
+    historyRenderer.init();
+    mapRenderer.init(occupancyGrid);
+    glfwSetKeyCallback(window, onKey);
     
     // Create buffers for circles
     glGenVertexArrays(1, &circleVAO);
     glGenBuffers(1, &circleVBO);
 
-    // Generate circle data
+    // Generate circle data, in polar coordinates as the points
     for (int r = 1000; r <= 4000; r += 1000) {
         for (int i = 0; i <= 360; i++) {
-            float angle = i * 3.14159f / 180.0f;
-            circleData.push_back(r * cos(angle));
-            circleData.push_back(r * sin(angle));
+            ScanPoint point = { (float)i, (float)r };
+            circleData.push_back(point);
         }
     }
 
     // Setup circle buffer
     glBindVertexArray(circleVAO);
     glBindBuffer(GL_ARRAY_BUFFER, circleVBO);
-    glBufferData(GL_ARRAY_BUFFER, circleData.size() * sizeof(float), circleData.data(), GL_STATIC_DRAW);
-    glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 2 * sizeof(float), (void*)0);
+    glBufferData(GL_ARRAY_BUFFER, circleData.size() * sizeof(ScanPoint), circleData.data(), GL_STATIC_DRAW);
+    glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, sizeof(ScanPoint), (void*)0);
     glEnableVertexAttribArray(0);
 
     glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
@@ -188,35 +695,34 @@ void renderFrame() {
     glClear(GL_COLOR_BUFFER_BIT);
     glUseProgram(shaderProgram);
 
-    // Set up projection matrix
-    float projection[16] = {
-        2.0f/8000.0f, 0.0f, 0.0f, 0.0f,
-        0.0f, 2.0f/8000.0f, 0.0f, 0.0f,
-        0.0f, 0.0f, 1.0f, 0.0f,
-        0.0f, 0.0f, 0.0f, 1.0f
-    };
-    GLint projLoc = glGetUniformLocation(shaderProgram, "projection");
+    if (showMap) {
+        mapRenderer.draw(projection);
+        glUseProgram(shaderProgram);
+    }
+
+    if (showHeat) {
+        historyRenderer.drawHeat();
+        glUseProgram(shaderProgram);
+    }
+
     glUniformMatrix4fv(projLoc, 1, GL_FALSE, projection);
 
     // Draw circles
-    GLint colorLoc = glGetUniformLocation(shaderProgram, "color");
     glUniform3f(colorLoc, 0.2f, 0.2f, 0.2f);
     glBindVertexArray(circleVAO);
     for (int i = 0; i < 4; i++) {
         glDrawArrays(GL_LINE_STRIP, i * 361, 361);
     }
 
-    // Draw points
-    if (!pointData.empty()) {
-        glUniform3f(colorLoc, 1.0f, 0.0f, 0.0f);
-        glBindVertexArray(VAO);
-        glBindBuffer(GL_ARRAY_BUFFER, VBO);
-        glBufferData(GL_ARRAY_BUFFER, pointData.size() * sizeof(float), pointData.data(), GL_DYNAMIC_DRAW);
-        glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 2 * sizeof(float), (void*)0);
-        glEnableVertexAttribArray(0);
-        glDrawArrays(GL_POINTS, 0, pointData.size() / 2);
+    if (showTrails) {
+        historyRenderer.drawTrails(projection, (float)glfwGetTime(), TRAIL_FADE_TIME);
+        glUseProgram(shaderProgram);
     }
 
+    // Draw points
+    glUniform3f(colorLoc, 1.0f, 0.0f, 0.0f);
+    pointUploader.draw();
+
     glfwSwapBuffers(window);
     glfwPollEvents();
 }
@@ -224,16 +730,77 @@ void renderFrame() {
 // Modified cleanup function
 void cleanupOpenGL() {
     if (window) {
-        glDeleteVertexArrays(1, &VAO);
-        glDeleteBuffers(1, &VBO);
+        pointUploader.cleanup();
+        historyRenderer.cleanup();
+        mapRenderer.cleanup();
         glDeleteVertexArrays(1, &circleVAO);
         glDeleteBuffers(1, &circleVBO);
         glDeleteProgram(shaderProgram);
         glfwDestroyWindow(window);
+        window = nullptr;
     }
     glfwTerminate();
 }
 
+// Grabs every scan as soon as it is complete, logs it and hands it over to the render loop
+void acquisitionThread() {
+    sl_lidar_response_measurement_node_hq_t nodes[8192];
+    int points_per_degree[BARCOUNT] = {0};
+    float last_angle = 0;
+    int scan_count = 0;
+    bool skip_next = false;
+    time_t current_time = 0;
+
+    while (!shouldClose) {
+        size_t count = _countof(nodes);
+        if (SL_IS_FAIL(drv->grabScanDataHq(nodes, count, 500))) continue;
+
+        drv->ascendScanData(nodes, count);
+        scan_count++;
+
+        // the lidar does not move, every scan is integrated at the origin
+        occupancyGrid->integrate(nodes, count);
+
+        ScanTripleBuffer::Slot& slot = scanBuffer.backSlot();
+        slot.points.clear();
+        slot.scanNumber = scan_count;
+        
+        for (int pos = 0; pos < (int)count ; ++pos) {
+            float current_angle = (nodes[pos].angle_z_q14 * 90.f) / 16384.f;
+            float current_distance = nodes[pos].dist_mm_q2/4.0f;
+            
+            if (current_distance > 0 && !skip_next) {
+                int degree = (int)current_angle;
+                if (degree >= 0 && degree < BARCOUNT) {
+                    if (points_per_degree[degree] < MAX_POINTS_PER_DEGREE) {
+                        time(&current_time);
+                        outFile << current_time << "," 
+                               << current_angle << ","
+                               << current_distance << ","
+                               << (int)nodes[pos].quality << ","
+                               << scan_count << "\n";
+                        
+                        ScanPoint point = { current_angle, current_distance };
+                        slot.points.push_back(point);
+                        
+                        points_per_degree[degree]++;
+                    }
+                }
+            }
+            skip_next = !skip_next;
+            
+            if (current_angle < last_angle) {
+                memset(points_per_degree, 0, sizeof(points_per_degree));
+            }
+            last_angle = current_angle;
+        }
+
+        scanBuffer.publish();
+        
+        printf("Scan #%d - Collected %d data points\n", scan_count, (int)count);
+    }
+}
+
 void print_usage(int argc, const char * argv[])
 {
     printf("Usage:\n"
@@ -284,8 +851,6 @@ int main(int argc, const char * argv[]) {
     IChannel* _channel = NULL;
     time_t now = 0;
     char filename[100] = {0};
-    time_t current_time = 0;
-    std::ofstream outFile;
     sl_lidar_response_device_info_t devinfo;
     bool connectSuccess = false;
 
@@ -341,6 +906,15 @@ int main(int argc, const char * argv[]) {
         }
     }
 
+    // 1cm cells over the 8m x 8m view
+    {
+        LidarOccupancyGridOptions gridOptions;
+        gridOptions.resolution = 10.0f;
+        gridOptions.width = 800;
+        gridOptions.height = 800;
+        occupancyGrid = *createLidarOccupancyGrid(gridOptions);
+    }
+
     // Initialize OpenGL
     initOpenGL();
 
@@ -439,56 +1013,26 @@ int main(int argc, const char * argv[]) {
 
     outFile << "timestamp,angle,distance,quality,scan_number\n";
 
-    while (!shouldClose && !glfwWindowShouldClose(window)) {
-        count = _countof(nodes);
-        op_result = drv->grabScanDataHq(nodes, count, 0);
-        
-        if (SL_IS_OK(op_result)) {
-            drv->ascendScanData(nodes, count);
-            scan_count++;
-            
-            // Clear point data for new scan
-            pointData.clear();
-            
-            for (int pos = 0; pos < (int)count ; ++pos) {
-                float current_angle = (nodes[pos].angle_z_q14 * 90.f) / 16384.f;
-                float current_distance = nodes[pos].dist_mm_q2/4.0f;
-                
-                if (current_distance > 0 && !skip_next) {
-                    int degree = (int)current_angle;
-                    if (degree >= 0 && degree < BARCOUNT) {
-                        if (points_per_degree[degree] < MAX_POINTS_PER_DEGREE) {
-                            time(&current_time);
-                            outFile << current_time << "," 
-                                   << current_angle << ","
-                                   << current_distance << ","
-                                   << (int)nodes[pos].quality << ","
-                                   << scan_count << "\n";
-                            
-                            // Convert polar coordinates to Cartesian for OpenGL
-                            float rad = current_angle * 3.14159f / 180.0f;
-                            pointData.push_back(current_distance * cos(rad));
-                            pointData.push_back(current_distance * sin(rad));
-                            
-                            points_per_degree[degree]++;
-                        }
-                    }
-                }
-                skip_next = !skip_next;
-                
-                if (current_angle < last_angle) {
-                    memset(points_per_degree, 0, sizeof(points_per_degree));
-                }
-                last_angle = current_angle;
+    {
+        std::thread acquisition(acquisitionThread);
+
+        printf("Keys: H toggles the trails of the last %d scans, O the occupancy heat map, M the occupancy grid map, C clears them\n",
+               historyRenderer.getSlotCount());
+
+        while (!shouldClose && !glfwWindowShouldClose(window)) {
+            const ScanTripleBuffer::Slot* scan = scanBuffer.acquire();
+            if (scan) {
+                pointUploader.upload(scan->points);
+                historyRenderer.addScan(scan->points, (float)glfwGetTime(), projection, OCCUPANCY_DECAY);
             }
+            mapRenderer.refresh();
             
             // Render the frame
             renderFrame();
-            
-            printf("Scan #%d - Collected %d data points\n", scan_count, (int)count);
         }
-        
-        delay(10);  // Small delay to prevent CPU overload
+
+        shouldClose = true;
+        acquisition.join();
     }
 
     drv->stop();
@@ -501,5 +1045,7 @@ on_finished:
         delete drv;
         drv = NULL;
     }
+    delete occupancyGrid;
+    occupancyGrid = nullptr;
     return 0;
 } 
\ No newline at end of file
@@ -0,0 +1,158 @@
+/*
+ *  Slamtec LIDAR SDK
+ *
+ *  Copyright (c) 2014 - 2023 Shanghai Slamtec Co., Ltd.
+ *  http://www.slamtec.com
+ *
+ */
+ /*
+  * Redistribution and use in source and binary forms, with or without
+  * modification, are permitted provided that the following conditions are met:
+  *
+  * 1. Redistributions of source code must retain the above copyright notice,
+  *    this list of conditions and the following disclaimer.
+  *
+  * 2. Redistributions in binary form must reproduce the above copyright notice,
+  *    this list of conditions and the following disclaimer in the documentation
+  *    and/or other materials provided with the distribution.
+  *
+  * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+  * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+  * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+  * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+  * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+  * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+  * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+  * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+  * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+  * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+  * EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+  *
+  */
+
+// Checks that sl::crc32 is bit-exact with the original byte-per-iteration routine
+// and compares their throughput on protocol sized packets.
+
+#include "sl_crc.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <vector>
+#include <chrono>
+
+namespace reference {
+
+    // the original implementation of sl::crc32
+    static sl_u32 table[256];
+
+    static void init(sl_u32 poly)
+    {
+        poly = sl::crc32::bitrev(poly, 32);
+        for (sl_u32 i = 0; i < 256; i++) {
+            sl_u32 c = i;
+            for (int j = 0; j < 8; j++) {
+                if (c & 1)
+                    c = poly ^ (c >> 1);
+                else
+                    c = c >> 1;
+            }
+            table[i] = c;
+        }
+    }
+
+    static sl_u32 cal(sl_u32 crc, const void* input, sl_u16 len)
+    {
+        const sl_u8* pch = (const sl_u8*)input;
+        sl_u8 leftBytes = 4 - (len & 0x3);
+
+        for (sl_u16 i = 0; i < len; i++) {
+            sl_u8 index = (sl_u8)(crc ^ *pch);
+            crc = (crc >> 8) ^ table[index];
+            pch++;
+        }
+
+        for (sl_u8 i = 0; i < leftBytes; i++) {
+            sl_u8 index = (sl_u8)(crc ^ 0);
+            crc = (crc >> 8) ^ table[index];
+        }
+        return crc ^ 0xffffffff;
+    }
+}
+
+static double benchmark(const char* name, const std::vector<sl_u8>& data, size_t packetSize, int rounds, bool useReference)
+{
+    size_t packetCount = data.size() / packetSize;
+    volatile sl_u32 sink = 0;
+
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    for (int round = 0; round < rounds; ++round) {
+        for (size_t pos = 0; pos < packetCount; ++pos) {
+            sl_u8* packet = (sl_u8*)&data[pos * packetSize];
+            if (useReference) {
+                sink = sink ^ reference::cal(0xFFFFFFFF, packet, (sl_u16)packetSize);
+            }
+            else {
+                sink = sink ^ sl::crc32::getResult(packet, (sl_u32)packetSize);
+            }
+        }
+    }
+    double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    double mbps = (double)packetCount * packetSize * rounds / elapsed / (1024.0 * 1024.0);
+
+    printf("  %-10s packet %5d bytes: %10.1f MB/s\n", name, (int)packetSize, mbps);
+    return mbps;
+}
+
+int main(int argc, const char* argv[])
+{
+    reference::init(0x4C11DB7);
+    srand(0x5EED);
+
+    std::vector<sl_u8> data(4 * 1024 * 1024);
+    for (size_t pos = 0; pos < data.size(); ++pos) {
+        data[pos] = (sl_u8)rand();
+    }
+
+    // bit-exactness: every length the protocol can use, at every alignment
+    size_t mismatch = 0;
+    for (sl_u32 len = 0; len <= 2048; ++len) {
+        for (size_t offset = 0; offset < 8; ++offset) {
+            sl_u8* ptr = &data[offset + len * 13];
+            if (reference::cal(0xFFFFFFFF, ptr, (sl_u16)len) != sl::crc32::getResult(ptr, len)) {
+                ++mismatch;
+            }
+        }
+    }
+
+    // the legacy init/cal interface with the default and a custom polynomial
+    const sl_u32 polys[] = { 0x4C11DB7, 0x1EDC6F41 };
+    for (size_t p = 0; p < sizeof(polys) / sizeof(polys[0]); ++p) {
+        reference::init(polys[p]);
+        sl::crc32::init(polys[p]);
+        for (sl_u32 len = 0; len <= 512; ++len) {
+            if (reference::cal(0x12345678, &data[len], (sl_u16)len) != sl::crc32::cal(0x12345678, &data[len], (sl_u16)len)) {
+                ++mismatch;
+            }
+        }
+    }
+    reference::init(0x4C11DB7);
+    sl::crc32::init(0x4C11DB7);
+
+    if (mismatch) {
+        printf("FAILED: %d mismatches against the reference implementation\n", (int)mismatch);
+        return 1;
+    }
+    printf("bit-exact against the reference implementation\n");
+
+    int rounds = (argc > 1) ? atoi(argv[1]) : 20;
+    if (rounds <= 0) rounds = 20;
+
+    // 132 bytes: HQ capsule payload without its crc field
+    const size_t packetSizes[] = { 16, 84, 132, 1024 };
+    for (size_t p = 0; p < sizeof(packetSizes) / sizeof(packetSizes[0]); ++p) {
+        double refSpeed = benchmark("reference", data, packetSizes[p], rounds, true);
+        double newSpeed = benchmark("sl::crc32", data, packetSizes[p], rounds, false);
+        printf("  speedup: %.2fx\n", newSpeed / refSpeed);
+    }
+    return 0;
+}
@@ -0,0 +1,545 @@
+/*
+ *  Slamtec LIDAR SDK
+ *
+ *  Copyright (c) 2014 - 2023 Shanghai Slamtec Co., Ltd.
+ *  http://www.slamtec.com
+ *
+ */
+ /*
+  * Redistribution and use in source and binary forms, with or without
+  * modification, are permitted provided that the following conditions are met:
+  *
+  * 1. Redistributions of source code must retain the above copyright notice,
+  *    this list of conditions and the following disclaimer.
+  *
+  * 2. Redistributions in binary form must reproduce the above copyright notice,
+  *    this list of conditions and the following disclaimer in the documentation
+  *    and/or other materials provided with the distribution.
+  *
+  * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+  * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+  * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+  * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+  * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+  * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+  * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+  * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+  * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+  * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+  * EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+  *
+  */
+
+// Measures the decoding throughput of every sample data handler, both when the
+// payloads are fed straight into LIDARSampleDataUnpacker::onSampleData and when
+// the raw wire stream goes through RPLidarProtocolCodec::onDecodeData first.
+// The streams are synthesized with valid sync bits, checksums and crcs so that
+// no packet is rejected. The codec path is also fed by a channel reading the stream
+// from a loopback TCP connection, plain and through the io_uring backend
+// (see createIoUringChannel, built with IO_URING=1).
+
+#include "sdkcommon.h"
+#include "hal/abs_rxtx.h"
+#include "hal/thread.h"
+#include "hal/types.h"
+#include "hal/assert.h"
+#include "hal/locker.h"
+#include "hal/event.h"
+#include "hal/byteorder.h"
+#include "sl_lidar_driver.h"
+#include "sl_crc.h"
+#include <memory>
+#include <atomic>
+
+#include "dataunpacker/dataunpacker.h"
+#include "sl_async_transceiver.h"
+#include "sl_lidarprotocol_codec.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stddef.h>
+#include <string.h>
+#include <vector>
+#include <chrono>
+#include <algorithm>
+#include <thread>
+
+#ifndef _WIN32
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <unistd.h>
+#define DECODER_BENCH_LOOPBACK
+#endif
+
+using namespace sl;
+using namespace sl::internal;
+
+class NodeCounter : public LIDARSampleDataListener
+{
+public:
+    NodeCounter() : nodeCount(0), scanCount(0), errorCount(0) {}
+
+    virtual void onHQNodeScanResetReq()
+    {
+    }
+
+    virtual void onHQNodeDecoded(_u64 timestamp_uS, const rplidar_response_measurement_node_hq_t* node)
+    {
+        if (node->flag & RPLIDAR_RESP_HQ_FLAG_SYNCBIT) ++scanCount;
+        ++nodeCount;
+    }
+
+    virtual void onHQNodesDecoded(const _u64* timestamps_uS, const rplidar_response_measurement_node_hq_t* nodes, size_t count)
+    {
+        for (size_t pos = 0; pos < count; ++pos) {
+            if (nodes[pos].flag & RPLIDAR_RESP_HQ_FLAG_SYNCBIT) ++scanCount;
+        }
+        nodeCount += count;
+    }
+
+    virtual void onDecodingError(int errMsg, _u8 ansType, const void* payload, size_t size)
+    {
+        ++errorCount;
+    }
+
+    size_t nodeCount;
+    size_t scanCount;
+    size_t errorCount;
+};
+
+// forwards the decoded messages the same way the driver does
+class UnpackerForwarder : public IProtocolMessageListener
+{
+public:
+    UnpackerForwarder(LIDARSampleDataUnpacker* unpacker) : _unpacker(unpacker) {}
+
+    virtual void onProtocolMessageDecoded(_u8 cmd, const _u8* payload, size_t size)
+    {
+        _unpacker->onSampleData(cmd, payload, size);
+    }
+
+private:
+    LIDARSampleDataUnpacker* _unpacker;
+};
+
+struct SampleStream {
+    const char*         name;
+    _u8                 ansType;
+    size_t              packetSize;
+    std::vector<_u8>    payload;
+};
+
+static const size_t SCAN_SAMPLE_COUNT = 3600; // samples per revolution used by the generators
+
+static void generateNormalNodes(SampleStream& stream, size_t packetCount)
+{
+    stream.name = "NormalNode";
+    stream.ansType = RPLIDAR_ANS_TYPE_MEASUREMENT;
+    stream.packetSize = sizeof(rplidar_response_measurement_node_t);
+
+    for (size_t pos = 0; pos < packetCount; ++pos) {
+        rplidar_response_measurement_node_t node;
+        size_t sampleIdx = pos % SCAN_SAMPLE_COUNT;
+        bool syncBit = (sampleIdx == 0);
+        _u16 angle_q6 = (_u16)(sampleIdx * 360 * 64 / SCAN_SAMPLE_COUNT);
+
+        node.sync_quality = (_u8)(((rand() & 0x3f) << RPLIDAR_RESP_MEASUREMENT_QUALITY_SHIFT) | (syncBit ? 0x1 : 0x2));
+        node.angle_q6_checkbit = cpu_to_le16((_u16)((angle_q6 << RPLIDAR_RESP_MEASUREMENT_ANGLE_SHIFT) | RPLIDAR_RESP_MEASUREMENT_CHECKBIT));
+        node.distance_q2 = cpu_to_le16((_u16)(rand() & 0xffff));
+
+        const _u8* bytes = reinterpret_cast<const _u8*>(&node);
+        stream.payload.insert(stream.payload.end(), bytes, bytes + sizeof(node));
+    }
+}
+
+static void generateHQNodes(SampleStream& stream, size_t packetCount)
+{
+    stream.name = "HQNode";
+    stream.ansType = RPLIDAR_ANS_TYPE_MEASUREMENT_HQ;
+    stream.packetSize = sizeof(rplidar_response_hq_capsule_measurement_nodes_t);
+
+    size_t sampleIdx = 0;
+    for (size_t pos = 0; pos < packetCount; ++pos) {
+        rplidar_response_hq_capsule_measurement_nodes_t capsule;
+        capsule.sync_byte = RPLIDAR_RESP_MEASUREMENT_HQ_SYNC;
+        capsule.time_stamp = cpu_to_le64((_u64)pos * 1000);
+
+        for (size_t nodeIdx = 0; nodeIdx < _countof(capsule.node_hq); ++nodeIdx, sampleIdx = (sampleIdx + 1) % SCAN_SAMPLE_COUNT) {
+            rplidar_response_measurement_node_hq_t& node = capsule.node_hq[nodeIdx];
+            node.angle_z_q14 = cpu_to_le16((_u16)(sampleIdx * 65536 / SCAN_SAMPLE_COUNT));
+            node.dist_mm_q2 = cpu_to_le32((_u32)(rand() & 0x3ffff));
+            node.quality = (_u8)rand();
+            node.flag = (sampleIdx == 0) ? RPLIDAR_RESP_HQ_FLAG_SYNCBIT : 0;
+        }
+        capsule.crc32 = cpu_to_le32(crc32::getResult(reinterpret_cast<sl_u8*>(&capsule), sizeof(capsule) - sizeof(capsule.crc32)));
+
+        const _u8* bytes = reinterpret_cast<const _u8*>(&capsule);
+        stream.payload.insert(stream.payload.end(), bytes, bytes + sizeof(capsule));
+    }
+}
+
+// the capsule family shares the same checksum scheme: the xor of every byte
+// starting at checksumOffset is split into the low nibbles of the first two bytes
+template <typename CapsuleT>
+static void generateCapsules(SampleStream& stream, const char* name, _u8 ansType, size_t checksumOffset, size_t packetCount)
+{
+    stream.name = name;
+    stream.ansType = ansType;
+    stream.packetSize = sizeof(CapsuleT);
+
+    // one revolution takes about 100 capsules
+    const size_t capsulesPerScan = 100;
+    for (size_t pos = 0; pos < packetCount; ++pos) {
+        CapsuleT capsule;
+        _u8* bytes = reinterpret_cast<_u8*>(&capsule);
+        for (size_t byteIdx = 0; byteIdx < sizeof(capsule); ++byteIdx) {
+            bytes[byteIdx] = (_u8)rand();
+        }
+
+        size_t capsuleIdx = pos % capsulesPerScan;
+        _u16 startAngle_q6 = (_u16)(capsuleIdx * 360 * 64 / capsulesPerScan);
+        // the sync bit marks the first capsule after the measurement (re)starts
+        if (pos == 0) startAngle_q6 |= RPLIDAR_RESP_MEASUREMENT_EXP_SYNCBIT;
+        capsule.start_angle_sync_q6 = cpu_to_le16(startAngle_q6);
+
+        _u8 checksum = 0;
+        for (size_t byteIdx = checksumOffset; byteIdx < sizeof(capsule); ++byteIdx) {
+            checksum ^= bytes[byteIdx];
+        }
+        bytes[0] = (_u8)(RPLIDAR_RESP_MEASUREMENT_EXP_SYNC_1 << 4) | (checksum & 0xf);
+        bytes[1] = (_u8)(RPLIDAR_RESP_MEASUREMENT_EXP_SYNC_2 << 4) | (checksum >> 4);
+
+        stream.payload.insert(stream.payload.end(), bytes, bytes + sizeof(capsule));
+    }
+}
+
+static LIDARSampleDataUnpacker* createUnpacker(NodeCounter& counter)
+{
+    LIDARSampleDataUnpacker* unpacker = LIDARSampleDataUnpacker::CreateInstance(counter);
+
+    SlamtecLidarTimingDesc timing;
+    memset(&timing, 0, sizeof(timing));
+    timing.sample_duration_uS = 32;
+    timing.native_baudrate = 1000000;
+    timing.native_interface_type = LIDAR_INTERFACE_UART;
+    unpacker->updateUnpackerContext(LIDARSampleDataUnpacker::UNPACKER_CONTEXT_TYPE_LIDAR_TIMING, &timing, sizeof(timing));
+    unpacker->enable();
+    return unpacker;
+}
+
+static void printResult(const char* path, const SampleStream& stream, size_t bytes, const NodeCounter& counter, double elapsed)
+{
+    printf("  %-22s %-13s %9.1f MB/s %10.2f Mnodes/s", stream.name, path,
+        bytes / elapsed / (1024.0 * 1024.0), counter.nodeCount / elapsed / 1e6);
+    if (counter.errorCount) {
+        printf("  (%d decoding errors)", (int)counter.errorCount);
+    }
+    printf("\n");
+}
+
+// one onSampleData call per packet, which is how the codec delivers them
+static void benchmarkUnpacker(const SampleStream& stream, int rounds)
+{
+    NodeCounter counter;
+    LIDARSampleDataUnpacker* unpacker = createUnpacker(counter);
+    size_t packetCount = stream.payload.size() / stream.packetSize;
+
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    for (int round = 0; round < rounds; ++round) {
+        // every round replays the stream from its start
+        unpacker->reset();
+        for (size_t pos = 0; pos < packetCount; ++pos) {
+            unpacker->onSampleData(stream.ansType, &stream.payload[pos * stream.packetSize], stream.packetSize);
+        }
+    }
+    double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    printResult("onSampleData", stream, stream.payload.size() * rounds, counter, elapsed);
+    LIDARSampleDataUnpacker::ReleaseInstance(unpacker);
+}
+
+// the loop mode answer header starting the wire stream of a scan request
+static void appendAnswerHeader(std::vector<_u8>& wire, const SampleStream& stream)
+{
+    _u32 sizeAndFlag = cpu_to_le32((_u32)stream.packetSize | ((_u32)RPLIDAR_ANS_PKTFLAG_LOOP << RPLIDAR_ANS_HEADER_SUBTYPE_SHIFT));
+    wire.push_back(RPLIDAR_ANS_SYNC_BYTE1);
+    wire.push_back(RPLIDAR_ANS_SYNC_BYTE2);
+    wire.insert(wire.end(), reinterpret_cast<const _u8*>(&sizeAndFlag), reinterpret_cast<const _u8*>(&sizeAndFlag) + 4);
+    wire.push_back(stream.ansType);
+}
+
+// the wire stream of a scan request: the loop mode answer header once, then the payloads
+static void benchmarkCodec(const SampleStream& stream, int rounds, size_t readSize)
+{
+    std::vector<_u8> wire;
+    appendAnswerHeader(wire, stream);
+    wire.insert(wire.end(), stream.payload.begin(), stream.payload.end());
+
+    NodeCounter counter;
+    LIDARSampleDataUnpacker* unpacker = createUnpacker(counter);
+    UnpackerForwarder forwarder(unpacker);
+    RPLidarProtocolCodec codec;
+    codec.setMessageListener(&forwarder);
+
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    for (int round = 0; round < rounds; ++round) {
+        codec.onDecodeReset();
+        unpacker->reset();
+        for (size_t pos = 0; pos < wire.size(); pos += readSize) {
+            codec.onDecodeData(&wire[pos], std::min(readSize, wire.size() - pos));
+        }
+    }
+    double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    printResult("codec", stream, wire.size() * rounds, counter, elapsed);
+    LIDARSampleDataUnpacker::ReleaseInstance(unpacker);
+}
+
+#ifdef DECODER_BENCH_LOOPBACK
+
+// serves a single connection on a loopback port: writes the header and the payload the given number of times,
+// then waits for the peer to close
+class LoopbackStreamer
+{
+public:
+    LoopbackStreamer()
+        : _listenSocket(-1)
+        , _port(0)
+        , _header(NULL)
+        , _payload(NULL)
+        , _rounds(0)
+    {
+    }
+
+    ~LoopbackStreamer()
+    {
+        if (_listenSocket >= 0) ::shutdown(_listenSocket, SHUT_RDWR);
+        if (_thread.joinable()) _thread.join();
+        if (_listenSocket >= 0) ::close(_listenSocket);
+    }
+
+    bool start(const std::vector<_u8>* header, const std::vector<_u8>* payload, int rounds)
+    {
+        _header = header;
+        _payload = payload;
+        _rounds = rounds;
+
+        _listenSocket = socket(AF_INET, SOCK_STREAM, 0);
+        if (_listenSocket < 0) return false;
+
+        sockaddr_in addr;
+        memset(&addr, 0, sizeof(addr));
+        addr.sin_family = AF_INET;
+        addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        socklen_t addrLen = sizeof(addr);
+        if (bind(_listenSocket, (sockaddr*)&addr, sizeof(addr)) < 0 || listen(_listenSocket, 1) < 0
+            || getsockname(_listenSocket, (sockaddr*)&addr, &addrLen) < 0) {
+            return false;
+        }
+        _port = ntohs(addr.sin_port);
+        _thread = std::thread(&LoopbackStreamer::_serve, this);
+        return true;
+    }
+
+    int getPort() const
+    {
+        return _port;
+    }
+
+private:
+    void _serve()
+    {
+        int client = accept(_listenSocket, NULL, NULL);
+        if (client < 0) return;
+
+        bool ok = _send(client, *_header);
+        for (int round = 0; ok && round < _rounds; ++round) {
+            ok = _send(client, *_payload);
+        }
+
+        char dummy;
+        while (::recv(client, &dummy, sizeof(dummy), 0) > 0);
+        ::close(client);
+    }
+
+    static bool _send(int client, const std::vector<_u8>& data)
+    {
+        for (size_t pos = 0; pos < data.size();) {
+            ssize_t sent = ::send(client, &data[pos], data.size() - pos, MSG_NOSIGNAL);
+            if (sent <= 0) return false;
+            pos += (size_t)sent;
+        }
+        return true;
+    }
+
+    int                         _listenSocket;
+    int                         _port;
+    const std::vector<_u8>*     _header;
+    const std::vector<_u8>*     _payload;
+    int                         _rounds;
+    std::thread                 _thread;
+};
+
+// a connected channel to the streamer, wrapped by the io_uring backend if asked for
+static IChannel* openLoopbackChannel(const LoopbackStreamer& streamer, bool ioUring)
+{
+    IChannel* channel = *createTcpChannel("127.0.0.1", streamer.getPort());
+    if (ioUring) {
+        Result<IChannel*> wrapped = createIoUringChannel(channel);
+        if (!wrapped) {
+            delete channel;
+            return NULL;
+        }
+        channel = *wrapped;
+    }
+
+    if (!channel->open()) {
+        delete channel;
+        return NULL;
+    }
+    return channel;
+}
+
+// the reads of the rx thread of the driver, every read handed over to the codec. The rounds follow each other
+// on a single connection, the capsule streams see a discontinuity raising a decoding error at every round boundary
+static void benchmarkChannel(const SampleStream& stream, int rounds, bool ioUring)
+{
+    const char* path = ioUring ? "tcp io_uring" : "tcp read";
+    std::vector<_u8> header;
+    appendAnswerHeader(header, stream);
+
+    LoopbackStreamer streamer;
+    if (!streamer.start(&header, &stream.payload, rounds)) {
+        printf("  %-22s %-13s cannot listen on the loopback\n", stream.name, path);
+        return;
+    }
+
+    IChannel* channel = openLoopbackChannel(streamer, ioUring);
+    if (!channel) {
+        printf("  %-22s %-13s not available\n", stream.name, path);
+        return;
+    }
+
+    // the reads go into a block registered once, as the driver does with its rx ring
+    std::vector<_u8> rxBuffer(AsyncTransceiver::DEFAULT_RX_RING_SIZE);
+    channel->registerRxBuffer(&rxBuffer[0], rxBuffer.size());
+
+    NodeCounter counter;
+    LIDARSampleDataUnpacker* unpacker = createUnpacker(counter);
+    UnpackerForwarder forwarder(unpacker);
+    RPLidarProtocolCodec codec;
+    codec.setMessageListener(&forwarder);
+
+    size_t expected = header.size() + stream.payload.size() * rounds;
+    size_t bytes = 0;
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    while (bytes < expected) {
+        size_t received = 0;
+        if (SL_IS_FAIL(channel->waitAndRead(&rxBuffer[0], rxBuffer.size(), received, 1000))) break;
+        codec.onDecodeData(&rxBuffer[0], received);
+        bytes += received;
+    }
+    double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    if (bytes < expected) printf("  %-22s %-13s stopped after %d of %d bytes\n", stream.name, path, (int)bytes, (int)expected);
+    printResult(path, stream, bytes, counter, elapsed);
+    LIDARSampleDataUnpacker::ReleaseInstance(unpacker);
+    channel->close();
+    delete channel;
+}
+
+// how soon a read blocked on an idle connection returns once cancelOperation is called, which the driver
+// does before joining its rx thread
+static void benchmarkCancel(int rounds)
+{
+    std::vector<_u8> nothing;
+    LoopbackStreamer streamer;
+    IChannel* channel = streamer.start(&nothing, &nothing, 0) ? openLoopbackChannel(streamer, true) : NULL;
+    if (!channel) {
+        printf("  io_uring cancel       not available\n");
+        return;
+    }
+
+    const int delay_mS = 20;
+    double maxWakeup_uS = 0;
+    int early = 0;
+    for (int round = 0; round < rounds; ++round) {
+        std::chrono::steady_clock::time_point cancelTime;
+        std::thread canceller([&] {
+            std::this_thread::sleep_for(std::chrono::milliseconds(delay_mS));
+            cancelTime = std::chrono::steady_clock::now();
+            channel->cancelOperation();
+        });
+
+        _u8 buffer[64];
+        size_t received = 0;
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        channel->waitAndRead(buffer, sizeof(buffer), received, 1000);
+        std::chrono::steady_clock::time_point end = std::chrono::steady_clock::now();
+        canceller.join();
+
+        // a stale cancellation would end the read before it is asked for
+        if (end < cancelTime || end - start < std::chrono::milliseconds(delay_mS)) {
+            ++early;
+            continue;
+        }
+        maxWakeup_uS = std::max(maxWakeup_uS, std::chrono::duration<double, std::micro>(end - cancelTime).count());
+    }
+
+    printf("  io_uring cancel        %d reads of a 1000 ms timeout, woken up within %.0f us", rounds, maxWakeup_uS);
+    if (early) printf("  (%d returned before the cancellation)", early);
+    printf("\n");
+    channel->close();
+    delete channel;
+}
+
+#endif
+
+int main(int argc, const char* argv[])
+{
+    int rounds = (argc > 1) ? atoi(argv[1]) : 10;
+    if (rounds <= 0) rounds = 10;
+
+    // the size of a typical channel read handed over to the codec
+    size_t readSize = (argc > 2) ? (size_t)atoi(argv[2]) : 4096;
+    if (!readSize) readSize = 4096;
+
+    srand(0x5EED);
+
+    // about 4MB of payload per stream
+    const size_t streamBytes = 4 * 1024 * 1024;
+    std::vector<SampleStream> streams(6);
+    generateNormalNodes(streams[0], streamBytes / sizeof(rplidar_response_measurement_node_t));
+    generateHQNodes(streams[1], streamBytes / sizeof(rplidar_response_hq_capsule_measurement_nodes_t));
+    generateCapsules<rplidar_response_capsule_measurement_nodes_t>(streams[2], "CapsuleNode",
+        RPLIDAR_ANS_TYPE_MEASUREMENT_CAPSULED,
+        offsetof(rplidar_response_capsule_measurement_nodes_t, start_angle_sync_q6),
+        streamBytes / sizeof(rplidar_response_capsule_measurement_nodes_t));
+    generateCapsules<rplidar_response_ultra_capsule_measurement_nodes_t>(streams[3], "UltraCapsuleNode",
+        RPLIDAR_ANS_TYPE_MEASUREMENT_CAPSULED_ULTRA,
+        offsetof(rplidar_response_ultra_capsule_measurement_nodes_t, start_angle_sync_q6),
+        streamBytes / sizeof(rplidar_response_ultra_capsule_measurement_nodes_t));
+    generateCapsules<rplidar_response_dense_capsule_measurement_nodes_t>(streams[4], "DenseCapsuleNode",
+        RPLIDAR_ANS_TYPE_MEASUREMENT_DENSE_CAPSULED,
+        offsetof(rplidar_response_dense_capsule_measurement_nodes_t, start_angle_sync_q6),
+        streamBytes / sizeof(rplidar_response_dense_capsule_measurement_nodes_t));
+    generateCapsules<rplidar_response_ultra_dense_capsule_measurement_nodes_t>(streams[5], "UltraDenseCapsuleNode",
+        RPLIDAR_ANS_TYPE_MEASUREMENT_ULTRA_DENSE_CAPSULED,
+        offsetof(rplidar_response_ultra_dense_capsule_measurement_nodes_t, time_stamp),
+        streamBytes / sizeof(rplidar_response_ultra_dense_capsule_measurement_nodes_t));
+
+    printf("%d rounds, %d bytes per codec read\n", rounds, (int)readSize);
+    for (size_t pos = 0; pos < streams.size(); ++pos) {
+        benchmarkUnpacker(streams[pos], rounds);
+        benchmarkCodec(streams[pos], rounds, readSize);
+#ifdef DECODER_BENCH_LOOPBACK
+        benchmarkChannel(streams[pos], rounds, false);
+        benchmarkChannel(streams[pos], rounds, true);
+#endif
+    }
+#ifdef DECODER_BENCH_LOOPBACK
+    benchmarkCancel(rounds);
+#endif
+    return 0;
+}
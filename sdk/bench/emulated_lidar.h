@@ -0,0 +1,247 @@
+/*
+ *  Slamtec LIDAR SDK
+ *
+ *  Copyright (c) 2014 - 2023 Shanghai Slamtec Co., Ltd.
+ *  http://www.slamtec.com
+ *
+ */
+ /*
+  * Redistribution and use in source and binary forms, with or without
+  * modification, are permitted provided that the following conditions are met:
+  *
+  * 1. Redistributions of source code must retain the above copyright notice,
+  *    this list of conditions and the following disclaimer.
+  *
+  * 2. Redistributions in binary form must reproduce the above copyright notice,
+  *    this list of conditions and the following disclaimer in the documentation
+  *    and/or other materials provided with the distribution.
+  *
+  * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+  * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+  * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+  * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+  * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+  * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+  * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+  * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+  * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+  * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+  * EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+  *
+  */
+
+#pragma once
+
+#include "sl_lidar.h"
+
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+#include <unistd.h>
+
+#include <string.h>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <chrono>
+
+// A legacy A1-class device (no config commands, no motor control commands) served over a
+// loopback tcp connection. It answers the queries straight away, starts streaming normal
+// nodes deviceLatency_uS after a scan command and stops deviceLatency_uS after the stop command.
+class EmulatedLidar
+{
+public:
+    EmulatedLidar(int nodesPerScan = 360, int scanFrequency = 10, int streamPeriod_uS = 5000, int deviceLatency_uS = 1000)
+        : _nodesPerScan(nodesPerScan)
+        , _scanFrequency(scanFrequency)
+        , _streamPeriod_uS(streamPeriod_uS)
+        , _deviceLatency_uS(deviceLatency_uS)
+        , _listenSocket(-1)
+        , _clientSocket(-1)
+        , _port(0)
+        , _running(true)
+        , _scanning(false)
+    {
+    }
+
+    ~EmulatedLidar()
+    {
+        _running = false;
+        _scanning = false;
+        if (_listenSocket >= 0) {
+            shutdown(_listenSocket, SHUT_RDWR);
+            close(_listenSocket);
+        }
+        if (_clientSocket >= 0) shutdown(_clientSocket, SHUT_RDWR);
+        if (_serviceThread.joinable()) _serviceThread.join();
+        if (_clientSocket >= 0) close(_clientSocket);
+    }
+
+    bool start()
+    {
+        _listenSocket = socket(AF_INET, SOCK_STREAM, 0);
+        if (_listenSocket < 0) return false;
+
+        sockaddr_in addr;
+        memset(&addr, 0, sizeof(addr));
+        addr.sin_family = AF_INET;
+        addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        addr.sin_port = 0;
+        if (bind(_listenSocket, (sockaddr*)&addr, sizeof(addr)) < 0) return false;
+        if (listen(_listenSocket, 1) < 0) return false;
+
+        socklen_t addrLen = sizeof(addr);
+        getsockname(_listenSocket, (sockaddr*)&addr, &addrLen);
+        _port = ntohs(addr.sin_port);
+
+        _serviceThread = std::thread(&EmulatedLidar::_serve, this);
+        return true;
+    }
+
+    int getPort() const
+    {
+        return _port;
+    }
+
+    int getDeviceLatency() const
+    {
+        return _deviceLatency_uS;
+    }
+
+private:
+    void _send(const void* data, size_t size)
+    {
+        std::lock_guard<std::mutex> l(_txLocker);
+        const sl_u8* pos = (const sl_u8*)data;
+        while (size) {
+            ssize_t sent = ::send(_clientSocket, pos, size, MSG_NOSIGNAL);
+            if (sent <= 0) return;
+            pos += sent;
+            size -= sent;
+        }
+    }
+
+    void _sendAnswer(sl_u8 ansType, const void* payload, sl_u32 size, bool loop = false)
+    {
+        std::vector<sl_u8> buffer(sizeof(sl_lidar_ans_header_t) + (loop ? 0 : size));
+        sl_lidar_ans_header_t* header = (sl_lidar_ans_header_t*)&buffer[0];
+        header->syncByte1 = SL_LIDAR_ANS_SYNC_BYTE1;
+        header->syncByte2 = SL_LIDAR_ANS_SYNC_BYTE2;
+        header->size_q30_subtype = size | (loop ? ((sl_u32)SL_LIDAR_ANS_PKTFLAG_LOOP << SL_LIDAR_ANS_HEADER_SUBTYPE_SHIFT) : 0);
+        header->type = ansType;
+        if (!loop && size) memcpy(&buffer[sizeof(sl_lidar_ans_header_t)], payload, size);
+        _send(&buffer[0], buffer.size());
+    }
+
+    void _stream()
+    {
+        std::this_thread::sleep_for(std::chrono::microseconds(_deviceLatency_uS));
+        _sendAnswer(SL_LIDAR_ANS_TYPE_MEASUREMENT, NULL, sizeof(sl_lidar_response_measurement_node_t), true);
+
+        int nodesPerChunk = (int)((long long)_nodesPerScan * _scanFrequency * _streamPeriod_uS / 1000000);
+        if (nodesPerChunk < 1) nodesPerChunk = 1;
+        std::chrono::steady_clock::time_point next = std::chrono::steady_clock::now();
+        int sampleIdx = 0;
+
+        while (_scanning) {
+            std::vector<sl_lidar_response_measurement_node_t> nodes(nodesPerChunk);
+            for (int pos = 0; pos < nodesPerChunk; ++pos, sampleIdx = (sampleIdx + 1) % _nodesPerScan) {
+                sl_u16 angle_q6 = (sl_u16)(sampleIdx * 360 * 64 / _nodesPerScan);
+                nodes[pos].sync_quality = (sl_u8)((40 << SL_LIDAR_RESP_MEASUREMENT_QUALITY_SHIFT) | (sampleIdx ? 0x2 : 0x1));
+                nodes[pos].angle_q6_checkbit = (sl_u16)((angle_q6 << SL_LIDAR_RESP_MEASUREMENT_ANGLE_SHIFT) | SL_LIDAR_RESP_MEASUREMENT_CHECKBIT);
+                nodes[pos].distance_q2 = 4000;
+            }
+            _send(&nodes[0], nodes.size() * sizeof(nodes[0]));
+
+            next += std::chrono::microseconds(_streamPeriod_uS);
+            std::this_thread::sleep_until(next);
+        }
+    }
+
+    void _stopStreaming(std::thread& streamer)
+    {
+        if (!streamer.joinable()) return;
+        std::this_thread::sleep_for(std::chrono::microseconds(_deviceLatency_uS));
+        _scanning = false;
+        streamer.join();
+    }
+
+    bool _recv(void* buffer, size_t size)
+    {
+        return size == 0 || recv(_clientSocket, buffer, size, MSG_WAITALL) == (ssize_t)size;
+    }
+
+    void _serve()
+    {
+        _clientSocket = accept(_listenSocket, NULL, NULL);
+        if (_clientSocket < 0) return;
+
+        // the answer headers are tiny, do not let them wait for the delayed acks
+        int noDelay = 1;
+        setsockopt(_clientSocket, IPPROTO_TCP, TCP_NODELAY, &noDelay, sizeof(noDelay));
+
+        std::thread streamer;
+        sl_u8 byte;
+
+        while (_running && _recv(&byte, 1)) {
+            if (byte != SL_LIDAR_CMD_SYNC_BYTE) continue;
+            sl_u8 cmd;
+            if (!_recv(&cmd, 1)) break;
+
+            if (cmd & SL_LIDAR_CMDFLAG_HAS_PAYLOAD) {
+                sl_u8 size, payload[256], checksum;
+                if (!_recv(&size, 1) || !_recv(payload, size) || !_recv(&checksum, 1)) break;
+            }
+
+            switch (cmd) {
+            case SL_LIDAR_CMD_GET_DEVICE_INFO:
+            {
+                sl_lidar_response_device_info_t info;
+                memset(&info, 0, sizeof(info));
+                info.model = 0x18;
+                info.firmware_version = 0x0112;
+                info.hardware_version = 7;
+                for (size_t pos = 0; pos < sizeof(info.serialnum); ++pos) info.serialnum[pos] = (sl_u8)pos;
+                _sendAnswer(SL_LIDAR_ANS_TYPE_DEVINFO, &info, sizeof(info));
+                break;
+            }
+            case SL_LIDAR_CMD_GET_SAMPLERATE:
+            {
+                sl_lidar_response_sample_rate_t rate;
+                rate.std_sample_duration_us = 1000000 / (_nodesPerScan * _scanFrequency);
+                rate.express_sample_duration_us = rate.std_sample_duration_us;
+                _sendAnswer(SL_LIDAR_ANS_TYPE_SAMPLE_RATE, &rate, sizeof(rate));
+                break;
+            }
+            case SL_LIDAR_CMD_SCAN:
+            case SL_LIDAR_CMD_FORCE_SCAN:
+                _stopStreaming(streamer);
+                _scanning = true;
+                streamer = std::thread(&EmulatedLidar::_stream, this);
+                break;
+            case SL_LIDAR_CMD_STOP:
+                _stopStreaming(streamer);
+                break;
+            default:
+                break;
+            }
+        }
+
+        _scanning = false;
+        if (streamer.joinable()) streamer.join();
+    }
+
+    int                 _nodesPerScan;
+    int                 _scanFrequency;
+    int                 _streamPeriod_uS;
+    int                 _deviceLatency_uS;
+    int                 _listenSocket;
+    int                 _clientSocket;
+    int                 _port;
+    std::atomic<bool>   _running;
+    std::atomic<bool>   _scanning;
+    std::thread         _serviceThread;
+    std::mutex          _txLocker;
+};
@@ -0,0 +1,118 @@
+/*
+ *  Slamtec LIDAR SDK
+ *
+ *  Copyright (c) 2014 - 2023 Shanghai Slamtec Co., Ltd.
+ *  http://www.slamtec.com
+ *
+ */
+ /*
+  * Redistribution and use in source and binary forms, with or without
+  * modification, are permitted provided that the following conditions are met:
+  *
+  * 1. Redistributions of source code must retain the above copyright notice,
+  *    this list of conditions and the following disclaimer.
+  *
+  * 2. Redistributions in binary form must reproduce the above copyright notice,
+  *    this list of conditions and the following disclaimer in the documentation
+  *    and/or other materials provided with the distribution.
+  *
+  * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+  * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+  * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+  * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+  * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+  * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+  * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+  * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+  * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+  * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+  * EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+  *
+  */
+
+// Compares the latency of the queued decoding (rx thread -> rx ring -> decoder thread)
+// with LidarConnectOptions::inlineDecoding against an emulated device (see emulated_lidar.h).
+// The latencies are the ones collected by the driver, measured from the moment the bytes
+// were read from the channel until the nodes are decoded and until the completed scan
+// reaches the scan callback.
+
+#include "emulated_lidar.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+using namespace sl;
+
+static const int NODES_PER_SCAN = 2000;
+static const int SCAN_FREQUENCY = 10;
+static const int STREAM_PERIOD_US = 1000;
+
+static void printHistogram(const char* name, const LidarLatencyHistogram& histogram)
+{
+    printf("    %-12s p50 %6u us  p99 %6u us  max %6u us  (%llu samples)\n", name,
+        histogram.p50_uS, histogram.p99_uS, histogram.max_uS, (unsigned long long)histogram.count);
+}
+
+static bool benchmarkMode(bool inlineDecoding, int seconds)
+{
+    EmulatedLidar device(NODES_PER_SCAN, SCAN_FREQUENCY, STREAM_PERIOD_US);
+    if (!device.start()) {
+        fprintf(stderr, "cannot start the emulated device\n");
+        return false;
+    }
+
+    IChannel* channel = *createTcpChannel("127.0.0.1", device.getPort());
+    ILidarDriver* drv = *createLidarDriver();
+
+    LidarConnectOptions options;
+    options.inlineDecoding = inlineDecoding;
+    if (!channel || !drv || SL_IS_FAIL(drv->connect(channel, options))) {
+        fprintf(stderr, "cannot connect to the emulated device\n");
+        delete drv;
+        delete channel;
+        return false;
+    }
+
+    std::atomic<int> scanCount(0);
+    drv->setScanCallback([&scanCount](const sl_lidar_response_measurement_node_hq_t*, size_t, sl_u64) {
+        ++scanCount;
+    });
+
+    drv->startScan(false, false);
+
+    // the first scans are dropped, they include the start up
+    std::this_thread::sleep_for(std::chrono::milliseconds(300));
+    drv->resetLatencyStats();
+    drv->setLatencyTrackingEnabled(true);
+    scanCount = 0;
+
+    std::this_thread::sleep_for(std::chrono::seconds(seconds));
+
+    LidarLatencyStats stats;
+    drv->getLatencyStats(stats);
+    drv->stop();
+
+    printf("  %s decoding, %d scans:\n", inlineDecoding ? "inline" : "queued", (int)scanCount);
+    printHistogram("rxQueue", stats.rxQueue);
+    printHistogram("nodeDecode", stats.nodeDecode);
+    printHistogram("scanSwap", stats.scanSwap);
+    printHistogram("scanGrab", stats.scanGrab);
+
+    drv->disconnect();
+    delete drv;
+    delete channel;
+    return true;
+}
+
+int main(int argc, const char* argv[])
+{
+    int seconds = (argc > 1) ? atoi(argv[1]) : 5;
+    if (seconds <= 0) seconds = 5;
+
+    printf("decode latency, %d nodes per scan at %d Hz, a read every %d us, %d s per mode:\n",
+        NODES_PER_SCAN, SCAN_FREQUENCY, STREAM_PERIOD_US, seconds);
+
+    if (!benchmarkMode(false, seconds)) return -1;
+    if (!benchmarkMode(true, seconds)) return -1;
+    return 0;
+}
@@ -0,0 +1,171 @@
+/*
+ *  Slamtec LIDAR SDK
+ *
+ *  Copyright (c) 2014 - 2023 Shanghai Slamtec Co., Ltd.
+ *  http://www.slamtec.com
+ *
+ */
+ /*
+  * Redistribution and use in source and binary forms, with or without
+  * modification, are permitted provided that the following conditions are met:
+  *
+  * 1. Redistributions of source code must retain the above copyright notice,
+  *    this list of conditions and the following disclaimer.
+  *
+  * 2. Redistributions in binary form must reproduce the above copyright notice,
+  *    this list of conditions and the following disclaimer in the documentation
+  *    and/or other materials provided with the distribution.
+  *
+  * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+  * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+  * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+  * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+  * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+  * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+  * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+  * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+  * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+  * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+  * EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+  *
+  */
+
+// Measures how long the driver takes to switch the scan on and off against an
+// emulated device (see emulated_lidar.h), so what is measured is the time the
+// driver spends on top of the device itself. It also checks that probing a
+// serial port nothing answers on (a pseudo terminal) is bounded by the probe
+// timeout, as when connectLidarSerialFast tries a wrong baudrate.
+
+#include "emulated_lidar.h"
+#include "sl_lidar_fastconnect.h"
+
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <algorithm>
+
+using namespace sl;
+
+static double elapsedMs(std::chrono::steady_clock::time_point start)
+{
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+static void printResult(const char* name, std::vector<double>& samples)
+{
+    if (samples.empty()) return;
+    std::sort(samples.begin(), samples.end());
+    printf("  %-28s min %8.2f ms  median %8.2f ms  max %8.2f ms\n", name,
+        samples.front(), samples[samples.size() / 2], samples.back());
+}
+
+// a probe costs the device info query of connect, plus the channel setup
+static bool checkSilentProbe()
+{
+    int master = posix_openpt(O_RDWR | O_NOCTTY);
+    if (master < 0 || grantpt(master) < 0 || unlockpt(master) < 0) {
+        printf("  silent probe                 no pseudo terminal, skipped\n");
+        if (master >= 0) close(master);
+        return true;
+    }
+    std::string device = ptsname(master);
+
+    LidarFastConnectOptions options;
+    std::vector<double> connectTime;
+    ILidarDriver* drv = *createLidarDriver();
+    for (int round = 0; round < 3; ++round) {
+        LidarConnectOptions connectOptions;
+        connectOptions.probeTimeout = options.probeTimeout;
+        IChannel* channel = *createSerialPortChannel(device, 115200);
+
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        drv->connect(channel, connectOptions);
+        connectTime.push_back(elapsedMs(start));
+
+        sl_lidar_response_device_info_t devInfo;
+        if (SL_IS_OK(drv->getCachedDeviceInfo(devInfo))) {
+            printf("  a silent device left a device info\n");
+            return false;
+        }
+        drv->disconnect();
+        delete channel;
+    }
+
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    Result<IChannel*> found = connectLidarSerialFast(drv, device, options);
+    double fastConnectTime = elapsedMs(start);
+    delete drv;
+    if (found) delete *found;
+    close(master);
+
+    printf("silent probe, probe timeout %u ms:\n", (unsigned)options.probeTimeout);
+    printResult("connect", connectTime);
+    printf("  %-28s %8.2f ms for %d baudrates\n", "connectLidarSerialFast", fastConnectTime, (int)options.baudRates.size());
+
+    double bound = 2.0 * options.probeTimeout;
+    if (found || connectTime.back() > bound || fastConnectTime > bound * options.baudRates.size()) {
+        printf("  a probe took longer than twice the probe timeout\n");
+        return false;
+    }
+    return true;
+}
+
+int main(int argc, const char* argv[])
+{
+    int rounds = (argc > 1) ? atoi(argv[1]) : 20;
+    if (rounds <= 0) rounds = 20;
+
+    EmulatedLidar device;
+    if (!device.start()) {
+        fprintf(stderr, "cannot start the emulated device\n");
+        return -1;
+    }
+
+    IChannel* channel = *createTcpChannel("127.0.0.1", device.getPort());
+    ILidarDriver* drv = *createLidarDriver();
+    if (!channel || !drv || SL_IS_FAIL(drv->connect(channel))) {
+        fprintf(stderr, "cannot connect to the emulated device\n");
+        return -1;
+    }
+
+    printf("mode switch latency, %d rounds, device latency %d us:\n", rounds, device.getDeviceLatency());
+
+    std::vector<double> startIdle, restart, stopScanning, stopIdle, firstScan;
+    std::vector<sl_lidar_response_measurement_node_hq_t> nodes(8192);
+
+    for (int round = 0; round < rounds; ++round) {
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        if (SL_IS_FAIL(drv->startScan(false, false))) {
+            fprintf(stderr, "startScan failed\n");
+            return -1;
+        }
+        startIdle.push_back(elapsedMs(start));
+
+        size_t count = nodes.size();
+        if (SL_IS_OK(drv->grabScanDataHq(&nodes[0], count, 2000))) firstScan.push_back(elapsedMs(start));
+
+        // switch while the device is streaming
+        start = std::chrono::steady_clock::now();
+        drv->startScan(false, false);
+        restart.push_back(elapsedMs(start));
+
+        start = std::chrono::steady_clock::now();
+        drv->stop();
+        stopScanning.push_back(elapsedMs(start));
+
+        start = std::chrono::steady_clock::now();
+        drv->stop();
+        stopIdle.push_back(elapsedMs(start));
+    }
+
+    printResult("startScan (idle)", startIdle);
+    printResult("startScan (while scanning)", restart);
+    printResult("stop (while scanning)", stopScanning);
+    printResult("stop (idle)", stopIdle);
+    printResult("startScan to first scan", firstScan);
+
+    drv->disconnect();
+    delete drv;
+    delete channel;
+    return checkSilentProbe() ? 0 : -1;
+}
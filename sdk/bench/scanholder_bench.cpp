@@ -0,0 +1,587 @@
+/*
+ *  Slamtec LIDAR SDK
+ *
+ *  Copyright (c) 2014 - 2023 Shanghai Slamtec Co., Ltd.
+ *  http://www.slamtec.com
+ *
+ */
+ /*
+  * Redistribution and use in source and binary forms, with or without
+  * modification, are permitted provided that the following conditions are met:
+  *
+  * 1. Redistributions of source code must retain the above copyright notice,
+  *    this list of conditions and the following disclaimer.
+  *
+  * 2. Redistributions in binary form must reproduce the above copyright notice,
+  *    this list of conditions and the following disclaimer in the documentation
+  *    and/or other materials provided with the distribution.
+  *
+  * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+  * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+  * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+  * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+  * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+  * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+  * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+  * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+  * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+  * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+  * EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+  *
+  */
+
+// Compares designs of the scan hand-over between the decoder thread and the grab interfaces under
+// contention: a synthetic producer pushes the node stream of an S3 (32K samples/s at 10Hz) in
+// dense capsule sized chunks, and 1 to 8 consumer threads wait for every new scan, read all of
+// its nodes and give it back. The designs are:
+//   double buffer  one mutex, the consumers copy the latest scan out under it (the former holder)
+//   triple buffer  the producer never waits, the consumers take turns to swap and copy the latest scan
+//   seqlock ring   the producer never waits, the consumers copy a scan and retry if it was overwritten
+//   slot ring      ScanDataHolder: the consumers lease a scan of the history without copying it
+// It reports the consumed scans, the latency from the publication of a scan until a consumer
+// gets it, the time the producer spent in the pushes, the scans dropped by the producer and
+// the scans the consumers missed because a newer one had replaced them.
+
+#include "sdkcommon.h"
+#include "hal/locker.h"
+#include "hal/event.h"
+#include "sl_lidar_driver.h"
+#include "sl_latency_stats.h"
+#include "sl_scan_data_holder.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
+
+using namespace sl;
+using namespace sl::internal;
+
+typedef sl_lidar_response_measurement_node_hq_t node_t;
+
+static const int S3_SAMPLE_RATE = 32000;
+static const int S3_SCAN_FREQUENCY = 10;
+static const size_t NODES_PER_SCAN = S3_SAMPLE_RATE / S3_SCAN_FREQUENCY;
+// the nodes of a dense capsule
+static const size_t NODES_PER_CHUNK = 40;
+static const size_t MAX_SCAN_NODES = 8192;
+static const _u32 CONSUMER_TIMEOUT_MS = 100;
+
+struct ConsumerContext
+{
+    explicit ConsumerContext(_u32 work)
+        : lastSequence(0)
+        , work_uS(work)
+        , checksum(0)
+    {
+        copy.reserve(MAX_SCAN_NODES);
+    }
+
+    _u64                lastSequence;
+    _u32                work_uS;
+    _u64                checksum;
+    std::vector<node_t> copy;
+};
+
+struct ScanInfo
+{
+    _u64 sequence;
+    _u64 publish_uS;
+    _u64 acquire_uS;
+};
+
+// what a consumer does with every scan: read all of its nodes, then keep busy for work_uS
+static void processScan(ConsumerContext& ctx, const node_t* nodes, size_t count)
+{
+    _u64 sum = 0;
+    for (size_t pos = 0; pos < count; ++pos) {
+        sum += nodes[pos].dist_mm_q2;
+    }
+    ctx.checksum += sum;
+
+    if (ctx.work_uS) {
+        _u64 until = getus() + ctx.work_uS;
+        while (getus() < until) {}
+    }
+}
+
+// appends a node to a scan the way ScanDataHolder does, the last entry is replaced once it is full
+static void appendNode(node_t* scan, size_t& count, const node_t& node)
+{
+    if (count < MAX_SCAN_NODES) scan[count++] = node;
+    else scan[MAX_SCAN_NODES - 1] = node;
+}
+
+class ScanQueue
+{
+public:
+    virtual ~ScanQueue() {}
+
+    virtual const char* getName() const = 0;
+
+    // called by a single producer thread
+    virtual void push(const node_t* nodes, size_t count) = 0;
+
+    // wait for a scan published after ctx.lastSequence and process it, false on timeout
+    virtual bool consume(ConsumerContext& ctx, _u32 timeout_ms, ScanInfo& info) = 0;
+
+    virtual _u64 getDroppedScanCount() const { return 0; }
+
+    // reads given up because the scan was overwritten meanwhile
+    virtual _u64 getRetryCount() const { return 0; }
+};
+
+// wakes up every waiting consumer when a scan is published
+class PublishNotifier
+{
+public:
+    PublishNotifier()
+        : _latest(0)
+    {
+    }
+
+    void publish(_u64 sequence)
+    {
+        std::lock_guard<std::mutex> l(_locker);
+        _latest = sequence;
+        _published.notify_all();
+    }
+
+    bool wait(_u64 afterSequence, _u32 timeout_ms)
+    {
+        std::unique_lock<std::mutex> l(_locker);
+        return _published.wait_for(l, std::chrono::milliseconds(timeout_ms), [this, afterSequence] { return _latest > afterSequence; });
+    }
+
+private:
+    std::mutex              _locker;
+    std::condition_variable _published;
+    _u64                    _latest;
+};
+
+class DoubleBufferQueue : public ScanQueue
+{
+public:
+    DoubleBufferQueue()
+        : _operational(0)
+        , _sequence(0)
+        , _publish_uS(0)
+    {
+        for (int pos = 0; pos < 2; ++pos) {
+            _scans[pos].resize(MAX_SCAN_NODES);
+            _counts[pos] = 0;
+        }
+    }
+
+    virtual const char* getName() const { return "double buffer"; }
+
+    virtual void push(const node_t* nodes, size_t count)
+    {
+        std::lock_guard<std::mutex> l(_locker);
+        bool published = false;
+        for (size_t pos = 0; pos < count; ++pos) {
+            if (nodes[pos].flag & RPLIDAR_RESP_HQ_FLAG_SYNCBIT) {
+                if (_counts[_operational]) {
+                    _operational ^= 1;
+                    ++_sequence;
+                    _publish_uS = getus();
+                    published = true;
+                }
+                _counts[_operational] = 0;
+            }
+            else if (!_counts[_operational]) {
+                continue;
+            }
+            appendNode(&_scans[_operational][0], _counts[_operational], nodes[pos]);
+        }
+        if (published) _published.notify_all();
+    }
+
+    virtual bool consume(ConsumerContext& ctx, _u32 timeout_ms, ScanInfo& info)
+    {
+        {
+            std::unique_lock<std::mutex> l(_locker);
+            if (!_published.wait_for(l, std::chrono::milliseconds(timeout_ms), [this, &ctx] { return _sequence > ctx.lastSequence; })) {
+                return false;
+            }
+            info.acquire_uS = getus();
+            info.sequence = _sequence;
+            info.publish_uS = _publish_uS;
+            int available = _operational ^ 1;
+            ctx.copy.assign(_scans[available].begin(), _scans[available].begin() + _counts[available]);
+        }
+        processScan(ctx, ctx.copy.data(), ctx.copy.size());
+        return true;
+    }
+
+private:
+    std::mutex              _locker;
+    std::condition_variable _published;
+    std::vector<node_t>     _scans[2];
+    size_t                  _counts[2];
+    int                     _operational;
+    _u64                    _sequence;
+    _u64                    _publish_uS;
+};
+
+class TripleBufferQueue : public ScanQueue
+{
+public:
+    TripleBufferQueue()
+        : _back(0)
+        , _front(1)
+        , _middle(2)
+        , _sequence(0)
+    {
+        for (int pos = 0; pos < 3; ++pos) {
+            _scans[pos].nodes.resize(MAX_SCAN_NODES);
+            _scans[pos].count = 0;
+            _scans[pos].sequence = 0;
+            _scans[pos].publish_uS = 0;
+        }
+    }
+
+    virtual const char* getName() const { return "triple buffer"; }
+
+    virtual void push(const node_t* nodes, size_t count)
+    {
+        for (size_t pos = 0; pos < count; ++pos) {
+            Scan* back = &_scans[_back];
+            if (nodes[pos].flag & RPLIDAR_RESP_HQ_FLAG_SYNCBIT) {
+                if (back->count) {
+                    back->sequence = ++_sequence;
+                    back->publish_uS = getus();
+                    _back = _middle.exchange(_back | FRESH_FLAG, std::memory_order_acq_rel) & INDEX_MASK;
+                    _notifier.publish(_sequence);
+                    back = &_scans[_back];
+                }
+                back->count = 0;
+            }
+            else if (!back->count) {
+                continue;
+            }
+            appendNode(&back->nodes[0], back->count, nodes[pos]);
+        }
+    }
+
+    virtual bool consume(ConsumerContext& ctx, _u32 timeout_ms, ScanInfo& info)
+    {
+        if (!_notifier.wait(ctx.lastSequence, timeout_ms)) return false;
+        {
+            // the front buffer has a single owner, the consumers take turns
+            std::lock_guard<std::mutex> l(_readLocker);
+            if (_middle.load(std::memory_order_relaxed) & FRESH_FLAG) {
+                _front = _middle.exchange(_front, std::memory_order_acq_rel) & INDEX_MASK;
+            }
+            const Scan& front = _scans[_front];
+            if (front.sequence <= ctx.lastSequence) return false;
+
+            info.acquire_uS = getus();
+            info.sequence = front.sequence;
+            info.publish_uS = front.publish_uS;
+            ctx.copy.assign(front.nodes.begin(), front.nodes.begin() + front.count);
+        }
+        processScan(ctx, ctx.copy.data(), ctx.copy.size());
+        return true;
+    }
+
+private:
+    enum {
+        INDEX_MASK = 0x3,
+        FRESH_FLAG = 0x4,
+    };
+
+    struct Scan {
+        std::vector<node_t> nodes;
+        size_t              count;
+        _u64                sequence;
+        _u64                publish_uS;
+    };
+
+    Scan                _scans[3];
+    // owned by the producer
+    int                 _back;
+    // owned by the consumer holding _readLocker
+    int                 _front;
+    std::atomic<int>    _middle;
+    std::mutex          _readLocker;
+    _u64                _sequence;
+    PublishNotifier     _notifier;
+};
+
+class SeqlockRingQueue : public ScanQueue
+{
+public:
+    enum {
+        SLOT_COUNT = 4,
+    };
+
+    SeqlockRingQueue()
+        : _slots(new Slot[SLOT_COUNT])
+        , _writingCount(0)
+        , _latest(0)
+        , _retryCount(0)
+    {
+        _beginWrite(_slots[1]);
+    }
+
+    ~SeqlockRingQueue()
+    {
+        delete[] _slots;
+    }
+
+    virtual const char* getName() const { return "seqlock ring"; }
+
+    // the scan of sequence number n is written into the slot n % SLOT_COUNT
+    virtual void push(const node_t* nodes, size_t count)
+    {
+        _u64 published = _latest.load(std::memory_order_relaxed);
+        for (size_t pos = 0; pos < count; ++pos) {
+            Slot* slot = &_slots[(published + 1) % SLOT_COUNT];
+            if (nodes[pos].flag & RPLIDAR_RESP_HQ_FLAG_SYNCBIT) {
+                if (_writingCount) {
+                    ++published;
+                    slot->count.store(_writingCount, std::memory_order_relaxed);
+                    slot->sequence.store(published, std::memory_order_relaxed);
+                    slot->publish_uS.store(getus(), std::memory_order_relaxed);
+                    slot->version.store(slot->version.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+                    _latest.store(published, std::memory_order_release);
+                    _notifier.publish(published);
+
+                    slot = &_slots[(published + 1) % SLOT_COUNT];
+                    _beginWrite(*slot);
+                }
+                _writingCount = 0;
+            }
+            else if (!_writingCount) {
+                continue;
+            }
+            appendNode(slot->nodes, _writingCount, nodes[pos]);
+        }
+    }
+
+    virtual bool consume(ConsumerContext& ctx, _u32 timeout_ms, ScanInfo& info)
+    {
+        if (!_notifier.wait(ctx.lastSequence, timeout_ms)) return false;
+
+        for (;;) {
+            _u64 sequence = _latest.load(std::memory_order_acquire);
+            const Slot& slot = _slots[sequence % SLOT_COUNT];
+
+            _u64 version = slot.version.load(std::memory_order_acquire);
+            if (!(version & 1)) {
+                info.acquire_uS = getus();
+                size_t count = slot.count.load(std::memory_order_relaxed);
+                info.sequence = slot.sequence.load(std::memory_order_relaxed);
+                info.publish_uS = slot.publish_uS.load(std::memory_order_relaxed);
+                ctx.copy.resize(count);
+                memcpy(ctx.copy.data(), slot.nodes, count * sizeof(node_t));
+
+                std::atomic_thread_fence(std::memory_order_acquire);
+                if (slot.version.load(std::memory_order_relaxed) == version && info.sequence == sequence) break;
+            }
+            _retryCount.fetch_add(1, std::memory_order_relaxed);
+        }
+        processScan(ctx, ctx.copy.data(), ctx.copy.size());
+        return true;
+    }
+
+    virtual _u64 getRetryCount() const
+    {
+        return _retryCount.load(std::memory_order_relaxed);
+    }
+
+private:
+    struct Slot {
+        Slot()
+            : version(0)
+            , count(0)
+            , sequence(0)
+            , publish_uS(0)
+        {
+        }
+
+        // odd while the producer writes the slot
+        std::atomic<_u64>   version;
+        std::atomic<size_t> count;
+        std::atomic<_u64>   sequence;
+        std::atomic<_u64>   publish_uS;
+        node_t              nodes[MAX_SCAN_NODES];
+    };
+
+    void _beginWrite(Slot& slot)
+    {
+        slot.version.store(slot.version.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+    }
+
+    Slot*               _slots;
+    size_t              _writingCount;
+    std::atomic<_u64>   _latest;
+    std::atomic<_u64>   _retryCount;
+    PublishNotifier     _notifier;
+};
+
+class SlotRingQueue : public ScanQueue
+{
+public:
+    explicit SlotRingQueue(size_t slotCount)
+        : _holder(MAX_SCAN_NODES, slotCount)
+        , _timestamps(MAX_SCAN_NODES, 0)
+    {
+        snprintf(_name, sizeof(_name), "slot ring (%d)", (int)slotCount);
+    }
+
+    virtual const char* getName() const { return _name; }
+
+    virtual void push(const node_t* nodes, size_t count)
+    {
+        _u64 arrival_uS = getus();
+        size_t pos = 0;
+        while (pos < count) {
+            bool published;
+            pos += _holder.pushScanNodeDataBatch(&_timestamps[0], nodes + pos, count - pos, published, arrival_uS);
+        }
+    }
+
+    virtual bool consume(ConsumerContext& ctx, _u32 timeout_ms, ScanInfo& info)
+    {
+        int slotID;
+        const ScanDataHolder<node_t>::scan_buffer_t* scan = _holder.acquireScanAfter(ctx.lastSequence, timeout_ms, slotID, NULL, &info.publish_uS, &info.sequence);
+        if (!scan) return false;
+        info.acquire_uS = getus();
+
+        // the leased scan is read in place
+        processScan(ctx, scan->data(), scan->size());
+        _holder.releaseScan(slotID);
+        return true;
+    }
+
+    virtual _u64 getDroppedScanCount() const
+    {
+        return _holder.getDroppedScanCount();
+    }
+
+private:
+    ScanDataHolder<node_t>  _holder;
+    std::vector<_u64>       _timestamps;
+    char                    _name[32];
+};
+
+static void benchmarkQueue(ScanQueue& queue, int consumerCount, double seconds, double speed, _u32 work_uS)
+{
+    LatencyHistogram latency;
+    LatencyHistogram stall;
+    std::atomic<bool> running(true);
+    std::atomic<_u64> consumedCount(0);
+    std::atomic<_u64> missedCount(0);
+
+    std::vector<std::thread> consumers;
+    for (int pos = 0; pos < consumerCount; ++pos) {
+        consumers.push_back(std::thread([&] {
+            ConsumerContext ctx(work_uS);
+            while (running) {
+                ScanInfo info;
+                if (!queue.consume(ctx, CONSUMER_TIMEOUT_MS, info)) continue;
+
+                latency.record(info.acquire_uS - info.publish_uS);
+                if (ctx.lastSequence && info.sequence > ctx.lastSequence + 1) {
+                    missedCount += info.sequence - ctx.lastSequence - 1;
+                }
+                ctx.lastSequence = info.sequence;
+                ++consumedCount;
+            }
+        }));
+    }
+
+    // the chunks are pushed at the pace of the device, as fast as possible with a zero speed
+    std::chrono::nanoseconds chunkPeriod(0);
+    if (speed > 0) chunkPeriod = std::chrono::nanoseconds((long long)(1e9 * NODES_PER_CHUNK / S3_SAMPLE_RATE / speed));
+
+    std::vector<node_t> chunk(NODES_PER_CHUNK);
+    size_t sampleIdx = 0;
+    _u64 syncCount = 0;
+    _u64 stallTotal_uS = 0;
+
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    std::chrono::steady_clock::time_point end = start + std::chrono::nanoseconds((long long)(seconds * 1e9));
+    std::chrono::steady_clock::time_point next = start;
+    while (std::chrono::steady_clock::now() < end) {
+        for (size_t pos = 0; pos < NODES_PER_CHUNK; ++pos, sampleIdx = (sampleIdx + 1) % NODES_PER_SCAN) {
+            node_t& node = chunk[pos];
+            node.angle_z_q14 = (_u16)(sampleIdx * 65536 / NODES_PER_SCAN);
+            node.dist_mm_q2 = (_u32)((1000 + sampleIdx) << 2);
+            node.quality = 47 << 2;
+            node.flag = sampleIdx ? 0 : RPLIDAR_RESP_HQ_FLAG_SYNCBIT;
+            if (!sampleIdx) ++syncCount;
+        }
+
+        _u64 pushStart_uS = getus();
+        queue.push(&chunk[0], chunk.size());
+        _u64 pushTime_uS = getus() - pushStart_uS;
+        stall.record(pushTime_uS);
+        stallTotal_uS += pushTime_uS;
+
+        next += chunkPeriod;
+        if (speed > 0) std::this_thread::sleep_until(next);
+        else next += std::chrono::nanoseconds(1);
+    }
+    double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    running = false;
+    for (size_t pos = 0; pos < consumers.size(); ++pos) {
+        consumers[pos].join();
+    }
+
+    LidarLatencyHistogram latencySummary, stallSummary;
+    latency.getSummary(latencySummary);
+    stall.getSummary(stallSummary);
+
+    printf("  %-15s %d consumer(s) %8.1f scans/s  latency p50 %6u p99 %6u max %6u us  stall %7.1f ms p99 %5u max %6u us"
+        "  dropped %llu missed %llu",
+        queue.getName(), consumerCount, consumedCount / elapsed,
+        latencySummary.p50_uS, latencySummary.p99_uS, latencySummary.max_uS,
+        stallTotal_uS / 1000.0, stallSummary.p99_uS, stallSummary.max_uS,
+        (unsigned long long)queue.getDroppedScanCount(), (unsigned long long)missedCount.load());
+    if (queue.getRetryCount()) {
+        printf(" retried %llu", (unsigned long long)queue.getRetryCount());
+    }
+    // the first sync node only opens the first scan
+    printf(" (of %llu published)\n", (unsigned long long)(syncCount ? syncCount - 1 : 0));
+}
+
+int main(int argc, const char* argv[])
+{
+    double seconds = (argc > 1) ? atof(argv[1]) : 2;
+    if (seconds <= 0) seconds = 2;
+
+    // a multiple of the S3 sample rate, 0 pushes the chunks back to back
+    double speed = (argc > 2) ? atof(argv[2]) : 1;
+    if (speed < 0) speed = 1;
+
+    // the time every consumer spends on a scan once it has read it
+    _u32 work_uS = (argc > 3) ? (_u32)atoi(argv[3]) : 0;
+
+    printf("%d samples/s at %d Hz, speed x%g, %u us of work per scan, %g s per run\n",
+        S3_SAMPLE_RATE, S3_SCAN_FREQUENCY, speed, work_uS, seconds);
+
+    static const int consumerCounts[] = { 1, 2, 4, 8 };
+    for (size_t design = 0; design < 4; ++design) {
+        for (size_t pos = 0; pos < _countof(consumerCounts); ++pos) {
+            ScanQueue* queue = NULL;
+            switch (design) {
+            case 0: queue = new DoubleBufferQueue(); break;
+            case 1: queue = new TripleBufferQueue(); break;
+            case 2: queue = new SeqlockRingQueue(); break;
+            default: queue = new SlotRingQueue(ScanDataHolder<node_t>::DEFAULT_SCAN_SLOT_COUNT); break;
+            }
+            benchmarkQueue(*queue, consumerCounts[pos], seconds, speed, work_uS);
+            delete queue;
+        }
+    }
+    return 0;
+}
@@ -37,7 +37,13 @@
 
 namespace sl {namespace crc32 {
     sl_u32 bitrev(sl_u32 input, sl_u16 bw);//reflect
-    void init(sl_u32 poly); // table init
+    void init(sl_u32 poly); // only needed for a non-default polynomial, the default (0x4C11DB7) tables are built at compile time
     sl_u32 cal(sl_u32 crc, void* input, sl_u16 len);
-    sl_result getResult(sl_u8 *ptr, sl_u32 len);
+    sl_result getResult(sl_u8 *ptr, sl_u32 len); // default polynomial, thread-safe
+
+    // incremental version of getResult(), the data can be fed in pieces:
+    // finish(update(begin(), ptr, len), len) == getResult(ptr, len)
+    sl_u32 begin();
+    sl_u32 update(sl_u32 state, const void* input, sl_u32 len);
+    sl_u32 finish(sl_u32 state, sl_u32 totalLen); // appends the zero padding
 }}
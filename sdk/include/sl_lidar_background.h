@@ -0,0 +1,125 @@
+/*
+ *  Slamtec LIDAR SDK
+ *
+ *  Copyright (c) 2014 - 2023 Shanghai Slamtec Co., Ltd.
+ *  http://www.slamtec.com
+ *
+ */
+ /*
+  * Redistribution and use in source and binary forms, with or without
+  * modification, are permitted provided that the following conditions are met:
+  *
+  * 1. Redistributions of source code must retain the above copyright notice,
+  *    this list of conditions and the following disclaimer.
+  *
+  * 2. Redistributions in binary form must reproduce the above copyright notice,
+  *    this list of conditions and the following disclaimer in the documentation
+  *    and/or other materials provided with the distribution.
+  *
+  * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+  * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+  * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+  * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+  * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+  * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+  * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+  * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+  * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+  * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+  * EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+  *
+  */
+
+#pragma once
+
+#include "sl_lidar_cmd.h"
+#include <stddef.h>
+#include <vector>
+
+namespace sl {
+
+    /**
+    * Options of a background model
+    */
+    struct LidarBackgroundOptions
+    {
+        // bin k covers the angles [k * 360 / binCount, (k + 1) * 360 / binCount) degrees, 1 to 65536
+        size_t  binCount;
+
+        // weight of a new scan in the background statistics, and the (much smaller) one while a bin sees
+        // the foreground, which lets an object staying in place fade into the background
+        float   learningRate;
+        float   foregroundLearningRate;
+
+        // a point is foreground when it is closer than the background of its bin by more than both minDistance
+        // (in millimeter) and sigmaFactor times the standard deviation of the background range
+        float   minDistance;
+        float   sigmaFactor;
+
+        // scans learnt as a plain average before any foreground is reported
+        sl_u32  warmupScans;
+
+        LidarBackgroundOptions()
+            : binCount(1440)
+            , learningRate(0.02f)
+            , foregroundLearningRate(0.0005f)
+            , minDistance(100)
+            , sigmaFactor(3)
+            , warmupScans(10)
+        {
+        }
+    };
+
+    /**
+    * Per bearing background model of a fixed installation, separating the points of a scan which differ from it
+    *
+    * Every bin keeps an exponential mean and variance of the closest range it sees and how often it sees one at all,
+    * so a bin facing open space has no background and anything appearing there is foreground. The statistics are
+    * kept as separate arrays and updated with SSE2/AVX2 (selected at runtime) or NEON instructions when available.
+    *
+    * A model is not thread-safe, use one per sensor.
+    */
+    class LidarBackgroundModel
+    {
+    public:
+        LidarBackgroundModel(const LidarBackgroundOptions& options = LidarBackgroundOptions());
+
+        const LidarBackgroundOptions& options() const { return _options; }
+
+        /// Forget the background and start learning again, the options are applied
+        void reset(const LidarBackgroundOptions& options);
+        void reset() { reset(_options); }
+
+        /// The warm up is over and the foreground is reported
+        bool isReady() const { return _scanCount >= _options.warmupScans; }
+
+        /**
+        * Learn a scan and pick its foreground points
+        * \param nodes       The nodes of the scan, in any order, the invalid ones (0 distance) are ignored
+        * \param foreground  Receives the foreground nodes in the scan order (cleared first), nothing during the warm up
+        * \param learn       Update the background with the scan, otherwise it is only compared with it
+        * \return The foreground node count
+        */
+        size_t apply(const sl_lidar_response_measurement_node_hq_t* nodes, size_t count, std::vector<sl_lidar_response_measurement_node_hq_t>& foreground, bool learn = true);
+
+        size_t binCount() const { return _mean.size(); }
+
+        /// Background range of every bin in millimeter, and the share of the scans in which the bin saw anything
+        const float* backgroundRange() const { return &_mean[0]; }
+        const float* backgroundPresence() const { return &_presence[0]; }
+
+    private:
+        LidarBackgroundOptions  _options;
+        sl_u32                  _scanCount;
+
+        // the closest range of every bin in the current scan, 0 if none
+        std::vector<float>      _observed;
+        // a node closer than this is foreground, computed from the statistics before the update
+        std::vector<float>      _limit;
+
+        std::vector<float>      _mean;
+        std::vector<float>      _variance;
+        std::vector<float>      _presence;
+    };
+
+}
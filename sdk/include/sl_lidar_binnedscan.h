@@ -0,0 +1,120 @@
+/*
+ *  Slamtec LIDAR SDK
+ *
+ *  Copyright (c) 2014 - 2023 Shanghai Slamtec Co., Ltd.
+ *  http://www.slamtec.com
+ *
+ */
+ /*
+  * Redistribution and use in source and binary forms, with or without
+  * modification, are permitted provided that the following conditions are met:
+  *
+  * 1. Redistributions of source code must retain the above copyright notice,
+  *    this list of conditions and the following disclaimer.
+  *
+  * 2. Redistributions in binary form must reproduce the above copyright notice,
+  *    this list of conditions and the following disclaimer in the documentation
+  *    and/or other materials provided with the distribution.
+  *
+  * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+  * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+  * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+  * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+  * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+  * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+  * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+  * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+  * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+  * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+  * EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+  *
+  */
+
+#pragma once
+
+#include "sl_lidar_cmd.h"
+#include <stddef.h>
+#include <vector>
+
+namespace sl {
+
+    /**
+    * Scan resampled into fixed angular bins
+    *
+    * Bin k covers the angles [k * 360 / binCount, (k + 1) * 360 / binCount) degrees, the nodes are bucketed by
+    * their angle_z_q14 value. The range at a bearing is a single lookup and the min range of any sector is
+    * answered in constant time by a sparse table built when the scan is assigned.
+    */
+    class LidarBinnedScan
+    {
+    public:
+        enum BinPolicy {
+            BIN_POLICY_MIN,     // the closest node of the bin
+            BIN_POLICY_LAST,    // the last node of the bin in the scan order
+            BIN_POLICY_MEAN,    // the mean range of the nodes of the bin
+        };
+
+        enum {
+            MAX_BIN_COUNT = 65536, // the resolution of angle_z_q14
+        };
+
+        /// e.g. 1440 bins for a 0.25 degree resolution
+        LidarBinnedScan(size_t binCount = 1440, BinPolicy policy = BIN_POLICY_MIN);
+
+        /// Change the bin count (1 to MAX_BIN_COUNT) and the policy, the scan is cleared
+        void configure(size_t binCount, BinPolicy policy);
+
+        size_t binCount() const { return _range.size(); }
+        BinPolicy policy() const { return _policy; }
+
+        /// Bucket the nodes into the bins, the invalid ones (0 distance) are ignored
+        void assign(const sl_lidar_response_measurement_node_hq_t* nodes, size_t count, sl_u64 timestamp_uS = 0);
+
+        /// Empty all the bins
+        void clear();
+
+        /// Timestamp of the first node of the scan (in microseconds)
+        sl_u64 timestamp_uS() const { return _timestamp_uS; }
+
+        /// Range of every bin in millimeter, 0 for an empty bin
+        const float* range() const { return &_range[0]; }
+        float range(size_t bin) const { return _range[bin]; }
+
+        /// The bin of an angle in degree, any value is wrapped into [0, 360)
+        size_t binAt(float angle) const;
+
+        /// Angle of the center of a bin in degree
+        float binAngle(size_t bin) const { return (bin + 0.5f) * 360.f / binCount(); }
+
+        /// Range at a bearing in degree, 0 if its bin is empty
+        float rangeAt(float angle) const { return _range[binAt(angle)]; }
+
+        /// The bin with the min range among the bins fromBin to toBin (both included), the sector wraps around 0
+        /// degree when fromBin > toBin.
+        /// \return binCount() if all of them are empty
+        size_t minBin(size_t fromBin, size_t toBin) const;
+
+        /// Min range in millimeter of the sector going clockwise from fromAngle to toAngle (in degree, both bins included),
+        /// 0 if all its bins are empty
+        /// \param bin  Optional, receives the bin of the min range (binCount() if none)
+        float minRange(float fromAngle, float toAngle, size_t* bin = NULL) const;
+
+    private:
+        void _buildSectorTable();
+        size_t _minBinOfRange(size_t fromBin, size_t toBin) const;
+
+        BinPolicy               _policy;
+        sl_u64                  _timestamp_uS;
+
+        std::vector<float>      _range;
+        // the range used to compare the bins, an empty bin is farther than any other one
+        std::vector<float>      _key;
+        // level k holds the bin of the min range of the 2^k bins starting at every bin
+        std::vector<sl_u32>     _sectorTable;
+        // floor(log2(n)) for n in [1, binCount]
+        std::vector<sl_u8>      _log2;
+        // for BIN_POLICY_MEAN
+        std::vector<sl_u32>     _nodeCount;
+    };
+
+}
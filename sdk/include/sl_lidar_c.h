@@ -0,0 +1,193 @@
+/*
+ *  Slamtec LIDAR SDK
+ *
+ *  Copyright (c) 2014 - 2023 Shanghai Slamtec Co., Ltd.
+ *  http://www.slamtec.com
+ *
+ */
+ /*
+  * Redistribution and use in source and binary forms, with or without
+  * modification, are permitted provided that the following conditions are met:
+  *
+  * 1. Redistributions of source code must retain the above copyright notice,
+  *    this list of conditions and the following disclaimer.
+  *
+  * 2. Redistributions in binary form must reproduce the above copyright notice,
+  *    this list of conditions and the following disclaimer in the documentation
+  *    and/or other materials provided with the distribution.
+  *
+  * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+  * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+  * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+  * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+  * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+  * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+  * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+  * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+  * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+  * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+  * EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+  *
+  */
+
+#pragma once
+
+// C interface of the driver for language bindings (Python ctypes/cffi, Rust FFI, ...), see ILidarDriver for the details
+// of the calls. Only plain C types cross it, the structs keep their layout once released: new fields are appended and
+// the calls filling a struct take its size, so a binding built against an older header keeps working.
+
+#include <stddef.h>
+#include "sl_types.h"
+#include "sl_lidar_cmd.h"
+
+#if defined(__GNUC__)
+#   define SL_LIDAR_C_API __attribute__((visibility("default")))
+#else
+#   define SL_LIDAR_C_API
+#endif
+
+#define SL_LIDAR_C_ABI_VERSION  1
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct sl_lidar_t sl_lidar_t;
+
+typedef struct sl_lidar_scan_mode_t
+{
+    uint16_t    id;
+    float       us_per_sample;
+    float       max_distance;
+    uint8_t     ans_type;
+    char        name[64];
+} sl_lidar_scan_mode_t;
+
+// Type codes of sl_lidar_scan_field_t, the values match DLDataTypeCode of DLPack
+enum
+{
+    SL_LIDAR_DTYPE_INT = 0,
+    SL_LIDAR_DTYPE_UINT = 1,
+    SL_LIDAR_DTYPE_FLOAT = 2,
+};
+
+// One field of the nodes of a scan buffer
+typedef struct sl_lidar_scan_field_t
+{
+    const char* name;           // same as the member of sl_lidar_response_measurement_node_hq_t, e.g. "dist_mm_q2"
+    uint8_t     dtype_code;     // SL_LIDAR_DTYPE_*
+    uint8_t     dtype_bits;
+    uint16_t    offset;         // byte offset in a node, the fields are not aligned
+    double      scale;          // multiply by it for the physical value, e.g. 0.25 for the distance in mm
+    const char* unit;
+} sl_lidar_scan_field_t;
+
+// A complete scan borrowed from the driver without copying, in the spirit of DLManagedTensor of DLPack:
+// a one-dimensional array of count nodes, stride bytes apart, whose fields are described by fields.
+// The memory is read-only and stays valid until release is called, which has to be done exactly once,
+// from any thread and even after sl_lidar_destroy (the driver is kept until the last buffer is released).
+// Holding many buffers makes the driver drop the new scans, see ILidarDriver::acquireScan.
+typedef struct sl_lidar_scan_buffer_t
+{
+    const void* data;
+    uint64_t    count;
+    uint64_t    stride;
+
+    const sl_lidar_scan_field_t* fields;
+    uint32_t    field_count;
+
+    uint64_t    timestamp_us;       // first node
+    uint64_t    end_timestamp_us;   // last node, the nodes in between are evenly spaced in time
+    uint64_t    sequence;           // counts the scans from 1, a gap tells how many were missed
+
+    void*       manager_ctx;
+    void        (*release)(struct sl_lidar_scan_buffer_t* self);
+} sl_lidar_scan_buffer_t;
+
+// Same as LidarRuntimeStats
+typedef struct sl_lidar_runtime_stats_t
+{
+    uint64_t    rx_bytes;
+    uint64_t    rx_overflow_bytes;
+    uint32_t    rx_overflow_count;
+    uint32_t    checksum_error_count;
+    uint64_t    packet_count;
+    uint64_t    sample_packet_count;
+    uint32_t    decoding_error_count;
+    uint32_t    dropped_scan_count;
+    uint64_t    node_count;
+    uint64_t    scan_count;
+    uint64_t    truncated_scan_node_count;
+    uint64_t    dropped_sample_node_count;
+    float       sample_period_us;
+    float       sample_clock_drift_ppm;
+    uint32_t    sample_clock_resync_count;
+    uint32_t    channel_error_count;
+    uint32_t    reconnect_count;
+    uint32_t    reconnect_failure_count;
+    uint64_t    last_recovery_time_us;
+    uint64_t    total_downtime_us;
+    uint64_t    filtered_node_count;
+} sl_lidar_runtime_stats_t;
+
+// Same as LidarMemoryFootprint
+typedef struct sl_lidar_memory_footprint_t
+{
+    uint64_t    arena_bytes;
+    uint64_t    rx_queue_bytes;
+    uint64_t    scan_cache_bytes;
+    uint64_t    scan_slot_count;
+    uint64_t    scan_node_capacity;
+    uint64_t    interval_sample_queue_bytes;
+    uint64_t    slice_buffer_bytes;
+    uint64_t    total_bytes;
+} sl_lidar_memory_footprint_t;
+
+/// SL_LIDAR_C_ABI_VERSION of the library, a binding should check it before anything else
+SL_LIDAR_C_API uint32_t sl_lidar_abi_version(void);
+
+SL_LIDAR_C_API sl_result sl_lidar_create(sl_lidar_t** lidar);
+
+/// Disconnects and frees the driver, once the scan buffers still held are released
+SL_LIDAR_C_API void sl_lidar_destroy(sl_lidar_t* lidar);
+
+/// The channel is created and owned by the driver until sl_lidar_disconnect
+SL_LIDAR_C_API sl_result sl_lidar_connect_serial(sl_lidar_t* lidar, const char* device, uint32_t baudrate);
+SL_LIDAR_C_API sl_result sl_lidar_connect_tcp(sl_lidar_t* lidar, const char* ip, uint16_t port);
+SL_LIDAR_C_API sl_result sl_lidar_connect_udp(sl_lidar_t* lidar, const char* ip, uint16_t port);
+SL_LIDAR_C_API void sl_lidar_disconnect(sl_lidar_t* lidar);
+SL_LIDAR_C_API int sl_lidar_is_connected(sl_lidar_t* lidar);
+
+SL_LIDAR_C_API sl_result sl_lidar_get_device_info(sl_lidar_t* lidar, sl_lidar_response_device_info_t* info, uint32_t timeout_ms);
+SL_LIDAR_C_API sl_result sl_lidar_get_health(sl_lidar_t* lidar, sl_lidar_response_device_health_t* health, uint32_t timeout_ms);
+
+/// count holds the size of modes when called and the number of modes filled (or available if modes is NULL) on return
+SL_LIDAR_C_API sl_result sl_lidar_get_scan_modes(sl_lidar_t* lidar, sl_lidar_scan_mode_t* modes, size_t* count);
+
+/// used_mode may be NULL
+SL_LIDAR_C_API sl_result sl_lidar_start_scan(sl_lidar_t* lidar, int force, int use_typical_scan, sl_lidar_scan_mode_t* used_mode);
+SL_LIDAR_C_API sl_result sl_lidar_start_scan_mode(sl_lidar_t* lidar, uint16_t mode_id, sl_lidar_scan_mode_t* used_mode);
+SL_LIDAR_C_API sl_result sl_lidar_stop(sl_lidar_t* lidar);
+SL_LIDAR_C_API sl_result sl_lidar_set_motor_speed(sl_lidar_t* lidar, uint16_t speed);
+
+/// Keep only the nodes within range_count angular ranges (in degree, none for any angle), one out of decimation
+/// and of a quality from min_quality, see ILidarDriver::setAcquisitionFilter
+SL_LIDAR_C_API sl_result sl_lidar_set_acquisition_filter(sl_lidar_t* lidar, const float* start_deg, const float* end_deg, size_t range_count
+    , uint32_t decimation, uint8_t min_quality);
+
+/// Borrow the latest complete scan, see ILidarDriver::acquireScan. *buffer is left NULL on failure
+SL_LIDAR_C_API sl_result sl_lidar_acquire_scan(sl_lidar_t* lidar, uint32_t timeout_ms, sl_lidar_scan_buffer_t** buffer);
+
+/// Borrow the oldest scan newer than after_sequence, see ILidarDriver::acquireNextScan
+SL_LIDAR_C_API sl_result sl_lidar_acquire_next_scan(sl_lidar_t* lidar, uint64_t after_sequence, uint32_t timeout_ms, sl_lidar_scan_buffer_t** buffer);
+
+/// Copy the latest complete scan into a caller-owned array, see ILidarDriver::grabScanDataHqWithTimeStamp
+SL_LIDAR_C_API sl_result sl_lidar_grab_scan(sl_lidar_t* lidar, sl_lidar_response_measurement_node_hq_t* nodes, size_t* count, uint64_t* timestamp_us, uint32_t timeout_ms);
+
+/// size is sizeof the struct as known by the caller, only that much is filled
+SL_LIDAR_C_API sl_result sl_lidar_get_runtime_stats(sl_lidar_t* lidar, sl_lidar_runtime_stats_t* stats, size_t size);
+SL_LIDAR_C_API sl_result sl_lidar_get_memory_footprint(sl_lidar_t* lidar, sl_lidar_memory_footprint_t* footprint, size_t size);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,196 @@
+/*
+ *  Slamtec LIDAR SDK
+ *
+ *  Copyright (c) 2014 - 2023 Shanghai Slamtec Co., Ltd.
+ *  http://www.slamtec.com
+ *
+ */
+ /*
+  * Redistribution and use in source and binary forms, with or without
+  * modification, are permitted provided that the following conditions are met:
+  *
+  * 1. Redistributions of source code must retain the above copyright notice,
+  *    this list of conditions and the following disclaimer.
+  *
+  * 2. Redistributions in binary form must reproduce the above copyright notice,
+  *    this list of conditions and the following disclaimer in the documentation
+  *    and/or other materials provided with the distribution.
+  *
+  * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+  * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+  * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+  * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+  * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+  * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+  * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+  * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+  * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+  * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+  * EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+  *
+  */
+
+#pragma once
+
+#include "sl_lidar_driver.h"
+#include <atomic>
+#include <vector>
+
+namespace sl {
+
+    /**
+    * Planar pose of the vehicle (the base frame) in the odometry frame
+    *
+    * The position is in millimeter and the yaw in radian. The yaw turns in the same direction as the
+    * node angles, i.e. a positive yaw turns the x axis towards the y axis of projectScanToCartesian.
+    */
+    struct LidarPose2D
+    {
+        // on the clock of the scan timestamps (see getus)
+        sl_u64  timestamp_uS;
+
+        float   x;
+        float   y;
+        float   yaw;
+
+        LidarPose2D()
+            : timestamp_uS(0)
+            , x(0)
+            , y(0)
+            , yaw(0)
+        {
+        }
+
+        LidarPose2D(sl_u64 timestamp_uS, float x, float y, float yaw)
+            : timestamp_uS(timestamp_uS)
+            , x(x)
+            , y(y)
+            , yaw(yaw)
+        {
+        }
+    };
+
+    /**
+    * Fixed-size ring of timestamped poses fed by a single producer, e.g. the odometry or IMU thread
+    *
+    * push never blocks nor allocates. Any number of readers can look up the ring concurrently without
+    * holding the producer back: they copy the entries they need and retry if the producer overwrote
+    * them in the meantime. The poses must be pushed in increasing timestamp order.
+    */
+    class LidarPoseRing
+    {
+    public:
+        /// The capacity is rounded up to a power of two, it should hold the poses of a few scans
+        explicit LidarPoseRing(size_t capacity = 1024);
+
+        size_t capacity() const { return _entries.size(); }
+
+        /// Append a pose, the oldest one is overwritten once the ring is full
+        void push(const LidarPose2D& pose);
+
+        /// Discard all the poses, it must not be called concurrently with push
+        void clear();
+
+        /// Number of poses pushed since the ring was created or cleared
+        sl_u64 getPushedCount() const { return _head.load(std::memory_order_acquire); }
+
+        /// The latest pose, false if there is none
+        bool getLatest(LidarPose2D& pose) const;
+
+        /// Copy the poses from the latest one older than (or at) begin_uS to the oldest one newer than (or at) end_uS,
+        /// oldest first, fewer if the ring does not reach that far on either side.
+        /// \return false if there is no pose at all
+        bool copySpan(sl_u64 begin_uS, sl_u64 end_uS, std::vector<LidarPose2D>& out) const;
+
+        /// The pose at timestamp_uS, interpolated linearly between the surrounding poses
+        /// \return false if timestamp_uS is not between the oldest and the latest pose of the ring
+        bool interpolate(sl_u64 timestamp_uS, LidarPose2D& pose) const;
+
+    private:
+        std::vector<LidarPose2D> _entries;
+        size_t                   _mask;
+        // count of the poses pushed, the latest one is _entries[(_head - 1) & _mask]
+        std::atomic<sl_u64>      _head;
+        // count of the poses whose copy into the ring has started, ahead of _head during a push
+        std::atomic<sl_u64>      _claimed;
+    };
+
+    /**
+    * Options of LidarScanDeskewer
+    */
+    struct LidarDeskewOptions
+    {
+        // pose of the LIDAR in the base frame (millimeter, radian), as LidarPose2D
+        float   mountX;
+        float   mountY;
+        float   mountYaw;
+
+        // how far (in microseconds) the poses may be extrapolated beyond the latest pose or before the oldest one,
+        // e.g. to cover the end of a scan when the pose feed lags behind
+        sl_u32  maxExtrapolation_uS;
+
+        LidarDeskewOptions()
+            : mountX(0)
+            , mountY(0)
+            , mountYaw(0)
+            , maxExtrapolation_uS(20000)
+        {
+        }
+    };
+
+    /**
+    * Motion compensation of the scans with the poses of a LidarPoseRing
+    *
+    * Every node is sampled at its own time (interpolated between the first and the last node timestamp of the scan).
+    * The deskewer places each node with the pose of the vehicle at that time and expresses the whole scan in cartesian
+    * coordinates (in millimeter) of the base frame at a single reference time, by default the time of the last node.
+    * The poses are interpolated linearly between the entries of the ring and the inner loop uses SSE2/AVX2
+    * (selected at runtime) or NEON instructions when available.
+    *
+    * A deskewer keeps some working buffers, use one per thread. Several deskewers can share a pose ring.
+    */
+    class LidarScanDeskewer
+    {
+    public:
+        explicit LidarScanDeskewer(const LidarPoseRing& poses, const LidarDeskewOptions& options = LidarDeskewOptions());
+
+        void setOptions(const LidarDeskewOptions& options) { _options = options; }
+        const LidarDeskewOptions& getOptions() const { return _options; }
+
+        /**
+        * Deskew a scan into the caller provided x and y buffers of at least count elements
+        * The nodes keep their index, an invalid node (0 distance) is placed at the position of the LIDAR.
+        *
+        * \param firstTimestamp_uS      Time of the first node
+        * \param lastTimestamp_uS       Time of the last node
+        * \param referenceTimestamp_uS  Time of the base frame of the output, 0 for lastTimestamp_uS
+        * \param referencePose          Optional, receives the pose of the base frame of the output
+        * \return SL_RESULT_OPERATION_TIMEOUT if the poses do not reach the end of the scan yet,
+        *         SL_RESULT_OPERATION_FAIL if the ring does not hold the poses of the beginning of the scan anymore
+        */
+        sl_result deskew(const sl_lidar_response_measurement_node_hq_t* nodes, size_t count, sl_u64 firstTimestamp_uS, sl_u64 lastTimestamp_uS,
+            float* x, float* y, sl_u64 referenceTimestamp_uS = 0, LidarPose2D* referencePose = NULL);
+
+        /// Same as above for a leased scan
+        sl_result deskew(const LidarScanLease& lease, float* x, float* y, sl_u64 referenceTimestamp_uS = 0, LidarPose2D* referencePose = NULL)
+        {
+            return deskew(lease.nodes, lease.count, lease.timestamp_uS, lease.endTimestamp_uS, x, y, referenceTimestamp_uS, referencePose);
+        }
+
+    private:
+        // the transform from the LIDAR frame into the reference base frame at the time of a pose
+        struct Transform
+        {
+            double  timestamp_uS;
+            double  x;
+            double  y;
+            double  angle;
+        };
+
+        const LidarPoseRing&     _poses;
+        LidarDeskewOptions       _options;
+        std::vector<LidarPose2D> _span;
+        std::vector<Transform>   _transforms;
+    };
+
+}
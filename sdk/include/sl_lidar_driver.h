@@ -38,6 +38,8 @@
 #include <vector>
 #include <map>
 #include <string>
+#include <functional>
+#include <string.h>
 
 #ifndef DEPRECATED
     #ifdef __GNUC__
@@ -52,6 +54,9 @@
 
 
 #include "sl_lidar_cmd.h"
+#include "sl_lidar_scanframe.h"
+#include "sl_lidar_binnedscan.h"
+#include "sl_lidar_lines.h"
 
 #include <string>
 
@@ -226,6 +231,50 @@ namespace sl {
         */
         virtual int read(void* buffer, size_t size) = 0;
 
+        /**
+        * Wait for some data and read what is available into the buffer
+        * It saves a round of system calls per read for the channels which can read and wait at once.
+        * \param buffer The buffer to receive data
+        * \param size The size of the read buffer
+        * \param received [out] Bytes read, may be 0 even if RESULT_OK is returned
+        * \param timeoutInMs Wait timeout (in milliseconds, -1 for forever)
+        * \return Same as waitForDataExt
+        */
+        virtual sl_result waitAndRead(void* buffer, size_t size, size_t& received, sl_u32 timeoutInMs = 1000)
+        {
+            size_t sizeHint = 0;
+            received = 0;
+
+            sl_result ans = waitForDataExt(sizeHint, timeoutInMs);
+            if (SL_IS_FAIL(ans)) return ans;
+            if (!sizeHint) return SL_RESULT_OK;
+
+            int rxSize = read(buffer, sizeHint < size ? sizeHint : size);
+            if (rxSize <= 0) return SL_RESULT_OPERATION_FAIL;
+
+            received = (size_t)rxSize;
+            return SL_RESULT_OK;
+        }
+
+        /**
+        * Receive time of the oldest data returned by the last waitAndRead
+        * \return Timestamp in microseconds (the time base of getus()), 0 if the channel cannot tell
+        */
+        virtual sl_u64 getLastRxTimestamp() { return 0; }
+
+        /**
+        * Tell the channel the memory block the following waitAndRead calls will receive into (e.g. the rx ring
+        * of the driver), so it can be prepared for the kernel once instead of on every read.
+        * The block stays valid until close(), a buffer outside of it may still be given to waitAndRead.
+        */
+        virtual void registerRxBuffer(void* buffer, size_t size) {}
+
+        /**
+        * Wake up a waitAndRead blocked in another thread, it returns RESULT_OPERATION_TIMEOUT right away.
+        * Called by the driver before it joins its rx thread to close the channel.
+        */
+        virtual void cancelOperation() {}
+
         /**
         * Clear read cache
         */
@@ -233,6 +282,12 @@ namespace sl {
 
         virtual int getChannelType() = 0;
 
+        /**
+        * Get the OS handle (file descriptor) which can be watched by a poller like epoll
+        * \return -1 if the channel cannot be polled, it will be serviced by dedicated threads then
+        */
+        virtual int getPollableHandle() { return -1; }
+
     private:
 
     };
@@ -259,6 +314,31 @@ namespace sl {
     */
     Result<IChannel*> createSerialPortChannel(const std::string& device, int baudrate);
 
+    /**
+    * Tuning of a serial channel, the defaults match createSerialPortChannel(device, baudrate)
+    */
+    struct SerialPortChannelOptions
+    {
+        // Ask the serial driver to deliver the received bytes immediately (ASYNC_LOW_LATENCY on Linux).
+        // It removes the 1-16ms latency timer of FTDI adapters at the cost of more USB transfers and wakeups.
+        bool    lowLatency;
+
+        // Let about this many bytes arrive before the receiving thread wakes up (0 to wake up on every byte).
+        // The extra latency is bounded by the time the bytes take on the wire, e.g. 256 bytes at 1Mbps is 2.5ms.
+        sl_u32  rxBatchThreshold;
+
+        SerialPortChannelOptions()
+            : lowLatency(false)
+            , rxBatchThreshold(0)
+        {
+        }
+    };
+
+    /**
+    * Create a serial channel with the given tuning, see SerialPortChannelOptions
+    */
+    Result<IChannel*> createSerialPortChannel(const std::string& device, int baudrate, const SerialPortChannelOptions& options);
+
     /**
     * Create a TCP channel
     * \param ip IP address of the device
@@ -273,6 +353,256 @@ namespace sl {
     */
     Result<IChannel*> createUdpChannel(const std::string& ip, int port);
 
+    /**
+    * Tuning of a UDP channel, the defaults match createUdpChannel(ip, port)
+    */
+    struct UdpChannelOptions
+    {
+        // Size of the kernel receive buffer (SO_RCVBUF) in bytes, 0 to keep the system default.
+        // A bigger buffer rides out longer stalls of the receiving thread before the datagrams get dropped.
+        sl_u32  rxBufferSize;
+
+        // The largest datagram expected from the device, the pending datagrams are received in a batch
+        // with this much room left for each. A larger datagram is received whole only when it is the first
+        // of a batch, later in a batch it gets truncated.
+        sl_u32  maxDatagramSize;
+
+        // Stamp the datagrams with the kernel receive time (SO_TIMESTAMPNS on Linux), so the arrival time
+        // excludes the scheduling delay of the receiving thread.
+        bool    rxTimestamp;
+
+        UdpChannelOptions()
+            : rxBufferSize(0)
+            , maxDatagramSize(1500)
+            , rxTimestamp(false)
+        {
+        }
+    };
+
+    /**
+    * Create a UDP channel with the given tuning, see UdpChannelOptions
+    */
+    Result<IChannel*> createUdpChannel(const std::string& ip, int port, const UdpChannelOptions& options);
+
+    /**
+    * Create a channel replaying a raw byte stream captured by ILidarDriver::startRawCapture
+    * The commands sent to it are dropped, so the capture should have been started before the
+    * driver was connected for the replay to contain the answers the driver expects.
+    * \param path The capture file
+    * \param speed Replay speed relative to the capture, e.g. 1 for real-time, 4 for 4x,
+    *              0 (or negative) for as fast as possible
+    */
+    Result<IChannel*> createReplayChannel(const std::string& path, float speed = 1.0f);
+
+    /**
+    * Create a channel receiving the data of a serial or TCP channel through io_uring (Linux)
+    * Waiting for and reading a chunk is a single system call with the read completing straight into the
+    * rx ring of the driver, instead of a wait and a read. Everything else is passed to the given channel.
+    * The channel is serviced by its own receiving thread, an IOReactor given to the driver is not used for it.
+    * Only available if the SDK is built with SL_LIDAR_IO_URING defined (Linux 5.6 or later).
+    * \param channel The serial or TCP channel to wrap, it is owned (and deleted) by the new channel on success
+    * \return SL_RESULT_OPERATION_NOT_SUPPORT if io_uring is not built in or not available in the kernel,
+    *         the given channel is left to the caller then and can be used as it is
+    */
+    Result<IChannel*> createIoUringChannel(IChannel* channel);
+
+    enum LidarThreadSchedPolicy
+    {
+        // SCHED_RR at its lowest priority if the process is permitted, otherwise left unchanged
+        LIDAR_THREAD_SCHED_DEFAULT = 0,
+        LIDAR_THREAD_SCHED_OTHER = 1,
+        LIDAR_THREAD_SCHED_FIFO = 2,
+        LIDAR_THREAD_SCHED_RR = 3,
+    };
+
+    /**
+    * Scheduling, cpu affinity and name of a thread run by the SDK
+    */
+    struct LidarThreadConfig
+    {
+        LidarThreadSchedPolicy policy;
+
+        // static priority for LIDAR_THREAD_SCHED_FIFO and LIDAR_THREAD_SCHED_RR (1..99 on Linux),
+        // nice value for LIDAR_THREAD_SCHED_OTHER, ignored by LIDAR_THREAD_SCHED_DEFAULT
+        int priority;
+
+        // bit n allows the thread to run on cpu n (0 to leave the affinity unchanged)
+        sl_u64 cpuAffinityMask;
+
+        // shown by top, perf and ftrace (empty for the SDK default name), at most 15 characters are kept on Linux
+        char name[16];
+
+        LidarThreadConfig()
+            : policy(LIDAR_THREAD_SCHED_DEFAULT)
+            , priority(0)
+            , cpuAffinityMask(0)
+        {
+            name[0] = '\0';
+        }
+    };
+
+    /**
+    * Shared I/O reactor
+    * Without a reactor, every connected driver runs its own rx thread and decoder thread.
+    * Drivers connected through the same reactor share a few epoll loops for receiving and a
+    * worker pool for decoding instead.
+    * The reactor must outlive all the drivers connected through it
+    */
+    class ILidarIOReactor
+    {
+    public:
+        virtual ~ILidarIOReactor() {}
+
+    public:
+        virtual size_t getIOThreadCount() const = 0;
+        virtual size_t getDecodeWorkerCount() const = 0;
+
+        /**
+        * Number of channels currently serviced by the reactor
+        */
+        virtual size_t getAttachedChannelCount() = 0;
+    };
+
+    /**
+    * Create a shared I/O reactor (only supported on Linux)
+    * \param ioThreadCount Number of epoll loops, channels are distributed among them
+    * \param decodeWorkerCount Number of threads decoding the received data
+    */
+    Result<ILidarIOReactor*> createLidarIOReactor(size_t ioThreadCount = 1, size_t decodeWorkerCount = 2);
+
+    /**
+    * Create a shared I/O reactor whose threads are configured as given
+    * When several threads share a config, their names are suffixed with the thread index.
+    */
+    Result<ILidarIOReactor*> createLidarIOReactor(size_t ioThreadCount, size_t decodeWorkerCount,
+        const LidarThreadConfig& ioThreadConfig, const LidarThreadConfig& decodeWorkerConfig);
+
+    /**
+    * Reconnection of the driver after a channel error, see LidarConnectOptions::reconnectPolicy
+    *
+    * The driver reopens the channel by itself (on a thread of its own) and restores what the application had set up:
+    * the baudrate negotiated by negotiateSerialBaudRate, the scan mode started last and the motor speed set after it.
+    * The scans keep going into the same scan history, so the leases, the sequence numbers and the callbacks carry on.
+    * The driver stays connected in the meantime, the commands fail until the channel is back.
+    */
+    struct LidarReconnectPolicy
+    {
+        bool    enabled;
+
+        // wait before the first attempt (in ms), doubled after every failed attempt up to maxBackoff
+        sl_u32  initialBackoff;
+        sl_u32  maxBackoff;
+
+        // failed attempts before the driver gives up and disconnects, 0 to keep trying until disconnect is called
+        sl_u32  maxAttempts;
+
+        LidarReconnectPolicy()
+            : enabled(false)
+            , initialBackoff(10)
+            , maxBackoff(2000)
+            , maxAttempts(0)
+        {
+        }
+    };
+
+    /**
+    * Memory budget of the driver, see LidarConnectOptions::memoryProfile
+    *
+    * With a budget, connect allocates a single block of exactly that many bytes and touches it, so the footprint of
+    * the driver is fixed and resident from then on. Its rx queue, its scan slots, the interval sample queue (with
+    * LidarConnectOptions::queueIntervalSamples) and the slice buffer are carved from it instead of the default sizes.
+    * The rx queue takes the largest power of two up to a quarter of the budget. Every scan mode started gets scan slots
+    * of 1000000 / (us_per_sample * minScanFrequency) nodes plus 1/8 of margin, as far as the rest of the budget allows;
+    * the nodes beyond are counted by LidarRuntimeStats::truncatedScanNodeCount. See ILidarDriver::getMemoryFootprint.
+    */
+    struct LidarMemoryProfile
+    {
+        // in bytes, 0 for the default fixed sizes (about 600KB per driver)
+        size_t  budget;
+
+        // the slowest rotation expected (in Hz), it gives the nodes of the longest scan
+        float   minScanFrequency;
+
+        LidarMemoryProfile()
+            : budget(0)
+            , minScanFrequency(5.f)
+        {
+        }
+    };
+
+    /**
+    * Per-connection options, see ILidarDriver::connect
+    */
+    struct LidarConnectOptions
+    {
+        // service the channel by this reactor instead of dedicated threads (NULL to disable)
+        // channels that cannot be polled will fall back to dedicated threads
+        ILidarIOReactor* reactor;
+
+        // queue the decoded nodes for getScanDataWithIntervalHq right from the start,
+        // otherwise the queue is only filled after its first call
+        bool queueIntervalSamples;
+
+        // number of latest complete scans kept for acquireNextScan and acquireRecentScans (0 for the default of 3),
+        // each one takes a preallocated buffer of 8192 nodes
+        size_t scanHistoryDepth;
+
+        // timeout of the queries made by connect to detect the motor control support,
+        // a short one makes probing a serial port at the wrong baudrate cheaper
+        sl_u32 probeTimeout;
+
+        // upper bound of the wait for the first sample packet after a scan command (in ms),
+        // startScan returns as soon as the device starts streaming
+        sl_u32 scanStartTimeout;
+
+        // upper bound of the wait for the sample stream to go quiet after the stop command (in ms)
+        sl_u32 stopTimeout;
+
+        // time given to the device to apply a motor speed command (in ms),
+        // it only delays the next command sent within this period
+        sl_u32 motorCommandGuardTime;
+
+        // decode the data on the rx thread right after it is read, saving the handoff to the decoder
+        // thread on every read. The callbacks run on the rx thread then, a slow one delays the reads.
+        // Ignored when the channel is serviced by a reactor
+        bool inlineDecoding;
+
+        // stamp the nodes by a model of the device sample clock fitted to the arrival of the data,
+        // giving smooth and monotonic timestamps free of the scheduling jitter.
+        // Otherwise every node is stamped by the host time it was decoded at minus a fixed delay
+        bool deviceClockModel;
+
+        // decode the samples of the started scan mode by an unpacker compiled for its answer type,
+        // resolving the packet dispatch and the node publishing at compile time instead of per packet
+        bool specializedDecoding;
+
+        // the threads receiving from and decoding the channel, unused when it is serviced by a reactor
+        // (there is no decoder thread with inlineDecoding)
+        LidarThreadConfig rxThreadConfig;
+        LidarThreadConfig decoderThreadConfig;
+
+        // reopen the channel and resume the scan after a channel error, e.g. a USB brownout or a network flap
+        LidarReconnectPolicy reconnectPolicy;
+
+        // allocate every buffer of the driver in one block of a fixed size, e.g. on a board short of memory.
+        // connect fails with SL_RESULT_INSUFFICIENT_MEMORY if the budget is too small for the smallest setup
+        LidarMemoryProfile memoryProfile;
+
+        LidarConnectOptions()
+            : reactor(NULL)
+            , queueIntervalSamples(false)
+            , scanHistoryDepth(0)
+            , probeTimeout(500)
+            , scanStartTimeout(10)
+            , stopTimeout(100)
+            , motorCommandGuardTime(10)
+            , inlineDecoding(false)
+            , deviceClockModel(true)
+            , specializedDecoding(false)
+        {
+        }
+    };
+
     enum MotorCtrlSupport
     {
         MotorCtrlSupportNone = 0,
@@ -280,10 +610,42 @@ namespace sl {
         MotorCtrlSupportRpm = 2,
     };
 
+    /**
+    * What the driver has to query from a device before scanning, see ILidarDriver::getCapabilityProfile
+    * It can be saved (see sl_lidar_fastconnect.h) and handed back to setCapabilityProfile on the next startup.
+    */
+    struct LidarCapabilityProfile
+    {
+        // the device the profile belongs to
+        sl_u8   serialnum[16];
+        sl_u8   model;
+        sl_u16  firmware_version;
+        sl_u8   hardware_version;
+
+        MotorCtrlSupport motorCtrlSupport;
+        bool    supportConfigCommands;
+        sl_u16  typicalScanMode;
+
+        // as returned by getAllSupportedScanModes, empty for the devices without configuration commands
+        std::vector<LidarScanMode> scanModes;
+
+        LidarCapabilityProfile()
+            : model(0)
+            , firmware_version(0)
+            , hardware_version(0)
+            , motorCtrlSupport(MotorCtrlSupportNone)
+            , supportConfigCommands(false)
+            , typicalScanMode(0)
+        {
+            memset(serialnum, 0, sizeof(serialnum));
+        }
+    };
+
     enum ChannelType{
         CHANNEL_TYPE_SERIALPORT = 0x0,
         CHANNEL_TYPE_TCP = 0x1,
         CHANNEL_TYPE_UDP = 0x2,
+        CHANNEL_TYPE_REPLAY = 0x3,
     };
 
         /**
@@ -303,6 +665,294 @@ namespace sl {
         sl_u16 min_speed;
     };
 
+    /**
+    * A read-only complete scan borrowed from the driver without copying, see ILidarDriver::acquireScan
+    */
+    struct LidarScanLease
+    {
+        // Scan nodes, only valid before the lease is released
+        const sl_lidar_response_measurement_node_hq_t* nodes;
+
+        // Node count of the scan
+        size_t  count;
+
+        // Timestamp of the first node of the scan (in microseconds)
+        sl_u64  timestamp_uS;
+
+        // Timestamp of the last node of the scan (in microseconds), the nodes in between are evenly spaced in time
+        sl_u64  endTimestamp_uS;
+
+        // Counts the complete scans of the driver from 1, a gap between two leases tells how many scans were missed
+        sl_u64  sequence;
+
+        // Used by the driver to identify the lease
+        sl_s32  handle;
+
+        LidarScanLease()
+            : nodes(NULL)
+            , count(0)
+            , timestamp_uS(0)
+            , endTimestamp_uS(0)
+            , sequence(0)
+            , handle(-1)
+        {
+        }
+    };
+
+    /**
+    * How the revolutions are cut into slices, see ILidarDriver::setSliceCallback
+    * A slice is published as soon as the next node falls beyond either limit, the last one of a revolution
+    * when the next revolution starts
+    */
+    struct LidarSliceConfig
+    {
+        // Angular width of the slices (in degree) counted from 0, e.g. 30 for 12 slices per revolution, 0 to cut by the node count only
+        float   sliceAngle_deg;
+
+        // Max nodes of a slice, 0 to cut by the angle only
+        size_t  maxSliceNodes;
+
+        LidarSliceConfig()
+            : sliceAngle_deg(30)
+            , maxSliceNodes(0)
+        {
+        }
+    };
+
+    /**
+    * Which decoded nodes the driver keeps, see ILidarDriver::setAcquisitionFilter
+    * A node is kept if it falls within one of the angular ranges (any angle without a range), its quality reaches
+    * minQuality and it is the decimation-th of the nodes passing so far in its revolution. When the SYNCBIT node of
+    * a revolution is discarded the flag is carried over to the next node kept, so the scans start as usual.
+    */
+    struct LidarAcquisitionFilter
+    {
+        enum {
+            MAX_RANGE_COUNT = 4,
+        };
+
+        // Angular ranges (in degree) going from startAngle up to endAngle, across 0 degree if endAngle is below
+        // startAngle, e.g. 300 to 60 for the forward 120 degrees
+        float   startAngle[MAX_RANGE_COUNT];
+        float   endAngle[MAX_RANGE_COUNT];
+        size_t  rangeCount;
+
+        // Keep one node out of decimation, counted from the start of every revolution (1 to keep them all)
+        sl_u32  decimation;
+
+        // The lowest sl_lidar_response_measurement_node_hq_t::quality kept, 0 to keep the nodes without a measurement
+        sl_u8   minQuality;
+
+        LidarAcquisitionFilter()
+            : rangeCount(0)
+            , decimation(1)
+            , minQuality(0)
+        {
+            for (size_t pos = 0; pos < MAX_RANGE_COUNT; ++pos) {
+                startAngle[pos] = 0;
+                endAngle[pos] = 0;
+            }
+        }
+
+        sl_result addRange(float fromAngle, float toAngle)
+        {
+            if (rangeCount >= MAX_RANGE_COUNT) return SL_RESULT_INSUFFICIENT_MEMORY;
+            startAngle[rangeCount] = fromAngle;
+            endAngle[rangeCount] = toAngle;
+            ++rangeCount;
+            return SL_RESULT_OK;
+        }
+    };
+
+    /**
+    * A part of a revolution published before the revolution is complete, see ILidarDriver::setSliceCallback
+    */
+    struct LidarScanSlice
+    {
+        // Slice nodes in the order received, only valid during the callback
+        const sl_lidar_response_measurement_node_hq_t* nodes;
+        size_t  count;
+
+        // Timestamps of the first and the last node of the slice (in microseconds)
+        sl_u64  timestamp_uS;
+        sl_u64  endTimestamp_uS;
+
+        // Counts the slices from 1
+        sl_u64  sequence;
+
+        // Counts the revolutions from 1, every slice of a revolution carries the same value
+        sl_u64  revolution;
+
+        // Position of the slice in its revolution from 0, and whether it is the last one
+        sl_u32  index;
+        bool    lastOfRevolution;
+
+        // Angles of the first and the last node of the slice (in degree)
+        float   startAngle_deg;
+        float   endAngle_deg;
+    };
+
+    /**
+    * The buffers of a driver, see ILidarDriver::getMemoryFootprint
+    */
+    struct LidarMemoryFootprint
+    {
+        // The block carved by the buffers with a memory budget (see LidarMemoryProfile), 0 otherwise
+        size_t  arenaBytes;
+
+        // The queue of the received bytes waiting for the decoder
+        size_t  rxQueueBytes;
+
+        // The scan slots: scanSlotCount scans (the history and the one being filled) of up to scanNodeCapacity nodes
+        size_t  scanCacheBytes;
+        size_t  scanSlotCount;
+        size_t  scanNodeCapacity;
+
+        // The queue of getScanDataWithIntervalHq, 0 until it is used
+        size_t  intervalSampleQueueBytes;
+
+        // The slice being assembled for the slice callback
+        size_t  sliceBufferBytes;
+
+        // The whole arena plus the buffers allocated out of it. Everything is resident with a memory budget,
+        // otherwise the pages of the buffers are only resident once they have been filled
+        size_t  totalBytes;
+    };
+
+    /**
+    * Counters of the receiving pipeline since the driver was created, see ILidarDriver::getRuntimeStats
+    */
+    struct LidarRuntimeStats
+    {
+        // Bytes read from the channel
+        sl_u64  rxBytes;
+
+        // Bytes discarded because the decoder could not keep up and the rx queue was full, and the number of reads affected
+        sl_u64  rxOverflowBytes;
+        sl_u32  rxOverflowCount;
+
+        // Protocol packets decoded and the ones carrying measurement samples
+        sl_u64  packetCount;
+        sl_u64  samplePacketCount;
+
+        // Measurement packets rejected due to a checksum (CRC) mismatch
+        sl_u32  checksumErrorCount;
+
+        // Other errors reported while unpacking the samples, e.g. an unexpected encoder reset
+        sl_u32  decodingErrorCount;
+
+        // Measurement nodes decoded and complete scans published
+        sl_u64  nodeCount;
+        sl_u64  scanCount;
+
+        // Complete scans discarded because every scan buffer was borrowed by the application
+        sl_u32  droppedScanCount;
+
+        // Nodes which replaced the last node of a scan exceeding the scan buffer
+        sl_u64  truncatedScanNodeCount;
+
+        // Nodes discarded from the sample queue of getScanDataWithIntervalHq before being fetched
+        sl_u64  droppedSampleNodeCount;
+
+        // Decoded nodes discarded by the acquisition filter (see ILidarDriver::setAcquisitionFilter), they are part of nodeCount
+        sl_u64  filteredNodeCount;
+
+        // Sample period of the current scan mode estimated by the device clock model, its drift from the period
+        // reported by the device (which is rounded to 1us) and the times the model lost track of the sample stream,
+        // see LidarConnectOptions::deviceClockModel
+        float   samplePeriod_uS;
+        float   sampleClockDrift_ppm;
+        sl_u32  sampleClockResyncCount;
+
+        // Channel errors, the recoveries of the reconnect policy and its failed attempts, see LidarReconnectPolicy
+        sl_u32  channelErrorCount;
+        sl_u32  reconnectCount;
+        sl_u32  reconnectFailureCount;
+
+        // Time from the latest channel error to the restored stream and the time spent without a working channel
+        // (in microseconds), the outage in progress included
+        sl_u64  lastRecoveryTime_uS;
+        sl_u64  totalDowntime_uS;
+    };
+
+    /**
+    * Latency distribution of one stage of the receiving pipeline (in microseconds), see ILidarDriver::getLatencyStats
+    */
+    struct LidarLatencyHistogram
+    {
+        // Number of samples recorded
+        sl_u64  count;
+
+        // Median, 99th percentile and the worst case, the percentiles are accurate within 1/8 of their value
+        sl_u32  p50_uS;
+        sl_u32  p99_uS;
+        sl_u32  max_uS;
+    };
+
+    /**
+    * Latency of the data through the driver, measured from the moment the bytes were read from the channel
+    */
+    struct LidarLatencyStats
+    {
+        // Until the bytes are taken out of the rx queue by the decoder
+        LidarLatencyHistogram rxQueue;
+
+        // Until the nodes carried by the bytes are decoded (recorded once per decoded batch)
+        LidarLatencyHistogram nodeDecode;
+
+        // Until the scan completed by the bytes is published
+        LidarLatencyHistogram scanSwap;
+
+        // Until the scan is handed over to the application by grabScanDataHq*, grabScanFrame, acquireScan or the scan callback
+        LidarLatencyHistogram scanGrab;
+
+        // Bytes waiting in the rx queue, the peak since the last reset and the queue size
+        size_t  rxQueueDepth;
+        size_t  rxQueueDepthMax;
+        size_t  rxQueueCapacity;
+
+        // Scans currently borrowed by the application through acquireScan
+        size_t  leasedScanCount;
+    };
+
+    /**
+    * Invoked when a complete 0-360 degree scan has been received, see ILidarDriver::setScanCallback
+    * The nodes are only valid during the call
+    */
+    typedef std::function<void(const sl_lidar_response_measurement_node_hq_t* nodes, size_t count, sl_u64 timestamp_uS)> LidarScanCallback;
+
+    /**
+    * Invoked for every decoded measurement node, see ILidarDriver::setNodeCallback
+    */
+    typedef std::function<void(const sl_lidar_response_measurement_node_hq_t& node, sl_u64 timestamp_uS)> LidarNodeCallback;
+
+    /**
+    * Invoked with every slice of a revolution as soon as it is complete, see ILidarDriver::setSliceCallback
+    */
+    typedef std::function<void(const LidarScanSlice& slice)> LidarSliceCallback;
+
+    /**
+    * Invoked with every complete scan (sorted by angle) and the line segments extracted from it, see ILidarDriver::setLineCallback
+    * The nodes and the segments are only valid during the call, the segment indices refer to the nodes
+    */
+    typedef std::function<void(const sl_lidar_response_measurement_node_hq_t* nodes, size_t count, sl_u64 timestamp_uS,
+        const LidarLineSegment* segments, size_t segmentCount)> LidarLineCallback;
+
+    /**
+    * Invoked with the answer of a command queued by ILidarDriver::sendCommandAsync, the payload is only valid during the call
+    * The result is SL_RESULT_OPERATION_TIMEOUT if no answer arrived in time
+    */
+    typedef std::function<void(sl_result result, const sl_u8* payload, size_t size)> LidarCommandCallback;
+
+    /**
+    * Invoked with the answer of ILidarDriver::getHealthAsync and getDeviceInfoAsync, the answer is only meaningful if the result is SL_RESULT_OK
+    */
+    typedef std::function<void(sl_result result, const sl_lidar_response_device_health_t& health)> LidarHealthCallback;
+    typedef std::function<void(sl_result result, const sl_lidar_response_device_info_t& info)> LidarDeviceInfoCallback;
+
+    class ILidarScanPublisher;
+    class ILidarSafetyMonitor;
+
     class ILidarDriver
     {
     public:
@@ -316,6 +966,13 @@ namespace sl {
         */
         virtual sl_result connect(IChannel* channel) = 0;
 
+        /**
+        * Connect to LIDAR via channel with extra options
+        * \param channel The communication channel
+        * \param options The connection options, e.g. the shared I/O reactor to use
+        */
+        virtual sl_result connect(IChannel* channel, const LidarConnectOptions& options) = 0;
+
         /**
         * Disconnect from the LIDAR
         */
@@ -375,6 +1032,36 @@ namespace sl {
         /// \param timeout       The operation timeout value (in millisecond) for the serial port communication  
         virtual sl_result getDeviceInfo(sl_lidar_response_device_info_t& info, sl_u32 timeout = DEFAULT_TIMEOUT) = 0;
 
+        /// Get the device information taken by the last successful getDeviceInfo of this connection
+        /// (connect makes one), without querying the device.
+        ///
+        /// \return SL_RESULT_OPERATION_NOT_SUPPORT if the device has not answered it yet on this connection
+        virtual sl_result getCachedDeviceInfo(sl_lidar_response_device_info_t& info) = 0;
+
+        /// Queue a command and return at once, the callback is invoked from the driver's command thread with the answer.
+        /// The queued commands are sent one at a time in order, interleaved with the blocking calls of other threads,
+        /// and the answers are matched by their answer type.
+        ///
+        /// The answers share the link with the sample stream and cannot be told apart from it, so a command expecting
+        /// an answer is held while a scan is running (rather than stopping it) and sent once the scan is stopped.
+        /// The commands without an answer, e.g. the motor speed, are not held by a scan, though they still wait
+        /// behind the commands queued before them.
+        /// Do not start or stop a scan this way, and do not disconnect or release the driver from the callback.
+        ///
+        /// \param cmd            The command to send
+        /// \param answerType     The answer type to wait for, 0 if the command has no answer
+        /// \param payload        The payload of the command (copied), NULL if it has none
+        /// \param payloadSize    Size of the payload
+        /// \param callback       Invoked once with the answer or the failure
+        /// \param timeout        Max duration (in millisecond) from now on to wait for the answer, including the time held
+        virtual sl_result sendCommandAsync(sl_u8 cmd, sl_u8 answerType, const void* payload, size_t payloadSize, const LidarCommandCallback& callback, sl_u32 timeout = DEFAULT_TIMEOUT) = 0;
+
+        /// Non-blocking getHealth, see sendCommandAsync
+        virtual sl_result getHealthAsync(const LidarHealthCallback& callback, sl_u32 timeout = DEFAULT_TIMEOUT) = 0;
+
+        /// Non-blocking getDeviceInfo, see sendCommandAsync
+        virtual sl_result getDeviceInfoAsync(const LidarDeviceInfoCallback& callback, sl_u32 timeout = DEFAULT_TIMEOUT) = 0;
+
         /// Check whether the device support motor control
         /// Note: this API will disable grab.
         /// 
@@ -382,6 +1069,21 @@ namespace sl {
         /// \param timeout          The operation timeout value (in millisecond) for the serial port communication. 
         virtual sl_result checkMotorCtrlSupport(MotorCtrlSupport& motorCtrlSupport, sl_u32 timeout = DEFAULT_TIMEOUT) = 0;
 
+        /// Query everything startScan needs to know about the device (scan modes and their sample durations,
+        /// typical scan mode, motor control support) and keep it for the connection. The later calls to
+        /// startScan, startScanExpress, getAllSupportedScanModes and getTypicalScanMode take it from there
+        /// instead of querying the device again. Note: this API will disable grab.
+        ///
+        /// \param profile          Return the result, the cached one if it is already known.
+        /// \param timeout          The operation timeout value (in millisecond) of each query.
+        virtual sl_result getCapabilityProfile(LidarCapabilityProfile& profile, sl_u32 timeout = DEFAULT_TIMEOUT) = 0;
+
+        /// Use a profile returned by getCapabilityProfile earlier (e.g. in a previous run) instead of querying the device.
+        /// It only applies to the current connection.
+        ///
+        /// \return SL_RESULT_INVALID_DATA if the profile does not match the serial number, model and versions of the connected device
+        virtual sl_result setCapabilityProfile(const LidarCapabilityProfile& profile) = 0;
+
         /// Calculate LIDAR's current scanning frequency from the given scan data
         /// Please refer to the application note doc for details
         /// Remark: the calcuation will be incorrect if the specified scan data doesn't contains enough data
@@ -466,6 +1168,149 @@ namespace sl {
         /// \The caller application can set the timeout value to Zero(0) to make this interface always returns immediately to achieve non-block operation.
         virtual sl_result grabScanDataHqWithTimeStamp(sl_lidar_response_measurement_node_hq_t* nodebuffer, size_t& count, sl_u64 & timestamp_uS, sl_u32 timeout = DEFAULT_TIMEOUT) = 0;
 
+        /// Wait and borrow the latest complete 0-360 degree scan without copying it.
+        /// The scan data has the same charactistics as the one returned by grabScanDataHqWithTimeStamp.
+        ///
+        /// The leased scan is read-only and stays unchanged until it is returned to the driver via releaseScan,
+        /// the decoding thread keeps receiving new scans in the meantime. Several leases can be held at a time, 
+        /// but the caller should release them as soon as possible: new scans will be dropped if all the internal buffers are leased.
+        ///
+        /// \param lease          The lease to fill, it must be released before the driver is disconnected or destroyed
+        ///
+        /// \param timeout        Max duration allowed to wait for a complete scan data
+        ///
+        /// The interface will return SL_RESULT_OPERATION_TIMEOUT to indicate that no complete 360-degrees' scan can be retrieved withing the given timeout duration. 
+        virtual sl_result acquireScan(LidarScanLease& lease, sl_u32 timeout = DEFAULT_TIMEOUT) = 0;
+
+        /// Borrow the oldest complete scan of the scan history newer than the given sequence number, wait for it if there is none yet.
+        /// Consumers passing the sequence of their previous lease see every scan as long as they keep up with the history
+        /// (see LidarConnectOptions::scanHistoryDepth), any scan missed shows as a gap between the sequence numbers.
+        ///
+        /// \param afterSequence  The sequence number of the last scan seen, 0 for the oldest scan of the history
+        ///
+        /// \param lease          The lease to fill, it must be released via releaseScan
+        ///
+        /// \param timeout        Max duration allowed to wait for the scan
+        ///
+        /// The interface will return SL_RESULT_OPERATION_TIMEOUT if no such scan arrives within the given timeout duration.
+        virtual sl_result acquireNextScan(sl_u64 afterSequence, LidarScanLease& lease, sl_u32 timeout = DEFAULT_TIMEOUT) = 0;
+
+        /// Borrow the latest complete scans of the scan history without waiting, the oldest one first, e.g. for temporal filtering.
+        /// Passing a single lease borrows the latest scan.
+        ///
+        /// \param leases         The leases to fill, each of them must be released via releaseScan
+        ///
+        /// \param count          The number of leases, once the interface returns, the number of scans borrowed
+        virtual sl_result acquireRecentScans(LidarScanLease* leases, size_t& count) = 0;
+
+        /// Return a scan previously borrowed via acquireScan. The lease is cleared once the interface returns.
+        virtual void releaseScan(LidarScanLease& lease) = 0;
+
+        /// Wait and grab a complete 0-360 degree scan into a structure-of-arrays frame.
+        /// The scan data has the same charactistics as the one returned by grabScanDataHqWithTimeStamp,
+        /// the angle and range are converted to degree and millimeter during the copy.
+        ///
+        /// \param frame          The frame to fill, its buffers only grow when the scan holds more nodes than its capacity.
+        ///                       Reuse the same frame to avoid any memory allocation.
+        ///
+        /// \param timeout        Max duration allowed to wait for a complete scan data, the frame is left untouched if a complete 360-degrees' scan data cannot to be ready timely.
+        ///
+        /// The interface will return SL_RESULT_OPERATION_TIMEOUT to indicate that no complete 360-degrees' scan can be retrieved withing the given timeout duration. 
+        virtual sl_result grabScanFrame(LidarScanFrame& frame, sl_u32 timeout = DEFAULT_TIMEOUT) = 0;
+
+        /// Wait and grab a complete 0-360 degree scan bucketed into the angular bins of a binned scan.
+        /// The scan data has the same charactistics as the one returned by grabScanDataHqWithTimeStamp.
+        ///
+        /// \param scan           The binned scan to fill, its bin count and policy are kept (see LidarBinnedScan::configure).
+        ///
+        /// \param timeout        Max duration allowed to wait for a complete scan data, the scan is left untouched if a complete 360-degrees' scan data cannot to be ready timely.
+        ///
+        /// The interface will return SL_RESULT_OPERATION_TIMEOUT to indicate that no complete 360-degrees' scan can be retrieved withing the given timeout duration. 
+        virtual sl_result grabBinnedScan(LidarBinnedScan& scan, sl_u32 timeout = DEFAULT_TIMEOUT) = 0;
+
+        /// Register a callback to be notified as soon as a complete 0-360 degree scan has been received.
+        /// It is an alternative to polling grabScanDataHq: the scan passed to the callback has the same charactistics
+        /// and the polling interfaces keep working as usual.
+        ///
+        /// The callback is invoked from the driver's decoding thread. It must return quickly and must not call 
+        /// any other interface of the driver except the polling ones, otherwise incoming data may be lost.
+        ///
+        /// \param callback       The callback to invoke, pass an empty callback to unregister the current one
+        virtual void setScanCallback(const LidarScanCallback& callback) = 0;
+
+        /// Register a callback to be notified of every decoded measurement node (including the ones of a partial scan).
+        /// The same constraints as setScanCallback apply.
+        ///
+        /// \param callback       The callback to invoke, pass an empty callback to unregister the current one
+        virtual void setNodeCallback(const LidarNodeCallback& callback) = 0;
+
+        /// Register a callback to be notified of the slices of every revolution as they fill, e.g. every 30 degrees,
+        /// so the processing of a sector can start without waiting for the rest of the scan.
+        /// The complete scans are still assembled and published as usual. The same constraints as setScanCallback apply.
+        ///
+        /// \param config         How the revolutions are cut into slices
+        /// \param callback       The callback to invoke, pass an empty callback to unregister the current one
+        virtual void setSliceCallback(const LidarSliceConfig& config, const LidarSliceCallback& callback) = 0;
+
+        /// Publish every complete scan into a shared memory ring so other processes can read it, see sl_lidar_shm.h
+        /// The scans are written from the driver's decoding thread, next to the scan callback.
+        ///
+        /// \param publisher      An opened publisher owned by the caller, pass NULL to stop publishing
+        virtual void setScanPublisher(ILidarScanPublisher* publisher) = 0;
+
+        /// Check every decoded packet against the protective fields of a safety monitor, see sl_lidar_safety.h
+        /// The nodes are evaluated in the driver's decoding thread before they are appended to the current scan,
+        /// so an intrusion is reported within the packet carrying it.
+        ///
+        /// \param monitor        A monitor owned by the caller, pass NULL to stop monitoring
+        virtual void setSafetyMonitor(ILidarSafetyMonitor* monitor) = 0;
+
+        /// Extract the line segments of every complete scan and hand them to a callback along with the scan, see sl_lidar_lines.h
+        /// The scan is sorted as by ascendScanData and the extraction runs in the driver's decoding thread, next to the scan callback.
+        ///
+        /// \param extractor      An extractor owned by the caller and not used elsewhere, pass NULL to stop the extraction
+        /// \param callback       The callback to invoke
+        virtual void setLineCallback(LidarLineExtractor* extractor, const LidarLineCallback& callback) = 0;
+
+        /// Discard the decoded nodes out of an angular region of interest, beyond a decimation or below a quality
+        /// right as they are unpacked, before they are stored. The scans, the slices, the node callback and
+        /// getScanDataWithIntervalHq only see the nodes kept, the safety monitor still checks every node.
+        /// With a memory budget the scan modes started afterwards get scan slots sized for the share of the nodes kept.
+        ///
+        /// \param filter         The nodes to keep, a default LidarAcquisitionFilter keeps them all
+        virtual sl_result setAcquisitionFilter(const LidarAcquisitionFilter& filter) = 0;
+
+        /// Number of measurement packets discarded due to a checksum (CRC) mismatch since the driver was created.
+        /// A growing value usually indicates a noisy link or a baudrate mismatch.
+        virtual sl_u32 getChecksumErrorCount() = 0;
+
+        /// Record every byte received from the channel into a file which can be replayed by createReplayChannel.
+        /// The recording is done by a background thread, the bytes are dropped if the disk cannot keep up.
+        ///
+        /// \param path          The capture file to create, any previous capture of this driver is stopped
+        virtual sl_result startRawCapture(const char* path) = 0;
+
+        /// Stop the raw capture and flush the file
+        virtual void stopRawCapture() = 0;
+
+        /// Retrieve the counters of the receiving pipeline, they are cheap enough to be always on.
+        /// Any growing loss counter means the application or the host cannot keep up with the LIDAR.
+        virtual sl_result getRuntimeStats(LidarRuntimeStats& stats) = 0;
+
+        /// Retrieve the sizes of the buffers allocated by the driver, they depend on the scan mode started last
+        /// with a memory budget (see LidarConnectOptions::memoryProfile)
+        virtual sl_result getMemoryFootprint(LidarMemoryFootprint& footprint) = 0;
+
+        /// Enable or disable the latency instrumentation, it is disabled by default.
+        /// The statistics collected so far are kept, use resetLatencyStats to clear them.
+        virtual void setLatencyTrackingEnabled(bool enabled) = 0;
+
+        /// Retrieve the latency histograms and the queue depths collected while the latency tracking is enabled
+        virtual sl_result getLatencyStats(LidarLatencyStats& stats) = 0;
+
+        /// Clear the latency histograms and the peak queue depth
+        virtual void resetLatencyStats() = 0;
+
 
         /// Ascending the scan data according to the angle value in the scan.
         ///
@@ -483,6 +1328,8 @@ namespace sl {
         /// \param count          Once the interface returns, this parameter will store the actual received data count.
         ///
         /// The interface will return SL_RESULT_OPERATION_TIMEOUT to indicate that not even a single node can be retrieved since last call. 
+        ///
+        /// The nodes are only queued once it has been called (or LidarConnectOptions::queueIntervalSamples is set), so the first call returns no node.
         virtual sl_result getScanDataWithIntervalHq(sl_lidar_response_measurement_node_hq_t* nodebuffer, size_t& count) = 0;
         /// Set lidar motor speed
         /// The host system can use this operation to set lidar motor speed.
@@ -0,0 +1,110 @@
+/*
+ *  Slamtec LIDAR SDK
+ *
+ *  Copyright (c) 2014 - 2023 Shanghai Slamtec Co., Ltd.
+ *  http://www.slamtec.com
+ *
+ */
+ /*
+  * Redistribution and use in source and binary forms, with or without
+  * modification, are permitted provided that the following conditions are met:
+  *
+  * 1. Redistributions of source code must retain the above copyright notice,
+  *    this list of conditions and the following disclaimer.
+  *
+  * 2. Redistributions in binary form must reproduce the above copyright notice,
+  *    this list of conditions and the following disclaimer in the documentation
+  *    and/or other materials provided with the distribution.
+  *
+  * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+  * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+  * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+  * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+  * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+  * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+  * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+  * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+  * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+  * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+  * EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+  *
+  */
+
+#pragma once
+
+#include "sl_lidar_driver.h"
+
+namespace sl {
+
+    /**
+    * Save a capability profile (see ILidarDriver::getCapabilityProfile) as a small text file
+    */
+    sl_result saveLidarCapabilityProfile(const char* filename, const LidarCapabilityProfile& profile);
+
+    /**
+    * Load a capability profile saved by saveLidarCapabilityProfile
+    * \return SL_RESULT_OPERATION_FAIL if the file cannot be read, SL_RESULT_INVALID_DATA if it is malformed
+    */
+    sl_result loadLidarCapabilityProfile(const char* filename, LidarCapabilityProfile& profile);
+
+    /**
+    * Options of connectLidarSerialFast
+    */
+    struct LidarFastConnectOptions
+    {
+        // baudrates probed in turn, the one which worked last time (if cached) is probed first
+        std::vector<sl_u32> baudRates;
+
+        // timeout of each probe, a device answers the device info query within a few milliseconds
+        sl_u32  probeTimeout;
+
+        // if no baudrate answers, ask the device to detect this one (see ILidarDriver::negotiateSerialBaudRate), 0 to disable
+        sl_u32  negotiateBaudRate;
+
+        // directory keeping the capability profile of each device (by serial number) and the last baudrate of each port,
+        // empty to disable the cache
+        std::string cacheDir;
+
+        // passed to ILidarDriver::connect, its probeTimeout is overridden by the one above
+        LidarConnectOptions connectOptions;
+
+        LidarFastConnectOptions()
+            : probeTimeout(100)
+            , negotiateBaudRate(0)
+        {
+            baudRates.push_back(1000000);
+            baudRates.push_back(256000);
+            baudRates.push_back(115200);
+        }
+    };
+
+    /**
+    * What connectLidarSerialFast found out
+    */
+    struct LidarFastConnectInfo
+    {
+        sl_u32  baudRate;
+        sl_lidar_response_device_info_t devInfo;
+        LidarCapabilityProfile profile;
+
+        // the profile was loaded from the cache, no discovery query was made
+        bool    profileCached;
+
+        LidarFastConnectInfo()
+            : baudRate(0)
+            , profileCached(false)
+        {
+            memset(&devInfo, 0, sizeof(devInfo));
+        }
+    };
+
+    /**
+    * Connect the driver to a LIDAR on a serial port at an unknown baudrate, with short probes instead of
+    * the default timeouts, and load (or discover and save) its capability profile so startScan needs no discovery query.
+    * A serial port cannot be opened at several baudrates at once, so the probes are made in turn, the cached one first.
+    *
+    * \return the channel the driver is connected on, owned by the caller (delete it after disconnecting the driver)
+    */
+    Result<IChannel*> connectLidarSerialFast(ILidarDriver* drv, const std::string& device,
+            const LidarFastConnectOptions& options = LidarFastConnectOptions(), LidarFastConnectInfo* outInfo = NULL);
+}
@@ -0,0 +1,176 @@
+/*
+ *  Slamtec LIDAR SDK
+ *
+ *  Copyright (c) 2014 - 2023 Shanghai Slamtec Co., Ltd.
+ *  http://www.slamtec.com
+ *
+ */
+ /*
+  * Redistribution and use in source and binary forms, with or without
+  * modification, are permitted provided that the following conditions are met:
+  *
+  * 1. Redistributions of source code must retain the above copyright notice,
+  *    this list of conditions and the following disclaimer.
+  *
+  * 2. Redistributions in binary form must reproduce the above copyright notice,
+  *    this list of conditions and the following disclaimer in the documentation
+  *    and/or other materials provided with the distribution.
+  *
+  * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+  * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+  * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+  * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+  * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+  * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+  * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+  * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+  * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+  * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+  * EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+  *
+  */
+
+#pragma once
+
+#include "sl_lidar_driver.h"
+
+namespace sl {
+
+    /**
+    * Per-device options of a fleet, see ILidarFleet::addDevice
+    */
+    struct LidarFleetDeviceOptions
+    {
+        enum {
+            SCAN_MODE_TYPICAL  = 0xFFFF,    // the typical scan mode of the device, as startScan(false, true)
+            SCAN_MODE_STANDARD = 0xFFFE,    // the legacy standard scan, as startScan(false, false)
+        };
+
+        // the scan mode to start, one of getAllSupportedScanModes or the values above
+        sl_u16  scanMode;
+
+        LidarFleetDeviceOptions()
+            : scanMode(SCAN_MODE_TYPICAL)
+        {
+        }
+    };
+
+    /**
+    * Options of a fleet, see createLidarFleet
+    */
+    struct LidarFleetOptions
+    {
+        // I/O threads and decoding threads shared by all the devices (see ILidarIOReactor),
+        // set ioThreadCount to 0 to give every device dedicated threads instead
+        size_t  ioThreadCount;
+        size_t  decodeWorkerCount;
+
+        // scans of different devices whose timestamps are at most this far apart are merged into one set
+        sl_u32  syncWindow_uS;
+
+        // max number of merged sets waiting for waitScanSet, the oldest one is dropped when it is full
+        size_t  queueDepth;
+
+        LidarFleetOptions()
+            : ioThreadCount(1)
+            , decodeWorkerCount(2)
+            , syncWindow_uS(50000)
+            , queueDepth(8)
+        {
+        }
+    };
+
+    /**
+    * A scan of one device of a fleet
+    */
+    struct LidarFleetScan
+    {
+        size_t  deviceIndex;
+        sl_u64  timestamp_uS;   // as returned by grabScanDataHqWithTimeStamp
+        std::vector<sl_lidar_response_measurement_node_hq_t> nodes;
+
+        LidarFleetScan()
+            : deviceIndex(0)
+            , timestamp_uS(0)
+        {
+        }
+    };
+
+    /**
+    * Time-aligned scans of the devices of a fleet, at most one per device
+    */
+    struct LidarScanSet
+    {
+        sl_u64  timestamp_uS;   // of the oldest scan in the set
+        bool    complete;       // every running device has a scan in the set
+        std::vector<LidarFleetScan> scans;
+
+        LidarScanSet()
+            : timestamp_uS(0)
+            , complete(false)
+        {
+        }
+    };
+
+    /**
+    * Runs several LIDARs together and merges their scans into time-aligned sets
+    *
+    * The devices are connected and started in parallel and share the I/O threads.
+    * A set is delivered as soon as every running device has contributed a scan. A device which
+    * stops delivering scans holds the others back for a few scans only, their sets are delivered
+    * without it (not complete) afterwards.
+    */
+    class ILidarFleet
+    {
+    public:
+        virtual ~ILidarFleet() {}
+
+    public:
+        /**
+        * Add a device before the fleet is started
+        * \param channel The channel of the device, it must stay alive until the fleet is stopped
+        * \return The index of the device
+        */
+        virtual size_t addDevice(IChannel* channel, const LidarFleetDeviceOptions& options = LidarFleetDeviceOptions()) = 0;
+
+        /**
+        * Connect all the devices in parallel and start scanning
+        * \return SL_RESULT_OK if all of them are running, otherwise the ones which are keep running,
+        *         see getDeviceStatus for the failed ones
+        */
+        virtual sl_result start(sl_u32 timeoutInMs = ILidarDriver::DEFAULT_TIMEOUT) = 0;
+
+        /**
+        * Stop scanning and disconnect all the devices, the queued sets are discarded
+        */
+        virtual void stop() = 0;
+
+        virtual size_t getDeviceCount() = 0;
+
+        /**
+        * The driver of a running device (NULL if the device failed to start)
+        * It can be used for device queries, but its scan callback belongs to the fleet.
+        */
+        virtual ILidarDriver* getDriver(size_t index) = 0;
+
+        /**
+        * The result of starting a device, SL_RESULT_OK if it is running
+        */
+        virtual sl_result getDeviceStatus(size_t index) = 0;
+
+        /**
+        * Wait for the next merged set
+        * The set is swapped with the queued one, so passing the same set again reuses its buffers.
+        * \return SL_RESULT_OPERATION_TIMEOUT if no set is available in time
+        */
+        virtual sl_result waitScanSet(LidarScanSet& set, sl_u32 timeoutInMs = ILidarDriver::DEFAULT_TIMEOUT) = 0;
+
+        /// Number of sets dropped because the queue was full
+        virtual sl_u64 getDroppedSetCount() = 0;
+
+        /// Number of scans dropped because no scan of the other devices was within the sync window
+        virtual sl_u64 getUnmatchedScanCount() = 0;
+    };
+
+    Result<ILidarFleet*> createLidarFleet(const LidarFleetOptions& options = LidarFleetOptions());
+}
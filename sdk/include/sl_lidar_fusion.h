@@ -0,0 +1,170 @@
+/*
+ *  Slamtec LIDAR SDK
+ *
+ *  Copyright (c) 2014 - 2023 Shanghai Slamtec Co., Ltd.
+ *  http://www.slamtec.com
+ *
+ */
+ /*
+  * Redistribution and use in source and binary forms, with or without
+  * modification, are permitted provided that the following conditions are met:
+  *
+  * 1. Redistributions of source code must retain the above copyright notice,
+  *    this list of conditions and the following disclaimer.
+  *
+  * 2. Redistributions in binary form must reproduce the above copyright notice,
+  *    this list of conditions and the following disclaimer in the documentation
+  *    and/or other materials provided with the distribution.
+  *
+  * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+  * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+  * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+  * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+  * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+  * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+  * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+  * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+  * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+  * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+  * EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+  *
+  */
+
+#pragma once
+
+#include "sl_lidar_driver.h"
+#include "sl_lidar_deskew.h"
+#include "sl_lidar_fleet.h"
+#include <vector>
+
+namespace sl {
+
+    /**
+    * Options of a scan fusion, see createLidarScanFusion
+    */
+    struct LidarFusionOptions
+    {
+        // a scan only tells the timestamp of its first node (see LidarScanSet), the time span of its nodes is then
+        // estimated from the timestamps of the consecutive scans of the device, up to this period
+        sl_u32  maxScanPeriod_uS;
+
+        // threads sharing the devices of a fusion, the calling thread included
+        size_t  threadCount;
+        LidarThreadConfig workerThreadConfig;
+
+        LidarFusionOptions()
+            : maxScanPeriod_uS(250000)
+            , threadCount(2)
+        {
+        }
+    };
+
+    /**
+    * A scan of one device to fuse
+    */
+    struct LidarFusionScan
+    {
+        size_t  deviceIndex;
+        const sl_lidar_response_measurement_node_hq_t* nodes;
+        size_t  count;
+
+        // time of the first and the last node, the nodes in between are evenly spaced in time (see LidarScanLease)
+        sl_u64  timestamp_uS;
+        sl_u64  endTimestamp_uS;
+
+        LidarFusionScan()
+            : deviceIndex(0)
+            , nodes(NULL)
+            , count(0)
+            , timestamp_uS(0)
+            , endTimestamp_uS(0)
+        {
+        }
+
+        LidarFusionScan(size_t deviceIndex, const LidarScanLease& lease)
+            : deviceIndex(deviceIndex)
+            , nodes(lease.nodes)
+            , count(lease.count)
+            , timestamp_uS(lease.timestamp_uS)
+            , endTimestamp_uS(lease.endTimestamp_uS)
+        {
+        }
+    };
+
+    /**
+    * A point of a fused cloud, in cartesian coordinates (in millimeter) of the base frame
+    */
+    struct LidarFusedPoint
+    {
+        sl_u64  timestamp_uS;
+        float   x;
+        float   y;
+        sl_u16  deviceIndex;
+        sl_u8   quality;
+        sl_u8   flag;
+    };
+
+    /**
+    * A merged point cloud, reuse the same cloud to avoid any memory allocation
+    */
+    struct LidarFusedCloud
+    {
+        // of the oldest and the newest point
+        sl_u64  timestamp_uS;
+        sl_u64  endTimestamp_uS;
+
+        // the points sorted by timestamp, only the first count ones are valid, the buffer only grows
+        std::vector<LidarFusedPoint> points;
+        size_t  count;
+
+        LidarFusedCloud()
+            : timestamp_uS(0)
+            , endTimestamp_uS(0)
+            , count(0)
+        {
+        }
+    };
+
+    /**
+    * Fusion of the scans of several LIDARs into a single point cloud of the vehicle (the base frame)
+    *
+    * Each device is placed with its extrinsics, the pose of the LIDAR in the base frame as for LidarDeskewOptions.
+    * The scans are spread over the worker threads by device: the nodes of a scan are projected and moved into the
+    * base frame with SSE2/AVX2 (selected at runtime) or NEON instructions when available, every node keeping its own
+    * timestamp. The scans are then merged into one cloud ordered by timestamp, the invalid nodes (0 distance) left out.
+    *
+    * When the fusion is given a pose ring, the vehicle motion is compensated as well: every scan goes through a
+    * LidarScanDeskewer and the whole cloud is expressed in the base frame at the time of the newest point.
+    *
+    * A fusion is not thread-safe, use one per vehicle.
+    */
+    class ILidarScanFusion
+    {
+    public:
+        virtual ~ILidarScanFusion() {}
+
+    public:
+        /// Set the pose of a device in the base frame (millimeter, radian), the timestamp is ignored.
+        /// A device without extrinsics is placed at the origin of the base frame.
+        virtual void setExtrinsics(size_t deviceIndex, const LidarPose2D& mount) = 0;
+
+        virtual LidarPose2D getExtrinsics(size_t deviceIndex) = 0;
+
+        /**
+        * Fuse the scans of some devices, at most one per device
+        * \param cloud  Receives the merged points, the ones of a scan which could not be processed are left out
+        * \return SL_RESULT_OK, otherwise the error of the first scan left out: SL_RESULT_INVALID_DATA if two scans
+        *         belong to the same device, or the result of LidarScanDeskewer::deskew
+        */
+        virtual sl_result fuse(const LidarFusionScan* scans, size_t count, LidarFusedCloud& cloud) = 0;
+
+        /// Same as above for a set of a fleet (see ILidarFleet::waitScanSet), the device indexes of the fleet are kept
+        virtual sl_result fuse(const LidarScanSet& set, LidarFusedCloud& cloud) = 0;
+    };
+
+    /**
+    * \param poses  Optional, the poses of the vehicle to compensate its motion with, it must outlive the fusion
+    */
+    Result<ILidarScanFusion*> createLidarScanFusion(const LidarFusionOptions& options = LidarFusionOptions(), const LidarPoseRing* poses = NULL);
+
+}
@@ -0,0 +1,169 @@
+/*
+ *  Slamtec LIDAR SDK
+ *
+ *  Copyright (c) 2014 - 2023 Shanghai Slamtec Co., Ltd.
+ *  http://www.slamtec.com
+ *
+ */
+ /*
+  * Redistribution and use in source and binary forms, with or without
+  * modification, are permitted provided that the following conditions are met:
+  *
+  * 1. Redistributions of source code must retain the above copyright notice,
+  *    this list of conditions and the following disclaimer.
+  *
+  * 2. Redistributions in binary form must reproduce the above copyright notice,
+  *    this list of conditions and the following disclaimer in the documentation
+  *    and/or other materials provided with the distribution.
+  *
+  * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+  * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+  * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+  * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+  * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+  * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+  * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+  * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+  * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+  * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+  * EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+  *
+  */
+
+#pragma once
+
+#include "sl_lidar_cmd.h"
+#include <vector>
+
+namespace sl {
+
+    /**
+    * A line segment fitted to consecutive points of a scan
+    * The distances are in millimeter and the angles in radian, in the LIDAR frame (see projectScanToCartesian).
+    */
+    struct LidarLineSegment
+    {
+        // the first and the last points of the segment projected onto the fitted line
+        float   startX;
+        float   startY;
+        float   endX;
+        float   endY;
+
+        // the fitted line is x * cos(normalAngle) + y * sin(normalAngle) = distance, with distance >= 0
+        float   normalAngle;
+        float   distance;
+
+        // RMS distance of the points to the line
+        float   rmsError;
+
+        // indices of the first and last points in the scan, the segment may wrap around its end
+        sl_u32  firstIndex;
+        sl_u32  lastIndex;
+        sl_u32  pointCount;
+    };
+
+    /**
+    * Options of a line extractor
+    */
+    struct LidarLineExtractorOptions
+    {
+        // adaptive breakpoint detection: two consecutive points are split apart when they are farther than a surface
+        // seen under breakpointAngle (radian) from the LIDAR would put them, plus 3 times rangeSigma
+        float   breakpointAngle;
+        float   rangeSigma;
+
+        // a run of points is split at its farthest point from the fitted line while that one is farther than splitDistance
+        float   splitDistance;
+
+        // the segments with fewer points or shorter than this are dropped
+        size_t  minPointCount;
+        float   minLength;
+
+        LidarLineExtractorOptions()
+            : breakpointAngle(0.175f)
+            , rangeSigma(10)
+            , splitDistance(30)
+            , minPointCount(6)
+            , minLength(150)
+        {
+        }
+    };
+
+    /**
+    * Line segment extraction from the ordered points of a scan (e.g. the output of ILidarDriver::ascendScanData)
+    *
+    * The points are first cut into runs by the adaptive breakpoint detection, then every run goes through
+    * split-and-merge. The lines are total least squares fits computed in constant time from running sums of
+    * the point coordinates, so splitting or merging never walks the points again except to find the farthest one.
+    *
+    * The working buffers only grow when a scan holds more points than any scan before, so reusing the same
+    * extractor does not allocate per scan. An extractor is not thread-safe, use one per thread.
+    */
+    class LidarLineExtractor
+    {
+    public:
+        LidarLineExtractor(const LidarLineExtractorOptions& options = LidarLineExtractorOptions());
+
+        const LidarLineExtractorOptions& options() const { return _options; }
+        void setOptions(const LidarLineExtractorOptions& options) { _options = options; }
+
+        /**
+        * Extract the segments of a scan in cartesian coordinates
+        * \param x, y       The points in the scan order, the points at the origin are invalid and skipped
+        * \param segments   Receives the segments in the scan order (cleared first)
+        * \return The segment count
+        */
+        size_t extract(const float* x, const float* y, size_t count, std::vector<LidarLineSegment>& segments);
+
+        /// Same as above for the nodes of a scan sorted by angle, the segment indices refer to the nodes
+        size_t extract(const sl_lidar_response_measurement_node_hq_t* nodes, size_t count, std::vector<LidarLineSegment>& segments);
+
+    private:
+        struct Fit
+        {
+            double  centerX;
+            double  centerY;
+            double  normalX;
+            double  normalY;
+            double  distance;
+            double  meanSquaredError;
+        };
+
+        struct Range
+        {
+            size_t  first;
+            size_t  last;       // inclusive
+        };
+
+        void _collectPoints(const float* x, const float* y, size_t count);
+        void _computeSums();
+        void _fit(size_t first, size_t last, Fit& fit) const;
+        size_t _farthestPoint(size_t first, size_t last, const Fit& fit, double& distance) const;
+        size_t _chordFarthestPoint(size_t first, size_t last) const;
+        void _splitRun(size_t first, size_t last);
+        void _mergeLines(size_t firstLine);
+        void _emitSegments(std::vector<LidarLineSegment>& segments);
+
+        LidarLineExtractorOptions _options;
+
+        // the valid points in the scan order starting at a breakpoint, with their index in the scan
+        std::vector<sl_u32>     _order;
+        std::vector<float>      _px;
+        std::vector<float>      _py;
+        std::vector<sl_u8>      _breaks;
+
+        // running sums over the valid points, each one holds the sum of the points before it
+        std::vector<double>     _sumX;
+        std::vector<double>     _sumY;
+        std::vector<double>     _sumXX;
+        std::vector<double>     _sumXY;
+        std::vector<double>     _sumYY;
+
+        std::vector<Range>      _stack;
+        std::vector<Range>      _lines;
+
+        std::vector<float>      _nodeX;
+        std::vector<float>      _nodeY;
+    };
+
+}
@@ -0,0 +1,156 @@
+/*
+ *  Slamtec LIDAR SDK
+ *
+ *  Copyright (c) 2014 - 2023 Shanghai Slamtec Co., Ltd.
+ *  http://www.slamtec.com
+ *
+ */
+ /*
+  * Redistribution and use in source and binary forms, with or without
+  * modification, are permitted provided that the following conditions are met:
+  *
+  * 1. Redistributions of source code must retain the above copyright notice,
+  *    this list of conditions and the following disclaimer.
+  *
+  * 2. Redistributions in binary form must reproduce the above copyright notice,
+  *    this list of conditions and the following disclaimer in the documentation
+  *    and/or other materials provided with the distribution.
+  *
+  * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+  * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+  * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+  * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+  * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+  * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+  * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+  * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+  * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+  * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+  * EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+  *
+  */
+
+#pragma once
+
+#include "sl_lidar_driver.h"
+#include "sl_lidar_deskew.h"
+
+#include <vector>
+
+namespace sl {
+
+    /**
+    * Options of an occupancy grid, see createLidarOccupancyGrid
+    * The distances are in millimeter.
+    */
+    struct LidarOccupancyGridOptions
+    {
+        // cell size
+        float   resolution;
+
+        // size of the grid in cells, rounded up to whole tiles
+        size_t  width;
+        size_t  height;
+
+        // world coordinates of the corner of the cell (0, 0), ignored when the grid is centered on the world origin
+        bool    centered;
+        float   originX;
+        float   originY;
+
+        // log-odds added to the cell of a return and to the cells crossed by a ray, and the bounds of a cell
+        float   logOddsHit;
+        float   logOddsMiss;
+        float   logOddsMin;
+        float   logOddsMax;
+
+        // the rays are cut this far from the LIDAR without marking a return, 0 for no limit
+        float   maxRange;
+
+        // threads casting the rays, the calling thread included
+        size_t  threadCount;
+        LidarThreadConfig workerThreadConfig;
+
+        LidarOccupancyGridOptions()
+            : resolution(50)
+            , width(1024)
+            , height(1024)
+            , centered(true)
+            , originX(0)
+            , originY(0)
+            , logOddsHit(0.85f)
+            , logOddsMiss(-0.4f)
+            , logOddsMin(-2.f)
+            , logOddsMax(3.5f)
+            , maxRange(0)
+            , threadCount(2)
+        {
+        }
+    };
+
+    /**
+    * 2D log-odds occupancy grid integrating the scans one after the other
+    *
+    * Every ray is walked from the LIDAR to its return (Bresenham) and each cell is updated at most once
+    * per scan, a return winning over a crossing ray. The rays are split among the worker threads.
+    *
+    * The cells are stored by tiles of TILE_SIZE x TILE_SIZE, tile (tx, ty) having the index ty * getTileColumns() + tx.
+    * The tiles modified by the scans are remembered until fetchDirtyTiles is called, so that a consumer only
+    * copies (or uploads to a texture) the regions that changed.
+    *
+    * All the methods are thread-safe: a scan may be integrated by one thread while another one reads the grid.
+    */
+    class ILidarOccupancyGrid
+    {
+    public:
+        enum {
+            TILE_SHIFT = 6,
+            TILE_SIZE = 1 << TILE_SHIFT,
+        };
+
+    public:
+        virtual ~ILidarOccupancyGrid() {}
+
+    public:
+        /**
+        * Integrate a scan
+        * \param x, y   Cartesian coordinates in the LIDAR frame, the points at the origin are invalid and skipped
+        * \param pose   Pose of the LIDAR in the grid frame
+        */
+        virtual sl_result integrate(const float* x, const float* y, size_t count, const LidarPose2D& pose = LidarPose2D()) = 0;
+
+        /// Same as above for the nodes of a scan, e.g. retrieved by grabScanDataHq
+        virtual sl_result integrate(const sl_lidar_response_measurement_node_hq_t* nodes, size_t count, const LidarPose2D& pose = LidarPose2D()) = 0;
+
+        /// Reset every cell to unknown, all the tiles become dirty
+        virtual void clear() = 0;
+
+        virtual size_t getWidth() const = 0;
+        virtual size_t getHeight() const = 0;
+        virtual size_t getTileColumns() const = 0;
+        virtual size_t getTileRows() const = 0;
+        virtual float getResolution() const = 0;
+        virtual float getOriginX() const = 0;
+        virtual float getOriginY() const = 0;
+
+        /// Occupancy probability of the cell at the world coordinates (x, y), 0.5 for the unknown cells and outside of the grid
+        virtual float getProbability(float x, float y) = 0;
+
+        /**
+        * Append the indices of the tiles modified since the previous call to tiles, and clear their dirty flag
+        * \return The number of indices appended
+        */
+        virtual size_t fetchDirtyTiles(std::vector<size_t>& tiles) = 0;
+
+        /**
+        * Copy a tile as occupancy probabilities scaled to 0..255 (128 for unknown), row 0 first
+        * \param stride  Distance in bytes between two rows of dest, at least TILE_SIZE
+        */
+        virtual sl_result copyTile(size_t tile, sl_u8* dest, size_t stride = TILE_SIZE) = 0;
+
+        /// Same as above in log-odds
+        virtual sl_result copyTileLogOdds(size_t tile, float* dest, size_t stride = TILE_SIZE) = 0;
+    };
+
+    Result<ILidarOccupancyGrid*> createLidarOccupancyGrid(const LidarOccupancyGridOptions& options = LidarOccupancyGridOptions());
+
+}
@@ -0,0 +1,138 @@
+/*
+ *  Slamtec LIDAR SDK
+ *
+ *  Copyright (c) 2014 - 2023 Shanghai Slamtec Co., Ltd.
+ *  http://www.slamtec.com
+ *
+ */
+ /*
+  * Redistribution and use in source and binary forms, with or without
+  * modification, are permitted provided that the following conditions are met:
+  *
+  * 1. Redistributions of source code must retain the above copyright notice,
+  *    this list of conditions and the following disclaimer.
+  *
+  * 2. Redistributions in binary form must reproduce the above copyright notice,
+  *    this list of conditions and the following disclaimer in the documentation
+  *    and/or other materials provided with the distribution.
+  *
+  * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+  * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+  * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+  * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+  * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+  * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+  * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+  * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+  * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+  * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+  * EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+  *
+  */
+
+#pragma once
+
+#include "sl_lidar_driver.h"
+#include "sl_lidar_scanframe.h"
+#include "sl_lidar_scanfilter.h"
+#include "sl_lidar_binnedscan.h"
+#include "sl_lidar_lines.h"
+#include <vector>
+
+namespace sl {
+
+    /**
+    * The stages run on every scan of a log by processLidarLog, in this order
+    */
+    struct LidarOfflineOptions
+    {
+        // Worker threads, 0 for one per hardware thread
+        size_t  threadCount;
+
+        // Sort the nodes of a scan by angle first, as ILidarDriver::ascendScanData does (the CSV written by data_logger already is)
+        bool    ascendScans;
+
+        // Applied to every scan, no stage to keep the nodes as they are
+        LidarScanFilterPipeline filters;
+
+        // Bin the filtered scan, 0 bins to skip it
+        size_t  binCount;
+        LidarBinnedScan::BinPolicy binPolicy;
+
+        // Extract the line segments of the filtered scan
+        bool    extractLines;
+        LidarLineExtractorOptions lineOptions;
+
+        LidarOfflineOptions()
+            : threadCount(0)
+            , ascendScans(true)
+            , binCount(0)
+            , binPolicy(LidarBinnedScan::BIN_POLICY_MIN)
+            , extractLines(false)
+        {
+        }
+    };
+
+    /**
+    * A scan of the log once it went through the stages, everything is owned by the worker and only valid in the callback
+    */
+    struct LidarOfflineScan
+    {
+        // scan_number of a CSV log, the index of the scan (from 1) in a recording
+        sl_u64  scanNumber;
+
+        // Timestamp of the first node (in microseconds), whole seconds for a CSV log
+        sl_u64  timestamp_uS;
+
+        // The node count of the scan as logged
+        size_t  rawNodeCount;
+
+        // The filtered scan, also as nodes
+        const LidarScanFrame* frame;
+        const sl_lidar_response_measurement_node_hq_t* nodes;
+        size_t  count;
+
+        // NULL unless the stage is enabled
+        const LidarBinnedScan* binned;
+        const std::vector<LidarLineSegment>* segments;
+
+        // 0 to threadCount - 1, e.g. to pick a per-thread accumulator
+        size_t  workerIndex;
+    };
+
+    /**
+    * Called on the worker threads for every scan, concurrently and not in the log order
+    */
+    typedef std::function<void(const LidarOfflineScan& scan)> LidarOfflineScanCallback;
+
+    struct LidarOfflineStats
+    {
+        sl_u64  scanCount;
+        sl_u64  rawNodeCount;
+        sl_u64  filteredNodeCount;
+        sl_u64  segmentCount;
+
+        // Lines of a CSV log which could not be parsed, they are skipped
+        sl_u64  malformedLineCount;
+
+        size_t  threadCount;
+        double  elapsed_s;
+    };
+
+    /**
+    * Run the stages of the options on every scan of a log, split by scan across a pool of threads
+    *
+    * The log is memory mapped. It is either a recording of ILidarScanRecorder (told by its header) or a CSV file
+    * of data_logger: timestamp,angle,distance,quality,scan_number with the lines of a scan next to each other.
+    * The numbers are parsed in place without locale or allocation, so the throughput scales with the threads
+    * until the storage becomes the limit.
+    *
+    * \param path       The log file
+    * \param options    The stages, each worker gets its own copy of them
+    * \param callback   Optional, receives every processed scan
+    * \param stats      Optional
+    * \return SL_RESULT_FORMAT_NOT_SUPPORT if the file is neither a recording nor a data_logger CSV
+    */
+    sl_result processLidarLog(const char* path, const LidarOfflineOptions& options, const LidarOfflineScanCallback& callback = LidarOfflineScanCallback(), LidarOfflineStats* stats = NULL);
+
+}
@@ -0,0 +1,56 @@
+/*
+ *  Slamtec LIDAR SDK
+ *
+ *  Copyright (c) 2014 - 2023 Shanghai Slamtec Co., Ltd.
+ *  http://www.slamtec.com
+ *
+ */
+ /*
+  * Redistribution and use in source and binary forms, with or without
+  * modification, are permitted provided that the following conditions are met:
+  *
+  * 1. Redistributions of source code must retain the above copyright notice,
+  *    this list of conditions and the following disclaimer.
+  *
+  * 2. Redistributions in binary form must reproduce the above copyright notice,
+  *    this list of conditions and the following disclaimer in the documentation
+  *    and/or other materials provided with the distribution.
+  *
+  * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+  * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+  * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+  * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+  * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+  * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+  * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+  * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+  * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+  * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+  * EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+  *
+  */
+
+#pragma once
+
+#include "sl_lidar_cmd.h"
+#include "sl_lidar_scanframe.h"
+#include <stddef.h>
+
+namespace sl {
+
+    /// Convert a scan into cartesian coordinates (in millimeter).
+    /// The LIDAR frame convention is kept: x = range * cos(angle), y = range * sin(angle), the angle growing clockwise.
+    /// 
+    /// The sin/cos values come from a lookup table indexed by angle_z_q14 (the full resolution of the HQ protocol)
+    /// and the conversion uses SSE2/AVX2 (selected at runtime) or NEON instructions when available.
+    ///
+    /// \param nodes     The scan nodes, e.g. retrieved by grabScanDataHq
+    /// \param count     Node count
+    /// \param x         Caller provided buffer with at least count elements
+    /// \param y         Caller provided buffer with at least count elements
+    void projectScanToCartesian(const sl_lidar_response_measurement_node_hq_t* nodes, size_t count, float* x, float* y);
+
+    /// Same as above for a structure-of-arrays frame, the angle is rounded to the angle_z_q14 resolution.
+    void projectScanToCartesian(const LidarScanFrame& frame, float* x, float* y);
+
+}
@@ -0,0 +1,167 @@
+/*
+ *  Slamtec LIDAR SDK
+ *
+ *  Copyright (c) 2014 - 2023 Shanghai Slamtec Co., Ltd.
+ *  http://www.slamtec.com
+ *
+ */
+ /*
+  * Redistribution and use in source and binary forms, with or without
+  * modification, are permitted provided that the following conditions are met:
+  *
+  * 1. Redistributions of source code must retain the above copyright notice,
+  *    this list of conditions and the following disclaimer.
+  *
+  * 2. Redistributions in binary form must reproduce the above copyright notice,
+  *    this list of conditions and the following disclaimer in the documentation
+  *    and/or other materials provided with the distribution.
+  *
+  * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+  * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+  * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+  * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+  * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+  * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+  * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+  * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+  * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+  * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+  * EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+  *
+  */
+
+#pragma once
+
+#include "sl_lidar_driver.h"
+
+// Scan recording format (little-endian):
+//   sl_lidar_record_file_header_t
+//   sl_lidar_record_frame_header_t + sl_lidar_response_measurement_node_hq_t[node_count]
+//   sl_lidar_record_frame_header_t + ...
+// A file cut short (e.g. by a power loss) stays readable up to its last complete frame.
+
+#define SL_LIDAR_RECORD_MAGIC               0x43524C53 // "SLRC"
+#define SL_LIDAR_RECORD_VERSION             1
+
+#if defined(_WIN32)
+#pragma pack(1)
+#endif
+
+typedef struct _sl_lidar_record_file_header_t
+{
+    sl_u32  magic;
+    sl_u16  version;
+    sl_u16  header_size;        // frames start right after the header
+    sl_u16  node_size;          // sizeof(sl_lidar_response_measurement_node_hq_t)
+    sl_lidar_response_device_info_t device_info;
+    sl_u16  scan_mode_id;
+    sl_u8   scan_mode_ans_type;
+    float   us_per_sample;
+    float   max_distance;
+    char    scan_mode_name[64];
+} __attribute__((packed)) sl_lidar_record_file_header_t;
+
+typedef struct _sl_lidar_record_frame_header_t
+{
+    sl_u32  frame_size;         // including this header
+    sl_u32  node_count;
+    sl_u64  timestamp_uS;       // as returned by grabScanDataHqWithTimeStamp
+} __attribute__((packed)) sl_lidar_record_frame_header_t;
+
+#if defined(_WIN32)
+#pragma pack()
+#endif
+
+namespace sl {
+
+    /**
+    * Writes scans to a recording file from a background thread
+    */
+    class ILidarScanRecorder
+    {
+    public:
+        virtual ~ILidarScanRecorder() {}
+
+    public:
+        /**
+        * Create the recording file and start the writer thread
+        */
+        virtual sl_result open(const char* path, const sl_lidar_response_device_info_t& devInfo, const LidarScanMode& scanMode) = 0;
+
+        /**
+        * Write all the queued scans and close the file
+        */
+        virtual void close() = 0;
+
+        virtual bool isOpened() = 0;
+
+        /**
+        * Queue a scan to be written, the nodes are copied so the buffer can be reused once it returns
+        * \return SL_RESULT_OPERATION_FAIL if the writer cannot keep up, the scan is dropped and counted then
+        */
+        virtual sl_result pushScan(const sl_lidar_response_measurement_node_hq_t* nodes, size_t count, sl_u64 timestamp_uS) = 0;
+
+        virtual sl_u64 getRecordedScanCount() = 0;
+        virtual sl_u64 getDroppedScanCount() = 0;
+    };
+
+    /**
+    * Create a scan recorder
+    * \param queueDepth Max number of scans waiting to be written
+    */
+    Result<ILidarScanRecorder*> createLidarScanRecorder(size_t queueDepth = 32);
+
+
+    /**
+    * A scan stored in a recording file, the nodes point into the memory mapped file
+    * and stay valid until the reader is closed
+    */
+    struct LidarRecordedScan
+    {
+        const sl_lidar_response_measurement_node_hq_t* nodes;
+        size_t  count;
+        sl_u64  timestamp_uS;
+
+        LidarRecordedScan()
+            : nodes(NULL)
+            , count(0)
+            , timestamp_uS(0)
+        {
+        }
+    };
+
+    /**
+    * Memory maps a recording file for replay and random access
+    */
+    class ILidarScanRecordReader
+    {
+    public:
+        virtual ~ILidarScanRecordReader() {}
+
+    public:
+        /**
+        * Map the file and index its frames
+        * \return SL_RESULT_FORMAT_NOT_SUPPORT if it is not a recording of a supported version
+        */
+        virtual sl_result open(const char* path) = 0;
+        virtual void close() = 0;
+
+        virtual const sl_lidar_response_device_info_t& getDeviceInfo() = 0;
+        virtual const LidarScanMode& getScanMode() = 0;
+
+        virtual size_t getScanCount() = 0;
+
+        /**
+        * Get a scan without copying
+        * \return SL_RESULT_INVALID_DATA if the index is out of range
+        */
+        virtual sl_result getScan(size_t index, LidarRecordedScan& scan) = 0;
+
+        /**
+        * Index of the first scan recorded at or after the given timestamp, getScanCount() if there is none
+        */
+        virtual size_t findScanByTimestamp(sl_u64 timestamp_uS) = 0;
+    };
+
+    Result<ILidarScanRecordReader*> createLidarScanRecordReader();
+}
@@ -0,0 +1,124 @@
+/*
+ *  Slamtec LIDAR SDK
+ *
+ *  Copyright (c) 2014 - 2023 Shanghai Slamtec Co., Ltd.
+ *  http://www.slamtec.com
+ *
+ */
+ /*
+  * Redistribution and use in source and binary forms, with or without
+  * modification, are permitted provided that the following conditions are met:
+  *
+  * 1. Redistributions of source code must retain the above copyright notice,
+  *    this list of conditions and the following disclaimer.
+  *
+  * 2. Redistributions in binary form must reproduce the above copyright notice,
+  *    this list of conditions and the following disclaimer in the documentation
+  *    and/or other materials provided with the distribution.
+  *
+  * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+  * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+  * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+  * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+  * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+  * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+  * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+  * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+  * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+  * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+  * EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+  *
+  */
+
+#pragma once
+
+#include "sl_lidar_driver.h"
+
+namespace sl {
+
+    /**
+    * A change of the state of a safety zone, see ILidarSafetyMonitor::setCallback
+    */
+    struct LidarSafetyEvent
+    {
+        int     zoneId;
+
+        // true when the zone has just been intruded, false when a whole revolution went by without any node inside
+        bool    intruded;
+
+        // the node which triggered the intrusion (or the end of the clear revolution): time in microseconds,
+        // angle in degree and range in millimeter (0 for a clear event)
+        sl_u64  timestamp_uS;
+        float   angle;
+        float   range;
+
+        LidarSafetyEvent()
+            : zoneId(0)
+            , intruded(false)
+            , timestamp_uS(0)
+            , angle(0)
+            , range(0)
+        {
+        }
+    };
+
+    /**
+    * Invoked from the thread evaluating the nodes, it must return quickly and must not change the zones
+    */
+    typedef std::function<void(const LidarSafetyEvent& event)> LidarSafetyCallback;
+
+    /**
+    * Protective fields checked as the nodes are decoded, without waiting for a complete revolution
+    *
+    * Every zone is turned into a per-angle [near, far) range interval when it is added, so checking a node
+    * against a zone is a single compare. The intervals are computed conservatively over the angular span of
+    * each bin of 360/ZONE_BIN_COUNT degree: a non-convex polygon is widened to the hull of its intervals along
+    * a bearing. A zone is intruded as soon as minPoints of its nodes are seen within a revolution and is clear
+    * again after a whole revolution without any node inside.
+    *
+    * The zones are in the LIDAR frame of projectScanToCartesian (millimeter, x = range * cos(angle), y = range * sin(angle)).
+    * Hand the monitor to ILidarDriver::setSafetyMonitor to evaluate every decoded packet in the decoding thread.
+    */
+    class ILidarSafetyMonitor
+    {
+    public:
+        enum {
+            ZONE_BIN_COUNT = 4096,
+        };
+
+        virtual ~ILidarSafetyMonitor() {}
+
+    public:
+        /**
+        * Add a polygonal zone, an existing zone with the same id is replaced
+        * \param x, y         Vertices of the polygon in millimeter (at least 3), in any winding order
+        * \param minPoints    Nodes to see inside within a revolution before the zone is intruded
+        */
+        virtual sl_result addPolygonZone(int zoneId, const float* x, const float* y, size_t vertexCount, size_t minPoints = 1) = 0;
+
+        /**
+        * Add a sector zone going clockwise from fromAngle to toAngle (in degree), between minRange and maxRange (in millimeter)
+        */
+        virtual sl_result addSectorZone(int zoneId, float fromAngle, float toAngle, float minRange, float maxRange, size_t minPoints = 1) = 0;
+
+        virtual void removeZone(int zoneId) = 0;
+        virtual void clearZones() = 0;
+
+        /// The callback notified of the zone state changes, pass an empty callback to unregister the current one
+        virtual void setCallback(const LidarSafetyCallback& callback) = 0;
+
+        virtual bool isZoneIntruded(int zoneId) = 0;
+
+        /// Mark all the zones as clear without notifying them, e.g. after the scan has been restarted
+        virtual void reset() = 0;
+
+        /**
+        * Check decoded nodes against the zones, timestamps_uS[i] belongs to nodes[i]
+        * A node with the SYNCBIT flag starts a new revolution.
+        */
+        virtual void evaluate(const sl_lidar_response_measurement_node_hq_t* nodes, const sl_u64* timestamps_uS, size_t count) = 0;
+    };
+
+    Result<ILidarSafetyMonitor*> createLidarSafetyMonitor();
+
+}
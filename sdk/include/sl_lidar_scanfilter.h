@@ -0,0 +1,119 @@
+/*
+ *  Slamtec LIDAR SDK
+ *
+ *  Copyright (c) 2014 - 2023 Shanghai Slamtec Co., Ltd.
+ *  http://www.slamtec.com
+ *
+ */
+ /*
+  * Redistribution and use in source and binary forms, with or without
+  * modification, are permitted provided that the following conditions are met:
+  *
+  * 1. Redistributions of source code must retain the above copyright notice,
+  *    this list of conditions and the following disclaimer.
+  *
+  * 2. Redistributions in binary form must reproduce the above copyright notice,
+  *    this list of conditions and the following disclaimer in the documentation
+  *    and/or other materials provided with the distribution.
+  *
+  * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+  * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+  * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+  * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+  * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+  * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+  * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+  * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+  * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+  * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+  * EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+  *
+  */
+
+#pragma once
+
+#include "sl_lidar_scanframe.h"
+#include <vector>
+
+namespace sl {
+
+    /**
+    * Chain of filters applied in place to a scan frame
+    *
+    * The stages are applied in the order they were added. The gating stages only mark the nodes to remove
+    * and consecutive ones are merged, the frame is compacted once before the next stage looking at the
+    * neighbors of a node (and at the end). The masks, the median and the compaction use SSE2/AVX2 (selected
+    * at runtime) or NEON instructions when available.
+    *
+    * The working buffers only grow when a frame holds more nodes than any frame before, so reusing the same
+    * pipeline does not allocate per scan. A pipeline is not thread-safe, use one per thread.
+    */
+    class LidarScanFilterPipeline
+    {
+    public:
+        enum {
+            MAX_MEDIAN_WINDOW = 15,
+        };
+
+        LidarScanFilterPipeline();
+
+        /// Remove all the stages
+        void clear();
+
+        size_t stageCount() const { return _stages.size(); }
+
+        /// Keep the nodes with minRange <= range <= maxRange (in millimeter), the invalid nodes (0 range) are removed as long as minRange > 0
+        void addRangeGate(float minRange, float maxRange);
+
+        /// Keep the nodes with quality >= minQuality
+        void addQualityThreshold(sl_u8 minQuality);
+
+        /// Replace every range by the median of the windowSize nodes around it (odd, 3 to MAX_MEDIAN_WINDOW), a scan wraps around.
+        /// Place it after a range gate so that the invalid nodes do not take part in the median.
+        void addMedian(size_t windowSize);
+
+        /// Remove the veiling points: when two adjacent nodes (at most maxGap degree apart) and the LIDAR see the surface between
+        /// them under an angle smaller than minAngle (in degree), the farther node is removed
+        void addShadowRemoval(float minAngle = 10.f, float maxGap = 2.f);
+
+        /// Keep the nearest node of every run of nodes falling into the same angular bin of binAngle degree
+        void addAngularDownsample(float binAngle);
+
+        /// Run the stages on the frame
+        /// \return The node count left in the frame
+        size_t apply(LidarScanFrame& frame);
+
+    private:
+        enum StageType {
+            STAGE_RANGE_GATE,
+            STAGE_QUALITY_THRESHOLD,
+            STAGE_MEDIAN,
+            STAGE_SHADOW_REMOVAL,
+            STAGE_ANGULAR_DOWNSAMPLE,
+        };
+
+        struct Stage
+        {
+            StageType   type;
+            float       param0;
+            float       param1;
+            size_t      window;
+        };
+
+        void _resetMask(size_t count);
+        size_t _compact(LidarScanFrame& frame);
+        void _median(LidarScanFrame& frame, size_t windowSize);
+        void _markShadows(const LidarScanFrame& frame, float minAngle, float maxGap);
+        void _markDownsample(const LidarScanFrame& frame, float binAngle);
+
+        std::vector<Stage>  _stages;
+
+        // 0xFF for the nodes to keep
+        std::vector<sl_u8>  _keep;
+        bool                _maskPending;
+
+        std::vector<float>  _scratch;
+        std::vector<sl_u8>  _pairs;
+    };
+
+}
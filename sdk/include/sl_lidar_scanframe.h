@@ -0,0 +1,108 @@
+/*
+ *  Slamtec LIDAR SDK
+ *
+ *  Copyright (c) 2014 - 2023 Shanghai Slamtec Co., Ltd.
+ *  http://www.slamtec.com
+ *
+ */
+ /*
+  * Redistribution and use in source and binary forms, with or without
+  * modification, are permitted provided that the following conditions are met:
+  *
+  * 1. Redistributions of source code must retain the above copyright notice,
+  *    this list of conditions and the following disclaimer.
+  *
+  * 2. Redistributions in binary form must reproduce the above copyright notice,
+  *    this list of conditions and the following disclaimer in the documentation
+  *    and/or other materials provided with the distribution.
+  *
+  * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+  * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+  * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+  * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+  * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+  * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+  * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+  * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+  * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+  * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+  * EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+  *
+  */
+
+#pragma once
+
+#include "sl_lidar_cmd.h"
+#include <stddef.h>
+
+namespace sl {
+
+    /**
+    * Structure-of-arrays representation of a scan
+    * 
+    * The angle (in degree) and range (in millimeter) are converted once from the fixed point values of 
+    * sl_lidar_response_measurement_node_hq_t. Every array starts on a 32-byte boundary and its capacity 
+    * is a multiple of 8 elements, so SIMD loops can process whole blocks without touching other arrays.
+    */
+    class LidarScanFrame
+    {
+    public:
+        enum {
+            ARRAY_ALIGNMENT = 32,
+            ARRAY_GRANULARITY = 8,
+        };
+
+        LidarScanFrame(size_t capacity = 0);
+        ~LidarScanFrame();
+
+        /// Make sure the frame can hold at least capacity nodes, the existing data is lost if the buffers are reallocated
+        void reserve(size_t capacity);
+
+        /// Change the node count, the buffers grow if needed
+        void resize(size_t count);
+
+        /// Convert the nodes into the frame
+        void assign(const sl_lidar_response_measurement_node_hq_t* nodes, size_t count, sl_u64 timestamp_uS = 0);
+
+        void clear() { _count = 0; }
+
+        size_t size() const { return _count; }
+        size_t capacity() const { return _capacity; }
+
+        /// Timestamp of the first node of the scan (in microseconds)
+        sl_u64 timestamp_uS() const { return _timestamp_uS; }
+        void setTimestamp_uS(sl_u64 timestamp_uS) { _timestamp_uS = timestamp_uS; }
+
+        /// Angle in degree
+        float* angle() { return _angle; }
+        const float* angle() const { return _angle; }
+
+        /// Range in millimeter, 0 indicates an invalid measurement
+        float* range() { return _range; }
+        const float* range() const { return _range; }
+
+        sl_u8* quality() { return _quality; }
+        const sl_u8* quality() const { return _quality; }
+
+        /// SL_LIDAR_RESP_HQ_FLAG_* bits
+        sl_u8* flag() { return _flag; }
+        const sl_u8* flag() const { return _flag; }
+
+    private:
+        LidarScanFrame(const LidarScanFrame&);
+        LidarScanFrame& operator=(const LidarScanFrame&);
+
+        void _release();
+
+        void*   _storage;
+        size_t  _capacity;
+        size_t  _count;
+        sl_u64  _timestamp_uS;
+
+        float*  _angle;
+        float*  _range;
+        sl_u8*  _quality;
+        sl_u8*  _flag;
+    };
+
+}
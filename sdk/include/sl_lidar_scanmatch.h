@@ -0,0 +1,179 @@
+/*
+ *  Slamtec LIDAR SDK
+ *
+ *  Copyright (c) 2014 - 2023 Shanghai Slamtec Co., Ltd.
+ *  http://www.slamtec.com
+ *
+ */
+ /*
+  * Redistribution and use in source and binary forms, with or without
+  * modification, are permitted provided that the following conditions are met:
+  *
+  * 1. Redistributions of source code must retain the above copyright notice,
+  *    this list of conditions and the following disclaimer.
+  *
+  * 2. Redistributions in binary form must reproduce the above copyright notice,
+  *    this list of conditions and the following disclaimer in the documentation
+  *    and/or other materials provided with the distribution.
+  *
+  * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+  * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+  * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+  * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+  * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+  * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+  * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+  * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+  * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+  * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+  * EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+  *
+  */
+
+#pragma once
+
+#include "sl_lidar_driver.h"
+#include "sl_lidar_deskew.h"
+
+namespace sl {
+
+    /**
+    * Options of a scan matcher, see createLidarScanMatcher
+    * The distances are in millimeter and the angles in radian.
+    */
+    struct LidarScanMatchOptions
+    {
+        // the points farther than this range from the LIDAR are ignored, 0 to keep all of them
+        float   maxRange;
+
+        // run the correlative search around the guess before the ICP refinement,
+        // otherwise the ICP starts from the guess and needs it to be close
+        bool    correlativeSearch;
+
+        // half size of the correlative search window around the guess
+        float   searchWindowXY;
+        float   searchWindowYaw;
+
+        // cell size of the finest correlative grid, and the number of coarser grids (each one twice the size of the previous)
+        float   gridResolution;
+        size_t  gridLevels;
+
+        // step of the yaw candidates, 0 to derive it from gridResolution and the range of the points
+        float   yawResolution;
+
+        // points taken from a scan (evenly spaced in the scan order) by the correlative search and by the ICP
+        size_t  correlativePointCount;
+        size_t  icpPointCount;
+
+        // a correlative result scoring less than this fraction of the max score is ignored and the ICP starts from the guess
+        float   minCorrelativeScore;
+
+        // ICP: the iterations stop once the update is below icpConvergenceXY and icpConvergenceYaw
+        size_t  icpMaxIterations;
+        float   icpMaxCorrespondenceDistance;
+        float   icpConvergenceXY;
+        float   icpConvergenceYaw;
+
+        // ICP: residuals beyond this distance are down-weighted (Huber loss)
+        float   icpHuberDistance;
+
+        // threads sharing the correlative search, the calling thread included
+        size_t  threadCount;
+        LidarThreadConfig workerThreadConfig;
+
+        LidarScanMatchOptions()
+            : maxRange(0)
+            , correlativeSearch(true)
+            , searchWindowXY(300)
+            , searchWindowYaw(0.35f)
+            , gridResolution(50)
+            , gridLevels(4)
+            , yawResolution(0)
+            , correlativePointCount(360)
+            , icpPointCount(720)
+            , minCorrelativeScore(0.3f)
+            , icpMaxIterations(20)
+            , icpMaxCorrespondenceDistance(200)
+            , icpConvergenceXY(0.5f)
+            , icpConvergenceYaw(0.0005f)
+            , icpHuberDistance(30)
+            , threadCount(2)
+        {
+        }
+    };
+
+    /**
+    * Outcome of a scan match
+    */
+    struct LidarScanMatchResult
+    {
+        // pose of the matched scan in the frame of the reference scan (timestamp left to 0)
+        LidarPose2D pose;
+
+        // fraction of the max score reached by the correlative search, 0 if it has not been run
+        float   correlativeScore;
+
+        // fraction of the ICP points having a correspondence in the reference scan, and their RMS distance (in millimeter)
+        float   matchRatio;
+        float   rmsError;
+
+        size_t  icpIterations;
+        bool    converged;
+
+        LidarScanMatchResult()
+            : correlativeScore(0)
+            , matchRatio(0)
+            , rmsError(0)
+            , icpIterations(0)
+            , converged(false)
+        {
+        }
+    };
+
+    /**
+    * 2D scan matcher for LIDAR odometry
+    *
+    * A scan is matched against a reference scan in two steps: a multi-resolution correlative search (branch
+    * and bound over a pyramid of max-pooled likelihood grids) spread over the worker threads by yaw candidate,
+    * then a point-to-line ICP refinement using a grid hash of the reference points for the nearest neighbor
+    * lookup. The points are cartesian coordinates in the LIDAR frame, as computed by projectScanToCartesian
+    * or by LidarScanDeskewer.
+    *
+    * A matcher is not thread-safe, use one per sensor.
+    */
+    class ILidarScanMatcher
+    {
+    public:
+        virtual ~ILidarScanMatcher() {}
+
+    public:
+        /// Set the scan the next scans are matched against
+        virtual sl_result setReference(const float* x, const float* y, size_t count) = 0;
+
+        /**
+        * Match a scan against the reference scan
+        * \param guess   Initial estimate of the pose of the scan in the reference frame
+        * \return SL_RESULT_OPERATION_FAIL if there is no reference scan or too few points to match
+        */
+        virtual sl_result match(const float* x, const float* y, size_t count, const LidarPose2D& guess, LidarScanMatchResult& result) = 0;
+
+        /**
+        * Scan-to-scan odometry: match a scan against the previous one (the motion between the two previous scans
+        * being the guess) and make it the new reference. The first scan only becomes the reference.
+        * \param result  The motion since the previous scan
+        */
+        virtual sl_result track(const float* x, const float* y, size_t count, LidarScanMatchResult& result) = 0;
+
+        /// Same as above for the nodes of a scan, e.g. retrieved by grabScanDataHq
+        virtual sl_result track(const sl_lidar_response_measurement_node_hq_t* nodes, size_t count, LidarScanMatchResult& result) = 0;
+
+        /// The pose of the latest tracked scan in the frame of the first one
+        virtual LidarPose2D getTrackedPose() = 0;
+
+        /// Forget the tracked scans and the reference scan
+        virtual void resetTracking() = 0;
+    };
+
+    Result<ILidarScanMatcher*> createLidarScanMatcher(const LidarScanMatchOptions& options = LidarScanMatchOptions());
+
+}
@@ -0,0 +1,144 @@
+/*
+ *  Slamtec LIDAR SDK
+ *
+ *  Copyright (c) 2014 - 2023 Shanghai Slamtec Co., Ltd.
+ *  http://www.slamtec.com
+ *
+ */
+ /*
+  * Redistribution and use in source and binary forms, with or without
+  * modification, are permitted provided that the following conditions are met:
+  *
+  * 1. Redistributions of source code must retain the above copyright notice,
+  *    this list of conditions and the following disclaimer.
+  *
+  * 2. Redistributions in binary form must reproduce the above copyright notice,
+  *    this list of conditions and the following disclaimer in the documentation
+  *    and/or other materials provided with the distribution.
+  *
+  * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+  * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+  * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+  * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+  * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+  * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+  * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+  * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+  * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+  * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+  * EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+  *
+  */
+
+#pragma once
+
+#include "sl_lidar_driver.h"
+
+namespace sl {
+
+    /**
+    * Publishes complete scans into a POSIX shared memory ring, so other processes can read them without
+    * owning the device and without copying them through a socket.
+    * The ring has a fixed number of slots guarded by sequence counters (seqlock), the writer never waits for the readers.
+    * Hand it to ILidarDriver::setScanPublisher to publish every scan of a driver from its decoding thread.
+    */
+    class ILidarScanPublisher
+    {
+    public:
+        virtual ~ILidarScanPublisher() {}
+
+    public:
+        /**
+        * Create the shared memory ring, an existing ring of the same name is replaced
+        * \param name          Name of the ring, e.g. "lidar_front" (shared by the subscribers)
+        * \param slotCount     Number of scans kept, i.e. how far a subscriber may lag behind without missing a scan
+        * \param maxNodeCount  Max node count of a scan, the extra nodes are cut off
+        */
+        virtual sl_result open(const char* name, size_t slotCount = 16, size_t maxNodeCount = 8192) = 0;
+
+        /**
+        * Tell the subscribers the publisher is gone and unmap the ring
+        */
+        virtual void close() = 0;
+
+        virtual bool isOpened() = 0;
+
+        /**
+        * Write a scan into the next slot and wake up the waiting subscribers
+        * \param sequence  Sequence number of the scan, see LidarScanLease::sequence (0 to count the published scans instead)
+        */
+        virtual sl_result publishScan(const sl_lidar_response_measurement_node_hq_t* nodes, size_t count, sl_u64 timestamp_uS, sl_u64 sequence = 0) = 0;
+
+        virtual sl_u64 getPublishedScanCount() = 0;
+    };
+
+    Result<ILidarScanPublisher*> createLidarScanPublisher();
+
+
+    /**
+    * A scan read in place from the shared memory ring, see ILidarScanSubscriber::waitNextScan
+    */
+    struct LidarSharedScan
+    {
+        // Scan nodes in the shared memory, the publisher may overwrite them once the subscriber falls behind
+        const sl_lidar_response_measurement_node_hq_t* nodes;
+        size_t  count;
+        sl_u64  timestamp_uS;
+
+        // Sequence number given by the publisher, a gap tells how many scans were missed
+        sl_u64  sequence;
+
+        // Used by the subscriber to validate the scan
+        sl_u32  slot;
+        sl_u64  version;
+
+        LidarSharedScan()
+            : nodes(NULL)
+            , count(0)
+            , timestamp_uS(0)
+            , sequence(0)
+            , slot(0)
+            , version(0)
+        {
+        }
+    };
+
+    /**
+    * Reads the scans of an ILidarScanPublisher from another process
+    */
+    class ILidarScanSubscriber
+    {
+    public:
+        virtual ~ILidarScanSubscriber() {}
+
+    public:
+        /**
+        * Map the ring created by the publisher
+        * \return SL_RESULT_OPERATION_FAIL if there is no such ring, SL_RESULT_FORMAT_NOT_SUPPORT if its layout is unknown
+        */
+        virtual sl_result open(const char* name) = 0;
+        virtual void close() = 0;
+
+        /**
+        * Wait for the scan following the one returned last time (the latest one on the first call) and return it in place
+        * Nothing is copied, check isScanIntact once done with the nodes or use copyScan.
+        * \return SL_RESULT_OPERATION_TIMEOUT if no new scan arrives in time
+        *         SL_RESULT_OPERATION_STOP if the publisher has been closed
+        */
+        virtual sl_result waitNextScan(LidarSharedScan& scan, sl_u32 timeoutInMs = ILidarDriver::DEFAULT_TIMEOUT) = 0;
+
+        /**
+        * Check that the publisher has not overwritten the scan since it was returned
+        */
+        virtual bool isScanIntact(const LidarSharedScan& scan) = 0;
+
+        /**
+        * Copy the nodes of the scan out of the ring
+        * \param count  The buffer size (in nodes), once the interface returns, the nodes copied
+        * \return SL_RESULT_INVALID_DATA if the scan has been overwritten meanwhile
+        */
+        virtual sl_result copyScan(const LidarSharedScan& scan, sl_lidar_response_measurement_node_hq_t* buffer, size_t& count) = 0;
+    };
+
+    Result<ILidarScanSubscriber*> createLidarScanSubscriber();
+}
@@ -0,0 +1,193 @@
+/*
+ *  Slamtec LIDAR SDK
+ *
+ *  Copyright (c) 2014 - 2023 Shanghai Slamtec Co., Ltd.
+ *  http://www.slamtec.com
+ *
+ */
+ /*
+  * Redistribution and use in source and binary forms, with or without
+  * modification, are permitted provided that the following conditions are met:
+  *
+  * 1. Redistributions of source code must retain the above copyright notice,
+  *    this list of conditions and the following disclaimer.
+  *
+  * 2. Redistributions in binary form must reproduce the above copyright notice,
+  *    this list of conditions and the following disclaimer in the documentation
+  *    and/or other materials provided with the distribution.
+  *
+  * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+  * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+  * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+  * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+  * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+  * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+  * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+  * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+  * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+  * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+  * EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+  *
+  */
+
+#pragma once
+
+#include "sl_lidar_driver.h"
+
+namespace sl {
+
+    /**
+    * Wire format of the scan stream, one frame per complete scan:
+    *   frame header (32 bytes, little endian): magic "SLSF", version, flags, quality bits, frame sequence,
+    *                                            node count, timestamp, payload size, decoded payload size
+    *   payload: per node, the zigzag varint of the angle residual (against a linear prediction from the two
+    *            previous nodes) and of the distance delta; then the nodes with a non-zero flag; then the
+    *            top qualityBits bits of every quality, bit-packed. The payload is optionally LZ4 compressed.
+    * Over UDP a frame is split into datagrams, each carrying the frame header and a fragment header.
+    */
+    enum LidarStreamTransport
+    {
+        LIDAR_STREAM_TRANSPORT_TCP = 0,
+        LIDAR_STREAM_TRANSPORT_UDP_MULTICAST = 1,
+    };
+
+    /**
+    * Options of a scan stream server, see createLidarScanStreamServer
+    */
+    struct LidarStreamServerOptions
+    {
+        LidarStreamTransport transport;
+
+        // TCP: the local address to listen on, UDP: the multicast group (e.g. 239.255.0.1)
+        std::string address;
+        int         port;
+
+        // quality bits kept per node (the most significant ones), 0 to drop the quality, 8 to keep it as is
+        int         qualityBits;
+
+        // compress the payload with LZ4, only available if the SDK is built with SL_LIDAR_STREAM_LZ4 defined (and -llz4)
+        bool        lz4;
+
+        // TCP: max number of connected clients, the newer connections are refused
+        size_t      maxClientCount;
+
+        // UDP: max size of a datagram, the larger frames are fragmented
+        size_t      maxDatagramSize;
+        int         multicastTtl;
+
+        LidarStreamServerOptions()
+            : transport(LIDAR_STREAM_TRANSPORT_TCP)
+            , address("0.0.0.0")
+            , port(20109)
+            , qualityBits(8)
+            , lz4(false)
+            , maxClientCount(8)
+            , maxDatagramSize(1400)
+            , multicastTtl(1)
+        {
+        }
+    };
+
+    /**
+    * Traffic counters of a scan stream server or client
+    */
+    struct LidarStreamStats
+    {
+        sl_u64  frameCount;         // frames sent (server) or decoded (client)
+        sl_u64  droppedFrameCount;  // server: scans skipped as the previous one was still being sent, client: corrupted or incomplete frames
+        sl_u64  rawBytes;           // size of the same scans as raw sl_lidar_response_measurement_node_hq_t arrays
+        sl_u64  encodedBytes;       // size of the frames on the wire, headers included
+
+        LidarStreamStats()
+            : frameCount(0)
+            , droppedFrameCount(0)
+            , rawBytes(0)
+            , encodedBytes(0)
+        {
+        }
+    };
+
+    /**
+    * Streams complete scans to remote clients in a compact delta-encoded format
+    *
+    * Feed it from a scan callback:
+    *   drv->setScanCallback([server](const sl_lidar_response_measurement_node_hq_t* nodes, size_t count, sl_u64 ts) {
+    *       server->publishScan(nodes, count, ts);
+    *   });
+    * Frames are encoded and sent by a background thread, a scan arriving while the previous one is still
+    * being sent is dropped. TCP clients which cannot keep up are disconnected.
+    */
+    class ILidarScanStreamServer
+    {
+    public:
+        virtual ~ILidarScanStreamServer() {}
+
+    public:
+        /**
+        * Listen for clients (TCP) or open the multicast socket (UDP) and start the sending thread
+        * \return SL_RESULT_OPERATION_NOT_SUPPORT if LZ4 is asked for but not built in
+        */
+        virtual sl_result start(const LidarStreamServerOptions& options = LidarStreamServerOptions()) = 0;
+        virtual void stop() = 0;
+
+        /**
+        * Queue a complete scan for sending, returns without waiting for the clients
+        */
+        virtual sl_result publishScan(const sl_lidar_response_measurement_node_hq_t* nodes, size_t count, sl_u64 timestamp_uS) = 0;
+
+        virtual size_t getClientCount() = 0;
+        virtual void getStats(LidarStreamStats& stats) = 0;
+    };
+
+    Result<ILidarScanStreamServer*> createLidarScanStreamServer();
+
+
+    /**
+    * Options of a scan stream client, see createLidarScanStreamClient
+    */
+    struct LidarStreamClientOptions
+    {
+        LidarStreamTransport transport;
+
+        // TCP: the address of the server, UDP: the multicast group to join
+        std::string address;
+        int         port;
+
+        // UDP: the local interface to join the group on, empty for the default one
+        std::string interfaceAddress;
+
+        LidarStreamClientOptions()
+            : transport(LIDAR_STREAM_TRANSPORT_TCP)
+            , address("127.0.0.1")
+            , port(20109)
+        {
+        }
+    };
+
+    /**
+    * Receives the scans of an ILidarScanStreamServer and serves them like ILidarDriver::grabScanDataHq
+    */
+    class ILidarScanStreamClient
+    {
+    public:
+        virtual ~ILidarScanStreamClient() {}
+
+    public:
+        virtual sl_result connect(const LidarStreamClientOptions& options = LidarStreamClientOptions()) = 0;
+        virtual void disconnect() = 0;
+
+        /// False once the server has closed the TCP connection
+        virtual bool isConnected() = 0;
+
+        /// Wait for a new complete scan, the same semantics as ILidarDriver::grabScanDataHq
+        /// The quality holds the bits kept by the server, shifted back in place.
+        virtual sl_result grabScanDataHq(sl_lidar_response_measurement_node_hq_t* nodebuffer, size_t& count, sl_u32 timeout = ILidarDriver::DEFAULT_TIMEOUT) = 0;
+
+        /// The same as grabScanDataHq, with the timestamp given to the server's publishScan
+        virtual sl_result grabScanDataHqWithTimeStamp(sl_lidar_response_measurement_node_hq_t* nodebuffer, size_t& count, sl_u64& timestamp_uS, sl_u32 timeout = ILidarDriver::DEFAULT_TIMEOUT) = 0;
+
+        virtual void getStats(LidarStreamStats& stats) = 0;
+    };
+
+    Result<ILidarScanStreamClient*> createLidarScanStreamClient();
+}
@@ -0,0 +1,66 @@
+/*
+ *  Slamtec LIDAR SDK
+ *
+ *  Copyright (c) 2014 - 2023 Shanghai Slamtec Co., Ltd.
+ *  http://www.slamtec.com
+ *
+ */
+ /*
+  * Redistribution and use in source and binary forms, with or without
+  * modification, are permitted provided that the following conditions are met:
+  *
+  * 1. Redistributions of source code must retain the above copyright notice,
+  *    this list of conditions and the following disclaimer.
+  *
+  * 2. Redistributions in binary form must reproduce the above copyright notice,
+  *    this list of conditions and the following disclaimer in the documentation
+  *    and/or other materials provided with the distribution.
+  *
+  * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+  * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+  * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+  * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+  * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+  * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+  * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+  * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+  * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+  * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+  * EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+  *
+  */
+
+#pragma once
+
+#include "sl_lidar_driver.h"
+#include <string>
+
+namespace sl {
+
+    /**
+    * Trace points of the receiving pipeline, exported as a Chrome trace (chrome://tracing, ui.perfetto.dev)
+    *
+    * They are only compiled into the SDK when it is built with SL_LIDAR_TRACE defined, otherwise these functions do
+    * nothing and the dump fails with SL_RESULT_OPERATION_NOT_SUPPORT. Once compiled in, the trace points cost a relaxed
+    * load and a branch while the tracing is disabled (the default), so they can stay in a release build.
+    *
+    * Every thread records into a lock-free ring of its own holding its latest 8192 events: the reads of the rx thread,
+    * the dequeues of the decoder thread, the protocol decoding, the sample handlers, the scan swaps and the waits
+    * for a scan in the grab interfaces.
+    */
+
+    /// The SDK has been built with the trace points
+    bool isLidarTraceSupported();
+
+    /// Start or stop recording, the events recorded so far are kept
+    void setLidarTraceEnabled(bool enabled);
+    bool isLidarTraceEnabled();
+
+    /// Discard the events recorded so far
+    void clearLidarTrace();
+
+    /// Export the recorded events in the JSON trace event format, the recording may go on meanwhile
+    sl_result dumpLidarTrace(std::string& json);
+    sl_result dumpLidarTrace(const char* path);
+
+}
@@ -0,0 +1,252 @@
+/*
+ *  Slamtec LIDAR SDK
+ *
+ *  Copyright (c) 2014 - 2023 Shanghai Slamtec Co., Ltd.
+ *  http://www.slamtec.com
+ *
+ */
+ /*
+  * Redistribution and use in source and binary forms, with or without
+  * modification, are permitted provided that the following conditions are met:
+  *
+  * 1. Redistributions of source code must retain the above copyright notice,
+  *    this list of conditions and the following disclaimer.
+  *
+  * 2. Redistributions in binary form must reproduce the above copyright notice,
+  *    this list of conditions and the following disclaimer in the documentation
+  *    and/or other materials provided with the distribution.
+  *
+  * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+  * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+  * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+  * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+  * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+  * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+  * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+  * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+  * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+  * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+  * EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+  *
+  */
+
+#pragma once
+
+#include "sl_lidar_cmd.h"
+#include <vector>
+
+namespace sl {
+
+    /**
+    * A cluster of consecutive points of a scan, e.g. a person or a forklift leg
+    * The distances are in millimeter, in the LIDAR frame (see projectScanToCartesian).
+    */
+    struct LidarCluster
+    {
+        // centroid of the points
+        float   centerX;
+        float   centerY;
+
+        // axis aligned bounding box of the points
+        float   minX;
+        float   minY;
+        float   maxX;
+        float   maxY;
+
+        // distance between the first and the last points
+        float   width;
+
+        // indices of the first and last points in the scan, the cluster may wrap around its end
+        sl_u32  firstIndex;
+        sl_u32  lastIndex;
+        sl_u32  pointCount;
+    };
+
+    /**
+    * Options of a scan clusterer
+    */
+    struct LidarClusterOptions
+    {
+        // two consecutive points belong to the same cluster when they are closer than maxGap plus gapPerMeter
+        // for every meter of range of the nearer one, which follows the spacing of the beams
+        float   maxGap;
+        float   gapPerMeter;
+
+        // the clusters with fewer points are dropped, and the wider ones if maxWidth is not 0 (e.g. to drop the walls)
+        size_t  minPointCount;
+        float   maxWidth;
+
+        LidarClusterOptions()
+            : maxGap(100)
+            , gapPerMeter(20)
+            , minPointCount(3)
+            , maxWidth(0)
+        {
+        }
+    };
+
+    /**
+    * Adjacency clustering of the ordered points of a scan (e.g. the output of ILidarDriver::ascendScanData)
+    *
+    * A single pass compares every point with the previous valid one, so it runs in linear time without any
+    * spatial index. The last cluster is joined with the first one when the scan closes on itself.
+    *
+    * The working buffers only grow when a scan holds more points than any scan before, so reusing the same
+    * clusterer does not allocate per scan. A clusterer is not thread-safe, use one per thread.
+    */
+    class LidarScanClusterer
+    {
+    public:
+        LidarScanClusterer(const LidarClusterOptions& options = LidarClusterOptions());
+
+        const LidarClusterOptions& options() const { return _options; }
+        void setOptions(const LidarClusterOptions& options) { _options = options; }
+
+        /**
+        * Cluster a scan in cartesian coordinates
+        * \param x, y       The points in the scan order, the points at the origin are invalid and skipped
+        * \param clusters   Receives the clusters in the scan order (cleared first)
+        * \return The cluster count
+        */
+        size_t cluster(const float* x, const float* y, size_t count, std::vector<LidarCluster>& clusters);
+
+        /// Same as above for the nodes of a scan sorted by angle, the cluster indices refer to the nodes
+        size_t cluster(const sl_lidar_response_measurement_node_hq_t* nodes, size_t count, std::vector<LidarCluster>& clusters);
+
+    private:
+        struct Run
+        {
+            size_t  first;
+            size_t  last;       // inclusive, may be smaller than first when it wraps around
+            size_t  pointCount;
+            double  sumX;
+            double  sumY;
+            float   minX;
+            float   minY;
+            float   maxX;
+            float   maxY;
+        };
+
+        bool _isAdjacent(float x0, float y0, float x1, float y1) const;
+        void _emitCluster(const Run& run, const float* x, const float* y, std::vector<LidarCluster>& clusters) const;
+
+        LidarClusterOptions _options;
+
+        std::vector<Run>        _runs;
+        std::vector<float>      _nodeX;
+        std::vector<float>      _nodeY;
+    };
+
+    /**
+    * An object followed over the scans by LidarObjectTracker
+    */
+    struct LidarTrack
+    {
+        // unique within the tracker, counted from 1
+        sl_u32  id;
+
+        // filtered position (in millimeter) and velocity (in millimeter per second) in the LIDAR frame
+        float   x;
+        float   y;
+        float   vx;
+        float   vy;
+
+        // width of the cluster last assigned
+        float   width;
+
+        // updates since the track was created, the ones with a cluster assigned, and the consecutive ones without
+        sl_u32  age;
+        sl_u32  hits;
+        sl_u32  misses;
+
+        // the track has been assigned often enough to be considered a real object
+        bool    confirmed;
+
+        // index of the cluster assigned by the last update, -1 if none
+        sl_s32  clusterIndex;
+
+        // timestamp of the last update with a cluster assigned (in microseconds)
+        sl_u64  timestamp_uS;
+    };
+
+    /**
+    * Options of an object tracker
+    */
+    struct LidarTrackerOptions
+    {
+        // a cluster can only be assigned to a track whose predicted position is closer than gateDistance (in millimeter)
+        float   gateDistance;
+
+        // gains of the alpha-beta filter correcting the position and the velocity
+        float   positionGain;
+        float   velocityGain;
+
+        // at most maxTracks tracks are followed, the new objects are ignored while they are all in use
+        size_t  maxTracks;
+
+        // a track is confirmed after confirmHits assignments and deleted after more than maxMisses updates without one
+        sl_u32  confirmHits;
+        sl_u32  maxMisses;
+
+        LidarTrackerOptions()
+            : gateDistance(500)
+            , positionGain(0.6f)
+            , velocityGain(0.3f)
+            , maxTracks(64)
+            , confirmHits(3)
+            , maxMisses(5)
+        {
+        }
+    };
+
+    /**
+    * Constant velocity tracking of the clusters of consecutive scans
+    *
+    * Every update predicts the tracks to the scan timestamp, assigns the clusters to the tracks greedily by the
+    * nearest predicted position within the gate, corrects the assigned tracks with an alpha-beta filter and starts
+    * a track for every cluster left unassigned.
+    *
+    * The tracks and the working buffers are allocated up to maxTracks when the tracker is created, so updating
+    * does not allocate (unless a scan holds more clusters than any scan before). A tracker is not thread-safe,
+    * use one per sensor.
+    */
+    class LidarObjectTracker
+    {
+    public:
+        LidarObjectTracker(const LidarTrackerOptions& options = LidarTrackerOptions());
+
+        const LidarTrackerOptions& options() const { return _options; }
+
+        // drop all the tracks, the ids keep growing
+        void reset();
+
+        /**
+        * Update the tracks with the clusters of a new scan
+        * \param clusters      The clusters of the scan, e.g. from LidarScanClusterer
+        * \param timestamp_uS  Timestamp of the scan, e.g. from grabScanDataHqWithTimeStamp
+        * \return The track count
+        */
+        size_t update(const LidarCluster* clusters, size_t count, sl_u64 timestamp_uS);
+
+        /// The tracks after the last update, the unconfirmed ones included, valid until the next update
+        const LidarTrack* tracks() const { return _tracks.empty() ? NULL : &_tracks[0]; }
+        size_t trackCount() const { return _tracks.size(); }
+
+    private:
+        struct Candidate
+        {
+            float   distanceSq;
+            sl_u32  track;
+            sl_u32  cluster;
+        };
+
+        LidarTrackerOptions _options;
+
+        std::vector<LidarTrack> _tracks;
+        std::vector<Candidate>  _candidates;
+        std::vector<sl_u8>      _clusterAssigned;
+        sl_u32  _nextID;
+        sl_u64  _lastTimestamp_uS;
+    };
+
+}
@@ -46,7 +46,9 @@
 #include <time.h>
 #include "hal/types.h"
 #include "arch/linux/net_serial.h"
-#include <sys/select.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <stdint.h>
 
 #include <algorithm>
 //__GNUC__
@@ -55,6 +57,7 @@
 #include <asm/ioctls.h>
 #include <asm/termbits.h>
 #include <sys/ioctl.h>
+#include <linux/serial.h>
 extern "C" int tcflush(int fildes, int queue_selector);
 #else
 // for other standard UNIX
@@ -186,6 +189,19 @@ bool raw_serial::open(const char * portname, uint32_t baudrate, uint32_t flags)
 #endif
 
 
+#if defined(__GNUC__) && defined(ASYNC_LOW_LATENCY)
+    if (flags & BIND_FLAG_LOW_LATENCY)
+    {
+        // only a hint: ptys and some adapters do not support it
+        struct serial_struct serinfo;
+        if (ioctl(serial_fd, TIOCGSERIAL, &serinfo) == 0)
+        {
+            serinfo.flags |= ASYNC_LOW_LATENCY;
+            ioctl(serial_fd, TIOCSSERIAL, &serinfo);
+        }
+    }
+#endif
+
     tcflush(serial_fd, TCIFLUSH);
 
     if (fcntl(serial_fd, F_SETFL, FNDELAY))
@@ -200,28 +216,34 @@ bool raw_serial::open(const char * portname, uint32_t baudrate, uint32_t flags)
 
     //Clear the DTR bit to let the motor spin
     clearDTR();
-    do {
-        // create self pipeline for wait cancellation
-        if (pipe(_selfpipe) == -1) break;
 
-        int flags = fcntl(_selfpipe[0], F_GETFL);
-        if (flags == -1)
-            break;
-
-        flags |= O_NONBLOCK;                /* Make read end nonblocking */
-        if (fcntl(_selfpipe[0], F_SETFL, flags) == -1)
-            break;
+    // the port and the cancellation event are waited together
+    _cancel_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    _epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+    if (_cancel_fd == -1 || _epoll_fd == -1)
+    {
+        close();
+        return false;
+    }
 
-        flags = fcntl(_selfpipe[1], F_GETFL);
-        if (flags == -1)
-            break;
+    struct epoll_event ev;
+    memset(&ev, 0, sizeof(ev));
+    ev.events = EPOLLIN;
+    ev.data.fd = serial_fd;
+    if (epoll_ctl(_epoll_fd, EPOLL_CTL_ADD, serial_fd, &ev) == -1)
+    {
+        close();
+        return false;
+    }
 
-        flags |= O_NONBLOCK;                /* Make write end nonblocking */
-        if (fcntl(_selfpipe[1], F_SETFL, flags) == -1)
-            break;
+    ev.data.fd = _cancel_fd;
+    if (epoll_ctl(_epoll_fd, EPOLL_CTL_ADD, _cancel_fd, &ev) == -1)
+    {
+        close();
+        return false;
+    }
 
-    } while (0);
-    
+    _rx_pending_likely = false;
     return true;
 }
 
@@ -231,13 +253,13 @@ void raw_serial::close()
         ::close(serial_fd);
     serial_fd = -1;
     
-    if (_selfpipe[0] != -1)
-        ::close(_selfpipe[0]);
+    if (_epoll_fd != -1)
+        ::close(_epoll_fd);
 
-    if (_selfpipe[1] != -1)
-        ::close(_selfpipe[1]);
+    if (_cancel_fd != -1)
+        ::close(_cancel_fd);
 
-    _selfpipe[0] = _selfpipe[1] = -1;
+    _epoll_fd = _cancel_fd = -1;
 
     _operation_aborted = false;
     _is_serial_opened = false;
@@ -303,86 +325,117 @@ int raw_serial::waitfordata(size_t data_count, _u32 timeout, size_t * returned_s
     if (returned_size==NULL) returned_size=(size_t *)&length;
     *returned_size = 0;
 
-    int max_fd;
-    fd_set input_set;
-    struct timeval timeout_val;
-
-    /* Initialize the input set */
-    FD_ZERO(&input_set);
-    FD_SET(serial_fd, &input_set);
-
-    if (_selfpipe[0] != -1)
-        FD_SET(_selfpipe[0], &input_set);
+    _u64 startMs = getms();
 
-    max_fd =  std::max<int>(serial_fd, _selfpipe[0]) + 1;
-
-    /* Initialize the timeout structure */
-    timeout_val.tv_sec = timeout / 1000;
-    timeout_val.tv_usec = (timeout % 1000) * 1000;
-
-    if ( isOpened() )
+    while ( isOpened() )
     {
         int nread;
-
         if ( ioctl(serial_fd, FIONREAD, &nread) == -1) return ANS_DEV_ERR;
 
-        *returned_size = nread;
-
-        if (*returned_size >= data_count)
+        if ((size_t)nread >= data_count)
         {
+            *returned_size = nread;
             return 0;
         }
-    }
-
-    while ( isOpened() )
-    {
-        /* Do the select */
-        int n = ::select(max_fd, &input_set, NULL, NULL, &timeout_val);
 
-        if (n < 0)
+        _u32 remaining = timeout;
+        if (timeout != (_u32)-1)
         {
-            // select error
-            *returned_size =  0;
-            return ANS_DEV_ERR;
+            _u64 elapsed = getms() - startMs;
+            if (elapsed >= timeout) return ANS_TIMEOUT;
+            remaining = (_u32)(timeout - elapsed);
         }
-        else if (n == 0)
+
+        if (nread)
         {
-            // time out
-            *returned_size =0;
-            return ANS_TIMEOUT;
+            // the port stays readable, so waiting on it would spin: wait for the missing bytes instead
+            _waitforbytes(data_count - nread, remaining);
+            continue;
         }
-        else
-        {
-            if (FD_ISSET(_selfpipe[0], &input_set)) {   
-                // require aborting the current operation
-                int ch;
-                for (;;) {                    
-                    if (::read(_selfpipe[0], &ch, 1) == -1) {
-                        break;
-                    }
-                    
-                }
-
-                // treat as  timeout
-                *returned_size = 0;
-                return ANS_TIMEOUT;
-            }
 
-            // data avaliable
-            assert (FD_ISSET(serial_fd, &input_set));
+        int ans = _waitforreadable(remaining);
+        if (ans != ANS_OK) return ans;
+    }
+
+    return ANS_DEV_ERR;
+}
+
+int raw_serial::waitandrecv(unsigned char * data, size_t size, _u32 timeout, size_t * received)
+{
+    *received = 0;
+    if (!isOpened()) return ANS_DEV_ERR;
+
+    // a busy link usually has more data pending after a full read, try it before waiting
+    if (!_rx_pending_likely)
+    {
+        int ans = _waitforreadable(timeout);
+        if (ans != ANS_OK) return ans;
+
+        if (_rx_batch_threshold > 1) {
+            // at least one byte is there already
+            _waitforbytes(_rx_batch_threshold - 1, timeout);
+        }
+    }
 
+    // with VMIN = 0 and VTIME = 0 an empty port reads 0 bytes, a lost device is reported by epoll
+    int ans = ::read(serial_fd, data, size);
+    if (ans <= 0)
+    {
+        _rx_pending_likely = false;
+        if (ans == 0 || errno == EAGAIN || errno == EINTR) return ANS_OK;
+        return ANS_DEV_ERR;
+    }
 
-            if ( ioctl(serial_fd, FIONREAD, returned_size) == -1) return ANS_DEV_ERR;
-            if (*returned_size >= data_count)
-            {
-                return 0;
+    _rx_pending_likely = ((size_t)ans == size);
+    required_rx_cnt = ans;
+    *received = ans;
+    return ANS_OK;
+}
+
+void raw_serial::setRxBatchThreshold(size_t bytes)
+{
+    _rx_batch_threshold = bytes;
+}
+
+int raw_serial::_waitforreadable(_u32 timeout)
+{
+    struct epoll_event events[2];
+    int waitMs = (timeout > 0x7FFFFFFF) ? -1 : (int)timeout;
+
+    int n = epoll_wait(_epoll_fd, events, 2, waitMs);
+    if (n < 0)
+    {
+        // interrupted by a signal, let the caller retry
+        return (errno == EINTR) ? ANS_TIMEOUT : ANS_DEV_ERR;
+    }
+
+    if (n == 0) return ANS_TIMEOUT;
+
+    for (int pos = 0; pos < n; ++pos)
+    {
+        if (events[pos].data.fd == _cancel_fd)
+        {
+            // require aborting the current operation, treat as timeout
+            uint64_t counter;
+            if (::read(_cancel_fd, &counter, sizeof(counter)) == -1) {
+                // already drained
             }
+            return ANS_TIMEOUT;
         }
-        
+
+        // e.g. the USB adapter has been unplugged
+        if (events[pos].events & (EPOLLERR | EPOLLHUP)) return ANS_DEV_ERR;
     }
+    return ANS_OK;
+}
 
-    *returned_size=0;
-    return ANS_DEV_ERR;
+void raw_serial::_waitforbytes(size_t count, _u32 maxDelayMs)
+{
+    // 10 bits per byte on the wire: 8N1
+    _u64 delayUs = _baudrate ? ((_u64)count * 10 * 1000000 / _baudrate) : 1000;
+    if (delayUs < 50) delayUs = 50;
+    if (delayUs > (_u64)maxDelayMs * 1000) delayUs = (_u64)maxDelayMs * 1000;
+    if (delayUs) usleep((useconds_t)delayUs);
 }
 
 size_t raw_serial::rxqueue_count()
@@ -416,15 +469,20 @@ void raw_serial::_init()
     _portName[0] = 0;
     required_tx_cnt = required_rx_cnt = 0;
     _operation_aborted = false;
-    _selfpipe[0] = _selfpipe[1] = -1;
+    _epoll_fd = _cancel_fd = -1;
+    _rx_batch_threshold = 0;
+    _rx_pending_likely = false;
 }
 
 void raw_serial::cancelOperation()
 {
     _operation_aborted = true;
-    if (_selfpipe[1] == -1) return;
+    if (_cancel_fd == -1) return;
 
-    (int)::write(_selfpipe[1], "x", 1);
+    uint64_t counter = 1;
+    if (::write(_cancel_fd, &counter, sizeof(counter)) == -1) {
+        // the counter is already set
+    }
 }
 
 _u32 raw_serial::getTermBaudBitmap(_u32 baud)
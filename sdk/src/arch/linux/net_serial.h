@@ -63,6 +63,9 @@ public:
 
     virtual size_t rxqueue_count();
 
+    virtual int waitandrecv(unsigned char * data, size_t size, _u32 timeout, size_t * received);
+    virtual void setRxBatchThreshold(size_t bytes);
+
     virtual void setDTR();
     virtual void clearDTR();
 
@@ -70,10 +73,17 @@ public:
 
     virtual void cancelOperation();
 
+    virtual int getPollableHandle() { return serial_fd; }
+
 protected:
     bool open(const char * portname, uint32_t baudrate, uint32_t flags = 0);
     void _init();
 
+    // returns ANS_OK once the port is readable, ANS_TIMEOUT on timeout or cancellation
+    int  _waitforreadable(_u32 timeout);
+    // sleep for the time it takes to receive the given count of bytes
+    void _waitforbytes(size_t count, _u32 maxDelayMs);
+
     char _portName[200];
     uint32_t _baudrate;
     uint32_t _flags;
@@ -83,8 +93,14 @@ protected:
     size_t required_tx_cnt;
     size_t required_rx_cnt;
 
-    int    _selfpipe[2];
+    // the port and the cancellation eventfd are watched by the epoll fd
+    int    _epoll_fd;
+    int    _cancel_fd;
     bool   _operation_aborted;
+
+    size_t _rx_batch_threshold;
+    // the last read filled the whole buffer, more data is likely pending
+    bool   _rx_pending_likely;
 };
 
 }}}
@@ -598,6 +598,27 @@ public:
         }
     }
 
+    virtual u_result getRxPendingSize(size_t & size)
+    {
+        int pending = 0;
+        size = 0;
+        if (::ioctl(_socket_fd, FIONREAD, &pending) == -1) return RESULT_OPERATION_FAIL;
+        size = (size_t)pending;
+        return RESULT_OK;
+    }
+
+    virtual u_result setRxBufferSize(size_t size)
+    {
+        int bufsize = (int)size;
+        int ans = ::setsockopt( _socket_fd, SOL_SOCKET, SO_RCVBUF, &bufsize, sizeof(bufsize) );
+        return ans?RESULT_OPERATION_FAIL:RESULT_OK;
+    }
+
+    virtual int getPollableHandle()
+    {
+        return _socket_fd;
+    }
+
 protected:
     int  _socket_fd;
 
@@ -611,6 +632,7 @@ public:
 
     DGramSocketImpl(int fd)
         : _socket_fd(fd)
+        , _rx_timestamp_enabled(false)
     {
         assert(fd>=0);
         int bool_true = 1;
@@ -832,8 +854,145 @@ public:
     }
 #endif
     
+    virtual u_result getRxPendingSize(size_t & size)
+    {
+        int pending = 0;
+        size = 0;
+        if (::ioctl(_socket_fd, FIONREAD, &pending) == -1) return RESULT_OPERATION_FAIL;
+        size = (size_t)pending;
+        return RESULT_OK;
+    }
+
+    virtual u_result setRxBufferSize(size_t size)
+    {
+        int bufsize = (int)size;
+        int ans = ::setsockopt( _socket_fd, SOL_SOCKET, SO_RCVBUF, &bufsize, sizeof(bufsize) );
+        return ans?RESULT_OPERATION_FAIL:RESULT_OK;
+    }
+
+    virtual u_result joinMulticastGroup(const SocketAddress & group, const SocketAddress * interfaceAddr)
+    {
+        const struct sockaddr_in * groupAddr = reinterpret_cast<const struct sockaddr_in *>(group.getPlatformData());
+        if (groupAddr->sin_family != AF_INET) return RESULT_OPERATION_NOT_SUPPORT;
+
+        struct ip_mreq mreq;
+        mreq.imr_multiaddr = groupAddr->sin_addr;
+        mreq.imr_interface.s_addr = htonl(INADDR_ANY);
+        if (interfaceAddr) {
+            mreq.imr_interface = reinterpret_cast<const struct sockaddr_in *>(interfaceAddr->getPlatformData())->sin_addr;
+        }
+        int ans = ::setsockopt( _socket_fd, IPPROTO_IP, IP_ADD_MEMBERSHIP, &mreq, sizeof(mreq) );
+        return ans?RESULT_OPERATION_FAIL:RESULT_OK;
+    }
+
+    virtual u_result setMulticastOptions(int ttl, bool loopback)
+    {
+        unsigned char ttlValue = (unsigned char)ttl;
+        unsigned char loopValue = loopback ? 1 : 0;
+        if (::setsockopt( _socket_fd, IPPROTO_IP, IP_MULTICAST_TTL, &ttlValue, sizeof(ttlValue) )) return RESULT_OPERATION_FAIL;
+        if (::setsockopt( _socket_fd, IPPROTO_IP, IP_MULTICAST_LOOP, &loopValue, sizeof(loopValue) )) return RESULT_OPERATION_FAIL;
+        return RESULT_OK;
+    }
+
+    virtual u_result enableRxTimestamp(bool enable)
+    {
+        int flag = enable ? 1 : 0;
+        int ans = ::setsockopt( _socket_fd, SOL_SOCKET, SO_TIMESTAMPNS, &flag, sizeof(flag) );
+        if (ans) return RESULT_OPERATION_FAIL;
+        _rx_timestamp_enabled = enable;
+        return RESULT_OK;
+    }
+
+    virtual u_result recvFromBatch(void *buf, size_t len, size_t maxDatagramSize, size_t & recv_len, size_t & datagram_count, _u64 * rx_timestamp_us)
+    {
+        recv_len = 0;
+        datagram_count = 0;
+        if (rx_timestamp_us) *rx_timestamp_us = 0;
+
+        // the head of the queue is measured, so the first datagram is never truncated
+        size_t headSize;
+        if (IS_FAIL(getRxPendingSize(headSize))) return RESULT_OPERATION_FAIL;
+        if (headSize > len) return RESULT_INSUFFICIENT_MEMORY;
+
+        // 0 is reported for an empty queue as well as for an empty datagram
+        size_t slotSize = maxDatagramSize > headSize ? maxDatagramSize : headSize;
+        if (!slotSize) slotSize = len;
+        size_t firstSize = headSize ? headSize : (slotSize < len ? slotSize : len);
+
+        struct mmsghdr msgs[RECV_BATCH_MAX];
+        struct iovec iovs[RECV_BATCH_MAX];
+        char control[CMSG_SPACE(sizeof(struct timespec))];
+
+        size_t batchSize = 1 + (len - firstSize) / slotSize;
+        if (batchSize > RECV_BATCH_MAX) batchSize = RECV_BATCH_MAX;
+
+        memset(msgs, 0, sizeof(msgs[0]) * batchSize);
+        for (size_t pos = 0; pos < batchSize; ++pos) {
+            iovs[pos].iov_base = (_u8 *)buf + (pos ? firstSize + (pos - 1) * slotSize : 0);
+            iovs[pos].iov_len = pos ? slotSize : firstSize;
+            msgs[pos].msg_hdr.msg_iov = &iovs[pos];
+            msgs[pos].msg_hdr.msg_iovlen = 1;
+        }
+        if (_rx_timestamp_enabled && rx_timestamp_us) {
+            msgs[0].msg_hdr.msg_control = control;
+            msgs[0].msg_hdr.msg_controllen = sizeof(control);
+        }
+
+        int ans = ::recvmmsg(_socket_fd, msgs, (unsigned int)batchSize, MSG_DONTWAIT, NULL);
+        if (ans == -1) {
+            switch (errno) {
+                case EAGAIN:
+#if EWOULDBLOCK!=EAGAIN
+                case EWOULDBLOCK:
+#endif
+                    return RESULT_OPERATION_TIMEOUT;
+                default:
+                    return RESULT_OPERATION_FAIL;
+            }
+        }
+
+        // pack the datagrams back to back, the first two are contiguous already
+        _u8 * packed = (_u8 *)buf;
+        for (int pos = 0; pos < ans; ++pos) {
+            size_t datagramSize = msgs[pos].msg_len;
+            if (datagramSize > iovs[pos].iov_len) datagramSize = iovs[pos].iov_len;
+            if (packed + recv_len != iovs[pos].iov_base) {
+                memmove(packed + recv_len, iovs[pos].iov_base, datagramSize);
+            }
+            recv_len += datagramSize;
+        }
+        datagram_count = (size_t)ans;
+
+        if (ans > 0 && msgs[0].msg_hdr.msg_control) {
+            for (struct cmsghdr * cmsg = CMSG_FIRSTHDR(&msgs[0].msg_hdr); cmsg; cmsg = CMSG_NXTHDR(&msgs[0].msg_hdr, cmsg)) {
+                if (cmsg->cmsg_level != SOL_SOCKET || cmsg->cmsg_type != SCM_TIMESTAMPNS) continue;
+
+                // the kernel stamps with the wall clock, bring it to the monotonic clock of getus()
+                struct timespec stamp, wallNow;
+                memcpy(&stamp, CMSG_DATA(cmsg), sizeof(stamp));
+                clock_gettime(CLOCK_REALTIME, &wallNow);
+                _u64 now_us = getus();
+                _s64 age_us = ((_s64)wallNow.tv_sec - stamp.tv_sec) * 1000000LL + (wallNow.tv_nsec - stamp.tv_nsec) / 1000;
+                if (age_us < 0) age_us = 0;
+                if (rx_timestamp_us && (_u64)age_us < now_us) *rx_timestamp_us = now_us - age_us;
+                break;
+            }
+        }
+        return RESULT_OK;
+    }
+
+    virtual int getPollableHandle()
+    {
+        return _socket_fd;
+    }
+
 protected:
+    enum {
+        RECV_BATCH_MAX = 16,
+    };
+
     int  _socket_fd;
+    bool _rx_timestamp_enabled;
 
 };
 
@@ -147,6 +147,76 @@ u_result Thread::SetSelfPriority( priority_val_t p)
 	return  RESULT_OK;
 }
 
+u_result Thread::SetSelfSchedPolicy(sched_policy_t policy, int priority)
+{
+    pid_t selfTid = syscall(SYS_gettid);
+
+    int schedPolicy;
+    switch (policy)
+    {
+    case SCHED_POLICY_FIFO:
+        schedPolicy = SCHED_FIFO;
+        break;
+    case SCHED_POLICY_RR:
+        schedPolicy = SCHED_RR;
+        break;
+    default:
+        schedPolicy = SCHED_OTHER;
+        break;
+    }
+
+    struct sched_param param;
+    memset(&param, 0, sizeof(param));
+    if (schedPolicy != SCHED_OTHER) {
+        if (priority < sched_get_priority_min(schedPolicy) || priority > sched_get_priority_max(schedPolicy)) {
+            return RESULT_INVALID_DATA;
+        }
+        param.sched_priority = priority;
+    }
+
+    // the same as SetSelfPriority, the child threads should not inherit it
+    if (sched_setscheduler(selfTid, schedPolicy | SCHED_RESET_ON_FORK, &param)) {
+        return RESULT_OPERATION_FAIL;
+    }
+
+    if (schedPolicy == SCHED_OTHER) {
+        if (setpriority(PRIO_PROCESS, selfTid, priority)) {
+            return RESULT_OPERATION_FAIL;
+        }
+    }
+    return RESULT_OK;
+}
+
+u_result Thread::SetSelfAffinity(_u64 cpuMask)
+{
+    cpu_set_t cpus;
+    CPU_ZERO(&cpus);
+    for (int cpu = 0; cpu < 64 && cpu < CPU_SETSIZE; ++cpu) {
+        if (cpuMask & ((_u64)1 << cpu)) CPU_SET(cpu, &cpus);
+    }
+    if (!CPU_COUNT(&cpus)) return RESULT_INVALID_DATA;
+
+    if (pthread_setaffinity_np(pthread_self(), sizeof(cpus), &cpus)) {
+        return RESULT_OPERATION_FAIL;
+    }
+    return RESULT_OK;
+}
+
+u_result Thread::SetSelfName(const char* name)
+{
+    if (!name) return RESULT_INVALID_DATA;
+
+    // the kernel keeps 15 characters plus the terminator
+    char shortName[16];
+    strncpy(shortName, name, sizeof(shortName) - 1);
+    shortName[sizeof(shortName) - 1] = '\0';
+
+    if (pthread_setname_np(pthread_self(), shortName)) {
+        return RESULT_OPERATION_FAIL;
+    }
+    return RESULT_OK;
+}
+
 Thread::priority_val_t Thread::getPriority()
 {
 	if (!this->_handle) return PRIORITY_NORMAL;
@@ -53,8 +53,6 @@
 #include <algorithm>
 #include <memory>
 
-#define CONF_NO_BOOST_CRC_SUPPORT
-
 #include "dataupacker_namespace.h"
 
 
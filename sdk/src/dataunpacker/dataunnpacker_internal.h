@@ -47,6 +47,7 @@ public:
 	LIDARSampleDataUnpackerInner(LIDARSampleDataListener& l): LIDARSampleDataUnpacker(l){}
 
 	virtual void publishHQNode(_u64 timestamp_uS, const rplidar_response_measurement_node_hq_t* node) = 0;
+	virtual void publishHQNodes(const _u64* timestamps_uS, const rplidar_response_measurement_node_hq_t* nodes, size_t count) = 0;
 	virtual void publishDecodingErrorMsg(int errorType, _u8 ansType, const void* payload, size_t size) = 0;
 	virtual void publishCustomData(_u8 ansType, _u32 customCode, const void* payload, size_t size) = 0;
 	virtual void publishNewScanReset() = 0;
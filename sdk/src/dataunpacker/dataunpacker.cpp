@@ -39,9 +39,11 @@
 #include "dataunnpacker_commondef.h"
 #include "dataunpacker.h"
 #include "dataunnpacker_internal.h"
+#include "sample_clock_model.h"
 
 
 #include <map>
+#include <atomic>
 
 
 #define REGISTER_HANDLER(_c_) {     \
@@ -79,6 +81,9 @@ static bool _registerDataUnpackerHandlers(std::vector<IDataUnpackerHandler *> &
 class LIDARSampleDataUnpackerImpl : public LIDARSampleDataUnpackerInner
 {
 public:
+	enum {
+		CLOCK_STAMP_BATCH_SIZE = 128,
+	};
 
 	void registerHandler(_u8 ansType, IDataUnpackerHandler* handler)
 	{
@@ -100,6 +105,8 @@ public:
 		, _enabled(false)
 		, _lastActiveAnsType(0)
 		, _lastActiveHandler(nullptr)
+		, _checksumErrorCount(0)
+		, _clockModelEnabled(true)
 	{
 
 	}
@@ -112,6 +119,9 @@ public:
 
 	virtual void updateUnpackerContext(UnpackerContextType type, const void* data, size_t size)
 	{
+		if (type == UNPACKER_CONTEXT_TYPE_LIDAR_TIMING && size == sizeof(SlamtecLidarTimingDesc)) {
+			_clockModel.setNominalPeriod(reinterpret_cast<const SlamtecLidarTimingDesc*>(data)->sample_duration_uS);
+		}
 	
 		// notify the handlers ...
 		for (auto itr = _handlerMap.begin(); itr != _handlerMap.end(); ++itr)
@@ -149,6 +159,7 @@ public:
 	virtual void reset()
 	{
 		clearCache();
+		_clockModel.reset();
 		_lastActiveHandler = nullptr;
 		_lastActiveAnsType = 0;
 
@@ -174,18 +185,57 @@ public:
 		}
 	}
 
+	virtual _u32 getChecksumErrorCount() const
+	{
+		return _checksumErrorCount.load();
+	}
+
+	virtual void setClockModelEnabled(bool enabled)
+	{
+		_clockModelEnabled = enabled;
+	}
+
+	virtual void getClockModelStatus(float& samplePeriod_uS, float& drift_ppm, _u32& resyncCount) const
+	{
+		samplePeriod_uS = _clockModel.getEstimatedPeriod_uS();
+		drift_ppm = _clockModel.getDrift_ppm();
+		resyncCount = _clockModel.getResyncCount();
+	}
+
 	virtual _u64 getCurrentTimestamp_uS() {
 		return getus();
 	}
 
 	virtual void publishHQNode(_u64 timestamp_uS, const rplidar_response_measurement_node_hq_t* node)
 	{
+		if (_clockModelEnabled) timestamp_uS = _clockModel.stampSample(timestamp_uS);
 		_listener.onHQNodeDecoded(timestamp_uS, node);
 	}
 
+	virtual void publishHQNodes(const _u64* timestamps_uS, const rplidar_response_measurement_node_hq_t* nodes, size_t count)
+	{
+		if (!_clockModelEnabled) {
+			_listener.onHQNodesDecoded(timestamps_uS, nodes, count);
+			return;
+		}
+
+		while (count) {
+			size_t batchSize = std::min<size_t>(count, CLOCK_STAMP_BATCH_SIZE);
+			for (size_t pos = 0; pos < batchSize; ++pos) {
+				_stampedTimestamps_uS[pos] = _clockModel.stampSample(timestamps_uS[pos]);
+			}
+			_listener.onHQNodesDecoded(_stampedTimestamps_uS, nodes, batchSize);
+
+			timestamps_uS += batchSize;
+			nodes += batchSize;
+			count -= batchSize;
+		}
+	}
+
 
 	virtual void publishDecodingErrorMsg(int errorType, _u8 ansType, const void* payload, size_t size)
 	{
+		if (errorType == ERR_EVENT_ON_EXP_CHECKSUM_ERR) ++_checksumErrorCount;
 		_listener.onDecodingError(errorType, ansType, payload, size);
 
 	}
@@ -220,6 +270,13 @@ protected:
 
 	_u8 _lastActiveAnsType;
 	IDataUnpackerHandler* _lastActiveHandler;
+
+	// read by the client threads
+	std::atomic<_u32> _checksumErrorCount;
+
+	bool             _clockModelEnabled;
+	SampleClockModel _clockModel;
+	_u64             _stampedTimestamps_uS[CLOCK_STAMP_BATCH_SIZE];
 };
 
 LIDARSampleDataUnpacker* LIDARSampleDataUnpacker::CreateInstance(LIDARSampleDataListener& listener)
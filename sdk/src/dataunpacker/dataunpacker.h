@@ -51,6 +51,15 @@ class LIDARSampleDataListener
 public:
 	virtual void onHQNodeScanResetReq() = 0;
 	virtual void onHQNodeDecoded(_u64 timestamp_uS, const rplidar_response_measurement_node_hq_t* node) = 0;
+
+	// nodes decoded from the same packet, timestamps_uS[i] belongs to nodes[i]
+	// override it to avoid the per-node overhead
+	virtual void onHQNodesDecoded(const _u64* timestamps_uS, const rplidar_response_measurement_node_hq_t* nodes, size_t count)
+	{
+		for (size_t pos = 0; pos < count; ++pos) {
+			onHQNodeDecoded(timestamps_uS[pos], nodes + pos);
+		}
+	}
 	virtual void onCustomSampleDataDecoded(_u8 ansType, _u32 customCode, const void* data, size_t size) {}
 
 	virtual void onDecodingError(int errMsg, _u8 ansType, const void* payload, size_t size) {}
@@ -84,6 +93,16 @@ public:
 	virtual void reset() = 0;
 	virtual void clearCache() = 0;
 
+	// number of packets dropped because of a checksum (crc) mismatch, never reset
+	virtual _u32 getChecksumErrorCount() const = 0;
+
+	// stamp the samples with a SampleClockModel fitted to their arrival instead of the raw host time, enabled by default
+	virtual void setClockModelEnabled(bool enabled) = 0;
+
+	// the sample period estimated by the clock model, its drift from UNPACKER_CONTEXT_TYPE_LIDAR_TIMING
+	// and the number of times the model lost track of the stream, safe to be called from any thread
+	virtual void getClockModelStatus(float& samplePeriod_uS, float& drift_ppm, _u32& resyncCount) const = 0;
+
 protected:
 	LIDARSampleDataUnpacker(LIDARSampleDataListener&);
 	LIDARSampleDataListener& _listener;
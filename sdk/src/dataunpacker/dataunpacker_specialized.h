@@ -0,0 +1,218 @@
+/*
+ *  Slamtec LIDAR SDK
+ *
+ *  Copyright (c) 2014 - 2023 Shanghai Slamtec Co., Ltd.
+ *  http://www.slamtec.com
+ *
+ */
+
+ /*
+  *  Sample Data Unpacker System
+  *
+  */
+
+  /*
+	* Redistribution and use in source and binary forms, with or without
+	* modification, are permitted provided that the following conditions are met:
+	*
+	* 1. Redistributions of source code must retain the above copyright notice,
+	*    this list of conditions and the following disclaimer.
+	*
+	* 2. Redistributions in binary form must reproduce the above copyright notice,
+	*    this list of conditions and the following disclaimer in the documentation
+	*    and/or other materials provided with the distribution.
+	*
+	* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+	* AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+	* THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+	* PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+	* CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+	* EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+	* PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+	* OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+	* WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+	* OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+	* EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+	*
+	*/
+
+#pragma once
+
+#include "dataunnpacker_commondef.h"
+#include "dataunpacker.h"
+#include "dataunnpacker_internal.h"
+#include "sample_clock_model.h"
+
+#include "unpacker/handler_capsules.h"
+#include "unpacker/handler_hqnode.h"
+#include "unpacker/handler_normalnode.h"
+
+#include <algorithm>
+#include <atomic>
+
+BEGIN_DATAUNPACKER_NS()
+
+// An unpacker bound at compile time to the handler of a single answer type and to the class
+// of its listener, for streams whose scan mode is known when they are started.
+// The handler is called directly instead of being looked up and dispatched per packet, and the
+// decoded nodes reach TListener::onHQNodesDecoded by a direct call, so the listener can be
+// inlined into the publishing when this template is instantiated in the listener's own unit.
+// The data of any other answer type is not consumed (onSampleData returns false).
+template <class THandler, class TListener>
+class LIDARSampleDataUnpackerSpecialized final : public LIDARSampleDataUnpackerInner
+{
+public:
+	enum {
+		CLOCK_STAMP_BATCH_SIZE = 128,
+	};
+
+	LIDARSampleDataUnpackerSpecialized(TListener& listener)
+		: LIDARSampleDataUnpackerInner(listener)
+		, _typedListener(listener)
+		, _answerType(0)
+		, _enabled(false)
+		, _checksumErrorCount(0)
+		, _clockModelEnabled(true)
+	{
+		_answerType = _handler.THandler::getSampleAnswerType();
+	}
+
+	virtual void updateUnpackerContext(UnpackerContextType type, const void* data, size_t size)
+	{
+		if (type == UNPACKER_CONTEXT_TYPE_LIDAR_TIMING && size == sizeof(SlamtecLidarTimingDesc)) {
+			_clockModel.setNominalPeriod(reinterpret_cast<const SlamtecLidarTimingDesc*>(data)->sample_duration_uS);
+		}
+		_handler.THandler::onUnpackerContextSet(type, data, size);
+	}
+
+	virtual void enable()
+	{
+		_enabled = true;
+		reset();
+	}
+
+	virtual void disable()
+	{
+		_enabled = false;
+		reset();
+	}
+
+	virtual bool onSampleData(_u8 ansType, const void* buffer, size_t size)
+	{
+		if (!_enabled || ansType != _answerType) return false;
+		_handler.THandler::onData(this, reinterpret_cast<const _u8*>(buffer), size);
+		return true;
+	}
+
+	virtual void reset()
+	{
+		clearCache();
+		_clockModel.reset();
+	}
+
+	virtual void clearCache()
+	{
+		_handler.THandler::reset();
+	}
+
+	virtual _u32 getChecksumErrorCount() const
+	{
+		return _checksumErrorCount.load();
+	}
+
+	virtual void setClockModelEnabled(bool enabled)
+	{
+		_clockModelEnabled = enabled;
+	}
+
+	virtual void getClockModelStatus(float& samplePeriod_uS, float& drift_ppm, _u32& resyncCount) const
+	{
+		samplePeriod_uS = _clockModel.getEstimatedPeriod_uS();
+		drift_ppm = _clockModel.getDrift_ppm();
+		resyncCount = _clockModel.getResyncCount();
+	}
+
+	virtual _u64 getCurrentTimestamp_uS()
+	{
+		return getus();
+	}
+
+	virtual void publishHQNode(_u64 timestamp_uS, const rplidar_response_measurement_node_hq_t* node)
+	{
+		if (_clockModelEnabled) timestamp_uS = _clockModel.stampSample(timestamp_uS);
+		_typedListener.TListener::onHQNodeDecoded(timestamp_uS, node);
+	}
+
+	virtual void publishHQNodes(const _u64* timestamps_uS, const rplidar_response_measurement_node_hq_t* nodes, size_t count)
+	{
+		if (!_clockModelEnabled) {
+			_typedListener.TListener::onHQNodesDecoded(timestamps_uS, nodes, count);
+			return;
+		}
+
+		while (count) {
+			size_t batchSize = std::min<size_t>(count, CLOCK_STAMP_BATCH_SIZE);
+			for (size_t pos = 0; pos < batchSize; ++pos) {
+				_stampedTimestamps_uS[pos] = _clockModel.stampSample(timestamps_uS[pos]);
+			}
+			_typedListener.TListener::onHQNodesDecoded(_stampedTimestamps_uS, nodes, batchSize);
+
+			timestamps_uS += batchSize;
+			nodes += batchSize;
+			count -= batchSize;
+		}
+	}
+
+	virtual void publishDecodingErrorMsg(int errorType, _u8 ansType, const void* payload, size_t size)
+	{
+		if (errorType == ERR_EVENT_ON_EXP_CHECKSUM_ERR) ++_checksumErrorCount;
+		_typedListener.TListener::onDecodingError(errorType, ansType, payload, size);
+	}
+
+	virtual void publishCustomData(_u8 ansType, _u32 customCode, const void* payload, size_t size)
+	{
+		_typedListener.TListener::onCustomSampleDataDecoded(ansType, customCode, payload, size);
+	}
+
+	virtual void publishNewScanReset()
+	{
+		_typedListener.TListener::onHQNodeScanResetReq();
+	}
+
+protected:
+	TListener&       _typedListener;
+	THandler         _handler;
+	_u8              _answerType;
+	bool             _enabled;
+
+	// read by the client threads
+	std::atomic<_u32> _checksumErrorCount;
+
+	bool             _clockModelEnabled;
+	SampleClockModel _clockModel;
+	_u64             _stampedTimestamps_uS[CLOCK_STAMP_BATCH_SIZE];
+};
+
+// The specialized unpacker of the answer type, NULL if no handler decodes it
+template <class TListener>
+LIDARSampleDataUnpacker* CreateSpecializedDataUnpacker(_u8 ansType, TListener& listener)
+{
+	switch (ansType) {
+	case SL_LIDAR_ANS_TYPE_MEASUREMENT:
+		return new LIDARSampleDataUnpackerSpecialized<unpacker::UnpackerHandler_NormalNode, TListener>(listener);
+	case SL_LIDAR_ANS_TYPE_MEASUREMENT_CAPSULED:
+		return new LIDARSampleDataUnpackerSpecialized<unpacker::UnpackerHandler_CapsuleNode, TListener>(listener);
+	case SL_LIDAR_ANS_TYPE_MEASUREMENT_HQ:
+		return new LIDARSampleDataUnpackerSpecialized<unpacker::UnpackerHandler_HQNode, TListener>(listener);
+	case SL_LIDAR_ANS_TYPE_MEASUREMENT_CAPSULED_ULTRA:
+		return new LIDARSampleDataUnpackerSpecialized<unpacker::UnpackerHandler_UltraCapsuleNode, TListener>(listener);
+	case SL_LIDAR_ANS_TYPE_MEASUREMENT_DENSE_CAPSULED:
+		return new LIDARSampleDataUnpackerSpecialized<unpacker::UnpackerHandler_DenseCapsuleNode, TListener>(listener);
+	case SL_LIDAR_ANS_TYPE_MEASUREMENT_ULTRA_DENSE_CAPSULED:
+		return new LIDARSampleDataUnpackerSpecialized<unpacker::UnpackerHandler_UltraDenseCapsuleNode, TListener>(listener);
+	default:
+		return nullptr;
+	}
+}
+
+END_DATAUNPACKER_NS()
@@ -0,0 +1,158 @@
+/*
+ *  Slamtec LIDAR SDK
+ *
+ *  Copyright (c) 2014 - 2023 Shanghai Slamtec Co., Ltd.
+ *  http://www.slamtec.com
+ *
+ */
+
+ /*
+  *  Sample Data Unpacker System
+  *
+  */
+
+  /*
+	* Redistribution and use in source and binary forms, with or without
+	* modification, are permitted provided that the following conditions are met:
+	*
+	* 1. Redistributions of source code must retain the above copyright notice,
+	*    this list of conditions and the following disclaimer.
+	*
+	* 2. Redistributions in binary form must reproduce the above copyright notice,
+	*    this list of conditions and the following disclaimer in the documentation
+	*    and/or other materials provided with the distribution.
+	*
+	* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+	* AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+	* THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+	* PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+	* CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+	* EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+	* PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+	* OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+	* WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+	* OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+	* EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+	*
+	*/
+
+#include "dataunnpacker_commondef.h"
+#include "sample_clock_model.h"
+
+BEGIN_DATAUNPACKER_NS()
+
+SampleClockModel::SampleClockModel()
+	: _nominalPeriod_q16(0)
+	, _periodMin_q16(0)
+	, _periodMax_q16(0)
+	, _period_q16(0)
+	, _windowSampleCount(MIN_WINDOW_SAMPLE_COUNT)
+	, _locked(false)
+	, _next_q16(0)
+	, _lastStamp_uS(0)
+	, _windowPos(0)
+	, _windowMinError_q16(0)
+	, _windowCorrection_q16(0)
+	, _publishedPeriod_q16(0)
+	, _resyncCount(0)
+{
+}
+
+void SampleClockModel::setNominalPeriod(_u32 period_uS)
+{
+	_nominalPeriod_q16 = period_uS << PERIOD_FRAC_BITS;
+	_periodMin_q16 = _nominalPeriod_q16 - (_nominalPeriod_q16 >> PERIOD_LIMIT_SHIFT);
+	_periodMax_q16 = _nominalPeriod_q16 + (_nominalPeriod_q16 >> PERIOD_LIMIT_SHIFT);
+	_period_q16 = _nominalPeriod_q16;
+	_publishedPeriod_q16 = _period_q16;
+
+	_windowSampleCount = period_uS ? (WINDOW_DURATION_US / period_uS) : 0;
+	if (_windowSampleCount < MIN_WINDOW_SAMPLE_COUNT) _windowSampleCount = MIN_WINDOW_SAMPLE_COUNT;
+
+	reset();
+}
+
+void SampleClockModel::reset()
+{
+	_locked = false;
+	_windowPos = 0;
+	_windowCorrection_q16 = 0;
+}
+
+_u64 SampleClockModel::stampSample(_u64 rawTimestamp_uS)
+{
+	if (!_period_q16) return rawTimestamp_uS;
+
+	_s64 raw_q16 = (_s64)(rawTimestamp_uS << PERIOD_FRAC_BITS);
+	_s64 predicted_q16 = (_s64)_next_q16;
+	_s64 error_q16 = raw_q16 - predicted_q16;
+
+	_s64 resyncLimit_q16 = (_s64)_period_q16 * RESYNC_PERIOD_COUNT;
+	if (resyncLimit_q16 < ((_s64)RESYNC_MIN_TIME_US << PERIOD_FRAC_BITS)) {
+		resyncLimit_q16 = ((_s64)RESYNC_MIN_TIME_US << PERIOD_FRAC_BITS);
+	}
+
+	if (!_locked || error_q16 > resyncLimit_q16 || error_q16 < -resyncLimit_q16) {
+		if (_locked) ++_resyncCount;
+		_locked = true;
+		predicted_q16 = raw_q16;
+		_windowPos = 0;
+		_windowCorrection_q16 = 0;
+		_windowMinError_q16 = 0;
+	}
+	else {
+		if (error_q16 < 0) {
+			// the sample cannot have been taken after it was received
+			predicted_q16 = raw_q16;
+			_windowCorrection_q16 += error_q16;
+			error_q16 = 0;
+		}
+
+		if (!_windowPos || error_q16 < _windowMinError_q16) _windowMinError_q16 = error_q16;
+	}
+
+	_u64 stamp_uS = (_u64)predicted_q16 >> PERIOD_FRAC_BITS;
+	if (stamp_uS <= _lastStamp_uS) stamp_uS = _lastStamp_uS + 1;
+	_lastStamp_uS = stamp_uS;
+
+	_next_q16 = (_u64)predicted_q16 + _period_q16;
+
+	if (++_windowPos >= _windowSampleCount) _closeWindow();
+	return stamp_uS;
+}
+
+void SampleClockModel::_closeWindow()
+{
+	// none of the samples arrived as early as predicted, the clock is behind
+	_next_q16 += _windowMinError_q16;
+	_windowCorrection_q16 += _windowMinError_q16;
+
+	_s64 period_q16 = (_s64)_period_q16 + (_windowCorrection_q16 / (_s64)_windowPos) / (1 << PERIOD_GAIN_SHIFT);
+	if (period_q16 < (_s64)_periodMin_q16) period_q16 = _periodMin_q16;
+	if (period_q16 > (_s64)_periodMax_q16) period_q16 = _periodMax_q16;
+	_period_q16 = (_u32)period_q16;
+	_publishedPeriod_q16.store(_period_q16, std::memory_order_relaxed);
+
+	_windowPos = 0;
+	_windowCorrection_q16 = 0;
+	_windowMinError_q16 = 0;
+}
+
+float SampleClockModel::getEstimatedPeriod_uS() const
+{
+	return (float)_publishedPeriod_q16.load(std::memory_order_relaxed) / (1 << PERIOD_FRAC_BITS);
+}
+
+float SampleClockModel::getDrift_ppm() const
+{
+	if (!_nominalPeriod_q16) return 0;
+	_u32 period_q16 = _publishedPeriod_q16.load(std::memory_order_relaxed);
+	return (float)(((double)period_q16 - (double)_nominalPeriod_q16) * 1e6 / (double)_nominalPeriod_q16);
+}
+
+_u32 SampleClockModel::getResyncCount() const
+{
+	return _resyncCount.load(std::memory_order_relaxed);
+}
+
+END_DATAUNPACKER_NS()
@@ -0,0 +1,102 @@
+/*
+ *  Slamtec LIDAR SDK
+ *
+ *  Copyright (c) 2014 - 2023 Shanghai Slamtec Co., Ltd.
+ *  http://www.slamtec.com
+ *
+ */
+
+ /*
+  *  Sample Data Unpacker System
+  *
+  */
+
+  /*
+	* Redistribution and use in source and binary forms, with or without
+	* modification, are permitted provided that the following conditions are met:
+	*
+	* 1. Redistributions of source code must retain the above copyright notice,
+	*    this list of conditions and the following disclaimer.
+	*
+	* 2. Redistributions in binary form must reproduce the above copyright notice,
+	*    this list of conditions and the following disclaimer in the documentation
+	*    and/or other materials provided with the distribution.
+	*
+	* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+	* AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+	* THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+	* PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+	* CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+	* EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+	* PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+	* OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+	* WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+	* OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+	* EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+	*
+	*/
+
+#pragma once
+
+#include <atomic>
+
+BEGIN_DATAUNPACKER_NS()
+
+// Maps the host time of the decoded samples onto a steady sample clock.
+// The device takes a sample every sample_duration_uS (give or take the drift of its crystal)
+// while the host time derived from the arrival of the packets also carries the transmission
+// and scheduling jitter, which can only ever delay a packet. So the model follows the lower
+// envelope of the arrivals: a sample observed earlier than predicted moves the clock back at
+// once, and the earliest arrival of every window moves it forward. The phase corrections made
+// over a window tell how far the estimated sample period is off.
+class SampleClockModel
+{
+public:
+	enum {
+		PERIOD_FRAC_BITS = 16,
+		WINDOW_DURATION_US = 100000,
+		MIN_WINDOW_SAMPLE_COUNT = 64,
+		PERIOD_GAIN_SHIFT = 2,      // a quarter of the period error found in a window is corrected
+		PERIOD_LIMIT_SHIFT = 4,     // the estimate stays within 1/16 of the nominal period
+		RESYNC_MIN_TIME_US = 20000, // and a sample off by more than this (or 64 periods) restarts the clock
+		RESYNC_PERIOD_COUNT = 64,
+	};
+
+	SampleClockModel();
+
+	// 0 to pass the timestamps through
+	void setNominalPeriod(_u32 period_uS);
+
+	// the stream was interrupted, the period estimate is kept
+	void reset();
+
+	// returns the timestamp of the next sample of the stream, the timestamps are monotonic
+	_u64 stampSample(_u64 rawTimestamp_uS);
+
+	// safe to be called from any thread
+	float getEstimatedPeriod_uS() const;
+	float getDrift_ppm() const;
+	_u32  getResyncCount() const;
+
+protected:
+	void _closeWindow();
+
+	_u32  _nominalPeriod_q16;
+	_u32  _periodMin_q16;
+	_u32  _periodMax_q16;
+	_u32  _period_q16;
+	_u32  _windowSampleCount;
+
+	bool  _locked;
+	_u64  _next_q16;            // predicted host time of the next sample
+	_u64  _lastStamp_uS;
+
+	_u32  _windowPos;
+	_s64  _windowMinError_q16;  // the earliest arrival of the window relative to the prediction
+	_s64  _windowCorrection_q16;
+
+	std::atomic<_u32> _publishedPeriod_q16;
+	std::atomic<_u32> _resyncCount;
+};
+
+END_DATAUNPACKER_NS()
@@ -39,6 +39,7 @@
 #include "../dataunnpacker_commondef.h"
 #include "../dataunpacker.h"
 #include "../dataunnpacker_internal.h"
+#include "sl_trace.h"
 
 
 
@@ -106,7 +107,19 @@ _u8 UnpackerHandler_CapsuleNode::getSampleAnswerType() const
 
 void UnpackerHandler_CapsuleNode::onData(LIDARSampleDataUnpackerInner* engine, const _u8* data, size_t cnt)
 {
+    SL_TRACE_SCOPE_ARG(traceScope, "unpacker.capsule", cnt);
     for (size_t pos = 0; pos < cnt; ++pos) {
+        // fast path: the whole capsule is available in the input buffer, skip the byte-wise state machine
+        if (_cached_scan_node_buf_pos == 0 && (cnt - pos) >= sizeof(rplidar_response_capsule_measurement_nodes_t)
+            && (data[pos] >> 4) == RPLIDAR_RESP_MEASUREMENT_EXP_SYNC_1
+            && (data[pos + 1] >> 4) == RPLIDAR_RESP_MEASUREMENT_EXP_SYNC_2)
+        {
+            memcpy(&_cached_scan_node_buf[0], data + pos, sizeof(rplidar_response_capsule_measurement_nodes_t));
+            _onCapsuleReceived(engine);
+            pos += sizeof(rplidar_response_capsule_measurement_nodes_t) - 1;
+            continue;
+        }
+
         _u8 current_data = data[pos];
         switch (_cached_scan_node_buf_pos) {
         case 0: // expect the sync bit 1
@@ -141,59 +154,64 @@ void UnpackerHandler_CapsuleNode::onData(LIDARSampleDataUnpackerInner* engine, c
             _cached_scan_node_buf[sizeof(rplidar_response_capsule_measurement_nodes_t) - 1] = current_data;
             _cached_scan_node_buf_pos = 0;
 
-            rplidar_response_capsule_measurement_nodes_t* node = reinterpret_cast<rplidar_response_capsule_measurement_nodes_t*>(&_cached_scan_node_buf[0]);
-
-            // calc the checksum ...
-            _u8 checksum = 0;
-            _u8 recvChecksum = ((node->s_checksum_1 & 0xF) | (node->s_checksum_2 << 4));
-            for (size_t cpos = offsetof(rplidar_response_capsule_measurement_nodes_t, start_angle_sync_q6);
-                cpos < sizeof(rplidar_response_capsule_measurement_nodes_t); ++cpos)
-            {
-                checksum ^= _cached_scan_node_buf[cpos];
-            }
+            _onCapsuleReceived(engine);
+            continue;
+        }
+        break;
 
-            if (recvChecksum == checksum)
-            {
-                // only consider vaild if the checksum matches...
+        }
+        _cached_scan_node_buf[_cached_scan_node_buf_pos++] = current_data;
+    }
 
-                // perform data endianess convertion if necessary
-#ifdef _CPU_ENDIAN_BIG
-                node->start_angle_sync_q6 = le16_to_cpu(node->start_angle_sync_q6);
-                for (size_t cpos = 0; cpos < _countof(node->cabins); ++cpos) {
-                    node->cabins[cpos].distance_angle_1 = le16_to_cpu(node->cabins[cpos].distance_angle_1);
-                    node->cabins[cpos].distance_angle_2 = le16_to_cpu(node->cabins[cpos].distance_angle_2);
-                }
-#endif
-                if (node->start_angle_sync_q6 & RPLIDAR_RESP_MEASUREMENT_EXP_SYNCBIT)
-                {
-                    if (_is_previous_capsuledataRdy) {
-                        engine->publishDecodingErrorMsg(LIDARSampleDataUnpacker::ERR_EVENT_ON_EXP_ENCODER_RESET
-                            , RPLIDAR_ANS_TYPE_MEASUREMENT_CAPSULED, node, sizeof(*node));
-                    }
-                    // this is the first capsule frame in logic, discard the previous cached data...
-                    _is_previous_capsuledataRdy = false;
-                    engine->publishNewScanReset();
+}
 
+void UnpackerHandler_CapsuleNode::_onCapsuleReceived(LIDARSampleDataUnpackerInner* engine)
+{
+    rplidar_response_capsule_measurement_nodes_t* node = reinterpret_cast<rplidar_response_capsule_measurement_nodes_t*>(&_cached_scan_node_buf[0]);
 
-                }
-                _onScanNodeCapsuleData(*node, engine);
-            }
-            else {
-                _is_previous_capsuledataRdy = false;
+    // calc the checksum ...
+    _u8 checksum = 0;
+    _u8 recvChecksum = ((node->s_checksum_1 & 0xF) | (node->s_checksum_2 << 4));
+    for (size_t cpos = offsetof(rplidar_response_capsule_measurement_nodes_t, start_angle_sync_q6);
+        cpos < sizeof(rplidar_response_capsule_measurement_nodes_t); ++cpos)
+    {
+        checksum ^= _cached_scan_node_buf[cpos];
+    }
 
+    if (recvChecksum == checksum)
+    {
+        // only consider vaild if the checksum matches...
 
-                engine->publishDecodingErrorMsg(LIDARSampleDataUnpacker::ERR_EVENT_ON_EXP_CHECKSUM_ERR
+        // perform data endianess convertion if necessary
+#ifdef _CPU_ENDIAN_BIG
+        node->start_angle_sync_q6 = le16_to_cpu(node->start_angle_sync_q6);
+        for (size_t cpos = 0; cpos < _countof(node->cabins); ++cpos) {
+            node->cabins[cpos].distance_angle_1 = le16_to_cpu(node->cabins[cpos].distance_angle_1);
+            node->cabins[cpos].distance_angle_2 = le16_to_cpu(node->cabins[cpos].distance_angle_2);
+        }
+#endif
+        if (node->start_angle_sync_q6 & RPLIDAR_RESP_MEASUREMENT_EXP_SYNCBIT)
+        {
+            if (_is_previous_capsuledataRdy) {
+                engine->publishDecodingErrorMsg(LIDARSampleDataUnpacker::ERR_EVENT_ON_EXP_ENCODER_RESET
                     , RPLIDAR_ANS_TYPE_MEASUREMENT_CAPSULED, node, sizeof(*node));
-
             }
-            continue;
-        }
-        break;
+            // this is the first capsule frame in logic, discard the previous cached data...
+            _is_previous_capsuledataRdy = false;
+            engine->publishNewScanReset();
+
 
         }
-        _cached_scan_node_buf[_cached_scan_node_buf_pos++] = current_data;
+        _onScanNodeCapsuleData(*node, engine);
     }
+    else {
+        _is_previous_capsuledataRdy = false;
+
+
+        engine->publishDecodingErrorMsg(LIDARSampleDataUnpacker::ERR_EVENT_ON_EXP_CHECKSUM_ERR
+            , RPLIDAR_ANS_TYPE_MEASUREMENT_CAPSULED, node, sizeof(*node));
 
+    }
 }
 
 void UnpackerHandler_CapsuleNode::reset()
@@ -218,6 +236,7 @@ void UnpackerHandler_CapsuleNode::_onScanNodeCapsuleData(rplidar_response_capsul
 
         int angleInc_q16 = (diffAngle_q8 << 3);
         int currentAngle_raw_q16 = (prevStartAngle_q8 << 8);
+        size_t decodedCount = 0;
         for (int pos = 0; pos < (int)_countof(_cached_previous_capsuledata.cabins); ++pos)
         {
             int dist_q2[2];
@@ -253,10 +272,15 @@ void UnpackerHandler_CapsuleNode::_onScanNodeCapsuleData(rplidar_response_capsul
                 hqNode.angle_z_q14 = (angle_q6[cpos] << 8) / 90;
                 hqNode.dist_mm_q2 = dist_q2[cpos];
 
-                engine->publishHQNode(_cached_last_data_timestamp_us - _getSampleDelayOffsetInExpressMode(_cachedTimingDesc, pos * 2 + cpos), &hqNode);
+                _decoded_node_ts[decodedCount] = _cached_last_data_timestamp_us - _getSampleDelayOffsetInExpressMode(_cachedTimingDesc, pos * 2 + cpos);
+                _decoded_nodes[decodedCount++] = hqNode;
             }
 
         }
+
+        if (decodedCount) {
+            engine->publishHQNodes(_decoded_node_ts, _decoded_nodes, decodedCount);
+        }
     }
 
     _cached_previous_capsuledata = capsule;
@@ -323,8 +347,20 @@ _u8 UnpackerHandler_UltraCapsuleNode::getSampleAnswerType() const
 
 void UnpackerHandler_UltraCapsuleNode::onData(LIDARSampleDataUnpackerInner* engine, const _u8* data, size_t cnt)
 {
+    SL_TRACE_SCOPE_ARG(traceScope, "unpacker.ultra_capsule", cnt);
 
     for (size_t pos = 0; pos < cnt; ++pos) {
+        // fast path: the whole capsule is available in the input buffer, skip the byte-wise state machine
+        if (_cached_scan_node_buf_pos == 0 && (cnt - pos) >= sizeof(rplidar_response_ultra_capsule_measurement_nodes_t)
+            && (data[pos] >> 4) == RPLIDAR_RESP_MEASUREMENT_EXP_SYNC_1
+            && (data[pos + 1] >> 4) == RPLIDAR_RESP_MEASUREMENT_EXP_SYNC_2)
+        {
+            memcpy(&_cached_scan_node_buf[0], data + pos, sizeof(rplidar_response_ultra_capsule_measurement_nodes_t));
+            _onCapsuleReceived(engine);
+            pos += sizeof(rplidar_response_ultra_capsule_measurement_nodes_t) - 1;
+            continue;
+        }
+
         _u8 current_data = data[pos];
         switch (_cached_scan_node_buf_pos) {
         case 0: // expect the sync bit 1
@@ -359,58 +395,63 @@ void UnpackerHandler_UltraCapsuleNode::onData(LIDARSampleDataUnpackerInner* engi
             _cached_scan_node_buf[sizeof(rplidar_response_ultra_capsule_measurement_nodes_t) - 1] = current_data;
             _cached_scan_node_buf_pos = 0;
 
-            rplidar_response_ultra_capsule_measurement_nodes_t* node = reinterpret_cast<rplidar_response_ultra_capsule_measurement_nodes_t*>(&_cached_scan_node_buf[0]);
-
-            // calc the checksum ...
-            _u8 checksum = 0;
-            _u8 recvChecksum = ((node->s_checksum_1 & 0xF) | (node->s_checksum_2 << 4));
-            for (size_t cpos = offsetof(rplidar_response_ultra_capsule_measurement_nodes_t, start_angle_sync_q6);
-                cpos < sizeof(rplidar_response_ultra_capsule_measurement_nodes_t); ++cpos)
-            {
-                checksum ^= _cached_scan_node_buf[cpos];
-            }
+            _onCapsuleReceived(engine);
+            continue;
+        }
+        break;
 
-            if (recvChecksum == checksum)
-            {
-                // only consider vaild if the checksum matches...
+        }
+        _cached_scan_node_buf[_cached_scan_node_buf_pos++] = current_data;
+    }
 
-                // perform data endianess convertion if necessary
-#ifdef _CPU_ENDIAN_BIG
-                node->start_angle_sync_q6 = le16_to_cpu(node->start_angle_sync_q6);
-                for (size_t cpos = 0; cpos < _countof(node->ultra_cabins); ++cpos) {
-                    node->ultra_cabins[cpos].combined_x3 = le32_to_cpu(node->ultra_cabins[cpos].combined_x3);
-                }
-#endif
-                if (node->start_angle_sync_q6 & RPLIDAR_RESP_MEASUREMENT_EXP_SYNCBIT)
-                {
-                    if (_is_previous_capsuledataRdy) {
-                        engine->publishDecodingErrorMsg(LIDARSampleDataUnpacker::ERR_EVENT_ON_EXP_ENCODER_RESET
-                            , RPLIDAR_ANS_TYPE_MEASUREMENT_CAPSULED_ULTRA, node, sizeof(*node));
+}
 
-                    }
-                    // this is the first capsule frame in logic, discard the previous cached data...
-                    _is_previous_capsuledataRdy = false;
+void UnpackerHandler_UltraCapsuleNode::_onCapsuleReceived(LIDARSampleDataUnpackerInner* engine)
+{
+    rplidar_response_ultra_capsule_measurement_nodes_t* node = reinterpret_cast<rplidar_response_ultra_capsule_measurement_nodes_t*>(&_cached_scan_node_buf[0]);
 
-                    engine->publishNewScanReset();
+    // calc the checksum ...
+    _u8 checksum = 0;
+    _u8 recvChecksum = ((node->s_checksum_1 & 0xF) | (node->s_checksum_2 << 4));
+    for (size_t cpos = offsetof(rplidar_response_ultra_capsule_measurement_nodes_t, start_angle_sync_q6);
+        cpos < sizeof(rplidar_response_ultra_capsule_measurement_nodes_t); ++cpos)
+    {
+        checksum ^= _cached_scan_node_buf[cpos];
+    }
 
-                }
-                _onScanNodeUltraCapsuleData(*node, engine);
-            }
-            else {
-                _is_previous_capsuledataRdy = false;
+    if (recvChecksum == checksum)
+    {
+        // only consider vaild if the checksum matches...
 
-                engine->publishDecodingErrorMsg(LIDARSampleDataUnpacker::ERR_EVENT_ON_EXP_CHECKSUM_ERR
+        // perform data endianess convertion if necessary
+#ifdef _CPU_ENDIAN_BIG
+        node->start_angle_sync_q6 = le16_to_cpu(node->start_angle_sync_q6);
+        for (size_t cpos = 0; cpos < _countof(node->ultra_cabins); ++cpos) {
+            node->ultra_cabins[cpos].combined_x3 = le32_to_cpu(node->ultra_cabins[cpos].combined_x3);
+        }
+#endif
+        if (node->start_angle_sync_q6 & RPLIDAR_RESP_MEASUREMENT_EXP_SYNCBIT)
+        {
+            if (_is_previous_capsuledataRdy) {
+                engine->publishDecodingErrorMsg(LIDARSampleDataUnpacker::ERR_EVENT_ON_EXP_ENCODER_RESET
                     , RPLIDAR_ANS_TYPE_MEASUREMENT_CAPSULED_ULTRA, node, sizeof(*node));
 
             }
-            continue;
-        }
-        break;
+            // this is the first capsule frame in logic, discard the previous cached data...
+            _is_previous_capsuledataRdy = false;
+
+            engine->publishNewScanReset();
 
         }
-        _cached_scan_node_buf[_cached_scan_node_buf_pos++] = current_data;
+        _onScanNodeUltraCapsuleData(*node, engine);
     }
+    else {
+        _is_previous_capsuledataRdy = false;
+
+        engine->publishDecodingErrorMsg(LIDARSampleDataUnpacker::ERR_EVENT_ON_EXP_CHECKSUM_ERR
+            , RPLIDAR_ANS_TYPE_MEASUREMENT_CAPSULED_ULTRA, node, sizeof(*node));
 
+    }
 }
 
 void UnpackerHandler_UltraCapsuleNode::reset()
@@ -472,6 +513,7 @@ void UnpackerHandler_UltraCapsuleNode::_onScanNodeUltraCapsuleData(rplidar_respo
 
         int angleInc_q16 = (diffAngle_q8 << 3) / 3;
         int currentAngle_raw_q16 = (prevStartAngle_q8 << 8);
+        size_t decodedCount = 0;
         for (int pos = 0; pos < (int)_countof(_cached_previous_ultracapsuledata.ultra_cabins); ++pos)
         {
             int dist_q2[3];
@@ -567,10 +609,15 @@ void UnpackerHandler_UltraCapsuleNode::_onScanNodeUltraCapsuleData(rplidar_respo
                 hqNode.angle_z_q14 = (angle_q6[cpos] << 8) / 90;
                 hqNode.dist_mm_q2 = dist_q2[cpos];
 
-                engine->publishHQNode(_cached_last_data_timestamp_us - _getSampleDelayOffsetInUltraBoostMode(_cachedTimingDesc, pos * 3 + cpos), &hqNode);
+                _decoded_node_ts[decodedCount] = _cached_last_data_timestamp_us - _getSampleDelayOffsetInUltraBoostMode(_cachedTimingDesc, pos * 3 + cpos);
+                _decoded_nodes[decodedCount++] = hqNode;
             }
 
         }
+
+        if (decodedCount) {
+            engine->publishHQNodes(_decoded_node_ts, _decoded_nodes, decodedCount);
+        }
     }
 
     _cached_previous_ultracapsuledata = capsule;
@@ -610,6 +657,7 @@ UnpackerHandler_DenseCapsuleNode::UnpackerHandler_DenseCapsuleNode()
     : _cached_scan_node_buf_pos(0)
     , _is_previous_capsuledataRdy(false)
     , _cached_last_data_timestamp_us(0)
+    , _last_node_sync_bit(0)
 
 {
     _cached_scan_node_buf.resize(sizeof(rplidar_response_dense_capsule_measurement_nodes_t));
@@ -638,8 +686,20 @@ _u8 UnpackerHandler_DenseCapsuleNode::getSampleAnswerType() const
 
 void UnpackerHandler_DenseCapsuleNode::onData(LIDARSampleDataUnpackerInner* engine, const _u8* data, size_t cnt)
 {
+    SL_TRACE_SCOPE_ARG(traceScope, "unpacker.dense_capsule", cnt);
 
     for (size_t pos = 0; pos < cnt; ++pos) {
+        // fast path: the whole capsule is available in the input buffer, skip the byte-wise state machine
+        if (_cached_scan_node_buf_pos == 0 && (cnt - pos) >= sizeof(rplidar_response_dense_capsule_measurement_nodes_t)
+            && (data[pos] >> 4) == RPLIDAR_RESP_MEASUREMENT_EXP_SYNC_1
+            && (data[pos + 1] >> 4) == RPLIDAR_RESP_MEASUREMENT_EXP_SYNC_2)
+        {
+            memcpy(&_cached_scan_node_buf[0], data + pos, sizeof(rplidar_response_dense_capsule_measurement_nodes_t));
+            _onCapsuleReceived(engine);
+            pos += sizeof(rplidar_response_dense_capsule_measurement_nodes_t) - 1;
+            continue;
+        }
+
         _u8 current_data = data[pos];
         switch (_cached_scan_node_buf_pos) {
         case 0: // expect the sync bit 1
@@ -674,56 +734,61 @@ void UnpackerHandler_DenseCapsuleNode::onData(LIDARSampleDataUnpackerInner* engi
             _cached_scan_node_buf[sizeof(rplidar_response_dense_capsule_measurement_nodes_t) - 1] = current_data;
             _cached_scan_node_buf_pos = 0;
 
-            rplidar_response_dense_capsule_measurement_nodes_t* node = reinterpret_cast<rplidar_response_dense_capsule_measurement_nodes_t*>(&_cached_scan_node_buf[0]);
+            _onCapsuleReceived(engine);
+            continue;
+        }
+        break;
 
-            // calc the checksum ...
-            _u8 checksum = 0;
-            _u8 recvChecksum = ((node->s_checksum_1 & 0xF) | (node->s_checksum_2 << 4));
-            for (size_t cpos = offsetof(rplidar_response_dense_capsule_measurement_nodes_t, start_angle_sync_q6);
-                cpos < sizeof(rplidar_response_dense_capsule_measurement_nodes_t); ++cpos)
-            {
-                checksum ^= _cached_scan_node_buf[cpos];
-            }
+        }
+        _cached_scan_node_buf[_cached_scan_node_buf_pos++] = current_data;
+    }
+}
 
-            if (recvChecksum == checksum)
-            {
-                // only consider vaild if the checksum matches...
+void UnpackerHandler_DenseCapsuleNode::_onCapsuleReceived(LIDARSampleDataUnpackerInner* engine)
+{
+    rplidar_response_dense_capsule_measurement_nodes_t* node = reinterpret_cast<rplidar_response_dense_capsule_measurement_nodes_t*>(&_cached_scan_node_buf[0]);
 
-                // perform data endianess convertion if necessary
-#ifdef _CPU_ENDIAN_BIG
-                node->start_angle_sync_q6 = le16_to_cpu(node->start_angle_sync_q6);
-                for (size_t cpos = 0; cpos < _countof(node->cabins); ++cpos) {
-                    node->cabins[cpos].distance_angle_1 = le16_to_cpu(node->cabins[cpos].distance_angle_1);
-                    node->cabins[cpos].distance_angle_2 = le16_to_cpu(node->cabins[cpos].distance_angle_2);
-                }
-#endif
-                if (node->start_angle_sync_q6 & RPLIDAR_RESP_MEASUREMENT_EXP_SYNCBIT)
-                {
-                    if (_is_previous_capsuledataRdy) {
-                        engine->publishDecodingErrorMsg(LIDARSampleDataUnpacker::ERR_EVENT_ON_EXP_ENCODER_RESET
-                            , RPLIDAR_ANS_TYPE_MEASUREMENT_DENSE_CAPSULED, node, sizeof(*node));
-                    }
-                    // this is the first capsule frame in logic, discard the previous cached data...
-                    _is_previous_capsuledataRdy = false;
-                    engine->publishNewScanReset();
+    // calc the checksum ...
+    _u8 checksum = 0;
+    _u8 recvChecksum = ((node->s_checksum_1 & 0xF) | (node->s_checksum_2 << 4));
+    for (size_t cpos = offsetof(rplidar_response_dense_capsule_measurement_nodes_t, start_angle_sync_q6);
+        cpos < sizeof(rplidar_response_dense_capsule_measurement_nodes_t); ++cpos)
+    {
+        checksum ^= _cached_scan_node_buf[cpos];
+    }
 
+    if (recvChecksum == checksum)
+    {
+        // only consider vaild if the checksum matches...
 
-                }
-                _onScanNodeDenseCapsuleData(*node, engine);
+        // perform data endianess convertion if necessary
+#ifdef _CPU_ENDIAN_BIG
+        node->start_angle_sync_q6 = le16_to_cpu(node->start_angle_sync_q6);
+        for (size_t cpos = 0; cpos < _countof(node->cabins); ++cpos) {
+            node->cabins[cpos].distance_angle_1 = le16_to_cpu(node->cabins[cpos].distance_angle_1);
+            node->cabins[cpos].distance_angle_2 = le16_to_cpu(node->cabins[cpos].distance_angle_2);
+        }
+#endif
+        if (node->start_angle_sync_q6 & RPLIDAR_RESP_MEASUREMENT_EXP_SYNCBIT)
+        {
+            if (_is_previous_capsuledataRdy) {
+                engine->publishDecodingErrorMsg(LIDARSampleDataUnpacker::ERR_EVENT_ON_EXP_ENCODER_RESET
+                    , RPLIDAR_ANS_TYPE_MEASUREMENT_DENSE_CAPSULED, node, sizeof(*node));
             }
-            else {
-                _is_previous_capsuledataRdy = false;
+            // this is the first capsule frame in logic, discard the previous cached data...
+            _is_previous_capsuledataRdy = false;
+            engine->publishNewScanReset();
 
-                engine->publishDecodingErrorMsg(LIDARSampleDataUnpacker::ERR_EVENT_ON_EXP_CHECKSUM_ERR
-                    , RPLIDAR_ANS_TYPE_MEASUREMENT_DENSE_CAPSULED, node, sizeof(*node));
 
-            }
-            continue;
         }
-        break;
+        _onScanNodeDenseCapsuleData(*node, engine);
+    }
+    else {
+        _is_previous_capsuledataRdy = false;
+
+        engine->publishDecodingErrorMsg(LIDARSampleDataUnpacker::ERR_EVENT_ON_EXP_CHECKSUM_ERR
+            , RPLIDAR_ANS_TYPE_MEASUREMENT_DENSE_CAPSULED, node, sizeof(*node));
 
-        }
-        _cached_scan_node_buf[_cached_scan_node_buf_pos++] = current_data;
     }
 }
 
@@ -731,11 +796,11 @@ void UnpackerHandler_DenseCapsuleNode::reset()
 {
     _cached_scan_node_buf_pos = 0;
     _cached_last_data_timestamp_us = 0;
+    _last_node_sync_bit = 0;
 }
 
 void UnpackerHandler_DenseCapsuleNode::_onScanNodeDenseCapsuleData(rplidar_response_dense_capsule_measurement_nodes_t& dense_capsule, LIDARSampleDataUnpackerInner* engine)
 {
-    static int lastNodeSyncBit = 0;
     _u64 currentTs = engine->getCurrentTimestamp_uS();
 
     if (_is_previous_capsuledataRdy) {
@@ -755,6 +820,7 @@ void UnpackerHandler_DenseCapsuleNode::_onScanNodeDenseCapsuleData(rplidar_respo
 
         int angleInc_q16 = (diffAngle_q8 << 8) / 40;
         int currentAngle_raw_q16 = (prevStartAngle_q8 << 8);
+        size_t decodedCount = 0;
         for (int pos = 0; pos < (int)_countof(_cached_previous_dense_capsuledata.cabins); ++pos)
         {
             int dist_q2;
@@ -764,7 +830,7 @@ void UnpackerHandler_DenseCapsuleNode::_onScanNodeDenseCapsuleData(rplidar_respo
             dist_q2 = dist << 2;
             angle_q6 = (currentAngle_raw_q16 >> 10);
             syncBit = (((currentAngle_raw_q16 + angleInc_q16) % (360 << 16)) < (angleInc_q16 << 1)) ? 1 : 0;
-            syncBit = (syncBit ^ lastNodeSyncBit) & syncBit;//Ensure that syncBit is exactly detected
+            syncBit = (syncBit ^ _last_node_sync_bit) & syncBit;//Ensure that syncBit is exactly detected
 
             currentAngle_raw_q16 += angleInc_q16;
 
@@ -778,10 +844,15 @@ void UnpackerHandler_DenseCapsuleNode::_onScanNodeDenseCapsuleData(rplidar_respo
             hqNode.quality = dist_q2 ? (0x2F << RPLIDAR_RESP_MEASUREMENT_QUALITY_SHIFT) : 0;
             hqNode.angle_z_q14 = (angle_q6 << 8) / 90;
             hqNode.dist_mm_q2 = dist_q2;
-            engine->publishHQNode(currentTs - _getSampleDelayOffsetInDenseMode(_cachedTimingDesc, pos), &hqNode);
+            _decoded_node_ts[decodedCount] = currentTs - _getSampleDelayOffsetInDenseMode(_cachedTimingDesc, pos);
+            _decoded_nodes[decodedCount++] = hqNode;
             
-            lastNodeSyncBit = syncBit;
+            _last_node_sync_bit = syncBit;
+
+        }
 
+        if (decodedCount) {
+            engine->publishHQNodes(_decoded_node_ts, _decoded_nodes, decodedCount);
         }
     }
 
@@ -851,7 +922,19 @@ _u8 UnpackerHandler_UltraDenseCapsuleNode::getSampleAnswerType() const
 
 void UnpackerHandler_UltraDenseCapsuleNode::onData(LIDARSampleDataUnpackerInner* engine, const _u8* data, size_t cnt)
 {
+    SL_TRACE_SCOPE_ARG(traceScope, "unpacker.ultra_dense_capsule", cnt);
     for (size_t pos = 0; pos < cnt; ++pos) {
+        // fast path: the whole capsule is available in the input buffer, skip the byte-wise state machine
+        if (_cached_scan_node_buf_pos == 0 && (cnt - pos) >= sizeof(rplidar_response_ultra_dense_capsule_measurement_nodes_t)
+            && (data[pos] >> 4) == RPLIDAR_RESP_MEASUREMENT_EXP_SYNC_1
+            && (data[pos + 1] >> 4) == RPLIDAR_RESP_MEASUREMENT_EXP_SYNC_2)
+        {
+            memcpy(&_cached_scan_node_buf[0], data + pos, sizeof(rplidar_response_ultra_dense_capsule_measurement_nodes_t));
+            _onCapsuleReceived(engine);
+            pos += sizeof(rplidar_response_ultra_dense_capsule_measurement_nodes_t) - 1;
+            continue;
+        }
+
         _u8 current_data = data[pos];
         switch (_cached_scan_node_buf_pos) {
         case 0: // expect the sync bit 1
@@ -886,58 +969,63 @@ void UnpackerHandler_UltraDenseCapsuleNode::onData(LIDARSampleDataUnpackerInner*
             _cached_scan_node_buf[sizeof(rplidar_response_ultra_dense_capsule_measurement_nodes_t) - 1] = current_data;
             _cached_scan_node_buf_pos = 0;
 
-            rplidar_response_ultra_dense_capsule_measurement_nodes_t* node = reinterpret_cast<rplidar_response_ultra_dense_capsule_measurement_nodes_t*>(&_cached_scan_node_buf[0]);
+            _onCapsuleReceived(engine);
+            continue;
+        }
+        break;
 
-            // calc the checksum ...
-            _u8 checksum = 0;
-            _u8 recvChecksum = ((node->s_checksum_1 & 0xF) | (node->s_checksum_2 << 4));
-            for (size_t cpos = offsetof(rplidar_response_ultra_dense_capsule_measurement_nodes_t, time_stamp);
-                cpos < sizeof(rplidar_response_ultra_dense_capsule_measurement_nodes_t); ++cpos)
-            {
-                checksum ^= _cached_scan_node_buf[cpos];
-            }
+        }
+        _cached_scan_node_buf[_cached_scan_node_buf_pos++] = current_data;
+    }
 
-            if (recvChecksum == checksum)
-            {
-                // only consider vaild if the checksum matches...
+}
 
-                // perform data endianess convertion if necessary
-#ifdef _CPU_ENDIAN_BIG
-                node->start_angle_sync_q6 = le16_to_cpu(node->start_angle_sync_q6);
-                for (size_t cpos = 0; cpos < _countof(node->cabins); ++cpos) {
-                    node->cabins[cpos].qualityl_distance_scale[0] = le16_to_cpu(node->cabins[cpos].qualityl_distance_scale[0]);
-                    node->cabins[cpos].qualityl_distance_scale[1] = le16_to_cpu(node->cabins[cpos].qualityl_distance_scale[1]);
-                }
-#endif
-                if (node->start_angle_sync_q6 & RPLIDAR_RESP_MEASUREMENT_EXP_SYNCBIT)
-                {
-                    if (_is_previous_capsuledataRdy) {
-                        engine->publishDecodingErrorMsg(LIDARSampleDataUnpacker::ERR_EVENT_ON_EXP_ENCODER_RESET
-                            , RPLIDAR_ANS_TYPE_MEASUREMENT_ULTRA_DENSE_CAPSULED, node, sizeof(*node));
+void UnpackerHandler_UltraDenseCapsuleNode::_onCapsuleReceived(LIDARSampleDataUnpackerInner* engine)
+{
+    rplidar_response_ultra_dense_capsule_measurement_nodes_t* node = reinterpret_cast<rplidar_response_ultra_dense_capsule_measurement_nodes_t*>(&_cached_scan_node_buf[0]);
 
-                    }
-                    // this is the first capsule frame in logic, discard the previous cached data...
-                    _is_previous_capsuledataRdy = false;
-                    engine->publishNewScanReset();
+    // calc the checksum ...
+    _u8 checksum = 0;
+    _u8 recvChecksum = ((node->s_checksum_1 & 0xF) | (node->s_checksum_2 << 4));
+    for (size_t cpos = offsetof(rplidar_response_ultra_dense_capsule_measurement_nodes_t, time_stamp);
+        cpos < sizeof(rplidar_response_ultra_dense_capsule_measurement_nodes_t); ++cpos)
+    {
+        checksum ^= _cached_scan_node_buf[cpos];
+    }
 
-                }
-                _onScanNodeUltraDenseCapsuleData(*node, engine);
-            }
-            else {
-                _is_previous_capsuledataRdy = false;
+    if (recvChecksum == checksum)
+    {
+        // only consider vaild if the checksum matches...
 
-                engine->publishDecodingErrorMsg(LIDARSampleDataUnpacker::ERR_EVENT_ON_EXP_CHECKSUM_ERR
+        // perform data endianess convertion if necessary
+#ifdef _CPU_ENDIAN_BIG
+        node->start_angle_sync_q6 = le16_to_cpu(node->start_angle_sync_q6);
+        for (size_t cpos = 0; cpos < _countof(node->cabins); ++cpos) {
+            node->cabins[cpos].qualityl_distance_scale[0] = le16_to_cpu(node->cabins[cpos].qualityl_distance_scale[0]);
+            node->cabins[cpos].qualityl_distance_scale[1] = le16_to_cpu(node->cabins[cpos].qualityl_distance_scale[1]);
+        }
+#endif
+        if (node->start_angle_sync_q6 & RPLIDAR_RESP_MEASUREMENT_EXP_SYNCBIT)
+        {
+            if (_is_previous_capsuledataRdy) {
+                engine->publishDecodingErrorMsg(LIDARSampleDataUnpacker::ERR_EVENT_ON_EXP_ENCODER_RESET
                     , RPLIDAR_ANS_TYPE_MEASUREMENT_ULTRA_DENSE_CAPSULED, node, sizeof(*node));
 
             }
-            continue;
-        }
-        break;
+            // this is the first capsule frame in logic, discard the previous cached data...
+            _is_previous_capsuledataRdy = false;
+            engine->publishNewScanReset();
 
         }
-        _cached_scan_node_buf[_cached_scan_node_buf_pos++] = current_data;
+        _onScanNodeUltraDenseCapsuleData(*node, engine);
     }
+    else {
+        _is_previous_capsuledataRdy = false;
+
+        engine->publishDecodingErrorMsg(LIDARSampleDataUnpacker::ERR_EVENT_ON_EXP_CHECKSUM_ERR
+            , RPLIDAR_ANS_TYPE_MEASUREMENT_ULTRA_DENSE_CAPSULED, node, sizeof(*node));
 
+    }
 }
 
 void UnpackerHandler_UltraDenseCapsuleNode::reset()
@@ -975,6 +1063,7 @@ void UnpackerHandler_UltraDenseCapsuleNode::_onScanNodeUltraDenseCapsuleData(rpl
 #define DISTANCE_THRESHOLD_TO_SCALE_3 24567 // (2^12 - 1)*4 + 8187 mm
         int angleInc_q16 = (diffAngle_q8 << 8) / 64;
         int currentAngle_raw_q16 = (prevStartAngle_q8 << 8);
+        size_t decodedCount = 0;
         for (int pos = 0; pos < (int)_countof(_cached_previous_ultra_dense_capsuledata.cabins) * 2; ++pos)
         {
             int angle_q6;
@@ -1034,11 +1123,16 @@ void UnpackerHandler_UltraDenseCapsuleNode::_onScanNodeUltraDenseCapsuleData(rpl
             hqNode.quality = quality;
             hqNode.angle_z_q14 = (angle_q6 << 8) / 90;
             hqNode.dist_mm_q2 = dist_q2;
-            engine->publishHQNode(currentTimestamp - _getSampleDelayOffsetInUltraDenseMode(_cachedTimingDesc, pos), &hqNode);
+            _decoded_node_ts[decodedCount] = currentTimestamp - _getSampleDelayOffsetInUltraDenseMode(_cachedTimingDesc, pos);
+            _decoded_nodes[decodedCount++] = hqNode;
             
             _last_node_sync_bit = syncBit;
 
         }
+
+        if (decodedCount) {
+            engine->publishHQNodes(_decoded_node_ts, _decoded_nodes, decodedCount);
+        }
     }
 
     _cached_previous_ultra_dense_capsuledata = *ultra_dense_capsule;
@@ -53,6 +53,7 @@ public:
 	virtual void onUnpackerContextSet(LIDARSampleDataUnpacker::UnpackerContextType type, const void* data, size_t size);
 protected:
 
+	void _onCapsuleReceived(LIDARSampleDataUnpackerInner* engine);
 	void _onScanNodeCapsuleData(rplidar_response_capsule_measurement_nodes_t &, LIDARSampleDataUnpackerInner* engine);
 
 	std::vector<_u8> _cached_scan_node_buf;
@@ -62,6 +63,11 @@ protected:
 	rplidar_response_capsule_measurement_nodes_t _cached_previous_capsuledata;
 	_u64             _cached_last_data_timestamp_us;
 
+	// nodes decoded from one capsule, published as a batch
+	enum { NODES_PER_CAPSULE = 16 * 2 };
+	rplidar_response_measurement_node_hq_t _decoded_nodes[NODES_PER_CAPSULE];
+	_u64             _decoded_node_ts[NODES_PER_CAPSULE];
+
 	SlamtecLidarTimingDesc _cachedTimingDesc;
 };
 
@@ -75,6 +81,7 @@ public:
 	virtual void reset();
 	virtual void onUnpackerContextSet(LIDARSampleDataUnpacker::UnpackerContextType type, const void* data, size_t size);
 protected:
+	void _onCapsuleReceived(LIDARSampleDataUnpackerInner* engine);
 	void _onScanNodeUltraCapsuleData(rplidar_response_ultra_capsule_measurement_nodes_t&, LIDARSampleDataUnpackerInner* engine);
 
 
@@ -85,6 +92,11 @@ protected:
 	rplidar_response_ultra_capsule_measurement_nodes_t _cached_previous_ultracapsuledata;
 	_u64             _cached_last_data_timestamp_us;
 
+	// nodes decoded from one capsule, published as a batch
+	enum { NODES_PER_CAPSULE = 32 * 3 };
+	rplidar_response_measurement_node_hq_t _decoded_nodes[NODES_PER_CAPSULE];
+	_u64             _decoded_node_ts[NODES_PER_CAPSULE];
+
 	SlamtecLidarTimingDesc _cachedTimingDesc;
 
 };
@@ -101,6 +113,7 @@ public:
 	virtual void reset();
 	virtual void onUnpackerContextSet(LIDARSampleDataUnpacker::UnpackerContextType type, const void* data, size_t size);
 protected:
+	void _onCapsuleReceived(LIDARSampleDataUnpackerInner* engine);
 	void _onScanNodeDenseCapsuleData(rplidar_response_dense_capsule_measurement_nodes_t&, LIDARSampleDataUnpackerInner* engine);
 
 
@@ -111,6 +124,13 @@ protected:
 	rplidar_response_dense_capsule_measurement_nodes_t _cached_previous_dense_capsuledata;
 	_u64             _cached_last_data_timestamp_us;
 
+	int              _last_node_sync_bit;
+
+	// nodes decoded from one capsule, published as a batch
+	enum { NODES_PER_CAPSULE = 40 };
+	rplidar_response_measurement_node_hq_t _decoded_nodes[NODES_PER_CAPSULE];
+	_u64             _decoded_node_ts[NODES_PER_CAPSULE];
+
 	SlamtecLidarTimingDesc _cachedTimingDesc;
 
 };
@@ -126,6 +146,7 @@ public:
 	virtual void reset();
 	virtual void onUnpackerContextSet(LIDARSampleDataUnpacker::UnpackerContextType type, const void* data, size_t size);
 protected:
+	void _onCapsuleReceived(LIDARSampleDataUnpackerInner* engine);
 	void _onScanNodeUltraDenseCapsuleData(rplidar_response_ultra_dense_capsule_measurement_nodes_t&, LIDARSampleDataUnpackerInner* engine);
 
 	std::vector<_u8> _cached_scan_node_buf;
@@ -140,6 +161,11 @@ protected:
 	int              _last_node_sync_bit;
 	int              _last_dist_q2;
 
+	// nodes decoded from one capsule, published as a batch
+	enum { NODES_PER_CAPSULE = 32 * 2 };
+	rplidar_response_measurement_node_hq_t _decoded_nodes[NODES_PER_CAPSULE];
+	_u64             _decoded_node_ts[NODES_PER_CAPSULE];
+
 	SlamtecLidarTimingDesc _cachedTimingDesc;
 };
 
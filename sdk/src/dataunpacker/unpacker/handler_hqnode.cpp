@@ -39,10 +39,9 @@
 #include "../dataunnpacker_commondef.h"
 #include "../dataunpacker.h"
 #include "../dataunnpacker_internal.h"
+#include "sl_trace.h"
 
-#ifdef CONF_NO_BOOST_CRC_SUPPORT
 #include "sl_crc.h" 
-#endif
 
 #include "handler_hqnode.h"
 
@@ -74,6 +73,7 @@ static _u64 _getSampleDelayOffsetInHQMode(const SlamtecLidarTimingDesc& timing)
 
 UnpackerHandler_HQNode::UnpackerHandler_HQNode()
     : _cached_scan_node_buf_pos(0)
+    , _crc_state(0)
 {
     _cached_scan_node_buf.resize(sizeof(rplidar_response_hq_capsule_measurement_nodes_t));
     memset(&_cachedTimingDesc, 0, sizeof(_cachedTimingDesc));
@@ -91,86 +91,72 @@ _u8 UnpackerHandler_HQNode::getSampleAnswerType() const
 
 void UnpackerHandler_HQNode::onData(LIDARSampleDataUnpackerInner* engine, const _u8* data, size_t cnt)
 {
+    SL_TRACE_SCOPE_ARG(traceScope, "unpacker.hq", cnt);
+    // the crc covers everything except the trailing crc32 field itself
+    const size_t capsuleSize = sizeof(rplidar_response_hq_capsule_measurement_nodes_t);
+    const size_t crcCoveredSize = capsuleSize - 4;
 
-    for (size_t pos = 0; pos < cnt; ++pos)
+    size_t pos = 0;
+    while (pos < cnt)
     {
-        _u8 current_data = data[pos];
+        if (_cached_scan_node_buf_pos == 0) {
+            // expect the sync byte
+            const _u8* syncByte = reinterpret_cast<const _u8*>(memchr(data + pos, RPLIDAR_RESP_MEASUREMENT_HQ_SYNC, cnt - pos));
+            if (!syncByte) break;
 
-        switch (_cached_scan_node_buf_pos)
-        {
-        case 0: // expect the sync byte
-        {
-            if (current_data == RPLIDAR_RESP_MEASUREMENT_HQ_SYNC) {
-                // pass
-            }
-            else {
-                continue;
-            }
+            pos = syncByte - data;
+            _crc_state = crc32::begin();
         }
-        break;
 
-        case sizeof(rplidar_response_hq_capsule_measurement_nodes_t) - 1 - 4:    // get bytes to calculate crc ready
-        {
-           
+        // copy as much of the capsule as available and feed the crc in the same pass
+        size_t chunkSize = std::min<size_t>(cnt - pos, capsuleSize - _cached_scan_node_buf_pos);
+        memcpy(&_cached_scan_node_buf[_cached_scan_node_buf_pos], data + pos, chunkSize);
+
+        if ((size_t)_cached_scan_node_buf_pos < crcCoveredSize) {
+            size_t crcChunkSize = std::min<size_t>(chunkSize, crcCoveredSize - _cached_scan_node_buf_pos);
+            _crc_state = crc32::update(_crc_state, data + pos, (_u32)crcChunkSize);
         }
-        break;
 
-        case sizeof(rplidar_response_hq_capsule_measurement_nodes_t) - 1: // new data ready
-        {
-            _cached_scan_node_buf[sizeof(rplidar_response_hq_capsule_measurement_nodes_t) - 1] = current_data;
+        _cached_scan_node_buf_pos += (int)chunkSize;
+        pos += chunkSize;
+
+        if ((size_t)_cached_scan_node_buf_pos == capsuleSize) {
+            // new data ready
             _cached_scan_node_buf_pos = 0;
-            rplidar_response_hq_capsule_measurement_nodes_t* nodesData = reinterpret_cast<rplidar_response_hq_capsule_measurement_nodes_t*>(&_cached_scan_node_buf[0]);
-
-#ifdef CONF_NO_BOOST_CRC_SUPPORT
-            _u32 crcCalc = crc32::getResult(&_cached_scan_node_buf[0], sizeof(sl_lidar_response_hq_capsule_measurement_nodes_t) - 4);
-
-
-#else
-            // calculate crc with boost crc method
-            boost::crc_optimal<32, 0x04C11DB7, 0xFFFFFFFF, 0xFFFFFFFF, true, true> mycrc;
-            std::vector<_u8> crcInputData;
-            crcInputData.resize(sizeof(rplidar_response_hq_capsule_measurement_nodes_t) - 4);
-            memcpy(&crcInputData[0], nodesData, sizeof(rplidar_response_hq_capsule_measurement_nodes_t) - 4);
-            //supplement crcInputData to mutiples of 4
-            int leftBytes = 4 - (crcInputData.size() & 3);
-            for (int i = 0; i < leftBytes; i++)
-                crcInputData.push_back(0);
-            mycrc.process_bytes(&crcInputData[0], crcInputData.size());
-            _u32 crcCalc = mycrc.checksum();
-            
-#endif
+            _onCapsuleReceived(engine, crc32::finish(_crc_state, (_u32)crcCoveredSize));
+        }
+    }
+}
 
-            _u32 recvCRC = nodesData->crc32;
+void UnpackerHandler_HQNode::_onCapsuleReceived(LIDARSampleDataUnpackerInner* engine, _u32 crcCalc)
+{
+    rplidar_response_hq_capsule_measurement_nodes_t* nodesData = reinterpret_cast<rplidar_response_hq_capsule_measurement_nodes_t*>(&_cached_scan_node_buf[0]);
+
+    _u32 recvCRC = nodesData->crc32;
 #ifdef _CPU_ENDIAN_BIG
-            recvCRC = le32_to_cpu(recvCRC);
-            nodesData->time_stamp = le64_to_cpu(nodesData->time_stamp);
+    recvCRC = le32_to_cpu(recvCRC);
+    nodesData->time_stamp = le64_to_cpu(nodesData->time_stamp);
 #endif
-            if (recvCRC == crcCalc)
-            {
-                for (size_t pos = 0; pos < _countof(nodesData->node_hq); ++pos)
-                {
-                    rplidar_response_measurement_node_hq_t hqNode = nodesData->node_hq[pos];
+    if (recvCRC == crcCalc)
+    {
+        const _u64 timestamp_uS = engine->getCurrentTimestamp_uS() - _getSampleDelayOffsetInHQMode(_cachedTimingDesc);
+        for (size_t pos = 0; pos < _countof(nodesData->node_hq); ++pos)
+        {
+            rplidar_response_measurement_node_hq_t& hqNode = _decoded_nodes[pos];
+            hqNode = nodesData->node_hq[pos];
 #ifdef _CPU_ENDIAN_BIG
-                    hqNode.angle_z_q14 = le16_to_cpu(hqNode.angle_z_q14);
-                    hqNode.dist_mm_q2 = le32_to_cpu(hqNode.dist_mm_q2);
+            hqNode.angle_z_q14 = le16_to_cpu(hqNode.angle_z_q14);
+            hqNode.dist_mm_q2 = le32_to_cpu(hqNode.dist_mm_q2);
 #endif
-                    engine->publishHQNode(engine->getCurrentTimestamp_uS() - _getSampleDelayOffsetInHQMode(_cachedTimingDesc), &hqNode);
-                }
-            }
-            else  //crc check not passed 
-            {
-                engine->publishDecodingErrorMsg(LIDARSampleDataUnpacker::ERR_EVENT_ON_EXP_CHECKSUM_ERR
-                    , RPLIDAR_ANS_TYPE_MEASUREMENT_HQ, nodesData, sizeof(*nodesData));
-            }
-            continue;
-        }
-        break;
-
-
+            _decoded_node_ts[pos] = timestamp_uS;
         }
-        _cached_scan_node_buf[_cached_scan_node_buf_pos++] = current_data;
+        engine->publishHQNodes(_decoded_node_ts, _decoded_nodes, _countof(nodesData->node_hq));
+    }
+    else  //crc check not passed 
+    {
+        engine->publishDecodingErrorMsg(LIDARSampleDataUnpacker::ERR_EVENT_ON_EXP_CHECKSUM_ERR
+            , RPLIDAR_ANS_TYPE_MEASUREMENT_HQ, nodesData, sizeof(*nodesData));
     }
-
 }
 
 
@@ -53,8 +53,16 @@ namespace unpacker {
 		virtual void onUnpackerContextSet(LIDARSampleDataUnpacker::UnpackerContextType type, const void* data, size_t size);
 
 	protected:
+		void _onCapsuleReceived(LIDARSampleDataUnpackerInner* engine, _u32 crcCalc);
+
 		std::vector<_u8> _cached_scan_node_buf;
 		int              _cached_scan_node_buf_pos;
+		_u32             _crc_state; // crc of the bytes cached so far
+
+		// nodes decoded from one capsule, published as a batch
+		enum { NODES_PER_CAPSULE = 96 };
+		rplidar_response_measurement_node_hq_t _decoded_nodes[NODES_PER_CAPSULE];
+		_u64             _decoded_node_ts[NODES_PER_CAPSULE];
 		SlamtecLidarTimingDesc _cachedTimingDesc;
 	};
 
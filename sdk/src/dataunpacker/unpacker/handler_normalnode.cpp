@@ -39,6 +39,7 @@
 #include "../dataunnpacker_commondef.h"
 #include "../dataunpacker.h"
 #include "../dataunnpacker_internal.h"
+#include "sl_trace.h"
 
 
 #include "handler_normalnode.h"
@@ -86,6 +87,11 @@ _u8 UnpackerHandler_NormalNode::getSampleAnswerType() const
 
 void UnpackerHandler_NormalNode::onData(LIDARSampleDataUnpackerInner* engine, const _u8* data, size_t cnt)
 {
+    SL_TRACE_SCOPE_ARG(traceScope, "unpacker.normal", cnt);
+    // the nodes of one block arrived together and share the timestamp
+    _u64 timestamp_uS = 0;
+    size_t decodedCount = 0;
+
     for (size_t pos = 0; pos < cnt; ++pos) {
         _u8 current_data = data[pos];
         switch (_cached_scan_node_buf_pos) {
@@ -123,14 +129,18 @@ void UnpackerHandler_NormalNode::onData(LIDARSampleDataUnpackerInner* engine, co
             node->distance_q2 = le16_to_cpu(node->distance_q2);
 #endif
             //cast node to rplidar_response_measurement_node_hq_t
-            rplidar_response_measurement_node_hq_t hqNode;
+            rplidar_response_measurement_node_hq_t& hqNode = _decoded_nodes[decodedCount];
             hqNode.angle_z_q14 = (((node->angle_q6_checkbit) >> RPLIDAR_RESP_MEASUREMENT_ANGLE_SHIFT) << 8) / 90;  //transfer to q14 Z-angle
             hqNode.dist_mm_q2 = node->distance_q2;
             hqNode.flag = (node->sync_quality & RPLIDAR_RESP_MEASUREMENT_SYNCBIT);  // trasfer syncbit to HQ flag field
             hqNode.quality = (node->sync_quality >> RPLIDAR_RESP_MEASUREMENT_QUALITY_SHIFT) << RPLIDAR_RESP_MEASUREMENT_QUALITY_SHIFT;  //remove the last two bits and then make quality from 0-63 to 0-255
-            
-            
-            engine->publishHQNode(engine->getCurrentTimestamp_uS() - _getSampleDelayOffsetInLegacyMode(_cachedTimingDesc), &hqNode);
+
+            if (!timestamp_uS) timestamp_uS = engine->getCurrentTimestamp_uS() - _getSampleDelayOffsetInLegacyMode(_cachedTimingDesc);
+            _decoded_node_ts[decodedCount++] = timestamp_uS;
+            if (decodedCount == NODES_PER_BATCH) {
+                engine->publishHQNodes(_decoded_node_ts, _decoded_nodes, decodedCount);
+                decodedCount = 0;
+            }
             continue;
 
         }
@@ -138,6 +148,10 @@ void UnpackerHandler_NormalNode::onData(LIDARSampleDataUnpackerInner* engine, co
         }
         _cached_scan_node_buf[_cached_scan_node_buf_pos++] = current_data;
     }
+
+    if (decodedCount) {
+        engine->publishHQNodes(_decoded_node_ts, _decoded_nodes, decodedCount);
+    }
 }
 
 
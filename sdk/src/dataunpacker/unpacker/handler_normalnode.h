@@ -55,6 +55,11 @@ protected:
 	std::vector<_u8> _cached_scan_node_buf;
 	int              _cached_scan_node_buf_pos;
 
+	// nodes decoded from one block of data, published as a batch
+	enum { NODES_PER_BATCH = 128 };
+	rplidar_response_measurement_node_hq_t _decoded_nodes[NODES_PER_BATCH];
+	_u64             _decoded_node_ts[NODES_PER_BATCH];
+
 	SlamtecLidarTimingDesc _cachedTimingDesc;
 };
 
@@ -47,6 +47,13 @@ public:
         ANS_DEV_ERR = -2,
     };
 
+    // flags of bind()
+    enum {
+        // ask the driver to hand over the received bytes right away instead of buffering them
+        // (the latency timer of the USB adapters), it is a hint and ignored where not supported
+        BIND_FLAG_LOW_LATENCY = 0x1 << 0,
+    };
+
     static serial_rxtx * CreateRxTx();
     static void ReleaseRxTx( serial_rxtx * );
 
@@ -69,10 +76,34 @@ public:
 
     virtual size_t rxqueue_count() = 0;
 
+    // wait for incoming data and read what is available (up to size bytes) straight into the buffer
+    // returns ANS_OK with the received size (0 for a spurious wakeup), ANS_TIMEOUT or ANS_DEV_ERR
+    virtual int waitandrecv(unsigned char * data, size_t size, _u32 timeout, size_t * received)
+    {
+        size_t ready = 0;
+        *received = 0;
+
+        int ans = waitfordata(1, timeout, &ready);
+        if (ans != ANS_OK) return ans;
+
+        int rxSize = recvdata(data, ready < size ? ready : size);
+        if (rxSize <= 0) return ANS_DEV_ERR;
+
+        *received = (size_t)rxSize;
+        return ANS_OK;
+    }
+
+    // let waitandrecv wait until about the given count of bytes has arrived (0 to disable),
+    // it trades some latency for fewer wakeups on high baudrates
+    virtual void setRxBatchThreshold(size_t bytes) {}
+
     virtual void setDTR() = 0;
     virtual void clearDTR() = 0;
     virtual void cancelOperation() {}
 
+    // the OS handle that can be watched by a poller (e.g. epoll), -1 if not available
+    virtual int getPollableHandle() { return -1; }
+
     virtual bool isOpened()
     {
         return _is_serial_opened;
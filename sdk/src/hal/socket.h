@@ -90,6 +90,15 @@ public:
 
     virtual u_result waitforSent(_u32 timeout  = DEFAULT_SOCKET_TIMEOUT) = 0;
     virtual u_result waitforData(_u32 timeout  = DEFAULT_SOCKET_TIMEOUT)  = 0;
+
+    // the OS handle that can be watched by a poller (e.g. epoll), -1 if not available
+    virtual int getPollableHandle() { return -1; }
+
+    // bytes that can be received without being blocked, for a datagram socket it is the size of the next datagram
+    virtual u_result getRxPendingSize(size_t & size) { size = 0; return RESULT_OPERATION_NOT_SUPPORT; }
+
+    // the size of the kernel receive buffer (SO_RCVBUF), the OS may round or cap it
+    virtual u_result setRxBufferSize(size_t size) { return RESULT_OPERATION_NOT_SUPPORT; }
 protected:
     SocketBase() {} 
 };
@@ -139,6 +148,28 @@ public:
     virtual u_result sendTo(const SocketAddress * target, const void * buffer, size_t len) = 0;
     virtual u_result recvFrom(void *buf, size_t len, size_t & recv_len, SocketAddress * sourceAddr = NULL) = 0;
     virtual u_result clearRxCache() = 0;
+
+    // IPv4 multicast: join the group to receive its datagrams (bind to the group port first),
+    // interfaceAddr selects the local interface, NULL for the default one
+    virtual u_result joinMulticastGroup(const SocketAddress & group, const SocketAddress * interfaceAddr = NULL) { return RESULT_OPERATION_NOT_SUPPORT; }
+    // hop limit and local loopback of the multicast datagrams sent
+    virtual u_result setMulticastOptions(int ttl, bool loopback = true) { return RESULT_OPERATION_NOT_SUPPORT; }
+
+    // stamp the received datagrams with the kernel receive time, see recvFromBatch
+    virtual u_result enableRxTimestamp(bool enable = true) { return RESULT_OPERATION_NOT_SUPPORT; }
+
+    // receive the pending datagrams back to back into buf without waiting, each datagram may take up to maxDatagramSize bytes
+    // (the larger ones are truncated), it stops before a datagram which does not fit in the buffer.
+    // rx_timestamp_us (optional) gets the kernel receive time of the first datagram in the getus() time base, 0 if unavailable
+    virtual u_result recvFromBatch(void *buf, size_t len, size_t maxDatagramSize, size_t & recv_len, size_t & datagram_count, _u64 * rx_timestamp_us = NULL)
+    {
+        // one datagram per call by default
+        if (rx_timestamp_us) *rx_timestamp_us = 0;
+        datagram_count = 0;
+        u_result ans = recvFrom(buf, len, recv_len);
+        if (IS_OK(ans)) datagram_count = 1;
+        return ans;
+    }
     
 protected:
     virtual ~DGramSocket() {} // use dispose();
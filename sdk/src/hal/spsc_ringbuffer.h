@@ -0,0 +1,190 @@
+/*
+ *  Slamtec LIDAR SDK
+ *
+ *  Copyright (c) 2014 - 2023 Shanghai Slamtec Co., Ltd.
+ *  http://www.slamtec.com
+ *
+ */
+ /*
+  * Redistribution and use in source and binary forms, with or without
+  * modification, are permitted provided that the following conditions are met:
+  *
+  * 1. Redistributions of source code must retain the above copyright notice,
+  *    this list of conditions and the following disclaimer.
+  *
+  * 2. Redistributions in binary form must reproduce the above copyright notice,
+  *    this list of conditions and the following disclaimer in the documentation
+  *    and/or other materials provided with the distribution.
+  *
+  * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+  * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+  * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+  * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+  * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+  * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+  * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+  * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+  * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+  * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+  * EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+  *
+  */
+
+#pragma once
+
+#include <atomic>
+#include <string.h>
+
+namespace rp{ namespace hal{
+
+// Fixed-capacity byte ring shared by exactly one producer thread and one consumer thread.
+// No lock is required as long as each side only calls its own set of methods.
+// The capacity is rounded up to a power of two and allocated once at construction, see setStorage for a buffer owned elsewhere.
+class SPSCByteRing
+{
+public:
+    explicit SPSCByteRing(size_t capacity)
+        : _buffer(NULL)
+        , _capacity(1)
+        , _ownsBuffer(false)
+        , _head(0)
+        , _tail(0)
+    {
+        setStorage(NULL, capacity);
+    }
+
+    ~SPSCByteRing()
+    {
+        if (_ownsBuffer) delete [] _buffer;
+    }
+
+    size_t capacity() const { return _capacity; }
+
+    bool ownsStorage() const { return _ownsBuffer; }
+
+    _u8* storage() const { return _buffer; }
+
+    // replace the storage, the ring allocates its own one when buffer is NULL
+    // the capacity of a given buffer has to be a power of two
+    // only valid when neither the producer nor the consumer is running, the content is lost
+    void setStorage(_u8* buffer, size_t capacity)
+    {
+        clear();
+        if (!buffer && _ownsBuffer && capacity <= _capacity && capacity * 2 > _capacity) return;
+        if (_ownsBuffer) delete [] _buffer;
+
+        if (buffer) {
+            assert(capacity && !(capacity & (capacity - 1)));
+            _buffer = buffer;
+            _capacity = capacity;
+            _ownsBuffer = false;
+        }
+        else {
+            _capacity = 1;
+            while (_capacity < capacity) _capacity <<= 1;
+            _buffer = new _u8[_capacity];
+            _ownsBuffer = true;
+        }
+    }
+
+    // producer side
+
+    // returns the contiguous free region starting at the write position
+    _u8* getWritableRegion(size_t& size)
+    {
+        size_t head = _head.load(std::memory_order_relaxed);
+        size_t tail = _tail.load(std::memory_order_acquire);
+
+        size_t freeSize = _capacity - (head - tail);
+        size_t offset = head & (_capacity - 1);
+        size_t toEnd = _capacity - offset;
+
+        size = freeSize < toEnd ? freeSize : toEnd;
+        return _buffer + offset;
+    }
+
+    void commitWrite(size_t size)
+    {
+        _head.store(_head.load(std::memory_order_relaxed) + size, std::memory_order_release);
+    }
+
+    size_t writableSize() const
+    {
+        return _capacity - (_head.load(std::memory_order_relaxed) - _tail.load(std::memory_order_acquire));
+    }
+
+    // copies the data into the ring, wrapping around if needed
+    // returns the number of bytes actually written
+    size_t write(const void* data, size_t size)
+    {
+        const _u8* src = reinterpret_cast<const _u8*>(data);
+        size_t written = 0;
+
+        while (written < size) {
+            size_t region;
+            _u8* dest = getWritableRegion(region);
+            if (!region) break;
+
+            if (region > size - written) region = size - written;
+            memcpy(dest, src + written, region);
+            commitWrite(region);
+            written += region;
+        }
+        return written;
+    }
+
+    // consumer side
+
+    // returns the contiguous filled region starting at the read position
+    const _u8* getReadableRegion(size_t& size)
+    {
+        size_t tail = _tail.load(std::memory_order_relaxed);
+        size_t head = _head.load(std::memory_order_acquire);
+
+        size_t usedSize = head - tail;
+        size_t offset = tail & (_capacity - 1);
+        size_t toEnd = _capacity - offset;
+
+        size = usedSize < toEnd ? usedSize : toEnd;
+        return _buffer + offset;
+    }
+
+    void commitRead(size_t size)
+    {
+        _tail.store(_tail.load(std::memory_order_relaxed) + size, std::memory_order_release);
+    }
+
+    // can be called from either side, the result is a snapshot
+    size_t size() const
+    {
+        return _head.load(std::memory_order_acquire) - _tail.load(std::memory_order_acquire);
+    }
+
+    bool empty() const
+    {
+        return size() == 0;
+    }
+
+    // only valid when neither the producer nor the consumer is running
+    void clear()
+    {
+        _head.store(0, std::memory_order_relaxed);
+        _tail.store(0, std::memory_order_relaxed);
+    }
+
+private:
+    SPSCByteRing(const SPSCByteRing&);
+    SPSCByteRing& operator=(const SPSCByteRing&);
+
+    _u8*   _buffer;
+    size_t _capacity;
+    bool   _ownsBuffer;
+
+    // keep the producer and consumer indices on different cache lines
+    _u8 _pad0[64];
+    std::atomic<size_t> _head;
+    _u8 _pad1[64];
+    std::atomic<size_t> _tail;
+};
+
+}}
@@ -52,6 +52,13 @@ public:
 		PRIORITY_IDLE     = 4,
 	};
 
+    enum sched_policy_t
+    {
+        SCHED_POLICY_OTHER = 0,
+        SCHED_POLICY_FIFO  = 1,
+        SCHED_POLICY_RR    = 2,
+    };
+
     template <class T, u_result (T::*PROC)(void)>
     static Thread create_member(T * pthis)
     {
@@ -81,6 +88,13 @@ public:
 
     static u_result SetSelfPriority(priority_val_t p);
 
+    // the priority is the static priority for SCHED_POLICY_FIFO/RR and the nice value for SCHED_POLICY_OTHER
+    static u_result SetSelfSchedPolicy(sched_policy_t policy, int priority);
+    // bit n of cpuMask allows the calling thread to run on cpu n
+    static u_result SetSelfAffinity(_u64 cpuMask);
+    // shown by top, perf and ftrace, may be truncated (15 characters on Linux)
+    static u_result SetSelfName(const char* name);
+
 
     bool operator== ( const Thread & right) { return this->_handle == right._handle; }
 protected:
@@ -0,0 +1,63 @@
+/*
+ *  Slamtec LIDAR SDK
+ *
+ *  Copyright (c) 2014 - 2023 Shanghai Slamtec Co., Ltd.
+ *  http://www.slamtec.com
+ *
+ */
+ /*
+  * Redistribution and use in source and binary forms, with or without
+  * modification, are permitted provided that the following conditions are met:
+  *
+  * 1. Redistributions of source code must retain the above copyright notice,
+  *    this list of conditions and the following disclaimer.
+  *
+  * 2. Redistributions in binary form must reproduce the above copyright notice,
+  *    this list of conditions and the following disclaimer in the documentation
+  *    and/or other materials provided with the distribution.
+  *
+  * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+  * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+  * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+  * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+  * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+  * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+  * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+  * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+  * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+  * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+  * EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+  *
+  */
+
+#pragma once
+
+#include "sl_types.h"
+#include <math.h>
+#include <stddef.h>
+
+namespace sl {
+
+    enum {
+        ANGLE_LUT_SIZE = 65536, // one entry per angle_z_q14 step, i.e. 360 degrees
+    };
+
+    struct AngleLUT
+    {
+        float cosValue[ANGLE_LUT_SIZE];
+        float sinValue[ANGLE_LUT_SIZE];
+
+        AngleLUT()
+        {
+            for (size_t pos = 0; pos < ANGLE_LUT_SIZE; ++pos) {
+                double rad = pos * (2.0 * M_PI / ANGLE_LUT_SIZE);
+                cosValue[pos] = (float)cos(rad);
+                sinValue[pos] = (float)sin(rad);
+            }
+        }
+    };
+
+    // shared by the projection and the deskewing routines, see sl_lidar_projection.cpp
+    const AngleLUT& getAngleLUT();
+
+}
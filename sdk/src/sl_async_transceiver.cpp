@@ -42,6 +42,8 @@
 #include "hal/event.h"
 
 #include "sl_async_transceiver.h"
+#include "sl_thread_config.h"
+#include "sl_trace.h"
 
 
 
@@ -176,11 +178,31 @@ void ProtocolMessage::_changeBufSize( bool force_compact)
 }
 
 
-AsyncTransceiver::AsyncTransceiver(IAsyncProtocolCodec& codec)
+AsyncTransceiver::AsyncTransceiver(IAsyncProtocolCodec& codec, size_t rxRingSize)
 	: _bindedChannel(NULL)
 	, _codec(codec)
 	, _isWorking(false)
     , _workingFlag(0)
+    , _isLosslessChannel(false)
+    , _inlineDecoding(false)
+    , _decodingInline(false)
+    , _rxRing(rxRingSize)
+    , _rxBytes(0)
+    , _rxOverflowBytes(0)
+    , _rxOverflowCount(0)
+    , _lastRx_uS(0)
+    , _reactor(NULL)
+    , _reactorRegID(0)
+    , _attachedToReactor(false)
+    , _captureTap(NULL)
+    , _hasCaptureTap(false)
+    , _latencyTracker(NULL)
+    , _rxArrivalMarkHead(0)
+    , _rxArrivalMarkTail(0)
+    , _rxQueuedBytes(0)
+    , _rxDecodedBytes(0)
+    , _decodingArrival_uS(0)
+    , _txMessage(std::make_shared<ProtocolMessage>())
 {
 
 }
@@ -214,16 +236,36 @@ u_result AsyncTransceiver::openChannelAndBind(IChannel* channel)
 
 		_dataEvt.set(false);
 
+        _rxRing.clear();
+        _rxArrivalMarkHead = 0;
+        _rxArrivalMarkTail = 0;
+        _rxQueuedBytes = 0;
+        _rxDecodedBytes = 0;
+
 		_isWorking = true;
         _workingFlag = 0;
         _bindedChannel = channel;
+        _isLosslessChannel = (channel->getChannelType() == CHANNEL_TYPE_REPLAY);
+        channel->registerRxBuffer(_rxRing.storage(), _rxRing.capacity());
 
 
-		_decoderThread = CLASS_THREAD(AsyncTransceiver, _proc_decoderThread);
-		_rxThread = CLASS_THREAD(AsyncTransceiver, _proc_rxThread);
-
-        
+        if (_reactor && channel->getPollableHandle() >= 0) {
+            _codec.onDecodeReset();
+            if (IS_OK(_reactor->attach(channel->getPollableHandle(), this, _reactorRegID))) {
+                _attachedToReactor = true;
+                break;
+            }
+            // fall back to the dedicated threads
+        }
 
+        _decodingInline = _inlineDecoding;
+        if (_decodingInline) {
+            // the rx thread is the only one touching the codec
+            _codec.onDecodeReset();
+        } else {
+            _decoderThread = CLASS_THREAD(AsyncTransceiver, _proc_decoderThread);
+        }
+		_rxThread = CLASS_THREAD(AsyncTransceiver, _proc_rxThread);
 
 	} while (0);
 
@@ -239,23 +281,86 @@ void AsyncTransceiver::unbindAndClose()
 
     
 	_isWorking = false;
-	_dataEvt.set(); // set signal to wake up threads
 
-	_decoderThread.join();
-	_rxThread.join();
+    if (_attachedToReactor) {
+        // no reactor callback is in progress once it returns
+        _reactor->detach(_reactorRegID);
+        _attachedToReactor = false;
+    } else {
+        _dataEvt.set(); // set signal to wake up threads
+        // the rx thread may be blocked in the channel for a whole rx timeout otherwise
+        _bindedChannel->cancelOperation();
+
+        _decoderThread.join();
+        _rxThread.join();
+    }
+    _decodingInline = false;
 
 
     _bindedChannel->close();
 
     _bindedChannel = NULL;
 
+    _rxRing.clear();
+}
 
-    for (std::list< Buffer* >::iterator itr = _rxQueue.begin(); itr != _rxQueue.end(); ++itr)
-    {
-        delete [] *itr;
-    }
-    _rxQueue.clear();
+void AsyncTransceiver::setReactor(IOReactor* reactor)
+{
+    rp::hal::AutoLocker l(_opLocker);
+    _reactor = reactor;
+}
+
+void AsyncTransceiver::setCaptureTap(RawCaptureWriter* tap)
+{
+    rp::hal::AutoLocker l(_captureLocker);
+    _captureTap = tap;
+    _hasCaptureTap = (tap != NULL);
+}
+
+void AsyncTransceiver::setInlineDecoding(bool enabled)
+{
+    rp::hal::AutoLocker l(_opLocker);
+    _inlineDecoding = enabled;
+}
+
+u_result AsyncTransceiver::setRxRingStorage(_u8* buffer, size_t size)
+{
+    rp::hal::AutoLocker l(_opLocker);
+    if (_isWorking) return RESULT_OPERATION_NOT_SUPPORT;
+    _rxRing.setStorage(buffer, size);
+    return RESULT_OK;
+}
+
+void AsyncTransceiver::setThreadConfig(const LidarThreadConfig& rxThreadConfig, const LidarThreadConfig& decoderThreadConfig)
+{
+    rp::hal::AutoLocker l(_opLocker);
+    _rxThreadConfig = rxThreadConfig;
+    _decoderThreadConfig = decoderThreadConfig;
+}
+
+void AsyncTransceiver::setLatencyTracker(LatencyTracker* tracker)
+{
+    _latencyTracker = tracker;
+}
+
+bool AsyncTransceiver::waitRxIdle(_u32 quietTime_uS, _u32 timeout)
+{
+    _u64 startTs = getus();
+    _u64 deadline = startTs + (_u64)timeout * 1000;
+
+    while (1) {
+        _u64 lastRx = _lastRx_uS.load(std::memory_order_relaxed);
+        _u64 quietSince = (lastRx > startTs) ? lastRx : startTs;
+        _u64 now = getus();
+
+        if (now >= quietSince + quietTime_uS) return true;
+        if (now >= deadline) return false;
 
+        // sleep until the earliest moment the wait can end
+        _u64 wakeup = quietSince + quietTime_uS;
+        if (wakeup > deadline) wakeup = deadline;
+        delay((_word_size_t)((wakeup - now + 999) / 1000));
+    }
 }
 
 u_result AsyncTransceiver::sendMessage(message_autoptr_t& msg)
@@ -265,7 +370,21 @@ u_result AsyncTransceiver::sendMessage(message_autoptr_t& msg)
     if (!_isWorking) return RESULT_OPERATION_NOT_SUPPORT;
 
     rp::hal::AutoLocker l(_opLocker);
+    return _encodeAndSend(msg);
+}
+
+u_result AsyncTransceiver::sendMessage(_u8 cmd, const void* payload, size_t size)
+{
+    if (!_isWorking) return RESULT_OPERATION_NOT_SUPPORT;
+
+    rp::hal::AutoLocker l(_opLocker);
+    _txMessage->cmd = cmd;
+    _txMessage->fillData(payload, size);
+    return _encodeAndSend(_txMessage);
+}
 
+u_result AsyncTransceiver::_encodeAndSend(message_autoptr_t& msg)
+{
     size_t requiredBufferSize = _codec.estimateLength(msg);
 
     if (requiredBufferSize == 0) {
@@ -273,135 +392,284 @@ u_result AsyncTransceiver::sendMessage(message_autoptr_t& msg)
         return RESULT_OK;
     }
 
-    u_result ans = RESULT_OK;
+    if (_txBuffer.size() < requiredBufferSize) {
+        _txBuffer.resize(requiredBufferSize);
+    }
 
-    _u8* txBuffer = new _u8[requiredBufferSize];
+    _codec.onEncodeData(msg, &_txBuffer[0], &requiredBufferSize);
 
-    do {
-  
-        if (!txBuffer) {
-            return RESULT_INSUFFICIENT_MEMORY;
-        }
+    int txSize = _bindedChannel->write(&_txBuffer[0], requiredBufferSize);
 
-        _codec.onEncodeData(msg, txBuffer, &requiredBufferSize);
+    if (txSize < 0) return RESULT_OPERATION_FAIL;
+    return RESULT_OK;
+}
 
-        int txSize = _bindedChannel->write(txBuffer, requiredBufferSize);
+sl_result AsyncTransceiver::_proc_rxThread()
+{
+    assert(_bindedChannel);
 
-        if (txSize < 0) ans = RESULT_OPERATION_FAIL;
+    applyThreadConfig(_rxThreadConfig, "sl_rx");
 
-    } while (0);
+    while (_isWorking && _receiveStreamData(1000)) {
+    }
+    _workingFlag |= WORKING_FLAG_RX_DISABLED;
+    return RESULT_OK;
+}
 
+bool AsyncTransceiver::_receiveData(size_t hintedSize)
+{
+    size_t freeSize;
+    _u8* rxBuffer = _rxRing.getWritableRegion(freeSize);
+    bool staged = false;
+
+    if (freeSize < hintedSize && _isLosslessChannel) {
+        // the channel can hold the data back, so never drop: read what fits or wait for the decoder
+        if (!freeSize) {
+            delay(1);
+            return true;
+        }
+    } else if (freeSize < hintedSize) {
+        // read into the staging buffer and copy it (or drop it if the decoder cannot keep up)
+        rxBuffer = _rxStagingBuf;
+        freeSize = sizeof(_rxStagingBuf);
+        staged = true;
+    }
 
-    delete[] txBuffer;
-    return ans;
+    // the remaining data (if any) will be picked up in the next round
+    size_t sizeToRead = hintedSize < freeSize ? hintedSize : freeSize;
+    size_t rxSize = _bindedChannel->read(rxBuffer, sizeToRead);
+#ifdef _DEBUG_DUMP_PACKET
+    printf("Revc: %d\n", (int)rxSize);
+#endif
+     
+    if  (!rxSize) {
+        _onChannelError(RESULT_OPERATION_ABORTED);
+        return false;
+    }
+
+    assert(sizeToRead >= rxSize);
+    _onDataReceived(rxBuffer, rxSize, staged);
+    return true;
 }
 
-sl_result AsyncTransceiver::_proc_rxThread()
+bool AsyncTransceiver::_receiveStreamData(_u32 timeout)
 {
-    assert(_bindedChannel);
+    size_t freeSize;
+    _u8* rxBuffer = _rxRing.getWritableRegion(freeSize);
+    bool staged = false;
+
+    if (!freeSize) {
+        if (_isLosslessChannel) {
+            delay(1);
+            return true;
+        }
+        // drain the channel, the data will be dropped if the decoder is still behind
+        rxBuffer = _rxStagingBuf;
+        freeSize = sizeof(_rxStagingBuf);
+        staged = true;
+    }
 
-    rp::hal::Thread::SetSelfPriority(rp::hal::Thread::PRIORITY_HIGH);
+    size_t rxSize = 0;
+    u_result result = _bindedChannel->waitAndRead(rxBuffer, freeSize, rxSize, timeout);
+    if (result == RESULT_INSUFFICIENT_MEMORY && !staged) {
+        // a datagram has to be read whole, the end of the ring is too short for the next one
+        rxBuffer = _rxStagingBuf;
+        staged = true;
+        result = _bindedChannel->waitAndRead(rxBuffer, sizeof(_rxStagingBuf), rxSize, 0);
+    }
+    if (IS_FAIL(result)) {
+        // timeout is allowed
+        if (result == RESULT_OPERATION_TIMEOUT) return true;
+        if (_isWorking) _onChannelError(result);
+        return false;
+    }
 
-    u_result result;
-    size_t hintedSize = 0;
-    while (_isWorking)
-    {
-        result = _bindedChannel->waitForDataExt(hintedSize, 1000);
+    if (rxSize) _onDataReceived(rxBuffer, rxSize, staged, _bindedChannel->getLastRxTimestamp());
+    return true;
+}
 
-        if (IS_FAIL(result))
-        {
-            // timeout is allowed
-            if (result == RESULT_OPERATION_TIMEOUT) {
-                continue;
-            }
-            if (_isWorking) {
-                _workingFlag |= WORKING_FLAG_ERROR;
-                _codec.onChannelError(result);
-                break;
-            }
-        }
+void AsyncTransceiver::_onDataReceived(_u8* rxBuffer, size_t rxSize, bool staged, _u64 rxTimestamp_uS)
+{
+    SL_TRACE_SCOPE_ARG(traceScope, "rx.read", rxSize);
+    _rxBytes.fetch_add(rxSize, std::memory_order_relaxed);
 
-        // no data in buffer, sleep and wait for the next round
-        if (!hintedSize)
-        {
-            continue;
-        }
+    _u64 now_uS = getus();
+    _lastRx_uS.store(now_uS, std::memory_order_relaxed);
 
+    _u64 arrival_uS = 0;
+    if (_latencyTracker.load(std::memory_order_relaxed)) {
+        // the kernel receive time (if the channel has it) also covers the wakeup of this thread
+        arrival_uS = rxTimestamp_uS ? rxTimestamp_uS : now_uS;
+    }
+
+    if (_hasCaptureTap) {
+        rp::hal::AutoLocker l(_captureLocker);
+        if (_captureTap) _captureTap->onRxData(rxBuffer, rxSize);
+    }
 
-        Buffer* decodeBuffer = new Buffer();
-        
-        decodeBuffer->data = new _u8[hintedSize];
+    if (staged) {
+        size_t written = _rxRing.write(rxBuffer, rxSize);
+        if (written < rxSize) {
+            _rxOverflowBytes += (rxSize - written);
+            ++_rxOverflowCount;
+        }
+        if (!written) return;
+
+        _rxQueuedBytes += written;
+        if (arrival_uS) _pushArrivalMark(arrival_uS);
+    }
 
-        decodeBuffer->size = _bindedChannel->read(decodeBuffer->data, hintedSize);
 #ifdef _DEBUG_DUMP_PACKET
-        printf("Revc: %d\n", decodeBuffer->size);
+    printf("=== Dump RX Packet, size = %d ===\n", (int)rxSize);
+    for (size_t pos = 0; pos < rxSize; pos++)
+    {
+        printf("%02x ", rxBuffer[pos]);
+    }
+    printf("\n=== END ===\n");
 #endif
-         
-        if  (!decodeBuffer->size) {
-            delete decodeBuffer;
 
-            
-            _workingFlag |= WORKING_FLAG_ERROR;
-            _codec.onChannelError(RESULT_OPERATION_ABORTED);
-            break;
-        }
+    if (!staged) {
+        // the mark goes first, so the decoder never sees these bytes without it
+        _rxQueuedBytes += rxSize;
+        if (arrival_uS) _pushArrivalMark(arrival_uS);
+        _rxRing.commitWrite(rxSize);
+    }
 
-        assert(hintedSize >= decodeBuffer->size);
+    if (_decodingInline) {
+        _decodeRxRing();
+        return;
+    }
+    _dataEvt.set();
+}
 
+void AsyncTransceiver::_pushArrivalMark(_u64 timestamp_uS)
+{
+    _u32 head = _rxArrivalMarkHead.load(std::memory_order_relaxed);
+    if (head - _rxArrivalMarkTail.load(std::memory_order_acquire) >= RX_ARRIVAL_MARK_COUNT) {
+        // the decoder is far behind, these bytes will be accounted to the next mark
+        return;
+    }
 
-#ifdef _DEBUG_DUMP_PACKET
-        printf("=== Dump RX Packet, size = %d ===\n", decodeBuffer->size);
-        for (int pos = 0; pos < decodeBuffer->size; pos++)
-        {
-            printf("%02x ", decodeBuffer->data[pos]);
+    RxArrivalMark& mark = _rxArrivalMarks[head % RX_ARRIVAL_MARK_COUNT];
+    mark.endOffset = _rxQueuedBytes;
+    mark.timestamp_uS = timestamp_uS;
+    _rxArrivalMarkHead.store(head + 1, std::memory_order_release);
+}
+
+void AsyncTransceiver::_decodeData(const _u8* buffer, size_t size)
+{
+    LatencyTracker* tracker = _latencyTracker.load(std::memory_order_relaxed);
+    _u64 decodedEnd = _rxDecodedBytes + size;
+    _u64 arrival_uS = 0;
+
+    _u32 tail = _rxArrivalMarkTail.load(std::memory_order_relaxed);
+    _u32 head = _rxArrivalMarkHead.load(std::memory_order_acquire);
+    if (tail != head) {
+        _u64 now_uS = tracker ? getus() : 0;
+        for (; tail != head; ++tail) {
+            const RxArrivalMark& mark = _rxArrivalMarks[tail % RX_ARRIVAL_MARK_COUNT];
+
+            // the oldest bytes of the chunk tell its age
+            if (!arrival_uS && mark.endOffset > _rxDecodedBytes) arrival_uS = mark.timestamp_uS;
+
+            // partially decoded, it stays for the next chunk
+            if (mark.endOffset > decodedEnd) break;
+
+            if (tracker) tracker->rxQueue.record(now_uS - mark.timestamp_uS);
         }
-        printf("\n=== END ===\n");
-#endif
+        _rxArrivalMarkTail.store(tail, std::memory_order_release);
 
-        _rxLocker.lock();
-        _rxQueue.push_back(decodeBuffer);
-        _dataEvt.set();
-        _rxLocker.unlock();
+        if (tracker) tracker->updateRxQueueDepth(_rxRing.size());
+    }
 
+    _decodingArrival_uS = tracker ? arrival_uS : 0;
+    _codec.onDecodeData(buffer, size);
+    _decodingArrival_uS = 0;
+    _rxDecodedBytes = decodedEnd;
+}
 
+void AsyncTransceiver::_decodeRxRing()
+{
+    // the ring may wrap, so it takes up to two rounds to drain it
+    while (_isWorking) {
+        size_t sizeToDecode;
+        const _u8* bufferToDecode = _rxRing.getReadableRegion(sizeToDecode);
+        if (!sizeToDecode) break;
+
+        _decodeData(bufferToDecode, sizeToDecode);
+        _rxRing.commitRead(sizeToDecode);
     }
-    _workingFlag |= WORKING_FLAG_RX_DISABLED;
-    return RESULT_OK;
+}
+
+void AsyncTransceiver::_onChannelError(u_result errCode)
+{
+    _workingFlag |= WORKING_FLAG_ERROR;
+    _codec.onChannelError(errCode);
+}
+
+bool AsyncTransceiver::onReactorReadable(bool& dataQueued)
+{
+    dataQueued = false;
+    if (!_isWorking) return true;
+
+    size_t hintedSize = 0;
+    u_result result = _bindedChannel->waitForDataExt(hintedSize, 0);
+
+    if (IS_FAIL(result)) {
+        // spurious wakeup
+        if (result == RESULT_OPERATION_TIMEOUT) return true;
+        _onChannelError(result);
+        _workingFlag |= WORKING_FLAG_RX_DISABLED;
+        return false;
+    }
+
+    if (!hintedSize) return true;
+
+    if (!_receiveData(hintedSize)) {
+        _workingFlag |= WORKING_FLAG_RX_DISABLED;
+        return false;
+    }
+    dataQueued = true;
+    return true;
+}
+
+bool AsyncTransceiver::onReactorDecode()
+{
+    // the ring may wrap, so it takes up to two rounds to drain what has been received so far
+    for (int round = 0; round < IOReactor::DECODE_ROUNDS_PER_TURN && _isWorking; ++round)
+    {
+        size_t sizeToDecode;
+        const _u8* bufferToDecode = _rxRing.getReadableRegion(sizeToDecode);
+        if (!sizeToDecode) return false;
+
+        _decodeData(bufferToDecode, sizeToDecode);
+        _rxRing.commitRead(sizeToDecode);
+    }
+    return _isWorking && !_rxRing.empty();
 }
 
 sl_result AsyncTransceiver::_proc_decoderThread()
 {
 
     assert(_bindedChannel);
-    rp::hal::Thread::SetSelfPriority(rp::hal::Thread::PRIORITY_HIGH);
+    applyThreadConfig(_decoderThreadConfig, "sl_decoder");
     _codec.onDecodeReset();
     
 
     while (_isWorking)
     {
-        _rxLocker.lock();
+        size_t sizeToDecode;
+        const _u8* bufferToDecode = _rxRing.getReadableRegion(sizeToDecode);
 
-        if (_rxQueue.empty())
+        if (!sizeToDecode)
         {
-            _rxLocker.unlock();
-
-            if (_dataEvt.wait(1000))
-                continue;
-
-            _rxLocker.lock();
+            _dataEvt.wait(1000);
+            continue;
         }
-        assert(!_rxQueue.empty());
-
-        Buffer * bufferToDecode = _rxQueue.front();
-        _rxQueue.pop_front();
-
-        _rxLocker.unlock();
-
-        //cout<<"decoding "<< bufferToDecode->size <<" bytes of data"<<endl;
-        _codec.onDecodeData(bufferToDecode->data, bufferToDecode->size);
-
 
-        delete bufferToDecode;
+        SL_TRACE_SCOPE_ARG(traceScope, "decoder.dequeue", sizeToDecode);
+        _decodeData(bufferToDecode, sizeToDecode);
+        _rxRing.commitRead(sizeToDecode);
     }
 
     return RESULT_OK;
@@ -32,8 +32,14 @@
 
 #pragma once
 
-#include <list>
 #include <memory>
+#include <atomic>
+#include <vector>
+
+#include "hal/spsc_ringbuffer.h"
+#include "sl_io_reactor.h"
+#include "sl_raw_capture.h"
+#include "sl_latency_stats.h"
 
 namespace sl { namespace internal {
 
@@ -98,7 +104,7 @@ public:
 
 };
 
-class AsyncTransceiver {
+class AsyncTransceiver : public IIOReactorHandler {
 public:
 
 	enum working_flag_t
@@ -109,8 +115,12 @@ public:
 		WORKING_FLAG_ERROR = 0x1L << 31,
 	};
 
+	enum {
+		DEFAULT_RX_RING_SIZE = 256 * 1024,
+	};
+
 
-	AsyncTransceiver(IAsyncProtocolCodec& codec);
+	AsyncTransceiver(IAsyncProtocolCodec& codec, size_t rxRingSize = DEFAULT_RX_RING_SIZE);
 	~AsyncTransceiver();
 
 
@@ -118,22 +128,121 @@ public:
 	u_result openChannelAndBind(IChannel* channel);
 	void     unbindAndClose();
 
+	// service the channel bound next time by the given reactor instead of the dedicated threads
+	// (NULL to disable), it takes effect on the next openChannelAndBind()
+	void     setReactor(IOReactor* reactor);
+
+	IOReactor* getReactor() const {
+		return _reactor;
+	}
+
+	bool isAttachedToReactor() const {
+		return _attachedToReactor;
+	}
+
+	// decode the received data on the rx thread right after it is read instead of handing it over
+	// to the decoder thread, it takes effect on the next openChannelAndBind() (ignored with a reactor)
+	void     setInlineDecoding(bool enabled);
+
+	bool isDecodingInline() const {
+		return _decodingInline;
+	}
+
+	// the storage of the rx queue, the transceiver allocates its own one of the given size when buffer is NULL,
+	// the size of a given buffer has to be a power of two. It fails while a channel is bound
+	u_result setRxRingStorage(_u8* buffer, size_t size);
+
+	// scheduling of the dedicated rx and decoder threads, it takes effect on the next openChannelAndBind()
+	void     setThreadConfig(const LidarThreadConfig& rxThreadConfig, const LidarThreadConfig& decoderThreadConfig);
+
+	// every received byte is also passed to the tap (NULL to disable)
+	// once it returns, the previous tap is no longer used
+	void     setCaptureTap(RawCaptureWriter* tap);
+
+	// record how long the received bytes wait in the rx queue (NULL to disable)
+	void     setLatencyTracker(LatencyTracker* tracker);
+
+	// when the bytes being decoded were read from the channel (0 if unknown),
+	// only meaningful inside the codec callbacks
+	_u64 getDecodingArrivalTimestamp() const {
+		return _decodingArrival_uS;
+	}
+
+	// the bound channel failed, the transceiver stays bound until unbindAndClose()
+	bool hasChannelError() const {
+		return (_workingFlag & WORKING_FLAG_ERROR) != 0;
+	}
+
 	IChannel* getBindedChannel() const {
 		return _bindedChannel;
 	}
 	
 	u_result sendMessage(message_autoptr_t& msg);
 
+	// the same as above on a message kept by the transceiver, nothing is allocated once it has grown to the payload size
+	u_result sendMessage(_u8 cmd, const void* payload, size_t size);
+
+	// bytes read from the channels bound so far
+	_u64 getRxBytes() const {
+		return _rxBytes.load();
+	}
+
+	// bytes (and the number of read operations) discarded because the decoder thread
+	// could not keep up and the rx ring was full
+	_u64 getRxOverflowBytes() const {
+		return _rxOverflowBytes.load();
+	}
+
+	_u32 getRxOverflowCount() const {
+		return _rxOverflowCount.load();
+	}
+
+	// wait until nothing has been received for quietTime_uS (counted from the call at least),
+	// return false if the channel is still busy after timeout (in ms)
+	bool waitRxIdle(_u32 quietTime_uS, _u32 timeout);
+
+	size_t getRxPendingSize() const {
+		return _rxRing.size();
+	}
+
+	size_t getRxRingCapacity() const {
+		return _rxRing.capacity();
+	}
+
+	// IIOReactorHandler
+	virtual bool onReactorReadable(bool& dataQueued);
+	virtual bool onReactorDecode();
+
 protected:
 
 	sl_result _proc_rxThread();
 	sl_result _proc_decoderThread();
 
+	// read up to hintedSize bytes into the rx ring, return false if the channel is broken
+	bool _receiveData(size_t hintedSize);
+	// wait and read straight into the rx ring (byte stream channels only)
+	bool _receiveStreamData(_u32 timeout);
+	void _onDataReceived(_u8* rxBuffer, size_t rxSize, bool staged, _u64 rxTimestamp_uS = 0);
+	void _onChannelError(u_result errCode);
+
+	void _decodeData(const _u8* buffer, size_t size);
+	void _decodeRxRing();
+	void _pushArrivalMark(_u64 timestamp_uS);
+
+	enum {
+		RX_ARRIVAL_MARK_COUNT = 512,
+	};
+
+	// the bytes of the rx ring up to endOffset were read from the channel at timestamp_uS
+	struct RxArrivalMark {
+		_u64 endOffset;
+		_u64 timestamp_uS;
+	};
+
 protected:
 
 
 	rp::hal::Locker _opLocker;
-	rp::hal::Locker _rxLocker;
 	rp::hal::Event  _dataEvt;
 
 	IChannel* _bindedChannel;
@@ -141,26 +250,52 @@ protected:
 
 
 	bool _isWorking;
-	_u32 _workingFlag;
+	std::atomic<_u32> _workingFlag;
 
-	rp::hal::Thread _rxThread;
-	rp::hal::Thread _decoderThread;
+	// replayed data is never dropped, the rx thread waits for the decoder instead
+	bool _isLosslessChannel;
 
-	struct Buffer {
-		size_t size;
-		_u8* data;
+	bool _inlineDecoding;
+	bool _decodingInline;
 
-
-		Buffer() : size(0), data(NULL){}
-
-		~Buffer() {
-			if (data) {
-				delete[] data;
-				data = NULL;
-			}
-		}
-	};
-	std::list< Buffer * > _rxQueue;
+	rp::hal::Thread _rxThread;
+	rp::hal::Thread _decoderThread;
+	LidarThreadConfig _rxThreadConfig;
+	LidarThreadConfig _decoderThreadConfig;
+
+	// rx thread is the only producer, decoder thread is the only consumer
+	rp::hal::SPSCByteRing _rxRing;
+	std::atomic<_u64> _rxBytes;
+	std::atomic<_u64> _rxOverflowBytes;
+	std::atomic<_u32> _rxOverflowCount;
+	std::atomic<_u64> _lastRx_uS;
+
+	// used when the contiguous free space of the rx ring is too small to hold a whole read
+	// (a datagram must not be truncated) or to drain the channel when the ring is full
+	_u8 _rxStagingBuf[4096];
+
+	IOReactor* _reactor;
+	_u32       _reactorRegID;
+	bool       _attachedToReactor;
+
+	rp::hal::Locker   _captureLocker;
+	RawCaptureWriter* _captureTap;
+	std::atomic<bool> _hasCaptureTap;
+
+	// the arrival marks are pushed by the rx side and popped by the decoder, only when the latency is tracked
+	std::atomic<LatencyTracker*> _latencyTracker;
+	RxArrivalMark     _rxArrivalMarks[RX_ARRIVAL_MARK_COUNT];
+	std::atomic<_u32> _rxArrivalMarkHead;
+	std::atomic<_u32> _rxArrivalMarkTail;
+	_u64              _rxQueuedBytes;
+	_u64              _rxDecodedBytes;
+	_u64              _decodingArrival_uS;
+
+	// reused by every send, guarded by _opLocker
+	message_autoptr_t _txMessage;
+	std::vector<_u8>  _txBuffer;
+
+	u_result _encodeAndSend(message_autoptr_t& msg);
 };
 
 
@@ -31,10 +31,55 @@
   */
 
 #include "sl_crc.h"  
+#include <string.h>
+
+#if defined(__GNUC__) && defined(__aarch64__) && defined(__linux__)
+// ARMv8 CRC32 instructions use the same (reflected 0x04C11DB7) polynomial, detected at runtime
+#define SL_CRC32_ARMV8
+#include <arm_acle.h>
+#include <sys/auxv.h>
+#ifndef HWCAP_CRC32
+#define HWCAP_CRC32 (1 << 7)
+#endif
+#endif
 
 namespace sl {namespace crc32 {
-    
-    static sl_u32 table[256];//crc32_table
+
+    // compile time table generation for the default polynomial 0x4C11DB7 (reflected: 0xEDB88320)
+    // entry [k][n] is the crc of the byte n followed by k zero bytes, as required by slice-by-8
+    static constexpr sl_u32 _byteStep(sl_u32 c, int bits)
+    {
+        return bits == 0 ? c : _byteStep((c & 1) ? (0xEDB88320 ^ (c >> 1)) : (c >> 1), bits - 1);
+    }
+
+    static constexpr sl_u32 _sliceEntry(int k, sl_u32 n)
+    {
+        return k == 0 ? _byteStep(n, 8) : ((_sliceEntry(k - 1, n) >> 8) ^ _byteStep(_sliceEntry(k - 1, n) & 0xFF, 8));
+    }
+
+#define SL_CRC_E1(k, n)   _sliceEntry(k, n)
+#define SL_CRC_E4(k, n)   SL_CRC_E1(k, n), SL_CRC_E1(k, n + 1), SL_CRC_E1(k, n + 2), SL_CRC_E1(k, n + 3)
+#define SL_CRC_E16(k, n)  SL_CRC_E4(k, n), SL_CRC_E4(k, n + 4), SL_CRC_E4(k, n + 8), SL_CRC_E4(k, n + 12)
+#define SL_CRC_E64(k, n)  SL_CRC_E16(k, n), SL_CRC_E16(k, n + 16), SL_CRC_E16(k, n + 32), SL_CRC_E16(k, n + 48)
+#define SL_CRC_E256(k)    { SL_CRC_E64(k, 0), SL_CRC_E64(k, 64), SL_CRC_E64(k, 128), SL_CRC_E64(k, 192) }
+
+    static constexpr sl_u32 default_table[8][256] = {
+        SL_CRC_E256(0), SL_CRC_E256(1), SL_CRC_E256(2), SL_CRC_E256(3),
+        SL_CRC_E256(4), SL_CRC_E256(5), SL_CRC_E256(6), SL_CRC_E256(7),
+    };
+
+#undef SL_CRC_E256
+#undef SL_CRC_E64
+#undef SL_CRC_E16
+#undef SL_CRC_E4
+#undef SL_CRC_E1
+
+    static const sl_u32 DEFAULT_POLY = 0x4C11DB7;
+
+    // only used when init() is called with a non-default polynomial
+    static sl_u32 custom_table[256];
+    static const sl_u32* active_table = default_table[0];
+
     sl_u32 bitrev(sl_u32 input, sl_u16 bw)
     {
         sl_u16 i;
@@ -55,6 +100,11 @@ namespace sl {namespace crc32 {
         sl_u16 j;
         sl_u32 c;
 
+        if (poly == DEFAULT_POLY) {
+            active_table = default_table[0];
+            return;
+        }
+
         poly = bitrev(poly, 32);
         for (i = 0; i < 256; i++) {
             c = i;
@@ -64,39 +114,116 @@ namespace sl {namespace crc32 {
                 else
                     c = c >> 1;
             }
-            table[i] = c;
+            custom_table[i] = c;
         }
+        active_table = custom_table;
     }
 
-    sl_u32 cal(sl_u32 crc, void* input, sl_u16 len)
+    static inline sl_u32 _update_bytewise(const sl_u32* table, sl_u32 crc, const sl_u8* pch, size_t len)
     {
-        sl_u16 i;
-        sl_u8 index;
-        sl_u8* pch;
-        pch = (unsigned char*)input;
-        sl_u8 leftBytes = 4 - (len & 0x3);
+        for (size_t i = 0; i < len; i++) {
+            crc = (crc >> 8) ^ table[(sl_u8)(crc ^ pch[i])];
+        }
+        return crc;
+    }
 
-        for (i = 0; i < len; i++) {
-            index = (unsigned char)(crc^*pch);
-            crc = (crc >> 8) ^ table[index];
-            pch++;
+    static sl_u32 _update_slice8(sl_u32 crc, const sl_u8* pch, size_t len)
+    {
+        while (len >= 8) {
+            sl_u32 one = crc ^ ((sl_u32)pch[0] | ((sl_u32)pch[1] << 8) | ((sl_u32)pch[2] << 16) | ((sl_u32)pch[3] << 24));
+            sl_u32 two = (sl_u32)pch[4] | ((sl_u32)pch[5] << 8) | ((sl_u32)pch[6] << 16) | ((sl_u32)pch[7] << 24);
+
+            crc = default_table[7][one & 0xFF] ^ default_table[6][(one >> 8) & 0xFF]
+                ^ default_table[5][(one >> 16) & 0xFF] ^ default_table[4][one >> 24]
+                ^ default_table[3][two & 0xFF] ^ default_table[2][(two >> 8) & 0xFF]
+                ^ default_table[1][(two >> 16) & 0xFF] ^ default_table[0][two >> 24];
+
+            pch += 8;
+            len -= 8;
         }
+        return _update_bytewise(default_table[0], crc, pch, len);
+    }
 
-        for (i = 0; i < leftBytes; i++) {//zero padding
-            index = (unsigned char)(crc ^ 0);
-            crc = (crc >> 8) ^ table[index];
+#ifdef SL_CRC32_ARMV8
+#ifdef __clang__
+    __attribute__((target("crc")))
+#else
+    __attribute__((target("+crc")))
+#endif
+    static sl_u32 _update_armv8(sl_u32 crc, const sl_u8* pch, size_t len)
+    {
+        while (len >= 8) {
+            sl_u64 data;
+            memcpy(&data, pch, sizeof(data));
+            crc = __crc32d(crc, data);
+            pch += 8;
+            len -= 8;
+        }
+        while (len--) {
+            crc = __crc32b(crc, *pch++);
+        }
+        return crc;
+    }
+
+    static bool _isARMv8CRCSupported()
+    {
+        static const bool supported = (getauxval(AT_HWCAP) & HWCAP_CRC32) != 0;
+        return supported;
+    }
+#endif
+
+    static sl_u32 _update_default(sl_u32 crc, const sl_u8* pch, size_t len)
+    {
+#ifdef SL_CRC32_ARMV8
+        if (_isARMv8CRCSupported()) {
+            return _update_armv8(crc, pch, len);
+        }
+#endif
+        return _update_slice8(crc, pch, len);
+    }
+
+    static sl_u32 _cal(const sl_u32* table, sl_u32 crc, const sl_u8* pch, sl_u16 len)
+    {
+        static const sl_u8 zeroPadding[4] = { 0, 0, 0, 0 };
+        // the protocol always pads 1 - 4 zero bytes (4 if the length is already aligned)
+        sl_u8 leftBytes = 4 - (len & 0x3);
+
+        if (table == default_table[0]) {
+            crc = _update_default(crc, pch, len);
+            crc = _update_default(crc, zeroPadding, leftBytes);
+        }
+        else {
+            crc = _update_bytewise(table, crc, pch, len);
+            crc = _update_bytewise(table, crc, zeroPadding, leftBytes);
         }
         return crc ^ 0xffffffff;
     }
 
+    sl_u32 cal(sl_u32 crc, void* input, sl_u16 len)
+    {
+        return _cal(active_table, crc, (const sl_u8*)input, len);
+    }
+
     sl_result getResult(sl_u8 *ptr, sl_u32 len) 
     {
-        static sl_u8 tmp;
-        if (tmp != 1) {
-            init(0x4C11DB7);
-            tmp = 1;
-        }
+        // always uses the default polynomial, no initialization required
+        return _cal(default_table[0], 0xFFFFFFFF, ptr, len);
+    }
 
-        return cal(0xFFFFFFFF, ptr, len);
+    sl_u32 begin()
+    {
+        return 0xFFFFFFFF;
+    }
+
+    sl_u32 update(sl_u32 state, const void* input, sl_u32 len)
+    {
+        return _update_default(state, (const sl_u8*)input, len);
+    }
+
+    sl_u32 finish(sl_u32 state, sl_u32 totalLen)
+    {
+        static const sl_u8 zeroPadding[4] = { 0, 0, 0, 0 };
+        sl_u8 leftBytes = 4 - (totalLen & 0x3);
+        return _update_default(state, zeroPadding, leftBytes) ^ 0xffffffff;
     }
-}}
\ No newline at end of file
+}}
@@ -0,0 +1,424 @@
+/*
+ *  Slamtec LIDAR SDK
+ *
+ *  Copyright (c) 2014 - 2023 Shanghai Slamtec Co., Ltd.
+ *  http://www.slamtec.com
+ *
+ */
+ /*
+  * Redistribution and use in source and binary forms, with or without
+  * modification, are permitted provided that the following conditions are met:
+  *
+  * 1. Redistributions of source code must retain the above copyright notice,
+  *    this list of conditions and the following disclaimer.
+  *
+  * 2. Redistributions in binary form must reproduce the above copyright notice,
+  *    this list of conditions and the following disclaimer in the documentation
+  *    and/or other materials provided with the distribution.
+  *
+  * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+  * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+  * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+  * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+  * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+  * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+  * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+  * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+  * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+  * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+  * EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+  *
+  */
+
+#include "sdkcommon.h"
+#include "hal/thread.h"
+#include "hal/types.h"
+#include "hal/assert.h"
+#include "hal/locker.h"
+#include "hal/event.h"
+#include "sl_lidar_driver.h"
+
+#include "sl_io_reactor.h"
+#include "sl_thread_config.h"
+
+#if defined(__linux__)
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+#define SL_IO_REACTOR_EPOLL
+#endif
+
+
+namespace sl { namespace internal {
+
+
+IOReactor::IOReactor(size_t ioThreadCount, size_t decodeWorkerCount,
+    const LidarThreadConfig& ioThreadConfig, const LidarThreadConfig& decodeWorkerConfig)
+    : _ioThreadCount(ioThreadCount ? ioThreadCount : 1)
+    , _decodeWorkerCount(decodeWorkerCount ? decodeWorkerCount : 1)
+    , _isRunning(false)
+    , _ioThreadConfig(ioThreadConfig)
+    , _decodeWorkerConfig(decodeWorkerConfig)
+    , _nextDecodeWorkerIndex(0)
+    , _nextRegID(1)
+{
+
+}
+
+IOReactor::~IOReactor()
+{
+    stop();
+}
+
+size_t IOReactor::getIOThreadCount() const
+{
+    return _ioThreadCount;
+}
+
+size_t IOReactor::getDecodeWorkerCount() const
+{
+    return _decodeWorkerCount;
+}
+
+size_t IOReactor::getAttachedChannelCount()
+{
+    rp::hal::AutoLocker l(_locker);
+    return _registrations.size();
+}
+
+#ifdef SL_IO_REACTOR_EPOLL
+
+u_result IOReactor::start()
+{
+    rp::hal::AutoLocker l(_locker);
+    if (_isRunning) return RESULT_ALREADY_DONE;
+
+    for (size_t pos = 0; pos < _ioThreadCount; ++pos) {
+        IOLoop* loop = new IOLoop();
+        loop->owner = this;
+        loop->index = pos;
+        loop->channelCount = 0;
+        loop->epollFd = epoll_create1(EPOLL_CLOEXEC);
+        loop->wakeupFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+
+        epoll_event evt;
+        memset(&evt, 0, sizeof(evt));
+        evt.events = EPOLLIN;
+        evt.data.u64 = 0; // registration IDs start from 1
+
+        if (loop->epollFd < 0 || loop->wakeupFd < 0
+            || epoll_ctl(loop->epollFd, EPOLL_CTL_ADD, loop->wakeupFd, &evt)) {
+            if (loop->epollFd >= 0) ::close(loop->epollFd);
+            if (loop->wakeupFd >= 0) ::close(loop->wakeupFd);
+            delete loop;
+            break;
+        }
+        _ioLoops.push_back(loop);
+    }
+
+    if (_ioLoops.size() != _ioThreadCount) {
+        for (size_t pos = 0; pos < _ioLoops.size(); ++pos) {
+            ::close(_ioLoops[pos]->epollFd);
+            ::close(_ioLoops[pos]->wakeupFd);
+            delete _ioLoops[pos];
+        }
+        _ioLoops.clear();
+        return RESULT_OPERATION_FAIL;
+    }
+
+    _isRunning = true;
+    _nextDecodeWorkerIndex = 0;
+    for (size_t pos = 0; pos < _ioLoops.size(); ++pos) {
+        _ioLoops[pos]->thread = rp::hal::Thread::create(_ioThreadThunk, _ioLoops[pos]);
+    }
+
+    for (size_t pos = 0; pos < _decodeWorkerCount; ++pos) {
+        _decodeWorkers.push_back(CLASS_THREAD(IOReactor, _proc_decodeWorker));
+    }
+    return RESULT_OK;
+}
+
+void IOReactor::stop()
+{
+    {
+        rp::hal::AutoLocker l(_locker);
+        if (!_isRunning) return;
+        _isRunning = false;
+        // the owners must detach their channels before the reactor is stopped
+        assert(_registrations.empty());
+    }
+
+    for (size_t pos = 0; pos < _ioLoops.size(); ++pos) {
+        _u64 one = 1;
+        if (::write(_ioLoops[pos]->wakeupFd, &one, sizeof(one)) < 0) {
+            // the loop will still notice the stop request on its next wakeup
+        }
+    }
+    _decodeEvt.set();
+
+    for (size_t pos = 0; pos < _ioLoops.size(); ++pos) {
+        _ioLoops[pos]->thread.join();
+        ::close(_ioLoops[pos]->epollFd);
+        ::close(_ioLoops[pos]->wakeupFd);
+        delete _ioLoops[pos];
+    }
+    _ioLoops.clear();
+
+    for (size_t pos = 0; pos < _decodeWorkers.size(); ++pos) {
+        _decodeWorkers[pos].join();
+    }
+    _decodeWorkers.clear();
+
+    rp::hal::AutoLocker l(_locker);
+    for (std::map<_u32, Registration*>::iterator itr = _registrations.begin(); itr != _registrations.end(); ++itr) {
+        delete itr->second;
+    }
+    _registrations.clear();
+    _decodeQueue.clear();
+}
+
+u_result IOReactor::attach(int pollableHandle, IIOReactorHandler* handler, _u32& regID)
+{
+    if (pollableHandle < 0 || !handler) return RESULT_INVALID_DATA;
+
+    rp::hal::AutoLocker l(_locker);
+    if (!_isRunning) return RESULT_OPERATION_NOT_SUPPORT;
+
+    // pick the least loaded loop
+    IOLoop* loop = _ioLoops[0];
+    for (size_t pos = 1; pos < _ioLoops.size(); ++pos) {
+        if (_ioLoops[pos]->channelCount < loop->channelCount) loop = _ioLoops[pos];
+    }
+
+    _u32 id = _nextRegID++;
+    if (!_nextRegID) _nextRegID = 1;
+
+    epoll_event evt;
+    memset(&evt, 0, sizeof(evt));
+    evt.events = EPOLLIN;
+    evt.data.u64 = id;
+    if (epoll_ctl(loop->epollFd, EPOLL_CTL_ADD, pollableHandle, &evt)) {
+        return RESULT_OPERATION_FAIL;
+    }
+
+    Registration* reg = new Registration();
+    reg->handler = handler;
+    reg->handle = pollableHandle;
+    reg->loop = loop;
+    reg->busy = 0;
+    reg->polling = true;
+    reg->detached = false;
+    reg->decodeQueued = false;
+    reg->decoding = false;
+    reg->decodeRequested = false;
+
+    _registrations[id] = reg;
+    ++loop->channelCount;
+    regID = id;
+    return RESULT_OK;
+}
+
+void IOReactor::detach(_u32 regID)
+{
+    Registration* reg;
+    {
+        rp::hal::AutoLocker l(_locker);
+        reg = _findRegistration_locked(regID);
+        if (!reg) return;
+
+        reg->detached = true;
+        if (reg->polling) {
+            epoll_ctl(reg->loop->epollFd, EPOLL_CTL_DEL, reg->handle, NULL);
+            reg->polling = false;
+        }
+        --reg->loop->channelCount;
+    }
+
+    // wait for the in-progress callbacks (if any) to finish
+    for (;;) {
+        {
+            rp::hal::AutoLocker l(_locker);
+            if (!reg->busy) {
+                _registrations.erase(regID);
+                break;
+            }
+        }
+        delay(1);
+    }
+    delete reg;
+}
+
+u_result IOReactor::_proc_ioLoop(IOLoop* loop)
+{
+    applyThreadConfig(_ioThreadConfig, "sl_reactor_io", (_ioThreadCount > 1) ? (int)loop->index : -1);
+
+    epoll_event events[MAX_EVENTS_PER_WAIT];
+
+    while (_isRunning)
+    {
+        int count = epoll_wait(loop->epollFd, events, MAX_EVENTS_PER_WAIT, 1000);
+        if (count < 0) {
+            if (errno == EINTR) continue;
+            break;
+        }
+
+        for (int pos = 0; pos < count; ++pos) {
+            _u32 id = (_u32)events[pos].data.u64;
+            if (!id) {
+                _u64 counter;
+                if (::read(loop->wakeupFd, &counter, sizeof(counter)) < 0) {
+                    // already drained
+                }
+                continue;
+            }
+
+            Registration* reg;
+            {
+                rp::hal::AutoLocker l(_locker);
+                reg = _findRegistration_locked(id);
+                if (!reg || !reg->polling) continue;
+                ++reg->busy;
+            }
+
+            bool dataQueued = false;
+            bool channelOK = reg->handler->onReactorReadable(dataQueued);
+
+            rp::hal::AutoLocker l(_locker);
+            if (!channelOK && reg->polling) {
+                epoll_ctl(loop->epollFd, EPOLL_CTL_DEL, reg->handle, NULL);
+                reg->polling = false;
+            }
+            if (dataQueued) _scheduleDecode_locked(id, reg);
+            --reg->busy;
+        }
+    }
+    return RESULT_OK;
+}
+
+#else
+
+u_result IOReactor::start()
+{
+    return RESULT_OPERATION_NOT_SUPPORT;
+}
+
+void IOReactor::stop()
+{
+    _isRunning = false;
+}
+
+u_result IOReactor::attach(int pollableHandle, IIOReactorHandler* handler, _u32& regID)
+{
+    return RESULT_OPERATION_NOT_SUPPORT;
+}
+
+void IOReactor::detach(_u32 regID)
+{
+}
+
+u_result IOReactor::_proc_ioLoop(IOLoop* loop)
+{
+    return RESULT_OPERATION_NOT_SUPPORT;
+}
+
+#endif
+
+_word_size_t THREAD_PROC IOReactor::_ioThreadThunk(void* data)
+{
+    IOLoop* loop = static_cast<IOLoop*>(data);
+    return loop->owner->_proc_ioLoop(loop);
+}
+
+IOReactor::Registration* IOReactor::_findRegistration_locked(_u32 regID)
+{
+    std::map<_u32, Registration*>::iterator itr = _registrations.find(regID);
+    if (itr == _registrations.end() || itr->second->detached) return NULL;
+    return itr->second;
+}
+
+void IOReactor::_scheduleDecode_locked(_u32 regID, Registration* reg)
+{
+    if (reg->detached) return;
+    if (reg->decoding) {
+        // the worker decoding it will requeue it
+        reg->decodeRequested = true;
+        return;
+    }
+    if (reg->decodeQueued) return;
+
+    reg->decodeQueued = true;
+    _decodeQueue.push_back(regID);
+    _decodeEvt.set();
+}
+
+u_result IOReactor::_proc_decodeWorker()
+{
+    int index = _nextDecodeWorkerIndex++;
+    applyThreadConfig(_decodeWorkerConfig, "sl_reactor_dec", (_decodeWorkerCount > 1) ? index : -1);
+
+    while (_isRunning)
+    {
+        _u32 id = 0;
+        Registration* reg = NULL;
+        {
+            rp::hal::AutoLocker l(_locker);
+            while (!_decodeQueue.empty() && !reg) {
+                id = _decodeQueue.front();
+                _decodeQueue.pop_front();
+                reg = _findRegistration_locked(id);
+            }
+
+            if (reg) {
+                reg->decodeQueued = false;
+                reg->decoding = true;
+                ++reg->busy;
+            }
+
+            // let another worker take the next one
+            if (!_decodeQueue.empty()) _decodeEvt.set();
+        }
+
+        if (!reg) {
+            _decodeEvt.wait(1000);
+            continue;
+        }
+
+        bool pending = reg->handler->onReactorDecode();
+
+        rp::hal::AutoLocker l(_locker);
+        reg->decoding = false;
+        // requeue at the tail so one busy channel cannot starve the others
+        if (pending || reg->decodeRequested) {
+            reg->decodeRequested = false;
+            _scheduleDecode_locked(id, reg);
+        }
+        --reg->busy;
+    }
+
+    // wake up the next worker so it can exit as well
+    _decodeEvt.set();
+    return RESULT_OK;
+}
+
+}}
+
+namespace sl {
+
+    Result<ILidarIOReactor*> createLidarIOReactor(size_t ioThreadCount, size_t decodeWorkerCount)
+    {
+        return createLidarIOReactor(ioThreadCount, decodeWorkerCount, LidarThreadConfig(), LidarThreadConfig());
+    }
+
+    Result<ILidarIOReactor*> createLidarIOReactor(size_t ioThreadCount, size_t decodeWorkerCount,
+        const LidarThreadConfig& ioThreadConfig, const LidarThreadConfig& decodeWorkerConfig)
+    {
+        internal::IOReactor* reactor = new internal::IOReactor(ioThreadCount, decodeWorkerCount, ioThreadConfig, decodeWorkerConfig);
+        u_result ans = reactor->start();
+        if (IS_FAIL(ans)) {
+            delete reactor;
+            return (sl_result)ans;
+        }
+        return (ILidarIOReactor*)reactor;
+    }
+
+}
@@ -0,0 +1,134 @@
+/*
+ *  Slamtec LIDAR SDK
+ *
+ *  Copyright (c) 2014 - 2023 Shanghai Slamtec Co., Ltd.
+ *  http://www.slamtec.com
+ *
+ */
+ /*
+  * Redistribution and use in source and binary forms, with or without
+  * modification, are permitted provided that the following conditions are met:
+  *
+  * 1. Redistributions of source code must retain the above copyright notice,
+  *    this list of conditions and the following disclaimer.
+  *
+  * 2. Redistributions in binary form must reproduce the above copyright notice,
+  *    this list of conditions and the following disclaimer in the documentation
+  *    and/or other materials provided with the distribution.
+  *
+  * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+  * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+  * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+  * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+  * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+  * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+  * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+  * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+  * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+  * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+  * EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+  *
+  */
+
+#pragma once
+
+#include <map>
+#include <deque>
+#include <vector>
+#include <atomic>
+
+#include "hal/thread.h"
+#include "hal/locker.h"
+#include "hal/event.h"
+
+namespace sl { namespace internal {
+
+class IIOReactorHandler {
+public:
+    virtual ~IIOReactorHandler() {}
+
+    // invoked by the io thread owning the channel when it becomes readable
+    // return false if the channel is broken, it will not be polled anymore
+    virtual bool onReactorReadable(bool& dataQueued) = 0;
+
+    // invoked by a decode worker, never concurrently for the same handler
+    // return true if there is still data pending to be decoded
+    virtual bool onReactorDecode() = 0;
+};
+
+
+// a few epoll loops receiving from many channels plus a worker pool decoding the data
+class IOReactor : public ILidarIOReactor {
+public:
+    enum {
+        MAX_EVENTS_PER_WAIT = 32,
+        DECODE_ROUNDS_PER_TURN = 2,
+    };
+
+    IOReactor(size_t ioThreadCount, size_t decodeWorkerCount,
+        const LidarThreadConfig& ioThreadConfig = LidarThreadConfig(), const LidarThreadConfig& decodeWorkerConfig = LidarThreadConfig());
+    virtual ~IOReactor();
+
+    u_result start();
+    void     stop();
+
+    size_t getIOThreadCount() const;
+    size_t getDecodeWorkerCount() const;
+    size_t getAttachedChannelCount();
+
+    // start polling the given handle, the handler will be invoked from the reactor threads
+    u_result attach(int pollableHandle, IIOReactorHandler* handler, _u32& regID);
+
+    // stop polling, no handler callback is in progress or will be issued once it returns
+    void     detach(_u32 regID);
+
+protected:
+    struct IOLoop {
+        IOReactor*      owner;
+        size_t          index;
+        int             epollFd;
+        int             wakeupFd;
+        size_t          channelCount;
+        rp::hal::Thread thread;
+    };
+
+    struct Registration {
+        IIOReactorHandler* handler;
+        int     handle;
+        IOLoop* loop;
+        int     busy;
+        bool    polling;
+        bool    detached;
+        bool    decodeQueued;
+        bool    decoding;
+        bool    decodeRequested;
+    };
+
+    static _word_size_t THREAD_PROC _ioThreadThunk(void* data);
+
+    u_result _proc_ioLoop(IOLoop* loop);
+    u_result _proc_decodeWorker();
+
+    void _scheduleDecode_locked(_u32 regID, Registration* reg);
+    Registration* _findRegistration_locked(_u32 regID);
+
+protected:
+    size_t _ioThreadCount;
+    size_t _decodeWorkerCount;
+    bool   _isRunning;
+
+    LidarThreadConfig _ioThreadConfig;
+    LidarThreadConfig _decodeWorkerConfig;
+    std::atomic<int>  _nextDecodeWorkerIndex;
+
+    rp::hal::Locker _locker;
+    rp::hal::Event  _decodeEvt;
+
+    std::vector<IOLoop*>           _ioLoops;
+    std::vector<rp::hal::Thread>   _decodeWorkers;
+    std::map<_u32, Registration*>  _registrations;
+    std::deque<_u32>               _decodeQueue;
+    _u32                           _nextRegID;
+};
+
+}}
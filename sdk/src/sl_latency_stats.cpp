@@ -0,0 +1,142 @@
+/*
+ *  Slamtec LIDAR SDK
+ *
+ *  Copyright (c) 2014 - 2023 Shanghai Slamtec Co., Ltd.
+ *  http://www.slamtec.com
+ *
+ */
+ /*
+  * Redistribution and use in source and binary forms, with or without
+  * modification, are permitted provided that the following conditions are met:
+  *
+  * 1. Redistributions of source code must retain the above copyright notice,
+  *    this list of conditions and the following disclaimer.
+  *
+  * 2. Redistributions in binary form must reproduce the above copyright notice,
+  *    this list of conditions and the following disclaimer in the documentation
+  *    and/or other materials provided with the distribution.
+  *
+  * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+  * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+  * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+  * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+  * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+  * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+  * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+  * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+  * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+  * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+  * EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+  *
+  */
+
+#include "sdkcommon.h"
+#include "sl_lidar_driver.h"
+#include "sl_latency_stats.h"
+
+namespace sl { namespace internal {
+
+LatencyHistogram::LatencyHistogram()
+{
+    reset();
+}
+
+void LatencyHistogram::record(_u64 latency_uS)
+{
+    _u32 value = (latency_uS > 0xFFFFFFFFULL) ? 0xFFFFFFFF : (_u32)latency_uS;
+
+    _buckets[_getBucketID(value)].fetch_add(1, std::memory_order_relaxed);
+    _count.fetch_add(1, std::memory_order_relaxed);
+
+    _u32 currentMax = _max.load(std::memory_order_relaxed);
+    while (value > currentMax && !_max.compare_exchange_weak(currentMax, value, std::memory_order_relaxed)) {
+    }
+}
+
+void LatencyHistogram::reset()
+{
+    for (size_t pos = 0; pos < BUCKET_COUNT; ++pos) {
+        _buckets[pos].store(0, std::memory_order_relaxed);
+    }
+    _count.store(0, std::memory_order_relaxed);
+    _max.store(0, std::memory_order_relaxed);
+}
+
+void LatencyHistogram::getSummary(LidarLatencyHistogram& summary) const
+{
+    // the samples recorded during the walk are either counted or not, both are fine for statistics
+    _u64 count = 0;
+    for (size_t pos = 0; pos < BUCKET_COUNT; ++pos) {
+        count += _buckets[pos].load(std::memory_order_relaxed);
+    }
+
+    summary.count = count;
+    summary.max_uS = _max.load(std::memory_order_relaxed);
+    summary.p50_uS = _getPercentile(count, 0.50);
+    summary.p99_uS = _getPercentile(count, 0.99);
+
+    if (summary.p50_uS > summary.max_uS) summary.p50_uS = summary.max_uS;
+    if (summary.p99_uS > summary.max_uS) summary.p99_uS = summary.max_uS;
+}
+
+size_t LatencyHistogram::_getBucketID(_u32 latency_uS)
+{
+    if (latency_uS < LINEAR_LIMIT) return latency_uS;
+
+    int msb = 31;
+    while (!(latency_uS & (0x1U << msb))) --msb;
+
+    // the bits right below the msb select the sub bucket
+    size_t subBucket = (latency_uS >> (msb - SUB_BUCKET_BITS)) & (SUB_BUCKET_COUNT - 1);
+    return LINEAR_LIMIT + (msb - SUB_BUCKET_BITS - 1) * SUB_BUCKET_COUNT + subBucket;
+}
+
+_u32 LatencyHistogram::_getBucketUpperBound(size_t bucketID)
+{
+    if (bucketID < LINEAR_LIMIT) return (_u32)bucketID;
+
+    int msb = (int)((bucketID - LINEAR_LIMIT) / SUB_BUCKET_COUNT) + SUB_BUCKET_BITS + 1;
+    _u64 subBucket = (bucketID - LINEAR_LIMIT) % SUB_BUCKET_COUNT;
+    _u64 lowerBound = (0x1ULL << msb) | (subBucket << (msb - SUB_BUCKET_BITS));
+    _u64 upperBound = lowerBound + (0x1ULL << (msb - SUB_BUCKET_BITS)) - 1;
+    return (upperBound > 0xFFFFFFFFULL) ? 0xFFFFFFFF : (_u32)upperBound;
+}
+
+_u32 LatencyHistogram::_getPercentile(_u64 count, double percentile) const
+{
+    if (!count) return 0;
+
+    _u64 rank = (_u64)(count * percentile + 0.5);
+    if (rank < 1) rank = 1;
+
+    _u64 accumulated = 0;
+    for (size_t pos = 0; pos < BUCKET_COUNT; ++pos) {
+        accumulated += _buckets[pos].load(std::memory_order_relaxed);
+        if (accumulated >= rank) return _getBucketUpperBound(pos);
+    }
+    return _max.load(std::memory_order_relaxed);
+}
+
+
+LatencyTracker::LatencyTracker()
+    : _rxQueueDepthMax(0)
+{
+}
+
+void LatencyTracker::reset()
+{
+    rxQueue.reset();
+    nodeDecode.reset();
+    scanSwap.reset();
+    scanGrab.reset();
+    _rxQueueDepthMax = 0;
+}
+
+void LatencyTracker::updateRxQueueDepth(size_t depth)
+{
+    size_t currentMax = _rxQueueDepthMax.load(std::memory_order_relaxed);
+    while (depth > currentMax && !_rxQueueDepthMax.compare_exchange_weak(currentMax, depth, std::memory_order_relaxed)) {
+    }
+}
+
+}}
@@ -0,0 +1,95 @@
+/*
+ *  Slamtec LIDAR SDK
+ *
+ *  Copyright (c) 2014 - 2023 Shanghai Slamtec Co., Ltd.
+ *  http://www.slamtec.com
+ *
+ */
+ /*
+  * Redistribution and use in source and binary forms, with or without
+  * modification, are permitted provided that the following conditions are met:
+  *
+  * 1. Redistributions of source code must retain the above copyright notice,
+  *    this list of conditions and the following disclaimer.
+  *
+  * 2. Redistributions in binary form must reproduce the above copyright notice,
+  *    this list of conditions and the following disclaimer in the documentation
+  *    and/or other materials provided with the distribution.
+  *
+  * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+  * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+  * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+  * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+  * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+  * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+  * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+  * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+  * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+  * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+  * EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+  *
+  */
+
+#pragma once
+
+#include <atomic>
+
+namespace sl { namespace internal {
+
+// lock-free log-linear histogram of latencies in microseconds
+// every power of two is split into 8 buckets, so a reported percentile is within 1/8 of the real value
+class LatencyHistogram
+{
+public:
+    enum {
+        SUB_BUCKET_BITS = 3,
+        SUB_BUCKET_COUNT = 1 << SUB_BUCKET_BITS,
+        // values below it get a bucket of their own
+        LINEAR_LIMIT = SUB_BUCKET_COUNT * 2,
+        BUCKET_COUNT = LINEAR_LIMIT + (32 - SUB_BUCKET_BITS - 1) * SUB_BUCKET_COUNT,
+    };
+
+    LatencyHistogram();
+
+    // can be called from several threads at the same time
+    void record(_u64 latency_uS);
+    void reset();
+
+    void getSummary(LidarLatencyHistogram& summary) const;
+
+protected:
+    static size_t _getBucketID(_u32 latency_uS);
+    static _u32 _getBucketUpperBound(size_t bucketID);
+
+    _u32 _getPercentile(_u64 count, double percentile) const;
+
+    std::atomic<_u32> _buckets[BUCKET_COUNT];
+    std::atomic<_u64> _count;
+    std::atomic<_u32> _max;
+};
+
+// the histograms of every instrumented stage of a driver
+class LatencyTracker
+{
+public:
+    LatencyTracker();
+
+    void reset();
+
+    // the peak depth of the rx queue, observed by the decoder
+    void updateRxQueueDepth(size_t depth);
+
+    size_t getRxQueueDepthMax() const {
+        return _rxQueueDepthMax.load();
+    }
+
+    LatencyHistogram rxQueue;
+    LatencyHistogram nodeDecode;
+    LatencyHistogram scanSwap;
+    LatencyHistogram scanGrab;
+
+protected:
+    std::atomic<size_t> _rxQueueDepthMax;
+};
+
+}}
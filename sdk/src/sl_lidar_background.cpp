@@ -0,0 +1,324 @@
+/*
+ *  Slamtec LIDAR SDK
+ *
+ *  Copyright (c) 2014 - 2023 Shanghai Slamtec Co., Ltd.
+ *  http://www.slamtec.com
+ *
+ */
+ /*
+  * Redistribution and use in source and binary forms, with or without
+  * modification, are permitted provided that the following conditions are met:
+  *
+  * 1. Redistributions of source code must retain the above copyright notice,
+  *    this list of conditions and the following disclaimer.
+  *
+  * 2. Redistributions in binary form must reproduce the above copyright notice,
+  *    this list of conditions and the following disclaimer in the documentation
+  *    and/or other materials provided with the distribution.
+  *
+  * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+  * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+  * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+  * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+  * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+  * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+  * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+  * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+  * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+  * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+  * EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+  *
+  */
+
+#include "sdkcommon.h"
+#include "sl_lidar_background.h"
+
+#include <math.h>
+#include <float.h>
+#include <algorithm>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define SL_BACKGROUND_SSE2
+#include <emmintrin.h>
+#endif
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+// compiled with the target attribute and selected at runtime
+#define SL_BACKGROUND_AVX2
+#include <immintrin.h>
+#endif
+
+#if defined(__aarch64__) && (defined(__ARM_NEON) || defined(__ARM_NEON__))
+// vsqrtq_f32 is only available on AArch64
+#define SL_BACKGROUND_NEON
+#include <arm_neon.h>
+#endif
+
+namespace sl {
+
+    struct BackgroundBinUpdate
+    {
+        const float* observed;
+        float* mean;
+        float* variance;
+        float* presence;
+        float* limit;
+
+        float rate;
+        float foregroundRate;
+        float minDistance;
+        float sigmaFactor;
+    };
+
+    // every routine updates the bins from pos on and returns the first bin left to the other paths:
+    // the limit is computed from the statistics before they learn the observed range
+    static size_t _updateBins_scalar(const BackgroundBinUpdate& u, size_t pos, size_t count)
+    {
+        for (; pos < count; ++pos) {
+            float observed = u.observed[pos];
+            float mean = u.mean[pos];
+            float variance = u.variance[pos];
+
+            float limit = (u.presence[pos] >= 0.5f) ? mean - std::max(u.minDistance, u.sigmaFactor * sqrtf(variance)) : FLT_MAX;
+            u.limit[pos] = limit;
+
+            bool hit = observed > 0;
+            float rate = (hit && observed < limit) ? u.foregroundRate : u.rate;
+            u.presence[pos] += rate * ((hit ? 1.f : 0.f) - u.presence[pos]);
+            if (!hit) continue;
+
+            if (mean == 0 && rate > 0) {
+                u.mean[pos] = observed;
+                u.variance[pos] = 0;
+            }
+            else {
+                float delta = observed - mean;
+                u.mean[pos] = mean + rate * delta;
+                u.variance[pos] = (1 - rate) * (variance + rate * delta * delta);
+            }
+        }
+        return pos;
+    }
+
+#ifdef SL_BACKGROUND_AVX2
+    static bool _isAVX2Supported()
+    {
+        static const bool supported = __builtin_cpu_supports("avx2");
+        return supported;
+    }
+
+    __attribute__((target("avx2")))
+    static size_t _updateBins_avx2(const BackgroundBinUpdate& u, size_t pos, size_t count)
+    {
+        const __m256 zero = _mm256_setzero_ps();
+        const __m256 one = _mm256_set1_ps(1.f);
+        const __m256 half = _mm256_set1_ps(0.5f);
+        const __m256 noLimit = _mm256_set1_ps(FLT_MAX);
+        const __m256 rate = _mm256_set1_ps(u.rate);
+        const __m256 foregroundRate = _mm256_set1_ps(u.foregroundRate);
+        const __m256 minDistance = _mm256_set1_ps(u.minDistance);
+        const __m256 sigmaFactor = _mm256_set1_ps(u.sigmaFactor);
+
+        for (; pos + 8 <= count; pos += 8) {
+            __m256 observed = _mm256_loadu_ps(u.observed + pos);
+            __m256 mean = _mm256_loadu_ps(u.mean + pos);
+            __m256 variance = _mm256_loadu_ps(u.variance + pos);
+            __m256 presence = _mm256_loadu_ps(u.presence + pos);
+
+            __m256 threshold = _mm256_max_ps(minDistance, _mm256_mul_ps(sigmaFactor, _mm256_sqrt_ps(variance)));
+            __m256 limit = _mm256_blendv_ps(noLimit, _mm256_sub_ps(mean, threshold), _mm256_cmp_ps(presence, half, _CMP_GE_OQ));
+            _mm256_storeu_ps(u.limit + pos, limit);
+
+            __m256 hit = _mm256_cmp_ps(observed, zero, _CMP_GT_OQ);
+            __m256 foreground = _mm256_and_ps(hit, _mm256_cmp_ps(observed, limit, _CMP_LT_OQ));
+            __m256 binRate = _mm256_blendv_ps(rate, foregroundRate, foreground);
+            presence = _mm256_add_ps(presence, _mm256_mul_ps(binRate, _mm256_sub_ps(_mm256_and_ps(hit, one), presence)));
+
+            __m256 hitRate = _mm256_and_ps(hit, binRate);
+            __m256 delta = _mm256_sub_ps(observed, mean);
+            __m256 newMean = _mm256_add_ps(mean, _mm256_mul_ps(hitRate, delta));
+            __m256 newVariance = _mm256_mul_ps(_mm256_sub_ps(one, hitRate), _mm256_add_ps(variance, _mm256_mul_ps(hitRate, _mm256_mul_ps(delta, delta))));
+
+            __m256 first = _mm256_and_ps(hit, _mm256_and_ps(_mm256_cmp_ps(mean, zero, _CMP_EQ_OQ), _mm256_cmp_ps(binRate, zero, _CMP_GT_OQ)));
+            _mm256_storeu_ps(u.mean + pos, _mm256_blendv_ps(newMean, observed, first));
+            _mm256_storeu_ps(u.variance + pos, _mm256_blendv_ps(newVariance, zero, first));
+            _mm256_storeu_ps(u.presence + pos, presence);
+        }
+        return pos;
+    }
+#endif
+
+#ifdef SL_BACKGROUND_SSE2
+    static inline __m128 _select_sse2(__m128 mask, __m128 a, __m128 b)
+    {
+        return _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b));
+    }
+
+    static size_t _updateBins_sse2(const BackgroundBinUpdate& u, size_t pos, size_t count)
+    {
+        const __m128 zero = _mm_setzero_ps();
+        const __m128 one = _mm_set1_ps(1.f);
+        const __m128 half = _mm_set1_ps(0.5f);
+        const __m128 noLimit = _mm_set1_ps(FLT_MAX);
+        const __m128 rate = _mm_set1_ps(u.rate);
+        const __m128 foregroundRate = _mm_set1_ps(u.foregroundRate);
+        const __m128 minDistance = _mm_set1_ps(u.minDistance);
+        const __m128 sigmaFactor = _mm_set1_ps(u.sigmaFactor);
+
+        for (; pos + 4 <= count; pos += 4) {
+            __m128 observed = _mm_loadu_ps(u.observed + pos);
+            __m128 mean = _mm_loadu_ps(u.mean + pos);
+            __m128 variance = _mm_loadu_ps(u.variance + pos);
+            __m128 presence = _mm_loadu_ps(u.presence + pos);
+
+            __m128 threshold = _mm_max_ps(minDistance, _mm_mul_ps(sigmaFactor, _mm_sqrt_ps(variance)));
+            __m128 limit = _select_sse2(_mm_cmpge_ps(presence, half), _mm_sub_ps(mean, threshold), noLimit);
+            _mm_storeu_ps(u.limit + pos, limit);
+
+            __m128 hit = _mm_cmpgt_ps(observed, zero);
+            __m128 foreground = _mm_and_ps(hit, _mm_cmplt_ps(observed, limit));
+            __m128 binRate = _select_sse2(foreground, foregroundRate, rate);
+            presence = _mm_add_ps(presence, _mm_mul_ps(binRate, _mm_sub_ps(_mm_and_ps(hit, one), presence)));
+
+            __m128 hitRate = _mm_and_ps(hit, binRate);
+            __m128 delta = _mm_sub_ps(observed, mean);
+            __m128 newMean = _mm_add_ps(mean, _mm_mul_ps(hitRate, delta));
+            __m128 newVariance = _mm_mul_ps(_mm_sub_ps(one, hitRate), _mm_add_ps(variance, _mm_mul_ps(hitRate, _mm_mul_ps(delta, delta))));
+
+            __m128 first = _mm_and_ps(hit, _mm_and_ps(_mm_cmpeq_ps(mean, zero), _mm_cmpgt_ps(binRate, zero)));
+            _mm_storeu_ps(u.mean + pos, _select_sse2(first, observed, newMean));
+            _mm_storeu_ps(u.variance + pos, _select_sse2(first, zero, newVariance));
+            _mm_storeu_ps(u.presence + pos, presence);
+        }
+        return pos;
+    }
+#endif
+
+#ifdef SL_BACKGROUND_NEON
+    static size_t _updateBins_neon(const BackgroundBinUpdate& u, size_t pos, size_t count)
+    {
+        const float32x4_t zero = vdupq_n_f32(0.f);
+        const float32x4_t one = vdupq_n_f32(1.f);
+        const float32x4_t noLimit = vdupq_n_f32(FLT_MAX);
+        const float32x4_t rate = vdupq_n_f32(u.rate);
+        const float32x4_t foregroundRate = vdupq_n_f32(u.foregroundRate);
+        const float32x4_t minDistance = vdupq_n_f32(u.minDistance);
+
+        for (; pos + 4 <= count; pos += 4) {
+            float32x4_t observed = vld1q_f32(u.observed + pos);
+            float32x4_t mean = vld1q_f32(u.mean + pos);
+            float32x4_t variance = vld1q_f32(u.variance + pos);
+            float32x4_t presence = vld1q_f32(u.presence + pos);
+
+            float32x4_t threshold = vmaxq_f32(minDistance, vmulq_n_f32(vsqrtq_f32(variance), u.sigmaFactor));
+            float32x4_t limit = vbslq_f32(vcgeq_f32(presence, vdupq_n_f32(0.5f)), vsubq_f32(mean, threshold), noLimit);
+            vst1q_f32(u.limit + pos, limit);
+
+            uint32x4_t hit = vcgtq_f32(observed, zero);
+            uint32x4_t foreground = vandq_u32(hit, vcltq_f32(observed, limit));
+            float32x4_t binRate = vbslq_f32(foreground, foregroundRate, rate);
+            presence = vaddq_f32(presence, vmulq_f32(binRate, vsubq_f32(vbslq_f32(hit, one, zero), presence)));
+
+            float32x4_t hitRate = vbslq_f32(hit, binRate, zero);
+            float32x4_t delta = vsubq_f32(observed, mean);
+            float32x4_t newMean = vaddq_f32(mean, vmulq_f32(hitRate, delta));
+            float32x4_t newVariance = vmulq_f32(vsubq_f32(one, hitRate), vaddq_f32(variance, vmulq_f32(hitRate, vmulq_f32(delta, delta))));
+
+            uint32x4_t first = vandq_u32(hit, vandq_u32(vceqq_f32(mean, zero), vcgtq_f32(binRate, zero)));
+            vst1q_f32(u.mean + pos, vbslq_f32(first, observed, newMean));
+            vst1q_f32(u.variance + pos, vbslq_f32(first, zero, newVariance));
+            vst1q_f32(u.presence + pos, presence);
+        }
+        return pos;
+    }
+#endif
+
+    static void _updateBins(const BackgroundBinUpdate& u, size_t count)
+    {
+        size_t pos = 0;
+#ifdef SL_BACKGROUND_AVX2
+        if (_isAVX2Supported()) {
+            pos = _updateBins_avx2(u, pos, count);
+        }
+#endif
+#ifdef SL_BACKGROUND_SSE2
+        pos = _updateBins_sse2(u, pos, count);
+#endif
+#ifdef SL_BACKGROUND_NEON
+        pos = _updateBins_neon(u, pos, count);
+#endif
+        _updateBins_scalar(u, pos, count);
+    }
+
+
+    LidarBackgroundModel::LidarBackgroundModel(const LidarBackgroundOptions& options)
+        : _scanCount(0)
+    {
+        reset(options);
+    }
+
+    void LidarBackgroundModel::reset(const LidarBackgroundOptions& options)
+    {
+        _options = options;
+        _options.binCount = std::min<size_t>(std::max<size_t>(_options.binCount, 1), 65536);
+        _scanCount = 0;
+
+        _observed.assign(_options.binCount, 0.f);
+        _limit.assign(_options.binCount, FLT_MAX);
+        _mean.assign(_options.binCount, 0.f);
+        _variance.assign(_options.binCount, 0.f);
+        _presence.assign(_options.binCount, 0.f);
+    }
+
+    size_t LidarBackgroundModel::apply(const sl_lidar_response_measurement_node_hq_t* nodes, size_t count, std::vector<sl_lidar_response_measurement_node_hq_t>& foreground, bool learn)
+    {
+        foreground.clear();
+        if (!nodes) count = 0;
+
+        const sl_u32 bins = (sl_u32)binCount();
+        float* observed = &_observed[0];
+        std::fill(_observed.begin(), _observed.end(), 0.f);
+        for (size_t pos = 0; pos < count; ++pos) {
+            if (!nodes[pos].dist_mm_q2) continue;
+            float value = nodes[pos].dist_mm_q2 * 0.25f;
+            float& bin = observed[(nodes[pos].angle_z_q14 * bins) >> 16];
+            if (!bin || value < bin) bin = value;
+        }
+
+        bool ready = isReady();
+
+        BackgroundBinUpdate update;
+        update.observed = observed;
+        update.mean = &_mean[0];
+        update.variance = &_variance[0];
+        update.presence = &_presence[0];
+        update.limit = &_limit[0];
+        update.minDistance = _options.minDistance;
+        update.sigmaFactor = _options.sigmaFactor;
+        if (!learn) {
+            update.rate = update.foregroundRate = 0;
+        }
+        else if (!ready) {
+            // a plain average of the scans so far
+            update.rate = update.foregroundRate = 1.f / (_scanCount + 1);
+        }
+        else {
+            update.rate = _options.learningRate;
+            update.foregroundRate = _options.foregroundLearningRate;
+        }
+        _updateBins(update, bins);
+
+        if (learn && !ready) ++_scanCount;
+        if (!ready) return 0;
+
+        const float* limit = &_limit[0];
+        for (size_t pos = 0; pos < count; ++pos) {
+            if (!nodes[pos].dist_mm_q2) continue;
+            if (nodes[pos].dist_mm_q2 * 0.25f < limit[(nodes[pos].angle_z_q14 * bins) >> 16]) {
+                foreground.push_back(nodes[pos]);
+            }
+        }
+        return foreground.size();
+    }
+
+}
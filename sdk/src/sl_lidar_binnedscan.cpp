@@ -0,0 +1,185 @@
+/*
+ *  Slamtec LIDAR SDK
+ *
+ *  Copyright (c) 2014 - 2023 Shanghai Slamtec Co., Ltd.
+ *  http://www.slamtec.com
+ *
+ */
+ /*
+  * Redistribution and use in source and binary forms, with or without
+  * modification, are permitted provided that the following conditions are met:
+  *
+  * 1. Redistributions of source code must retain the above copyright notice,
+  *    this list of conditions and the following disclaimer.
+  *
+  * 2. Redistributions in binary form must reproduce the above copyright notice,
+  *    this list of conditions and the following disclaimer in the documentation
+  *    and/or other materials provided with the distribution.
+  *
+  * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+  * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+  * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+  * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+  * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+  * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+  * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+  * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+  * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+  * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+  * EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+  *
+  */
+
+#include "sl_lidar_binnedscan.h"
+#include <math.h>
+#include <float.h>
+#include <algorithm>
+
+namespace sl {
+
+    LidarBinnedScan::LidarBinnedScan(size_t binCount, BinPolicy policy)
+        : _policy(policy)
+        , _timestamp_uS(0)
+    {
+        configure(binCount, policy);
+    }
+
+    void LidarBinnedScan::configure(size_t binCount, BinPolicy policy)
+    {
+        binCount = std::min<size_t>(std::max<size_t>(binCount, 1), MAX_BIN_COUNT);
+        _policy = policy;
+
+        _range.assign(binCount, 0.f);
+        _key.assign(binCount, FLT_MAX);
+        _nodeCount.assign(policy == BIN_POLICY_MEAN ? binCount : 0, 0);
+
+        _log2.assign(binCount + 1, 0);
+        for (size_t pos = 2; pos <= binCount; ++pos) {
+            _log2[pos] = _log2[pos / 2] + 1;
+        }
+        _sectorTable.resize(binCount * (_log2[binCount] + 1));
+        clear();
+    }
+
+    void LidarBinnedScan::clear()
+    {
+        _timestamp_uS = 0;
+        std::fill(_range.begin(), _range.end(), 0.f);
+        std::fill(_key.begin(), _key.end(), FLT_MAX);
+        _buildSectorTable();
+    }
+
+    void LidarBinnedScan::assign(const sl_lidar_response_measurement_node_hq_t* nodes, size_t count, sl_u64 timestamp_uS)
+    {
+        const sl_u32 bins = (sl_u32)binCount();
+        float* range = &_range[0];
+
+        _timestamp_uS = timestamp_uS;
+        std::fill(_range.begin(), _range.end(), 0.f);
+
+        switch (_policy) {
+        case BIN_POLICY_MIN:
+            for (size_t pos = 0; pos < count; ++pos) {
+                if (!nodes[pos].dist_mm_q2) continue;
+                float value = nodes[pos].dist_mm_q2 * 0.25f;
+                float& bin = range[(nodes[pos].angle_z_q14 * bins) >> 16];
+                if (!bin || value < bin) bin = value;
+            }
+            break;
+
+        case BIN_POLICY_LAST:
+            for (size_t pos = 0; pos < count; ++pos) {
+                if (!nodes[pos].dist_mm_q2) continue;
+                range[(nodes[pos].angle_z_q14 * bins) >> 16] = nodes[pos].dist_mm_q2 * 0.25f;
+            }
+            break;
+
+        case BIN_POLICY_MEAN:
+            {
+                sl_u32* nodeCount = &_nodeCount[0];
+                std::fill(_nodeCount.begin(), _nodeCount.end(), 0);
+                for (size_t pos = 0; pos < count; ++pos) {
+                    if (!nodes[pos].dist_mm_q2) continue;
+                    sl_u32 bin = (nodes[pos].angle_z_q14 * bins) >> 16;
+                    range[bin] += nodes[pos].dist_mm_q2 * 0.25f;
+                    ++nodeCount[bin];
+                }
+                for (sl_u32 bin = 0; bin < bins; ++bin) {
+                    if (nodeCount[bin] > 1) range[bin] /= nodeCount[bin];
+                }
+            }
+            break;
+        }
+
+        for (sl_u32 bin = 0; bin < bins; ++bin) {
+            _key[bin] = range[bin] ? range[bin] : FLT_MAX;
+        }
+        _buildSectorTable();
+    }
+
+    void LidarBinnedScan::_buildSectorTable()
+    {
+        const size_t bins = binCount();
+        sl_u32* level = &_sectorTable[0];
+
+        for (size_t pos = 0; pos < bins; ++pos) {
+            level[pos] = (sl_u32)pos;
+        }
+
+        // the min of 2^k bins is the min of the two halves of 2^(k-1) bins
+        for (size_t span = 1; span * 2 <= bins; span *= 2) {
+            const sl_u32* previous = level;
+            level += bins;
+            for (size_t pos = 0; pos + span * 2 <= bins; ++pos) {
+                sl_u32 left = previous[pos];
+                sl_u32 right = previous[pos + span];
+                level[pos] = _key[right] < _key[left] ? right : left;
+            }
+        }
+    }
+
+    size_t LidarBinnedScan::_minBinOfRange(size_t fromBin, size_t toBin) const
+    {
+        // two overlapping power-of-two spans cover the range
+        size_t levelIndex = _log2[toBin - fromBin + 1];
+        const sl_u32* level = &_sectorTable[levelIndex * binCount()];
+        sl_u32 left = level[fromBin];
+        sl_u32 right = level[toBin + 1 - ((size_t)1 << levelIndex)];
+        return _key[right] < _key[left] ? right : left;
+    }
+
+    size_t LidarBinnedScan::minBin(size_t fromBin, size_t toBin) const
+    {
+        const size_t bins = binCount();
+        if (fromBin >= bins || toBin >= bins) return bins;
+
+        size_t found;
+        if (fromBin <= toBin) {
+            found = _minBinOfRange(fromBin, toBin);
+        }
+        else {
+            size_t head = _minBinOfRange(fromBin, bins - 1);
+            size_t tail = _minBinOfRange(0, toBin);
+            found = _key[tail] < _key[head] ? tail : head;
+        }
+        return _range[found] ? found : bins;
+    }
+
+    size_t LidarBinnedScan::binAt(float angle) const
+    {
+        const size_t bins = binCount();
+        float wrapped = fmodf(angle, 360.f);
+        if (wrapped < 0) wrapped += 360.f;
+
+        size_t bin = (size_t)(wrapped * (bins / 360.f));
+        return bin < bins ? bin : bins - 1;
+    }
+
+    float LidarBinnedScan::minRange(float fromAngle, float toAngle, size_t* bin) const
+    {
+        size_t found = minBin(binAt(fromAngle), binAt(toAngle));
+        if (bin) *bin = found;
+        return found < binCount() ? _range[found] : 0.f;
+    }
+
+}
@@ -0,0 +1,393 @@
+/*
+ *  Slamtec LIDAR SDK
+ *
+ *  Copyright (c) 2014 - 2023 Shanghai Slamtec Co., Ltd.
+ *  http://www.slamtec.com
+ *
+ */
+ /*
+  * Redistribution and use in source and binary forms, with or without
+  * modification, are permitted provided that the following conditions are met:
+  *
+  * 1. Redistributions of source code must retain the above copyright notice,
+  *    this list of conditions and the following disclaimer.
+  *
+  * 2. Redistributions in binary form must reproduce the above copyright notice,
+  *    this list of conditions and the following disclaimer in the documentation
+  *    and/or other materials provided with the distribution.
+  *
+  * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+  * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+  * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+  * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+  * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+  * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+  * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+  * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+  * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+  * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+  * EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+  *
+  */
+
+#include "sdkcommon.h"
+#include "sl_lidar.h"
+#include "sl_lidar_c.h"
+
+#include <atomic>
+#include <vector>
+
+using namespace sl;
+
+// the driver, and the channel it is connected through
+// every scan buffer out holds a reference, so the driver outlives the buffers released after sl_lidar_destroy
+struct sl_lidar_t
+{
+    ILidarDriver* driver;
+    IChannel* channel;
+    std::atomic<int> refs;
+
+    sl_lidar_t(ILidarDriver* driver)
+        : driver(driver)
+        , channel(NULL)
+        , refs(1)
+    {
+    }
+
+    void addRef()
+    {
+        refs.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    void release()
+    {
+        if (refs.fetch_sub(1, std::memory_order_acq_rel) != 1) return;
+        delete driver;
+        delete channel;
+        delete this;
+    }
+};
+
+namespace {
+
+    const sl_lidar_scan_field_t s_scanFields[] = {
+        { "angle_z_q14", SL_LIDAR_DTYPE_UINT, 16, offsetof(sl_lidar_response_measurement_node_hq_t, angle_z_q14), 90.0 / 16384.0, "deg" },
+        { "dist_mm_q2",  SL_LIDAR_DTYPE_UINT, 32, offsetof(sl_lidar_response_measurement_node_hq_t, dist_mm_q2), 1.0 / 4.0, "mm" },
+        { "quality",     SL_LIDAR_DTYPE_UINT, 8,  offsetof(sl_lidar_response_measurement_node_hq_t, quality), 1.0, "" },
+        { "flag",        SL_LIDAR_DTYPE_UINT, 8,  offsetof(sl_lidar_response_measurement_node_hq_t, flag), 1.0, "" },
+    };
+
+    struct ScanBufferHolder
+    {
+        sl_lidar_scan_buffer_t buffer;
+        sl_lidar_t* owner;
+        LidarScanLease lease;
+    };
+
+    void releaseScanBuffer(sl_lidar_scan_buffer_t* buffer)
+    {
+        if (!buffer) return;
+        ScanBufferHolder* holder = (ScanBufferHolder*)buffer->manager_ctx;
+
+        holder->owner->driver->releaseScan(holder->lease);
+        holder->owner->release();
+        delete holder;
+    }
+
+    sl_result exportScanBuffer(sl_lidar_t* lidar, ScanBufferHolder* holder, sl_lidar_scan_buffer_t** buffer)
+    {
+        sl_lidar_scan_buffer_t& desc = holder->buffer;
+        memset(&desc, 0, sizeof(desc));
+        desc.data = holder->lease.nodes;
+        desc.count = holder->lease.count;
+        desc.stride = sizeof(sl_lidar_response_measurement_node_hq_t);
+        desc.fields = s_scanFields;
+        desc.field_count = _countof(s_scanFields);
+        desc.timestamp_us = holder->lease.timestamp_uS;
+        desc.end_timestamp_us = holder->lease.endTimestamp_uS;
+        desc.sequence = holder->lease.sequence;
+        desc.manager_ctx = holder;
+        desc.release = releaseScanBuffer;
+
+        holder->owner = lidar;
+        lidar->addRef();
+        *buffer = &desc;
+        return SL_RESULT_OK;
+    }
+
+    void exportScanMode(const LidarScanMode& mode, sl_lidar_scan_mode_t* out)
+    {
+        if (!out) return;
+        memset(out, 0, sizeof(*out));
+        out->id = mode.id;
+        out->us_per_sample = mode.us_per_sample;
+        out->max_distance = mode.max_distance;
+        out->ans_type = mode.ans_type;
+        memcpy(out->name, mode.scan_mode, sizeof(out->name));
+        out->name[sizeof(out->name) - 1] = 0;
+    }
+
+    sl_result connectChannel(sl_lidar_t* lidar, Result<IChannel*> channel)
+    {
+        if (!channel) return channel.err;
+
+        lidar->driver->disconnect();
+        delete lidar->channel;
+        lidar->channel = channel.value;
+
+        sl_result ans = lidar->driver->connect(lidar->channel);
+        if (SL_IS_FAIL(ans)) {
+            delete lidar->channel;
+            lidar->channel = NULL;
+        }
+        return ans;
+    }
+
+    // the caller may know an older (shorter) version of the struct
+    template <typename T>
+    void copyOut(const T& source, void* dest, size_t size)
+    {
+        memcpy(dest, &source, size < sizeof(T) ? size : sizeof(T));
+    }
+
+}
+
+extern "C" {
+
+uint32_t sl_lidar_abi_version(void)
+{
+    return SL_LIDAR_C_ABI_VERSION;
+}
+
+sl_result sl_lidar_create(sl_lidar_t** lidar)
+{
+    if (!lidar) return SL_RESULT_INVALID_DATA;
+    *lidar = NULL;
+
+    Result<ILidarDriver*> driver = createLidarDriver();
+    if (!driver) return driver.err;
+
+    *lidar = new sl_lidar_t(driver.value);
+    return SL_RESULT_OK;
+}
+
+void sl_lidar_destroy(sl_lidar_t* lidar)
+{
+    if (!lidar) return;
+    // the scans still leased keep their memory, the driver only stops updating it
+    lidar->driver->disconnect();
+    lidar->release();
+}
+
+sl_result sl_lidar_connect_serial(sl_lidar_t* lidar, const char* device, uint32_t baudrate)
+{
+    if (!lidar || !device) return SL_RESULT_INVALID_DATA;
+    return connectChannel(lidar, createSerialPortChannel(device, (int)baudrate));
+}
+
+sl_result sl_lidar_connect_tcp(sl_lidar_t* lidar, const char* ip, uint16_t port)
+{
+    if (!lidar || !ip) return SL_RESULT_INVALID_DATA;
+    return connectChannel(lidar, createTcpChannel(ip, port));
+}
+
+sl_result sl_lidar_connect_udp(sl_lidar_t* lidar, const char* ip, uint16_t port)
+{
+    if (!lidar || !ip) return SL_RESULT_INVALID_DATA;
+    return connectChannel(lidar, createUdpChannel(ip, port));
+}
+
+void sl_lidar_disconnect(sl_lidar_t* lidar)
+{
+    if (!lidar) return;
+    lidar->driver->disconnect();
+    delete lidar->channel;
+    lidar->channel = NULL;
+}
+
+int sl_lidar_is_connected(sl_lidar_t* lidar)
+{
+    return (lidar && lidar->driver->isConnected()) ? 1 : 0;
+}
+
+sl_result sl_lidar_get_device_info(sl_lidar_t* lidar, sl_lidar_response_device_info_t* info, uint32_t timeout_ms)
+{
+    if (!lidar || !info) return SL_RESULT_INVALID_DATA;
+    return lidar->driver->getDeviceInfo(*info, timeout_ms);
+}
+
+sl_result sl_lidar_get_health(sl_lidar_t* lidar, sl_lidar_response_device_health_t* health, uint32_t timeout_ms)
+{
+    if (!lidar || !health) return SL_RESULT_INVALID_DATA;
+    return lidar->driver->getHealth(*health, timeout_ms);
+}
+
+sl_result sl_lidar_get_scan_modes(sl_lidar_t* lidar, sl_lidar_scan_mode_t* modes, size_t* count)
+{
+    if (!lidar || !count) return SL_RESULT_INVALID_DATA;
+
+    std::vector<LidarScanMode> supportedModes;
+    sl_result ans = lidar->driver->getAllSupportedScanModes(supportedModes);
+    if (SL_IS_FAIL(ans)) {
+        *count = 0;
+        return ans;
+    }
+
+    if (!modes) {
+        *count = supportedModes.size();
+        return SL_RESULT_OK;
+    }
+
+    size_t filled = supportedModes.size() < *count ? supportedModes.size() : *count;
+    for (size_t pos = 0; pos < filled; ++pos) {
+        exportScanMode(supportedModes[pos], &modes[pos]);
+    }
+    *count = filled;
+    return SL_RESULT_OK;
+}
+
+sl_result sl_lidar_start_scan(sl_lidar_t* lidar, int force, int use_typical_scan, sl_lidar_scan_mode_t* used_mode)
+{
+    if (!lidar) return SL_RESULT_INVALID_DATA;
+
+    LidarScanMode mode;
+    sl_result ans = lidar->driver->startScan(force != 0, use_typical_scan != 0, 0, &mode);
+    if (SL_IS_OK(ans)) exportScanMode(mode, used_mode);
+    return ans;
+}
+
+sl_result sl_lidar_start_scan_mode(sl_lidar_t* lidar, uint16_t mode_id, sl_lidar_scan_mode_t* used_mode)
+{
+    if (!lidar) return SL_RESULT_INVALID_DATA;
+
+    LidarScanMode mode;
+    sl_result ans = lidar->driver->startScanExpress(false, mode_id, 0, &mode);
+    if (SL_IS_OK(ans)) exportScanMode(mode, used_mode);
+    return ans;
+}
+
+sl_result sl_lidar_stop(sl_lidar_t* lidar)
+{
+    if (!lidar) return SL_RESULT_INVALID_DATA;
+    return lidar->driver->stop();
+}
+
+sl_result sl_lidar_set_motor_speed(sl_lidar_t* lidar, uint16_t speed)
+{
+    if (!lidar) return SL_RESULT_INVALID_DATA;
+    return lidar->driver->setMotorSpeed(speed);
+}
+
+sl_result sl_lidar_set_acquisition_filter(sl_lidar_t* lidar, const float* start_deg, const float* end_deg, size_t range_count
+    , uint32_t decimation, uint8_t min_quality)
+{
+    if (!lidar || (range_count && (!start_deg || !end_deg))) return SL_RESULT_INVALID_DATA;
+
+    LidarAcquisitionFilter filter;
+    for (size_t pos = 0; pos < range_count; ++pos) {
+        sl_result ans = filter.addRange(start_deg[pos], end_deg[pos]);
+        if (SL_IS_FAIL(ans)) return ans;
+    }
+    filter.decimation = decimation;
+    filter.minQuality = min_quality;
+    return lidar->driver->setAcquisitionFilter(filter);
+}
+
+sl_result sl_lidar_acquire_scan(sl_lidar_t* lidar, uint32_t timeout_ms, sl_lidar_scan_buffer_t** buffer)
+{
+    if (!lidar || !buffer) return SL_RESULT_INVALID_DATA;
+    *buffer = NULL;
+
+    ScanBufferHolder* holder = new ScanBufferHolder();
+    sl_result ans = lidar->driver->acquireScan(holder->lease, timeout_ms);
+    if (SL_IS_FAIL(ans)) {
+        delete holder;
+        return ans;
+    }
+    return exportScanBuffer(lidar, holder, buffer);
+}
+
+sl_result sl_lidar_acquire_next_scan(sl_lidar_t* lidar, uint64_t after_sequence, uint32_t timeout_ms, sl_lidar_scan_buffer_t** buffer)
+{
+    if (!lidar || !buffer) return SL_RESULT_INVALID_DATA;
+    *buffer = NULL;
+
+    ScanBufferHolder* holder = new ScanBufferHolder();
+    sl_result ans = lidar->driver->acquireNextScan(after_sequence, holder->lease, timeout_ms);
+    if (SL_IS_FAIL(ans)) {
+        delete holder;
+        return ans;
+    }
+    return exportScanBuffer(lidar, holder, buffer);
+}
+
+sl_result sl_lidar_grab_scan(sl_lidar_t* lidar, sl_lidar_response_measurement_node_hq_t* nodes, size_t* count, uint64_t* timestamp_us, uint32_t timeout_ms)
+{
+    if (!lidar || !nodes || !count) return SL_RESULT_INVALID_DATA;
+
+    sl_u64 timestamp = 0;
+    sl_result ans = lidar->driver->grabScanDataHqWithTimeStamp(nodes, *count, timestamp, timeout_ms);
+    if (timestamp_us) *timestamp_us = timestamp;
+    return ans;
+}
+
+sl_result sl_lidar_get_runtime_stats(sl_lidar_t* lidar, sl_lidar_runtime_stats_t* stats, size_t size)
+{
+    if (!lidar || !stats) return SL_RESULT_INVALID_DATA;
+
+    LidarRuntimeStats source;
+    sl_result ans = lidar->driver->getRuntimeStats(source);
+    if (SL_IS_FAIL(ans)) return ans;
+
+    sl_lidar_runtime_stats_t out;
+    memset(&out, 0, sizeof(out));
+    out.rx_bytes = source.rxBytes;
+    out.rx_overflow_bytes = source.rxOverflowBytes;
+    out.rx_overflow_count = source.rxOverflowCount;
+    out.checksum_error_count = source.checksumErrorCount;
+    out.packet_count = source.packetCount;
+    out.sample_packet_count = source.samplePacketCount;
+    out.decoding_error_count = source.decodingErrorCount;
+    out.dropped_scan_count = source.droppedScanCount;
+    out.node_count = source.nodeCount;
+    out.scan_count = source.scanCount;
+    out.truncated_scan_node_count = source.truncatedScanNodeCount;
+    out.dropped_sample_node_count = source.droppedSampleNodeCount;
+    out.sample_period_us = source.samplePeriod_uS;
+    out.sample_clock_drift_ppm = source.sampleClockDrift_ppm;
+    out.sample_clock_resync_count = source.sampleClockResyncCount;
+    out.channel_error_count = source.channelErrorCount;
+    out.reconnect_count = source.reconnectCount;
+    out.reconnect_failure_count = source.reconnectFailureCount;
+    out.last_recovery_time_us = source.lastRecoveryTime_uS;
+    out.total_downtime_us = source.totalDowntime_uS;
+    out.filtered_node_count = source.filteredNodeCount;
+
+    copyOut(out, stats, size);
+    return SL_RESULT_OK;
+}
+
+sl_result sl_lidar_get_memory_footprint(sl_lidar_t* lidar, sl_lidar_memory_footprint_t* footprint, size_t size)
+{
+    if (!lidar || !footprint) return SL_RESULT_INVALID_DATA;
+
+    LidarMemoryFootprint source;
+    sl_result ans = lidar->driver->getMemoryFootprint(source);
+    if (SL_IS_FAIL(ans)) return ans;
+
+    sl_lidar_memory_footprint_t out;
+    memset(&out, 0, sizeof(out));
+    out.arena_bytes = source.arenaBytes;
+    out.rx_queue_bytes = source.rxQueueBytes;
+    out.scan_cache_bytes = source.scanCacheBytes;
+    out.scan_slot_count = source.scanSlotCount;
+    out.scan_node_capacity = source.scanNodeCapacity;
+    out.interval_sample_queue_bytes = source.intervalSampleQueueBytes;
+    out.slice_buffer_bytes = source.sliceBufferBytes;
+    out.total_bytes = source.totalBytes;
+
+    copyOut(out, footprint, size);
+    return SL_RESULT_OK;
+}
+
+}
@@ -0,0 +1,470 @@
+/*
+ *  Slamtec LIDAR SDK
+ *
+ *  Copyright (c) 2014 - 2023 Shanghai Slamtec Co., Ltd.
+ *  http://www.slamtec.com
+ *
+ */
+ /*
+  * Redistribution and use in source and binary forms, with or without
+  * modification, are permitted provided that the following conditions are met:
+  *
+  * 1. Redistributions of source code must retain the above copyright notice,
+  *    this list of conditions and the following disclaimer.
+  *
+  * 2. Redistributions in binary form must reproduce the above copyright notice,
+  *    this list of conditions and the following disclaimer in the documentation
+  *    and/or other materials provided with the distribution.
+  *
+  * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+  * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+  * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+  * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+  * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+  * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+  * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+  * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+  * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+  * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+  * EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+  *
+  */
+
+#include "sl_lidar_deskew.h"
+#include "sl_angle_lut.h"
+#include <math.h>
+#include <algorithm>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define SL_DESKEW_SSE2
+#include <emmintrin.h>
+#endif
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+// compiled with the target attribute and selected at runtime
+#define SL_DESKEW_AVX2
+#include <immintrin.h>
+#endif
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#define SL_DESKEW_NEON
+#include <arm_neon.h>
+#endif
+
+namespace sl {
+
+    enum {
+        // a reader is only lapped by the producer if it is preempted for a long time, give up after a few attempts
+        POSE_COPY_RETRY_COUNT = 4,
+    };
+
+    static const double LUT_STEPS_PER_RADIAN = ANGLE_LUT_SIZE / (2.0 * M_PI);
+
+    LidarPoseRing::LidarPoseRing(size_t capacity)
+        : _mask(0)
+        , _head(0)
+        , _claimed(0)
+    {
+        size_t size = 2;
+        while (size < capacity) size <<= 1;
+        _entries.resize(size);
+        _mask = size - 1;
+    }
+
+    void LidarPoseRing::push(const LidarPose2D& pose)
+    {
+        sl_u64 head = _head.load(std::memory_order_relaxed);
+
+        // tell the readers the oldest entry is being overwritten before touching it
+        _claimed.store(head + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+
+        _entries[head & _mask] = pose;
+        _head.store(head + 1, std::memory_order_release);
+    }
+
+    void LidarPoseRing::clear()
+    {
+        _head.store(0, std::memory_order_release);
+        _claimed.store(0, std::memory_order_release);
+    }
+
+    bool LidarPoseRing::getLatest(LidarPose2D& pose) const
+    {
+        for (int attempt = 0; attempt < POSE_COPY_RETRY_COUNT; ++attempt) {
+            sl_u64 head = _head.load(std::memory_order_acquire);
+            if (!head) return false;
+
+            pose = _entries[(head - 1) & _mask];
+
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (head - 1 + _entries.size() >= _claimed.load(std::memory_order_relaxed)) return true;
+        }
+        return false;
+    }
+
+    bool LidarPoseRing::copySpan(sl_u64 begin_uS, sl_u64 end_uS, std::vector<LidarPose2D>& out) const
+    {
+        for (int attempt = 0; attempt < POSE_COPY_RETRY_COUNT; ++attempt) {
+            out.clear();
+
+            sl_u64 head = _head.load(std::memory_order_acquire);
+            if (!head) return false;
+
+            sl_u64 oldest = head > _entries.size() ? head - _entries.size() : 0;
+            sl_u64 pos = head;
+
+            // walk back from the latest pose, only the oldest of the poses newer than end_uS is kept
+            LidarPose2D newer;
+            bool hasNewer = false;
+            while (pos > oldest) {
+                const LidarPose2D& pose = _entries[--pos & _mask];
+                if (pose.timestamp_uS > end_uS) {
+                    newer = pose;
+                    hasNewer = true;
+                    continue;
+                }
+                if (hasNewer) {
+                    out.push_back(newer);
+                    hasNewer = false;
+                }
+                out.push_back(pose);
+                if (pose.timestamp_uS <= begin_uS) break;
+            }
+            if (hasNewer) out.push_back(newer);
+
+            // pos is the oldest entry read, it must not have been overwritten meanwhile
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (pos + _entries.size() >= _claimed.load(std::memory_order_relaxed)) {
+                std::reverse(out.begin(), out.end());
+                return true;
+            }
+        }
+        out.clear();
+        return false;
+    }
+
+    static inline double wrapAngle(double angle)
+    {
+        return angle - 2.0 * M_PI * floor((angle + M_PI) / (2.0 * M_PI));
+    }
+
+    // make the yaw continuous along the span so that it can be interpolated linearly
+    static void unwrapYaw(std::vector<LidarPose2D>& span)
+    {
+        for (size_t pos = 1; pos < span.size(); ++pos) {
+            span[pos].yaw = (float)(span[pos - 1].yaw + wrapAngle((double)span[pos].yaw - span[pos - 1].yaw));
+        }
+    }
+
+    // interpolated or extrapolated with the nearest pair of poses of the span
+    static void interpolateSpan(const std::vector<LidarPose2D>& span, double timestamp_uS, double& x, double& y, double& yaw)
+    {
+        if (span.size() < 2) {
+            x = span[0].x;
+            y = span[0].y;
+            yaw = span[0].yaw;
+            return;
+        }
+
+        size_t pos = 1;
+        while (pos + 1 < span.size() && span[pos].timestamp_uS <= timestamp_uS) ++pos;
+
+        const LidarPose2D& a = span[pos - 1];
+        const LidarPose2D& b = span[pos];
+        double duration = (double)b.timestamp_uS - (double)a.timestamp_uS;
+        double ratio = duration > 0 ? (timestamp_uS - (double)a.timestamp_uS) / duration : 0;
+
+        x = a.x + (b.x - a.x) * ratio;
+        y = a.y + (b.y - a.y) * ratio;
+        yaw = a.yaw + ((double)b.yaw - a.yaw) * ratio;
+    }
+
+    bool LidarPoseRing::interpolate(sl_u64 timestamp_uS, LidarPose2D& pose) const
+    {
+        std::vector<LidarPose2D> span;
+        if (!copySpan(timestamp_uS, timestamp_uS, span)) return false;
+        if (timestamp_uS < span.front().timestamp_uS || timestamp_uS > span.back().timestamp_uS) return false;
+
+        unwrapYaw(span);
+
+        double x, y, yaw;
+        interpolateSpan(span, (double)timestamp_uS, x, y, yaw);
+        pose = LidarPose2D(timestamp_uS, (float)x, (float)y, (float)wrapAngle(yaw));
+        return true;
+    }
+
+    // the transform of consecutive nodes sampled between two poses, linear in the node index
+    struct DeskewSegment
+    {
+        float x;
+        float y;
+        float angle;    // in angle LUT steps, offset by a full turn so that it stays positive
+        float dx;
+        float dy;
+        float dangle;
+    };
+
+    static inline void advanceSegment(DeskewSegment& segment, size_t count)
+    {
+        segment.x += segment.dx * count;
+        segment.y += segment.dy * count;
+        segment.angle += segment.dangle * count;
+    }
+
+    static void _deskewNodes_scalar(const AngleLUT& lut, const sl_lidar_response_measurement_node_hq_t* nodes, size_t count, const DeskewSegment& segment, float* x, float* y)
+    {
+        for (size_t pos = 0; pos < count; ++pos) {
+            float u = (float)pos;
+            sl_u32 index = ((sl_u32)(nodes[pos].angle_z_q14 + segment.angle + segment.dangle * u + 0.5f)) & (ANGLE_LUT_SIZE - 1);
+            float range = nodes[pos].dist_mm_q2 * 0.25f;
+            x[pos] = segment.x + segment.dx * u + range * lut.cosValue[index];
+            y[pos] = segment.y + segment.dy * u + range * lut.sinValue[index];
+        }
+    }
+
+#ifdef SL_DESKEW_AVX2
+    static bool _isAVX2Supported()
+    {
+        static const bool supported = __builtin_cpu_supports("avx2");
+        return supported;
+    }
+
+    // the following routines return the number of nodes processed, the remaining ones are left to the other paths
+
+    __attribute__((target("avx2")))
+    static size_t _deskewNodes_avx2(const AngleLUT& lut, const sl_lidar_response_measurement_node_hq_t* nodes, size_t count, const DeskewSegment& segment, float* x, float* y)
+    {
+        // byte offset of each node in a block of 8 packed nodes
+        const __m256i nodeOffset = _mm256_setr_epi32(0, 8, 16, 24, 32, 40, 48, 56);
+        const __m256i angleMask = _mm256_set1_epi32(0xFFFF);
+        const __m256i indexMask = _mm256_set1_epi32(ANGLE_LUT_SIZE - 1);
+        const __m256 rangeScale = _mm256_set1_ps(0.25f);
+        const __m256 blockStep = _mm256_set1_ps(8.f);
+
+        const __m256 baseX = _mm256_set1_ps(segment.x), slopeX = _mm256_set1_ps(segment.dx);
+        const __m256 baseY = _mm256_set1_ps(segment.y), slopeY = _mm256_set1_ps(segment.dy);
+        const __m256 baseAngle = _mm256_set1_ps(segment.angle + 0.5f), slopeAngle = _mm256_set1_ps(segment.dangle);
+        __m256 u = _mm256_setr_ps(0, 1, 2, 3, 4, 5, 6, 7);
+
+        size_t pos = 0;
+        for (; pos + 8 <= count; pos += 8) {
+            const char* block = reinterpret_cast<const char*>(nodes + pos);
+
+            __m256i nodeAngle = _mm256_and_si256(_mm256_i32gather_epi32(reinterpret_cast<const int*>(block), nodeOffset, 1), angleMask);
+            __m256i dist = _mm256_i32gather_epi32(reinterpret_cast<const int*>(block + 2), nodeOffset, 1);
+
+            __m256 angle = _mm256_add_ps(_mm256_cvtepi32_ps(nodeAngle), _mm256_add_ps(baseAngle, _mm256_mul_ps(slopeAngle, u)));
+            __m256i index = _mm256_and_si256(_mm256_cvttps_epi32(angle), indexMask);
+
+            __m256 range = _mm256_mul_ps(_mm256_cvtepi32_ps(dist), rangeScale);
+            __m256 cosValue = _mm256_i32gather_ps(lut.cosValue, index, 4);
+            __m256 sinValue = _mm256_i32gather_ps(lut.sinValue, index, 4);
+
+            __m256 offsetX = _mm256_add_ps(baseX, _mm256_mul_ps(slopeX, u));
+            __m256 offsetY = _mm256_add_ps(baseY, _mm256_mul_ps(slopeY, u));
+            _mm256_storeu_ps(x + pos, _mm256_add_ps(offsetX, _mm256_mul_ps(range, cosValue)));
+            _mm256_storeu_ps(y + pos, _mm256_add_ps(offsetY, _mm256_mul_ps(range, sinValue)));
+
+            u = _mm256_add_ps(u, blockStep);
+        }
+        return pos;
+    }
+#endif
+
+#ifdef SL_DESKEW_SSE2
+    // there is no gather instruction in SSE2, only the arithmetic is vectorized
+    static size_t _deskewNodes_sse2(const AngleLUT& lut, const sl_lidar_response_measurement_node_hq_t* nodes, size_t count, const DeskewSegment& segment, float* x, float* y)
+    {
+        const __m128i indexMask = _mm_set1_epi32(ANGLE_LUT_SIZE - 1);
+        const __m128 rangeScale = _mm_set1_ps(0.25f);
+        const __m128 blockStep = _mm_set1_ps(4.f);
+
+        const __m128 baseX = _mm_set1_ps(segment.x), slopeX = _mm_set1_ps(segment.dx);
+        const __m128 baseY = _mm_set1_ps(segment.y), slopeY = _mm_set1_ps(segment.dy);
+        const __m128 baseAngle = _mm_set1_ps(segment.angle + 0.5f), slopeAngle = _mm_set1_ps(segment.dangle);
+        __m128 u = _mm_setr_ps(0, 1, 2, 3);
+
+        size_t pos = 0;
+        for (; pos + 4 <= count; pos += 4) {
+            const sl_lidar_response_measurement_node_hq_t* block = nodes + pos;
+
+            __m128i nodeAngle = _mm_setr_epi32(block[0].angle_z_q14, block[1].angle_z_q14, block[2].angle_z_q14, block[3].angle_z_q14);
+            __m128i dist = _mm_setr_epi32(block[0].dist_mm_q2, block[1].dist_mm_q2, block[2].dist_mm_q2, block[3].dist_mm_q2);
+
+            __m128 angle = _mm_add_ps(_mm_cvtepi32_ps(nodeAngle), _mm_add_ps(baseAngle, _mm_mul_ps(slopeAngle, u)));
+            union { __m128i v; sl_s32 i[4]; } idx;
+            idx.v = _mm_and_si128(_mm_cvttps_epi32(angle), indexMask);
+
+            __m128 range = _mm_mul_ps(_mm_cvtepi32_ps(dist), rangeScale);
+            __m128 cosValue = _mm_setr_ps(lut.cosValue[idx.i[0]], lut.cosValue[idx.i[1]], lut.cosValue[idx.i[2]], lut.cosValue[idx.i[3]]);
+            __m128 sinValue = _mm_setr_ps(lut.sinValue[idx.i[0]], lut.sinValue[idx.i[1]], lut.sinValue[idx.i[2]], lut.sinValue[idx.i[3]]);
+
+            __m128 offsetX = _mm_add_ps(baseX, _mm_mul_ps(slopeX, u));
+            __m128 offsetY = _mm_add_ps(baseY, _mm_mul_ps(slopeY, u));
+            _mm_storeu_ps(x + pos, _mm_add_ps(offsetX, _mm_mul_ps(range, cosValue)));
+            _mm_storeu_ps(y + pos, _mm_add_ps(offsetY, _mm_mul_ps(range, sinValue)));
+
+            u = _mm_add_ps(u, blockStep);
+        }
+        return pos;
+    }
+#endif
+
+#ifdef SL_DESKEW_NEON
+    static size_t _deskewNodes_neon(const AngleLUT& lut, const sl_lidar_response_measurement_node_hq_t* nodes, size_t count, const DeskewSegment& segment, float* x, float* y)
+    {
+        const float32x4_t baseX = vdupq_n_f32(segment.x), slopeX = vdupq_n_f32(segment.dx);
+        const float32x4_t baseY = vdupq_n_f32(segment.y), slopeY = vdupq_n_f32(segment.dy);
+        const float32x4_t baseAngle = vdupq_n_f32(segment.angle + 0.5f), slopeAngle = vdupq_n_f32(segment.dangle);
+        const float step[4] = { 0, 1, 2, 3 };
+        float32x4_t u = vld1q_f32(step);
+
+        size_t pos = 0;
+        for (; pos + 4 <= count; pos += 4) {
+            // word 0: angle_z_q14 | dist_mm_q2 (low 16bits) << 16
+            // word 1: dist_mm_q2 (high 16bits) | quality << 16 | flag << 24
+            uint32x4x2_t words = vld2q_u32(reinterpret_cast<const uint32_t*>(nodes + pos));
+
+            uint32x4_t dist = vorrq_u32(vshrq_n_u32(words.val[0], 16), vshlq_n_u32(words.val[1], 16));
+            float32x4_t range = vmulq_n_f32(vcvtq_f32_u32(dist), 0.25f);
+
+            float32x4_t nodeAngle = vcvtq_f32_u32(vandq_u32(words.val[0], vdupq_n_u32(0xFFFF)));
+            float32x4_t angle = vaddq_f32(nodeAngle, vaddq_f32(baseAngle, vmulq_f32(slopeAngle, u)));
+
+            uint32_t index[4];
+            vst1q_u32(index, vandq_u32(vcvtq_u32_f32(angle), vdupq_n_u32(ANGLE_LUT_SIZE - 1)));
+
+            float cosValue[4] = { lut.cosValue[index[0]], lut.cosValue[index[1]], lut.cosValue[index[2]], lut.cosValue[index[3]] };
+            float sinValue[4] = { lut.sinValue[index[0]], lut.sinValue[index[1]], lut.sinValue[index[2]], lut.sinValue[index[3]] };
+
+            float32x4_t offsetX = vaddq_f32(baseX, vmulq_f32(slopeX, u));
+            float32x4_t offsetY = vaddq_f32(baseY, vmulq_f32(slopeY, u));
+            vst1q_f32(x + pos, vaddq_f32(offsetX, vmulq_f32(range, vld1q_f32(cosValue))));
+            vst1q_f32(y + pos, vaddq_f32(offsetY, vmulq_f32(range, vld1q_f32(sinValue))));
+
+            u = vaddq_f32(u, vdupq_n_f32(4.f));
+        }
+        return pos;
+    }
+#endif
+
+    static void deskewSegment(const AngleLUT& lut, const sl_lidar_response_measurement_node_hq_t* nodes, size_t count, DeskewSegment segment, float* x, float* y)
+    {
+        size_t pos = 0;
+        size_t processed;
+
+#ifdef SL_DESKEW_AVX2
+        if (_isAVX2Supported()) {
+            processed = _deskewNodes_avx2(lut, nodes, count, segment, x, y);
+            advanceSegment(segment, processed);
+            pos += processed;
+        }
+#endif
+#ifdef SL_DESKEW_SSE2
+        processed = _deskewNodes_sse2(lut, nodes + pos, count - pos, segment, x + pos, y + pos);
+        advanceSegment(segment, processed);
+        pos += processed;
+#endif
+#ifdef SL_DESKEW_NEON
+        processed = _deskewNodes_neon(lut, nodes + pos, count - pos, segment, x + pos, y + pos);
+        advanceSegment(segment, processed);
+        pos += processed;
+#endif
+        (void)processed;
+        _deskewNodes_scalar(lut, nodes + pos, count - pos, segment, x + pos, y + pos);
+    }
+
+    LidarScanDeskewer::LidarScanDeskewer(const LidarPoseRing& poses, const LidarDeskewOptions& options)
+        : _poses(poses)
+        , _options(options)
+    {
+    }
+
+    sl_result LidarScanDeskewer::deskew(const sl_lidar_response_measurement_node_hq_t* nodes, size_t count, sl_u64 firstTimestamp_uS, sl_u64 lastTimestamp_uS,
+        float* x, float* y, sl_u64 referenceTimestamp_uS, LidarPose2D* referencePose)
+    {
+        if (!count) return SL_RESULT_OK;
+        if (!nodes || !x || !y || lastTimestamp_uS < firstTimestamp_uS) return SL_RESULT_INVALID_DATA;
+
+        if (!referenceTimestamp_uS) referenceTimestamp_uS = lastTimestamp_uS;
+        sl_u64 begin_uS = std::min(firstTimestamp_uS, referenceTimestamp_uS);
+        sl_u64 end_uS = std::max(lastTimestamp_uS, referenceTimestamp_uS);
+
+        if (!_poses.copySpan(begin_uS, end_uS, _span)) return SL_RESULT_OPERATION_TIMEOUT;
+        if (end_uS > _span.back().timestamp_uS + _options.maxExtrapolation_uS) return SL_RESULT_OPERATION_TIMEOUT;
+        if (begin_uS + _options.maxExtrapolation_uS < _span.front().timestamp_uS) return SL_RESULT_OPERATION_FAIL;
+
+        unwrapYaw(_span);
+
+        double refX, refY, refYaw;
+        interpolateSpan(_span, (double)referenceTimestamp_uS, refX, refY, refYaw);
+        if (referencePose) {
+            *referencePose = LidarPose2D(referenceTimestamp_uS, (float)refX, (float)refY, (float)wrapAngle(refYaw));
+        }
+
+        // maps the LIDAR frame at the time of every pose into the reference base frame
+        double refCos = cos(refYaw), refSin = sin(refYaw);
+        _transforms.resize(_span.size());
+        for (size_t pos = 0; pos < _span.size(); ++pos) {
+            const LidarPose2D& pose = _span[pos];
+            double dx = pose.x - refX;
+            double dy = pose.y - refY;
+            double rotation = pose.yaw - refYaw;
+            double rotationCos = cos(rotation), rotationSin = sin(rotation);
+
+            Transform& transform = _transforms[pos];
+            transform.timestamp_uS = (double)pose.timestamp_uS;
+            transform.x = refCos * dx + refSin * dy + rotationCos * _options.mountX - rotationSin * _options.mountY;
+            transform.y = -refSin * dx + refCos * dy + rotationSin * _options.mountX + rotationCos * _options.mountY;
+            transform.angle = rotation + _options.mountYaw;
+        }
+        if (_transforms.size() < 2) {
+            // a single pose, the vehicle is assumed to be static
+            Transform transform = _transforms[0];
+            transform.timestamp_uS += 1;
+            _transforms.push_back(transform);
+        }
+
+        const AngleLUT& lut = getAngleLUT();
+        double nodePeriod_uS = count > 1 ? ((double)lastTimestamp_uS - (double)firstTimestamp_uS) / (count - 1) : 0;
+        size_t nodeBegin = 0;
+
+        // the first and the last pair of poses are extended to the nodes outside of the poses
+        for (size_t pos = 1; pos < _transforms.size() && nodeBegin < count; ++pos) {
+            const Transform& a = _transforms[pos - 1];
+            const Transform& b = _transforms[pos];
+
+            size_t nodeEnd = count;
+            if (pos + 1 < _transforms.size()) {
+                double offset = b.timestamp_uS - (double)firstTimestamp_uS;
+                if (nodePeriod_uS > 0) {
+                    nodeEnd = offset > 0 ? (size_t)std::min<double>(ceil(offset / nodePeriod_uS), (double)count) : 0;
+                }
+                else if (offset <= 0) {
+                    nodeEnd = 0;
+                }
+                if (nodeEnd <= nodeBegin) continue;
+            }
+
+            // poses sharing a timestamp are not interpolated
+            double duration = b.timestamp_uS - a.timestamp_uS;
+            double ratio = duration > 0 ? ((double)firstTimestamp_uS + nodeBegin * nodePeriod_uS - a.timestamp_uS) / duration : 0;
+            double slope = duration > 0 ? nodePeriod_uS / duration : 0;
+            double angle = (a.angle + (b.angle - a.angle) * ratio) * LUT_STEPS_PER_RADIAN;
+
+            DeskewSegment segment;
+            segment.x = (float)(a.x + (b.x - a.x) * ratio);
+            segment.y = (float)(a.y + (b.y - a.y) * ratio);
+            segment.angle = (float)(angle - ANGLE_LUT_SIZE * floor(angle / ANGLE_LUT_SIZE) + ANGLE_LUT_SIZE);
+            segment.dx = (float)((b.x - a.x) * slope);
+            segment.dy = (float)((b.y - a.y) * slope);
+            segment.dangle = (float)((b.angle - a.angle) * slope * LUT_STEPS_PER_RADIAN);
+
+            deskewSegment(lut, nodes + nodeBegin, nodeEnd - nodeBegin, segment, x + nodeBegin, y + nodeBegin);
+            nodeBegin = nodeEnd;
+        }
+        return SL_RESULT_OK;
+    }
+
+}
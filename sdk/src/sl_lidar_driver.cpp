@@ -41,15 +41,23 @@
 #include "hal/waiter.h"
 #include "hal/byteorder.h"
 #include "sl_lidar_driver.h"
+#include "sl_lidar_shm.h"
+#include "sl_lidar_safety.h"
 #include "sl_crc.h" 
 #include <algorithm>
 #include <memory>
 #include <atomic>
 #include <deque>
+#include <math.h>
 
 #include "dataunpacker/dataunpacker.h"
+#include "dataunpacker/dataunpacker_specialized.h"
 #include "sl_async_transceiver.h"
 #include "sl_lidarprotocol_codec.h"
+#include "sl_thread_config.h"
+#include "sl_trace.h"
+#include "sl_node_buffer.h"
+#include "sl_scan_data_holder.h"
 
 
 
@@ -119,14 +127,77 @@ namespace sl {
         return node.dist_mm_q2;
     }
    
+    // integer sort key, orders the nodes exactly as getAngle() does
+    static inline sl_u16 getAngleKey(const sl_lidar_response_measurement_node_t& node)
+    {
+        return node.angle_q6_checkbit >> SL_LIDAR_RESP_MEASUREMENT_ANGLE_SHIFT;
+    }
+
+    static inline sl_u16 getAngleKey(const sl_lidar_response_measurement_node_hq_t& node)
+    {
+        return node.angle_z_q14;
+    }
+
+    // linear time ordering by angle:
+    // a scan is usually already in order except for the 360->0 wrap point, so a single rotation is enough,
+    // otherwise fall back to a LSD radix sort on the 16bit angle key.
+    // The caller keeps the scratch of the sort across the calls, it only grows for a scan larger than any before
     template <class TNode>
-    static bool angleLessThan(const TNode& a, const TNode& b)
+    static void sortByAngle_(TNode * nodebuffer, size_t count, std::vector<TNode>& scratch)
     {
-        return getAngle(a) < getAngle(b);
+        if (count < 2) return;
+
+        size_t wrapPos = 0;
+        size_t pos;
+        for (pos = 1; pos < count; ++pos) {
+            if (getAngleKey(nodebuffer[pos]) < getAngleKey(nodebuffer[pos - 1])) {
+                if (wrapPos) break; // more than one descent
+                wrapPos = pos;
+            }
+        }
+
+        if (pos == count) {
+            if (!wrapPos) return; // already sorted
+
+            if (getAngleKey(nodebuffer[count - 1]) < getAngleKey(nodebuffer[0])) {
+                std::rotate(nodebuffer, nodebuffer + wrapPos, nodebuffer + count);
+                return;
+            }
+        }
+
+        if (scratch.size() < count) scratch.resize(count);
+        size_t histogram[2][256];
+        memset(histogram, 0, sizeof(histogram));
+
+        for (pos = 0; pos < count; ++pos) {
+            sl_u16 key = getAngleKey(nodebuffer[pos]);
+            ++histogram[0][key & 0xFF];
+            ++histogram[1][key >> 8];
+        }
+
+        TNode* src = nodebuffer;
+        TNode* dest = &scratch[0];
+        for (int pass = 0; pass < 2; ++pass) {
+            size_t offset = 0;
+            for (int bucket = 0; bucket < 256; ++bucket) {
+                size_t bucketSize = histogram[pass][bucket];
+                histogram[pass][bucket] = offset;
+                offset += bucketSize;
+            }
+
+            int shift = pass * 8;
+            for (pos = 0; pos < count; ++pos) {
+                sl_u8 bucket = (sl_u8)(getAngleKey(src[pos]) >> shift);
+                dest[histogram[pass][bucket]++] = src[pos];
+            }
+            std::swap(src, dest);
+        }
+        // after an even number of passes, the result is back in nodebuffer
+        assert(src == nodebuffer);
     }
 
     template < class TNode >
-    static sl_result ascendScanData_(TNode * nodebuffer, size_t count)
+    static sl_result ascendScanData_(TNode * nodebuffer, size_t count, std::vector<TNode>& scratch)
     {
         float inc_origin_angle = 360.f / count;
         size_t i = 0;
@@ -178,7 +249,7 @@ namespace sl {
         }
 
         // Reorder the scan according to the angle value
-        std::sort(nodebuffer, nodebuffer + count, &angleLessThan<TNode>);
+        sortByAngle_(nodebuffer, count, scratch);
 
         return SL_RESULT_OK;
     }
@@ -189,23 +260,93 @@ namespace sl {
     public:
         RawSampleNodeHolder(size_t maxcount = 8192)
             : _max_count(maxcount)
+            , _enabled(false)
+            , _nodes(NULL)
+            , _ownsStorage(true)
+            , _head(0)
+            , _count(0)
+            , _dropped_node_count(0)
         {
            
         }
+
+        // the queue costs a lock and a copy per node, it is only filled once somebody asks for it
+        void enable()
+        {
+            if (_enabled.load(std::memory_order_relaxed)) return;
+
+            rp::hal::AutoLocker l(_locker);
+            if (!_nodes) _allocRing_locked();
+            _enabled.store(true, std::memory_order_release);
+        }
+
+        // change the capacity of the queue, the nodes queued so far are dropped
+        // the queue is kept in storage, the holder allocates its own one (once enabled) when it is NULL
+        void configure(size_t maxcount, T* storage = NULL)
+        {
+            rp::hal::AutoLocker l(_locker);
+            _data_waiter.set(false);
+            _head = 0;
+            _count = 0;
+            if (!storage && _ownsStorage && maxcount == _max_count) return;
+            _max_count = maxcount;
+
+            std::vector<T>().swap(_ring);
+            _nodes = storage;
+            _ownsStorage = !storage;
+            if (!_nodes && _enabled.load(std::memory_order_relaxed)) _allocRing_locked();
+        }
+
+        size_t getStorageBytes() {
+            rp::hal::AutoLocker l(_locker);
+            return _nodes ? _max_count * sizeof(T) : 0;
+        }
+
+        bool ownsStorage() const {
+            return _ownsStorage;
+        }
+
+        bool isEnabled() const {
+            return _enabled.load(std::memory_order_relaxed);
+        }
+
         void clear()
         {
             rp::hal::AutoLocker l(_locker);
             _data_waiter.set(false);
-            _data_queue.clear();
+            _head = 0;
+            _count = 0;
         }
 
         void pushNode(_u64 timestamp_uS, const T* node)
         {
+            pushNodes(&timestamp_uS, node, 1);
+        }
+
+        void pushNodes(const _u64* timestamps_uS, const T* nodes, size_t count)
+        {
+            if (!_enabled.load(std::memory_order_acquire)) return;
+
             rp::hal::AutoLocker l(_locker);
-            _data_queue.push_back(*node);
-            if (_data_queue.size() > _max_count) {
-                _data_queue.pop_front();
+            if (count > _max_count) {
+                // only the newest ones fit
+                _dropped_node_count += count - _max_count;
+                nodes += count - _max_count;
+                count = _max_count;
             }
+
+            size_t overflow = _count + count > _max_count ? _count + count - _max_count : 0;
+            if (overflow) {
+                _head = (_head + overflow) % _max_count;
+                _count -= overflow;
+                _dropped_node_count += overflow;
+            }
+
+            size_t tail = (_head + _count) % _max_count;
+            size_t firstPart = std::min(count, _max_count - tail);
+            std::copy(nodes, nodes + firstPart, _nodes + tail);
+            std::copy(nodes + firstPart, nodes + count, _nodes);
+            _count += count;
             _data_waiter.set();
         }
 
@@ -215,167 +356,323 @@ namespace sl {
             {
                 rp::hal::AutoLocker l(_locker);
 
-                size_t copiedCount = 0;
-
-                while (maxcount--) {
-                    node[copiedCount++] = _data_queue.front();
-                    _data_queue.pop_front();
+                size_t copiedCount = std::min(maxcount, _count);
+                size_t firstPart = std::min(copiedCount, _max_count - _head);
+                std::copy(_nodes + _head, _nodes + _head + firstPart, node);
+                if (copiedCount > firstPart) {
+                    std::copy(_nodes, _nodes + (copiedCount - firstPart), node + firstPart);
                 }
 
+                _head = (_head + copiedCount) % _max_count;
+                _count -= copiedCount;
+
+                // the rest does not have to wait for new data
+                if (_count) _data_waiter.set();
                 return copiedCount;
             }
             return 0;
         }
+
+        // the oldest nodes discarded because the queue was full
+        _u64 getDroppedNodeCount() const {
+            return _dropped_node_count;
+        }
+
     protected:
+        void _allocRing_locked()
+        {
+            _ring.resize(_max_count);
+            _nodes = &_ring[0];
+            _ownsStorage = true;
+        }
+
         size_t          _max_count;
         rp::hal::Locker _locker;
         rp::hal::Event  _data_waiter;
-        std::deque<T>   _data_queue;
+        std::atomic<bool> _enabled;
+        std::vector<T>  _ring;
+        // either _ring or a storage owned by somebody else
+        T*              _nodes;
+        bool            _ownsStorage;
+        size_t          _head;
+        size_t          _count;
+        std::atomic<_u64> _dropped_node_count;
         
     };
 
-    template<typename T>
-    class ScanDataHolder
+    // cuts the node stream into the slices of every revolution, see LidarSliceConfig
+    class ScanSliceAssembler
     {
     public:
-        ScanDataHolder(size_t maxcount = 8192) 
-            : _scan_node_buffer_size(maxcount)
-            , _scan_node_available_id(-1)
-            , _new_scan_ready(false)
+        enum {
+            HALF_TURN_Q14 = 180 * 16384 / 90,
+        };
+
+        ScanSliceAssembler(size_t maxcount = 8192)
+            : _max_slice_size(0)
+            , _slice_width_q14(0)
+            , _requested_node_limit(0)
+            , _slice_node_limit(0)
+            , _in_revolution(false)
+            , _revolution(0)
+            , _slice_sequence(0)
+            , _slice_index(0)
+            , _slice_bin(0)
+            , _before_zero(false)
+            , _start_timestamp_uS(0)
+            , _end_timestamp_uS(0)
         {
-            _scanbuffer[0].reserve(_scan_node_buffer_size);
-            _scanbuffer[1].reserve(_scan_node_buffer_size);
+            setStorage(maxcount, NULL);
+        }
 
-            memset(_scan_begin_timestamp_uS, 0, sizeof(_scan_begin_timestamp_uS));
+        void configure(const LidarSliceConfig& config)
+        {
+            _slice_width_q14 = (config.sliceAngle_deg > 0) ? (_u32)(config.sliceAngle_deg * 16384.f / 90.f) : 0;
+            if (config.sliceAngle_deg > 0 && !_slice_width_q14) _slice_width_q14 = 1;
+            _requested_node_limit = config.maxSliceNodes;
+            _updateNodeLimit();
+            reset();
         }
 
-        size_t getMaxCacheCount() const {
-            return _scan_node_buffer_size;
+        // the slice being assembled is kept in storage, the assembler allocates its own one when it is NULL
+        void setStorage(size_t maxcount, sl_lidar_response_measurement_node_hq_t* storage)
+        {
+            if (storage) {
+                std::vector<sl_lidar_response_measurement_node_hq_t>().swap(_owned_storage);
+            }
+            else {
+                if (_owned_storage.size() != maxcount) std::vector<sl_lidar_response_measurement_node_hq_t>(maxcount).swap(_owned_storage);
+                storage = _owned_storage.data();
+            }
+            _max_slice_size = maxcount;
+            _nodes.attach(storage, maxcount);
+            _updateNodeLimit();
+            reset();
         }
 
+        size_t getStorageBytes() const {
+            return _max_slice_size * sizeof(sl_lidar_response_measurement_node_hq_t);
+        }
 
-        void reset() {
-            rp::hal::AutoLocker l(_locker);
-            _scan_node_available_id = -1;
-            _new_scan_ready = false;
-            _scanbuffer[0].clear();
-            _scanbuffer[1].clear();
-            _data_waiter.set(false);
-            memset(_scan_begin_timestamp_uS, 0, sizeof(_scan_begin_timestamp_uS));
+        bool ownsStorage() const {
+            return !_owned_storage.empty();
         }
 
-        bool checkNewScanSignalAndReset()
+        // drop the current revolution, the slicing restarts from the next SYNCBIT node
+        void reset()
         {
-            return _new_scan_ready.exchange(false);
+            _nodes.clear();
+            _in_revolution = false;
         }
 
-        void pushScanNodeData(_u64 currentSampleTsUs, const T* hqNode)
+        template <class TFunc>
+        void pushNodes(const _u64* timestamps_uS, const sl_lidar_response_measurement_node_hq_t* nodes, size_t count, const TFunc& publish)
         {
-            rp::hal::AutoLocker l(_locker);
-
-            int  operationBufID = _getOperationBufferID_locked();
-            auto operationalBuf = &_scanbuffer[operationBufID];
-            
-            if (hqNode->flag & RPLIDAR_RESP_HQ_FLAG_SYNCBIT) {
-                if (operationalBuf->size()) {
-                    operationBufID = _finishCurrentScanAndSwap_locked();
-                    operationalBuf = &_scanbuffer[operationBufID];
-
-                    // publish the available scan
-                    _new_scan_ready = true;
-                    _data_waiter.set();
-
+            for (size_t pos = 0; pos < count; ++pos) {
+                const sl_lidar_response_measurement_node_hq_t& node = nodes[pos];
+                _u32 bin = _slice_width_q14 ? (node.angle_z_q14 / _slice_width_q14) : 0;
+                bool beforeZero = node.angle_z_q14 >= HALF_TURN_Q14;
+
+                if (node.flag & RPLIDAR_RESP_HQ_FLAG_SYNCBIT) {
+                    if (_nodes.size()) _publishSlice(true, publish);
+                    _in_revolution = true;
+                    ++_revolution;
+                    _slice_index = 0;
+                    // the revolution may start slightly before 0 degree
+                    _before_zero = beforeZero;
+                    _slice_bin = _before_zero ? 0 : bin;
                 }
-                
-                assert(operationalBuf->size() == 0);
-
-                //store the timestamp info
-                _scan_begin_timestamp_uS[operationBufID] = currentSampleTsUs;
-            }
-            else {
-                if (operationalBuf->size() == 0) {
-                    //discard the data, do not form partial scan
-                    return;
+                else if (!_in_revolution) {
+                    // do not form a partial revolution
+                    continue;
+                }
+                else {
+                    // the nodes until 0 degree belong to the first slice
+                    if (_before_zero && !beforeZero) _before_zero = false;
+                    // the angle may jitter backwards across a boundary, such nodes stay in the current slice
+                    bool nextBin = !_before_zero && bin > _slice_bin;
+
+                    if (nextBin || _nodes.size() >= _slice_node_limit) {
+                        _publishSlice(false, publish);
+                        ++_slice_index;
+                        if (nextBin) _slice_bin = bin;
+                    }
                 }
-            }
 
-            if (operationalBuf->size() >= _scan_node_buffer_size) {
-                //replace the last entry if buffer is full
-                operationalBuf->at(operationalBuf->size() - 1) = *hqNode;
-            }
-            else {
-                operationalBuf->push_back(*hqNode);
+                if (_nodes.empty()) _start_timestamp_uS = timestamps_uS[pos];
+                _end_timestamp_uS = timestamps_uS[pos];
+                _nodes.push_back(node);
             }
-
         }
 
-        void rewindCurrentScanData() {
-            rp::hal::AutoLocker l(_locker);
-            _getOperationalBuffer_locked().clear();
+    protected:
+        void _updateNodeLimit()
+        {
+            _slice_node_limit = (_requested_node_limit && _requested_node_limit < _max_slice_size) ? _requested_node_limit : _max_slice_size;
         }
 
-        std::vector<T>* waitAndLockAvailableScan(_u32 timeout, _u64 * out_timestamp_uS = nullptr)
+        template <class TFunc>
+        void _publishSlice(bool lastOfRevolution, const TFunc& publish)
         {
-            if (_data_waiter.wait(timeout) == rp::hal::Event::EVENT_OK)
-            {
-                _locker.lock();
-                assert(_scan_node_available_id >= 0);
-                _new_scan_ready = false;
-                if (out_timestamp_uS) {
-                    *out_timestamp_uS = _scan_begin_timestamp_uS[_scan_node_available_id];
-                }
-                return &_scanbuffer[_scan_node_available_id];
-            }
-            else {
-                return nullptr;
-            }
-        }
+            LidarScanSlice slice;
+            slice.nodes = &_nodes[0];
+            slice.count = _nodes.size();
+            slice.timestamp_uS = _start_timestamp_uS;
+            slice.endTimestamp_uS = _end_timestamp_uS;
+            slice.sequence = ++_slice_sequence;
+            slice.revolution = _revolution;
+            slice.index = _slice_index;
+            slice.lastOfRevolution = lastOfRevolution;
+            slice.startAngle_deg = _nodes.front().angle_z_q14 * 90.f / 16384.f;
+            slice.endAngle_deg = _nodes.back().angle_z_q14 * 90.f / 16384.f;
+            publish(slice);
+            _nodes.clear();
+        }
+
+        size_t _max_slice_size;
+        _u32   _slice_width_q14;
+        // LidarSliceConfig::maxSliceNodes
+        size_t _requested_node_limit;
+        size_t _slice_node_limit;
+        bool   _in_revolution;
+        _u64   _revolution;
+        _u64   _slice_sequence;
+        _u32   _slice_index;
+        _u32   _slice_bin;
+        bool   _before_zero;
+        _u64   _start_timestamp_uS;
+        _u64   _end_timestamp_uS;
+        internal::NodeBuffer<sl_lidar_response_measurement_node_hq_t> _nodes;
+        std::vector<sl_lidar_response_measurement_node_hq_t> _owned_storage;
+    };
 
-        void unlockScan(std::vector<T>* scan) {
-            if (scan) {
-                _locker.unlock();
-            }
-        }
+    // picks the decoded nodes kept by a LidarAcquisitionFilter
+    class AcquisitionNodeFilter
+    {
+    public:
+        enum {
+            // angle_z_q14 wraps around at a full turn
+            FULL_TURN_Q14 = 360 * 16384 / 90,
+        };
 
-    protected:
-        int _finishCurrentScanAndSwap_locked() {
-            _scan_node_available_id = _getOperationBufferID_locked();
-            int newOperationalID  =  1 - _scan_node_available_id;
+        AcquisitionNodeFilter()
+            : _range_count(0)
+            , _decimation(1)
+            , _min_quality(0)
+            , _active(false)
+            , _phase(0)
+            , _pending_sync(false)
+        {
+        }
 
-            _scanbuffer[newOperationalID].clear();
-            return newOperationalID;
+        sl_result configure(const LidarAcquisitionFilter& filter)
+        {
+            if (filter.rangeCount > LidarAcquisitionFilter::MAX_RANGE_COUNT || filter.decimation < 1) return SL_RESULT_INVALID_DATA;
+            for (size_t pos = 0; pos < filter.rangeCount; ++pos) {
+                if (!(fabs(filter.startAngle[pos]) < 1e6f) || !(fabs(filter.endAngle[pos]) < 1e6f)) return SL_RESULT_INVALID_DATA;
+            }
+
+            for (size_t pos = 0; pos < filter.rangeCount; ++pos) {
+                // the width is taken clockwise from the start, a range ending where it starts is a full turn
+                float width = fmodf(filter.endAngle[pos] - filter.startAngle[pos], 360.f);
+                if (width <= 0) width += 360.f;
+                float start = fmodf(filter.startAngle[pos], 360.f);
+                if (start < 0) start += 360.f;
+
+                _range_start_q14[pos] = (_u32)(start * 16384.f / 90.f) % FULL_TURN_Q14;
+                _range_width_q14[pos] = std::min<_u32>((_u32)(width * 16384.f / 90.f + 0.5f), FULL_TURN_Q14);
+            }
+            _range_count = filter.rangeCount;
+            _decimation = filter.decimation;
+            _min_quality = filter.minQuality;
+            _active = _range_count || _decimation > 1 || _min_quality;
+            reset();
+            return SL_RESULT_OK;
         }
 
-        int _getOperationBufferID_locked() {
-            if (_scan_node_available_id < 0) return 0;
-            return 1 - _scan_node_available_id;
+        bool isActive() const {
+            return _active;
         }
 
-        std::vector<T>& _getOperationalBuffer_locked()
+        // the largest share of the nodes the angular ranges and the decimation keep
+        float getKeptRatio() const
         {
-            return _scanbuffer[_getOperationBufferID_locked()];
+            _u32 covered_q14 = _range_count ? 0 : FULL_TURN_Q14;
+            for (size_t pos = 0; pos < _range_count; ++pos) covered_q14 += _range_width_q14[pos];
+            return std::min((float)covered_q14 / FULL_TURN_Q14, 1.f) / _decimation;
         }
 
+        // forget the revolution in progress
+        void reset()
+        {
+            _phase = 0;
+            _pending_sync = false;
+        }
 
-        rp::hal::Locker _locker;
-        rp::hal::Event  _data_waiter;
+        // copy the nodes kept to keptNodes (and their timestamps to keptTimestamps_uS), returns how many they are
+        size_t apply(const _u64* timestamps_uS, const sl_lidar_response_measurement_node_hq_t* nodes, size_t count
+            , _u64* keptTimestamps_uS, sl_lidar_response_measurement_node_hq_t* keptNodes)
+        {
+            size_t kept = 0;
+            for (size_t pos = 0; pos < count; ++pos) {
+                const sl_lidar_response_measurement_node_hq_t& node = nodes[pos];
+                if (node.flag & RPLIDAR_RESP_HQ_FLAG_SYNCBIT) {
+                    _phase = 0;
+                    _pending_sync = true;
+                }
 
-        
+                if (node.quality < _min_quality || !_inRanges(node.angle_z_q14)) continue;
+                bool keep = (_phase == 0);
+                if (++_phase >= _decimation) _phase = 0;
+                if (!keep) continue;
 
-        _u64   _scan_begin_timestamp_uS[2];
-        size_t _scan_node_buffer_size;
-        int    _scan_node_available_id;
-        std::atomic<bool>   _new_scan_ready;
+                keptNodes[kept] = node;
+                keptNodes[kept].flag = (node.flag & ~RPLIDAR_RESP_HQ_FLAG_SYNCBIT) | (_pending_sync ? RPLIDAR_RESP_HQ_FLAG_SYNCBIT : 0);
+                keptTimestamps_uS[kept] = timestamps_uS[pos];
+                _pending_sync = false;
+                ++kept;
+            }
+            return kept;
+        }
 
-        std::vector<T> _scanbuffer[2];
+    protected:
+        bool _inRanges(_u32 angle_q14) const
+        {
+            if (!_range_count) return true;
+            for (size_t pos = 0; pos < _range_count; ++pos) {
+                if (((angle_q14 + FULL_TURN_Q14 - _range_start_q14[pos]) % FULL_TURN_Q14) < _range_width_q14[pos]) return true;
+            }
+            return false;
+        }
+
+        _u32   _range_start_q14[LidarAcquisitionFilter::MAX_RANGE_COUNT];
+        _u32   _range_width_q14[LidarAcquisitionFilter::MAX_RANGE_COUNT];
+        size_t _range_count;
+        _u32   _decimation;
+        _u8    _min_quality;
+        bool   _active;
+        // position of the next node in the decimation, and whether the SYNCBIT goes to the next node kept
+        _u32   _phase;
+        bool   _pending_sync;
     };
 
     class SlamtecLidarDriver : 
-        public ILidarDriver, internal::IProtocolMessageListener, internal::LIDARSampleDataListener
+        public ILidarDriver, internal::IProtocolMessageListener, public internal::LIDARSampleDataListener
     {
     public:
         enum {
             MAX_SCANNODE_CACHE_COUNT = 8192,
+            // the nodes of a packet go through the acquisition filter in batches of up to this many
+            ACQUISITION_BATCH_SIZE = 256,
+            // the smallest scan a memory budget has to hold, a node per degree
+            MIN_BUDGET_SCANNODE_COUNT = 360,
+            MIN_BUDGET_RX_RING_SIZE = 4 * 1024,
+        };
+
+        enum {
+            // the line is considered quiet after the device stopped streaming for this long,
+            // it also covers the 1ms the device needs to handle the stop command
+            STOP_RX_QUIET_TIME_US = 5000,
         };
 
         enum {
@@ -396,16 +693,64 @@ namespace sl {
 
     public:
         SlamtecLidarDriver()
-            : _isConnected(false)
+            : _specializedDecoding(false)
+            , _deviceClockModel(true)
+            , _isStreaming(false)
+            , _async_locker(true)
+            , _asyncThreadRunning(false)
+            , _asyncExiting(false)
+            , _isConnected(false)
+            , _channel(NULL)
+            , _reconnectThreadRunning(false)
+            , _reconnectExiting(false)
+            , _recovering(false)
+            , _negotiatedBaudRate(0)
+            , _motorSpeedToRestore(-1)
+            , _outageStart_uS(0)
+            , _totalDowntime_uS(0)
+            , _lastRecoveryTime_uS(0)
+            , _channelErrorCount(0)
+            , _reconnectCount(0)
+            , _reconnectFailureCount(0)
             , _isSupportingMotorCtrl(MotorCtrlSupportNone)
             , _op_locker(true)
             , _scanHolder(MAX_SCANNODE_CACHE_COUNT)
             , _rawSampleNodeHolder(MAX_SCANNODE_CACHE_COUNT)
+            , _arenaNodeMark(0)
+            , _intervalQueueInArena(false)
             , _waiting_packet_type(0)
+            , _hasCachedDevInfo(false)
+            , _hasCapabilityProfile(false)
+            , _scanStartTimeout(10)
+            , _stopTimeout(100)
+            , _motorCommandGuardTime(10)
+            , _commandGuardDeadline_uS(0)
+            , _firstSampleEvt(false, false)
+            , _waitingFirstSample(false)
+            , _callback_locker(true)
+            , _sliceAssembler(MAX_SCANNODE_CACHE_COUNT)
+            , _scanPublisher(NULL)
+            , _safetyMonitor(NULL)
+            , _lineExtractor(NULL)
+            , _hasSafetyMonitor(false)
+            , _hasScanCallback(false)
+            , _hasNodeCallback(false)
+            , _hasSliceCallback(false)
+            , _hasAcquisitionFilter(false)
+            , _latencyTracking(false)
+            , _packetCount(0)
+            , _samplePacketCount(0)
+            , _decodedNodeCount(0)
+            , _filteredNodeCount(0)
+            , _decodingErrorCount(0)
         {
             _protocolHandler = std::make_shared< internal::RPLidarProtocolCodec>();
             _transeiver = std::make_shared< internal::AsyncTransceiver>(*_protocolHandler);
             _dataunpacker.reset(internal::LIDARSampleDataUnpacker::CreateInstance(*this));
+            _activeUnpacker = _dataunpacker.get();
+            for (size_t pos = 0; pos < _countof(_specializedUnpackers); ++pos) {
+                _specializedUnpackers[pos] = NULL;
+            }
 
             _protocolHandler->setMessageListener(this);
 
@@ -415,8 +760,14 @@ namespace sl {
 
         virtual ~SlamtecLidarDriver()
         {
+            _stopAsyncCommands();
+            _stopReconnect();
             disconnect();
+            stopRawCapture();
             _protocolHandler->setMessageListener(nullptr);
+            for (size_t pos = 0; pos < _countof(_specializedUnpackers); ++pos) {
+                delete _specializedUnpackers[pos].load();
+            }
         }
 
 
@@ -471,22 +822,60 @@ namespace sl {
         }
 
         sl_result connect(IChannel* channel)
+        {
+            return connect(channel, LidarConnectOptions());
+        }
+
+        sl_result connect(IChannel* channel, const LidarConnectOptions& options)
         {
             rp::hal::AutoLocker l(_op_locker);
             if (!channel) return SL_RESULT_OPERATION_FAIL;
             if (isConnected()) return SL_RESULT_ALREADY_DONE;
 
+            internal::IOReactor* reactor = NULL;
+            if (options.reactor) {
+                reactor = dynamic_cast<internal::IOReactor*>(options.reactor);
+                if (!reactor) return SL_RESULT_INVALID_DATA;
+            }
+
+            // the lost scans will not be released any more
+            size_t historyDepth = options.scanHistoryDepth ? options.scanHistoryDepth : (size_t)(internal_scan_holder_t::DEFAULT_SCAN_SLOT_COUNT - 1);
+            sl_result bufferAns = _setupBuffers(options, historyDepth + 1);
+            if (IS_FAIL(bufferAns)) return bufferAns;
+
             _rawSampleNodeHolder.clear();
+            if (options.queueIntervalSamples) _rawSampleNodeHolder.enable();
+
+            _scanStartTimeout = options.scanStartTimeout;
+            _stopTimeout = options.stopTimeout;
+            _motorCommandGuardTime = options.motorCommandGuardTime;
+            _commandGuardDeadline_uS = 0;
 
             sl_result ans;
             
-       
+            // also used when the channel is reopened, e.g. by negotiateSerialBaudRate()
+            _transeiver->setReactor(reactor);
+            _transeiver->setThreadConfig(options.rxThreadConfig, options.decoderThreadConfig);
+            _transeiver->setInlineDecoding(options.inlineDecoding);
+            _specializedDecoding = options.specializedDecoding;
+            _deviceClockModel = options.deviceClockModel;
+            _forEachUnpacker([&](internal::LIDARSampleDataUnpacker* unpacker) {
+                unpacker->setClockModelEnabled(options.deviceClockModel);
+            });
             ans = (sl_result)_transeiver->openChannelAndBind(channel);
 
+            _hasCapabilityProfile = false;
+            _hasCachedDevInfo = false;
             if (IS_OK(ans)) {
+                _channel = channel;
+                _reconnectPolicy = options.reconnectPolicy;
+                _scanToResume = ScanResumeState();
+                _negotiatedBaudRate = 0;
+                _motorSpeedToRestore = -1;
+                if (_reconnectPolicy.enabled) _startReconnect();
                 _isConnected = true;
                 // the first dev info local cache will be taken here
-                checkMotorCtrlSupport(_isSupportingMotorCtrl, 500);
+                checkMotorCtrlSupport(_isSupportingMotorCtrl, options.probeTimeout);
             }
             
             return ans;
@@ -500,6 +889,10 @@ namespace sl {
 
                 _transeiver->unbindAndClose();
                 _isConnected = false;
+                _channel = NULL;
+                _endOutage();
+                // a pending reconnection gives up
+                _reconnectCancelEvt.set();
             }
         }
 
@@ -521,6 +914,11 @@ namespace sl {
 
             if (!isConnected()) return SL_RESULT_OPERATION_NOT_SUPPORT;
 
+            if (_hasCapabilityProfile) {
+                outModes.insert(outModes.end(), _capabilityProfile.scanModes.begin(), _capabilityProfile.scanModes.end());
+                return SL_RESULT_OK;
+            }
+
             Result<nullptr_t> ans = SL_RESULT_OK;
             bool confProtocolSupported = false;
             ans = checkSupportConfigCommands(confProtocolSupported, timeoutInMs);
@@ -558,6 +956,11 @@ namespace sl {
             rp::hal::AutoLocker l(_op_locker);
             if (!isConnected()) return SL_RESULT_OPERATION_NOT_SUPPORT;
 
+            if (_hasCapabilityProfile) {
+                outMode = _capabilityProfile.typicalScanMode;
+                return SL_RESULT_OK;
+            }
+
             Result<nullptr_t> ans = SL_RESULT_OK;
             std::vector<sl_u8> answer;
             bool lidarSupportConfigCmds = false;
@@ -622,7 +1025,10 @@ namespace sl {
 
             Result<nullptr_t> ans = SL_RESULT_OK;
 
-            if (ifSupportLidarConf) {
+            if (ifSupportLidarConf && _lookupCachedScanMode(SL_LIDAR_CONF_SCAN_COMMAND_STD, outUsedScanMode)) {
+                // known from the capability profile
+            }
+            else if (ifSupportLidarConf) {
 
                 outUsedScanMode.id = SL_LIDAR_CONF_SCAN_COMMAND_STD;
                 ans = getLidarSampleDuration(outUsedScanMode.us_per_sample, outUsedScanMode.id);
@@ -649,14 +1055,21 @@ namespace sl {
 
 
             _updateTimingDesc(_cached_DevInfo, outUsedScanMode.us_per_sample);
+            _applyScanModeCapacity(outUsedScanMode.us_per_sample);
 
             startMotor();
 
-            _scanHolder.reset();
-            _dataunpacker->enable();
+            _resetScanHolder();
+            _resetSlices();
+            _resetAcquisitionFilter();
+            _enableDataGrabbing(outUsedScanMode.ans_type);
 
+            _armFirstSampleWait();
             ans = _sendCommandWithoutResponse(force ? SL_LIDAR_CMD_FORCE_SCAN : SL_LIDAR_CMD_SCAN, nullptr, 0, true);
-            if (ans) delay(10); // wait rplidar to handle it
+            if (ans) {
+                _waitFirstSample(); // wait rplidar to handle it
+                _scanToResume = ScanResumeState(false, force, SL_LIDAR_CONF_SCAN_COMMAND_STD, 0);
+            }
             return ans;
         }
 
@@ -700,7 +1113,10 @@ namespace sl {
 
             
             outUsedScanMode->id = scanMode;
-            if (ifSupportLidarConf) {
+            if (ifSupportLidarConf && _lookupCachedScanMode(scanMode, *outUsedScanMode)) {
+                // known from the capability profile
+            }
+            else if (ifSupportLidarConf) {
                 ans = getLidarSampleDuration(outUsedScanMode->us_per_sample, outUsedScanMode->id);
                 if (!ans) return SL_RESULT_INVALID_DATA;
 
@@ -737,10 +1153,13 @@ namespace sl {
             }
             
             _updateTimingDesc(_cached_DevInfo, outUsedScanMode->us_per_sample);
+            _applyScanModeCapacity(outUsedScanMode->us_per_sample);
             startMotor();
 
-            _scanHolder.reset();
-            _dataunpacker->enable();
+            _resetScanHolder();
+            _resetSlices();
+            _resetAcquisitionFilter();
+            _enableDataGrabbing(outUsedScanMode->ans_type);
 
             sl_lidar_payload_express_scan_t scanReq;
             memset(&scanReq, 0, sizeof(scanReq));
@@ -754,8 +1173,12 @@ namespace sl {
 
             scanReq.working_flags = options;
 
+            _armFirstSampleWait();
             ans = _sendCommandWithoutResponse(SL_LIDAR_CMD_EXPRESS_SCAN, &scanReq, sizeof(scanReq), true);
-            if (ans) delay(10); // wait rplidar to handle it
+            if (ans) {
+                _waitFirstSample(); // wait rplidar to handle it
+                _scanToResume = ScanResumeState(true, force, scanMode, options);
+            }
             return ans;
 
         }
@@ -768,14 +1191,15 @@ namespace sl {
             u_result ans = SL_RESULT_OK;
             ans = _sendCommandWithoutResponse(SL_LIDAR_CMD_STOP);
             _disableDataGrabbing();
+            _scanToResume.valid = false;
 
             if (IS_FAIL(ans)) return ans;
             
-
-            delay(100);
+            // the samples already on the way are dropped before the next command is sent
+            _transeiver->waitRxIdle(STOP_RX_QUIET_TIME_US, _stopTimeout);
 
             if(_isSupportingMotorCtrl == MotorCtrlSupportPwm)
-                setMotorSpeed(0);
+                _setMotorSpeed(0);
   
             return SL_RESULT_OK;
         }
@@ -787,18 +1211,277 @@ namespace sl {
             if (!nodebuffer)
                 return SL_RESULT_INVALID_DATA;
 
-            auto availBuffer = _scanHolder.waitAndLockAvailableScan(timeout, &timestamp_uS);
+            int slotID;
+            _u64 arrival_uS = 0;
+            auto availBuffer = _scanHolder.acquireAvailableScan(timeout, slotID, &timestamp_uS, &arrival_uS);
             if (!availBuffer) return SL_RESULT_OPERATION_TIMEOUT;
 
+            // the scan is leased, the decoder thread can keep pushing data during the copy
             count = std::min<size_t>(count, availBuffer->size());
 
             std::copy(availBuffer->begin(), availBuffer->begin() + count, nodebuffer);
 
-            _scanHolder.unlockScan(availBuffer);
+            _scanHolder.releaseScan(slotID);
+            _recordScanGrabLatency(arrival_uS);
 
             return RESULT_OK;
         }
 
+        sl_result acquireScan(LidarScanLease& lease, sl_u32 timeout = DEFAULT_TIMEOUT)
+        {
+            int slotID;
+            _u64 timestamp_uS = 0;
+            _u64 arrival_uS = 0;
+            _u64 sequence = 0;
+            auto availBuffer = _scanHolder.acquireAvailableScan(timeout, slotID, &timestamp_uS, &arrival_uS, &sequence, &lease.endTimestamp_uS);
+            if (!availBuffer) return SL_RESULT_OPERATION_TIMEOUT;
+
+            lease.nodes = availBuffer->data();
+            lease.count = availBuffer->size();
+            lease.timestamp_uS = timestamp_uS;
+            lease.sequence = sequence;
+            lease.handle = slotID;
+            _recordScanGrabLatency(arrival_uS);
+            return SL_RESULT_OK;
+        }
+
+        sl_result acquireNextScan(sl_u64 afterSequence, LidarScanLease& lease, sl_u32 timeout = DEFAULT_TIMEOUT)
+        {
+            int slotID;
+            _u64 timestamp_uS = 0;
+            _u64 arrival_uS = 0;
+            _u64 sequence = 0;
+            auto availBuffer = _scanHolder.acquireScanAfter(afterSequence, timeout, slotID, &timestamp_uS, &arrival_uS, &sequence, &lease.endTimestamp_uS);
+            if (!availBuffer) return SL_RESULT_OPERATION_TIMEOUT;
+
+            lease.nodes = availBuffer->data();
+            lease.count = availBuffer->size();
+            lease.timestamp_uS = timestamp_uS;
+            lease.sequence = sequence;
+            lease.handle = slotID;
+            _recordScanGrabLatency(arrival_uS);
+            return SL_RESULT_OK;
+        }
+
+        sl_result acquireRecentScans(LidarScanLease* leases, size_t& count)
+        {
+            if (!leases && count) return SL_RESULT_INVALID_DATA;
+
+            // the leases are filled right from the history ring
+            count = _scanHolder.acquireRecentScans(count, [leases](size_t pos, int slotID, const internal_scan_holder_t::scan_buffer_t& scan,
+                    _u64 timestamp_uS, _u64 endTimestamp_uS, _u64 sequence) {
+                LidarScanLease& lease = leases[pos];
+                lease.nodes = scan.data();
+                lease.count = scan.size();
+                lease.timestamp_uS = timestamp_uS;
+                lease.endTimestamp_uS = endTimestamp_uS;
+                lease.sequence = sequence;
+                lease.handle = slotID;
+            });
+            return SL_RESULT_OK;
+        }
+
+        sl_result grabScanFrame(LidarScanFrame& frame, sl_u32 timeout = DEFAULT_TIMEOUT)
+        {
+            int slotID;
+            _u64 timestamp_uS = 0;
+            _u64 arrival_uS = 0;
+            auto availBuffer = _scanHolder.acquireAvailableScan(timeout, slotID, &timestamp_uS, &arrival_uS);
+            if (!availBuffer) return SL_RESULT_OPERATION_TIMEOUT;
+
+            size_t count = availBuffer->size();
+            frame.assign(availBuffer->data(), count, timestamp_uS);
+
+            _scanHolder.releaseScan(slotID);
+            _recordScanGrabLatency(arrival_uS);
+            return frame.size() == count ? SL_RESULT_OK : SL_RESULT_INSUFFICIENT_MEMORY;
+        }
+
+        sl_result grabBinnedScan(LidarBinnedScan& scan, sl_u32 timeout = DEFAULT_TIMEOUT)
+        {
+            int slotID;
+            _u64 timestamp_uS = 0;
+            _u64 arrival_uS = 0;
+            auto availBuffer = _scanHolder.acquireAvailableScan(timeout, slotID, &timestamp_uS, &arrival_uS);
+            if (!availBuffer) return SL_RESULT_OPERATION_TIMEOUT;
+
+            scan.assign(availBuffer->data(), availBuffer->size(), timestamp_uS);
+
+            _scanHolder.releaseScan(slotID);
+            _recordScanGrabLatency(arrival_uS);
+            return SL_RESULT_OK;
+        }
+
+        void releaseScan(LidarScanLease& lease)
+        {
+            if (lease.handle < 0) return;
+
+            _scanHolder.releaseScan(lease.handle);
+            lease = LidarScanLease();
+        }
+
+        void setScanCallback(const LidarScanCallback& callback)
+        {
+            rp::hal::AutoLocker l(_callback_locker);
+            _scanCallback = callback;
+            _updateHasScanCallback_locked();
+        }
+
+        void setScanPublisher(ILidarScanPublisher* publisher)
+        {
+            rp::hal::AutoLocker l(_callback_locker);
+            _scanPublisher = publisher;
+            _updateHasScanCallback_locked();
+        }
+
+        void setLineCallback(LidarLineExtractor* extractor, const LidarLineCallback& callback)
+        {
+            rp::hal::AutoLocker l(_callback_locker);
+            _lineExtractor = callback ? extractor : NULL;
+            _lineCallback = _lineExtractor ? callback : LidarLineCallback();
+            _updateHasScanCallback_locked();
+        }
+
+        void setSafetyMonitor(ILidarSafetyMonitor* monitor)
+        {
+            rp::hal::AutoLocker l(_callback_locker);
+            _safetyMonitor = monitor;
+            _hasSafetyMonitor = (monitor != NULL);
+        }
+
+        sl_result setAcquisitionFilter(const LidarAcquisitionFilter& filter)
+        {
+            rp::hal::AutoLocker l(_callback_locker);
+            sl_result ans = _acquisitionFilter.configure(filter);
+            if (IS_FAIL(ans)) return ans;
+            _hasAcquisitionFilter = _acquisitionFilter.isActive();
+            return SL_RESULT_OK;
+        }
+
+        void setNodeCallback(const LidarNodeCallback& callback)
+        {
+            rp::hal::AutoLocker l(_callback_locker);
+            _nodeCallback = callback;
+            _hasNodeCallback = (bool)_nodeCallback;
+        }
+
+        void setSliceCallback(const LidarSliceConfig& config, const LidarSliceCallback& callback)
+        {
+            rp::hal::AutoLocker l(_callback_locker);
+            _sliceCallback = callback;
+            _sliceAssembler.configure(config);
+            _hasSliceCallback = (bool)_sliceCallback;
+        }
+
+        sl_u32 getChecksumErrorCount()
+        {
+            sl_u32 count = 0;
+            _forEachUnpacker([&](internal::LIDARSampleDataUnpacker* unpacker) {
+                count += unpacker->getChecksumErrorCount();
+            });
+            return count;
+        }
+
+        sl_result startRawCapture(const char* path)
+        {
+            stopRawCapture();
+            if (!path) return SL_RESULT_INVALID_DATA;
+
+            std::shared_ptr<internal::RawCaptureWriter> capture = std::make_shared<internal::RawCaptureWriter>();
+            sl_result ans = (sl_result)capture->open(path);
+            if (IS_FAIL(ans)) return ans;
+
+            rp::hal::AutoLocker l(_capture_locker);
+            _rawCapture = capture;
+            _transeiver->setCaptureTap(_rawCapture.get());
+            return SL_RESULT_OK;
+        }
+
+        void stopRawCapture()
+        {
+            rp::hal::AutoLocker l(_capture_locker);
+            if (!_rawCapture) return;
+
+            _transeiver->setCaptureTap(NULL);
+            _rawCapture->close();
+            _rawCapture.reset();
+        }
+
+        sl_result getMemoryFootprint(LidarMemoryFootprint& footprint)
+        {
+            rp::hal::AutoLocker l(_op_locker);
+            footprint.arenaBytes = _arena.size();
+            footprint.rxQueueBytes = _transeiver->getRxRingCapacity();
+            footprint.scanCacheBytes = _scanHolder.getStorageBytes();
+            footprint.scanSlotCount = _scanHolder.getSlotCount();
+            footprint.scanNodeCapacity = _scanHolder.getMaxCacheCount();
+            footprint.intervalSampleQueueBytes = _rawSampleNodeHolder.getStorageBytes();
+            {
+                rp::hal::AutoLocker cl(_callback_locker);
+                footprint.sliceBufferBytes = _sliceAssembler.getStorageBytes();
+            }
+
+            if (_arena.size()) {
+                // only the interval sample queue may be out of the arena, when it is used without being asked for at connect
+                footprint.totalBytes = footprint.arenaBytes + (_rawSampleNodeHolder.ownsStorage() ? footprint.intervalSampleQueueBytes : 0);
+            }
+            else {
+                footprint.totalBytes = footprint.rxQueueBytes + footprint.scanCacheBytes + footprint.intervalSampleQueueBytes + footprint.sliceBufferBytes;
+            }
+            return SL_RESULT_OK;
+        }
+
+        sl_result getRuntimeStats(LidarRuntimeStats& stats)
+        {
+            stats.rxBytes = _transeiver->getRxBytes();
+            stats.rxOverflowBytes = _transeiver->getRxOverflowBytes();
+            stats.rxOverflowCount = _transeiver->getRxOverflowCount();
+            stats.packetCount = _packetCount;
+            stats.samplePacketCount = _samplePacketCount;
+            stats.checksumErrorCount = getChecksumErrorCount();
+            stats.decodingErrorCount = _decodingErrorCount;
+            stats.nodeCount = _decodedNodeCount;
+            stats.scanCount = _scanHolder.getPublishedScanCount();
+            stats.droppedScanCount = _scanHolder.getDroppedScanCount();
+            stats.truncatedScanNodeCount = _scanHolder.getTruncatedNodeCount();
+            stats.droppedSampleNodeCount = _rawSampleNodeHolder.getDroppedNodeCount();
+            stats.filteredNodeCount = _filteredNodeCount;
+            _activeUnpacker.load()->getClockModelStatus(stats.samplePeriod_uS, stats.sampleClockDrift_ppm, stats.sampleClockResyncCount);
+            stats.channelErrorCount = _channelErrorCount;
+            stats.reconnectCount = _reconnectCount;
+            stats.reconnectFailureCount = _reconnectFailureCount;
+            stats.lastRecoveryTime_uS = _lastRecoveryTime_uS;
+            stats.totalDowntime_uS = _totalDowntime_uS;
+            _u64 outageStart_uS = _outageStart_uS;
+            if (outageStart_uS) stats.totalDowntime_uS += getus() - outageStart_uS;
+            return SL_RESULT_OK;
+        }
+
+        void setLatencyTrackingEnabled(bool enabled)
+        {
+            _latencyTracking = enabled;
+            _transeiver->setLatencyTracker(enabled ? &_latency : NULL);
+        }
+
+        sl_result getLatencyStats(LidarLatencyStats& stats)
+        {
+            _latency.rxQueue.getSummary(stats.rxQueue);
+            _latency.nodeDecode.getSummary(stats.nodeDecode);
+            _latency.scanSwap.getSummary(stats.scanSwap);
+            _latency.scanGrab.getSummary(stats.scanGrab);
+
+            stats.rxQueueDepth = _transeiver->getRxPendingSize();
+            stats.rxQueueDepthMax = _latency.getRxQueueDepthMax();
+            stats.rxQueueCapacity = _transeiver->getRxRingCapacity();
+            stats.leasedScanCount = _scanHolder.getLeasedScanCount();
+            return SL_RESULT_OK;
+        }
+
+        void resetLatencyStats()
+        {
+            _latency.reset();
+        }
+
         sl_result grabScanDataHq(sl_lidar_response_measurement_node_hq_t* nodebuffer, size_t& count, sl_u32 timeout = DEFAULT_TIMEOUT)
         {
             _u64 localTS;
@@ -827,9 +1510,79 @@ namespace sl {
 #endif
 
             _cached_DevInfo = info;
+            _hasCachedDevInfo = true;
             return (sl_result)ans;
         }
 
+        sl_result getCachedDeviceInfo(sl_lidar_response_device_info_t& info)
+        {
+            rp::hal::AutoLocker l(_op_locker);
+            if (!isConnected() || !_hasCachedDevInfo) return SL_RESULT_OPERATION_NOT_SUPPORT;
+
+            info = _cached_DevInfo;
+            return SL_RESULT_OK;
+        }
+
+        sl_result sendCommandAsync(sl_u8 cmd, sl_u8 answerType, const void* payload, size_t payloadSize, const LidarCommandCallback& callback, sl_u32 timeout = DEFAULT_TIMEOUT)
+        {
+            if (!callback || payloadSize > 0xFF || (payloadSize && !payload)) return SL_RESULT_INVALID_DATA;
+            if (!isConnected()) return SL_RESULT_OPERATION_NOT_SUPPORT;
+
+            AsyncCommandRequest request;
+            request.cmd = cmd;
+            request.answerType = answerType;
+            if (payloadSize) request.payload.assign((const _u8*)payload, (const _u8*)payload + payloadSize);
+            request.callback = callback;
+            request.deadline_uS = getus() + (_u64)timeout * 1000;
+
+            rp::hal::AutoLocker l(_async_locker);
+            if (_asyncExiting) return SL_RESULT_OPERATION_STOP;
+            if (!_asyncThreadRunning) {
+                _asyncThread = rp::hal::Thread::create_member<SlamtecLidarDriver, &SlamtecLidarDriver::_proc_asyncCommands>(this);
+                if (!_asyncThread.getHandle()) return SL_RESULT_OPERATION_FAIL;
+                _asyncThreadRunning = true;
+            }
+            _asyncRequests.push_back(std::move(request));
+            _asyncEvt.set();
+            return SL_RESULT_OK;
+        }
+
+        sl_result getHealthAsync(const LidarHealthCallback& callback, sl_u32 timeout = DEFAULT_TIMEOUT)
+        {
+            if (!callback) return SL_RESULT_INVALID_DATA;
+            return sendCommandAsync(SL_LIDAR_CMD_GET_DEVICE_HEALTH, SL_LIDAR_ANS_TYPE_DEVHEALTH, NULL, 0,
+                [callback](sl_result ans, const sl_u8* payload, size_t size) {
+                    sl_lidar_response_device_health_t health;
+                    memset(&health, 0, sizeof(health));
+                    if (SL_IS_OK(ans) && size < sizeof(health)) ans = SL_RESULT_INVALID_DATA;
+                    if (SL_IS_OK(ans)) {
+                        memcpy(&health, payload, sizeof(health));
+#ifdef _CPU_ENDIAN_BIG
+                        health.error_code = le16_to_cpu(health.error_code);
+#endif
+                    }
+                    callback(ans, health);
+                }, timeout);
+        }
+
+        sl_result getDeviceInfoAsync(const LidarDeviceInfoCallback& callback, sl_u32 timeout = DEFAULT_TIMEOUT)
+        {
+            if (!callback) return SL_RESULT_INVALID_DATA;
+            return sendCommandAsync(SL_LIDAR_CMD_GET_DEVICE_INFO, SL_LIDAR_ANS_TYPE_DEVINFO, NULL, 0,
+                [callback](sl_result ans, const sl_u8* payload, size_t size) {
+                    sl_lidar_response_device_info_t info;
+                    memset(&info, 0, sizeof(info));
+                    if (SL_IS_OK(ans) && size < sizeof(info)) ans = SL_RESULT_INVALID_DATA;
+                    if (SL_IS_OK(ans)) {
+                        memcpy(&info, payload, sizeof(info));
+#ifdef _CPU_ENDIAN_BIG
+                        info.firmware_version = le16_to_cpu(info.firmware_version);
+#endif
+                    }
+                    callback(ans, info);
+                }, timeout);
+        }
+
         sl_result checkMotorCtrlSupport(MotorCtrlSupport & support, sl_u32 timeout = DEFAULT_TIMEOUT)
         {
             rp::hal::AutoLocker l(_op_locker);
@@ -841,7 +1594,7 @@ namespace sl {
 
             {
                 sl_lidar_response_device_info_t devInfo;
-                ans = getDeviceInfo(devInfo, 500);
+                ans = getDeviceInfo(devInfo, timeout);
                 if (!ans) return ans;
                 sl_u8 majorId = devInfo.model >> 4;
                 if (majorId >= BUILTIN_MOTORCTL_MINUM_MAJOR_ID) {
@@ -873,8 +1626,63 @@ namespace sl {
                 }
 
             }
-            return SL_RESULT_OK;
+            return SL_RESULT_OK;
+
+        }
+
+        sl_result getCapabilityProfile(LidarCapabilityProfile& profile, sl_u32 timeout = DEFAULT_TIMEOUT)
+        {
+            rp::hal::AutoLocker l(_op_locker);
+            if (!isConnected()) return SL_RESULT_OPERATION_NOT_SUPPORT;
+
+            if (_hasCapabilityProfile) {
+                profile = _capabilityProfile;
+                return SL_RESULT_OK;
+            }
+
+            _disableDataGrabbing();
+
+            LidarCapabilityProfile discovered;
+            sl_lidar_response_device_info_t devInfo;
+            Result<nullptr_t> ans = getDeviceInfo(devInfo, timeout);
+            if (!ans) return ans;
+
+            memcpy(discovered.serialnum, devInfo.serialnum, sizeof(discovered.serialnum));
+            discovered.model = devInfo.model;
+            discovered.firmware_version = devInfo.firmware_version;
+            discovered.hardware_version = devInfo.hardware_version;
+            discovered.motorCtrlSupport = _isSupportingMotorCtrl;
+
+            ans = checkSupportConfigCommands(discovered.supportConfigCommands, timeout);
+            if (!ans) return ans;
+            ans = getTypicalScanMode(discovered.typicalScanMode, timeout);
+            if (!ans) return ans;
+            ans = getAllSupportedScanModes(discovered.scanModes, timeout);
+            if (!ans) return ans;
+
+            _capabilityProfile = discovered;
+            _hasCapabilityProfile = true;
+            profile = discovered;
+            return SL_RESULT_OK;
+        }
+
+        sl_result setCapabilityProfile(const LidarCapabilityProfile& profile)
+        {
+            rp::hal::AutoLocker l(_op_locker);
+            if (!isConnected()) return SL_RESULT_OPERATION_NOT_SUPPORT;
+
+            // checked against the device info taken by connect
+            if (memcmp(profile.serialnum, _cached_DevInfo.serialnum, sizeof(profile.serialnum))
+                || profile.model != _cached_DevInfo.model
+                || profile.firmware_version != _cached_DevInfo.firmware_version
+                || profile.hardware_version != _cached_DevInfo.hardware_version) {
+                return SL_RESULT_INVALID_DATA;
+            }
 
+            _capabilityProfile = profile;
+            _hasCapabilityProfile = true;
+            _isSupportingMotorCtrl = profile.motorCtrlSupport;
+            return SL_RESULT_OK;
         }
 
         sl_result getFrequency(const LidarScanMode& scanMode, const sl_lidar_response_measurement_node_hq_t* nodes, size_t count, float& frequency)
@@ -956,11 +1764,18 @@ namespace sl {
 
         sl_result ascendScanData(sl_lidar_response_measurement_node_hq_t * nodebuffer, size_t count)
         {
-            return ascendScanData_<sl_lidar_response_measurement_node_hq_t>(nodebuffer, count);
+            rp::hal::AutoLocker l(_ascend_locker);
+            return ascendScanData_<sl_lidar_response_measurement_node_hq_t>(nodebuffer, count, _ascendScratch);
         }
 
         sl_result getScanDataWithIntervalHq(sl_lidar_response_measurement_node_hq_t * nodebuffer, size_t & count)
         {
+            if (!_rawSampleNodeHolder.isEnabled()) {
+                // the nodes are queued from now on
+                _rawSampleNodeHolder.enable();
+                count = 0;
+                return SL_RESULT_OK;
+            }
             count = _rawSampleNodeHolder.waitAndFetch(nodebuffer, count, 0);
             return SL_RESULT_OK;
         }
@@ -970,10 +1785,19 @@ namespace sl {
             rp::hal::AutoLocker l(_op_locker);
             if (!isConnected()) return SL_RESULT_OPERATION_NOT_SUPPORT;
 
+            sl_result ans = _setMotorSpeed(speed);
+            // applied again after a reconnection
+            if (SL_IS_OK(ans)) _motorSpeedToRestore = speed;
+            return ans;
+        }
+
+        sl_result _setMotorSpeed(sl_u16 speed)
+        {
 
             Result<nullptr_t> ans = SL_RESULT_OK;
             
-            if(speed == DEFAULT_MOTOR_SPEED){
+            // the DTR line only tells stopped from running, no need to ask the device
+            if(speed == DEFAULT_MOTOR_SPEED && _isSupportingMotorCtrl != MotorCtrlSupportNone){
                 sl_lidar_response_desired_rot_speed_t desired_speed;
                 ans = getDesiredSpeed(desired_speed);
                 if (ans) {
@@ -1006,7 +1830,7 @@ namespace sl {
 
                 ans = _sendCommandWithoutResponse(SL_LIDAR_CMD_SET_MOTOR_PWM, &motor_pwm, sizeof(motor_pwm), true);
                 if (!ans) return ans;
-                delay(10);
+                _setCommandGuard(_motorCommandGuardTime);
                 break;
             case MotorCtrlSupportRpm:
                 sl_lidar_payload_motor_pwm_t motor_rpm;
@@ -1014,7 +1838,7 @@ namespace sl {
 
                 ans = _sendCommandWithoutResponse(SL_LIDAR_CMD_HQ_MOTOR_SPEED_CTRL, &motor_rpm, sizeof(motor_rpm), true);
                 if (!ans) return ans;
-                delay(10);
+                _setCommandGuard(_motorCommandGuardTime);
                 break;
             }
             return SL_RESULT_OK;
@@ -1144,6 +1968,7 @@ namespace sl {
 
 
                     ans = _sendCommandWithoutResponse(SL_LIDAR_CMD_NEW_BAUDRATE_CONFIRM, &confirmation, sizeof(confirmation));
+                    if (IS_OK(ans)) _negotiatedBaudRate = requiredBaudRate;
 
                     return ans;
                 }
@@ -1157,7 +1982,9 @@ namespace sl {
     protected:
         sl_result startMotor()
         {
-            return setMotorSpeed(DEFAULT_MOTOR_SPEED);
+            // a scan start overrides the speed set before
+            _motorSpeedToRestore = -1;
+            return _setMotorSpeed(DEFAULT_MOTOR_SPEED);
         }
 
         u_result getDesiredSpeed(sl_lidar_response_desired_rot_speed_t & motorSpeed, sl_u32 timeoutInMs = DEFAULT_TIMEOUT)
@@ -1175,6 +2002,11 @@ namespace sl {
 
         u_result checkSupportConfigCommands(bool& outSupport, sl_u32 timeoutInMs = DEFAULT_TIMEOUT)
         {
+            if (_hasCapabilityProfile) {
+                outSupport = _capabilityProfile.supportConfigCommands;
+                return RESULT_OK;
+            }
+
             u_result ans;
             rplidar_response_device_info_t devinfo;
             ans = getDeviceInfo(devinfo, timeoutInMs);
@@ -1455,11 +2287,63 @@ namespace sl {
         }
 
     protected:
+
+        template <class TFunc>
+        void _forEachUnpacker(const TFunc& func)
+        {
+            func(_dataunpacker.get());
+            for (size_t pos = 0; pos < _countof(_specializedUnpackers); ++pos) {
+                internal::LIDARSampleDataUnpacker* unpacker = _specializedUnpackers[pos].load(std::memory_order_acquire);
+                if (unpacker) func(unpacker);
+            }
+        }
+
+        // picks the unpacker decoding the samples of the scan about to start.
+        // The specialized ones are created on first use and kept till the driver is released,
+        // so the decoder may still be finishing a packet on the previous one while switching
+        internal::LIDARSampleDataUnpacker* _selectUnpacker(_u8 ansType)
+        {
+            internal::LIDARSampleDataUnpacker* unpacker = _dataunpacker.get();
+
+            if (_specializedDecoding
+                && ansType >= SL_LIDAR_ANS_TYPE_MEASUREMENT
+                && ansType < SL_LIDAR_ANS_TYPE_MEASUREMENT + _countof(_specializedUnpackers)) {
+
+                std::atomic<internal::LIDARSampleDataUnpacker*>& slot = _specializedUnpackers[ansType - SL_LIDAR_ANS_TYPE_MEASUREMENT];
+                internal::LIDARSampleDataUnpacker* specialized = slot.load();
+                if (!specialized) {
+                    specialized = internal::CreateSpecializedDataUnpacker(ansType, *this);
+                    if (specialized) {
+                        specialized->updateUnpackerContext(internal::LIDARSampleDataUnpacker::UNPACKER_CONTEXT_TYPE_LIDAR_TIMING, &_timing_desc, sizeof(_timing_desc));
+                        specialized->setClockModelEnabled(_deviceClockModel);
+                        slot.store(specialized, std::memory_order_release);
+                    }
+                }
+                if (specialized) unpacker = specialized;
+            }
+
+            _activeUnpacker.store(unpacker, std::memory_order_release);
+            return unpacker;
+        }
         
+        void _enableDataGrabbing(_u8 ansType)
+        {
+            _selectUnpacker(ansType)->enable();
+            _isStreaming = true;
+        }
+
         void _disableDataGrabbing()
         {
-            _dataunpacker->disable();
+            _forEachUnpacker([](internal::LIDARSampleDataUnpacker* unpacker) {
+                unpacker->disable();
+            });
             _protocolHandler->exitLoopMode(); // exit loop mode
+
+            if (_isStreaming) {
+                _isStreaming = false;
+                // release the queued commands held by the scan
+                _asyncEvt.set();
+            }
         }
         
 
@@ -1548,7 +2432,9 @@ namespace sl {
 
 
             // notify the data unpacker
-            _dataunpacker->updateUnpackerContext(internal::LIDARSampleDataUnpacker::UNPACKER_CONTEXT_TYPE_LIDAR_TIMING ,&_timing_desc, sizeof(_timing_desc));
+            _forEachUnpacker([this](internal::LIDARSampleDataUnpacker* unpacker) {
+                unpacker->updateUnpackerContext(internal::LIDARSampleDataUnpacker::UNPACKER_CONTEXT_TYPE_LIDAR_TIMING, &_timing_desc, sizeof(_timing_desc));
+            });
             return true;
 
         }
@@ -1602,10 +2488,10 @@ namespace sl {
             if (!noForceStop) {
                 _disableDataGrabbing();
             }
+            _waitCommandGuard();
             _response_waiter.set(false);
 
-            internal::message_autoptr_t message(new internal::ProtocolMessage(cmd, (const _u8*)payload, payloadsize));
-            return _transeiver->sendMessage(message);
+            return _transeiver->sendMessage(cmd, payload, payloadsize);
 
         }
 
@@ -1615,13 +2501,13 @@ namespace sl {
 
             _data_locker.lock();
 
-            internal::message_autoptr_t message(new internal::ProtocolMessage(cmd, (const _u8*)payload, payloadsize));
             _disableDataGrabbing();
             _waiting_packet_type = responseType;
             _response_waiter.set(false);
             _data_locker.unlock();
 
-            ans = _transeiver->sendMessage(message);
+            _waitCommandGuard();
+            ans = _transeiver->sendMessage(cmd, payload, payloadsize);
 
             if (IS_FAIL(ans)) return ans;
 
@@ -1639,29 +2525,456 @@ namespace sl {
                 }
             } while (1);
         }
+
+        struct AsyncCommandRequest
+        {
+            _u8 cmd;
+            _u8 answerType;
+            std::vector<_u8> payload;
+            LidarCommandCallback callback;
+            _u64 deadline_uS;
+        };
+
+        u_result _proc_asyncCommands()
+        {
+            internal::applyThreadConfig(LidarThreadConfig(), "sl_command");
+
+            while (!_asyncExiting) {
+                AsyncCommandRequest request;
+                {
+                    rp::hal::AutoLocker l(_async_locker);
+                    if (!_asyncRequests.empty()) {
+                        request = std::move(_asyncRequests.front());
+                        _asyncRequests.pop_front();
+                    }
+                }
+                if (!request.callback) {
+                    _asyncEvt.wait();
+                    continue;
+                }
+
+                _u64 currentTs = getus();
+                if (currentTs >= request.deadline_uS) {
+                    request.callback(SL_RESULT_OPERATION_TIMEOUT, NULL, 0);
+                    continue;
+                }
+                _u32 remainingTime = (_u32)((request.deadline_uS - currentTs + 999) / 1000);
+
+                const _u8* payload = request.payload.empty() ? NULL : &request.payload[0];
+                sl_result ans;
+                bool held = false;
+                internal::message_autoptr_t ans_frame;
+                {
+                    rp::hal::AutoLocker l(_op_locker);
+                    if (!isConnected()) {
+                        ans = SL_RESULT_OPERATION_NOT_SUPPORT;
+                    } else if (!request.answerType) {
+                        ans = _sendCommandWithoutResponse(request.cmd, payload, request.payload.size(), true);
+                    } else if (_isStreaming) {
+                        held = true;
+                    } else {
+                        ans = _sendCommandWithResponse(request.cmd, request.answerType, ans_frame, remainingTime, payload, request.payload.size());
+                    }
+                }
+
+                if (held) {
+                    {
+                        // keep the order, the later requests wait behind it
+                        rp::hal::AutoLocker l(_async_locker);
+                        _asyncRequests.push_front(std::move(request));
+                    }
+                    _asyncEvt.wait(remainingTime);
+                    continue;
+                }
+
+                if (SL_IS_OK(ans) && ans_frame) {
+                    request.callback(ans, ans_frame->getDataBuf(), ans_frame->getPayloadSize());
+                } else {
+                    request.callback(ans, NULL, 0);
+                }
+            }
+            return RESULT_OK;
+        }
+
+        void _stopAsyncCommands()
+        {
+            bool running;
+            {
+                rp::hal::AutoLocker l(_async_locker);
+                _asyncExiting = true;
+                running = _asyncThreadRunning;
+                _asyncThreadRunning = false;
+            }
+
+            if (running) {
+                _asyncEvt.set();
+                _asyncThread.join();
+            }
+
+            std::deque<AsyncCommandRequest> pending;
+            {
+                rp::hal::AutoLocker l(_async_locker);
+                pending.swap(_asyncRequests);
+            }
+            for (size_t pos = 0; pos < pending.size(); ++pos) {
+                pending[pos].callback(SL_RESULT_OPERATION_STOP, NULL, 0);
+            }
+        }
+
+        // what _proc_reconnect restores once the channel is reopened
+        struct ScanResumeState
+        {
+            bool    valid;
+            bool    express;
+            bool    force;
+            sl_u16  scanMode;
+            sl_u32  options;
+
+            ScanResumeState()
+                : valid(false)
+                , express(false)
+                , force(false)
+                , scanMode(0)
+                , options(0)
+            {
+            }
+
+            ScanResumeState(bool express, bool force, sl_u16 scanMode, sl_u32 options)
+                : valid(true)
+                , express(express)
+                , force(force)
+                , scanMode(scanMode)
+                , options(options)
+            {
+            }
+        };
+
+        // lay the buffers out for a new connection: in the arena with a memory budget, at their default sizes otherwise
+        sl_result _setupBuffers(const LidarConnectOptions& options, size_t slotCount)
+        {
+            _memoryProfile = options.memoryProfile;
+
+            if (!_memoryProfile.budget) {
+                if (!_scanHolder.configure(MAX_SCANNODE_CACHE_COUNT, slotCount)) return SL_RESULT_OPERATION_FAIL;
+                _transeiver->setRxRingStorage(NULL, internal::AsyncTransceiver::DEFAULT_RX_RING_SIZE);
+                _rawSampleNodeHolder.configure(MAX_SCANNODE_CACHE_COUNT);
+                {
+                    rp::hal::AutoLocker l(_callback_locker);
+                    _sliceAssembler.setStorage(MAX_SCANNODE_CACHE_COUNT, NULL);
+                }
+                _intervalQueueInArena = false;
+                _arena.release();
+                return SL_RESULT_OK;
+            }
+
+            // the leased scans may live in the arena about to be replaced
+            if (_scanHolder.getLeasedScanCount()) return SL_RESULT_OPERATION_FAIL;
+
+            size_t budget = _memoryProfile.budget;
+            size_t rxRingSize = MIN_BUDGET_RX_RING_SIZE;
+            while (rxRingSize * 2 <= budget / 4 && rxRingSize * 2 <= internal::AsyncTransceiver::DEFAULT_RX_RING_SIZE) rxRingSize *= 2;
+
+            // every buffer may lose an alignment to the padding
+            size_t nodeBytes = (budget > rxRingSize + 4 * internal::MemoryArena::ALIGNMENT) ? budget - rxRingSize - 4 * internal::MemoryArena::ALIGNMENT : 0;
+            if (_fitScanNodeCapacity(MIN_BUDGET_SCANNODE_COUNT, nodeBytes, slotCount, options.queueIntervalSamples) < MIN_BUDGET_SCANNODE_COUNT) {
+                return SL_RESULT_INSUFFICIENT_MEMORY;
+            }
+
+            if (!_arena.allocate(budget)) return SL_RESULT_INSUFFICIENT_MEMORY;
+            _transeiver->setRxRingStorage((_u8*)_arena.carve(rxRingSize), rxRingSize);
+            _arenaNodeMark = _arena.getMark();
+            _intervalQueueInArena = options.queueIntervalSamples;
+
+            // no scan mode is known yet
+            size_t capacity = _fitScanNodeCapacity(MAX_SCANNODE_CACHE_COUNT, _getArenaNodeBytes(), slotCount, _intervalQueueInArena);
+            if (!_carveNodeBuffers(capacity, slotCount)) return SL_RESULT_OPERATION_FAIL;
+            return SL_RESULT_OK;
+        }
+
+        // the room left for the node buffers after the rx queue, without the padding between them
+        size_t _getArenaNodeBytes()
+        {
+            _arena.rewind(_arenaNodeMark);
+            size_t freeBytes = _arena.getFreeSize();
+            return freeBytes > 3 * internal::MemoryArena::ALIGNMENT ? freeBytes - 3 * internal::MemoryArena::ALIGNMENT : 0;
+        }
+
+        // the largest scan up to maxcount nodes whose buffers fit in freeBytes
+        static size_t _fitScanNodeCapacity(size_t maxcount, size_t freeBytes, size_t slotCount, bool intervalQueue)
+        {
+            // the scan slots, the slice buffer and the interval sample queue
+            size_t bytesPerNode = (slotCount + 1 + (intervalQueue ? 1 : 0)) * sizeof(sl_lidar_response_measurement_node_hq_t);
+            return std::min(maxcount, freeBytes / bytesPerNode);
+        }
+
+        // the layout only depends on the capacity, carving the current one again leaves everything in place
+        // it fails while a scan is leased, the slots cannot move then
+        bool _carveNodeBuffers(size_t capacity, size_t slotCount)
+        {
+            typedef sl_lidar_response_measurement_node_hq_t node_t;
+
+            _arena.rewind(_arenaNodeMark);
+            node_t* scanStorage = (node_t*)_arena.carve(internal_scan_holder_t::getStorageSize(capacity, slotCount));
+            node_t* sliceStorage = (node_t*)_arena.carve(capacity * sizeof(node_t));
+            node_t* intervalStorage = _intervalQueueInArena ? (node_t*)_arena.carve(capacity * sizeof(node_t)) : NULL;
+            assert(scanStorage && sliceStorage && (intervalStorage || !_intervalQueueInArena));
+
+            if (!_scanHolder.configure(capacity, slotCount, scanStorage)) return false;
+            _rawSampleNodeHolder.configure(capacity, intervalStorage);
+            rp::hal::AutoLocker l(_callback_locker);
+            _sliceAssembler.setStorage(capacity, sliceStorage);
+            return true;
+        }
+
+        // with a memory budget, size the scans for the scan mode about to start
+        void _applyScanModeCapacity(float us_per_sample)
+        {
+            if (!_arena.size()) return;
+
+            size_t slotCount = _scanHolder.getSlotCount();
+            size_t capacity = MAX_SCANNODE_CACHE_COUNT;
+            if (us_per_sample > 0 && _memoryProfile.minScanFrequency > 0) {
+                capacity = (size_t)(1000000.f / (us_per_sample * _memoryProfile.minScanFrequency));
+                if (_hasAcquisitionFilter) {
+                    rp::hal::AutoLocker l(_callback_locker);
+                    capacity = (size_t)ceilf(capacity * _acquisitionFilter.getKeptRatio());
+                }
+                // the rotation speed jitters
+                capacity += capacity / 8;
+            }
+            size_t fit = _fitScanNodeCapacity(std::max<size_t>(capacity, MIN_BUDGET_SCANNODE_COUNT), _getArenaNodeBytes(), slotCount, _intervalQueueInArena);
+
+            size_t current = _scanHolder.getMaxCacheCount();
+            if (fit == current) return;
+            // a leased scan keeps the current layout
+            if (!_carveNodeBuffers(fit, slotCount)) _carveNodeBuffers(current, slotCount);
+        }
+
+        void _resetScanHolder()
+        {
+            if (_recovering) {
+                // the scans keep going into the history, only the one cut by the channel error is dropped
+                _scanHolder.rewindCurrentScanData();
+            } else {
+                _scanHolder.reset();
+            }
+        }
+
+        // the outage in progress (if any) is over, its duration is added to the downtime
+        _u64 _endOutage()
+        {
+            _u64 outageStart_uS = _outageStart_uS.exchange(0);
+            if (!outageStart_uS) return 0;
+
+            _u64 duration_uS = getus() - outageStart_uS;
+            _totalDowntime_uS += duration_uS;
+            return duration_uS;
+        }
+
+        void _startReconnect()
+        {
+            if (_reconnectThreadRunning) return;
+            _reconnectThread = rp::hal::Thread::create_member<SlamtecLidarDriver, &SlamtecLidarDriver::_proc_reconnect>(this);
+            _reconnectThreadRunning = (_reconnectThread.getHandle() != 0);
+        }
+
+        void _stopReconnect()
+        {
+            if (!_reconnectThreadRunning) return;
+            _reconnectExiting = true;
+            _reconnectEvt.set();
+            _reconnectCancelEvt.set();
+            _reconnectThread.join();
+            _reconnectThreadRunning = false;
+        }
+
+        // reopen the channel of the driver and restore its state, with _op_locker held
+        sl_result _reopenChannel_locked()
+        {
+            ScanResumeState resume = _scanToResume;
+            int motorSpeed = _motorSpeedToRestore;
+            sl_u32 baudRate = _negotiatedBaudRate;
+
+            sl_result ans = _restoreChannel_locked(resume, motorSpeed, baudRate);
+            if (IS_FAIL(ans)) {
+                // the commands of a failed attempt reset the state, it is restored by the next one
+                _scanToResume = resume;
+                _motorSpeedToRestore = motorSpeed;
+                _negotiatedBaudRate = baudRate;
+            }
+            return ans;
+        }
+
+        sl_result _restoreChannel_locked(const ScanResumeState& resume, int motorSpeed, sl_u32 baudRate)
+        {
+            _disableDataGrabbing();
+            _transeiver->unbindAndClose();
+
+            sl_result ans = (sl_result)_transeiver->openChannelAndBind(_channel);
+            if (IS_FAIL(ans)) {
+                // the next attempt starts from a closed channel, e.g. with a new socket
+                _channel->close();
+                return ans;
+            }
+
+            if (baudRate) {
+                ans = negotiateSerialBaudRate(baudRate, NULL);
+                if (IS_FAIL(ans)) return ans;
+            }
+
+            if (resume.valid) {
+                _recovering = true;
+                if (resume.express) {
+                    ans = startScanExpress(resume.force, resume.scanMode, resume.options);
+                } else {
+                    ans = startScanNormal(resume.force);
+                }
+                _recovering = false;
+                if (IS_FAIL(ans)) return ans;
+            }
+
+            if (motorSpeed >= 0) {
+                ans = setMotorSpeed((sl_u16)motorSpeed);
+                if (IS_FAIL(ans)) return ans;
+            }
+
+            // the channel may have failed again in the meantime
+            if (_transeiver->hasChannelError()) return SL_RESULT_OPERATION_FAIL;
+            return SL_RESULT_OK;
+        }
+
+        u_result _proc_reconnect()
+        {
+            internal::applyThreadConfig(LidarThreadConfig(), "sl_reconnect");
+
+            while (!_reconnectExiting) {
+                _reconnectEvt.wait();
+                if (_reconnectExiting) break;
+
+                _reconnectCancelEvt.set(false);
+                sl_u32 backoff = _reconnectPolicy.initialBackoff;
+                for (sl_u32 attempt = 1; !_reconnectExiting; ++attempt) {
+                    // cut short by disconnect and by the destructor
+                    _reconnectCancelEvt.wait(backoff);
+
+                    rp::hal::AutoLocker l(_op_locker);
+                    // disconnected by the application
+                    if (!_isConnected || _reconnectExiting) break;
+                    if (!_outageStart_uS) {
+                        // connected again by the application, unless the channel failed right after the previous recovery
+                        if (!_transeiver->hasChannelError()) break;
+                        _u64 noOutage = 0;
+                        _outageStart_uS.compare_exchange_strong(noOutage, getus());
+                    }
+
+                    if (IS_OK(_reopenChannel_locked())) {
+                        _lastRecoveryTime_uS = _endOutage();
+                        ++_reconnectCount;
+                        break;
+                    }
+
+                    ++_reconnectFailureCount;
+                    if (_reconnectPolicy.maxAttempts && attempt >= _reconnectPolicy.maxAttempts) {
+                        // give up, the application sees a disconnected driver
+                        _disableDataGrabbing();
+                        _transeiver->unbindAndClose();
+                        _isConnected = false;
+                        _channel = NULL;
+                        _endOutage();
+                        break;
+                    }
+                    backoff = std::min(std::max<sl_u32>(backoff, 1) * 2, std::max(_reconnectPolicy.maxBackoff, _reconnectPolicy.initialBackoff));
+                }
+            }
+            return RESULT_OK;
+        }
         
     public:
 
         virtual void onHQNodeDecoded(_u64 timestamp_uS, const rplidar_response_measurement_node_hq_t* node)
         {
-            _scanHolder.pushScanNodeData(timestamp_uS, node);
+            if (_hasAcquisitionFilter) {
+                onHQNodesDecoded(&timestamp_uS, node, 1);
+                return;
+            }
+
+            _u64 arrival_uS = _recordNodeDecodeLatency();
+            _decodedNodeCount.fetch_add(1, std::memory_order_relaxed);
+            if (_hasSafetyMonitor) _evaluateSafetyZones(&timestamp_uS, node, 1);
+            if (_hasSliceCallback) _pushSliceNodes(&timestamp_uS, node, 1);
+            bool scanPublished = _scanHolder.pushScanNodeData(timestamp_uS, node, arrival_uS);
+            if (scanPublished && arrival_uS) _latency.scanSwap.record(getus() - arrival_uS);
             _rawSampleNodeHolder.pushNode(timestamp_uS, node);
+
+            if (_hasNodeCallback) {
+                rp::hal::AutoLocker l(_callback_locker);
+                if (_nodeCallback) _nodeCallback(*node, timestamp_uS);
+            }
+
+            if (scanPublished && _hasScanCallback) {
+                _publishScanToCallback();
+            }
+        }
+
+        virtual void onHQNodesDecoded(const _u64* timestamps_uS, const rplidar_response_measurement_node_hq_t* nodes, size_t count)
+        {
+            _u64 arrival_uS = _recordNodeDecodeLatency();
+            _decodedNodeCount.fetch_add(count, std::memory_order_relaxed);
+            if (_hasSafetyMonitor) _evaluateSafetyZones(timestamps_uS, nodes, count);
+
+            if (!_hasAcquisitionFilter) {
+                _storeDecodedNodes(timestamps_uS, nodes, count, arrival_uS);
+                return;
+            }
+
+            // only the nodes kept go any further
+            while (count) {
+                size_t batchSize = std::min<size_t>(count, ACQUISITION_BATCH_SIZE);
+                size_t kept;
+                {
+                    rp::hal::AutoLocker l(_callback_locker);
+                    kept = _acquisitionFilter.apply(timestamps_uS, nodes, batchSize, _acquiredTimestamps_uS, _acquiredNodes);
+                }
+                _filteredNodeCount.fetch_add(batchSize - kept, std::memory_order_relaxed);
+                if (kept) _storeDecodedNodes(_acquiredTimestamps_uS, _acquiredNodes, kept, arrival_uS);
+
+                timestamps_uS += batchSize;
+                nodes += batchSize;
+                count -= batchSize;
+            }
         }
 
         virtual void onHQNodeScanResetReq() {
             _scanHolder.rewindCurrentScanData();
+            _resetSlices();
+            _resetAcquisitionFilter();
+        }
+
+        virtual void onDecodingError(int errMsg, _u8 ansType, const void* payload, size_t size)
+        {
+            // the checksum errors are counted by the unpacker itself
+            if (errMsg != internal::LIDARSampleDataUnpacker::ERR_EVENT_ON_EXP_CHECKSUM_ERR) {
+                _decodingErrorCount.fetch_add(1, std::memory_order_relaxed);
+            }
         }
 
-        virtual void onProtocolMessageDecoded(const internal::ProtocolMessage& msg)
+        virtual void onProtocolMessageDecoded(_u8 cmd, const _u8* payload, size_t size)
         {
-            internal::message_autoptr_t message = std::make_shared<internal::ProtocolMessage>(msg);
+            _packetCount.fetch_add(1, std::memory_order_relaxed);
 
-            if (_dataunpacker->onSampleData(message->cmd, message->getDataBuf(), message->getPayloadSize()))
+            // the sample data is consumed in place
+            if (_activeUnpacker.load(std::memory_order_acquire)->onSampleData(cmd, payload, size))
             {
+                _samplePacketCount.fetch_add(1, std::memory_order_relaxed);
+                if (_waitingFirstSample.load(std::memory_order_relaxed) && _waitingFirstSample.exchange(false)) {
+                    _firstSampleEvt.set();
+                }
                 return;
             }
 
-            if (message->cmd == _waiting_packet_type) {
+            if (cmd == _waiting_packet_type) {
+                // only a response being waited for outlives the call
+                internal::message_autoptr_t message = std::make_shared<internal::ProtocolMessage>(cmd, payload, size);
                 _data_locker.lock();
                 _lastAnsPkt = message;
                 _response_waiter.setResult(message->cmd);
@@ -1670,29 +2983,279 @@ namespace sl {
 
             
         }
+
+        virtual void onProtocolChannelError(u_result errCode)
+        {
+            _channelErrorCount.fetch_add(1, std::memory_order_relaxed);
+            if (!_reconnectPolicy.enabled) return;
+
+            // the outage lasts from the first error till the channel is restored
+            _u64 noOutage = 0;
+            _outageStart_uS.compare_exchange_strong(noOutage, getus());
+            _reconnectEvt.set();
+        }
+    protected:
+        void _pushSliceNodes(const _u64* timestamps_uS, const rplidar_response_measurement_node_hq_t* nodes, size_t count)
+        {
+            rp::hal::AutoLocker l(_callback_locker);
+            if (!_sliceCallback) return;
+            _sliceAssembler.pushNodes(timestamps_uS, nodes, count, [this](const LidarScanSlice& slice) {
+                _sliceCallback(slice);
+            });
+        }
+
+        // hand the nodes of a packet to the slices, the interval sample queue, the node callback and the scans
+        void _storeDecodedNodes(const _u64* timestamps_uS, const rplidar_response_measurement_node_hq_t* nodes, size_t count, _u64 arrival_uS)
+        {
+            if (_hasSliceCallback) _pushSliceNodes(timestamps_uS, nodes, count);
+            _rawSampleNodeHolder.pushNodes(timestamps_uS, nodes, count);
+
+            if (_hasNodeCallback) {
+                rp::hal::AutoLocker l(_callback_locker);
+                if (_nodeCallback) {
+                    for (size_t pos = 0; pos < count; ++pos) {
+                        _nodeCallback(nodes[pos], timestamps_uS[pos]);
+                    }
+                }
+            }
+
+            while (count) {
+                bool scanPublished;
+                size_t consumed = _scanHolder.pushScanNodeDataBatch(timestamps_uS, nodes, count, scanPublished, arrival_uS);
+                if (scanPublished && arrival_uS) _latency.scanSwap.record(getus() - arrival_uS);
+
+                if (scanPublished && _hasScanCallback) {
+                    _publishScanToCallback();
+                }
+
+                timestamps_uS += consumed;
+                nodes += consumed;
+                count -= consumed;
+            }
+        }
+
+        void _resetSlices()
+        {
+            if (!_hasSliceCallback) return;
+            rp::hal::AutoLocker l(_callback_locker);
+            _sliceAssembler.reset();
+        }
+
+        void _resetAcquisitionFilter()
+        {
+            if (!_hasAcquisitionFilter) return;
+            rp::hal::AutoLocker l(_callback_locker);
+            _acquisitionFilter.reset();
+        }
+
+        void _evaluateSafetyZones(const _u64* timestamps_uS, const rplidar_response_measurement_node_hq_t* nodes, size_t count)
+        {
+            rp::hal::AutoLocker l(_callback_locker);
+            if (_safetyMonitor) _safetyMonitor->evaluate(nodes, timestamps_uS, count);
+        }
+
+        // returns when the bytes being decoded were received, 0 if the latency is not tracked
+        _u64 _recordNodeDecodeLatency()
+        {
+            if (!_latencyTracking) return 0;
+
+            _u64 arrival_uS = _transeiver->getDecodingArrivalTimestamp();
+            if (arrival_uS) _latency.nodeDecode.record(getus() - arrival_uS);
+            return arrival_uS;
+        }
+
+        bool _lookupCachedScanMode(sl_u16 id, LidarScanMode& mode)
+        {
+            if (!_hasCapabilityProfile) return false;
+
+            for (size_t pos = 0; pos < _capabilityProfile.scanModes.size(); ++pos) {
+                if (_capabilityProfile.scanModes[pos].id == id) {
+                    mode = _capabilityProfile.scanModes[pos];
+                    return true;
+                }
+            }
+            return false;
+        }
+
+        void _armFirstSampleWait()
+        {
+            _firstSampleEvt.set(false);
+            _waitingFirstSample = true;
+        }
+
+        void _waitFirstSample()
+        {
+            _firstSampleEvt.wait(_scanStartTimeout);
+            _waitingFirstSample = false;
+        }
+
+        // the next command will not be sent within timeout ms
+        void _setCommandGuard(sl_u32 timeout)
+        {
+            _commandGuardDeadline_uS = getus() + (_u64)timeout * 1000;
+        }
+
+        void _waitCommandGuard()
+        {
+            if (!_commandGuardDeadline_uS) return;
+
+            _u64 now = getus();
+            if (now < _commandGuardDeadline_uS) {
+                delay((_word_size_t)((_commandGuardDeadline_uS - now + 999) / 1000));
+            }
+            _commandGuardDeadline_uS = 0;
+        }
+
+        void _recordScanGrabLatency(_u64 arrival_uS)
+        {
+            if (arrival_uS && _latencyTracking) _latency.scanGrab.record(getus() - arrival_uS);
+        }
+
+        void _updateHasScanCallback_locked()
+        {
+            _hasScanCallback = (bool)_scanCallback || _scanPublisher || _lineExtractor;
+        }
+
+        void _publishScanToCallback()
+        {
+            int slotID;
+            _u64 timestamp_uS = 0;
+            _u64 arrival_uS = 0;
+            _u64 sequence = 0;
+            auto scan = _scanHolder.acquireLatestScan(slotID, &timestamp_uS, &arrival_uS, &sequence);
+            if (!scan) return;
+
+            _recordScanGrabLatency(arrival_uS);
+
+            {
+                rp::hal::AutoLocker l(_callback_locker);
+                if (_scanPublisher) _scanPublisher->publishScan(scan->data(), scan->size(), timestamp_uS, sequence);
+                if (_scanCallback) _scanCallback(scan->data(), scan->size(), timestamp_uS);
+                if (_lineExtractor && scan->size()) {
+                    _lineNodes.assign(scan->data(), scan->data() + scan->size());
+                    if (SL_IS_OK(ascendScanData_(&_lineNodes[0], _lineNodes.size(), _lineSortScratch))) {
+                        _lineExtractor->extract(&_lineNodes[0], _lineNodes.size(), _lineSegments);
+                        _lineCallback(&_lineNodes[0], _lineNodes.size(), timestamp_uS, _lineSegments.empty() ? NULL : &_lineSegments[0], _lineSegments.size());
+                    }
+                }
+            }
+            _scanHolder.releaseScan(slotID);
+        }
+
     private:
 
         std::shared_ptr<internal::RPLidarProtocolCodec> _protocolHandler;
         std::shared_ptr<internal::AsyncTransceiver> _transeiver;
         std::shared_ptr<internal::LIDARSampleDataUnpacker> _dataunpacker;
+        // the unpackers specialized for the answer types from SL_LIDAR_ANS_TYPE_MEASUREMENT on
+        std::atomic<internal::LIDARSampleDataUnpacker*> _specializedUnpackers[6];
+        std::atomic<internal::LIDARSampleDataUnpacker*> _activeUnpacker;
+        bool _specializedDecoding;
+        bool _deviceClockModel;
+
+        // the scan stream occupies the link from the start of a scan till the data grabbing is disabled
+        std::atomic<bool> _isStreaming;
+
+        // the commands queued by sendCommandAsync, sent by _asyncThread
+        rp::hal::Locker                  _async_locker;
+        std::deque<AsyncCommandRequest>  _asyncRequests;
+        rp::hal::Event                   _asyncEvt;
+        rp::hal::Thread                  _asyncThread;
+        bool                             _asyncThreadRunning;
+        std::atomic<bool>                _asyncExiting;
 
         bool _isConnected;
 
+        // the reconnect policy, see LidarReconnectPolicy. The state to restore is guarded by _op_locker
+        IChannel*                 _channel;
+        LidarReconnectPolicy      _reconnectPolicy;
+        rp::hal::Thread           _reconnectThread;
+        bool                      _reconnectThreadRunning;
+        std::atomic<bool>         _reconnectExiting;
+        rp::hal::Event            _reconnectEvt;
+        rp::hal::Event            _reconnectCancelEvt;
+        bool                      _recovering;
+        ScanResumeState           _scanToResume;
+        sl_u32                    _negotiatedBaudRate;
+        int                       _motorSpeedToRestore;
+        std::atomic<_u64>         _outageStart_uS;
+        std::atomic<_u64>         _totalDowntime_uS;
+        std::atomic<_u64>         _lastRecoveryTime_uS;
+        std::atomic<_u32>         _channelErrorCount;
+        std::atomic<_u32>         _reconnectCount;
+        std::atomic<_u32>         _reconnectFailureCount;
+
         MotorCtrlSupport          _isSupportingMotorCtrl;
 
 
         rp::hal::Locker           _op_locker;
         rp::hal::Locker           _data_locker;
+        // guards the sort scratch of ascendScanData, which may be called from any thread
+        rp::hal::Locker           _ascend_locker;
+        std::vector<sl_lidar_response_measurement_node_hq_t> _ascendScratch;
         rp::hal::Waiter<_u32>     _response_waiter;
 
-        ScanDataHolder<sl_lidar_response_measurement_node_hq_t> _scanHolder;
+        typedef ScanDataHolder<sl_lidar_response_measurement_node_hq_t> internal_scan_holder_t;
+        internal_scan_holder_t _scanHolder;
         RawSampleNodeHolder<sl_lidar_response_measurement_node_hq_t> _rawSampleNodeHolder;
+        // the block the buffers are carved from with a memory budget, the node buffers start at _arenaNodeMark
+        internal::MemoryArena         _arena;
+        LidarMemoryProfile            _memoryProfile;
+        size_t                        _arenaNodeMark;
+        bool                          _intervalQueueInArena;
         _u32                          _waiting_packet_type;
         internal::message_autoptr_t   _lastAnsPkt;
 
         sl_lidar_response_device_info_t _cached_DevInfo;
+        bool                           _hasCachedDevInfo;
+        LidarCapabilityProfile         _capabilityProfile;
+        bool                           _hasCapabilityProfile;
+
+        // bounds of the waits made by the command paths, see LidarConnectOptions
+        sl_u32                    _scanStartTimeout;
+        sl_u32                    _stopTimeout;
+        sl_u32                    _motorCommandGuardTime;
+        _u64                      _commandGuardDeadline_uS;
+        rp::hal::Event            _firstSampleEvt;
+        std::atomic<bool>         _waitingFirstSample;
         SlamtecLidarTimingDesc         _timing_desc;
 
+        // recursive, so the callbacks can be replaced from inside a callback
+        rp::hal::Locker           _callback_locker;
+        LidarScanCallback         _scanCallback;
+        LidarNodeCallback         _nodeCallback;
+        LidarSliceCallback        _sliceCallback;
+        ScanSliceAssembler        _sliceAssembler;
+        ILidarScanPublisher*      _scanPublisher;
+        ILidarSafetyMonitor*      _safetyMonitor;
+        LidarLineExtractor*       _lineExtractor;
+        LidarLineCallback         _lineCallback;
+        std::vector<sl_lidar_response_measurement_node_hq_t> _lineNodes;
+        std::vector<sl_lidar_response_measurement_node_hq_t> _lineSortScratch;
+        std::vector<LidarLineSegment> _lineSegments;
+        std::atomic<bool>         _hasSafetyMonitor;
+        std::atomic<bool>         _hasScanCallback;
+        std::atomic<bool>         _hasNodeCallback;
+        std::atomic<bool>         _hasSliceCallback;
+
+        // guarded by _callback_locker, the nodes kept are copied out by the decoding thread
+        AcquisitionNodeFilter     _acquisitionFilter;
+        std::atomic<bool>         _hasAcquisitionFilter;
+        _u64                      _acquiredTimestamps_uS[ACQUISITION_BATCH_SIZE];
+        sl_lidar_response_measurement_node_hq_t _acquiredNodes[ACQUISITION_BATCH_SIZE];
+
+        rp::hal::Locker           _capture_locker;
+        std::shared_ptr<internal::RawCaptureWriter> _rawCapture;
+
+        internal::LatencyTracker  _latency;
+        std::atomic<bool>         _latencyTracking;
+
+        std::atomic<_u64>         _packetCount;
+        std::atomic<_u64>         _samplePacketCount;
+        std::atomic<_u64>         _decodedNodeCount;
+        std::atomic<_u64>         _filteredNodeCount;
+        std::atomic<_u32>         _decodingErrorCount;
+
     };
 
     Result<ILidarDriver*> createLidarDriver()
@@ -0,0 +1,280 @@
+/*
+ *  Slamtec LIDAR SDK
+ *
+ *  Copyright (c) 2014 - 2023 Shanghai Slamtec Co., Ltd.
+ *  http://www.slamtec.com
+ *
+ */
+ /*
+  * Redistribution and use in source and binary forms, with or without
+  * modification, are permitted provided that the following conditions are met:
+  *
+  * 1. Redistributions of source code must retain the above copyright notice,
+  *    this list of conditions and the following disclaimer.
+  *
+  * 2. Redistributions in binary form must reproduce the above copyright notice,
+  *    this list of conditions and the following disclaimer in the documentation
+  *    and/or other materials provided with the distribution.
+  *
+  * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+  * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+  * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+  * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+  * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+  * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+  * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+  * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+  * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+  * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+  * EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+  *
+  */
+
+#include "sdkcommon.h"
+#include "sl_lidar_driver.h"
+#include "sl_lidar_fastconnect.h"
+
+#include <stdio.h>
+#include <algorithm>
+
+#define SL_LIDAR_PROFILE_HEADER     "slamtec_lidar_profile"
+#define SL_LIDAR_PROFILE_VERSION    1
+
+namespace sl {
+
+    namespace {
+
+        static std::string _getProfilePath(const std::string& cacheDir, const sl_u8* serialnum)
+        {
+            char name[40];
+            for (int pos = 0; pos < 16; ++pos) {
+                sprintf(name + pos * 2, "%02X", serialnum[pos]);
+            }
+            return cacheDir + "/" + name + ".profile";
+        }
+
+        static std::string _getBaudRatePath(const std::string& cacheDir, const std::string& device)
+        {
+            // e.g. /dev/ttyUSB0 => dev_ttyUSB0.baud
+            std::string name;
+            for (size_t pos = 0; pos < device.size(); ++pos) {
+                char c = device[pos];
+                bool plain = (c >= '0' && c <= '9') || (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || c == '-';
+                if (plain) {
+                    name += c;
+                } else if (!name.empty() && name[name.size() - 1] != '_') {
+                    name += '_';
+                }
+            }
+            return cacheDir + "/" + name + ".baud";
+        }
+
+        static sl_u32 _loadBaudRate(const std::string& path)
+        {
+            FILE* file = fopen(path.c_str(), "r");
+            if (!file) return 0;
+
+            unsigned long baudRate = 0;
+            if (fscanf(file, "%lu", &baudRate) != 1) baudRate = 0;
+            fclose(file);
+            return (sl_u32)baudRate;
+        }
+
+        static void _saveBaudRate(const std::string& path, sl_u32 baudRate)
+        {
+            FILE* file = fopen(path.c_str(), "w");
+            if (!file) return;
+
+            fprintf(file, "%lu\n", (unsigned long)baudRate);
+            fclose(file);
+        }
+
+        static sl_result _probe(ILidarDriver* drv, IChannel* channel, sl_u32 negotiateBaudRate,
+                const LidarFastConnectOptions& options, sl_lidar_response_device_info_t& devInfo)
+        {
+            LidarConnectOptions connectOptions = options.connectOptions;
+            connectOptions.probeTimeout = options.probeTimeout;
+
+            sl_result ans = drv->connect(channel, connectOptions);
+            if (SL_IS_FAIL(ans)) return ans;
+
+            if (negotiateBaudRate) {
+                ans = drv->negotiateSerialBaudRate(negotiateBaudRate);
+                if (SL_IS_OK(ans)) ans = drv->getDeviceInfo(devInfo, options.probeTimeout);
+            } else {
+                // connect has just queried it, a device silent at this baudrate left none
+                ans = drv->getCachedDeviceInfo(devInfo);
+                if (ans == SL_RESULT_OPERATION_NOT_SUPPORT) ans = SL_RESULT_OPERATION_TIMEOUT;
+            }
+            if (SL_IS_FAIL(ans)) drv->disconnect();
+            return ans;
+        }
+    }
+
+    sl_result saveLidarCapabilityProfile(const char* filename, const LidarCapabilityProfile& profile)
+    {
+        FILE* file = fopen(filename, "w");
+        if (!file) return SL_RESULT_OPERATION_FAIL;
+
+        fprintf(file, "%s %d\n", SL_LIDAR_PROFILE_HEADER, SL_LIDAR_PROFILE_VERSION);
+        fprintf(file, "serialnum ");
+        for (int pos = 0; pos < 16; ++pos) {
+            fprintf(file, "%02X", profile.serialnum[pos]);
+        }
+        fprintf(file, "\nmodel %u\nfirmware_version %u\nhardware_version %u\n",
+                (unsigned)profile.model, (unsigned)profile.firmware_version, (unsigned)profile.hardware_version);
+        fprintf(file, "motor_ctrl %d\nconfig_commands %d\ntypical_mode %u\n",
+                (int)profile.motorCtrlSupport, profile.supportConfigCommands ? 1 : 0, (unsigned)profile.typicalScanMode);
+
+        // mode <id> <us_per_sample> <max_distance> <ans_type> <name up to the end of the line>
+        for (size_t pos = 0; pos < profile.scanModes.size(); ++pos) {
+            const LidarScanMode& mode = profile.scanModes[pos];
+            char name[sizeof(mode.scan_mode) + 1];
+            memcpy(name, mode.scan_mode, sizeof(mode.scan_mode));
+            name[sizeof(mode.scan_mode)] = 0;
+            fprintf(file, "mode %u %.9g %.9g %u %s\n", (unsigned)mode.id, mode.us_per_sample, mode.max_distance, (unsigned)mode.ans_type, name);
+        }
+
+        bool written = !ferror(file);
+        if (fclose(file)) written = false;
+        return written ? SL_RESULT_OK : SL_RESULT_OPERATION_FAIL;
+    }
+
+    sl_result loadLidarCapabilityProfile(const char* filename, LidarCapabilityProfile& profile)
+    {
+        FILE* file = fopen(filename, "r");
+        if (!file) return SL_RESULT_OPERATION_FAIL;
+
+        LidarCapabilityProfile loaded;
+        char line[256];
+        int fields = 0;
+        bool valid = false;
+
+        if (fgets(line, sizeof(line), file)) {
+            int version = 0;
+            char header[32];
+            valid = sscanf(line, "%31s %d", header, &version) == 2
+                && strcmp(header, SL_LIDAR_PROFILE_HEADER) == 0 && version == SL_LIDAR_PROFILE_VERSION;
+        }
+
+        while (valid && fgets(line, sizeof(line), file)) {
+            char key[32];
+            int offset = 0;
+            if (sscanf(line, "%31s %n", key, &offset) != 1) continue;
+            const char* value = line + offset;
+            unsigned a = 0, b = 0;
+
+            if (strcmp(key, "serialnum") == 0) {
+                for (int pos = 0; pos < 16 && valid; ++pos) {
+                    valid = sscanf(value + pos * 2, "%2x", &a) == 1;
+                    loaded.serialnum[pos] = (sl_u8)a;
+                }
+                ++fields;
+            } else if (strcmp(key, "model") == 0 && sscanf(value, "%u", &a) == 1) {
+                loaded.model = (sl_u8)a;
+                ++fields;
+            } else if (strcmp(key, "firmware_version") == 0 && sscanf(value, "%u", &a) == 1) {
+                loaded.firmware_version = (sl_u16)a;
+                ++fields;
+            } else if (strcmp(key, "hardware_version") == 0 && sscanf(value, "%u", &a) == 1) {
+                loaded.hardware_version = (sl_u8)a;
+                ++fields;
+            } else if (strcmp(key, "motor_ctrl") == 0 && sscanf(value, "%u", &a) == 1) {
+                loaded.motorCtrlSupport = (MotorCtrlSupport)a;
+                ++fields;
+            } else if (strcmp(key, "config_commands") == 0 && sscanf(value, "%u", &a) == 1) {
+                loaded.supportConfigCommands = a != 0;
+                ++fields;
+            } else if (strcmp(key, "typical_mode") == 0 && sscanf(value, "%u", &a) == 1) {
+                loaded.typicalScanMode = (sl_u16)a;
+                ++fields;
+            } else if (strcmp(key, "mode") == 0) {
+                LidarScanMode mode;
+                memset(&mode, 0, sizeof(mode));
+                int nameOffset = 0;
+                if (sscanf(value, "%u %f %f %u %n", &a, &mode.us_per_sample, &mode.max_distance, &b, &nameOffset) != 4) {
+                    valid = false;
+                    break;
+                }
+                mode.id = (sl_u16)a;
+                mode.ans_type = (sl_u8)b;
+
+                std::string name(value + nameOffset);
+                while (!name.empty() && (name[name.size() - 1] == '\n' || name[name.size() - 1] == '\r')) name.erase(name.size() - 1);
+                strncpy(mode.scan_mode, name.c_str(), sizeof(mode.scan_mode) - 1);
+                loaded.scanModes.push_back(mode);
+            }
+        }
+        fclose(file);
+
+        if (!valid || fields != 7) return SL_RESULT_INVALID_DATA;
+        profile = loaded;
+        return SL_RESULT_OK;
+    }
+
+    Result<IChannel*> connectLidarSerialFast(ILidarDriver* drv, const std::string& device,
+            const LidarFastConnectOptions& options, LidarFastConnectInfo* outInfo)
+    {
+        if (!drv) return SL_RESULT_INVALID_DATA;
+
+        LidarFastConnectInfo info;
+        std::vector<sl_u32> baudRates = options.baudRates;
+        std::string baudRatePath;
+
+        if (!options.cacheDir.empty()) {
+            baudRatePath = _getBaudRatePath(options.cacheDir, device);
+            sl_u32 cachedBaudRate = _loadBaudRate(baudRatePath);
+            if (cachedBaudRate) {
+                baudRates.erase(std::remove(baudRates.begin(), baudRates.end(), cachedBaudRate), baudRates.end());
+                baudRates.insert(baudRates.begin(), cachedBaudRate);
+            }
+        }
+
+        IChannel* channel = NULL;
+        sl_result ans = SL_RESULT_OPERATION_TIMEOUT;
+        for (size_t pos = 0; pos <= baudRates.size(); ++pos) {
+            // the negotiation comes last, it takes more than a second
+            bool negotiate = pos == baudRates.size();
+            if (negotiate && !options.negotiateBaudRate) break;
+            sl_u32 baudRate = negotiate ? options.negotiateBaudRate : baudRates[pos];
+
+            Result<IChannel*> created = createSerialPortChannel(device, baudRate);
+            if (!created) return created.err;
+            channel = *created;
+
+            ans = _probe(drv, channel, negotiate ? baudRate : 0, options, info.devInfo);
+            if (SL_IS_OK(ans)) {
+                info.baudRate = baudRate;
+                break;
+            }
+
+            delete channel;
+            channel = NULL;
+            // the port itself cannot be opened, no baudrate will do
+            if (ans != SL_RESULT_OPERATION_TIMEOUT && ans != SL_RESULT_INVALID_DATA) return ans;
+        }
+        if (!channel) return ans;
+
+        std::string profilePath;
+        if (!options.cacheDir.empty()) {
+            _saveBaudRate(baudRatePath, info.baudRate);
+            profilePath = _getProfilePath(options.cacheDir, info.devInfo.serialnum);
+
+            if (SL_IS_OK(loadLidarCapabilityProfile(profilePath.c_str(), info.profile))
+                && SL_IS_OK(drv->setCapabilityProfile(info.profile))) {
+                info.profileCached = true;
+            }
+        }
+
+        if (!info.profileCached) {
+            ans = drv->getCapabilityProfile(info.profile);
+            // still connected, startScan will query what it needs
+            if (SL_IS_OK(ans) && !profilePath.empty()) {
+                saveLidarCapabilityProfile(profilePath.c_str(), info.profile);
+            }
+        }
+
+        if (outInfo) *outInfo = info;
+        return channel;
+    }
+}
@@ -0,0 +1,444 @@
+/*
+ *  Slamtec LIDAR SDK
+ *
+ *  Copyright (c) 2014 - 2023 Shanghai Slamtec Co., Ltd.
+ *  http://www.slamtec.com
+ *
+ */
+ /*
+  * Redistribution and use in source and binary forms, with or without
+  * modification, are permitted provided that the following conditions are met:
+  *
+  * 1. Redistributions of source code must retain the above copyright notice,
+  *    this list of conditions and the following disclaimer.
+  *
+  * 2. Redistributions in binary form must reproduce the above copyright notice,
+  *    this list of conditions and the following disclaimer in the documentation
+  *    and/or other materials provided with the distribution.
+  *
+  * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+  * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+  * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+  * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+  * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+  * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+  * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+  * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+  * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+  * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+  * EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+  *
+  */
+
+#include "sdkcommon.h"
+#include "hal/thread.h"
+#include "hal/types.h"
+#include "hal/assert.h"
+#include "hal/locker.h"
+#include "hal/event.h"
+#include "sl_lidar_driver.h"
+#include "sl_lidar_fleet.h"
+
+#include <vector>
+#include <algorithm>
+
+namespace sl {
+
+    class LidarFleet : public ILidarFleet
+    {
+    public:
+        enum {
+            // scans a device may queue while waiting for the others, a device stalled for longer is left out of the sets
+            DEVICE_PENDING_DEPTH = 3,
+        };
+
+        LidarFleet(const LidarFleetOptions& options)
+            : _options(options)
+            , _reactor(NULL)
+            , _isRunning(false)
+            , _startTimeout(ILidarDriver::DEFAULT_TIMEOUT)
+            , _sets(options.queueDepth ? options.queueDepth : 1)
+            , _setHead(0)
+            , _queuedSetCount(0)
+            , _droppedSetCount(0)
+            , _unmatchedScanCount(0)
+        {
+        }
+
+        virtual ~LidarFleet()
+        {
+            stop();
+            for (size_t pos = 0; pos < _devices.size(); ++pos) {
+                delete _devices[pos];
+            }
+        }
+
+        size_t addDevice(IChannel* channel, const LidarFleetDeviceOptions& options)
+        {
+            rp::hal::AutoLocker l(_locker);
+            assert(!_isRunning);
+            _devices.push_back(new DeviceContext(this, _devices.size(), channel, options));
+            return _devices.size() - 1;
+        }
+
+        sl_result start(sl_u32 timeoutInMs)
+        {
+            if (_isRunning) return SL_RESULT_ALREADY_DONE;
+            _startTimeout = timeoutInMs;
+
+            if (_options.ioThreadCount && !_reactor) {
+                // without a reactor every device falls back to dedicated threads
+                Result<ILidarIOReactor*> reactor = createLidarIOReactor(_options.ioThreadCount, _options.decodeWorkerCount);
+                if (reactor) _reactor = *reactor;
+            }
+
+            _isRunning = true;
+
+            // the handshakes wait for the answers of the devices, so they run in parallel
+            for (size_t pos = 0; pos < _devices.size(); ++pos) {
+                DeviceContext* device = _devices[pos];
+                device->status = SL_RESULT_OPERATION_FAIL;
+                device->startThread = rp::hal::Thread::create_member<DeviceContext, &DeviceContext::_proc_startThread>(device);
+            }
+
+            sl_result ans = SL_RESULT_OK;
+            for (size_t pos = 0; pos < _devices.size(); ++pos) {
+                _devices[pos]->startThread.join();
+                if (SL_IS_FAIL(_devices[pos]->status)) ans = SL_RESULT_OPERATION_FAIL;
+            }
+            return ans;
+        }
+
+        void stop()
+        {
+            if (!_isRunning) return;
+
+            for (size_t pos = 0; pos < _devices.size(); ++pos) {
+                _stopDevice(*_devices[pos]);
+            }
+
+            if (_reactor) {
+                // all the drivers have been disconnected from it
+                delete _reactor;
+                _reactor = NULL;
+            }
+
+            rp::hal::AutoLocker l(_locker);
+            _setHead = 0;
+            _queuedSetCount = 0;
+            _isRunning = false;
+        }
+
+        size_t getDeviceCount()
+        {
+            rp::hal::AutoLocker l(_locker);
+            return _devices.size();
+        }
+
+        ILidarDriver* getDriver(size_t index)
+        {
+            rp::hal::AutoLocker l(_locker);
+            if (index >= _devices.size()) return NULL;
+            return _devices[index]->driver;
+        }
+
+        sl_result getDeviceStatus(size_t index)
+        {
+            rp::hal::AutoLocker l(_locker);
+            if (index >= _devices.size()) return SL_RESULT_INVALID_DATA;
+            return _devices[index]->status;
+        }
+
+        sl_result waitScanSet(LidarScanSet& set, sl_u32 timeoutInMs)
+        {
+            _u32 startTs = getms();
+            for (;;) {
+                {
+                    rp::hal::AutoLocker l(_locker);
+                    if (_queuedSetCount) {
+                        // the caller's buffers are recycled for a later set
+                        std::swap(set, _sets[_setHead]);
+                        _setHead = (_setHead + 1) % _sets.size();
+                        --_queuedSetCount;
+                        return SL_RESULT_OK;
+                    }
+                }
+
+                _u32 elapsed = getms() - startTs;
+                if (elapsed >= timeoutInMs) return SL_RESULT_OPERATION_TIMEOUT;
+                _setEvt.wait(timeoutInMs - elapsed);
+            }
+        }
+
+        sl_u64 getDroppedSetCount()
+        {
+            rp::hal::AutoLocker l(_locker);
+            return _droppedSetCount;
+        }
+
+        sl_u64 getUnmatchedScanCount()
+        {
+            rp::hal::AutoLocker l(_locker);
+            return _unmatchedScanCount;
+        }
+
+    protected:
+        struct PendingScan {
+            std::vector<sl_lidar_response_measurement_node_hq_t> nodes;
+            sl_u64 timestamp_uS;
+        };
+
+        struct DeviceContext {
+            DeviceContext(LidarFleet* owner, size_t deviceIndex, IChannel* deviceChannel, const LidarFleetDeviceOptions& deviceOptions)
+                : fleet(owner)
+                , index(deviceIndex)
+                , channel(deviceChannel)
+                , options(deviceOptions)
+                , driver(NULL)
+                , status(SL_RESULT_OPERATION_FAIL)
+                , active(false)
+                , lagging(false)
+                , pendingHead(0)
+                , pendingCount(0)
+            {
+            }
+
+            u_result _proc_startThread()
+            {
+                fleet->_startDevice(*this);
+                return RESULT_OK;
+            }
+
+            PendingScan& head() {
+                return pending[pendingHead];
+            }
+
+            void popHead() {
+                pendingHead = (pendingHead + 1) % DEVICE_PENDING_DEPTH;
+                --pendingCount;
+            }
+
+            LidarFleet* fleet;
+            size_t index;
+            IChannel* channel;
+            LidarFleetDeviceOptions options;
+
+            ILidarDriver* driver;
+            sl_result status;
+            rp::hal::Thread startThread;
+
+            // guarded by the fleet locker
+            bool active;
+            bool lagging;   // left out of a set, not waited for until its next scan
+            PendingScan pending[DEVICE_PENDING_DEPTH];
+            size_t pendingHead;
+            size_t pendingCount;
+        };
+
+        void _startDevice(DeviceContext& device)
+        {
+            Result<ILidarDriver*> createdDriver = createLidarDriver();
+            if (!createdDriver) {
+                device.status = SL_RESULT_INSUFFICIENT_MEMORY;
+                return;
+            }
+            ILidarDriver* driver = *createdDriver;
+
+            LidarConnectOptions connectOptions;
+            connectOptions.reactor = _reactor;
+
+            sl_result ans = driver->connect(device.channel, connectOptions);
+            if (SL_IS_OK(ans)) {
+                // make sure there is a device answering on the channel
+                sl_lidar_response_device_info_t devinfo;
+                ans = driver->getDeviceInfo(devinfo, _startTimeout);
+            }
+
+            if (SL_IS_OK(ans)) {
+                driver->setScanCallback([this, &device](const sl_lidar_response_measurement_node_hq_t* nodes, size_t count, sl_u64 timestamp_uS) {
+                    _onScan(device, nodes, count, timestamp_uS);
+                });
+                {
+                    rp::hal::AutoLocker l(_locker);
+                    device.active = true;
+                    device.lagging = false;
+                }
+
+                driver->setMotorSpeed();
+                switch (device.options.scanMode) {
+                case LidarFleetDeviceOptions::SCAN_MODE_TYPICAL:
+                    ans = driver->startScan(false, true);
+                    break;
+                case LidarFleetDeviceOptions::SCAN_MODE_STANDARD:
+                    ans = driver->startScan(false, false);
+                    break;
+                default:
+                    ans = driver->startScanExpress(false, device.options.scanMode, 0, NULL, _startTimeout);
+                }
+            }
+
+            if (SL_IS_FAIL(ans)) {
+                driver->setScanCallback(LidarScanCallback());
+                if (driver->isConnected()) driver->disconnect();
+                delete driver;
+                driver = NULL;
+            }
+
+            rp::hal::AutoLocker l(_locker);
+            if (!driver) {
+                device.active = false;
+                device.pendingCount = 0;
+                // the sets may have been held back by this device
+                _assembleSets_locked();
+            }
+            device.driver = driver;
+            device.status = ans;
+        }
+
+        void _stopDevice(DeviceContext& device)
+        {
+            ILidarDriver* driver;
+            {
+                rp::hal::AutoLocker l(_locker);
+                driver = device.driver;
+                device.driver = NULL;
+                device.active = false;
+                device.pendingCount = 0;
+                device.status = SL_RESULT_OPERATION_STOP;
+            }
+            if (!driver) return;
+
+            // no callback is running once it returns
+            driver->setScanCallback(LidarScanCallback());
+            driver->stop();
+            driver->setMotorSpeed(0);
+            driver->disconnect();
+            delete driver;
+        }
+
+        void _onScan(DeviceContext& device, const sl_lidar_response_measurement_node_hq_t* nodes, size_t count, sl_u64 timestamp_uS)
+        {
+            rp::hal::AutoLocker l(_locker);
+            if (!device.active) return;
+
+            if (device.pendingCount == DEVICE_PENDING_DEPTH) {
+                device.popHead();
+                ++_unmatchedScanCount;
+            }
+
+            device.lagging = false;
+            PendingScan& scan = device.pending[(device.pendingHead + device.pendingCount) % DEVICE_PENDING_DEPTH];
+            scan.nodes.assign(nodes, nodes + count);
+            scan.timestamp_uS = timestamp_uS;
+            ++device.pendingCount;
+
+            _assembleSets_locked();
+        }
+
+        void _assembleSets_locked()
+        {
+            for (;;) {
+                size_t activeCount = 0;
+                size_t waitedCount = 0;
+                size_t readyCount = 0;
+                bool stalled = false;
+                sl_u64 oldest = 0;
+                sl_u64 newest = 0;
+
+                for (size_t pos = 0; pos < _devices.size(); ++pos) {
+                    DeviceContext& device = *_devices[pos];
+                    if (!device.active) continue;
+                    ++activeCount;
+                    if (!device.pendingCount) {
+                        if (!device.lagging) ++waitedCount;
+                        continue;
+                    }
+
+                    sl_u64 ts = device.head().timestamp_uS;
+                    if (!readyCount || ts < oldest) oldest = ts;
+                    if (!readyCount || ts > newest) newest = ts;
+                    if (device.pendingCount == DEVICE_PENDING_DEPTH) stalled = true;
+                    ++readyCount;
+                }
+
+                if (!readyCount) return;
+
+                // wait for the other devices unless one of them has fallen behind for too long
+                if (waitedCount && !stalled) return;
+
+                if (!waitedCount && newest - oldest > _options.syncWindow_uS) {
+                    // the oldest scans have no counterpart of the other devices, and never will
+                    for (size_t pos = 0; pos < _devices.size(); ++pos) {
+                        DeviceContext& device = *_devices[pos];
+                        if (!device.active || !device.pendingCount) continue;
+                        if (device.head().timestamp_uS + _options.syncWindow_uS < newest) {
+                            device.popHead();
+                            ++_unmatchedScanCount;
+                        }
+                    }
+                    continue;
+                }
+
+                _pushSet_locked(oldest, activeCount);
+            }
+        }
+
+        void _pushSet_locked(sl_u64 oldest, size_t activeCount)
+        {
+            if (_queuedSetCount == _sets.size()) {
+                _setHead = (_setHead + 1) % _sets.size();
+                --_queuedSetCount;
+                ++_droppedSetCount;
+            }
+
+            LidarScanSet& set = _sets[(_setHead + _queuedSetCount) % _sets.size()];
+            size_t scanCount = 0;
+            set.timestamp_uS = oldest;
+
+            for (size_t pos = 0; pos < _devices.size(); ++pos) {
+                DeviceContext& device = *_devices[pos];
+                if (!device.active) continue;
+                if (!device.pendingCount) {
+                    device.lagging = true;
+                    continue;
+                }
+                if (device.head().timestamp_uS > oldest + _options.syncWindow_uS) continue;
+
+                if (set.scans.size() <= scanCount) set.scans.resize(scanCount + 1);
+                LidarFleetScan& scan = set.scans[scanCount++];
+                scan.deviceIndex = device.index;
+                scan.timestamp_uS = device.head().timestamp_uS;
+                // the pending slot takes over the buffer of the recycled set
+                std::swap(scan.nodes, device.head().nodes);
+                device.popHead();
+            }
+
+            set.scans.resize(scanCount);
+            set.complete = (scanCount == activeCount);
+            ++_queuedSetCount;
+            _setEvt.set();
+        }
+
+    protected:
+        LidarFleetOptions _options;
+        ILidarIOReactor* _reactor;
+        bool _isRunning;
+        sl_u32 _startTimeout;
+
+        rp::hal::Locker _locker;
+        rp::hal::Event  _setEvt;
+        std::vector<DeviceContext*> _devices;
+
+        std::vector<LidarScanSet> _sets;
+        size_t _setHead;
+        size_t _queuedSetCount;
+
+        sl_u64 _droppedSetCount;
+        sl_u64 _unmatchedScanCount;
+    };
+
+    Result<ILidarFleet*> createLidarFleet(const LidarFleetOptions& options)
+    {
+        return new LidarFleet(options);
+    }
+}
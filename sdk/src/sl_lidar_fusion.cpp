@@ -0,0 +1,523 @@
+/*
+ *  Slamtec LIDAR SDK
+ *
+ *  Copyright (c) 2014 - 2023 Shanghai Slamtec Co., Ltd.
+ *  http://www.slamtec.com
+ *
+ */
+ /*
+  * Redistribution and use in source and binary forms, with or without
+  * modification, are permitted provided that the following conditions are met:
+  *
+  * 1. Redistributions of source code must retain the above copyright notice,
+  *    this list of conditions and the following disclaimer.
+  *
+  * 2. Redistributions in binary form must reproduce the above copyright notice,
+  *    this list of conditions and the following disclaimer in the documentation
+  *    and/or other materials provided with the distribution.
+  *
+  * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+  * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+  * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+  * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+  * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+  * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+  * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+  * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+  * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+  * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+  * EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+  *
+  */
+
+#include "sdkcommon.h"
+#include "hal/thread.h"
+#include "hal/types.h"
+#include "hal/event.h"
+#include "sl_lidar_driver.h"
+#include "sl_lidar_fusion.h"
+#include "sl_lidar_projection.h"
+#include "sl_thread_config.h"
+
+#include <math.h>
+#include <atomic>
+#include <algorithm>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define SL_FUSION_SSE2
+#include <emmintrin.h>
+#endif
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+// compiled with the target attribute and selected at runtime
+#define SL_FUSION_AVX2
+#include <immintrin.h>
+#endif
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#define SL_FUSION_NEON
+#include <arm_neon.h>
+#endif
+
+namespace sl {
+
+    struct RigidTransform
+    {
+        float   cosYaw;
+        float   sinYaw;
+        float   x;
+        float   y;
+    };
+
+    // every routine moves the points from pos on in place and returns the first point left to the other paths
+    static size_t _transformPoints_scalar(const RigidTransform& t, float* x, float* y, size_t pos, size_t count)
+    {
+        for (; pos < count; ++pos) {
+            float px = x[pos];
+            float py = y[pos];
+            x[pos] = t.x + t.cosYaw * px - t.sinYaw * py;
+            y[pos] = t.y + t.sinYaw * px + t.cosYaw * py;
+        }
+        return pos;
+    }
+
+#ifdef SL_FUSION_AVX2
+    static bool _isAVX2Supported()
+    {
+        static const bool supported = __builtin_cpu_supports("avx2");
+        return supported;
+    }
+
+    __attribute__((target("avx2")))
+    static size_t _transformPoints_avx2(const RigidTransform& t, float* x, float* y, size_t pos, size_t count)
+    {
+        const __m256 cosYaw = _mm256_set1_ps(t.cosYaw);
+        const __m256 sinYaw = _mm256_set1_ps(t.sinYaw);
+        const __m256 offsetX = _mm256_set1_ps(t.x);
+        const __m256 offsetY = _mm256_set1_ps(t.y);
+
+        for (; pos + 8 <= count; pos += 8) {
+            __m256 px = _mm256_loadu_ps(x + pos);
+            __m256 py = _mm256_loadu_ps(y + pos);
+            // no FMA, so that every path rounds the same way
+            _mm256_storeu_ps(x + pos, _mm256_sub_ps(_mm256_add_ps(offsetX, _mm256_mul_ps(cosYaw, px)), _mm256_mul_ps(sinYaw, py)));
+            _mm256_storeu_ps(y + pos, _mm256_add_ps(_mm256_add_ps(offsetY, _mm256_mul_ps(sinYaw, px)), _mm256_mul_ps(cosYaw, py)));
+        }
+        return pos;
+    }
+#endif
+
+#ifdef SL_FUSION_SSE2
+    static size_t _transformPoints_sse2(const RigidTransform& t, float* x, float* y, size_t pos, size_t count)
+    {
+        const __m128 cosYaw = _mm_set1_ps(t.cosYaw);
+        const __m128 sinYaw = _mm_set1_ps(t.sinYaw);
+        const __m128 offsetX = _mm_set1_ps(t.x);
+        const __m128 offsetY = _mm_set1_ps(t.y);
+
+        for (; pos + 4 <= count; pos += 4) {
+            __m128 px = _mm_loadu_ps(x + pos);
+            __m128 py = _mm_loadu_ps(y + pos);
+            _mm_storeu_ps(x + pos, _mm_sub_ps(_mm_add_ps(offsetX, _mm_mul_ps(cosYaw, px)), _mm_mul_ps(sinYaw, py)));
+            _mm_storeu_ps(y + pos, _mm_add_ps(_mm_add_ps(offsetY, _mm_mul_ps(sinYaw, px)), _mm_mul_ps(cosYaw, py)));
+        }
+        return pos;
+    }
+#endif
+
+#ifdef SL_FUSION_NEON
+    static size_t _transformPoints_neon(const RigidTransform& t, float* x, float* y, size_t pos, size_t count)
+    {
+        const float32x4_t cosYaw = vdupq_n_f32(t.cosYaw);
+        const float32x4_t sinYaw = vdupq_n_f32(t.sinYaw);
+        const float32x4_t offsetX = vdupq_n_f32(t.x);
+        const float32x4_t offsetY = vdupq_n_f32(t.y);
+
+        for (; pos + 4 <= count; pos += 4) {
+            float32x4_t px = vld1q_f32(x + pos);
+            float32x4_t py = vld1q_f32(y + pos);
+            vst1q_f32(x + pos, vsubq_f32(vaddq_f32(offsetX, vmulq_f32(cosYaw, px)), vmulq_f32(sinYaw, py)));
+            vst1q_f32(y + pos, vaddq_f32(vaddq_f32(offsetY, vmulq_f32(sinYaw, px)), vmulq_f32(cosYaw, py)));
+        }
+        return pos;
+    }
+#endif
+
+    static void transformPoints(const RigidTransform& t, float* x, float* y, size_t count)
+    {
+        size_t pos = 0;
+#ifdef SL_FUSION_AVX2
+        if (_isAVX2Supported()) {
+            pos = _transformPoints_avx2(t, x, y, pos, count);
+        }
+#endif
+#ifdef SL_FUSION_SSE2
+        pos = _transformPoints_sse2(t, x, y, pos, count);
+#endif
+#ifdef SL_FUSION_NEON
+        pos = _transformPoints_neon(t, x, y, pos, count);
+#endif
+        _transformPoints_scalar(t, x, y, pos, count);
+    }
+
+    class LidarScanFusion : public ILidarScanFusion
+    {
+    public:
+        LidarScanFusion(const LidarFusionOptions& options, const LidarPoseRing* poses)
+            : _options(options)
+            , _poses(poses)
+            , _referenceTimestamp_uS(0)
+            , _taskCount(0)
+            , _nextTask(0)
+            , _isRunning(true)
+            , _nextWorkerIndex(0)
+            , _pendingWorkers(0)
+            , _doneEvt(true, false)
+        {
+            if (_options.threadCount < 1) _options.threadCount = 1;
+
+            for (size_t pos = 1; pos < _options.threadCount; ++pos) {
+                _startEvts.push_back(new rp::hal::Event(true, false));
+            }
+            for (size_t pos = 1; pos < _options.threadCount; ++pos) {
+                _workers.push_back(CLASS_THREAD(LidarScanFusion, _proc_worker));
+            }
+        }
+
+        virtual ~LidarScanFusion()
+        {
+            _isRunning = false;
+            for (size_t pos = 0; pos < _startEvts.size(); ++pos) {
+                _startEvts[pos]->set();
+            }
+            for (size_t pos = 0; pos < _workers.size(); ++pos) {
+                _workers[pos].join();
+            }
+            for (size_t pos = 0; pos < _startEvts.size(); ++pos) {
+                delete _startEvts[pos];
+            }
+            for (size_t pos = 0; pos < _devices.size(); ++pos) {
+                delete _devices[pos].deskewer;
+            }
+        }
+
+        void setExtrinsics(size_t deviceIndex, const LidarPose2D& mount)
+        {
+            DeviceContext& device = _device(deviceIndex);
+            device.mount = mount;
+            device.mount.timestamp_uS = 0;
+            if (device.deskewer) {
+                device.deskewer->setOptions(_deskewOptions(mount));
+            }
+        }
+
+        LidarPose2D getExtrinsics(size_t deviceIndex)
+        {
+            if (deviceIndex >= _devices.size()) return LidarPose2D();
+            return _devices[deviceIndex].mount;
+        }
+
+        sl_result fuse(const LidarFusionScan* scans, size_t count, LidarFusedCloud& cloud)
+        {
+            if (!scans && count) return SL_RESULT_INVALID_DATA;
+
+            if (_tasks.size() < count) _tasks.resize(count);
+            _taskCount = 0;
+            _referenceTimestamp_uS = 0;
+
+            sl_result ans = SL_RESULT_OK;
+            for (size_t pos = 0; pos < _devices.size(); ++pos) {
+                _devices[pos].busy = false;
+            }
+            for (size_t pos = 0; pos < count; ++pos) {
+                const LidarFusionScan& scan = scans[pos];
+                if ((!scan.nodes && scan.count) || scan.endTimestamp_uS < scan.timestamp_uS) {
+                    if (IS_OK(ans)) ans = SL_RESULT_INVALID_DATA;
+                    continue;
+                }
+
+                DeviceContext& device = _device(scan.deviceIndex);
+                if (device.busy) {
+                    if (IS_OK(ans)) ans = SL_RESULT_INVALID_DATA;
+                    continue;
+                }
+                device.busy = true;
+
+                ScanTask& task = _tasks[_taskCount++];
+                task.scan = scan;
+                task.result = SL_RESULT_OK;
+                _referenceTimestamp_uS = std::max(_referenceTimestamp_uS, scan.endTimestamp_uS);
+            }
+
+            // the scans are processed in parallel, the merge is left to the calling thread
+            _runTasks();
+
+            for (size_t pos = 0; pos < _taskCount; ++pos) {
+                if (IS_FAIL(_tasks[pos].result) && IS_OK(ans)) ans = _tasks[pos].result;
+            }
+            _merge(cloud);
+            return ans;
+        }
+
+        sl_result fuse(const LidarScanSet& set, LidarFusedCloud& cloud)
+        {
+            _setScans.resize(set.scans.size());
+            for (size_t pos = 0; pos < set.scans.size(); ++pos) {
+                const LidarFleetScan& fleetScan = set.scans[pos];
+                LidarFusionScan& scan = _setScans[pos];
+                scan.deviceIndex = fleetScan.deviceIndex;
+                scan.nodes = fleetScan.nodes.empty() ? NULL : &fleetScan.nodes[0];
+                scan.count = fleetScan.nodes.size();
+                scan.timestamp_uS = fleetScan.timestamp_uS;
+                scan.endTimestamp_uS = fleetScan.timestamp_uS + _estimateScanSpan(_device(fleetScan.deviceIndex), fleetScan.timestamp_uS, scan.count);
+            }
+            return fuse(_setScans.empty() ? NULL : &_setScans[0], _setScans.size(), cloud);
+        }
+
+    private:
+        struct DeviceContext
+        {
+            LidarPose2D mount;
+            LidarScanDeskewer* deskewer;
+
+            // for the time span of the scans of a fleet
+            sl_u64  lastTimestamp_uS;
+            sl_u64  scanPeriod_uS;
+
+            bool    busy;
+
+            DeviceContext()
+                : deskewer(NULL)
+                , lastTimestamp_uS(0)
+                , scanPeriod_uS(0)
+                , busy(false)
+            {
+            }
+        };
+
+        struct ScanTask
+        {
+            LidarFusionScan scan;
+            sl_result result;
+
+            // the points of the scan in the base frame, in the node order
+            std::vector<float> x;
+            std::vector<float> y;
+
+            ScanTask()
+                : result(SL_RESULT_OK)
+            {
+            }
+        };
+
+        // position of the next point of a scan during the merge
+        struct MergeCursor
+        {
+            sl_u64  timestamp_uS;
+            size_t  task;
+            size_t  node;
+
+            // the heap keeps the oldest point on top, the scans of the same time in the input order
+            bool operator<(const MergeCursor& other) const
+            {
+                if (timestamp_uS != other.timestamp_uS) return timestamp_uS > other.timestamp_uS;
+                return task > other.task;
+            }
+        };
+
+        static LidarDeskewOptions _deskewOptions(const LidarPose2D& mount)
+        {
+            LidarDeskewOptions options;
+            options.mountX = mount.x;
+            options.mountY = mount.y;
+            options.mountYaw = mount.yaw;
+            return options;
+        }
+
+        DeviceContext& _device(size_t deviceIndex)
+        {
+            while (_devices.size() <= deviceIndex) {
+                _devices.push_back(DeviceContext());
+            }
+            DeviceContext& device = _devices[deviceIndex];
+            if (_poses && !device.deskewer) {
+                device.deskewer = new LidarScanDeskewer(*_poses, _deskewOptions(device.mount));
+            }
+            return device;
+        }
+
+        sl_u64 _estimateScanSpan(DeviceContext& device, sl_u64 timestamp_uS, size_t nodeCount)
+        {
+            if (device.lastTimestamp_uS && timestamp_uS > device.lastTimestamp_uS
+                && timestamp_uS - device.lastTimestamp_uS <= _options.maxScanPeriod_uS) {
+                device.scanPeriod_uS = timestamp_uS - device.lastTimestamp_uS;
+            }
+            device.lastTimestamp_uS = timestamp_uS;
+
+            // the next scan starts one node period after the last node of this one
+            if (nodeCount < 2) return 0;
+            return device.scanPeriod_uS * (nodeCount - 1) / nodeCount;
+        }
+
+        static inline sl_u64 _nodeTimestamp(const LidarFusionScan& scan, size_t node)
+        {
+            if (scan.count < 2) return scan.timestamp_uS;
+            return scan.timestamp_uS + (sl_u64)((double)(scan.endTimestamp_uS - scan.timestamp_uS) * node / (scan.count - 1) + 0.5);
+        }
+
+        void _processTask(ScanTask& task)
+        {
+            const LidarFusionScan& scan = task.scan;
+            if (task.x.size() < scan.count) {
+                task.x.resize(scan.count);
+                task.y.resize(scan.count);
+            }
+            if (!scan.count) return;
+
+            // the device table does not grow while the tasks run
+            const DeviceContext& device = _devices[scan.deviceIndex];
+            if (device.deskewer) {
+                task.result = device.deskewer->deskew(scan.nodes, scan.count, scan.timestamp_uS, scan.endTimestamp_uS, &task.x[0], &task.y[0], _referenceTimestamp_uS);
+                return;
+            }
+
+            RigidTransform transform;
+            transform.cosYaw = cosf(device.mount.yaw);
+            transform.sinYaw = sinf(device.mount.yaw);
+            transform.x = device.mount.x;
+            transform.y = device.mount.y;
+
+            projectScanToCartesian(scan.nodes, scan.count, &task.x[0], &task.y[0]);
+            transformPoints(transform, &task.x[0], &task.y[0], scan.count);
+        }
+
+        void _processTasks()
+        {
+            for (;;) {
+                size_t pos = _nextTask++;
+                if (pos >= _taskCount) break;
+                _processTask(_tasks[pos]);
+            }
+        }
+
+        void _runTasks()
+        {
+            _nextTask = 0;
+            // a single scan is not worth waking up the workers
+            if (_taskCount < 2 || _workers.empty()) {
+                _processTasks();
+                return;
+            }
+
+            _pendingWorkers = (int)_workers.size();
+            for (size_t pos = 0; pos < _startEvts.size(); ++pos) {
+                _startEvts[pos]->set();
+            }
+
+            _processTasks();
+
+            while (_pendingWorkers.load() > 0) {
+                _doneEvt.wait(100);
+            }
+        }
+
+        bool _nextCursor(MergeCursor& cursor, size_t node)
+        {
+            const LidarFusionScan& scan = _tasks[cursor.task].scan;
+            for (; node < scan.count; ++node) {
+                if (scan.nodes[node].dist_mm_q2) {
+                    cursor.node = node;
+                    cursor.timestamp_uS = _nodeTimestamp(scan, node);
+                    return true;
+                }
+            }
+            return false;
+        }
+
+        void _merge(LidarFusedCloud& cloud)
+        {
+            size_t total = 0;
+            _cursors.clear();
+            for (size_t pos = 0; pos < _taskCount; ++pos) {
+                ScanTask& task = _tasks[pos];
+                if (IS_FAIL(task.result)) continue;
+                total += task.scan.count;
+
+                MergeCursor cursor;
+                cursor.task = pos;
+                if (_nextCursor(cursor, 0)) _cursors.push_back(cursor);
+            }
+            std::make_heap(_cursors.begin(), _cursors.end());
+
+            if (cloud.points.size() < total) cloud.points.resize(total);
+            cloud.count = 0;
+            cloud.timestamp_uS = _cursors.empty() ? 0 : _cursors.front().timestamp_uS;
+            cloud.endTimestamp_uS = cloud.timestamp_uS;
+
+            // each scan is in time order already, the scans are merged k-way
+            while (!_cursors.empty()) {
+                std::pop_heap(_cursors.begin(), _cursors.end());
+                MergeCursor& cursor = _cursors.back();
+                const ScanTask& task = _tasks[cursor.task];
+                const sl_lidar_response_measurement_node_hq_t& node = task.scan.nodes[cursor.node];
+
+                LidarFusedPoint& point = cloud.points[cloud.count++];
+                point.timestamp_uS = cursor.timestamp_uS;
+                point.x = task.x[cursor.node];
+                point.y = task.y[cursor.node];
+                point.deviceIndex = (sl_u16)task.scan.deviceIndex;
+                point.quality = node.quality;
+                point.flag = node.flag;
+                cloud.endTimestamp_uS = cursor.timestamp_uS;
+
+                if (_nextCursor(cursor, cursor.node + 1)) {
+                    std::push_heap(_cursors.begin(), _cursors.end());
+                }
+                else {
+                    _cursors.pop_back();
+                }
+            }
+        }
+
+        u_result _proc_worker()
+        {
+            int index = _nextWorkerIndex++;
+            internal::applyThreadConfig(_options.workerThreadConfig, "sl_fusion", index);
+
+            for (;;) {
+                _startEvts[index]->wait();
+                if (!_isRunning) break;
+
+                _processTasks();
+                if (--_pendingWorkers == 0) _doneEvt.set();
+            }
+            return RESULT_OK;
+        }
+
+        LidarFusionOptions      _options;
+        const LidarPoseRing*    _poses;
+        std::vector<DeviceContext> _devices;
+
+        // scans being fused, the tasks keep their buffers from one call to the next
+        std::vector<LidarFusionScan> _setScans;
+        std::vector<ScanTask>   _tasks;
+        std::vector<MergeCursor> _cursors;
+        sl_u64                  _referenceTimestamp_uS;
+        size_t                  _taskCount;
+        std::atomic<size_t>     _nextTask;
+
+        // worker threads, the calling thread takes part in the fusion as well
+        std::atomic<bool>       _isRunning;
+        std::atomic<int>        _nextWorkerIndex;
+        std::atomic<int>        _pendingWorkers;
+        std::vector<rp::hal::Thread> _workers;
+        std::vector<rp::hal::Event*> _startEvts;
+        rp::hal::Event          _doneEvt;
+    };
+
+    Result<ILidarScanFusion*> createLidarScanFusion(const LidarFusionOptions& options, const LidarPoseRing* poses)
+    {
+        return new LidarScanFusion(options, poses);
+    }
+
+}
@@ -0,0 +1,321 @@
+/*
+ *  Slamtec LIDAR SDK
+ *
+ *  Copyright (c) 2014 - 2023 Shanghai Slamtec Co., Ltd.
+ *  http://www.slamtec.com
+ *
+ */
+ /*
+  * Redistribution and use in source and binary forms, with or without
+  * modification, are permitted provided that the following conditions are met:
+  *
+  * 1. Redistributions of source code must retain the above copyright notice,
+  *    this list of conditions and the following disclaimer.
+  *
+  * 2. Redistributions in binary form must reproduce the above copyright notice,
+  *    this list of conditions and the following disclaimer in the documentation
+  *    and/or other materials provided with the distribution.
+  *
+  * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+  * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+  * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+  * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+  * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+  * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+  * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+  * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+  * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+  * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+  * EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+  *
+  */
+
+#include "sdkcommon.h"
+#include "sl_lidar_driver.h"
+#include "sl_lidar_lines.h"
+#include "sl_lidar_projection.h"
+
+#include <math.h>
+#include <algorithm>
+
+namespace sl {
+
+    LidarLineExtractor::LidarLineExtractor(const LidarLineExtractorOptions& options)
+        : _options(options)
+    {
+    }
+
+    size_t LidarLineExtractor::extract(const float* x, const float* y, size_t count, std::vector<LidarLineSegment>& segments)
+    {
+        segments.clear();
+        if (!x || !y) return 0;
+
+        _collectPoints(x, y, count);
+        size_t pointCount = _order.size();
+        if (pointCount < std::max<size_t>(_options.minPointCount, 2)) return 0;
+
+        _computeSums();
+
+        // split-and-merge every run between two breakpoints
+        _lines.clear();
+        size_t first = 0;
+        for (size_t pos = 1; pos <= pointCount; ++pos) {
+            if (pos == pointCount || _breaks[pos]) {
+                size_t firstLine = _lines.size();
+                _splitRun(first, pos - 1);
+                _mergeLines(firstLine);
+                first = pos;
+            }
+        }
+
+        _emitSegments(segments);
+        return segments.size();
+    }
+
+    size_t LidarLineExtractor::extract(const sl_lidar_response_measurement_node_hq_t* nodes, size_t count, std::vector<LidarLineSegment>& segments)
+    {
+        segments.clear();
+        if (!nodes) return 0;
+
+        if (_nodeX.size() < count + 1) {
+            _nodeX.resize(count + 1);
+            _nodeY.resize(count + 1);
+        }
+        projectScanToCartesian(nodes, count, &_nodeX[0], &_nodeY[0]);
+        return extract(&_nodeX[0], &_nodeY[0], count, segments);
+    }
+
+    void LidarLineExtractor::_collectPoints(const float* x, const float* y, size_t count)
+    {
+        _order.clear();
+        for (size_t pos = 0; pos < count; ++pos) {
+            if (x[pos] != 0 || y[pos] != 0) _order.push_back((sl_u32)pos);
+        }
+
+        size_t pointCount = _order.size();
+        _breaks.assign(pointCount, 0);
+        if (!pointCount) return;
+
+        // adaptive breakpoint detection (Borges & Aldon): the farthest a point can be from the previous one on a surface seen
+        // under breakpointAngle, the runs wrap around the end of the scan
+        float sinBreakpoint = sinf(_options.breakpointAngle);
+        float cosBreakpoint = cosf(_options.breakpointAngle);
+        float noise = 3 * _options.rangeSigma;
+        size_t firstBreak = pointCount;
+
+        for (size_t pos = 0; pos < pointCount; ++pos) {
+            size_t previous = _order[pos ? pos - 1 : pointCount - 1];
+            size_t current = _order[pos];
+
+            float dot = x[previous] * x[current] + y[previous] * y[current];
+            float cross = fabsf(x[previous] * y[current] - y[previous] * x[current]);
+            float previousRange = sqrtf(x[previous] * x[previous] + y[previous] * y[previous]);
+            float currentRange = sqrtf(x[current] * x[current] + y[current] * y[current]);
+            float rangeProduct = previousRange * currentRange;
+
+            // sin and cos of the angle between the two points
+            float sinStep = rangeProduct > 0 ? cross / rangeProduct : 0;
+            float cosStep = rangeProduct > 0 ? dot / rangeProduct : 1;
+
+            bool isBreak;
+            // sin(breakpointAngle - step), positive while the step is below breakpointAngle
+            float sinMargin = sinBreakpoint * cosStep - cosBreakpoint * sinStep;
+            if (pointCount == 1 || !(sinMargin > 0) || dot <= 0) {
+                isBreak = true;
+            }
+            else {
+                float maxDistance = previousRange * sinStep / sinMargin + noise;
+                float dx = x[current] - x[previous], dy = y[current] - y[previous];
+                isBreak = dx * dx + dy * dy > maxDistance * maxDistance;
+            }
+
+            _breaks[pos] = isBreak ? 1 : 0;
+            if (isBreak && firstBreak == pointCount) firstBreak = pos;
+        }
+
+        // a closed contour without any break is taken from the first point
+        if (firstBreak == pointCount) {
+            firstBreak = 0;
+            _breaks[0] = 1;
+        }
+        std::rotate(_order.begin(), _order.begin() + firstBreak, _order.end());
+        std::rotate(_breaks.begin(), _breaks.begin() + firstBreak, _breaks.end());
+
+        _px.resize(pointCount);
+        _py.resize(pointCount);
+        for (size_t pos = 0; pos < pointCount; ++pos) {
+            _px[pos] = x[_order[pos]];
+            _py[pos] = y[_order[pos]];
+        }
+    }
+
+    void LidarLineExtractor::_computeSums()
+    {
+        size_t pointCount = _px.size();
+        _sumX.resize(pointCount + 1);
+        _sumY.resize(pointCount + 1);
+        _sumXX.resize(pointCount + 1);
+        _sumXY.resize(pointCount + 1);
+        _sumYY.resize(pointCount + 1);
+
+        double sumX = 0, sumY = 0, sumXX = 0, sumXY = 0, sumYY = 0;
+        for (size_t pos = 0; pos < pointCount; ++pos) {
+            _sumX[pos] = sumX; _sumY[pos] = sumY;
+            _sumXX[pos] = sumXX; _sumXY[pos] = sumXY; _sumYY[pos] = sumYY;
+
+            double x = _px[pos], y = _py[pos];
+            sumX += x; sumY += y;
+            sumXX += x * x; sumXY += x * y; sumYY += y * y;
+        }
+        _sumX[pointCount] = sumX; _sumY[pointCount] = sumY;
+        _sumXX[pointCount] = sumXX; _sumXY[pointCount] = sumXY; _sumYY[pointCount] = sumYY;
+    }
+
+    // total least squares line of the points first..last
+    void LidarLineExtractor::_fit(size_t first, size_t last, Fit& fit) const
+    {
+        double count = (double)(last - first + 1);
+        fit.centerX = (_sumX[last + 1] - _sumX[first]) / count;
+        fit.centerY = (_sumY[last + 1] - _sumY[first]) / count;
+        double covXX = (_sumXX[last + 1] - _sumXX[first]) / count - fit.centerX * fit.centerX;
+        double covXY = (_sumXY[last + 1] - _sumXY[first]) / count - fit.centerX * fit.centerY;
+        double covYY = (_sumYY[last + 1] - _sumYY[first]) / count - fit.centerY * fit.centerY;
+
+        double direction = 0.5 * atan2(2 * covXY, covXX - covYY);
+        fit.normalX = -sin(direction);
+        fit.normalY = cos(direction);
+        fit.distance = fit.normalX * fit.centerX + fit.normalY * fit.centerY;
+
+        // the smallest eigenvalue of the covariance
+        double halfGap = sqrt((covXX - covYY) * (covXX - covYY) * 0.25 + covXY * covXY);
+        fit.meanSquaredError = std::max((covXX + covYY) * 0.5 - halfGap, 0.0);
+    }
+
+    size_t LidarLineExtractor::_farthestPoint(size_t first, size_t last, const Fit& fit, double& distance) const
+    {
+        size_t farthest = first;
+        distance = 0;
+        for (size_t pos = first; pos <= last; ++pos) {
+            double offset = fabs(fit.normalX * _px[pos] + fit.normalY * _py[pos] - fit.distance);
+            if (offset > distance) {
+                distance = offset;
+                farthest = pos;
+            }
+        }
+        return farthest;
+    }
+
+    // the farthest point from the chord joining the ends, i.e. the corner of the run
+    size_t LidarLineExtractor::_chordFarthestPoint(size_t first, size_t last) const
+    {
+        float chordX = _px[last] - _px[first], chordY = _py[last] - _py[first];
+        size_t farthest = (first + last) / 2;
+        float best = 0;
+        for (size_t pos = first + 1; pos < last; ++pos) {
+            float offset = fabsf(chordX * (_py[pos] - _py[first]) - chordY * (_px[pos] - _px[first]));
+            if (offset > best) {
+                best = offset;
+                farthest = pos;
+            }
+        }
+        return farthest;
+    }
+
+    void LidarLineExtractor::_splitRun(size_t first, size_t last)
+    {
+        _stack.clear();
+        Range run = { first, last };
+        _stack.push_back(run);
+
+        // depth first, the left part first so that the lines come out in the scan order
+        while (!_stack.empty()) {
+            Range range = _stack.back();
+            _stack.pop_back();
+
+            size_t count = range.last - range.first + 1;
+            if (count >= 3 && count >= _options.minPointCount) {
+                Fit fit;
+                double distance;
+                _fit(range.first, range.last, fit);
+                _farthestPoint(range.first, range.last, fit, distance);
+
+                if (distance > _options.splitDistance) {
+                    size_t corner = _chordFarthestPoint(range.first, range.last);
+                    Range left = { range.first, corner };
+                    Range right = { corner + 1, range.last };
+                    _stack.push_back(right);
+                    _stack.push_back(left);
+                    continue;
+                }
+            }
+            _lines.push_back(range);
+        }
+    }
+
+    // merge the consecutive lines of a run as long as the merged line stays within splitDistance of its points
+    void LidarLineExtractor::_mergeLines(size_t firstLine)
+    {
+        if (_lines.size() - firstLine < 2) return;
+
+        size_t kept = firstLine;
+        for (size_t pos = firstLine + 1; pos < _lines.size(); ++pos) {
+            Range& current = _lines[kept];
+            const Range& next = _lines[pos];
+
+            Fit fit;
+            double distance;
+            _fit(current.first, next.last, fit);
+            _farthestPoint(current.first, next.last, fit, distance);
+
+            if (distance <= _options.splitDistance) {
+                current.last = next.last;
+            }
+            else {
+                _lines[++kept] = next;
+            }
+        }
+        _lines.resize(kept + 1);
+    }
+
+    void LidarLineExtractor::_emitSegments(std::vector<LidarLineSegment>& segments)
+    {
+        double minLength2 = (double)_options.minLength * _options.minLength;
+
+        for (size_t pos = 0; pos < _lines.size(); ++pos) {
+            const Range& line = _lines[pos];
+            size_t count = line.last - line.first + 1;
+            if (count < _options.minPointCount || count < 2) continue;
+
+            Fit fit;
+            _fit(line.first, line.last, fit);
+            if (fit.distance < 0) {
+                fit.normalX = -fit.normalX;
+                fit.normalY = -fit.normalY;
+                fit.distance = -fit.distance;
+            }
+
+            // the end points on the line
+            double startOffset = fit.normalX * _px[line.first] + fit.normalY * _py[line.first] - fit.distance;
+            double endOffset = fit.normalX * _px[line.last] + fit.normalY * _py[line.last] - fit.distance;
+            double startX = _px[line.first] - fit.normalX * startOffset, startY = _py[line.first] - fit.normalY * startOffset;
+            double endX = _px[line.last] - fit.normalX * endOffset, endY = _py[line.last] - fit.normalY * endOffset;
+
+            double length2 = (endX - startX) * (endX - startX) + (endY - startY) * (endY - startY);
+            if (length2 < minLength2) continue;
+
+            LidarLineSegment segment;
+            segment.startX = (float)startX;
+            segment.startY = (float)startY;
+            segment.endX = (float)endX;
+            segment.endY = (float)endY;
+            segment.normalAngle = (float)atan2(fit.normalY, fit.normalX);
+            segment.distance = (float)fit.distance;
+            segment.rmsError = (float)sqrt(fit.meanSquaredError);
+            segment.firstIndex = _order[line.first];
+            segment.lastIndex = _order[line.last];
+            segment.pointCount = (sl_u32)count;
+            segments.push_back(segment);
+        }
+    }
+
+}
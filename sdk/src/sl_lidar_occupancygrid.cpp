@@ -0,0 +1,496 @@
+/*
+ *  Slamtec LIDAR SDK
+ *
+ *  Copyright (c) 2014 - 2023 Shanghai Slamtec Co., Ltd.
+ *  http://www.slamtec.com
+ *
+ */
+ /*
+  * Redistribution and use in source and binary forms, with or without
+  * modification, are permitted provided that the following conditions are met:
+  *
+  * 1. Redistributions of source code must retain the above copyright notice,
+  *    this list of conditions and the following disclaimer.
+  *
+  * 2. Redistributions in binary form must reproduce the above copyright notice,
+  *    this list of conditions and the following disclaimer in the documentation
+  *    and/or other materials provided with the distribution.
+  *
+  * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+  * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+  * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+  * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+  * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+  * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+  * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+  * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+  * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+  * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+  * EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+  *
+  */
+
+#include "sdkcommon.h"
+#include "hal/thread.h"
+#include "hal/types.h"
+#include "hal/event.h"
+#include "hal/locker.h"
+#include "sl_lidar_driver.h"
+#include "sl_lidar_occupancygrid.h"
+#include "sl_lidar_projection.h"
+#include "sl_thread_config.h"
+
+#include <math.h>
+#include <vector>
+#include <atomic>
+#include <algorithm>
+
+namespace sl {
+
+    enum {
+        // log-odds are stored as fixed point numbers with 10 fraction bits
+        LOGODDS_FRACTION_BITS = 10,
+        LOGODDS_LIMIT = 31 << LOGODDS_FRACTION_BITS,
+
+        // probability lookup, indexed by the high bits of the fixed point log-odds
+        PROBABILITY_LUT_SHIFT = 6,
+        PROBABILITY_LUT_SIZE = 65536 >> PROBABILITY_LUT_SHIFT,
+
+        // the rays are handed to the workers by chunks
+        RAY_CHUNK_SIZE = 128,
+
+        MARK_MISS = 0x1,
+        MARK_HIT = 0x2,
+    };
+
+    static inline sl_s16 toFixedLogOdds(float value)
+    {
+        float fixed = value * (1 << LOGODDS_FRACTION_BITS);
+        fixed = std::min(std::max(fixed, (float)-LOGODDS_LIMIT), (float)LOGODDS_LIMIT);
+        return (sl_s16)(fixed < 0 ? fixed - 0.5f : fixed + 0.5f);
+    }
+
+    // clip the segment (x0, y0) - (x1, y1) to [0, width) x [0, height) (Liang-Barsky), false if it is outside
+    static bool clipSegment(float& x0, float& y0, float& x1, float& y1, float width, float height, bool& endClipped)
+    {
+        float dx = x1 - x0, dy = y1 - y0;
+        float enter = 0, leave = 1;
+        float p[4] = { -dx, dx, -dy, dy };
+        float q[4] = { x0, width - x0, y0, height - y0 };
+
+        for (int side = 0; side < 4; ++side) {
+            if (p[side] == 0) {
+                if (q[side] < 0) return false;
+                continue;
+            }
+            float t = q[side] / p[side];
+            if (p[side] < 0) {
+                if (t > enter) enter = t;
+            }
+            else {
+                if (t < leave) leave = t;
+            }
+        }
+        if (enter > leave) return false;
+
+        endClipped = leave < 1;
+        x1 = x0 + dx * leave;
+        y1 = y0 + dy * leave;
+        x0 += dx * enter;
+        y0 += dy * enter;
+        return true;
+    }
+
+    class LidarOccupancyGrid : public ILidarOccupancyGrid
+    {
+    public:
+        LidarOccupancyGrid(const LidarOccupancyGridOptions& options)
+            : _options(options)
+            , _integrateLocker(true)
+            , _rayX(NULL)
+            , _rayY(NULL)
+            , _rayCount(0)
+            , _nextRayChunk(0)
+            , _phase(PHASE_CAST)
+            , _isRunning(true)
+            , _nextWorkerIndex(0)
+            , _pendingWorkers(0)
+            , _doneEvt(true, false)
+        {
+            if (!(_options.resolution > 0)) _options.resolution = 50;
+            if (_options.threadCount < 1) _options.threadCount = 1;
+
+            _tileColumns = std::max<size_t>((_options.width + TILE_SIZE - 1) >> TILE_SHIFT, 1);
+            _tileRows = std::max<size_t>((_options.height + TILE_SIZE - 1) >> TILE_SHIFT, 1);
+            _width = _tileColumns << TILE_SHIFT;
+            _height = _tileRows << TILE_SHIFT;
+            if (_options.centered) {
+                _options.originX = -(float)_width * _options.resolution * 0.5f;
+                _options.originY = -(float)_height * _options.resolution * 0.5f;
+            }
+
+            _hit = toFixedLogOdds(_options.logOddsHit);
+            _miss = toFixedLogOdds(_options.logOddsMiss);
+            _min = toFixedLogOdds(std::min(_options.logOddsMin, 0.f));
+            _max = toFixedLogOdds(std::max(_options.logOddsMax, 0.f));
+
+            for (size_t pos = 0; pos < PROBABILITY_LUT_SIZE; ++pos) {
+                float logOdds = ((float)((int)(pos << PROBABILITY_LUT_SHIFT) - 32768) + (1 << (PROBABILITY_LUT_SHIFT - 1))) / (1 << LOGODDS_FRACTION_BITS);
+                float probability = 1.f - 1.f / (1.f + expf(logOdds));
+                _probabilityLUT[pos] = (sl_u8)std::min(probability * 256.f, 255.f);
+            }
+            // so that the unknown cells map to 128 exactly
+            _probabilityLUT[32768 >> PROBABILITY_LUT_SHIFT] = 128;
+
+            size_t cellCount = _width * _height;
+            _cells.assign(cellCount, 0);
+            _marks = new std::atomic<sl_u8>[cellCount];
+            for (size_t pos = 0; pos < cellCount; ++pos) _marks[pos].store(0, std::memory_order_relaxed);
+
+            size_t tileCount = _tileColumns * _tileRows;
+            _tileTouched = new std::atomic<sl_u8>[tileCount];
+            for (size_t pos = 0; pos < tileCount; ++pos) _tileTouched[pos].store(0, std::memory_order_relaxed);
+            _tileDirty.assign(tileCount, 0);
+
+            _scratches.resize(_options.threadCount);
+            for (size_t pos = 1; pos < _options.threadCount; ++pos) {
+                _startEvts.push_back(new rp::hal::Event(true, false));
+            }
+            for (size_t pos = 1; pos < _options.threadCount; ++pos) {
+                _workers.push_back(CLASS_THREAD(LidarOccupancyGrid, _proc_worker));
+            }
+        }
+
+        virtual ~LidarOccupancyGrid()
+        {
+            _isRunning = false;
+            for (size_t pos = 0; pos < _startEvts.size(); ++pos) {
+                _startEvts[pos]->set();
+            }
+            for (size_t pos = 0; pos < _workers.size(); ++pos) {
+                _workers[pos].join();
+            }
+            for (size_t pos = 0; pos < _startEvts.size(); ++pos) {
+                delete _startEvts[pos];
+            }
+            delete[] _marks;
+            delete[] _tileTouched;
+        }
+
+        sl_result integrate(const float* x, const float* y, size_t count, const LidarPose2D& pose)
+        {
+            if ((!x || !y) && count) return SL_RESULT_INVALID_DATA;
+
+            rp::hal::AutoLocker l(_integrateLocker);
+            _rayX = x;
+            _rayY = y;
+            _rayCount = count;
+            _pose = pose;
+
+            // walk the rays and mark the cells, the grid itself is left untouched
+            _nextRayChunk = 0;
+            _runTasks(PHASE_CAST);
+
+            // each worker updates the cells it has been the first to mark
+            {
+                rp::hal::AutoLocker gridLock(_locker);
+                _runTasks(PHASE_APPLY);
+
+                for (size_t worker = 0; worker < _scratches.size(); ++worker) {
+                    std::vector<sl_u32>& tiles = _scratches[worker].tiles;
+                    for (size_t pos = 0; pos < tiles.size(); ++pos) {
+                        _tileTouched[tiles[pos]].store(0, std::memory_order_relaxed);
+                        _markDirty_locked(tiles[pos]);
+                    }
+                    tiles.clear();
+                }
+            }
+            return SL_RESULT_OK;
+        }
+
+        sl_result integrate(const sl_lidar_response_measurement_node_hq_t* nodes, size_t count, const LidarPose2D& pose)
+        {
+            if (!nodes && count) return SL_RESULT_INVALID_DATA;
+
+            rp::hal::AutoLocker l(_integrateLocker);
+            if (_nodeX.size() < count + 1) {
+                _nodeX.resize(count + 1);
+                _nodeY.resize(count + 1);
+            }
+            projectScanToCartesian(nodes, count, &_nodeX[0], &_nodeY[0]);
+            return integrate(&_nodeX[0], &_nodeY[0], count, pose);
+        }
+
+        void clear()
+        {
+            rp::hal::AutoLocker l(_locker);
+            std::fill(_cells.begin(), _cells.end(), 0);
+            for (size_t tile = 0; tile < _tileDirty.size(); ++tile) {
+                _markDirty_locked(tile);
+            }
+        }
+
+        size_t getWidth() const { return _width; }
+        size_t getHeight() const { return _height; }
+        size_t getTileColumns() const { return _tileColumns; }
+        size_t getTileRows() const { return _tileRows; }
+        float getResolution() const { return _options.resolution; }
+        float getOriginX() const { return _options.originX; }
+        float getOriginY() const { return _options.originY; }
+
+        float getProbability(float x, float y)
+        {
+            float col = floorf((x - _options.originX) / _options.resolution);
+            float row = floorf((y - _options.originY) / _options.resolution);
+            if (!(col >= 0 && row >= 0 && col < (float)_width && row < (float)_height)) return 0.5f;
+
+            rp::hal::AutoLocker l(_locker);
+            float logOdds = (float)_cells[_cellIndex((size_t)col, (size_t)row)] / (1 << LOGODDS_FRACTION_BITS);
+            return 1.f - 1.f / (1.f + expf(logOdds));
+        }
+
+        size_t fetchDirtyTiles(std::vector<size_t>& tiles)
+        {
+            rp::hal::AutoLocker l(_locker);
+            size_t count = _dirtyTiles.size();
+            for (size_t pos = 0; pos < count; ++pos) {
+                tiles.push_back(_dirtyTiles[pos]);
+                _tileDirty[_dirtyTiles[pos]] = 0;
+            }
+            _dirtyTiles.clear();
+            return count;
+        }
+
+        sl_result copyTile(size_t tile, sl_u8* dest, size_t stride)
+        {
+            if (!dest || stride < TILE_SIZE) return SL_RESULT_INVALID_DATA;
+            if (tile >= _tileDirty.size()) return SL_RESULT_INVALID_DATA;
+
+            rp::hal::AutoLocker l(_locker);
+            const sl_s16* source = &_cells[tile << (TILE_SHIFT * 2)];
+            for (size_t row = 0; row < TILE_SIZE; ++row, dest += stride, source += TILE_SIZE) {
+                for (size_t col = 0; col < TILE_SIZE; ++col) {
+                    dest[col] = _probabilityLUT[(sl_u16)(source[col] + 32768) >> PROBABILITY_LUT_SHIFT];
+                }
+            }
+            return SL_RESULT_OK;
+        }
+
+        sl_result copyTileLogOdds(size_t tile, float* dest, size_t stride)
+        {
+            if (!dest || stride < TILE_SIZE) return SL_RESULT_INVALID_DATA;
+            if (tile >= _tileDirty.size()) return SL_RESULT_INVALID_DATA;
+
+            rp::hal::AutoLocker l(_locker);
+            const sl_s16* source = &_cells[tile << (TILE_SHIFT * 2)];
+            const float scale = 1.f / (1 << LOGODDS_FRACTION_BITS);
+            for (size_t row = 0; row < TILE_SIZE; ++row, dest += stride, source += TILE_SIZE) {
+                for (size_t col = 0; col < TILE_SIZE; ++col) {
+                    dest[col] = source[col] * scale;
+                }
+            }
+            return SL_RESULT_OK;
+        }
+
+    protected:
+        enum TaskPhase {
+            PHASE_CAST,
+            PHASE_APPLY,
+        };
+
+        // per thread state of a scan integration
+        struct WorkerScratch
+        {
+            std::vector<sl_u32> cells;      // cells first marked by this worker
+            std::vector<sl_u32> tiles;      // tiles first touched by this worker
+        };
+
+        // the cells of a tile are contiguous, row by row
+        inline size_t _cellIndex(size_t col, size_t row) const
+        {
+            size_t tile = (row >> TILE_SHIFT) * _tileColumns + (col >> TILE_SHIFT);
+            return (tile << (TILE_SHIFT * 2)) | ((row & (TILE_SIZE - 1)) << TILE_SHIFT) | (col & (TILE_SIZE - 1));
+        }
+
+        inline void _mark(WorkerScratch& scratch, size_t cell, sl_u8 mark)
+        {
+            std::atomic<sl_u8>& slot = _marks[cell];
+            // the cells near the LIDAR are crossed by most of the rays, skip the atomic operation when possible
+            if ((slot.load(std::memory_order_relaxed) & mark) == mark) return;
+            if (!slot.fetch_or(mark, std::memory_order_relaxed)) {
+                scratch.cells.push_back((sl_u32)cell);
+            }
+        }
+
+        void _castRay(WorkerScratch& scratch, float startX, float startY, float endX, float endY, bool hit)
+        {
+            bool endClipped = false;
+            if (!clipSegment(startX, startY, endX, endY, (float)_width, (float)_height, endClipped)) return;
+            if (endClipped) hit = false;
+
+            int col = std::min((int)startX, (int)_width - 1), row = std::min((int)startY, (int)_height - 1);
+            int endCol = std::min((int)endX, (int)_width - 1), endRow = std::min((int)endY, (int)_height - 1);
+
+            int deltaCol = abs(endCol - col), deltaRow = -abs(endRow - row);
+            int stepCol = col < endCol ? 1 : -1, stepRow = row < endRow ? 1 : -1;
+            int error = deltaCol + deltaRow;
+
+            while (col != endCol || row != endRow) {
+                _mark(scratch, _cellIndex(col, row), MARK_MISS);
+                int error2 = error * 2;
+                if (error2 >= deltaRow) {
+                    error += deltaRow;
+                    col += stepCol;
+                }
+                if (error2 <= deltaCol) {
+                    error += deltaCol;
+                    row += stepRow;
+                }
+            }
+            _mark(scratch, _cellIndex(col, row), hit ? MARK_HIT : MARK_MISS);
+        }
+
+        void _castTask(WorkerScratch& scratch)
+        {
+            float cosYaw = cosf(_pose.yaw), sinYaw = sinf(_pose.yaw);
+            float scale = 1.f / _options.resolution;
+            float originX = (_pose.x - _options.originX) * scale;
+            float originY = (_pose.y - _options.originY) * scale;
+            float maxRange2 = _options.maxRange * _options.maxRange;
+
+            for (;;) {
+                size_t first = _nextRayChunk.fetch_add(RAY_CHUNK_SIZE);
+                if (first >= _rayCount) break;
+                size_t last = std::min(first + RAY_CHUNK_SIZE, _rayCount);
+
+                for (size_t pos = first; pos < last; ++pos) {
+                    float x = _rayX[pos], y = _rayY[pos];
+                    float range2 = x * x + y * y;
+                    if (!(range2 > 0)) continue;
+
+                    bool hit = true;
+                    if (maxRange2 > 0 && range2 > maxRange2) {
+                        float shrink = _options.maxRange / sqrtf(range2);
+                        x *= shrink;
+                        y *= shrink;
+                        hit = false;
+                    }
+
+                    float endX = originX + (cosYaw * x - sinYaw * y) * scale;
+                    float endY = originY + (sinYaw * x + cosYaw * y) * scale;
+                    _castRay(scratch, originX, originY, endX, endY, hit);
+                }
+            }
+        }
+
+        void _applyTask(WorkerScratch& scratch)
+        {
+            for (size_t pos = 0; pos < scratch.cells.size(); ++pos) {
+                sl_u32 cell = scratch.cells[pos];
+                sl_u8 mark = _marks[cell].exchange(0, std::memory_order_relaxed);
+
+                int value = _cells[cell] + ((mark & MARK_HIT) ? _hit : _miss);
+                _cells[cell] = (sl_s16)std::min(std::max(value, (int)_min), (int)_max);
+
+                sl_u32 tile = cell >> (TILE_SHIFT * 2);
+                if (!_tileTouched[tile].load(std::memory_order_relaxed) && !_tileTouched[tile].exchange(1, std::memory_order_relaxed)) {
+                    scratch.tiles.push_back(tile);
+                }
+            }
+            scratch.cells.clear();
+        }
+
+        void _runTask(size_t scratchIndex)
+        {
+            if (_phase == PHASE_CAST) {
+                _castTask(_scratches[scratchIndex]);
+            }
+            else {
+                _applyTask(_scratches[scratchIndex]);
+            }
+        }
+
+        void _runTasks(TaskPhase phase)
+        {
+            _phase = phase;
+            _pendingWorkers = (int)_workers.size();
+            for (size_t pos = 0; pos < _startEvts.size(); ++pos) {
+                _startEvts[pos]->set();
+            }
+
+            _runTask(0);
+
+            while (_pendingWorkers.load() > 0) {
+                _doneEvt.wait(100);
+            }
+        }
+
+        u_result _proc_worker()
+        {
+            int index = _nextWorkerIndex++;
+            internal::applyThreadConfig(_options.workerThreadConfig, "sl_occgrid", index);
+
+            for (;;) {
+                _startEvts[index]->wait();
+                if (!_isRunning) break;
+
+                _runTask(index + 1);
+                if (--_pendingWorkers == 0) _doneEvt.set();
+            }
+            return RESULT_OK;
+        }
+
+        void _markDirty_locked(size_t tile)
+        {
+            if (_tileDirty[tile]) return;
+            _tileDirty[tile] = 1;
+            _dirtyTiles.push_back(tile);
+        }
+
+        LidarOccupancyGridOptions _options;
+        size_t                  _width;
+        size_t                  _height;
+        size_t                  _tileColumns;
+        size_t                  _tileRows;
+
+        sl_s16                  _hit;
+        sl_s16                  _miss;
+        sl_s16                  _min;
+        sl_s16                  _max;
+        sl_u8                   _probabilityLUT[PROBABILITY_LUT_SIZE];
+
+        // the cells and the dirty tiles, guarded by _locker
+        rp::hal::Locker         _locker;
+        std::vector<sl_s16>     _cells;
+        std::vector<sl_u8>      _tileDirty;
+        std::vector<size_t>     _dirtyTiles;
+
+        // scan being integrated, guarded by _integrateLocker (recursive, the nodes are projected first)
+        rp::hal::Locker         _integrateLocker;
+        std::atomic<sl_u8>*     _marks;
+        std::atomic<sl_u8>*     _tileTouched;
+        const float*            _rayX;
+        const float*            _rayY;
+        size_t                  _rayCount;
+        LidarPose2D             _pose;
+        std::vector<float>      _nodeX;
+        std::vector<float>      _nodeY;
+        std::atomic<size_t>     _nextRayChunk;
+        TaskPhase               _phase;
+        std::vector<WorkerScratch> _scratches;
+
+        // worker threads, the calling thread takes part in the integration as well
+        std::atomic<bool>       _isRunning;
+        std::atomic<int>        _nextWorkerIndex;
+        std::atomic<int>        _pendingWorkers;
+        std::vector<rp::hal::Thread> _workers;
+        std::vector<rp::hal::Event*> _startEvts;
+        rp::hal::Event          _doneEvt;
+    };
+
+    Result<ILidarOccupancyGrid*> createLidarOccupancyGrid(const LidarOccupancyGridOptions& options)
+    {
+        return new LidarOccupancyGrid(options);
+    }
+
+}
@@ -0,0 +1,475 @@
+/*
+ *  Slamtec LIDAR SDK
+ *
+ *  Copyright (c) 2014 - 2023 Shanghai Slamtec Co., Ltd.
+ *  http://www.slamtec.com
+ *
+ */
+ /*
+  * Redistribution and use in source and binary forms, with or without
+  * modification, are permitted provided that the following conditions are met:
+  *
+  * 1. Redistributions of source code must retain the above copyright notice,
+  *    this list of conditions and the following disclaimer.
+  *
+  * 2. Redistributions in binary form must reproduce the above copyright notice,
+  *    this list of conditions and the following disclaimer in the documentation
+  *    and/or other materials provided with the distribution.
+  *
+  * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+  * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+  * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+  * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+  * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+  * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+  * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+  * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+  * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+  * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+  * EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+  *
+  */
+
+#include "sdkcommon.h"
+#include "hal/thread.h"
+#include "hal/types.h"
+#include "sl_lidar_driver.h"
+#include "sl_lidar_record.h"
+#include "sl_lidar_offline.h"
+#include "sl_mapped_file.h"
+
+#include <stdlib.h>
+#include <vector>
+#include <algorithm>
+#include <atomic>
+#include <thread>
+
+namespace sl {
+
+    namespace {
+
+        enum {
+            // scans of a recording claimed by a worker at a time
+            RECORD_BLOCK_SCANS = 64,
+
+            // bytes of a CSV log claimed by a worker at a time, cut at the next scan
+            CSV_CHUNK_SIZE = 1024 * 1024,
+
+            // longer numbers go to strtod
+            MAX_FAST_DIGITS = 18,
+        };
+
+        const double s_pow10[] = {
+            1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9,
+            1e10, 1e11, 1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18,
+        };
+
+        bool isDigit(char c)
+        {
+            return c >= '0' && c <= '9';
+        }
+
+        // same contract as std::from_chars (C++17): p moves past the number, no locale, no allocation, no terminator needed
+        bool parseInteger(const char*& p, const char* end, sl_s64& value)
+        {
+            const char* pos = p;
+            bool negative = false;
+            if (pos != end && (*pos == '-' || *pos == '+')) negative = (*pos++ == '-');
+
+            const char* digits = pos;
+            sl_u64 mantissa = 0;
+            while (pos != end && isDigit(*pos) && pos - digits < MAX_FAST_DIGITS) mantissa = mantissa * 10 + (sl_u64)(*pos++ - '0');
+            if (pos == digits || (pos != end && isDigit(*pos))) return false;
+
+            value = negative ? -(sl_s64)mantissa : (sl_s64)mantissa;
+            p = pos;
+            return true;
+        }
+
+        bool parseFloat(const char*& p, const char* end, double& value)
+        {
+            const char* pos = p;
+            bool negative = false;
+            if (pos != end && (*pos == '-' || *pos == '+')) negative = (*pos++ == '-');
+
+            sl_u64 mantissa = 0;
+            int digitCount = 0;
+            int fractionDigits = 0;
+            while (pos != end && isDigit(*pos)) {
+                mantissa = mantissa * 10 + (sl_u64)(*pos++ - '0');
+                ++digitCount;
+            }
+            if (pos != end && *pos == '.') {
+                ++pos;
+                while (pos != end && isDigit(*pos)) {
+                    mantissa = mantissa * 10 + (sl_u64)(*pos++ - '0');
+                    ++digitCount;
+                    ++fractionDigits;
+                }
+            }
+
+            if (digitCount && digitCount <= MAX_FAST_DIGITS && (pos == end || (*pos != 'e' && *pos != 'E'))) {
+                // exact for the fixed-point values written by data_logger
+                double result = (double)mantissa / s_pow10[fractionDigits];
+                value = negative ? -result : result;
+                p = pos;
+                return true;
+            }
+
+            // exponents, long digit runs, inf and nan
+            char buffer[64];
+            size_t length = 0;
+            for (pos = p; pos != end && length < sizeof(buffer) - 1 && *pos != ',' && *pos != '\n' && *pos != '\r'; ++pos) {
+                buffer[length++] = *pos;
+            }
+            buffer[length] = '\0';
+
+            char* parsedEnd = NULL;
+            value = strtod(buffer, &parsedEnd);
+            if (parsedEnd == buffer) return false;
+            p += parsedEnd - buffer;
+            return true;
+        }
+
+        bool skipChar(const char*& p, const char* end, char c)
+        {
+            if (p == end || *p != c) return false;
+            ++p;
+            return true;
+        }
+
+        const char* nextLine(const char* p, const char* end)
+        {
+            const char* eol = (const char*)memchr(p, '\n', end - p);
+            return eol ? eol + 1 : end;
+        }
+
+        struct CsvSample
+        {
+            sl_s64  timestamp;
+            double  angle;
+            double  distance;
+            sl_s64  quality;
+            sl_s64  scanNumber;
+        };
+
+        // timestamp,angle,distance,quality,scan_number
+        bool parseCsvLine(const char* p, const char* end, CsvSample& sample)
+        {
+            if (!parseInteger(p, end, sample.timestamp) || !skipChar(p, end, ',')) return false;
+            if (!parseFloat(p, end, sample.angle) || !skipChar(p, end, ',')) return false;
+            if (!parseFloat(p, end, sample.distance) || !skipChar(p, end, ',')) return false;
+            if (!parseInteger(p, end, sample.quality) || !skipChar(p, end, ',')) return false;
+            if (!parseInteger(p, end, sample.scanNumber)) return false;
+
+            skipChar(p, end, '\r');
+            return p == end || *p == '\n';
+        }
+
+        bool parseScanNumber(const char* line, const char* end, sl_s64& scanNumber)
+        {
+            CsvSample sample;
+            if (!parseCsvLine(line, end, sample)) return false;
+            scanNumber = sample.scanNumber;
+            return true;
+        }
+
+        // the first line of a chunk starting at or after offset, which does not belong to the same scan as the line before it
+        const char* findScanStart(const char* offset, const char* end)
+        {
+            // the line holding offset belongs to the previous chunk
+            const char* line = nextLine(offset - 1, end);
+            sl_s64 scanNumber = 0;
+            bool known = false;
+            while (line != end) {
+                sl_s64 lineScanNumber;
+                if (parseScanNumber(line, end, lineScanNumber)) {
+                    if (known && lineScanNumber != scanNumber) break;
+                    scanNumber = lineScanNumber;
+                    known = true;
+                }
+                line = nextLine(line, end);
+            }
+            return line;
+        }
+
+        bool ascendByAngle(const sl_lidar_response_measurement_node_hq_t& a, const sl_lidar_response_measurement_node_hq_t& b)
+        {
+            return a.angle_z_q14 < b.angle_z_q14;
+        }
+
+        class OfflineProcessor;
+
+        struct OfflineWorker
+        {
+            OfflineProcessor* owner;
+            size_t      index;
+            rp::hal::Thread thread;
+
+            LidarScanFilterPipeline filters;
+            LidarScanFrame  frame;
+            LidarBinnedScan binned;
+            LidarLineExtractor lines;
+
+            std::vector<sl_lidar_response_measurement_node_hq_t> nodes;
+            std::vector<sl_lidar_response_measurement_node_hq_t> filteredNodes;
+            std::vector<LidarLineSegment> segments;
+
+            LidarOfflineStats stats;
+        };
+
+        class OfflineProcessor
+        {
+        public:
+            OfflineProcessor(const LidarOfflineOptions& options, const LidarOfflineScanCallback& callback)
+                : _options(options)
+                , _callback(callback)
+                , _reader(NULL)
+                , _nextUnit(0)
+            {
+            }
+
+            ~OfflineProcessor()
+            {
+                for (size_t pos = 0; pos < _workers.size(); ++pos) delete _workers[pos];
+                delete _reader;
+            }
+
+            sl_result open(const char* path)
+            {
+                sl_result ans = _file.open(path, internal::MappedFile::ACCESS_SEQUENTIAL);
+                if (SL_IS_FAIL(ans)) return ans;
+
+                sl_u32 magic = 0;
+                if (_file.size() >= sizeof(magic)) memcpy(&magic, _file.data(), sizeof(magic));
+                if (magic == SL_LIDAR_RECORD_MAGIC) {
+                    // the reader maps the file on its own and indexes the frames
+                    _file.close();
+                    _reader = *createLidarScanRecordReader();
+                    if (!_reader) return SL_RESULT_INSUFFICIENT_MEMORY;
+                    return _reader->open(path);
+                }
+                return _splitCsv();
+            }
+
+            void run(LidarOfflineStats& stats)
+            {
+                size_t threadCount = _options.threadCount;
+                if (!threadCount) threadCount = std::thread::hardware_concurrency();
+                if (!threadCount) threadCount = 1;
+
+                _u64 start_uS = getus();
+                for (size_t pos = 0; pos < threadCount; ++pos) {
+                    OfflineWorker* worker = new OfflineWorker();
+                    worker->owner = this;
+                    worker->index = pos;
+                    worker->filters = _options.filters;
+                    if (_options.binCount) worker->binned.configure(_options.binCount, _options.binPolicy);
+                    worker->lines.setOptions(_options.lineOptions);
+                    memset(&worker->stats, 0, sizeof(worker->stats));
+                    _workers.push_back(worker);
+                }
+                for (size_t pos = 0; pos < _workers.size(); ++pos) {
+                    _workers[pos]->thread = rp::hal::Thread::create(_workerThunk, _workers[pos]);
+                }
+
+                memset(&stats, 0, sizeof(stats));
+                for (size_t pos = 0; pos < _workers.size(); ++pos) {
+                    _workers[pos]->thread.join();
+
+                    const LidarOfflineStats& workerStats = _workers[pos]->stats;
+                    stats.scanCount += workerStats.scanCount;
+                    stats.rawNodeCount += workerStats.rawNodeCount;
+                    stats.filteredNodeCount += workerStats.filteredNodeCount;
+                    stats.segmentCount += workerStats.segmentCount;
+                    stats.malformedLineCount += workerStats.malformedLineCount;
+                }
+                stats.threadCount = threadCount;
+                stats.elapsed_s = (getus() - start_uS) / 1e6;
+            }
+
+        private:
+            static _word_size_t THREAD_PROC _workerThunk(void* data)
+            {
+                OfflineWorker* worker = reinterpret_cast<OfflineWorker*>(data);
+                worker->owner->_workerProc(*worker);
+                return 0;
+            }
+
+            sl_result _splitCsv()
+            {
+                const char* begin = (const char*)_file.data();
+                const char* end = begin + _file.size();
+
+                // the header line written by data_logger, if any, is not a sample
+                const char* data = begin;
+                if (!isDigit(*data) && *data != '-') data = nextLine(data, end);
+
+                // the first sample decides if this is a data_logger CSV at all
+                CsvSample sample;
+                if (data == end || !parseCsvLine(data, end, sample)) return SL_RESULT_FORMAT_NOT_SUPPORT;
+
+                _chunks.push_back(data);
+                while (_chunks.back() != end) {
+                    const char* chunkEnd = _chunks.back() + CSV_CHUNK_SIZE;
+                    _chunks.push_back(chunkEnd >= end ? end : findScanStart(chunkEnd, end));
+                }
+                return SL_RESULT_OK;
+            }
+
+            size_t _unitCount() const
+            {
+                if (_reader) return (_reader->getScanCount() + RECORD_BLOCK_SCANS - 1) / RECORD_BLOCK_SCANS;
+                return _chunks.size() - 1;
+            }
+
+            void _workerProc(OfflineWorker& worker)
+            {
+                size_t unitCount = _unitCount();
+                for (;;) {
+                    size_t unit = _nextUnit.fetch_add(1, std::memory_order_relaxed);
+                    if (unit >= unitCount) break;
+
+                    if (_reader) {
+                        _processRecordBlock(worker, unit);
+                    } else {
+                        _processCsvChunk(worker, _chunks[unit], _chunks[unit + 1]);
+                    }
+                }
+            }
+
+            void _processRecordBlock(OfflineWorker& worker, size_t block)
+            {
+                size_t first = block * RECORD_BLOCK_SCANS;
+                size_t last = std::min(first + RECORD_BLOCK_SCANS, _reader->getScanCount());
+                for (size_t index = first; index < last; ++index) {
+                    LidarRecordedScan scan;
+                    if (SL_IS_FAIL(_reader->getScan(index, scan))) continue;
+
+                    worker.nodes.assign(scan.nodes, scan.nodes + scan.count);
+                    _processScan(worker, index + 1, scan.timestamp_uS);
+                }
+            }
+
+            void _processCsvChunk(OfflineWorker& worker, const char* begin, const char* end)
+            {
+                sl_s64 scanNumber = 0;
+                sl_u64 timestamp_uS = 0;
+                worker.nodes.clear();
+
+                for (const char* line = begin; line != end; line = nextLine(line, end)) {
+                    if (*line == '\n' || *line == '\r') continue;
+
+                    CsvSample sample;
+                    if (!parseCsvLine(line, end, sample)) {
+                        ++worker.stats.malformedLineCount;
+                        continue;
+                    }
+
+                    if (sample.scanNumber != scanNumber && !worker.nodes.empty()) {
+                        _processScan(worker, (sl_u64)scanNumber, timestamp_uS);
+                        worker.nodes.clear();
+                    }
+                    if (worker.nodes.empty()) {
+                        scanNumber = sample.scanNumber;
+                        timestamp_uS = (sl_u64)sample.timestamp * 1000000;
+                    }
+
+                    sl_lidar_response_measurement_node_hq_t node;
+                    double angle_q14 = sample.angle * 16384.0 / 90.0 + 0.5;
+                    double dist_q2 = sample.distance * 4.0 + 0.5;
+                    node.angle_z_q14 = (sl_u16)((sl_u32)(angle_q14 > 0 ? angle_q14 : 0) & 0xFFFF);
+                    node.dist_mm_q2 = (sl_u32)(dist_q2 > 0 ? dist_q2 : 0);
+                    node.quality = (sl_u8)(sample.quality < 0 ? 0 : (sample.quality > 255 ? 255 : sample.quality));
+                    node.flag = worker.nodes.empty() ? SL_LIDAR_RESP_HQ_FLAG_SYNCBIT : 0;
+                    worker.nodes.push_back(node);
+                }
+
+                if (!worker.nodes.empty()) _processScan(worker, (sl_u64)scanNumber, timestamp_uS);
+            }
+
+            void _processScan(OfflineWorker& worker, sl_u64 scanNumber, sl_u64 timestamp_uS)
+            {
+                size_t rawCount = worker.nodes.size();
+                if (_options.ascendScans && rawCount) {
+                    std::stable_sort(worker.nodes.begin(), worker.nodes.end(), ascendByAngle);
+                }
+
+                const sl_lidar_response_measurement_node_hq_t* nodes = rawCount ? &worker.nodes[0] : NULL;
+                size_t count = rawCount;
+
+                worker.frame.assign(nodes, count, timestamp_uS);
+                if (worker.filters.stageCount()) {
+                    count = worker.filters.apply(worker.frame);
+                    _frameToNodes(worker.frame, worker.filteredNodes);
+                    nodes = count ? &worker.filteredNodes[0] : NULL;
+                }
+
+                LidarOfflineScan scan;
+                scan.scanNumber = scanNumber;
+                scan.timestamp_uS = timestamp_uS;
+                scan.rawNodeCount = rawCount;
+                scan.frame = &worker.frame;
+                scan.nodes = nodes;
+                scan.count = count;
+                scan.binned = NULL;
+                scan.segments = NULL;
+                scan.workerIndex = worker.index;
+
+                if (_options.binCount) {
+                    worker.binned.assign(nodes, count, timestamp_uS);
+                    scan.binned = &worker.binned;
+                }
+                if (_options.extractLines) {
+                    worker.lines.extract(nodes, count, worker.segments);
+                    scan.segments = &worker.segments;
+                    worker.stats.segmentCount += worker.segments.size();
+                }
+
+                ++worker.stats.scanCount;
+                worker.stats.rawNodeCount += rawCount;
+                worker.stats.filteredNodeCount += count;
+
+                if (_callback) _callback(scan);
+            }
+
+            static void _frameToNodes(const LidarScanFrame& frame, std::vector<sl_lidar_response_measurement_node_hq_t>& nodes)
+            {
+                nodes.resize(frame.size());
+                for (size_t pos = 0; pos < frame.size(); ++pos) {
+                    sl_u32 angle_q14 = (sl_u32)(frame.angle()[pos] * (16384.f / 90.f) + 0.5f);
+                    nodes[pos].angle_z_q14 = (sl_u16)(angle_q14 & 0xFFFF);
+                    nodes[pos].dist_mm_q2 = (sl_u32)(frame.range()[pos] * 4.f + 0.5f);
+                    nodes[pos].quality = frame.quality()[pos];
+                    nodes[pos].flag = frame.flag()[pos];
+                }
+            }
+
+            const LidarOfflineOptions& _options;
+            const LidarOfflineScanCallback& _callback;
+
+            internal::MappedFile _file;
+            ILidarScanRecordReader* _reader;
+            std::vector<const char*> _chunks;
+
+            std::vector<OfflineWorker*> _workers;
+            std::atomic<size_t> _nextUnit;
+        };
+
+    }
+
+    sl_result processLidarLog(const char* path, const LidarOfflineOptions& options, const LidarOfflineScanCallback& callback, LidarOfflineStats* stats)
+    {
+        if (!path) return SL_RESULT_INVALID_DATA;
+
+        OfflineProcessor processor(options, callback);
+        sl_result ans = processor.open(path);
+        if (SL_IS_FAIL(ans)) return ans;
+
+        LidarOfflineStats runStats;
+        processor.run(runStats);
+        if (stats) *stats = runStats;
+        return SL_RESULT_OK;
+    }
+
+}
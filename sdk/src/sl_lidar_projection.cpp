@@ -0,0 +1,277 @@
+/*
+ *  Slamtec LIDAR SDK
+ *
+ *  Copyright (c) 2014 - 2023 Shanghai Slamtec Co., Ltd.
+ *  http://www.slamtec.com
+ *
+ */
+ /*
+  * Redistribution and use in source and binary forms, with or without
+  * modification, are permitted provided that the following conditions are met:
+  *
+  * 1. Redistributions of source code must retain the above copyright notice,
+  *    this list of conditions and the following disclaimer.
+  *
+  * 2. Redistributions in binary form must reproduce the above copyright notice,
+  *    this list of conditions and the following disclaimer in the documentation
+  *    and/or other materials provided with the distribution.
+  *
+  * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+  * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+  * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+  * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+  * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+  * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+  * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+  * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+  * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+  * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+  * EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+  *
+  */
+
+#include "sl_lidar_projection.h"
+#include "sl_angle_lut.h"
+#include <math.h>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define SL_PROJECTION_SSE2
+#include <emmintrin.h>
+#endif
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+// compiled with the target attribute and selected at runtime
+#define SL_PROJECTION_AVX2
+#include <immintrin.h>
+#endif
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#define SL_PROJECTION_NEON
+#include <arm_neon.h>
+#endif
+
+namespace sl {
+
+    const AngleLUT& getAngleLUT()
+    {
+        // initialized once in a thread-safe way
+        static AngleLUT lut;
+        return lut;
+    }
+
+    static const float ANGLE_TO_LUT_INDEX = 16384.f / 90.f;
+
+    static inline sl_u32 angleToLUTIndex(float angle)
+    {
+        return ((sl_s32)(angle * ANGLE_TO_LUT_INDEX + 0.5f)) & (ANGLE_LUT_SIZE - 1);
+    }
+
+    static void _projectNodes_scalar(const AngleLUT& lut, const sl_lidar_response_measurement_node_hq_t* nodes, size_t count, float* x, float* y)
+    {
+        for (size_t pos = 0; pos < count; ++pos) {
+            sl_u32 index = nodes[pos].angle_z_q14;
+            float range = nodes[pos].dist_mm_q2 * 0.25f;
+            x[pos] = range * lut.cosValue[index];
+            y[pos] = range * lut.sinValue[index];
+        }
+    }
+
+    static void _projectFrame_scalar(const AngleLUT& lut, const float* angle, const float* range, size_t count, float* x, float* y)
+    {
+        for (size_t pos = 0; pos < count; ++pos) {
+            sl_u32 index = angleToLUTIndex(angle[pos]);
+            x[pos] = range[pos] * lut.cosValue[index];
+            y[pos] = range[pos] * lut.sinValue[index];
+        }
+    }
+
+#ifdef SL_PROJECTION_AVX2
+    static bool _isAVX2Supported()
+    {
+        static const bool supported = __builtin_cpu_supports("avx2");
+        return supported;
+    }
+
+    // the following routines return the number of elements processed, the remaining ones are left to the other paths
+
+    __attribute__((target("avx2")))
+    static size_t _projectNodes_avx2(const AngleLUT& lut, const sl_lidar_response_measurement_node_hq_t* nodes, size_t count, float* x, float* y)
+    {
+        // byte offset of each node in a block of 8 packed nodes
+        const __m256i nodeOffset = _mm256_setr_epi32(0, 8, 16, 24, 32, 40, 48, 56);
+        const __m256i angleMask = _mm256_set1_epi32(0xFFFF);
+        const __m256 rangeScale = _mm256_set1_ps(0.25f);
+
+        size_t pos = 0;
+        for (; pos + 8 <= count; pos += 8) {
+            const char* block = reinterpret_cast<const char*>(nodes + pos);
+
+            __m256i index = _mm256_and_si256(_mm256_i32gather_epi32(reinterpret_cast<const int*>(block), nodeOffset, 1), angleMask);
+            __m256i dist = _mm256_i32gather_epi32(reinterpret_cast<const int*>(block + 2), nodeOffset, 1);
+
+            __m256 range = _mm256_mul_ps(_mm256_cvtepi32_ps(dist), rangeScale);
+            __m256 cosValue = _mm256_i32gather_ps(lut.cosValue, index, 4);
+            __m256 sinValue = _mm256_i32gather_ps(lut.sinValue, index, 4);
+
+            _mm256_storeu_ps(x + pos, _mm256_mul_ps(range, cosValue));
+            _mm256_storeu_ps(y + pos, _mm256_mul_ps(range, sinValue));
+        }
+        return pos;
+    }
+
+    __attribute__((target("avx2")))
+    static size_t _projectFrame_avx2(const AngleLUT& lut, const float* angle, const float* range, size_t count, float* x, float* y)
+    {
+        const __m256 indexScale = _mm256_set1_ps(ANGLE_TO_LUT_INDEX);
+        const __m256 half = _mm256_set1_ps(0.5f);
+        const __m256i indexMask = _mm256_set1_epi32(ANGLE_LUT_SIZE - 1);
+
+        size_t pos = 0;
+        for (; pos + 8 <= count; pos += 8) {
+            __m256 angleValue = _mm256_loadu_ps(angle + pos);
+            __m256i index = _mm256_and_si256(_mm256_cvttps_epi32(_mm256_add_ps(_mm256_mul_ps(angleValue, indexScale), half)), indexMask);
+
+            __m256 rangeValue = _mm256_loadu_ps(range + pos);
+            __m256 cosValue = _mm256_i32gather_ps(lut.cosValue, index, 4);
+            __m256 sinValue = _mm256_i32gather_ps(lut.sinValue, index, 4);
+
+            _mm256_storeu_ps(x + pos, _mm256_mul_ps(rangeValue, cosValue));
+            _mm256_storeu_ps(y + pos, _mm256_mul_ps(rangeValue, sinValue));
+        }
+        return pos;
+    }
+#endif
+
+#ifdef SL_PROJECTION_SSE2
+    // there is no gather instruction in SSE2, only the arithmetic is vectorized
+    static size_t _projectNodes_sse2(const AngleLUT& lut, const sl_lidar_response_measurement_node_hq_t* nodes, size_t count, float* x, float* y)
+    {
+        const __m128 rangeScale = _mm_set1_ps(0.25f);
+
+        size_t pos = 0;
+        for (; pos + 4 <= count; pos += 4) {
+            const sl_lidar_response_measurement_node_hq_t* block = nodes + pos;
+
+            __m128i dist = _mm_setr_epi32(block[0].dist_mm_q2, block[1].dist_mm_q2, block[2].dist_mm_q2, block[3].dist_mm_q2);
+            __m128 range = _mm_mul_ps(_mm_cvtepi32_ps(dist), rangeScale);
+            __m128 cosValue = _mm_setr_ps(lut.cosValue[block[0].angle_z_q14], lut.cosValue[block[1].angle_z_q14], lut.cosValue[block[2].angle_z_q14], lut.cosValue[block[3].angle_z_q14]);
+            __m128 sinValue = _mm_setr_ps(lut.sinValue[block[0].angle_z_q14], lut.sinValue[block[1].angle_z_q14], lut.sinValue[block[2].angle_z_q14], lut.sinValue[block[3].angle_z_q14]);
+
+            _mm_storeu_ps(x + pos, _mm_mul_ps(range, cosValue));
+            _mm_storeu_ps(y + pos, _mm_mul_ps(range, sinValue));
+        }
+        return pos;
+    }
+
+    static size_t _projectFrame_sse2(const AngleLUT& lut, const float* angle, const float* range, size_t count, float* x, float* y)
+    {
+        const __m128 indexScale = _mm_set1_ps(ANGLE_TO_LUT_INDEX);
+        const __m128 half = _mm_set1_ps(0.5f);
+        const __m128i indexMask = _mm_set1_epi32(ANGLE_LUT_SIZE - 1);
+
+        size_t pos = 0;
+        for (; pos + 4 <= count; pos += 4) {
+            __m128 angleValue = _mm_loadu_ps(angle + pos);
+            __m128i index = _mm_and_si128(_mm_cvttps_epi32(_mm_add_ps(_mm_mul_ps(angleValue, indexScale), half)), indexMask);
+
+            union { __m128i v; sl_s32 i[4]; } idx;
+            idx.v = index;
+
+            __m128 rangeValue = _mm_loadu_ps(range + pos);
+            __m128 cosValue = _mm_setr_ps(lut.cosValue[idx.i[0]], lut.cosValue[idx.i[1]], lut.cosValue[idx.i[2]], lut.cosValue[idx.i[3]]);
+            __m128 sinValue = _mm_setr_ps(lut.sinValue[idx.i[0]], lut.sinValue[idx.i[1]], lut.sinValue[idx.i[2]], lut.sinValue[idx.i[3]]);
+
+            _mm_storeu_ps(x + pos, _mm_mul_ps(rangeValue, cosValue));
+            _mm_storeu_ps(y + pos, _mm_mul_ps(rangeValue, sinValue));
+        }
+        return pos;
+    }
+#endif
+
+#ifdef SL_PROJECTION_NEON
+    static size_t _projectNodes_neon(const AngleLUT& lut, const sl_lidar_response_measurement_node_hq_t* nodes, size_t count, float* x, float* y)
+    {
+        size_t pos = 0;
+        for (; pos + 4 <= count; pos += 4) {
+            // word 0: angle_z_q14 | dist_mm_q2 (low 16bits) << 16
+            // word 1: dist_mm_q2 (high 16bits) | quality << 16 | flag << 24
+            uint32x4x2_t words = vld2q_u32(reinterpret_cast<const uint32_t*>(nodes + pos));
+
+            uint32x4_t dist = vorrq_u32(vshrq_n_u32(words.val[0], 16), vshlq_n_u32(words.val[1], 16));
+            float32x4_t range = vmulq_n_f32(vcvtq_f32_u32(dist), 0.25f);
+
+            uint32_t index[4];
+            vst1q_u32(index, vandq_u32(words.val[0], vdupq_n_u32(0xFFFF)));
+
+            float cosValue[4] = { lut.cosValue[index[0]], lut.cosValue[index[1]], lut.cosValue[index[2]], lut.cosValue[index[3]] };
+            float sinValue[4] = { lut.sinValue[index[0]], lut.sinValue[index[1]], lut.sinValue[index[2]], lut.sinValue[index[3]] };
+
+            vst1q_f32(x + pos, vmulq_f32(range, vld1q_f32(cosValue)));
+            vst1q_f32(y + pos, vmulq_f32(range, vld1q_f32(sinValue)));
+        }
+        return pos;
+    }
+
+    static size_t _projectFrame_neon(const AngleLUT& lut, const float* angle, const float* range, size_t count, float* x, float* y)
+    {
+        size_t pos = 0;
+        for (; pos + 4 <= count; pos += 4) {
+            float32x4_t angleValue = vld1q_f32(angle + pos);
+            int32x4_t index = vcvtq_s32_f32(vaddq_f32(vmulq_n_f32(angleValue, ANGLE_TO_LUT_INDEX), vdupq_n_f32(0.5f)));
+            
+            sl_s32 idx[4];
+            vst1q_s32(idx, vandq_s32(index, vdupq_n_s32(ANGLE_LUT_SIZE - 1)));
+
+            float cosValue[4] = { lut.cosValue[idx[0]], lut.cosValue[idx[1]], lut.cosValue[idx[2]], lut.cosValue[idx[3]] };
+            float sinValue[4] = { lut.sinValue[idx[0]], lut.sinValue[idx[1]], lut.sinValue[idx[2]], lut.sinValue[idx[3]] };
+
+            float32x4_t rangeValue = vld1q_f32(range + pos);
+            vst1q_f32(x + pos, vmulq_f32(rangeValue, vld1q_f32(cosValue)));
+            vst1q_f32(y + pos, vmulq_f32(rangeValue, vld1q_f32(sinValue)));
+        }
+        return pos;
+    }
+#endif
+
+    void projectScanToCartesian(const sl_lidar_response_measurement_node_hq_t* nodes, size_t count, float* x, float* y)
+    {
+        const AngleLUT& lut = getAngleLUT();
+        size_t pos = 0;
+
+#ifdef SL_PROJECTION_AVX2
+        if (_isAVX2Supported()) {
+            pos += _projectNodes_avx2(lut, nodes, count, x, y);
+        }
+#endif
+#ifdef SL_PROJECTION_SSE2
+        pos += _projectNodes_sse2(lut, nodes + pos, count - pos, x + pos, y + pos);
+#endif
+#ifdef SL_PROJECTION_NEON
+        pos += _projectNodes_neon(lut, nodes + pos, count - pos, x + pos, y + pos);
+#endif
+        _projectNodes_scalar(lut, nodes + pos, count - pos, x + pos, y + pos);
+    }
+
+    void projectScanToCartesian(const LidarScanFrame& frame, float* x, float* y)
+    {
+        const AngleLUT& lut = getAngleLUT();
+        const float* angle = frame.angle();
+        const float* range = frame.range();
+        size_t count = frame.size();
+        size_t pos = 0;
+
+#ifdef SL_PROJECTION_AVX2
+        if (_isAVX2Supported()) {
+            pos += _projectFrame_avx2(lut, angle, range, count, x, y);
+        }
+#endif
+#ifdef SL_PROJECTION_SSE2
+        pos += _projectFrame_sse2(lut, angle + pos, range + pos, count - pos, x + pos, y + pos);
+#endif
+#ifdef SL_PROJECTION_NEON
+        pos += _projectFrame_neon(lut, angle + pos, range + pos, count - pos, x + pos, y + pos);
+#endif
+        _projectFrame_scalar(lut, angle + pos, range + pos, count - pos, x + pos, y + pos);
+    }
+
+}
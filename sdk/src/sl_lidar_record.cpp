@@ -0,0 +1,369 @@
+/*
+ *  Slamtec LIDAR SDK
+ *
+ *  Copyright (c) 2014 - 2023 Shanghai Slamtec Co., Ltd.
+ *  http://www.slamtec.com
+ *
+ */
+ /*
+  * Redistribution and use in source and binary forms, with or without
+  * modification, are permitted provided that the following conditions are met:
+  *
+  * 1. Redistributions of source code must retain the above copyright notice,
+  *    this list of conditions and the following disclaimer.
+  *
+  * 2. Redistributions in binary form must reproduce the above copyright notice,
+  *    this list of conditions and the following disclaimer in the documentation
+  *    and/or other materials provided with the distribution.
+  *
+  * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+  * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+  * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+  * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+  * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+  * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+  * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+  * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+  * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+  * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+  * EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+  *
+  */
+
+#include "sdkcommon.h"
+#include "hal/thread.h"
+#include "hal/types.h"
+#include "hal/assert.h"
+#include "hal/locker.h"
+#include "hal/event.h"
+#include "sl_lidar_driver.h"
+#include "sl_lidar_record.h"
+#include "sl_mapped_file.h"
+
+#include <stdio.h>
+#include <vector>
+#include <algorithm>
+
+namespace sl {
+
+    class LidarScanRecorder : public ILidarScanRecorder
+    {
+    public:
+        enum {
+            WRITE_BUFFER_SIZE = 1024 * 1024,
+        };
+
+        LidarScanRecorder(size_t queueDepth)
+            : _file(NULL)
+            , _isWorking(false)
+            , _slots(queueDepth ? queueDepth : 1)
+            , _head(0)
+            , _queuedCount(0)
+            , _recordedCount(0)
+            , _droppedCount(0)
+        {
+        }
+
+        virtual ~LidarScanRecorder()
+        {
+            close();
+        }
+
+        sl_result open(const char* path, const sl_lidar_response_device_info_t& devInfo, const LidarScanMode& scanMode)
+        {
+            close();
+
+            FILE* file = fopen(path, "wb");
+            if (!file) return SL_RESULT_OPERATION_FAIL;
+            setvbuf(file, NULL, _IOFBF, WRITE_BUFFER_SIZE);
+
+            sl_lidar_record_file_header_t header;
+            memset(&header, 0, sizeof(header));
+            header.magic = SL_LIDAR_RECORD_MAGIC;
+            header.version = SL_LIDAR_RECORD_VERSION;
+            header.header_size = sizeof(header);
+            header.node_size = sizeof(sl_lidar_response_measurement_node_hq_t);
+            header.device_info = devInfo;
+            header.scan_mode_id = scanMode.id;
+            header.scan_mode_ans_type = scanMode.ans_type;
+            header.us_per_sample = scanMode.us_per_sample;
+            header.max_distance = scanMode.max_distance;
+            memcpy(header.scan_mode_name, scanMode.scan_mode, sizeof(header.scan_mode_name));
+
+            if (fwrite(&header, sizeof(header), 1, file) != 1) {
+                fclose(file);
+                return SL_RESULT_OPERATION_FAIL;
+            }
+
+            rp::hal::AutoLocker l(_locker);
+            _file = file;
+            _head = 0;
+            _queuedCount = 0;
+            _recordedCount = 0;
+            _droppedCount = 0;
+            _isWorking = true;
+            _writerThread = CLASS_THREAD(LidarScanRecorder, _proc_writerThread);
+            return SL_RESULT_OK;
+        }
+
+        void close()
+        {
+            {
+                rp::hal::AutoLocker l(_locker);
+                if (!_isWorking) return;
+                _isWorking = false;
+            }
+            _dataEvt.set();
+            _writerThread.join();
+
+            fclose(_file);
+            _file = NULL;
+        }
+
+        bool isOpened()
+        {
+            return _isWorking;
+        }
+
+        sl_result pushScan(const sl_lidar_response_measurement_node_hq_t* nodes, size_t count, sl_u64 timestamp_uS)
+        {
+            rp::hal::AutoLocker l(_locker);
+            if (!_isWorking) return SL_RESULT_OPERATION_NOT_SUPPORT;
+
+            if (_queuedCount == _slots.size()) {
+                ++_droppedCount;
+                return SL_RESULT_OPERATION_FAIL;
+            }
+
+            // the slot buffers are reused, so they stop reallocating once they reach the scan size
+            ScanSlot& slot = _slots[(_head + _queuedCount) % _slots.size()];
+            slot.nodes.assign(nodes, nodes + count);
+            slot.timestamp_uS = timestamp_uS;
+            ++_queuedCount;
+
+            _dataEvt.set();
+            return SL_RESULT_OK;
+        }
+
+        sl_u64 getRecordedScanCount()
+        {
+            rp::hal::AutoLocker l(_locker);
+            return _recordedCount;
+        }
+
+        sl_u64 getDroppedScanCount()
+        {
+            rp::hal::AutoLocker l(_locker);
+            return _droppedCount;
+        }
+
+    protected:
+        struct ScanSlot {
+            std::vector<sl_lidar_response_measurement_node_hq_t> nodes;
+            sl_u64 timestamp_uS;
+        };
+
+        u_result _proc_writerThread()
+        {
+            for (;;)
+            {
+                ScanSlot* slot = NULL;
+                bool working;
+                {
+                    rp::hal::AutoLocker l(_locker);
+                    working = _isWorking;
+                    if (_queuedCount) slot = &_slots[_head];
+                }
+
+                if (!slot) {
+                    // write everything queued before leaving
+                    if (!working) break;
+                    // flush while idle so a crash loses as little as possible
+                    fflush(_file);
+                    _dataEvt.wait(1000);
+                    continue;
+                }
+
+                // the producer never touches the head slot while it is queued
+                sl_lidar_record_frame_header_t frameHeader;
+                frameHeader.node_count = (sl_u32)slot->nodes.size();
+                frameHeader.frame_size = (sl_u32)(sizeof(frameHeader) + slot->nodes.size() * sizeof(sl_lidar_response_measurement_node_hq_t));
+                frameHeader.timestamp_uS = slot->timestamp_uS;
+
+                fwrite(&frameHeader, sizeof(frameHeader), 1, _file);
+                if (!slot->nodes.empty()) {
+                    fwrite(&slot->nodes[0], sizeof(sl_lidar_response_measurement_node_hq_t), slot->nodes.size(), _file);
+                }
+
+                rp::hal::AutoLocker l(_locker);
+                _head = (_head + 1) % _slots.size();
+                --_queuedCount;
+                ++_recordedCount;
+            }
+            return RESULT_OK;
+        }
+
+    protected:
+        FILE* _file;
+        bool  _isWorking;
+
+        rp::hal::Locker _locker;
+        rp::hal::Event  _dataEvt;
+        rp::hal::Thread _writerThread;
+
+        std::vector<ScanSlot> _slots;
+        size_t _head;
+        size_t _queuedCount;
+
+        sl_u64 _recordedCount;
+        sl_u64 _droppedCount;
+    };
+
+
+    class LidarScanRecordReader : public ILidarScanRecordReader
+    {
+    public:
+        LidarScanRecordReader()
+            : _mapped(NULL)
+            , _mappedSize(0)
+        {
+            memset(&_devInfo, 0, sizeof(_devInfo));
+            memset(&_scanMode, 0, sizeof(_scanMode));
+        }
+
+        virtual ~LidarScanRecordReader()
+        {
+            close();
+        }
+
+        sl_result open(const char* path)
+        {
+            close();
+
+            sl_result ans = _map(path);
+            if (SL_IS_FAIL(ans)) return ans;
+
+            ans = _buildIndex();
+            if (SL_IS_FAIL(ans)) close();
+            return ans;
+        }
+
+        void close()
+        {
+            _frameOffsets.clear();
+            _frameTimestamps.clear();
+
+            _file.close();
+            _mapped = NULL;
+            _mappedSize = 0;
+        }
+
+        const sl_lidar_response_device_info_t& getDeviceInfo()
+        {
+            return _devInfo;
+        }
+
+        const LidarScanMode& getScanMode()
+        {
+            return _scanMode;
+        }
+
+        size_t getScanCount()
+        {
+            return _frameOffsets.size();
+        }
+
+        sl_result getScan(size_t index, LidarRecordedScan& scan)
+        {
+            if (index >= _frameOffsets.size()) return SL_RESULT_INVALID_DATA;
+
+            sl_lidar_record_frame_header_t frameHeader;
+            memcpy(&frameHeader, _mapped + _frameOffsets[index], sizeof(frameHeader));
+
+            // the node struct is packed, so it can be used in place
+            scan.nodes = reinterpret_cast<const sl_lidar_response_measurement_node_hq_t*>(_mapped + _frameOffsets[index] + sizeof(frameHeader));
+            scan.count = frameHeader.node_count;
+            scan.timestamp_uS = frameHeader.timestamp_uS;
+            return SL_RESULT_OK;
+        }
+
+        size_t findScanByTimestamp(sl_u64 timestamp_uS)
+        {
+            return std::lower_bound(_frameTimestamps.begin(), _frameTimestamps.end(), timestamp_uS) - _frameTimestamps.begin();
+        }
+
+    protected:
+        sl_result _map(const char* path)
+        {
+            // replay is mostly sequential
+            sl_result ans = _file.open(path, internal::MappedFile::ACCESS_SEQUENTIAL);
+            if (SL_IS_FAIL(ans)) return ans;
+
+            _mapped = _file.data();
+            _mappedSize = _file.size();
+            return SL_RESULT_OK;
+        }
+
+        sl_result _buildIndex()
+        {
+            sl_lidar_record_file_header_t header;
+            if (_mappedSize < sizeof(header)) return SL_RESULT_FORMAT_NOT_SUPPORT;
+            memcpy(&header, _mapped, sizeof(header));
+
+            if (header.magic != SL_LIDAR_RECORD_MAGIC || header.version != SL_LIDAR_RECORD_VERSION
+                || header.header_size < sizeof(header) || header.header_size > _mappedSize
+                || header.node_size != sizeof(sl_lidar_response_measurement_node_hq_t)) {
+                return SL_RESULT_FORMAT_NOT_SUPPORT;
+            }
+
+            _devInfo = header.device_info;
+            _scanMode.id = header.scan_mode_id;
+            _scanMode.ans_type = header.scan_mode_ans_type;
+            _scanMode.us_per_sample = header.us_per_sample;
+            _scanMode.max_distance = header.max_distance;
+            memcpy(_scanMode.scan_mode, header.scan_mode_name, sizeof(_scanMode.scan_mode));
+            _scanMode.scan_mode[sizeof(_scanMode.scan_mode) - 1] = '\0';
+
+            // only the frame headers are touched, the nodes are paged in on demand
+            size_t offset = header.header_size;
+            while (_mappedSize - offset >= sizeof(sl_lidar_record_frame_header_t))
+            {
+                sl_lidar_record_frame_header_t frameHeader;
+                memcpy(&frameHeader, _mapped + offset, sizeof(frameHeader));
+
+                if (frameHeader.frame_size != sizeof(frameHeader) + (size_t)frameHeader.node_count * sizeof(sl_lidar_response_measurement_node_hq_t)
+                    || frameHeader.frame_size > _mappedSize - offset) {
+                    // truncated or corrupted, keep the frames before it
+                    break;
+                }
+
+                _frameOffsets.push_back(offset);
+                _frameTimestamps.push_back(frameHeader.timestamp_uS);
+                offset += frameHeader.frame_size;
+            }
+            return SL_RESULT_OK;
+        }
+
+    protected:
+        internal::MappedFile _file;
+        const sl_u8* _mapped;
+        size_t       _mappedSize;
+
+        sl_lidar_response_device_info_t _devInfo;
+        LidarScanMode                   _scanMode;
+
+        std::vector<size_t> _frameOffsets;
+        std::vector<sl_u64> _frameTimestamps;
+    };
+
+
+    Result<ILidarScanRecorder*> createLidarScanRecorder(size_t queueDepth)
+    {
+        return new LidarScanRecorder(queueDepth);
+    }
+
+    Result<ILidarScanRecordReader*> createLidarScanRecordReader()
+    {
+        return new LidarScanRecordReader();
+    }
+}
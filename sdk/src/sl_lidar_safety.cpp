@@ -0,0 +1,358 @@
+/*
+ *  Slamtec LIDAR SDK
+ *
+ *  Copyright (c) 2014 - 2023 Shanghai Slamtec Co., Ltd.
+ *  http://www.slamtec.com
+ *
+ */
+ /*
+  * Redistribution and use in source and binary forms, with or without
+  * modification, are permitted provided that the following conditions are met:
+  *
+  * 1. Redistributions of source code must retain the above copyright notice,
+  *    this list of conditions and the following disclaimer.
+  *
+  * 2. Redistributions in binary form must reproduce the above copyright notice,
+  *    this list of conditions and the following disclaimer in the documentation
+  *    and/or other materials provided with the distribution.
+  *
+  * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+  * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+  * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+  * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+  * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+  * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+  * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+  * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+  * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+  * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+  * EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+  *
+  */
+
+#include "sdkcommon.h"
+#include "hal/types.h"
+#include "hal/locker.h"
+#include "sl_lidar_driver.h"
+#include "sl_lidar_safety.h"
+
+#include <math.h>
+#include <vector>
+#include <algorithm>
+
+namespace sl {
+
+    enum {
+        // angle_z_q14 >> ZONE_BIN_SHIFT is the bin of a node
+        ZONE_BIN_SHIFT = 4,
+    };
+
+    static_assert((65536 >> ZONE_BIN_SHIFT) == ILidarSafetyMonitor::ZONE_BIN_COUNT, "ZONE_BIN_SHIFT does not match ZONE_BIN_COUNT");
+
+    static const double ZONE_BIN_ANGLE = 2.0 * M_PI / ILidarSafetyMonitor::ZONE_BIN_COUNT;
+
+    class LidarSafetyMonitor : public ILidarSafetyMonitor
+    {
+    public:
+        LidarSafetyMonitor()
+            : _locker(true) // the callback may query the zone states
+        {
+        }
+
+        virtual ~LidarSafetyMonitor()
+        {
+            clearZones();
+        }
+
+        sl_result addPolygonZone(int zoneId, const float* x, const float* y, size_t vertexCount, size_t minPoints)
+        {
+            if (!x || !y || vertexCount < 3) return SL_RESULT_INVALID_DATA;
+
+            Zone* zone = new Zone(zoneId, minPoints);
+            _buildPolygonBins(*zone, x, y, vertexCount);
+            _addZone(zone);
+            return SL_RESULT_OK;
+        }
+
+        sl_result addSectorZone(int zoneId, float fromAngle, float toAngle, float minRange, float maxRange, size_t minPoints)
+        {
+            if (minRange < 0 || maxRange <= minRange) return SL_RESULT_INVALID_DATA;
+
+            double span = fmod((double)toAngle - fromAngle, 360.0);
+            if (span <= 0) span += 360.0;
+            double start = fmod((double)fromAngle, 360.0);
+            if (start < 0) start += 360.0;
+
+            // every bin touching the sector
+            size_t firstBin = (size_t)(start / 360.0 * ZONE_BIN_COUNT);
+            size_t binCount = std::min<size_t>((size_t)ceil((start + span) / 360.0 * ZONE_BIN_COUNT) - firstBin, ZONE_BIN_COUNT);
+
+            Zone* zone = new Zone(zoneId, minPoints);
+            for (size_t pos = 0; pos < binCount; ++pos) {
+                _setBin(zone->bins[(firstBin + pos) % ZONE_BIN_COUNT], minRange, maxRange);
+            }
+            _addZone(zone);
+            return SL_RESULT_OK;
+        }
+
+        void removeZone(int zoneId)
+        {
+            rp::hal::AutoLocker l(_locker);
+            for (size_t pos = 0; pos < _zones.size(); ++pos) {
+                if (_zones[pos]->id != zoneId) continue;
+                delete _zones[pos];
+                _zones.erase(_zones.begin() + pos);
+                return;
+            }
+        }
+
+        void clearZones()
+        {
+            rp::hal::AutoLocker l(_locker);
+            for (size_t pos = 0; pos < _zones.size(); ++pos) {
+                delete _zones[pos];
+            }
+            _zones.clear();
+        }
+
+        void setCallback(const LidarSafetyCallback& callback)
+        {
+            rp::hal::AutoLocker l(_locker);
+            _callback = callback;
+        }
+
+        bool isZoneIntruded(int zoneId)
+        {
+            rp::hal::AutoLocker l(_locker);
+            for (size_t pos = 0; pos < _zones.size(); ++pos) {
+                if (_zones[pos]->id == zoneId) return _zones[pos]->intruded;
+            }
+            return false;
+        }
+
+        void reset()
+        {
+            rp::hal::AutoLocker l(_locker);
+            for (size_t pos = 0; pos < _zones.size(); ++pos) {
+                _zones[pos]->hitCount = 0;
+                _zones[pos]->intruded = false;
+            }
+        }
+
+        void evaluate(const sl_lidar_response_measurement_node_hq_t* nodes, const sl_u64* timestamps_uS, size_t count)
+        {
+            rp::hal::AutoLocker l(_locker);
+
+            size_t pos = 0;
+            while (pos < count) {
+                if (nodes[pos].flag & SL_LIDAR_RESP_HQ_FLAG_SYNCBIT) {
+                    _finishRevolution(timestamps_uS[pos]);
+                }
+
+                // the nodes up to the next revolution are checked zone by zone
+                size_t rangeEnd = pos + 1;
+                while (rangeEnd < count && !(nodes[rangeEnd].flag & SL_LIDAR_RESP_HQ_FLAG_SYNCBIT)) {
+                    ++rangeEnd;
+                }
+
+                for (size_t zonePos = 0; zonePos < _zones.size(); ++zonePos) {
+                    _evaluateZone(*_zones[zonePos], nodes + pos, timestamps_uS + pos, rangeEnd - pos);
+                }
+                pos = rangeEnd;
+            }
+        }
+
+    protected:
+        // a node is inside if near <= dist_mm_q2 < near + width, tested as (dist_mm_q2 - near) < width in unsigned arithmetic
+        struct ZoneBin
+        {
+            sl_u32 near;    // at least 1 so that the invalid nodes (0 distance) are never inside
+            sl_u32 width;
+        };
+
+        struct Zone
+        {
+            int                  id;
+            size_t               minPoints;
+            std::vector<ZoneBin> bins;
+
+            // nodes seen inside during the current revolution
+            size_t               hitCount;
+            bool                 intruded;
+
+            Zone(int id, size_t minPoints)
+                : id(id)
+                , minPoints(minPoints ? minPoints : 1)
+                , bins(ZONE_BIN_COUNT)
+                , hitCount(0)
+                , intruded(false)
+            {
+                ZoneBin empty = { 1, 0 };
+                std::fill(bins.begin(), bins.end(), empty);
+            }
+        };
+
+        void _addZone(Zone* zone)
+        {
+            rp::hal::AutoLocker l(_locker);
+            for (size_t pos = 0; pos < _zones.size(); ++pos) {
+                if (_zones[pos]->id != zone->id) continue;
+                delete _zones[pos];
+                _zones[pos] = zone;
+                return;
+            }
+            _zones.push_back(zone);
+        }
+
+        static void _setBin(ZoneBin& bin, double nearRange, double farRange)
+        {
+            double nearQ2 = std::max(floor(nearRange * 4), 1.0);
+            double farQ2 = std::min(ceil(farRange * 4), 4294967295.0);
+            bin.near = (sl_u32)nearQ2;
+            bin.width = farQ2 > nearQ2 ? (sl_u32)(farQ2 - nearQ2) : 0;
+        }
+
+        static bool _isOriginInside(const std::vector<double>& x, const std::vector<double>& y)
+        {
+            bool inside = false;
+            for (size_t pos = 0, prev = x.size() - 1; pos < x.size(); prev = pos++) {
+                if ((y[pos] > 0) != (y[prev] > 0)) {
+                    double crossX = x[pos] + (x[prev] - x[pos]) * (0 - y[pos]) / (y[prev] - y[pos]);
+                    if (crossX > 0) inside = !inside;
+                }
+            }
+            return inside;
+        }
+
+        // the hull of the distances where the ray at the given angle crosses the polygon edges, both 0 without a crossing
+        static bool _castRay(const std::vector<double>& x, const std::vector<double>& y, double angle, double& nearRange, double& farRange)
+        {
+            double dirX = cos(angle), dirY = sin(angle);
+            bool hit = false;
+            nearRange = farRange = 0;
+            for (size_t pos = 0, prev = x.size() - 1; pos < x.size(); prev = pos++) {
+                double edgeX = x[pos] - x[prev];
+                double edgeY = y[pos] - y[prev];
+                double denom = dirX * edgeY - dirY * edgeX;
+                if (fabs(denom) < 1e-12) continue;
+
+                double t = (x[prev] * edgeY - y[prev] * edgeX) / denom;
+                double s = (x[prev] * dirY - y[prev] * dirX) / denom;
+                if (t < 0 || s < 0 || s > 1) continue;
+
+                if (!hit || t < nearRange) nearRange = t;
+                if (!hit || t > farRange) farRange = t;
+                hit = true;
+            }
+            return hit;
+        }
+
+        static double _wrapAngle(double angle)
+        {
+            angle = fmod(angle, 2.0 * M_PI);
+            return angle < 0 ? angle + 2.0 * M_PI : angle;
+        }
+
+        static void _buildPolygonBins(Zone& zone, const float* inputX, const float* inputY, size_t vertexCount)
+        {
+            std::vector<double> x(inputX, inputX + vertexCount);
+            std::vector<double> y(inputY, inputY + vertexCount);
+            bool originInside = _isOriginInside(x, y);
+
+            // besides the bin boundaries, the extremes of the distances along the rays lie at the
+            // vertex angles and at the feet of the perpendiculars to the edges
+            std::vector<double> criticalAngles;
+            for (size_t pos = 0, prev = vertexCount - 1; pos < vertexCount; prev = pos++) {
+                criticalAngles.push_back(_wrapAngle(atan2(y[pos], x[pos])));
+
+                double edgeX = x[pos] - x[prev];
+                double edgeY = y[pos] - y[prev];
+                double length2 = edgeX * edgeX + edgeY * edgeY;
+                if (length2 <= 0) continue;
+                double s = -(x[prev] * edgeX + y[prev] * edgeY) / length2;
+                if (s <= 0 || s >= 1) continue;
+                criticalAngles.push_back(_wrapAngle(atan2(y[prev] + edgeY * s, x[prev] + edgeX * s)));
+            }
+            std::sort(criticalAngles.begin(), criticalAngles.end());
+
+            size_t critical = 0;
+            for (size_t binPos = 0; binPos < ZONE_BIN_COUNT; ++binPos) {
+                double binStart = binPos * ZONE_BIN_ANGLE;
+                double binEnd = binStart + ZONE_BIN_ANGLE;
+
+                double nearRange = 0, farRange = 0;
+                bool hit = false;
+                double rayNear, rayFar;
+
+                if (_castRay(x, y, binStart, rayNear, rayFar)) {
+                    nearRange = rayNear; farRange = rayFar; hit = true;
+                }
+                if (_castRay(x, y, binEnd, rayNear, rayFar)) {
+                    if (!hit || rayNear < nearRange) nearRange = rayNear;
+                    if (!hit || rayFar > farRange) farRange = rayFar;
+                    hit = true;
+                }
+                for (; critical < criticalAngles.size() && criticalAngles[critical] < binEnd; ++critical) {
+                    if (!_castRay(x, y, criticalAngles[critical], rayNear, rayFar)) continue;
+                    if (!hit || rayNear < nearRange) nearRange = rayNear;
+                    if (!hit || rayFar > farRange) farRange = rayFar;
+                    hit = true;
+                }
+
+                if (!hit) continue;
+                _setBin(zone.bins[binPos], originInside ? 0 : nearRange, farRange);
+            }
+        }
+
+        void _evaluateZone(Zone& zone, const sl_lidar_response_measurement_node_hq_t* nodes, const sl_u64* timestamps_uS, size_t count)
+        {
+            const ZoneBin* bins = &zone.bins[0];
+            for (size_t pos = 0; pos < count; ++pos) {
+                const ZoneBin& bin = bins[nodes[pos].angle_z_q14 >> ZONE_BIN_SHIFT];
+                if (nodes[pos].dist_mm_q2 - bin.near >= bin.width) continue;
+
+                if (++zone.hitCount >= zone.minPoints && !zone.intruded) {
+                    zone.intruded = true;
+                    _notify(zone, true, timestamps_uS[pos], &nodes[pos]);
+                }
+            }
+        }
+
+        void _finishRevolution(sl_u64 timestamp_uS)
+        {
+            for (size_t pos = 0; pos < _zones.size(); ++pos) {
+                Zone& zone = *_zones[pos];
+                if (zone.intruded && !zone.hitCount) {
+                    zone.intruded = false;
+                    _notify(zone, false, timestamp_uS, NULL);
+                }
+                zone.hitCount = 0;
+            }
+        }
+
+        void _notify(const Zone& zone, bool intruded, sl_u64 timestamp_uS, const sl_lidar_response_measurement_node_hq_t* node)
+        {
+            if (!_callback) return;
+
+            LidarSafetyEvent event;
+            event.zoneId = zone.id;
+            event.intruded = intruded;
+            event.timestamp_uS = timestamp_uS;
+            if (node) {
+                event.angle = node->angle_z_q14 * (90.f / 16384.f);
+                event.range = node->dist_mm_q2 * (1.f / 4.f);
+            }
+            _callback(event);
+        }
+
+        rp::hal::Locker      _locker;
+        std::vector<Zone*>   _zones;
+        LidarSafetyCallback  _callback;
+    };
+
+    Result<ILidarSafetyMonitor*> createLidarSafetyMonitor()
+    {
+        return new LidarSafetyMonitor();
+    }
+
+}
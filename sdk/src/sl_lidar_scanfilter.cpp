@@ -0,0 +1,610 @@
+/*
+ *  Slamtec LIDAR SDK
+ *
+ *  Copyright (c) 2014 - 2023 Shanghai Slamtec Co., Ltd.
+ *  http://www.slamtec.com
+ *
+ */
+ /*
+  * Redistribution and use in source and binary forms, with or without
+  * modification, are permitted provided that the following conditions are met:
+  *
+  * 1. Redistributions of source code must retain the above copyright notice,
+  *    this list of conditions and the following disclaimer.
+  *
+  * 2. Redistributions in binary form must reproduce the above copyright notice,
+  *    this list of conditions and the following disclaimer in the documentation
+  *    and/or other materials provided with the distribution.
+  *
+  * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+  * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+  * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+  * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+  * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+  * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+  * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+  * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+  * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+  * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+  * EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+  *
+  */
+
+#include "sl_lidar_scanfilter.h"
+#include <math.h>
+#include <float.h>
+#include <string.h>
+#include <algorithm>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define SL_SCANFILTER_SSE2
+#include <emmintrin.h>
+#endif
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+// compiled with the target attribute and selected at runtime
+#define SL_SCANFILTER_AVX2
+#include <immintrin.h>
+#endif
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#define SL_SCANFILTER_NEON
+#include <arm_neon.h>
+#endif
+
+namespace sl {
+
+    static const float DEGREE_TO_RADIAN = (float)(M_PI / 180.0);
+
+    // bit 0: the first node of a pair is a veiling point, bit 1: the second one
+    enum {
+        SHADOW_FIRST = 1,
+        SHADOW_SECOND = 2,
+    };
+
+    static inline sl_u8 shadowPair(float angle0, float angle1, float range0, float range1, float tanMinAngle, float maxGap)
+    {
+        float gap = (angle1 - angle0) * DEGREE_TO_RADIAN;
+        if (!(gap > 0 && gap <= maxGap && range0 > 0 && range1 > 0)) return 0;
+
+        // the gap is small, sin and cos are replaced by their Taylor expansions
+        float height = range1 * gap;
+        float along = fabsf(range0 - range1 * (1.f - 0.5f * gap * gap));
+        if (height >= tanMinAngle * along) return 0;
+        return range0 > range1 ? SHADOW_FIRST : SHADOW_SECOND;
+    }
+
+    static inline float median3(float a, float b, float c)
+    {
+        return std::max(std::min(a, b), std::min(std::max(a, b), c));
+    }
+
+    static inline float median5(float a, float b, float c, float d, float e)
+    {
+        return median3(e, std::max(std::min(a, b), std::min(c, d)), std::min(std::max(a, b), std::max(c, d)));
+    }
+
+    // the following routines return the number of elements processed, the remaining ones are left to the other paths
+
+#ifdef SL_SCANFILTER_AVX2
+    static bool _isAVX2Supported()
+    {
+        static const bool supported = __builtin_cpu_supports("avx2");
+        return supported;
+    }
+
+    struct CompactLUT
+    {
+        // lanes to gather for every 8-bit mask, the kept ones first
+        sl_s32 lanes[256][8];
+
+        CompactLUT()
+        {
+            for (int mask = 0; mask < 256; ++mask) {
+                int out = 0;
+                for (int lane = 0; lane < 8; ++lane) {
+                    if (mask & (1 << lane)) lanes[mask][out++] = lane;
+                }
+                while (out < 8) lanes[mask][out++] = 0;
+            }
+        }
+    };
+
+    static const CompactLUT& getCompactLUT()
+    {
+        static CompactLUT lut;
+        return lut;
+    }
+
+    __attribute__((target("avx2")))
+    static size_t _compact_avx2(const sl_u8* keep, size_t count, float* angle, float* range, sl_u8* quality, sl_u8* flag, size_t& out)
+    {
+        const CompactLUT& lut = getCompactLUT();
+
+        size_t pos = 0;
+        for (; pos + 8 <= count; pos += 8) {
+            int mask = _mm_movemask_epi8(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(keep + pos)));
+            if (!mask) continue;
+
+            // the stores never pass the block being read, it is loaded before
+            __m256i lanes = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(lut.lanes[mask]));
+            _mm256_storeu_ps(angle + out, _mm256_permutevar8x32_ps(_mm256_loadu_ps(angle + pos), lanes));
+            _mm256_storeu_ps(range + out, _mm256_permutevar8x32_ps(_mm256_loadu_ps(range + pos), lanes));
+
+            for (int bits = mask; bits; bits &= bits - 1) {
+                int lane = __builtin_ctz(bits);
+                quality[out] = quality[pos + lane];
+                flag[out] = flag[pos + lane];
+                ++out;
+            }
+        }
+        return pos;
+    }
+
+    __attribute__((target("avx2")))
+    static size_t _median3_avx2(const float* padded, size_t count, float* range)
+    {
+        size_t pos = 0;
+        for (; pos + 8 <= count; pos += 8) {
+            __m256 a = _mm256_loadu_ps(padded + pos);
+            __m256 b = _mm256_loadu_ps(padded + pos + 1);
+            __m256 c = _mm256_loadu_ps(padded + pos + 2);
+            __m256 value = _mm256_max_ps(_mm256_min_ps(a, b), _mm256_min_ps(_mm256_max_ps(a, b), c));
+            _mm256_storeu_ps(range + pos, value);
+        }
+        return pos;
+    }
+
+    __attribute__((target("avx2")))
+    static size_t _median5_avx2(const float* padded, size_t count, float* range)
+    {
+        size_t pos = 0;
+        for (; pos + 8 <= count; pos += 8) {
+            __m256 a = _mm256_loadu_ps(padded + pos);
+            __m256 b = _mm256_loadu_ps(padded + pos + 1);
+            __m256 c = _mm256_loadu_ps(padded + pos + 2);
+            __m256 d = _mm256_loadu_ps(padded + pos + 3);
+            __m256 e = _mm256_loadu_ps(padded + pos + 4);
+            __m256 low = _mm256_max_ps(_mm256_min_ps(a, b), _mm256_min_ps(c, d));
+            __m256 high = _mm256_min_ps(_mm256_max_ps(a, b), _mm256_max_ps(c, d));
+            __m256 value = _mm256_max_ps(_mm256_min_ps(e, low), _mm256_min_ps(_mm256_max_ps(e, low), high));
+            _mm256_storeu_ps(range + pos, value);
+        }
+        return pos;
+    }
+#endif
+
+#ifdef SL_SCANFILTER_SSE2
+    static size_t _maskRange_sse2(const float* range, size_t count, float minRange, float maxRange, sl_u8* keep)
+    {
+        const __m128 low = _mm_set1_ps(minRange);
+        const __m128 high = _mm_set1_ps(maxRange);
+
+        size_t pos = 0;
+        for (; pos + 16 <= count; pos += 16) {
+            __m128i inside[4];
+            for (int block = 0; block < 4; ++block) {
+                __m128 value = _mm_loadu_ps(range + pos + block * 4);
+                inside[block] = _mm_castps_si128(_mm_and_ps(_mm_cmpge_ps(value, low), _mm_cmple_ps(value, high)));
+            }
+            // the all-ones lanes saturate into 0xFF bytes
+            __m128i mask = _mm_packs_epi16(_mm_packs_epi32(inside[0], inside[1]), _mm_packs_epi32(inside[2], inside[3]));
+            __m128i* dest = reinterpret_cast<__m128i*>(keep + pos);
+            _mm_storeu_si128(dest, _mm_and_si128(_mm_loadu_si128(dest), mask));
+        }
+        return pos;
+    }
+
+    static size_t _maskQuality_sse2(const sl_u8* quality, size_t count, sl_u8 minQuality, sl_u8* keep)
+    {
+        const __m128i threshold = _mm_set1_epi8((char)minQuality);
+
+        size_t pos = 0;
+        for (; pos + 16 <= count; pos += 16) {
+            __m128i value = _mm_loadu_si128(reinterpret_cast<const __m128i*>(quality + pos));
+            // there is no unsigned byte compare in SSE2: value >= threshold <=> max(value, threshold) == value
+            __m128i mask = _mm_cmpeq_epi8(_mm_max_epu8(value, threshold), value);
+            __m128i* dest = reinterpret_cast<__m128i*>(keep + pos);
+            _mm_storeu_si128(dest, _mm_and_si128(_mm_loadu_si128(dest), mask));
+        }
+        return pos;
+    }
+
+    static size_t _median3_sse2(const float* padded, size_t count, float* range)
+    {
+        size_t pos = 0;
+        for (; pos + 4 <= count; pos += 4) {
+            __m128 a = _mm_loadu_ps(padded + pos);
+            __m128 b = _mm_loadu_ps(padded + pos + 1);
+            __m128 c = _mm_loadu_ps(padded + pos + 2);
+            _mm_storeu_ps(range + pos, _mm_max_ps(_mm_min_ps(a, b), _mm_min_ps(_mm_max_ps(a, b), c)));
+        }
+        return pos;
+    }
+
+    static size_t _median5_sse2(const float* padded, size_t count, float* range)
+    {
+        size_t pos = 0;
+        for (; pos + 4 <= count; pos += 4) {
+            __m128 a = _mm_loadu_ps(padded + pos);
+            __m128 b = _mm_loadu_ps(padded + pos + 1);
+            __m128 c = _mm_loadu_ps(padded + pos + 2);
+            __m128 d = _mm_loadu_ps(padded + pos + 3);
+            __m128 e = _mm_loadu_ps(padded + pos + 4);
+            __m128 low = _mm_max_ps(_mm_min_ps(a, b), _mm_min_ps(c, d));
+            __m128 high = _mm_min_ps(_mm_max_ps(a, b), _mm_max_ps(c, d));
+            _mm_storeu_ps(range + pos, _mm_max_ps(_mm_min_ps(e, low), _mm_min_ps(_mm_max_ps(e, low), high)));
+        }
+        return pos;
+    }
+
+    static size_t _markShadows_sse2(const float* angle, const float* range, size_t pairCount, float tanMinAngle, float maxGap, sl_u8* pairs)
+    {
+        const __m128 zero = _mm_setzero_ps();
+        const __m128 one = _mm_set1_ps(1.f);
+        const __m128 half = _mm_set1_ps(0.5f);
+        const __m128 signMask = _mm_castsi128_ps(_mm_set1_epi32(0x7FFFFFFF));
+        const __m128 toRadian = _mm_set1_ps(DEGREE_TO_RADIAN);
+        const __m128 gapLimit = _mm_set1_ps(maxGap);
+        const __m128 tanLimit = _mm_set1_ps(tanMinAngle);
+        const __m128i firstCode = _mm_set1_epi32(SHADOW_FIRST);
+        const __m128i secondCode = _mm_set1_epi32(SHADOW_SECOND);
+
+        size_t pos = 0;
+        for (; pos + 4 <= pairCount; pos += 4) {
+            __m128 range0 = _mm_loadu_ps(range + pos);
+            __m128 range1 = _mm_loadu_ps(range + pos + 1);
+            __m128 gap = _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(angle + pos + 1), _mm_loadu_ps(angle + pos)), toRadian);
+
+            __m128 valid = _mm_and_ps(_mm_and_ps(_mm_cmpgt_ps(gap, zero), _mm_cmple_ps(gap, gapLimit)),
+                _mm_and_ps(_mm_cmpgt_ps(range0, zero), _mm_cmpgt_ps(range1, zero)));
+
+            __m128 height = _mm_mul_ps(range1, gap);
+            __m128 cosGap = _mm_sub_ps(one, _mm_mul_ps(half, _mm_mul_ps(gap, gap)));
+            __m128 along = _mm_and_ps(_mm_sub_ps(range0, _mm_mul_ps(range1, cosGap)), signMask);
+            __m128 veil = _mm_and_ps(valid, _mm_cmplt_ps(height, _mm_mul_ps(tanLimit, along)));
+
+            __m128i first = _mm_castps_si128(_mm_and_ps(veil, _mm_cmpgt_ps(range0, range1)));
+            __m128i second = _mm_andnot_si128(first, _mm_castps_si128(veil));
+            __m128i code = _mm_or_si128(_mm_and_si128(first, firstCode), _mm_and_si128(second, secondCode));
+
+            __m128i packed = _mm_packs_epi16(_mm_packs_epi32(code, _mm_setzero_si128()), _mm_setzero_si128());
+            sl_s32 bytes = _mm_cvtsi128_si32(packed);
+            memcpy(pairs + pos, &bytes, sizeof(bytes));
+        }
+        return pos;
+    }
+#endif
+
+#ifdef SL_SCANFILTER_NEON
+    static size_t _maskRange_neon(const float* range, size_t count, float minRange, float maxRange, sl_u8* keep)
+    {
+        const float32x4_t low = vdupq_n_f32(minRange);
+        const float32x4_t high = vdupq_n_f32(maxRange);
+
+        size_t pos = 0;
+        for (; pos + 16 <= count; pos += 16) {
+            uint16x4_t inside[4];
+            for (int block = 0; block < 4; ++block) {
+                float32x4_t value = vld1q_f32(range + pos + block * 4);
+                inside[block] = vmovn_u32(vandq_u32(vcgeq_f32(value, low), vcleq_f32(value, high)));
+            }
+            uint8x16_t mask = vcombine_u8(vmovn_u16(vcombine_u16(inside[0], inside[1])), vmovn_u16(vcombine_u16(inside[2], inside[3])));
+            vst1q_u8(keep + pos, vandq_u8(vld1q_u8(keep + pos), mask));
+        }
+        return pos;
+    }
+
+    static size_t _maskQuality_neon(const sl_u8* quality, size_t count, sl_u8 minQuality, sl_u8* keep)
+    {
+        const uint8x16_t threshold = vdupq_n_u8(minQuality);
+
+        size_t pos = 0;
+        for (; pos + 16 <= count; pos += 16) {
+            uint8x16_t mask = vcgeq_u8(vld1q_u8(quality + pos), threshold);
+            vst1q_u8(keep + pos, vandq_u8(vld1q_u8(keep + pos), mask));
+        }
+        return pos;
+    }
+
+    static size_t _median3_neon(const float* padded, size_t count, float* range)
+    {
+        size_t pos = 0;
+        for (; pos + 4 <= count; pos += 4) {
+            float32x4_t a = vld1q_f32(padded + pos);
+            float32x4_t b = vld1q_f32(padded + pos + 1);
+            float32x4_t c = vld1q_f32(padded + pos + 2);
+            vst1q_f32(range + pos, vmaxq_f32(vminq_f32(a, b), vminq_f32(vmaxq_f32(a, b), c)));
+        }
+        return pos;
+    }
+
+    static size_t _median5_neon(const float* padded, size_t count, float* range)
+    {
+        size_t pos = 0;
+        for (; pos + 4 <= count; pos += 4) {
+            float32x4_t a = vld1q_f32(padded + pos);
+            float32x4_t b = vld1q_f32(padded + pos + 1);
+            float32x4_t c = vld1q_f32(padded + pos + 2);
+            float32x4_t d = vld1q_f32(padded + pos + 3);
+            float32x4_t e = vld1q_f32(padded + pos + 4);
+            float32x4_t low = vmaxq_f32(vminq_f32(a, b), vminq_f32(c, d));
+            float32x4_t high = vminq_f32(vmaxq_f32(a, b), vmaxq_f32(c, d));
+            vst1q_f32(range + pos, vmaxq_f32(vminq_f32(e, low), vminq_f32(vmaxq_f32(e, low), high)));
+        }
+        return pos;
+    }
+#endif
+
+    static void _maskRange(const float* range, size_t count, float minRange, float maxRange, sl_u8* keep)
+    {
+        size_t pos = 0;
+#ifdef SL_SCANFILTER_SSE2
+        pos += _maskRange_sse2(range, count, minRange, maxRange, keep);
+#endif
+#ifdef SL_SCANFILTER_NEON
+        pos += _maskRange_neon(range, count, minRange, maxRange, keep);
+#endif
+        for (; pos < count; ++pos) {
+            if (!(range[pos] >= minRange && range[pos] <= maxRange)) keep[pos] = 0;
+        }
+    }
+
+    static void _maskQuality(const sl_u8* quality, size_t count, sl_u8 minQuality, sl_u8* keep)
+    {
+        size_t pos = 0;
+#ifdef SL_SCANFILTER_SSE2
+        pos += _maskQuality_sse2(quality, count, minQuality, keep);
+#endif
+#ifdef SL_SCANFILTER_NEON
+        pos += _maskQuality_neon(quality, count, minQuality, keep);
+#endif
+        for (; pos < count; ++pos) {
+            if (quality[pos] < minQuality) keep[pos] = 0;
+        }
+    }
+
+    LidarScanFilterPipeline::LidarScanFilterPipeline()
+        : _maskPending(false)
+    {
+    }
+
+    void LidarScanFilterPipeline::clear()
+    {
+        _stages.clear();
+    }
+
+    void LidarScanFilterPipeline::addRangeGate(float minRange, float maxRange)
+    {
+        Stage stage = { STAGE_RANGE_GATE, minRange, maxRange, 0 };
+        _stages.push_back(stage);
+    }
+
+    void LidarScanFilterPipeline::addQualityThreshold(sl_u8 minQuality)
+    {
+        Stage stage = { STAGE_QUALITY_THRESHOLD, (float)minQuality, 0, 0 };
+        _stages.push_back(stage);
+    }
+
+    void LidarScanFilterPipeline::addMedian(size_t windowSize)
+    {
+        windowSize = std::min<size_t>(std::max<size_t>(windowSize, 3), MAX_MEDIAN_WINDOW) | 1;
+        Stage stage = { STAGE_MEDIAN, 0, 0, windowSize };
+        _stages.push_back(stage);
+    }
+
+    void LidarScanFilterPipeline::addShadowRemoval(float minAngle, float maxGap)
+    {
+        Stage stage = { STAGE_SHADOW_REMOVAL, minAngle, maxGap, 0 };
+        _stages.push_back(stage);
+    }
+
+    void LidarScanFilterPipeline::addAngularDownsample(float binAngle)
+    {
+        Stage stage = { STAGE_ANGULAR_DOWNSAMPLE, binAngle, 0, 0 };
+        _stages.push_back(stage);
+    }
+
+    size_t LidarScanFilterPipeline::apply(LidarScanFrame& frame)
+    {
+        _maskPending = false;
+
+        for (size_t pos = 0; pos < _stages.size(); ++pos) {
+            const Stage& stage = _stages[pos];
+
+            switch (stage.type) {
+            case STAGE_RANGE_GATE:
+                if (!_maskPending) _resetMask(frame.size());
+                _maskRange(frame.range(), frame.size(), stage.param0, stage.param1, &_keep[0]);
+                _maskPending = true;
+                break;
+
+            case STAGE_QUALITY_THRESHOLD:
+                if (!_maskPending) _resetMask(frame.size());
+                _maskQuality(frame.quality(), frame.size(), (sl_u8)stage.param0, &_keep[0]);
+                _maskPending = true;
+                break;
+
+            case STAGE_MEDIAN:
+                if (_maskPending) _compact(frame);
+                _median(frame, stage.window);
+                break;
+
+            case STAGE_SHADOW_REMOVAL:
+                if (_maskPending) _compact(frame);
+                _resetMask(frame.size());
+                _markShadows(frame, stage.param0, stage.param1);
+                _maskPending = true;
+                break;
+
+            case STAGE_ANGULAR_DOWNSAMPLE:
+                if (_maskPending) _compact(frame);
+                _resetMask(frame.size());
+                _markDownsample(frame, stage.param0);
+                _maskPending = true;
+                break;
+            }
+        }
+
+        if (_maskPending) _compact(frame);
+        return frame.size();
+    }
+
+    void LidarScanFilterPipeline::_resetMask(size_t count)
+    {
+        // one extra byte so that &_keep[0] is valid for an empty frame
+        if (_keep.size() < count + 1) _keep.resize(count + 1);
+        memset(&_keep[0], 0xFF, count);
+    }
+
+    size_t LidarScanFilterPipeline::_compact(LidarScanFrame& frame)
+    {
+        const sl_u8* keep = &_keep[0];
+        size_t count = frame.size();
+        float* angle = frame.angle();
+        float* range = frame.range();
+        sl_u8* quality = frame.quality();
+        sl_u8* flag = frame.flag();
+
+        size_t out = 0;
+        size_t pos = 0;
+
+#ifdef SL_SCANFILTER_AVX2
+        if (_isAVX2Supported()) {
+            pos += _compact_avx2(keep, count, angle, range, quality, flag, out);
+        }
+#endif
+        for (; pos < count; ++pos) {
+            if (!keep[pos]) continue;
+            angle[out] = angle[pos];
+            range[out] = range[pos];
+            quality[out] = quality[pos];
+            flag[out] = flag[pos];
+            ++out;
+        }
+
+        frame.resize(out);
+        _maskPending = false;
+        return out;
+    }
+
+    void LidarScanFilterPipeline::_median(LidarScanFrame& frame, size_t windowSize)
+    {
+        size_t count = frame.size();
+        if (count < windowSize) return;
+
+        // the ranges with the ends of the scan wrapped around on both sides
+        size_t half = windowSize / 2;
+        if (_scratch.size() < count + windowSize) _scratch.resize(count + windowSize);
+        float* padded = &_scratch[0];
+        float* range = frame.range();
+        memcpy(padded, range + count - half, half * sizeof(float));
+        memcpy(padded + half, range, count * sizeof(float));
+        memcpy(padded + half + count, range, half * sizeof(float));
+
+        size_t pos = 0;
+        if (windowSize == 3) {
+#ifdef SL_SCANFILTER_AVX2
+            if (_isAVX2Supported()) pos += _median3_avx2(padded, count, range);
+#endif
+#ifdef SL_SCANFILTER_SSE2
+            pos += _median3_sse2(padded + pos, count - pos, range + pos);
+#endif
+#ifdef SL_SCANFILTER_NEON
+            pos += _median3_neon(padded + pos, count - pos, range + pos);
+#endif
+            for (; pos < count; ++pos) {
+                range[pos] = median3(padded[pos], padded[pos + 1], padded[pos + 2]);
+            }
+        }
+        else if (windowSize == 5) {
+#ifdef SL_SCANFILTER_AVX2
+            if (_isAVX2Supported()) pos += _median5_avx2(padded, count, range);
+#endif
+#ifdef SL_SCANFILTER_SSE2
+            pos += _median5_sse2(padded + pos, count - pos, range + pos);
+#endif
+#ifdef SL_SCANFILTER_NEON
+            pos += _median5_neon(padded + pos, count - pos, range + pos);
+#endif
+            for (; pos < count; ++pos) {
+                range[pos] = median5(padded[pos], padded[pos + 1], padded[pos + 2], padded[pos + 3], padded[pos + 4]);
+            }
+        }
+        else {
+            float window[MAX_MEDIAN_WINDOW];
+            for (; pos < count; ++pos) {
+                memcpy(window, padded + pos, windowSize * sizeof(float));
+                std::nth_element(window, window + half, window + windowSize);
+                range[pos] = window[half];
+            }
+        }
+    }
+
+    void LidarScanFilterPipeline::_markShadows(const LidarScanFrame& frame, float minAngle, float maxGap)
+    {
+        size_t count = frame.size();
+        if (count < 2) return;
+
+        const float* angle = frame.angle();
+        const float* range = frame.range();
+        float tanMinAngle = tanf(minAngle * DEGREE_TO_RADIAN);
+        float gapLimit = maxGap * DEGREE_TO_RADIAN;
+
+        // pairs[i] tells which node of the pair (i, i + 1) is a veiling point
+        size_t pairCount = count - 1;
+        if (_pairs.size() < pairCount) _pairs.resize(pairCount);
+        sl_u8* pairs = &_pairs[0];
+
+        size_t pos = 0;
+#ifdef SL_SCANFILTER_SSE2
+        pos += _markShadows_sse2(angle, range, pairCount, tanMinAngle, gapLimit, pairs);
+#endif
+        for (; pos < pairCount; ++pos) {
+            pairs[pos] = shadowPair(angle[pos], angle[pos + 1], range[pos], range[pos + 1], tanMinAngle, gapLimit);
+        }
+
+        sl_u8* keep = &_keep[0];
+        for (pos = 0; pos < pairCount; ++pos) {
+            if (!pairs[pos]) continue;
+            if (pairs[pos] & SHADOW_FIRST) keep[pos] = 0;
+            if (pairs[pos] & SHADOW_SECOND) keep[pos + 1] = 0;
+        }
+    }
+
+    void LidarScanFilterPipeline::_markDownsample(const LidarScanFrame& frame, float binAngle)
+    {
+        size_t count = frame.size();
+        if (!count || !(binAngle > 0)) return;
+
+        const float* angle = frame.angle();
+        const float* range = frame.range();
+        sl_u8* keep = &_keep[0];
+        float binScale = 1.f / binAngle;
+
+        // an invalid node is only kept if its whole run is invalid
+        sl_s32 currentBin = (sl_s32)floorf(angle[0] * binScale);
+        size_t best = 0;
+        float bestRange = range[0] > 0 ? range[0] : FLT_MAX;
+
+        for (size_t pos = 1; pos < count; ++pos) {
+            sl_s32 bin = (sl_s32)floorf(angle[pos] * binScale);
+            float value = range[pos] > 0 ? range[pos] : FLT_MAX;
+
+            if (bin != currentBin) {
+                currentBin = bin;
+                best = pos;
+                bestRange = value;
+            }
+            else if (value < bestRange) {
+                keep[best] = 0;
+                best = pos;
+                bestRange = value;
+            }
+            else {
+                keep[pos] = 0;
+            }
+        }
+    }
+
+}
@@ -0,0 +1,124 @@
+/*
+ *  Slamtec LIDAR SDK
+ *
+ *  Copyright (c) 2014 - 2023 Shanghai Slamtec Co., Ltd.
+ *  http://www.slamtec.com
+ *
+ */
+ /*
+  * Redistribution and use in source and binary forms, with or without
+  * modification, are permitted provided that the following conditions are met:
+  *
+  * 1. Redistributions of source code must retain the above copyright notice,
+  *    this list of conditions and the following disclaimer.
+  *
+  * 2. Redistributions in binary form must reproduce the above copyright notice,
+  *    this list of conditions and the following disclaimer in the documentation
+  *    and/or other materials provided with the distribution.
+  *
+  * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+  * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+  * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+  * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+  * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+  * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+  * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+  * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+  * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+  * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+  * EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+  *
+  */
+
+#include "sl_lidar_scanframe.h"
+#include <stdlib.h>
+
+namespace sl {
+
+    static inline size_t alignSize(size_t size, size_t alignment)
+    {
+        return (size + alignment - 1) & ~(alignment - 1);
+    }
+
+    LidarScanFrame::LidarScanFrame(size_t capacity)
+        : _storage(NULL)
+        , _capacity(0)
+        , _count(0)
+        , _timestamp_uS(0)
+        , _angle(NULL)
+        , _range(NULL)
+        , _quality(NULL)
+        , _flag(NULL)
+    {
+        reserve(capacity);
+    }
+
+    LidarScanFrame::~LidarScanFrame()
+    {
+        _release();
+    }
+
+    void LidarScanFrame::_release()
+    {
+        free(_storage);
+        _storage = NULL;
+        _capacity = 0;
+        _count = 0;
+        _angle = _range = NULL;
+        _quality = _flag = NULL;
+    }
+
+    void LidarScanFrame::reserve(size_t capacity)
+    {
+        if (capacity <= _capacity) return;
+
+        _release();
+
+        capacity = alignSize(capacity, ARRAY_GRANULARITY);
+
+        // all the arrays share one allocation, each of them starts on an aligned boundary
+        size_t floatArraySize = alignSize(capacity * sizeof(float), ARRAY_ALIGNMENT);
+        size_t byteArraySize = alignSize(capacity * sizeof(sl_u8), ARRAY_ALIGNMENT);
+        size_t totalSize = floatArraySize * 2 + byteArraySize * 2 + ARRAY_ALIGNMENT;
+
+        _storage = malloc(totalSize);
+        if (!_storage) return;
+
+        sl_u8* base = (sl_u8*)alignSize((size_t)_storage, ARRAY_ALIGNMENT);
+        _angle = (float*)base;
+        _range = (float*)(base + floatArraySize);
+        _quality = base + floatArraySize * 2;
+        _flag = base + floatArraySize * 2 + byteArraySize;
+        _capacity = capacity;
+    }
+
+    void LidarScanFrame::resize(size_t count)
+    {
+        if (count > _capacity) {
+            reserve(count);
+            if (count > _capacity) return;
+        }
+        _count = count;
+    }
+
+    void LidarScanFrame::assign(const sl_lidar_response_measurement_node_hq_t* nodes, size_t count, sl_u64 timestamp_uS)
+    {
+        _count = 0;
+        _timestamp_uS = timestamp_uS;
+        resize(count);
+
+        float* angle = _angle;
+        float* range = _range;
+        sl_u8* quality = _quality;
+        sl_u8* flag = _flag;
+
+        for (size_t pos = 0; pos < _count; ++pos) {
+            const sl_lidar_response_measurement_node_hq_t& node = nodes[pos];
+            angle[pos] = node.angle_z_q14 * (90.f / 16384.f);
+            range[pos] = node.dist_mm_q2 * (1.f / 4.f);
+            quality[pos] = node.quality;
+            flag[pos] = node.flag;
+        }
+    }
+
+}
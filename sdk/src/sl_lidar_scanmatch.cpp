@@ -0,0 +1,778 @@
+/*
+ *  Slamtec LIDAR SDK
+ *
+ *  Copyright (c) 2014 - 2023 Shanghai Slamtec Co., Ltd.
+ *  http://www.slamtec.com
+ *
+ */
+ /*
+  * Redistribution and use in source and binary forms, with or without
+  * modification, are permitted provided that the following conditions are met:
+  *
+  * 1. Redistributions of source code must retain the above copyright notice,
+  *    this list of conditions and the following disclaimer.
+  *
+  * 2. Redistributions in binary form must reproduce the above copyright notice,
+  *    this list of conditions and the following disclaimer in the documentation
+  *    and/or other materials provided with the distribution.
+  *
+  * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+  * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+  * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+  * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+  * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+  * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+  * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+  * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+  * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+  * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+  * EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+  *
+  */
+
+#include "sdkcommon.h"
+#include "hal/thread.h"
+#include "hal/types.h"
+#include "hal/event.h"
+#include "sl_lidar_driver.h"
+#include "sl_lidar_scanmatch.h"
+#include "sl_lidar_projection.h"
+#include "sl_thread_config.h"
+
+#include <math.h>
+#include <float.h>
+#include <vector>
+#include <atomic>
+#include <algorithm>
+
+namespace sl {
+
+    enum {
+        // the likelihood of a cell next to a reference point, splatted with a gaussian over this radius (in cells)
+        LIKELIHOOD_KERNEL_RADIUS = 2,
+        LIKELIHOOD_MAX = 255,
+
+        // scan order neighbors on each side used to estimate the normal of a reference point
+        NORMAL_NEIGHBOR_COUNT = 2,
+
+        MIN_MATCH_POINT_COUNT = 10,
+    };
+
+    struct MatchPoint
+    {
+        float x;
+        float y;
+    };
+
+    static inline LidarPose2D composePose(const LidarPose2D& base, const LidarPose2D& motion)
+    {
+        float cosYaw = cosf(base.yaw), sinYaw = sinf(base.yaw);
+        float yaw = base.yaw + motion.yaw;
+        yaw = atan2f(sinf(yaw), cosf(yaw));
+        return LidarPose2D(motion.timestamp_uS, base.x + cosYaw * motion.x - sinYaw * motion.y, base.y + sinYaw * motion.x + cosYaw * motion.y, yaw);
+    }
+
+    // take count points evenly spaced in the scan order
+    static void subsamplePoints(const std::vector<MatchPoint>& points, size_t count, std::vector<MatchPoint>& out)
+    {
+        out.clear();
+        if (!count || points.size() <= count) {
+            out = points;
+            return;
+        }
+        double step = (double)points.size() / count;
+        for (size_t pos = 0; pos < count; ++pos) {
+            out.push_back(points[(size_t)(pos * step)]);
+        }
+    }
+
+    class LidarScanMatcher : public ILidarScanMatcher
+    {
+    public:
+        LidarScanMatcher(const LidarScanMatchOptions& options)
+            : _options(options)
+            , _hasReference(false)
+            , _gridWidth(0)
+            , _gridHeight(0)
+            , _gridOriginX(0)
+            , _gridOriginY(0)
+            , _nnWidth(0)
+            , _nnHeight(0)
+            , _nnOriginX(0)
+            , _nnOriginY(0)
+            , _isRunning(true)
+            , _nextWorkerIndex(0)
+            , _pendingWorkers(0)
+            , _doneEvt(true, false)
+            , _hasTrackedScan(false)
+        {
+            if (_options.gridLevels < 1) _options.gridLevels = 1;
+            if (_options.gridLevels > 8) _options.gridLevels = 8;
+            if (!(_options.gridResolution > 0)) _options.gridResolution = 50;
+            if (!(_options.icpMaxCorrespondenceDistance > 0)) _options.icpMaxCorrespondenceDistance = 200;
+            if (_options.threadCount < 1) _options.threadCount = 1;
+
+            _scratches.resize(_options.threadCount);
+            for (size_t pos = 1; pos < _options.threadCount; ++pos) {
+                _startEvts.push_back(new rp::hal::Event(true, false));
+            }
+            for (size_t pos = 1; pos < _options.threadCount; ++pos) {
+                _workers.push_back(CLASS_THREAD(LidarScanMatcher, _proc_worker));
+            }
+        }
+
+        virtual ~LidarScanMatcher()
+        {
+            _isRunning = false;
+            for (size_t pos = 0; pos < _startEvts.size(); ++pos) {
+                _startEvts[pos]->set();
+            }
+            for (size_t pos = 0; pos < _workers.size(); ++pos) {
+                _workers[pos].join();
+            }
+            for (size_t pos = 0; pos < _startEvts.size(); ++pos) {
+                delete _startEvts[pos];
+            }
+        }
+
+        sl_result setReference(const float* x, const float* y, size_t count)
+        {
+            if (!x || !y) return SL_RESULT_INVALID_DATA;
+
+            _hasReference = false;
+            _filterPoints(x, y, count, _refPoints);
+            if (_refPoints.size() < MIN_MATCH_POINT_COUNT) return SL_RESULT_OPERATION_FAIL;
+
+            _buildNormals();
+            _buildNeighborGrid();
+            if (_options.correlativeSearch) _buildLikelihoodGrids();
+            _hasReference = true;
+            return SL_RESULT_OK;
+        }
+
+        sl_result match(const float* x, const float* y, size_t count, const LidarPose2D& guess, LidarScanMatchResult& result)
+        {
+            if (!x || !y) return SL_RESULT_INVALID_DATA;
+            result = LidarScanMatchResult();
+            result.pose = guess;
+            if (!_hasReference) return SL_RESULT_OPERATION_FAIL;
+
+            _filterPoints(x, y, count, _points);
+            if (_points.size() < MIN_MATCH_POINT_COUNT) return SL_RESULT_OPERATION_FAIL;
+
+            LidarPose2D start = guess;
+            if (_options.correlativeSearch) {
+                LidarPose2D found;
+                result.correlativeScore = _correlativeSearch(guess, found);
+                if (result.correlativeScore >= _options.minCorrelativeScore) start = found;
+            }
+
+            return _refineICP(start, result);
+        }
+
+        sl_result track(const float* x, const float* y, size_t count, LidarScanMatchResult& result)
+        {
+            if (!x || !y) return SL_RESULT_INVALID_DATA;
+            result = LidarScanMatchResult();
+
+            sl_result ans = SL_RESULT_OK;
+            if (_hasTrackedScan && _hasReference) {
+                ans = match(x, y, count, _lastMotion, result);
+                // a scan failing to match is assumed to follow the previous motion
+                if (IS_FAIL(ans)) result.pose = _lastMotion;
+
+                _lastMotion = result.pose;
+                _trackedPose = composePose(_trackedPose, result.pose);
+            }
+
+            sl_result refAns = setReference(x, y, count);
+            _hasTrackedScan = true;
+            return IS_FAIL(ans) ? ans : refAns;
+        }
+
+        sl_result track(const sl_lidar_response_measurement_node_hq_t* nodes, size_t count, LidarScanMatchResult& result)
+        {
+            if (!nodes && count) return SL_RESULT_INVALID_DATA;
+
+            if (_nodeX.size() < count + 1) {
+                _nodeX.resize(count + 1);
+                _nodeY.resize(count + 1);
+            }
+            projectScanToCartesian(nodes, count, &_nodeX[0], &_nodeY[0]);
+            return track(&_nodeX[0], &_nodeY[0], count, result);
+        }
+
+        LidarPose2D getTrackedPose()
+        {
+            return _trackedPose;
+        }
+
+        void resetTracking()
+        {
+            _hasReference = false;
+            _hasTrackedScan = false;
+            _trackedPose = LidarPose2D();
+            _lastMotion = LidarPose2D();
+        }
+
+    protected:
+        struct Candidate
+        {
+            int dx;
+            int dy;
+            int score;
+
+            bool operator<(const Candidate& other) const { return score > other.score; }
+        };
+
+        // per thread state of the correlative search
+        struct SearchScratch
+        {
+            std::vector<int>                     cellX;
+            std::vector<int>                     cellY;
+            std::vector< std::vector<Candidate> > candidates;   // one list per level
+
+            int     bestScore;
+            int     bestYaw;
+            int     bestDX;
+            int     bestDY;
+        };
+
+        void _filterPoints(const float* x, const float* y, size_t count, std::vector<MatchPoint>& out)
+        {
+            float maxRange2 = _options.maxRange * _options.maxRange;
+            out.clear();
+            for (size_t pos = 0; pos < count; ++pos) {
+                float range2 = x[pos] * x[pos] + y[pos] * y[pos];
+                // the invalid nodes are projected onto the origin
+                if (!(range2 > 1.f) || (maxRange2 > 0 && range2 > maxRange2) || !(range2 < FLT_MAX)) continue;
+                MatchPoint point = { x[pos], y[pos] };
+                out.push_back(point);
+            }
+        }
+
+        // the normal of the line fitted through the nearby neighbors in the scan order
+        void _buildNormals()
+        {
+            size_t count = _refPoints.size();
+            float maxDistance2 = _options.icpMaxCorrespondenceDistance * _options.icpMaxCorrespondenceDistance;
+
+            _refNormals.resize(count);
+            _refHasNormal.assign(count, 0);
+
+            for (size_t pos = 0; pos < count; ++pos) {
+                const MatchPoint& center = _refPoints[pos];
+                float sumX = 0, sumY = 0, sumXX = 0, sumXY = 0, sumYY = 0;
+                int used = 0;
+
+                size_t first = pos >= NORMAL_NEIGHBOR_COUNT ? pos - NORMAL_NEIGHBOR_COUNT : 0;
+                size_t last = std::min(pos + NORMAL_NEIGHBOR_COUNT, count - 1);
+                for (size_t neighbor = first; neighbor <= last; ++neighbor) {
+                    float dx = _refPoints[neighbor].x - center.x;
+                    float dy = _refPoints[neighbor].y - center.y;
+                    if (dx * dx + dy * dy > maxDistance2) continue;
+                    sumX += dx; sumY += dy;
+                    sumXX += dx * dx; sumXY += dx * dy; sumYY += dy * dy;
+                    ++used;
+                }
+                if (used < 3) continue;
+
+                float meanX = sumX / used, meanY = sumY / used;
+                float covXX = sumXX / used - meanX * meanX;
+                float covXY = sumXY / used - meanX * meanY;
+                float covYY = sumYY / used - meanY * meanY;
+
+                // the neighbors have to be spread along a line
+                float trace = covXX + covYY;
+                float det = covXX * covYY - covXY * covXY;
+                float gap = sqrtf(std::max(trace * trace * 0.25f - det, 0.f));
+                float minEigen = trace * 0.5f - gap, maxEigen = trace * 0.5f + gap;
+                if (!(maxEigen > 0) || minEigen > maxEigen * 0.1f) continue;
+
+                float direction = 0.5f * atan2f(2 * covXY, covXX - covYY);
+                _refNormals[pos].x = -sinf(direction);
+                _refNormals[pos].y = cosf(direction);
+                _refHasNormal[pos] = 1;
+            }
+        }
+
+        // the reference points bucketed into cells of icpMaxCorrespondenceDistance, the nearest neighbor is in the 3x3 cells around
+        void _buildNeighborGrid()
+        {
+            float minX = FLT_MAX, minY = FLT_MAX, maxX = -FLT_MAX, maxY = -FLT_MAX;
+            for (size_t pos = 0; pos < _refPoints.size(); ++pos) {
+                minX = std::min(minX, _refPoints[pos].x); maxX = std::max(maxX, _refPoints[pos].x);
+                minY = std::min(minY, _refPoints[pos].y); maxY = std::max(maxY, _refPoints[pos].y);
+            }
+
+            float cellSize = _options.icpMaxCorrespondenceDistance;
+            _nnOriginX = minX;
+            _nnOriginY = minY;
+            _nnWidth = (int)((maxX - minX) / cellSize) + 1;
+            _nnHeight = (int)((maxY - minY) / cellSize) + 1;
+
+            // counting sort of the points by cell
+            _nnCellStart.assign((size_t)_nnWidth * _nnHeight + 1, 0);
+            _nnCellOfPoint.resize(_refPoints.size());
+            for (size_t pos = 0; pos < _refPoints.size(); ++pos) {
+                int cellX = (int)((_refPoints[pos].x - minX) / cellSize);
+                int cellY = (int)((_refPoints[pos].y - minY) / cellSize);
+                _nnCellOfPoint[pos] = (sl_u32)(cellY * _nnWidth + cellX);
+                ++_nnCellStart[_nnCellOfPoint[pos] + 1];
+            }
+            for (size_t pos = 1; pos < _nnCellStart.size(); ++pos) {
+                _nnCellStart[pos] += _nnCellStart[pos - 1];
+            }
+            _nnIndex.resize(_refPoints.size());
+            _nnFill.assign(_nnCellStart.begin(), _nnCellStart.end() - 1);
+            for (size_t pos = 0; pos < _refPoints.size(); ++pos) {
+                _nnIndex[_nnFill[_nnCellOfPoint[pos]]++] = (sl_u32)pos;
+            }
+        }
+
+        // returns the index of the nearest reference point within icpMaxCorrespondenceDistance, -1 if none
+        int _findNearest(float x, float y) const
+        {
+            float cellSize = _options.icpMaxCorrespondenceDistance;
+            int cellX = (int)floorf((x - _nnOriginX) / cellSize);
+            int cellY = (int)floorf((y - _nnOriginY) / cellSize);
+            if (cellX < -1 || cellY < -1 || cellX > _nnWidth || cellY > _nnHeight) return -1;
+
+            float best = cellSize * cellSize;
+            int found = -1;
+            for (int row = std::max(cellY - 1, 0); row <= std::min(cellY + 1, _nnHeight - 1); ++row) {
+                for (int col = std::max(cellX - 1, 0); col <= std::min(cellX + 1, _nnWidth - 1); ++col) {
+                    size_t cell = (size_t)row * _nnWidth + col;
+                    for (sl_u32 pos = _nnCellStart[cell]; pos < _nnCellStart[cell + 1]; ++pos) {
+                        const MatchPoint& point = _refPoints[_nnIndex[pos]];
+                        float dx = point.x - x, dy = point.y - y;
+                        float distance2 = dx * dx + dy * dy;
+                        if (distance2 < best) {
+                            best = distance2;
+                            found = (int)_nnIndex[pos];
+                        }
+                    }
+                }
+            }
+            return found;
+        }
+
+        void _buildLikelihoodGrids()
+        {
+            float resolution = _options.gridResolution;
+            size_t levelCount = _options.gridLevels;
+            int margin = (1 << (levelCount - 1)) + LIKELIHOOD_KERNEL_RADIUS + 1;
+
+            float minX = FLT_MAX, minY = FLT_MAX, maxX = -FLT_MAX, maxY = -FLT_MAX;
+            for (size_t pos = 0; pos < _refPoints.size(); ++pos) {
+                minX = std::min(minX, _refPoints[pos].x); maxX = std::max(maxX, _refPoints[pos].x);
+                minY = std::min(minY, _refPoints[pos].y); maxY = std::max(maxY, _refPoints[pos].y);
+            }
+            _gridOriginX = minX - margin * resolution;
+            _gridOriginY = minY - margin * resolution;
+            _gridWidth = (int)((maxX - minX) / resolution) + margin * 2 + 1;
+            _gridHeight = (int)((maxY - minY) / resolution) + margin * 2 + 1;
+            size_t cellCount = (size_t)_gridWidth * _gridHeight;
+
+            _levels.resize(levelCount);
+            std::vector<sl_u8>& finest = _levels[0];
+            finest.assign(cellCount, 0);
+
+            // gaussian with a sigma of one cell
+            const int kernelSize = LIKELIHOOD_KERNEL_RADIUS * 2 + 1;
+            sl_u8 kernel[kernelSize][kernelSize];
+            for (int row = 0; row < kernelSize; ++row) {
+                for (int col = 0; col < kernelSize; ++col) {
+                    float dx = (float)(col - LIKELIHOOD_KERNEL_RADIUS), dy = (float)(row - LIKELIHOOD_KERNEL_RADIUS);
+                    kernel[row][col] = (sl_u8)(LIKELIHOOD_MAX * expf(-0.5f * (dx * dx + dy * dy)) + 0.5f);
+                }
+            }
+
+            for (size_t pos = 0; pos < _refPoints.size(); ++pos) {
+                int cellX = (int)((_refPoints[pos].x - _gridOriginX) / resolution);
+                int cellY = (int)((_refPoints[pos].y - _gridOriginY) / resolution);
+                for (int row = 0; row < kernelSize; ++row) {
+                    sl_u8* line = &finest[(size_t)(cellY + row - LIKELIHOOD_KERNEL_RADIUS) * _gridWidth + cellX - LIKELIHOOD_KERNEL_RADIUS];
+                    for (int col = 0; col < kernelSize; ++col) {
+                        if (kernel[row][col] > line[col]) line[col] = kernel[row][col];
+                    }
+                }
+            }
+
+            // level k holds the max of the 2^k x 2^k cells starting at every cell, an upper bound of the finer scores
+            std::vector<sl_u8>& rows = _poolScratch;
+            rows.resize(cellCount);
+            for (size_t level = 1; level < levelCount; ++level) {
+                const std::vector<sl_u8>& previous = _levels[level - 1];
+                std::vector<sl_u8>& current = _levels[level];
+                current.resize(cellCount);
+                int half = 1 << (level - 1);
+
+                for (int row = 0; row < _gridHeight; ++row) {
+                    const sl_u8* source = &previous[(size_t)row * _gridWidth];
+                    sl_u8* dest = &rows[(size_t)row * _gridWidth];
+                    for (int col = 0; col < _gridWidth; ++col) {
+                        dest[col] = (col + half < _gridWidth) ? std::max(source[col], source[col + half]) : source[col];
+                    }
+                }
+                for (int row = 0; row < _gridHeight; ++row) {
+                    const sl_u8* source = &rows[(size_t)row * _gridWidth];
+                    sl_u8* dest = &current[(size_t)row * _gridWidth];
+                    if (row + half < _gridHeight) {
+                        const sl_u8* below = source + (size_t)half * _gridWidth;
+                        for (int col = 0; col < _gridWidth; ++col) dest[col] = std::max(source[col], below[col]);
+                    }
+                    else {
+                        std::copy(source, source + _gridWidth, dest);
+                    }
+                }
+            }
+        }
+
+        int _scoreCandidate(const SearchScratch& scratch, size_t level, int dx, int dy) const
+        {
+            const sl_u8* grid = &_levels[level][0];
+            const int* cellX = &scratch.cellX[0];
+            const int* cellY = &scratch.cellY[0];
+            size_t count = scratch.cellX.size();
+            int score = 0;
+            for (size_t pos = 0; pos < count; ++pos) {
+                int col = cellX[pos] + dx;
+                int row = cellY[pos] + dy;
+                if ((unsigned)col < (unsigned)_gridWidth && (unsigned)row < (unsigned)_gridHeight) {
+                    score += grid[(size_t)row * _gridWidth + col];
+                }
+            }
+            return score;
+        }
+
+        // depth first branch and bound, the candidates of a level are visited best first
+        void _branchAndBound(SearchScratch& scratch, size_t level, size_t first, size_t last, int yawIndex)
+        {
+            std::vector<Candidate>& candidates = scratch.candidates[level];
+            std::sort(candidates.begin() + first, candidates.begin() + last);
+
+            for (size_t pos = first; pos < last; ++pos) {
+                Candidate candidate = scratch.candidates[level][pos];
+                int bound = std::max(scratch.bestScore, _sharedBestScore.load(std::memory_order_relaxed));
+                if (candidate.score <= bound) break;
+
+                if (!level) {
+                    scratch.bestScore = candidate.score;
+                    scratch.bestYaw = yawIndex;
+                    scratch.bestDX = candidate.dx;
+                    scratch.bestDY = candidate.dy;
+
+                    int shared = _sharedBestScore.load(std::memory_order_relaxed);
+                    while (candidate.score > shared && !_sharedBestScore.compare_exchange_weak(shared, candidate.score)) {}
+                    continue;
+                }
+
+                // the 4 children of half the size, within the search window
+                std::vector<Candidate>& children = scratch.candidates[level - 1];
+                size_t childFirst = children.size();
+                int half = 1 << (level - 1);
+                for (int offsetY = 0; offsetY < 2; ++offsetY) {
+                    for (int offsetX = 0; offsetX < 2; ++offsetX) {
+                        Candidate child;
+                        child.dx = candidate.dx + offsetX * half;
+                        child.dy = candidate.dy + offsetY * half;
+                        if (child.dx > _searchWindowCells || child.dy > _searchWindowCells) continue;
+                        child.score = _scoreCandidate(scratch, level - 1, child.dx, child.dy);
+                        children.push_back(child);
+                    }
+                }
+                _branchAndBound(scratch, level - 1, childFirst, children.size(), yawIndex);
+                children.resize(childFirst);
+            }
+        }
+
+        void _searchYaw(SearchScratch& scratch, int yawIndex)
+        {
+            float yaw = _searchGuess.yaw + (yawIndex - _yawCandidateCount / 2) * _yawStep;
+            float cosYaw = cosf(yaw), sinYaw = sinf(yaw);
+            float resolution = _options.gridResolution;
+
+            size_t count = _searchPoints.size();
+            scratch.cellX.resize(count);
+            scratch.cellY.resize(count);
+            for (size_t pos = 0; pos < count; ++pos) {
+                const MatchPoint& point = _searchPoints[pos];
+                float x = cosYaw * point.x - sinYaw * point.y + _searchGuess.x;
+                float y = sinYaw * point.x + cosYaw * point.y + _searchGuess.y;
+                scratch.cellX[pos] = (int)floorf((x - _gridOriginX) / resolution);
+                scratch.cellY[pos] = (int)floorf((y - _gridOriginY) / resolution);
+            }
+
+            size_t top = _levels.size() - 1;
+            int width = 1 << top;
+            std::vector<Candidate>& roots = scratch.candidates[top];
+            roots.clear();
+            for (int dy = -_searchWindowCells; dy <= _searchWindowCells; dy += width) {
+                for (int dx = -_searchWindowCells; dx <= _searchWindowCells; dx += width) {
+                    Candidate candidate = { dx, dy, _scoreCandidate(scratch, top, dx, dy) };
+                    roots.push_back(candidate);
+                }
+            }
+            _branchAndBound(scratch, top, 0, roots.size(), yawIndex);
+        }
+
+        void _searchTask(size_t scratchIndex)
+        {
+            SearchScratch& scratch = _scratches[scratchIndex];
+            scratch.bestScore = 0;
+            scratch.bestYaw = -1;
+            scratch.candidates.resize(_levels.size());
+            for (size_t level = 0; level < scratch.candidates.size(); ++level) {
+                scratch.candidates[level].clear();
+            }
+
+            for (;;) {
+                int order = _nextYawCandidate.fetch_add(1);
+                if (order >= _yawCandidateCount) break;
+                // from the guess outwards, the best candidates are found early for a better pruning
+                int center = _yawCandidateCount / 2;
+                int yawIndex = (order & 1) ? center - (order + 1) / 2 : center + order / 2;
+                _searchYaw(scratch, yawIndex);
+            }
+        }
+
+        // returns the normalized score of the best pose found
+        float _correlativeSearch(const LidarPose2D& guess, LidarPose2D& found)
+        {
+            subsamplePoints(_points, _options.correlativePointCount, _searchPoints);
+
+            float maxRange = 0;
+            for (size_t pos = 0; pos < _searchPoints.size(); ++pos) {
+                maxRange = std::max(maxRange, sqrtf(_searchPoints[pos].x * _searchPoints[pos].x + _searchPoints[pos].y * _searchPoints[pos].y));
+            }
+
+            float resolution = _options.gridResolution;
+            _yawStep = _options.yawResolution;
+            if (!(_yawStep > 0)) {
+                // the farthest point moves by at most one cell between two yaw candidates
+                _yawStep = maxRange > resolution ? acosf(1.f - resolution * resolution / (2.f * maxRange * maxRange)) : 0.1f;
+            }
+            _yawCandidateCount = 2 * (int)ceilf(_options.searchWindowYaw / _yawStep) + 1;
+            _searchWindowCells = (int)ceilf(_options.searchWindowXY / resolution);
+            _searchGuess = guess;
+            _nextYawCandidate = 0;
+            _sharedBestScore = 0;
+
+            _runSearchTasks();
+
+            const SearchScratch* best = NULL;
+            for (size_t pos = 0; pos < _scratches.size(); ++pos) {
+                if (_scratches[pos].bestYaw < 0) continue;
+                if (!best || _scratches[pos].bestScore > best->bestScore) best = &_scratches[pos];
+            }
+            if (!best) return 0;
+
+            found = guess;
+            found.x = guess.x + best->bestDX * resolution;
+            found.y = guess.y + best->bestDY * resolution;
+            found.yaw = guess.yaw + (best->bestYaw - _yawCandidateCount / 2) * _yawStep;
+            return (float)best->bestScore / ((float)LIKELIHOOD_MAX * _searchPoints.size());
+        }
+
+        void _runSearchTasks()
+        {
+            _pendingWorkers = (int)_workers.size();
+            for (size_t pos = 0; pos < _startEvts.size(); ++pos) {
+                _startEvts[pos]->set();
+            }
+
+            _searchTask(0);
+
+            while (_pendingWorkers.load() > 0) {
+                _doneEvt.wait(100);
+            }
+        }
+
+        u_result _proc_worker()
+        {
+            int index = _nextWorkerIndex++;
+            internal::applyThreadConfig(_options.workerThreadConfig, "sl_scanmatch", index);
+
+            for (;;) {
+                _startEvts[index]->wait();
+                if (!_isRunning) break;
+
+                _searchTask(index + 1);
+                if (--_pendingWorkers == 0) _doneEvt.set();
+            }
+            return RESULT_OK;
+        }
+
+        // point-to-line Gauss-Newton iterations, point-to-point for the reference points without a normal
+        sl_result _refineICP(const LidarPose2D& start, LidarScanMatchResult& result)
+        {
+            subsamplePoints(_points, _options.icpPointCount, _icpPoints);
+
+            double poseX = start.x, poseY = start.y, poseYaw = start.yaw;
+            double huber = _options.icpHuberDistance > 0 ? _options.icpHuberDistance : DBL_MAX;
+            size_t matched = 0;
+            double squaredSum = 0;
+
+            result.converged = false;
+            for (result.icpIterations = 0; result.icpIterations < _options.icpMaxIterations; ) {
+                double cosYaw = cos(poseYaw), sinYaw = sin(poseYaw);
+                double hessian[3][3] = { { 0 } };
+                double gradient[3] = { 0 };
+                matched = 0;
+                squaredSum = 0;
+
+                for (size_t pos = 0; pos < _icpPoints.size(); ++pos) {
+                    const MatchPoint& point = _icpPoints[pos];
+                    double offsetX = cosYaw * point.x - sinYaw * point.y;
+                    double offsetY = sinYaw * point.x + cosYaw * point.y;
+                    double x = offsetX + poseX, y = offsetY + poseY;
+
+                    int nearest = _findNearest((float)x, (float)y);
+                    if (nearest < 0) continue;
+
+                    const MatchPoint& target = _refPoints[nearest];
+                    double errorX = x - target.x, errorY = y - target.y;
+                    ++matched;
+
+                    if (_refHasNormal[nearest]) {
+                        const MatchPoint& normal = _refNormals[nearest];
+                        double residual = normal.x * errorX + normal.y * errorY;
+                        double jacobian[3] = { normal.x, normal.y, normal.x * -offsetY + normal.y * offsetX };
+                        double weight = fabs(residual) <= huber ? 1.0 : huber / fabs(residual);
+                        _accumulate(hessian, gradient, jacobian, residual, weight);
+                        squaredSum += residual * residual;
+                    }
+                    else {
+                        double distance = sqrt(errorX * errorX + errorY * errorY);
+                        double weight = distance <= huber ? 1.0 : huber / distance;
+                        double jacobianX[3] = { 1, 0, -offsetY };
+                        double jacobianY[3] = { 0, 1, offsetX };
+                        _accumulate(hessian, gradient, jacobianX, errorX, weight);
+                        _accumulate(hessian, gradient, jacobianY, errorY, weight);
+                        squaredSum += distance * distance;
+                    }
+                }
+
+                if (matched < MIN_MATCH_POINT_COUNT) break;
+
+                double delta[3];
+                if (!_solve3x3(hessian, gradient, delta)) break;
+
+                poseX -= delta[0];
+                poseY -= delta[1];
+                poseYaw -= delta[2];
+                ++result.icpIterations;
+
+                if (sqrt(delta[0] * delta[0] + delta[1] * delta[1]) < _options.icpConvergenceXY && fabs(delta[2]) < _options.icpConvergenceYaw) {
+                    result.converged = true;
+                    break;
+                }
+            }
+
+            result.pose = LidarPose2D(0, (float)poseX, (float)poseY, (float)atan2(sin(poseYaw), cos(poseYaw)));
+            result.matchRatio = _icpPoints.empty() ? 0 : (float)matched / _icpPoints.size();
+            result.rmsError = matched ? (float)sqrt(squaredSum / matched) : 0;
+            return matched >= MIN_MATCH_POINT_COUNT ? SL_RESULT_OK : SL_RESULT_OPERATION_FAIL;
+        }
+
+        static void _accumulate(double hessian[3][3], double gradient[3], const double jacobian[3], double residual, double weight)
+        {
+            for (int row = 0; row < 3; ++row) {
+                gradient[row] += weight * jacobian[row] * residual;
+                for (int col = 0; col < 3; ++col) {
+                    hessian[row][col] += weight * jacobian[row] * jacobian[col];
+                }
+            }
+        }
+
+        // solves hessian * delta = gradient, slightly damped so that a degenerated direction (e.g. a corridor) stays put
+        static bool _solve3x3(const double hessian[3][3], const double gradient[3], double delta[3])
+        {
+            double a[3][3];
+            double damping = 1e-6 * (hessian[0][0] + hessian[1][1] + hessian[2][2]) + 1e-9;
+            for (int row = 0; row < 3; ++row) {
+                for (int col = 0; col < 3; ++col) a[row][col] = hessian[row][col];
+                a[row][row] += damping;
+            }
+
+            double det = a[0][0] * (a[1][1] * a[2][2] - a[1][2] * a[2][1])
+                - a[0][1] * (a[1][0] * a[2][2] - a[1][2] * a[2][0])
+                + a[0][2] * (a[1][0] * a[2][1] - a[1][1] * a[2][0]);
+            if (!(fabs(det) > 1e-30)) return false;
+
+            for (int unknown = 0; unknown < 3; ++unknown) {
+                double m[3][3];
+                for (int row = 0; row < 3; ++row) {
+                    for (int col = 0; col < 3; ++col) m[row][col] = (col == unknown) ? gradient[row] : a[row][col];
+                }
+                double value = m[0][0] * (m[1][1] * m[2][2] - m[1][2] * m[2][1])
+                    - m[0][1] * (m[1][0] * m[2][2] - m[1][2] * m[2][0])
+                    + m[0][2] * (m[1][0] * m[2][1] - m[1][1] * m[2][0]);
+                delta[unknown] = value / det;
+            }
+            return true;
+        }
+
+        LidarScanMatchOptions   _options;
+
+        // reference scan
+        bool                     _hasReference;
+        std::vector<MatchPoint>  _refPoints;
+        std::vector<MatchPoint>  _refNormals;
+        std::vector<sl_u8>       _refHasNormal;
+
+        // correlative grids of the reference scan, finest first
+        std::vector< std::vector<sl_u8> > _levels;
+        std::vector<sl_u8>       _poolScratch;
+        int                      _gridWidth;
+        int                      _gridHeight;
+        float                    _gridOriginX;
+        float                    _gridOriginY;
+
+        // nearest neighbor grid hash of the reference scan
+        int                      _nnWidth;
+        int                      _nnHeight;
+        float                    _nnOriginX;
+        float                    _nnOriginY;
+        std::vector<sl_u32>      _nnCellStart;
+        std::vector<sl_u32>      _nnCellOfPoint;
+        std::vector<sl_u32>      _nnFill;
+        std::vector<sl_u32>      _nnIndex;
+
+        // scan being matched
+        std::vector<MatchPoint>  _points;
+        std::vector<MatchPoint>  _searchPoints;
+        std::vector<MatchPoint>  _icpPoints;
+        std::vector<float>       _nodeX;
+        std::vector<float>       _nodeY;
+
+        // correlative search shared with the workers
+        LidarPose2D              _searchGuess;
+        float                    _yawStep;
+        int                      _yawCandidateCount;
+        int                      _searchWindowCells;
+        std::atomic<int>         _nextYawCandidate;
+        std::atomic<int>         _sharedBestScore;
+        std::vector<SearchScratch> _scratches;
+
+        // worker threads, the calling thread takes part in the search as well
+        std::atomic<bool>        _isRunning;
+        std::atomic<int>         _nextWorkerIndex;
+        std::atomic<int>         _pendingWorkers;
+        std::vector<rp::hal::Thread> _workers;
+        std::vector<rp::hal::Event*> _startEvts;
+        rp::hal::Event           _doneEvt;
+
+        // odometry
+        bool                     _hasTrackedScan;
+        LidarPose2D              _trackedPose;
+        LidarPose2D              _lastMotion;
+    };
+
+    Result<ILidarScanMatcher*> createLidarScanMatcher(const LidarScanMatchOptions& options)
+    {
+        return new LidarScanMatcher(options);
+    }
+
+}
@@ -0,0 +1,410 @@
+/*
+ *  Slamtec LIDAR SDK
+ *
+ *  Copyright (c) 2014 - 2023 Shanghai Slamtec Co., Ltd.
+ *  http://www.slamtec.com
+ *
+ */
+ /*
+  * Redistribution and use in source and binary forms, with or without
+  * modification, are permitted provided that the following conditions are met:
+  *
+  * 1. Redistributions of source code must retain the above copyright notice,
+  *    this list of conditions and the following disclaimer.
+  *
+  * 2. Redistributions in binary form must reproduce the above copyright notice,
+  *    this list of conditions and the following disclaimer in the documentation
+  *    and/or other materials provided with the distribution.
+  *
+  * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+  * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+  * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+  * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+  * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+  * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+  * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+  * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+  * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+  * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+  * EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+  *
+  */
+
+#include "sdkcommon.h"
+#include "hal/types.h"
+#include "hal/assert.h"
+#include "sl_lidar_driver.h"
+#include "sl_lidar_shm.h"
+
+#include <atomic>
+#include <string>
+#include <algorithm>
+
+#if !defined(_WIN32) && !defined(_MACOS)
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <linux/futex.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <limits.h>
+#define SL_LIDAR_SHM_SUPPORTED
+#endif
+
+// Shared memory layout, both sides have to be built for the same architecture:
+//   ShmRingHeader
+//   ShmSlotHeader + sl_lidar_response_measurement_node_hq_t[max_node_count]   (slot_count times)
+
+#define SL_LIDAR_SHM_MAGIC      0x4D484C53 // "SLHM"
+#define SL_LIDAR_SHM_VERSION    1
+
+namespace sl {
+
+#ifdef SL_LIDAR_SHM_SUPPORTED
+
+    namespace {
+
+        struct ShmRingHeader
+        {
+            std::atomic<_u32> magic;    // written last, once the header is complete
+            _u32              version;
+            _u32              header_size;
+            _u32              slot_size;
+            _u32              slot_count;
+            _u32              max_node_count;
+            _u32              node_size;
+            std::atomic<_u32> closed;
+            std::atomic<_u64> published_count;     // slots written so far, the latest one is (published_count - 1) % slot_count
+            std::atomic<_u32> wake_seq;            // the futex word, bumped on every publish
+            std::atomic<_u32> waiter_count;
+        };
+
+        struct ShmSlotHeader
+        {
+            std::atomic<_u64> version;  // odd while the slot is being written
+            std::atomic<_u64> sequence;
+            std::atomic<_u64> timestamp_uS;
+            std::atomic<_u32> node_count;
+            _u32              reserved;
+        };
+
+        static std::string _toShmName(const char* name)
+        {
+            std::string shmName(name ? name : "");
+            if (shmName.empty() || shmName[0] != '/') shmName.insert(0, "/");
+            return shmName;
+        }
+
+        static inline size_t _alignSize(size_t size)
+        {
+            return (size + 63) & ~(size_t)63;
+        }
+
+        static inline ShmSlotHeader* _getSlot(_u8* base, const ShmRingHeader* header, size_t slot)
+        {
+            return reinterpret_cast<ShmSlotHeader*>(base + header->header_size + slot * header->slot_size);
+        }
+
+        static inline sl_lidar_response_measurement_node_hq_t* _getSlotNodes(ShmSlotHeader* slot)
+        {
+            return reinterpret_cast<sl_lidar_response_measurement_node_hq_t*>(reinterpret_cast<_u8*>(slot) + sizeof(ShmSlotHeader));
+        }
+
+        static inline long _futex(std::atomic<_u32>* word, int op, _u32 val, const struct timespec* timeout)
+        {
+            return syscall(SYS_futex, reinterpret_cast<_u32*>(word), op, val, timeout, NULL, 0);
+        }
+    }
+
+    class LidarScanPublisher : public ILidarScanPublisher
+    {
+    public:
+        LidarScanPublisher()
+            : _mapped(NULL)
+            , _mappedSize(0)
+            , _header(NULL)
+            , _publishedCount(0)
+        {
+        }
+
+        virtual ~LidarScanPublisher()
+        {
+            close();
+        }
+
+        sl_result open(const char* name, size_t slotCount, size_t maxNodeCount)
+        {
+            close();
+            if (!slotCount || !maxNodeCount) return SL_RESULT_INVALID_DATA;
+
+            // the subscribers still attached to a previous ring keep their mapping and see it closed
+            _name = _toShmName(name);
+            shm_unlink(_name.c_str());
+
+            int fd = shm_open(_name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0666);
+            if (fd < 0) return SL_RESULT_OPERATION_FAIL;
+            // the subscribers register themselves as waiters, they need write access even with a restrictive umask
+            fchmod(fd, 0666);
+
+            size_t headerSize = _alignSize(sizeof(ShmRingHeader));
+            size_t slotSize = _alignSize(sizeof(ShmSlotHeader) + maxNodeCount * sizeof(sl_lidar_response_measurement_node_hq_t));
+            size_t totalSize = headerSize + slotSize * slotCount;
+
+            void* mapped = MAP_FAILED;
+            if (ftruncate(fd, (off_t)totalSize) == 0) {
+                mapped = mmap(NULL, totalSize, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+            }
+            ::close(fd);
+
+            if (mapped == MAP_FAILED) {
+                shm_unlink(_name.c_str());
+                return SL_RESULT_OPERATION_FAIL;
+            }
+
+            // a new mapping reads as zeros, which is an empty slot
+            _mapped = reinterpret_cast<_u8*>(mapped);
+            _mappedSize = totalSize;
+            _header = reinterpret_cast<ShmRingHeader*>(_mapped);
+            _header->version = SL_LIDAR_SHM_VERSION;
+            _header->header_size = (_u32)headerSize;
+            _header->slot_size = (_u32)slotSize;
+            _header->slot_count = (_u32)slotCount;
+            _header->max_node_count = (_u32)maxNodeCount;
+            _header->node_size = sizeof(sl_lidar_response_measurement_node_hq_t);
+            _header->magic.store(SL_LIDAR_SHM_MAGIC, std::memory_order_release);
+            _publishedCount = 0;
+            return SL_RESULT_OK;
+        }
+
+        void close()
+        {
+            if (!_mapped) return;
+
+            _header->closed.store(1, std::memory_order_release);
+            _header->wake_seq.fetch_add(1, std::memory_order_release);
+            _futex(&_header->wake_seq, FUTEX_WAKE, INT_MAX, NULL);
+
+            munmap(_mapped, _mappedSize);
+            shm_unlink(_name.c_str());
+            _mapped = NULL;
+            _mappedSize = 0;
+            _header = NULL;
+        }
+
+        bool isOpened()
+        {
+            return _mapped != NULL;
+        }
+
+        sl_result publishScan(const sl_lidar_response_measurement_node_hq_t* nodes, size_t count, sl_u64 timestamp_uS, sl_u64 sequence)
+        {
+            if (!_mapped) return SL_RESULT_OPERATION_FAIL;
+
+            ShmSlotHeader* slot = _getSlot(_mapped, _header, (size_t)(_publishedCount % _header->slot_count));
+            if (count > _header->max_node_count) count = _header->max_node_count;
+
+            // seqlock: the readers retry (or give up) on an odd or changed version
+            _u64 version = slot->version.load(std::memory_order_relaxed);
+            slot->version.store(version + 1, std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_release);
+
+            slot->sequence.store(sequence ? sequence : _publishedCount + 1, std::memory_order_relaxed);
+            slot->timestamp_uS.store(timestamp_uS, std::memory_order_relaxed);
+            slot->node_count.store((_u32)count, std::memory_order_relaxed);
+            if (count) memcpy(_getSlotNodes(slot), nodes, count * sizeof(sl_lidar_response_measurement_node_hq_t));
+
+            slot->version.store(version + 2, std::memory_order_release);
+            _header->published_count.store(++_publishedCount, std::memory_order_release);
+
+            _header->wake_seq.fetch_add(1, std::memory_order_release);
+            if (_header->waiter_count.load(std::memory_order_acquire)) {
+                _futex(&_header->wake_seq, FUTEX_WAKE, INT_MAX, NULL);
+            }
+            return SL_RESULT_OK;
+        }
+
+        sl_u64 getPublishedScanCount()
+        {
+            return _publishedCount;
+        }
+
+    protected:
+        std::string _name;
+        _u8* _mapped;
+        size_t _mappedSize;
+        ShmRingHeader* _header;
+        _u64 _publishedCount;
+    };
+
+
+    class LidarScanSubscriber : public ILidarScanSubscriber
+    {
+    public:
+        LidarScanSubscriber()
+            : _mapped(NULL)
+            , _mappedSize(0)
+            , _header(NULL)
+            , _nextCount(0)
+        {
+        }
+
+        virtual ~LidarScanSubscriber()
+        {
+            close();
+        }
+
+        sl_result open(const char* name)
+        {
+            close();
+
+            int fd = shm_open(_toShmName(name).c_str(), O_RDWR, 0);
+            if (fd < 0) return SL_RESULT_OPERATION_FAIL;
+
+            struct stat st;
+            void* mapped = MAP_FAILED;
+            if (fstat(fd, &st) == 0 && (size_t)st.st_size >= sizeof(ShmRingHeader)) {
+                mapped = mmap(NULL, (size_t)st.st_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+            }
+            ::close(fd);
+            if (mapped == MAP_FAILED) return SL_RESULT_OPERATION_FAIL;
+
+            _mapped = reinterpret_cast<_u8*>(mapped);
+            _mappedSize = (size_t)st.st_size;
+            _header = reinterpret_cast<ShmRingHeader*>(_mapped);
+
+            if (_header->magic.load(std::memory_order_acquire) != SL_LIDAR_SHM_MAGIC
+                || _header->version != SL_LIDAR_SHM_VERSION
+                || _header->node_size != sizeof(sl_lidar_response_measurement_node_hq_t)
+                || !_header->slot_count
+                || _header->header_size + (size_t)_header->slot_size * _header->slot_count > _mappedSize) {
+                close();
+                return SL_RESULT_FORMAT_NOT_SUPPORT;
+            }
+
+            // start with the latest scan
+            _u64 published = _header->published_count.load(std::memory_order_acquire);
+            _nextCount = published ? published - 1 : 0;
+            return SL_RESULT_OK;
+        }
+
+        void close()
+        {
+            if (!_mapped) return;
+            munmap(_mapped, _mappedSize);
+            _mapped = NULL;
+            _mappedSize = 0;
+            _header = NULL;
+        }
+
+        sl_result waitNextScan(LidarSharedScan& scan, sl_u32 timeoutInMs)
+        {
+            if (!_mapped) return SL_RESULT_OPERATION_FAIL;
+
+            _u32 startTs = getms();
+            for (;;) {
+                _u32 wakeSeq = _header->wake_seq.load(std::memory_order_acquire);
+                _u64 published = _header->published_count.load(std::memory_order_acquire);
+
+                while (published > _nextCount) {
+                    // fallen behind: skip to the oldest slot that is not about to be overwritten
+                    if (published - _nextCount >= _header->slot_count) {
+                        _nextCount = published - _header->slot_count + 1;
+                    }
+                    if (_readSlot(scan, _nextCount)) {
+                        ++_nextCount;
+                        return SL_RESULT_OK;
+                    }
+                    // overwritten while being read, the skip above moves past it
+                    published = _header->published_count.load(std::memory_order_acquire);
+                }
+
+                if (_header->closed.load(std::memory_order_acquire)) return SL_RESULT_OPERATION_STOP;
+
+                _u32 elapsed = getms() - startTs;
+                if (elapsed >= timeoutInMs) return SL_RESULT_OPERATION_TIMEOUT;
+
+                _u32 remaining = timeoutInMs - elapsed;
+                struct timespec timeout;
+                timeout.tv_sec = remaining / 1000;
+                timeout.tv_nsec = (remaining % 1000) * 1000000L;
+
+                // sleeps only if nothing has been published since wakeSeq was read
+                _header->waiter_count.fetch_add(1, std::memory_order_acq_rel);
+                _futex(&_header->wake_seq, FUTEX_WAIT, wakeSeq, &timeout);
+                _header->waiter_count.fetch_sub(1, std::memory_order_acq_rel);
+            }
+        }
+
+        bool isScanIntact(const LidarSharedScan& scan)
+        {
+            if (!_mapped || scan.slot >= _header->slot_count) return false;
+
+            std::atomic_thread_fence(std::memory_order_acquire);
+            return _getSlot(_mapped, _header, scan.slot)->version.load(std::memory_order_relaxed) == scan.version;
+        }
+
+        sl_result copyScan(const LidarSharedScan& scan, sl_lidar_response_measurement_node_hq_t* buffer, size_t& count)
+        {
+            if (!scan.nodes) return SL_RESULT_INVALID_DATA;
+
+            count = std::min(count, scan.count);
+            memcpy(buffer, scan.nodes, count * sizeof(sl_lidar_response_measurement_node_hq_t));
+            if (!isScanIntact(scan)) {
+                count = 0;
+                return SL_RESULT_INVALID_DATA;
+            }
+            return SL_RESULT_OK;
+        }
+
+    protected:
+        // the scan counted as the given slot write, false if it is being (or has been) overwritten
+        bool _readSlot(LidarSharedScan& scan, _u64 writeIndex)
+        {
+            _u32 slotID = (_u32)(writeIndex % _header->slot_count);
+            ShmSlotHeader* slot = _getSlot(_mapped, _header, slotID);
+
+            _u64 version = slot->version.load(std::memory_order_acquire);
+            // each write adds 2 to the version, so a complete slot holds the write (version / 2 - 1) / slot_count
+            if ((version & 1) || !version || (version / 2 - 1) * _header->slot_count + slotID != writeIndex) return false;
+
+            scan.sequence = slot->sequence.load(std::memory_order_relaxed);
+            scan.timestamp_uS = slot->timestamp_uS.load(std::memory_order_relaxed);
+            scan.count = std::min<size_t>(slot->node_count.load(std::memory_order_relaxed), _header->max_node_count);
+            scan.nodes = _getSlotNodes(slot);
+            scan.slot = slotID;
+            scan.version = version;
+
+            std::atomic_thread_fence(std::memory_order_acquire);
+            return slot->version.load(std::memory_order_relaxed) == version;
+        }
+
+        _u8* _mapped;
+        size_t _mappedSize;
+        ShmRingHeader* _header;
+        _u64 _nextCount;    // the write index of the next scan to return
+    };
+
+    Result<ILidarScanPublisher*> createLidarScanPublisher()
+    {
+        return new LidarScanPublisher();
+    }
+
+    Result<ILidarScanSubscriber*> createLidarScanSubscriber()
+    {
+        return new LidarScanSubscriber();
+    }
+
+#else
+
+    Result<ILidarScanPublisher*> createLidarScanPublisher()
+    {
+        return SL_RESULT_OPERATION_NOT_SUPPORT;
+    }
+
+    Result<ILidarScanSubscriber*> createLidarScanSubscriber()
+    {
+        return SL_RESULT_OPERATION_NOT_SUPPORT;
+    }
+
+#endif
+}
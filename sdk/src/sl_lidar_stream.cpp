@@ -0,0 +1,805 @@
+/*
+ *  Slamtec LIDAR SDK
+ *
+ *  Copyright (c) 2014 - 2023 Shanghai Slamtec Co., Ltd.
+ *  http://www.slamtec.com
+ *
+ */
+ /*
+  * Redistribution and use in source and binary forms, with or without
+  * modification, are permitted provided that the following conditions are met:
+  *
+  * 1. Redistributions of source code must retain the above copyright notice,
+  *    this list of conditions and the following disclaimer.
+  *
+  * 2. Redistributions in binary form must reproduce the above copyright notice,
+  *    this list of conditions and the following disclaimer in the documentation
+  *    and/or other materials provided with the distribution.
+  *
+  * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+  * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+  * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+  * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+  * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+  * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+  * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+  * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+  * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+  * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+  * EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+  *
+  */
+
+#include "sdkcommon.h"
+#include "hal/thread.h"
+#include "hal/types.h"
+#include "hal/assert.h"
+#include "hal/locker.h"
+#include "hal/socket.h"
+#include "hal/event.h"
+#include "hal/byteorder.h"
+#include "sl_lidar_driver.h"
+#include "sl_lidar_stream.h"
+
+#include <atomic>
+#include <algorithm>
+
+#ifdef SL_LIDAR_STREAM_LZ4
+#include <lz4.h>
+#endif
+
+#define SL_LIDAR_STREAM_MAGIC           0x46534C53 // "SLSF"
+#define SL_LIDAR_STREAM_VERSION         1
+#define SL_LIDAR_STREAM_FLAG_LZ4        0x1
+
+#if defined(_WIN32)
+#pragma pack(1)
+#endif
+
+typedef struct _sl_lidar_stream_frame_header_t
+{
+    _u32 magic;
+    _u8  version;
+    _u8  flags;
+    _u8  qualityBits;
+    _u8  reserved;
+    _u32 sequence;
+    _u32 nodeCount;
+    _u64 timestamp_uS;
+    _u32 payloadSize;       // on the wire
+    _u32 rawPayloadSize;    // once decompressed
+} __attribute__((packed)) sl_lidar_stream_frame_header_t;
+
+typedef struct _sl_lidar_stream_fragment_header_t
+{
+    _u16 index;
+    _u16 count;
+    _u32 offset;            // in the payload
+} __attribute__((packed)) sl_lidar_stream_fragment_header_t;
+
+#if defined(_WIN32)
+#pragma pack()
+#endif
+
+namespace sl {
+
+    namespace internal {
+
+        static const size_t STREAM_MAX_NODE_COUNT = 65536;
+        static const size_t STREAM_MAX_PAYLOAD_SIZE = STREAM_MAX_NODE_COUNT * 16;
+
+        static inline _u32 _zigzagEncode(_s32 v)
+        {
+            return ((_u32)v << 1) ^ (_u32)(v >> 31);
+        }
+
+        static inline _s32 _zigzagDecode(_u32 v)
+        {
+            return (_s32)(v >> 1) ^ -(_s32)(v & 1);
+        }
+
+        static inline _u8* _putVarint(_u8* pos, _u32 v)
+        {
+            while (v >= 0x80) {
+                *pos++ = (_u8)(v | 0x80);
+                v >>= 7;
+            }
+            *pos++ = (_u8)v;
+            return pos;
+        }
+
+        static inline bool _getVarint(const _u8*& pos, const _u8* end, _u32& v)
+        {
+            v = 0;
+            for (int shift = 0; shift < 35 && pos < end; shift += 7) {
+                _u8 byte = *pos++;
+                v |= (_u32)(byte & 0x7F) << shift;
+                if (!(byte & 0x80)) return true;
+            }
+            return false;
+        }
+
+        static inline size_t _getEncodedScanSizeBound(size_t count)
+        {
+            // 3 + 5 bytes of varints, 5 + 1 bytes for a flagged node, a quality byte
+            return count * 15 + 8;
+        }
+
+        // see LidarStreamTransport for the layout
+        static size_t _encodeScanPayload(const sl_lidar_response_measurement_node_hq_t* nodes, size_t count, int qualityBits, _u8* out)
+        {
+            _u8* pos = out;
+            _u16 prevAngle = 0, angleStep = 0;
+            _u32 prevDist = 0;
+            size_t flaggedCount = 0;
+
+            for (size_t i = 0; i < count; ++i) {
+                _u16 predicted = (_u16)(prevAngle + angleStep);
+                pos = _putVarint(pos, _zigzagEncode((_s16)(nodes[i].angle_z_q14 - predicted)));
+                pos = _putVarint(pos, _zigzagEncode((_s32)(nodes[i].dist_mm_q2 - prevDist)));
+
+                if (i) angleStep = (_u16)(nodes[i].angle_z_q14 - prevAngle);
+                prevAngle = nodes[i].angle_z_q14;
+                prevDist = nodes[i].dist_mm_q2;
+                if (nodes[i].flag) ++flaggedCount;
+            }
+
+            pos = _putVarint(pos, (_u32)flaggedCount);
+            for (size_t i = 0, last = 0; flaggedCount && i < count; ++i) {
+                if (!nodes[i].flag) continue;
+                pos = _putVarint(pos, (_u32)(i - last));
+                *pos++ = nodes[i].flag;
+                last = i;
+            }
+
+            if (qualityBits > 0) {
+                const int shift = 8 - qualityBits;
+                _u32 bits = 0;
+                int bitCount = 0;
+                for (size_t i = 0; i < count; ++i) {
+                    bits |= (_u32)(nodes[i].quality >> shift) << bitCount;
+                    bitCount += qualityBits;
+                    while (bitCount >= 8) {
+                        *pos++ = (_u8)bits;
+                        bits >>= 8;
+                        bitCount -= 8;
+                    }
+                }
+                if (bitCount) *pos++ = (_u8)bits;
+            }
+            return pos - out;
+        }
+
+        static bool _decodeScanPayload(const _u8* payload, size_t size, size_t count, int qualityBits, std::vector<sl_lidar_response_measurement_node_hq_t>& nodes)
+        {
+            const _u8* pos = payload;
+            const _u8* end = payload + size;
+            _u16 prevAngle = 0, angleStep = 0;
+            _u32 prevDist = 0;
+            _u32 value;
+
+            nodes.resize(count);
+            for (size_t i = 0; i < count; ++i) {
+                sl_lidar_response_measurement_node_hq_t& node = nodes[i];
+
+                if (!_getVarint(pos, end, value)) return false;
+                node.angle_z_q14 = (_u16)(prevAngle + angleStep + _zigzagDecode(value));
+                if (!_getVarint(pos, end, value)) return false;
+                node.dist_mm_q2 = prevDist + (_u32)_zigzagDecode(value);
+                node.quality = 0;
+                node.flag = 0;
+
+                if (i) angleStep = (_u16)(node.angle_z_q14 - prevAngle);
+                prevAngle = node.angle_z_q14;
+                prevDist = node.dist_mm_q2;
+            }
+
+            _u32 flaggedCount;
+            if (!_getVarint(pos, end, flaggedCount) || flaggedCount > count) return false;
+            for (size_t i = 0, last = 0; i < flaggedCount; ++i) {
+                if (!_getVarint(pos, end, value)) return false;
+                last += value;
+                if (last >= count || pos >= end) return false;
+                nodes[last].flag = *pos++;
+            }
+
+            if (qualityBits > 0) {
+                const int shift = 8 - qualityBits;
+                const _u32 mask = (1u << qualityBits) - 1;
+                if ((size_t)(end - pos) < (count * qualityBits + 7) / 8) return false;
+
+                _u32 bits = 0;
+                int bitCount = 0;
+                for (size_t i = 0; i < count; ++i) {
+                    while (bitCount < qualityBits) {
+                        bits |= (_u32)(*pos++) << bitCount;
+                        bitCount += 8;
+                    }
+                    nodes[i].quality = (_u8)((bits & mask) << shift);
+                    bits >>= qualityBits;
+                    bitCount -= qualityBits;
+                }
+            }
+            return true;
+        }
+    }
+
+
+    class LidarScanStreamServer : public ILidarScanStreamServer
+    {
+    public:
+        enum {
+            CLIENT_SEND_TIMEOUT = 200,
+        };
+
+        LidarScanStreamServer()
+            : _listenSocket(NULL)
+            , _dgramSocket(NULL)
+            , _isWorking(false)
+            , _hasPendingScan(false)
+            , _pendingTimestamp(0)
+            , _encodedBytes(0)
+            , _frameSequence(0)
+            , _sendEvt(true, false)
+        {
+        }
+
+        virtual ~LidarScanStreamServer()
+        {
+            stop();
+        }
+
+        sl_result start(const LidarStreamServerOptions& options)
+        {
+            stop();
+
+            if (options.qualityBits < 0 || options.qualityBits > 8) return SL_RESULT_INVALID_DATA;
+#ifndef SL_LIDAR_STREAM_LZ4
+            if (options.lz4) return SL_RESULT_OPERATION_NOT_SUPPORT;
+#endif
+            _options = options;
+            if (_options.maxDatagramSize < 256) _options.maxDatagramSize = 256;
+
+            if (_options.transport == LIDAR_STREAM_TRANSPORT_TCP) {
+                _listenSocket = rp::net::StreamSocket::CreateSocket();
+                if (!_listenSocket) return SL_RESULT_OPERATION_FAIL;
+
+                rp::net::SocketAddress localAddr(_options.address.c_str(), _options.port);
+                if (IS_FAIL(_listenSocket->bind(localAddr)) || IS_FAIL(_listenSocket->listen())) {
+                    _listenSocket->dispose();
+                    _listenSocket = NULL;
+                    return SL_RESULT_OPERATION_FAIL;
+                }
+            } else {
+                _dgramSocket = rp::net::DGramSocket::CreateSocket();
+                if (!_dgramSocket) return SL_RESULT_OPERATION_FAIL;
+
+                _groupAddr = rp::net::SocketAddress(_options.address.c_str(), _options.port);
+                _dgramSocket->setMulticastOptions(_options.multicastTtl, true);
+            }
+
+            _isWorking = true;
+            _sendThread = CLASS_THREAD(LidarScanStreamServer, _proc_sendThread);
+            if (_listenSocket) {
+                _acceptThread = CLASS_THREAD(LidarScanStreamServer, _proc_acceptThread);
+            }
+            return SL_RESULT_OK;
+        }
+
+        void stop()
+        {
+            if (!_isWorking) return;
+
+            _isWorking = false;
+            _sendEvt.set();
+            _sendThread.join();
+            if (_listenSocket) _acceptThread.join();
+
+            {
+                rp::hal::AutoLocker l(_client_locker);
+                for (size_t pos = 0; pos < _clients.size(); ++pos) {
+                    _clients[pos]->dispose();
+                }
+                _clients.clear();
+            }
+
+            if (_listenSocket) {
+                _listenSocket->dispose();
+                _listenSocket = NULL;
+            }
+            if (_dgramSocket) {
+                _dgramSocket->dispose();
+                _dgramSocket = NULL;
+            }
+            _hasPendingScan = false;
+        }
+
+        sl_result publishScan(const sl_lidar_response_measurement_node_hq_t* nodes, size_t count, sl_u64 timestamp_uS)
+        {
+            if (!_isWorking) return SL_RESULT_OPERATION_FAIL;
+            if (count > internal::STREAM_MAX_NODE_COUNT) count = internal::STREAM_MAX_NODE_COUNT;
+
+            {
+                rp::hal::AutoLocker l(_pending_locker);
+                if (_hasPendingScan) ++_stats.droppedFrameCount;
+                _pendingNodes.assign(nodes, nodes + count);
+                _pendingTimestamp = timestamp_uS;
+                _hasPendingScan = true;
+            }
+            _sendEvt.set();
+            return SL_RESULT_OK;
+        }
+
+        size_t getClientCount()
+        {
+            rp::hal::AutoLocker l(_client_locker);
+            return _clients.size();
+        }
+
+        void getStats(LidarStreamStats& stats)
+        {
+            rp::hal::AutoLocker l(_pending_locker);
+            stats = _stats;
+        }
+
+    protected:
+        u_result _proc_acceptThread()
+        {
+            while (_isWorking) {
+                if (IS_FAIL(_listenSocket->waitforIncomingConnection(100))) continue;
+
+                rp::net::StreamSocket* client = _listenSocket->accept();
+                if (!client) continue;
+
+                rp::hal::AutoLocker l(_client_locker);
+                if (_clients.size() >= _options.maxClientCount) {
+                    client->dispose();
+                    continue;
+                }
+                client->enableNoDelay(true);
+                client->setTimeout(CLIENT_SEND_TIMEOUT, rp::net::SocketBase::SOCKET_DIR_WR);
+                _clients.push_back(client);
+            }
+            return RESULT_OK;
+        }
+
+        u_result _proc_sendThread()
+        {
+            while (_isWorking) {
+                if (_sendEvt.wait(100) != rp::hal::Event::EVENT_OK) continue;
+
+                sl_u64 timestamp_uS;
+                {
+                    rp::hal::AutoLocker l(_pending_locker);
+                    if (!_hasPendingScan) continue;
+                    _sendNodes.swap(_pendingNodes);
+                    timestamp_uS = _pendingTimestamp;
+                    _hasPendingScan = false;
+                }
+
+                size_t frameSize = _encodeFrame(timestamp_uS);
+                if (!frameSize) continue;
+
+                if (_listenSocket) {
+                    _sendFrameToClients(frameSize);
+                } else {
+                    _sendFrameToGroup();
+                }
+
+                rp::hal::AutoLocker l(_pending_locker);
+                ++_stats.frameCount;
+                _stats.rawBytes += _sendNodes.size() * sizeof(sl_lidar_response_measurement_node_hq_t);
+                _stats.encodedBytes += _encodedBytes;
+            }
+            return RESULT_OK;
+        }
+
+        // encodes the scan in _sendNodes into _frame (header + payload), returns its size
+        size_t _encodeFrame(sl_u64 timestamp_uS)
+        {
+            const size_t headerSize = sizeof(sl_lidar_stream_frame_header_t);
+            const size_t count = _sendNodes.size();
+            size_t bound = internal::_getEncodedScanSizeBound(count);
+
+            _payload.resize(bound);
+            size_t rawSize = internal::_encodeScanPayload(count ? &_sendNodes[0] : NULL, count, _options.qualityBits, &_payload[0]);
+
+            _u8 flags = 0;
+            size_t payloadSize = rawSize;
+#ifdef SL_LIDAR_STREAM_LZ4
+            if (_options.lz4) {
+                _frame.resize(headerSize + LZ4_compressBound((int)rawSize));
+                int compressed = LZ4_compress_default(reinterpret_cast<const char*>(&_payload[0]), reinterpret_cast<char*>(&_frame[headerSize]),
+                        (int)rawSize, (int)(_frame.size() - headerSize));
+                if (compressed <= 0) return 0;
+                payloadSize = (size_t)compressed;
+                flags |= SL_LIDAR_STREAM_FLAG_LZ4;
+            } else
+#endif
+            {
+                _frame.resize(headerSize + rawSize);
+                memcpy(&_frame[headerSize], &_payload[0], rawSize);
+            }
+
+            sl_lidar_stream_frame_header_t* header = reinterpret_cast<sl_lidar_stream_frame_header_t*>(&_frame[0]);
+            header->magic = cpu_to_le32(SL_LIDAR_STREAM_MAGIC);
+            header->version = SL_LIDAR_STREAM_VERSION;
+            header->flags = flags;
+            header->qualityBits = (_u8)_options.qualityBits;
+            header->reserved = 0;
+            header->sequence = cpu_to_le32(++_frameSequence);
+            header->nodeCount = cpu_to_le32((_u32)count);
+            header->timestamp_uS = cpu_to_le64(timestamp_uS);
+            header->payloadSize = cpu_to_le32((_u32)payloadSize);
+            header->rawPayloadSize = cpu_to_le32((_u32)rawSize);
+
+            _frame.resize(headerSize + payloadSize);
+            return _frame.size();
+        }
+
+        void _sendFrameToClients(size_t frameSize)
+        {
+            rp::hal::AutoLocker l(_client_locker);
+            _encodedBytes = frameSize;
+
+            for (size_t pos = 0; pos < _clients.size(); ) {
+                // a partial or timed out send leaves the stream out of sync, the client has to go
+                if (IS_FAIL(_clients[pos]->send(&_frame[0], frameSize))) {
+                    _clients[pos]->dispose();
+                    _clients.erase(_clients.begin() + pos);
+                } else {
+                    ++pos;
+                }
+            }
+        }
+
+        void _sendFrameToGroup()
+        {
+            const size_t headerSize = sizeof(sl_lidar_stream_frame_header_t) + sizeof(sl_lidar_stream_fragment_header_t);
+            const size_t payloadSize = _frame.size() - sizeof(sl_lidar_stream_frame_header_t);
+            const size_t chunkSize = _options.maxDatagramSize - headerSize;
+            const size_t fragmentCount = std::max<size_t>(1, (payloadSize + chunkSize - 1) / chunkSize);
+
+            _datagram.resize(_options.maxDatagramSize);
+            memcpy(&_datagram[0], &_frame[0], sizeof(sl_lidar_stream_frame_header_t));
+            sl_lidar_stream_fragment_header_t* fragment = reinterpret_cast<sl_lidar_stream_fragment_header_t*>(&_datagram[sizeof(sl_lidar_stream_frame_header_t)]);
+
+            _encodedBytes = 0;
+            for (size_t index = 0; index < fragmentCount; ++index) {
+                size_t offset = index * chunkSize;
+                size_t size = std::min(chunkSize, payloadSize - offset);
+
+                fragment->index = cpu_to_le16((_u16)index);
+                fragment->count = cpu_to_le16((_u16)fragmentCount);
+                fragment->offset = cpu_to_le32((_u32)offset);
+                if (size) memcpy(&_datagram[headerSize], &_frame[sizeof(sl_lidar_stream_frame_header_t) + offset], size);
+
+                if (IS_OK(_dgramSocket->sendTo(&_groupAddr, &_datagram[0], headerSize + size))) {
+                    _encodedBytes += headerSize + size;
+                }
+            }
+        }
+
+        LidarStreamServerOptions _options;
+        rp::net::StreamSocket* _listenSocket;
+        rp::net::DGramSocket* _dgramSocket;
+        rp::net::SocketAddress _groupAddr;
+        std::atomic<bool> _isWorking;
+
+        rp::hal::Locker _client_locker;
+        std::vector<rp::net::StreamSocket*> _clients;
+
+        rp::hal::Locker _pending_locker;
+        std::vector<sl_lidar_response_measurement_node_hq_t> _pendingNodes;
+        bool _hasPendingScan;
+        sl_u64 _pendingTimestamp;
+        LidarStreamStats _stats;
+
+        // owned by the sending thread
+        std::vector<sl_lidar_response_measurement_node_hq_t> _sendNodes;
+        std::vector<_u8> _payload;
+        std::vector<_u8> _frame;
+        std::vector<_u8> _datagram;
+        size_t _encodedBytes;
+        _u32 _frameSequence;
+
+        rp::hal::Event _sendEvt;
+        rp::hal::Thread _sendThread;
+        rp::hal::Thread _acceptThread;
+    };
+
+
+    class LidarScanStreamClient : public ILidarScanStreamClient
+    {
+    public:
+        LidarScanStreamClient()
+            : _streamSocket(NULL)
+            , _dgramSocket(NULL)
+            , _isWorking(false)
+            , _isConnected(false)
+            , _scanTimestamp(0)
+            , _rxFilled(0)
+            , _fragmentSequence(0)
+            , _fragmentCount(0)
+            , _fragmentReceived(0)
+            , _scanEvt(true, false)
+        {
+        }
+
+        virtual ~LidarScanStreamClient()
+        {
+            disconnect();
+        }
+
+        sl_result connect(const LidarStreamClientOptions& options)
+        {
+            disconnect();
+            _options = options;
+
+            if (_options.transport == LIDAR_STREAM_TRANSPORT_TCP) {
+                _streamSocket = rp::net::StreamSocket::CreateSocket();
+                if (!_streamSocket) return SL_RESULT_OPERATION_FAIL;
+
+                rp::net::SocketAddress serverAddr(_options.address.c_str(), _options.port);
+                if (IS_FAIL(_streamSocket->connect(serverAddr))) {
+                    _streamSocket->dispose();
+                    _streamSocket = NULL;
+                    return SL_RESULT_OPERATION_FAIL;
+                }
+            } else {
+                _dgramSocket = rp::net::DGramSocket::CreateSocket();
+                if (!_dgramSocket) return SL_RESULT_OPERATION_FAIL;
+
+                rp::net::SocketAddress localAddr("0.0.0.0", _options.port);
+                rp::net::SocketAddress groupAddr(_options.address.c_str(), _options.port);
+                rp::net::SocketAddress interfaceAddr(_options.interfaceAddress.empty() ? "0.0.0.0" : _options.interfaceAddress.c_str(), 0);
+                if (IS_FAIL(_dgramSocket->bind(localAddr))
+                    || IS_FAIL(_dgramSocket->joinMulticastGroup(groupAddr, _options.interfaceAddress.empty() ? NULL : &interfaceAddr))) {
+                    _dgramSocket->dispose();
+                    _dgramSocket = NULL;
+                    return SL_RESULT_OPERATION_FAIL;
+                }
+            }
+
+            _rxFilled = 0;
+            _fragmentCount = 0;
+            _isWorking = true;
+            _isConnected = true;
+            _rxThread = CLASS_THREAD(LidarScanStreamClient, _proc_rxThread);
+            return SL_RESULT_OK;
+        }
+
+        void disconnect()
+        {
+            if (!_isWorking) return;
+
+            _isWorking = false;
+            _rxThread.join();
+            _isConnected = false;
+
+            if (_streamSocket) {
+                _streamSocket->dispose();
+                _streamSocket = NULL;
+            }
+            if (_dgramSocket) {
+                _dgramSocket->dispose();
+                _dgramSocket = NULL;
+            }
+        }
+
+        bool isConnected()
+        {
+            return _isConnected;
+        }
+
+        sl_result grabScanDataHq(sl_lidar_response_measurement_node_hq_t* nodebuffer, size_t& count, sl_u32 timeout)
+        {
+            sl_u64 timestamp_uS;
+            return grabScanDataHqWithTimeStamp(nodebuffer, count, timestamp_uS, timeout);
+        }
+
+        sl_result grabScanDataHqWithTimeStamp(sl_lidar_response_measurement_node_hq_t* nodebuffer, size_t& count, sl_u64& timestamp_uS, sl_u32 timeout)
+        {
+            switch (_scanEvt.wait(timeout)) {
+            case rp::hal::Event::EVENT_TIMEOUT:
+                count = 0;
+                return _isConnected ? SL_RESULT_OPERATION_TIMEOUT : SL_RESULT_OPERATION_FAIL;
+            case rp::hal::Event::EVENT_OK:
+                {
+                    rp::hal::AutoLocker l(_scan_locker);
+                    size_t size_to_copy = std::min(count, _scanNodes.size());
+                    if (size_to_copy) memcpy(nodebuffer, &_scanNodes[0], size_to_copy * sizeof(sl_lidar_response_measurement_node_hq_t));
+                    count = size_to_copy;
+                    timestamp_uS = _scanTimestamp;
+                }
+                return SL_RESULT_OK;
+            default:
+                count = 0;
+                return SL_RESULT_OPERATION_FAIL;
+            }
+        }
+
+        void getStats(LidarStreamStats& stats)
+        {
+            rp::hal::AutoLocker l(_scan_locker);
+            stats = _stats;
+        }
+
+    protected:
+        u_result _proc_rxThread()
+        {
+            if (_streamSocket) {
+                _receiveStream();
+            } else {
+                _receiveDatagrams();
+            }
+            _isConnected = false;
+            return RESULT_OK;
+        }
+
+        void _receiveStream()
+        {
+            const size_t headerSize = sizeof(sl_lidar_stream_frame_header_t);
+            _rxBuffer.resize(64 * 1024);
+
+            while (_isWorking) {
+                u_result ans = _streamSocket->waitforData(100);
+                if (ans == RESULT_OPERATION_TIMEOUT) continue;
+                if (IS_FAIL(ans)) return;
+
+                if (_rxFilled == _rxBuffer.size()) _rxBuffer.resize(_rxBuffer.size() * 2);
+                size_t received = 0;
+                ans = _streamSocket->recv(&_rxBuffer[_rxFilled], _rxBuffer.size() - _rxFilled, received);
+                if (ans == RESULT_OPERATION_TIMEOUT) continue;
+                if (IS_FAIL(ans) || !received) return; // closed by the server
+                _rxFilled += received;
+
+                size_t consumed = 0;
+                while (_rxFilled - consumed >= headerSize) {
+                    const sl_lidar_stream_frame_header_t* header = reinterpret_cast<const sl_lidar_stream_frame_header_t*>(&_rxBuffer[consumed]);
+                    size_t payloadSize = le32_to_cpu(header->payloadSize);
+
+                    // nothing to resync on in a stream
+                    if (le32_to_cpu(header->magic) != SL_LIDAR_STREAM_MAGIC || payloadSize > internal::STREAM_MAX_PAYLOAD_SIZE) return;
+                    if (_rxFilled - consumed < headerSize + payloadSize) {
+                        if (_rxBuffer.size() < headerSize + payloadSize) _rxBuffer.resize(headerSize + payloadSize);
+                        break;
+                    }
+
+                    _onFrameReceived(*header, &_rxBuffer[consumed + headerSize], headerSize + payloadSize);
+                    consumed += headerSize + payloadSize;
+                }
+
+                if (consumed) {
+                    memmove(&_rxBuffer[0], &_rxBuffer[consumed], _rxFilled - consumed);
+                    _rxFilled -= consumed;
+                }
+            }
+        }
+
+        void _receiveDatagrams()
+        {
+            const size_t headerSize = sizeof(sl_lidar_stream_frame_header_t) + sizeof(sl_lidar_stream_fragment_header_t);
+            _rxBuffer.resize(64 * 1024);
+
+            while (_isWorking) {
+                u_result ans = _dgramSocket->waitforData(100);
+                if (ans == RESULT_OPERATION_TIMEOUT) continue;
+                if (IS_FAIL(ans)) return;
+
+                size_t received = 0;
+                if (IS_FAIL(_dgramSocket->recvFrom(&_rxBuffer[0], _rxBuffer.size(), received))) continue;
+                if (received < headerSize) continue;
+
+                const sl_lidar_stream_frame_header_t* header = reinterpret_cast<const sl_lidar_stream_frame_header_t*>(&_rxBuffer[0]);
+                const sl_lidar_stream_fragment_header_t* fragment = reinterpret_cast<const sl_lidar_stream_fragment_header_t*>(&_rxBuffer[sizeof(sl_lidar_stream_frame_header_t)]);
+                if (le32_to_cpu(header->magic) != SL_LIDAR_STREAM_MAGIC) continue;
+
+                _u32 sequence = le32_to_cpu(header->sequence);
+                size_t payloadSize = le32_to_cpu(header->payloadSize);
+                size_t index = le16_to_cpu(fragment->index);
+                size_t count = le16_to_cpu(fragment->count);
+                size_t offset = le32_to_cpu(fragment->offset);
+                size_t size = received - headerSize;
+                if (payloadSize > internal::STREAM_MAX_PAYLOAD_SIZE || index >= count || offset + size > payloadSize) continue;
+
+                if (!_fragmentCount || sequence != _fragmentSequence) {
+                    // a new frame, the one being assembled (if any) lost a datagram
+                    if (_fragmentCount) {
+                        rp::hal::AutoLocker l(_scan_locker);
+                        ++_stats.droppedFrameCount;
+                    }
+                    _fragmentSequence = sequence;
+                    _fragmentCount = count;
+                    _fragmentReceived = 0;
+                    _fragmentMask.assign(count, false);
+                    _fragmentPayload.resize(payloadSize);
+                } else if (count != _fragmentCount || payloadSize != _fragmentPayload.size()) {
+                    continue;
+                }
+
+                if (_fragmentMask[index]) continue;
+                _fragmentMask[index] = true;
+                ++_fragmentReceived;
+                if (size) memcpy(&_fragmentPayload[offset], &_rxBuffer[headerSize], size);
+
+                if (_fragmentReceived == _fragmentCount) {
+                    _fragmentCount = 0;
+                    _onFrameReceived(*header, _fragmentPayload.empty() ? NULL : &_fragmentPayload[0],
+                            sizeof(sl_lidar_stream_frame_header_t) + payloadSize);
+                }
+            }
+        }
+
+        void _onFrameReceived(const sl_lidar_stream_frame_header_t& header, const _u8* payload, size_t wireSize)
+        {
+            size_t nodeCount = le32_to_cpu(header.nodeCount);
+            size_t payloadSize = le32_to_cpu(header.payloadSize);
+            size_t rawSize = le32_to_cpu(header.rawPayloadSize);
+            bool decoded = false;
+
+            if (header.version == SL_LIDAR_STREAM_VERSION && header.qualityBits <= 8
+                && nodeCount <= internal::STREAM_MAX_NODE_COUNT && rawSize <= internal::STREAM_MAX_PAYLOAD_SIZE) {
+                if (header.flags & SL_LIDAR_STREAM_FLAG_LZ4) {
+#ifdef SL_LIDAR_STREAM_LZ4
+                    _rawPayload.resize(rawSize);
+                    if (rawSize && payloadSize
+                        && LZ4_decompress_safe(reinterpret_cast<const char*>(payload), reinterpret_cast<char*>(&_rawPayload[0]), (int)payloadSize, (int)rawSize) == (int)rawSize) {
+                        decoded = internal::_decodeScanPayload(&_rawPayload[0], rawSize, nodeCount, header.qualityBits, _decodedNodes);
+                    }
+#endif
+                } else if (rawSize == payloadSize) {
+                    decoded = internal::_decodeScanPayload(payload, payloadSize, nodeCount, header.qualityBits, _decodedNodes);
+                }
+            }
+
+            rp::hal::AutoLocker l(_scan_locker);
+            if (!decoded) {
+                ++_stats.droppedFrameCount;
+                return;
+            }
+            _scanNodes.swap(_decodedNodes);
+            _scanTimestamp = le64_to_cpu(header.timestamp_uS);
+            ++_stats.frameCount;
+            _stats.rawBytes += nodeCount * sizeof(sl_lidar_response_measurement_node_hq_t);
+            _stats.encodedBytes += wireSize;
+            _scanEvt.set();
+        }
+
+        LidarStreamClientOptions _options;
+        rp::net::StreamSocket* _streamSocket;
+        rp::net::DGramSocket* _dgramSocket;
+        std::atomic<bool> _isWorking;
+        std::atomic<bool> _isConnected;
+
+        rp::hal::Locker _scan_locker;
+        std::vector<sl_lidar_response_measurement_node_hq_t> _scanNodes;
+        sl_u64 _scanTimestamp;
+        LidarStreamStats _stats;
+
+        // owned by the receiving thread
+        std::vector<_u8> _rxBuffer;
+        size_t _rxFilled;
+        std::vector<_u8> _rawPayload;
+        std::vector<sl_lidar_response_measurement_node_hq_t> _decodedNodes;
+
+        _u32 _fragmentSequence;
+        size_t _fragmentCount;
+        size_t _fragmentReceived;
+        std::vector<bool> _fragmentMask;
+        std::vector<_u8> _fragmentPayload;
+
+        rp::hal::Event _scanEvt;
+        rp::hal::Thread _rxThread;
+    };
+
+    Result<ILidarScanStreamServer*> createLidarScanStreamServer()
+    {
+        return new LidarScanStreamServer();
+    }
+
+    Result<ILidarScanStreamClient*> createLidarScanStreamClient()
+    {
+        return new LidarScanStreamClient();
+    }
+}
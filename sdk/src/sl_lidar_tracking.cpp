@@ -0,0 +1,262 @@
+/*
+ *  Slamtec LIDAR SDK
+ *
+ *  Copyright (c) 2014 - 2023 Shanghai Slamtec Co., Ltd.
+ *  http://www.slamtec.com
+ *
+ */
+ /*
+  * Redistribution and use in source and binary forms, with or without
+  * modification, are permitted provided that the following conditions are met:
+  *
+  * 1. Redistributions of source code must retain the above copyright notice,
+  *    this list of conditions and the following disclaimer.
+  *
+  * 2. Redistributions in binary form must reproduce the above copyright notice,
+  *    this list of conditions and the following disclaimer in the documentation
+  *    and/or other materials provided with the distribution.
+  *
+  * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+  * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+  * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+  * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+  * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+  * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+  * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+  * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+  * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+  * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+  * EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+  *
+  */
+
+#include "sdkcommon.h"
+#include "sl_lidar_driver.h"
+#include "sl_lidar_tracking.h"
+#include "sl_lidar_projection.h"
+
+#include <math.h>
+#include <algorithm>
+
+namespace sl {
+
+    LidarScanClusterer::LidarScanClusterer(const LidarClusterOptions& options)
+        : _options(options)
+    {
+    }
+
+    size_t LidarScanClusterer::cluster(const float* x, const float* y, size_t count, std::vector<LidarCluster>& clusters)
+    {
+        clusters.clear();
+        _runs.clear();
+        if (!x || !y) return 0;
+
+        size_t previous = count;
+        for (size_t pos = 0; pos < count; ++pos) {
+            if (x[pos] == 0 && y[pos] == 0) continue;
+
+            if (previous == count || !_isAdjacent(x[previous], y[previous], x[pos], y[pos])) {
+                Run run;
+                run.first = pos;
+                run.pointCount = 0;
+                run.sumX = 0;
+                run.sumY = 0;
+                run.minX = run.maxX = x[pos];
+                run.minY = run.maxY = y[pos];
+                _runs.push_back(run);
+            }
+
+            Run& run = _runs.back();
+            run.last = pos;
+            ++run.pointCount;
+            run.sumX += x[pos];
+            run.sumY += y[pos];
+            run.minX = std::min(run.minX, x[pos]);
+            run.minY = std::min(run.minY, y[pos]);
+            run.maxX = std::max(run.maxX, x[pos]);
+            run.maxY = std::max(run.maxY, y[pos]);
+            previous = pos;
+        }
+
+        // the scan closes on itself, the run crossing its end is split in two
+        size_t firstRun = 0;
+        if (_runs.size() > 1) {
+            Run& head = _runs.front();
+            Run& tail = _runs.back();
+            if (_isAdjacent(x[tail.last], y[tail.last], x[head.first], y[head.first])) {
+                tail.last = head.last;
+                tail.pointCount += head.pointCount;
+                tail.sumX += head.sumX;
+                tail.sumY += head.sumY;
+                tail.minX = std::min(tail.minX, head.minX);
+                tail.minY = std::min(tail.minY, head.minY);
+                tail.maxX = std::max(tail.maxX, head.maxX);
+                tail.maxY = std::max(tail.maxY, head.maxY);
+                firstRun = 1;
+            }
+        }
+
+        for (size_t pos = firstRun; pos < _runs.size(); ++pos) {
+            _emitCluster(_runs[pos], x, y, clusters);
+        }
+        return clusters.size();
+    }
+
+    size_t LidarScanClusterer::cluster(const sl_lidar_response_measurement_node_hq_t* nodes, size_t count, std::vector<LidarCluster>& clusters)
+    {
+        clusters.clear();
+        if (!nodes) return 0;
+
+        if (_nodeX.size() < count + 1) {
+            _nodeX.resize(count + 1);
+            _nodeY.resize(count + 1);
+        }
+        projectScanToCartesian(nodes, count, &_nodeX[0], &_nodeY[0]);
+        return cluster(&_nodeX[0], &_nodeY[0], count, clusters);
+    }
+
+    bool LidarScanClusterer::_isAdjacent(float x0, float y0, float x1, float y1) const
+    {
+        float dx = x1 - x0;
+        float dy = y1 - y0;
+        float range = sqrtf(std::min(x0 * x0 + y0 * y0, x1 * x1 + y1 * y1));
+        float threshold = _options.maxGap + _options.gapPerMeter * range / 1000.f;
+        return dx * dx + dy * dy <= threshold * threshold;
+    }
+
+    void LidarScanClusterer::_emitCluster(const Run& run, const float* x, const float* y, std::vector<LidarCluster>& clusters) const
+    {
+        if (run.pointCount < std::max<size_t>(_options.minPointCount, 1)) return;
+
+        float dx = x[run.last] - x[run.first];
+        float dy = y[run.last] - y[run.first];
+        float width = sqrtf(dx * dx + dy * dy);
+        if (_options.maxWidth > 0 && width > _options.maxWidth) return;
+
+        LidarCluster cluster;
+        cluster.centerX = (float)(run.sumX / run.pointCount);
+        cluster.centerY = (float)(run.sumY / run.pointCount);
+        cluster.minX = run.minX;
+        cluster.minY = run.minY;
+        cluster.maxX = run.maxX;
+        cluster.maxY = run.maxY;
+        cluster.width = width;
+        cluster.firstIndex = (sl_u32)run.first;
+        cluster.lastIndex = (sl_u32)run.last;
+        cluster.pointCount = (sl_u32)run.pointCount;
+        clusters.push_back(cluster);
+    }
+
+
+    LidarObjectTracker::LidarObjectTracker(const LidarTrackerOptions& options)
+        : _options(options)
+        , _nextID(1)
+        , _lastTimestamp_uS(0)
+    {
+        _tracks.reserve(_options.maxTracks);
+    }
+
+    void LidarObjectTracker::reset()
+    {
+        _tracks.clear();
+        _lastTimestamp_uS = 0;
+    }
+
+    size_t LidarObjectTracker::update(const LidarCluster* clusters, size_t count, sl_u64 timestamp_uS)
+    {
+        if (!clusters) count = 0;
+
+        float dt = 0;
+        if (_lastTimestamp_uS && timestamp_uS > _lastTimestamp_uS) {
+            dt = (float)(timestamp_uS - _lastTimestamp_uS) / 1e6f;
+        }
+        _lastTimestamp_uS = timestamp_uS;
+
+        // predict
+        for (size_t pos = 0; pos < _tracks.size(); ++pos) {
+            LidarTrack& track = _tracks[pos];
+            track.x += track.vx * dt;
+            track.y += track.vy * dt;
+            ++track.age;
+            track.clusterIndex = -1;
+        }
+
+        // gated candidates, assigned greedily from the nearest one
+        float gateSq = _options.gateDistance * _options.gateDistance;
+        _candidates.clear();
+        for (size_t trackPos = 0; trackPos < _tracks.size(); ++trackPos) {
+            const LidarTrack& track = _tracks[trackPos];
+            for (size_t clusterPos = 0; clusterPos < count; ++clusterPos) {
+                float dx = clusters[clusterPos].centerX - track.x;
+                float dy = clusters[clusterPos].centerY - track.y;
+                float distanceSq = dx * dx + dy * dy;
+                if (distanceSq > gateSq) continue;
+
+                Candidate candidate;
+                candidate.distanceSq = distanceSq;
+                candidate.track = (sl_u32)trackPos;
+                candidate.cluster = (sl_u32)clusterPos;
+                _candidates.push_back(candidate);
+            }
+        }
+        std::sort(_candidates.begin(), _candidates.end(), [](const Candidate& a, const Candidate& b) {
+            return a.distanceSq < b.distanceSq;
+        });
+
+        _clusterAssigned.assign(count, 0);
+        for (size_t pos = 0; pos < _candidates.size(); ++pos) {
+            const Candidate& candidate = _candidates[pos];
+            LidarTrack& track = _tracks[candidate.track];
+            if (track.clusterIndex >= 0 || _clusterAssigned[candidate.cluster]) continue;
+
+            const LidarCluster& cluster = clusters[candidate.cluster];
+            float residualX = cluster.centerX - track.x;
+            float residualY = cluster.centerY - track.y;
+            track.x += _options.positionGain * residualX;
+            track.y += _options.positionGain * residualY;
+            if (dt > 0) {
+                track.vx += _options.velocityGain * residualX / dt;
+                track.vy += _options.velocityGain * residualY / dt;
+            }
+            track.width = cluster.width;
+            ++track.hits;
+            track.misses = 0;
+            if (track.hits >= _options.confirmHits) track.confirmed = true;
+            track.clusterIndex = (sl_s32)candidate.cluster;
+            track.timestamp_uS = timestamp_uS;
+            _clusterAssigned[candidate.cluster] = 1;
+        }
+
+        // the tracks left unassigned coast on their prediction until they are missed too often
+        size_t kept = 0;
+        for (size_t pos = 0; pos < _tracks.size(); ++pos) {
+            LidarTrack& track = _tracks[pos];
+            if (track.clusterIndex < 0 && ++track.misses > _options.maxMisses) continue;
+            if (kept != pos) _tracks[kept] = track;
+            ++kept;
+        }
+        _tracks.resize(kept);
+
+        for (size_t pos = 0; pos < count && _tracks.size() < _options.maxTracks; ++pos) {
+            if (_clusterAssigned[pos]) continue;
+
+            LidarTrack track;
+            track.id = _nextID++;
+            track.x = clusters[pos].centerX;
+            track.y = clusters[pos].centerY;
+            track.vx = 0;
+            track.vy = 0;
+            track.width = clusters[pos].width;
+            track.age = 0;
+            track.hits = 1;
+            track.misses = 0;
+            track.confirmed = (track.hits >= _options.confirmHits);
+            track.clusterIndex = (sl_s32)pos;
+            track.timestamp_uS = timestamp_uS;
+            _tracks.push_back(track);
+        }
+
+        return _tracks.size();
+    }
+
+}
@@ -48,6 +48,7 @@
 
 #include "sl_async_transceiver.h"
 #include "sl_lidarprotocol_codec.h"
+#include "sl_trace.h"
 
 
 
@@ -58,9 +59,9 @@ namespace sl { namespace internal {
 RPLidarProtocolCodec::RPLidarProtocolCodec()
     : IAsyncProtocolCodec()
     , _listener(NULL)
-    , _op_locker(true)
+    , _decodeResetRequested(false)
 {
-    onDecodeReset();
+    _applyDecodeReset();
 }
 
 void RPLidarProtocolCodec::exitLoopMode() {
@@ -71,8 +72,7 @@ void RPLidarProtocolCodec::exitLoopMode() {
 
 void RPLidarProtocolCodec::setMessageListener(IProtocolMessageListener* listener)
 {
-    rp::hal::AutoLocker l(_op_locker);
-    _listener = listener;
+    _listener.store(listener, std::memory_order_release);
 }
 
 size_t RPLidarProtocolCodec::estimateLength(message_autoptr_t& message)
@@ -129,8 +129,19 @@ void RPLidarProtocolCodec::onEncodeData(message_autoptr_t& message, _u8* buffer,
     *size = currentPos;
 }
 
+void   RPLidarProtocolCodec::onChannelError(u_result errCode) {
+    IProtocolMessageListener* cachedLister = _listener.load(std::memory_order_acquire);
+    if (cachedLister) cachedLister->onProtocolChannelError(errCode);
+}
+
 void   RPLidarProtocolCodec::onDecodeReset() {
-    rp::hal::AutoLocker autolock(_op_locker);
+    // applied by the decoding thread at the start of its next onDecodeData call or after the message
+    // it is completing, the bytes of a header or payload in progress are still decoded against the old state
+    _decodeResetRequested.store(true, std::memory_order_release);
+}
+
+void RPLidarProtocolCodec::_applyDecodeReset()
+{
     // flush the pending data
     _decodingMessage.cleanData();
     // reset to initial state
@@ -141,13 +152,57 @@ void   RPLidarProtocolCodec::onDecodeReset() {
 
 void RPLidarProtocolCodec::onDecodeData(const void* buffer, size_t size)
 {
-    rp::hal::AutoLocker autolock(_op_locker);
-
+    SL_TRACE_SCOPE_ARG(traceScope, "codec.decode", size);
     const _u8* data = reinterpret_cast<const _u8*>(buffer);
     const _u8* dataEnd = data + size;
 
+    if (_decodeResetRequested.exchange(false, std::memory_order_acquire)) {
+        _applyDecodeReset();
+    }
 
     while (data != dataEnd) {
+
+        if ((_working_states & ((_u32)STATUS_LOOP_MODE_FLAG - 1)) == STATUS_RECV_PAYLOAD) {
+            size_t payloadSize = _decodingMessage.getPayloadSize();
+            size_t available = (size_t)(dataEnd - data);
+            const _u8* payload;
+
+            if (!_rx_pos && available >= payloadSize) {
+                // the whole payload is in the buffer, lend it out without copying
+                payload = data;
+                data += payloadSize;
+            }
+            else {
+                size_t copySize = std::min<size_t>(payloadSize - _rx_pos, available);
+                memcpy(_decodingMessage.getDataBuf() + _rx_pos, data, copySize);
+                _rx_pos += copySize;
+                data += copySize;
+
+                if (_rx_pos != payloadSize) break;
+                payload = _decodingMessage.getDataBuf();
+            }
+
+            if (_working_states & STATUS_LOOP_MODE_FLAG) {
+                // rewind to the payload recv status in loop mode
+                _rx_pos = 0;
+            }
+            else {
+                // reset the decoder
+                _working_states = STATUS_WAIT_SYNC1;
+            }
+
+            IProtocolMessageListener* cachedLister = _listener.load(std::memory_order_acquire);
+            if (cachedLister) {
+                cachedLister->onProtocolMessageDecoded(_decodingMessage.cmd, payload, payloadSize);
+            }
+
+            if (_decodeResetRequested.load(std::memory_order_relaxed)
+                && _decodeResetRequested.exchange(false, std::memory_order_acquire)) {
+                _applyDecodeReset();
+            }
+            continue;
+        }
+
         _u8 currentByte = *data;
         ++data;
 
@@ -202,31 +257,6 @@ void RPLidarProtocolCodec::onDecodeData(const void* buffer, size_t size)
                 _working_states = STATUS_WAIT_SYNC1;
             }
             break;
-        case STATUS_RECV_PAYLOAD:
-            _decodingMessage.getDataBuf()[_rx_pos++] = currentByte;
-
-            if ((size_t)_rx_pos == _decodingMessage.getPayloadSize()) {
-                if (_working_states & STATUS_LOOP_MODE_FLAG) {
-                    // rewind to the payload recv status in loop mode
-                    _rx_pos = 0;
-                }
-                else {
-                    // reset the decoder
-                    _working_states = STATUS_WAIT_SYNC1;
-                }
-
-                IProtocolMessageListener* cachedLister = _listener;
-
-                autolock.forceUnlock(); //unlock the oplock to prevent deadlock
-
-
-                if (cachedLister) {
-                    cachedLister->onProtocolMessageDecoded(_decodingMessage);
-                }
-
-                _op_locker.lock(); // relock it
-            }
-            break;
         }
 
     }
@@ -40,7 +40,12 @@ namespace sl { namespace internal {
 
 class IProtocolMessageListener {
 public:
-    virtual void onProtocolMessageDecoded(const ProtocolMessage&) = 0;
+    // the payload is borrowed (it may point into the rx buffer) and only valid during the call,
+    // build a ProtocolMessage from it to keep it
+    virtual void onProtocolMessageDecoded(_u8 cmd, const _u8* payload, size_t size) = 0;
+
+    // the channel failed, called from the thread which found it out
+    virtual void onProtocolChannelError(u_result errCode) {}
 };
 
 
@@ -67,19 +72,23 @@ public:
 
     virtual void onEncodeData(message_autoptr_t& message, _u8* txbuffer, size_t* size);
 
+    virtual void   onChannelError(u_result errCode);
     virtual void   onDecodeReset();
     virtual void   onDecodeData(const void* buffer, size_t size);
     
     void setMessageListener(IProtocolMessageListener* l);
 
 protected:
+    void _applyDecodeReset();
 
-    IProtocolMessageListener* _listener;
+    std::atomic<IProtocolMessageListener*> _listener;
     ProtocolMessage          _decodingMessage;
-    rp::hal::Locker          _op_locker;
+
+    // set by onDecodeReset and applied by the decoding thread itself, so decoding takes no lock
+    std::atomic<bool>        _decodeResetRequested;
                             
     _u32                     _working_states;
-    int                      _rx_pos;
+    size_t                   _rx_pos;
 };
 
 }}
@@ -0,0 +1,154 @@
+/*
+ *  Slamtec LIDAR SDK
+ *
+ *  Copyright (c) 2014 - 2023 Shanghai Slamtec Co., Ltd.
+ *  http://www.slamtec.com
+ *
+ */
+ /*
+  * Redistribution and use in source and binary forms, with or without
+  * modification, are permitted provided that the following conditions are met:
+  *
+  * 1. Redistributions of source code must retain the above copyright notice,
+  *    this list of conditions and the following disclaimer.
+  *
+  * 2. Redistributions in binary form must reproduce the above copyright notice,
+  *    this list of conditions and the following disclaimer in the documentation
+  *    and/or other materials provided with the distribution.
+  *
+  * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+  * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+  * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+  * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+  * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+  * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+  * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+  * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+  * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+  * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+  * EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+  *
+  */
+
+#pragma once
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+namespace sl { namespace internal {
+
+// a whole file mapped read-only, the pages are read in on demand
+class MappedFile
+{
+public:
+    enum AccessHint {
+        ACCESS_SEQUENTIAL,
+        ACCESS_RANDOM,
+    };
+
+    MappedFile()
+        : _mapped(NULL)
+        , _mappedSize(0)
+#ifdef _WIN32
+        , _fileHandle(INVALID_HANDLE_VALUE)
+        , _mappingHandle(NULL)
+#endif
+    {
+    }
+
+    ~MappedFile()
+    {
+        close();
+    }
+
+    // SL_RESULT_FORMAT_NOT_SUPPORT for an empty file, it cannot be mapped
+    sl_result open(const char* path, AccessHint hint = ACCESS_SEQUENTIAL)
+    {
+        close();
+#ifdef _WIN32
+        _fileHandle = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE, NULL, OPEN_EXISTING,
+            hint == ACCESS_SEQUENTIAL ? FILE_FLAG_SEQUENTIAL_SCAN : FILE_FLAG_RANDOM_ACCESS, NULL);
+        if (_fileHandle == INVALID_HANDLE_VALUE) return SL_RESULT_OPERATION_FAIL;
+
+        LARGE_INTEGER fileSize;
+        if (!GetFileSizeEx(_fileHandle, &fileSize) || !fileSize.QuadPart) {
+            CloseHandle(_fileHandle);
+            _fileHandle = INVALID_HANDLE_VALUE;
+            return SL_RESULT_FORMAT_NOT_SUPPORT;
+        }
+
+        _mappingHandle = CreateFileMapping(_fileHandle, NULL, PAGE_READONLY, 0, 0, NULL);
+        if (_mappingHandle) {
+            _mapped = (const sl_u8*)MapViewOfFile(_mappingHandle, FILE_MAP_READ, 0, 0, 0);
+        }
+        if (!_mapped) {
+            if (_mappingHandle) CloseHandle(_mappingHandle);
+            CloseHandle(_fileHandle);
+            _mappingHandle = NULL;
+            _fileHandle = INVALID_HANDLE_VALUE;
+            return SL_RESULT_OPERATION_FAIL;
+        }
+        _mappedSize = (size_t)fileSize.QuadPart;
+#else
+        int fd = ::open(path, O_RDONLY);
+        if (fd < 0) return SL_RESULT_OPERATION_FAIL;
+
+        struct stat st;
+        if (fstat(fd, &st) || !st.st_size) {
+            ::close(fd);
+            return SL_RESULT_FORMAT_NOT_SUPPORT;
+        }
+
+        void* mapped = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        // the mapping keeps the file referenced
+        ::close(fd);
+        if (mapped == MAP_FAILED) return SL_RESULT_OPERATION_FAIL;
+
+        madvise(mapped, (size_t)st.st_size, hint == ACCESS_SEQUENTIAL ? MADV_SEQUENTIAL : MADV_RANDOM);
+
+        _mapped = (const sl_u8*)mapped;
+        _mappedSize = (size_t)st.st_size;
+#endif
+        return SL_RESULT_OK;
+    }
+
+    void close()
+    {
+        if (!_mapped) return;
+#ifdef _WIN32
+        UnmapViewOfFile(_mapped);
+        CloseHandle(_mappingHandle);
+        CloseHandle(_fileHandle);
+        _mappingHandle = NULL;
+        _fileHandle = INVALID_HANDLE_VALUE;
+#else
+        munmap((void*)_mapped, _mappedSize);
+#endif
+        _mapped = NULL;
+        _mappedSize = 0;
+    }
+
+    bool isOpened() const { return _mapped != NULL; }
+
+    const sl_u8* data() const { return _mapped; }
+    size_t size() const { return _mappedSize; }
+
+private:
+    MappedFile(const MappedFile&);
+    MappedFile& operator=(const MappedFile&);
+
+    const sl_u8* _mapped;
+    size_t       _mappedSize;
+#ifdef _WIN32
+    HANDLE       _fileHandle;
+    HANDLE       _mappingHandle;
+#endif
+};
+
+}}
@@ -0,0 +1,178 @@
+/*
+ *  Slamtec LIDAR SDK
+ *
+ *  Copyright (c) 2014 - 2023 Shanghai Slamtec Co., Ltd.
+ *  http://www.slamtec.com
+ *
+ */
+ /*
+  * Redistribution and use in source and binary forms, with or without
+  * modification, are permitted provided that the following conditions are met:
+  *
+  * 1. Redistributions of source code must retain the above copyright notice,
+  *    this list of conditions and the following disclaimer.
+  *
+  * 2. Redistributions in binary form must reproduce the above copyright notice,
+  *    this list of conditions and the following disclaimer in the documentation
+  *    and/or other materials provided with the distribution.
+  *
+  * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+  * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+  * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+  * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+  * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+  * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+  * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+  * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+  * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+  * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+  * EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+  *
+  */
+
+#pragma once
+
+#include <new>
+#include <algorithm>
+#include <string.h>
+
+namespace sl { namespace internal {
+
+// a fixed capacity array of nodes in a storage owned by somebody else, it never allocates
+template<typename T>
+class NodeBuffer
+{
+public:
+    NodeBuffer()
+        : _nodes(NULL)
+        , _size(0)
+        , _capacity(0)
+    {
+    }
+
+    void attach(T* storage, size_t capacity)
+    {
+        _nodes = storage;
+        _size = 0;
+        _capacity = storage ? capacity : 0;
+    }
+
+    T* data() { return _nodes; }
+    const T* data() const { return _nodes; }
+    const T* begin() const { return _nodes; }
+    const T* end() const { return _nodes + _size; }
+
+    size_t size() const { return _size; }
+    size_t capacity() const { return _capacity; }
+    bool empty() const { return !_size; }
+
+    T& operator[](size_t pos) { return _nodes[pos]; }
+    const T& operator[](size_t pos) const { return _nodes[pos]; }
+    T& front() { return _nodes[0]; }
+    const T& front() const { return _nodes[0]; }
+    T& back() { return _nodes[_size - 1]; }
+    const T& back() const { return _nodes[_size - 1]; }
+
+    void clear() { _size = 0; }
+
+    // the caller makes sure the nodes fit
+    void push_back(const T& node)
+    {
+        _nodes[_size++] = node;
+    }
+
+    void append(const T* nodes, size_t count)
+    {
+        std::copy(nodes, nodes + count, _nodes + _size);
+        _size += count;
+    }
+
+private:
+    T*     _nodes;
+    size_t _size;
+    size_t _capacity;
+};
+
+// a single block the buffers of a driver are carved from, see LidarMemoryProfile
+class MemoryArena
+{
+public:
+    enum {
+        ALIGNMENT = 64,
+    };
+
+    MemoryArena()
+        : _block(NULL)
+        , _size(0)
+        , _used(0)
+    {
+    }
+
+    ~MemoryArena()
+    {
+        release();
+    }
+
+    // the whole block is touched, so that it is resident from now on and nothing is paged in while streaming
+    bool allocate(size_t size)
+    {
+        if (size == _size && _block) {
+            _used = 0;
+            return true;
+        }
+
+        release();
+        _block = new (std::nothrow) _u8[size];
+        if (!_block) return false;
+        memset(_block, 0, size);
+        _size = size;
+        return true;
+    }
+
+    void release()
+    {
+        delete[] _block;
+        _block = NULL;
+        _size = 0;
+        _used = 0;
+    }
+
+    // NULL if the rest of the block is too small
+    void* carve(size_t size)
+    {
+        size_t offset = _alignedOffset();
+        if (!_block || offset > _size || size > _size - offset) return NULL;
+        _used = offset + size;
+        return _block + offset;
+    }
+
+    // the largest buffer carve can still return
+    size_t getFreeSize() const
+    {
+        size_t offset = _alignedOffset();
+        return offset < _size ? _size - offset : 0;
+    }
+
+    // give back everything carved after the mark
+    size_t getMark() const { return _used; }
+    void rewind(size_t mark) { _used = mark; }
+
+    size_t size() const { return _size; }
+
+private:
+    MemoryArena(const MemoryArena&);
+    MemoryArena& operator=(const MemoryArena&);
+
+    // every buffer starts on its own cache line
+    size_t _alignedOffset() const
+    {
+        size_t address = (size_t)(_block + _used);
+        return _used + (((address + ALIGNMENT - 1) & ~(size_t)(ALIGNMENT - 1)) - address);
+    }
+
+    _u8*   _block;
+    size_t _size;
+    size_t _used;
+};
+
+}}
@@ -0,0 +1,137 @@
+/*
+ *  Slamtec LIDAR SDK
+ *
+ *  Copyright (c) 2014 - 2023 Shanghai Slamtec Co., Ltd.
+ *  http://www.slamtec.com
+ *
+ */
+ /*
+  * Redistribution and use in source and binary forms, with or without
+  * modification, are permitted provided that the following conditions are met:
+  *
+  * 1. Redistributions of source code must retain the above copyright notice,
+  *    this list of conditions and the following disclaimer.
+  *
+  * 2. Redistributions in binary form must reproduce the above copyright notice,
+  *    this list of conditions and the following disclaimer in the documentation
+  *    and/or other materials provided with the distribution.
+  *
+  * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+  * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+  * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+  * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+  * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+  * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+  * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+  * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+  * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+  * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+  * EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+  *
+  */
+
+#include "sdkcommon.h"
+#include "hal/thread.h"
+#include "hal/types.h"
+#include "hal/assert.h"
+#include "hal/locker.h"
+#include "hal/event.h"
+
+#include <stdio.h>
+
+#include "sl_raw_capture.h"
+
+namespace sl { namespace internal {
+
+RawCaptureWriter::RawCaptureWriter(size_t ringSize)
+    : _file(NULL)
+    , _isWorking(false)
+    , _ring(ringSize)
+    , _droppedBytes(0)
+{
+
+}
+
+RawCaptureWriter::~RawCaptureWriter()
+{
+    close();
+}
+
+u_result RawCaptureWriter::open(const char* path)
+{
+    close();
+
+    _file = fopen(path, "wb");
+    if (!_file) return RESULT_OPERATION_FAIL;
+
+    sl_lidar_raw_capture_header_t header;
+    header.magic = SL_LIDAR_RAW_CAPTURE_MAGIC;
+    header.version = SL_LIDAR_RAW_CAPTURE_VERSION;
+    header.header_size = sizeof(header);
+
+    if (fwrite(&header, sizeof(header), 1, _file) != 1) {
+        fclose(_file);
+        _file = NULL;
+        return RESULT_OPERATION_FAIL;
+    }
+
+    _ring.clear();
+    _droppedBytes = 0;
+    _isWorking = true;
+    _writerThread = CLASS_THREAD(RawCaptureWriter, _proc_writerThread);
+    return RESULT_OK;
+}
+
+void RawCaptureWriter::close()
+{
+    if (!_isWorking) return;
+
+    _isWorking = false;
+    _dataEvt.set();
+    _writerThread.join();
+
+    fclose(_file);
+    _file = NULL;
+}
+
+void RawCaptureWriter::onRxData(const void* data, size_t size)
+{
+    if (!_isWorking || !size) return;
+
+    sl_lidar_raw_capture_chunk_t chunk;
+    chunk.timestamp_uS = getus();
+    chunk.size = (sl_u32)size;
+
+    // a chunk is either recorded as a whole or dropped
+    if (_ring.writableSize() < sizeof(chunk) + size) {
+        _droppedBytes += size;
+        return;
+    }
+
+    _ring.write(&chunk, sizeof(chunk));
+    _ring.write(data, size);
+    _dataEvt.set();
+}
+
+u_result RawCaptureWriter::_proc_writerThread()
+{
+    for (;;)
+    {
+        size_t size;
+        const _u8* buffer = _ring.getReadableRegion(size);
+
+        if (!size) {
+            // write everything captured before leaving
+            if (!_isWorking) break;
+            fflush(_file);
+            _dataEvt.wait(1000);
+            continue;
+        }
+
+        fwrite(buffer, 1, size, _file);
+        _ring.commitRead(size);
+    }
+    return RESULT_OK;
+}
+
+}}
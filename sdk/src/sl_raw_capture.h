@@ -0,0 +1,106 @@
+/*
+ *  Slamtec LIDAR SDK
+ *
+ *  Copyright (c) 2014 - 2023 Shanghai Slamtec Co., Ltd.
+ *  http://www.slamtec.com
+ *
+ */
+ /*
+  * Redistribution and use in source and binary forms, with or without
+  * modification, are permitted provided that the following conditions are met:
+  *
+  * 1. Redistributions of source code must retain the above copyright notice,
+  *    this list of conditions and the following disclaimer.
+  *
+  * 2. Redistributions in binary form must reproduce the above copyright notice,
+  *    this list of conditions and the following disclaimer in the documentation
+  *    and/or other materials provided with the distribution.
+  *
+  * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+  * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+  * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+  * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+  * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+  * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+  * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+  * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+  * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+  * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+  * EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+  *
+  */
+
+#pragma once
+
+#include <atomic>
+
+#include "hal/thread.h"
+#include "hal/event.h"
+#include "hal/spsc_ringbuffer.h"
+
+// Raw capture format (little-endian):
+//   sl_lidar_raw_capture_header_t
+//   sl_lidar_raw_capture_chunk_t + the bytes of one channel read
+//   sl_lidar_raw_capture_chunk_t + ...
+
+#define SL_LIDAR_RAW_CAPTURE_MAGIC          0x57524C53 // "SLRW"
+#define SL_LIDAR_RAW_CAPTURE_VERSION        1
+
+#if defined(_WIN32)
+#pragma pack(1)
+#endif
+
+typedef struct _sl_lidar_raw_capture_header_t
+{
+    sl_u32  magic;
+    sl_u16  version;
+    sl_u16  header_size;
+} __attribute__((packed)) sl_lidar_raw_capture_header_t;
+
+typedef struct _sl_lidar_raw_capture_chunk_t
+{
+    sl_u64  timestamp_uS;       // when the bytes were received
+    sl_u32  size;
+} __attribute__((packed)) sl_lidar_raw_capture_chunk_t;
+
+#if defined(_WIN32)
+#pragma pack()
+#endif
+
+namespace sl { namespace internal {
+
+// records the received bytes from the rx thread without blocking it, a writer thread empties the ring to disk
+class RawCaptureWriter {
+public:
+    enum {
+        DEFAULT_RING_SIZE = 4 * 1024 * 1024,
+    };
+
+    RawCaptureWriter(size_t ringSize = DEFAULT_RING_SIZE);
+    ~RawCaptureWriter();
+
+    u_result open(const char* path);
+    void     close();
+
+    // only to be invoked by one thread at a time (the rx thread)
+    void onRxData(const void* data, size_t size);
+
+    _u64 getDroppedBytes() const {
+        return _droppedBytes.load();
+    }
+
+protected:
+    u_result _proc_writerThread();
+
+protected:
+    FILE* _file;
+    bool  _isWorking;
+
+    rp::hal::SPSCByteRing _ring;
+    rp::hal::Event        _dataEvt;
+    rp::hal::Thread       _writerThread;
+
+    std::atomic<_u64>     _droppedBytes;
+};
+
+}}
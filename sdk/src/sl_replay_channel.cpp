@@ -0,0 +1,212 @@
+/*
+ *  Slamtec LIDAR SDK
+ *
+ *  Copyright (c) 2014 - 2023 Shanghai Slamtec Co., Ltd.
+ *  http://www.slamtec.com
+ *
+ */
+ /*
+  * Redistribution and use in source and binary forms, with or without
+  * modification, are permitted provided that the following conditions are met:
+  *
+  * 1. Redistributions of source code must retain the above copyright notice,
+  *    this list of conditions and the following disclaimer.
+  *
+  * 2. Redistributions in binary form must reproduce the above copyright notice,
+  *    this list of conditions and the following disclaimer in the documentation
+  *    and/or other materials provided with the distribution.
+  *
+  * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+  * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+  * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+  * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+  * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+  * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+  * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+  * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+  * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+  * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+  * EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+  *
+  */
+
+#include "sdkcommon.h"
+#include "sl_lidar_driver.h"
+#include "hal/abs_rxtx.h"
+#include "hal/socket.h"
+
+#include <stdio.h>
+#include <vector>
+
+#include "sl_raw_capture.h"
+
+
+namespace sl {
+
+    class ReplayChannel : public IChannel
+    {
+    public:
+        ReplayChannel(const std::string& path, float speed)
+            : _path(path)
+            , _speed(speed)
+            , _file(NULL)
+            , _chunkPos(0)
+            , _chunkTimestamp_uS(0)
+            , _firstChunkTimestamp_uS(0)
+            , _replayStart_uS(0)
+            , _endOfStream(false)
+        {
+        }
+
+        ~ReplayChannel()
+        {
+            close();
+        }
+
+        bool open()
+        {
+            close();
+
+            _file = fopen(_path.c_str(), "rb");
+            if (!_file) return false;
+
+            sl_lidar_raw_capture_header_t header;
+            if (fread(&header, sizeof(header), 1, _file) != 1
+                || header.magic != SL_LIDAR_RAW_CAPTURE_MAGIC
+                || header.version != SL_LIDAR_RAW_CAPTURE_VERSION
+                || header.header_size < sizeof(header)
+                || fseek(_file, header.header_size, SEEK_SET)) {
+                close();
+                return false;
+            }
+
+            _chunk.clear();
+            _chunkPos = 0;
+            _firstChunkTimestamp_uS = 0;
+            _replayStart_uS = 0;
+            _endOfStream = false;
+            return true;
+        }
+
+        void close()
+        {
+            if (_file) {
+                fclose(_file);
+                _file = NULL;
+            }
+        }
+
+        void flush()
+        {
+        
+        }
+
+        sl_result waitForDataExt(size_t& size_hint, sl_u32 timeoutInMs)
+        {
+            size_hint = 0;
+            if (!_file) return RESULT_OPERATION_FAIL;
+
+            if (_chunkPos == _chunk.size() && !_loadNextChunk()) {
+                // the recording is over, behave like an idle device
+                delay(timeoutInMs);
+                return RESULT_OPERATION_TIMEOUT;
+            }
+
+            if (_speed > 0) {
+                // pace the chunks as they were received, scaled by the speed factor
+                _u64 dueTime = _replayStart_uS + (_u64)((_chunkTimestamp_uS - _firstChunkTimestamp_uS) / _speed);
+                _u64 currentTime = getus();
+                if (dueTime > currentTime) {
+                    _u64 waitTime_uS = dueTime - currentTime;
+                    if (waitTime_uS > (_u64)timeoutInMs * 1000) {
+                        delay(timeoutInMs);
+                        return RESULT_OPERATION_TIMEOUT;
+                    }
+                    delay((_word_size_t)((waitTime_uS + 999) / 1000));
+                }
+            }
+
+            size_hint = _chunk.size() - _chunkPos;
+            return RESULT_OK;
+        }
+
+        bool waitForData(size_t size, sl_u32 timeoutInMs, size_t* actualReady)
+        {
+            size_t sizeHint;
+            bool ready = (waitForDataExt(sizeHint, timeoutInMs) == RESULT_OK);
+            if (actualReady) *actualReady = sizeHint;
+            return ready && sizeHint >= size;
+        }
+
+        int write(const void* data, size_t size)
+        {
+            // the commands are dropped, the recording is expected to contain the answers
+            return (int)size;
+        }
+
+        int read(void* buffer, size_t size)
+        {
+            size_t available = _chunk.size() - _chunkPos;
+            if (size > available) size = available;
+            if (size) {
+                memcpy(buffer, &_chunk[_chunkPos], size);
+                _chunkPos += size;
+            }
+            return (int)size;
+        }
+
+        void clearReadCache()
+        {
+        
+        }
+
+        int getChannelType() {
+            return CHANNEL_TYPE_REPLAY;
+        }
+
+    protected:
+        bool _loadNextChunk()
+        {
+            if (_endOfStream) return false;
+
+            sl_lidar_raw_capture_chunk_t chunk;
+            if (fread(&chunk, sizeof(chunk), 1, _file) != 1) {
+                _endOfStream = true;
+                return false;
+            }
+
+            _chunk.resize(chunk.size);
+            if (chunk.size && fread(&_chunk[0], 1, chunk.size, _file) != chunk.size) {
+                // truncated recording
+                _chunk.clear();
+                _endOfStream = true;
+                return false;
+            }
+
+            if (!_replayStart_uS) {
+                _replayStart_uS = getus();
+                _firstChunkTimestamp_uS = chunk.timestamp_uS;
+            }
+            _chunkTimestamp_uS = chunk.timestamp_uS;
+            _chunkPos = 0;
+            return true;
+        }
+
+    private:
+        std::string _path;
+        float       _speed;
+        FILE*       _file;
+
+        std::vector<_u8> _chunk;
+        size_t      _chunkPos;
+        _u64        _chunkTimestamp_uS;
+        _u64        _firstChunkTimestamp_uS;
+        _u64        _replayStart_uS;
+        bool        _endOfStream;
+    };
+
+    Result<IChannel*> createReplayChannel(const std::string& path, float speed)
+    {
+        return new ReplayChannel(path, speed);
+    }
+}
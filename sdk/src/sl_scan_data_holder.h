@@ -0,0 +1,449 @@
+/*
+ *  Slamtec LIDAR SDK
+ *
+ *  Copyright (c) 2014 - 2023 Shanghai Slamtec Co., Ltd.
+ *  http://www.slamtec.com
+ *
+ */
+ /*
+  * Redistribution and use in source and binary forms, with or without
+  * modification, are permitted provided that the following conditions are met:
+  *
+  * 1. Redistributions of source code must retain the above copyright notice,
+  *    this list of conditions and the following disclaimer.
+  *
+  * 2. Redistributions in binary form must reproduce the above copyright notice,
+  *    this list of conditions and the following disclaimer in the documentation
+  *    and/or other materials provided with the distribution.
+  *
+  * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+  * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+  * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+  * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+  * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+  * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+  * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+  * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+  * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+  * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+  * EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+  *
+  */
+
+#pragma once
+
+#include "hal/locker.h"
+#include "hal/event.h"
+#include "sl_trace.h"
+#include "sl_node_buffer.h"
+
+#include <vector>
+#include <atomic>
+#include <algorithm>
+
+namespace sl {
+
+    // the complete scans handed over from the decoder to the grab interfaces of the driver
+    // T must have the flag field of sl_lidar_response_measurement_node_hq_t
+    template<typename T>
+    class ScanDataHolder
+    {
+    public:
+        enum {
+            // one slot is being filled, the others keep the latest scans (the history) and can stay leased by the consumers
+            DEFAULT_SCAN_SLOT_COUNT = 4,
+            MIN_SCAN_SLOT_COUNT = 2,
+        };
+
+        typedef internal::NodeBuffer<T> scan_buffer_t;
+
+        ScanDataHolder(size_t maxcount = 8192, size_t slotCount = DEFAULT_SCAN_SLOT_COUNT) 
+            : _history_waiter(false)
+            , _scan_node_buffer_size(maxcount)
+            , _external_storage(NULL)
+            , _operational_id(0)
+            , _available_id(-1)
+            , _new_scan_ready(false)
+            , _dropped_scan_count(0)
+            , _published_scan_count(0)
+            , _truncated_node_count(0)
+            , _history_start_seq(0)
+        {
+            _allocSlots_locked(slotCount);
+        }
+
+        // the bytes of the storage of slotCount scans of up to maxcount nodes
+        static size_t getStorageSize(size_t maxcount, size_t slotCount)
+        {
+            return maxcount * std::max<size_t>(slotCount, MIN_SCAN_SLOT_COUNT) * sizeof(T);
+        }
+
+        // change the number of slots and of nodes per scan, it fails while a scan is leased
+        // the slots are carved from storage (see getStorageSize), the holder allocates its own one when it is NULL
+        bool configure(size_t maxcount, size_t slotCount, T* storage = NULL)
+        {
+            rp::hal::AutoLocker l(_locker);
+            if (slotCount < MIN_SCAN_SLOT_COUNT) slotCount = MIN_SCAN_SLOT_COUNT;
+            if (slotCount == _slots.size() && maxcount == _scan_node_buffer_size && storage == _external_storage) return true;
+
+            for (size_t pos = 0; pos < _slots.size(); ++pos) {
+                if (_slots[pos].refcount) return false;
+            }
+
+            _scan_node_buffer_size = maxcount;
+            _external_storage = storage;
+            _allocSlots_locked(slotCount);
+            _operational_id = 0;
+            _available_id = -1;
+            _new_scan_ready = false;
+            _history_start_seq = _published_scan_count;
+            _data_waiter.set(false);
+            return true;
+        }
+
+        size_t getSlotCount() {
+            rp::hal::AutoLocker l(_locker);
+            return _slots.size();
+        }
+
+        size_t getMaxCacheCount() const {
+            return _scan_node_buffer_size;
+        }
+
+        size_t getStorageBytes() {
+            rp::hal::AutoLocker l(_locker);
+            return _scan_node_buffer_size * _slots.size() * sizeof(T);
+        }
+
+        bool ownsStorage() const {
+            return !_external_storage;
+        }
+
+        // scans discarded because all the other slots were leased by the consumers
+        _u32 getDroppedScanCount() const {
+            return _dropped_scan_count;
+        }
+
+        _u64 getPublishedScanCount() const {
+            return _published_scan_count;
+        }
+
+        // nodes which replaced the last entry of a scan because the scan buffer was full
+        _u64 getTruncatedNodeCount() const {
+            return _truncated_node_count;
+        }
+
+        void reset() {
+            rp::hal::AutoLocker l(_locker);
+            _available_id = -1;
+            _new_scan_ready = false;
+            // the scans published so far leave the history, even the leased ones
+            _history_start_seq = _published_scan_count;
+            for (size_t pos = 0; pos < _slots.size(); ++pos) {
+                // leased scans stay untouched until they are released
+                if (_slots[pos].refcount) continue;
+                _slots[pos].nodes.clear();
+                _slots[pos].timestamp_uS = 0;
+                _slots[pos].end_timestamp_uS = 0;
+                _slots[pos].arrival_uS = 0;
+                _slots[pos].sequence = 0;
+            }
+            _data_waiter.set(false);
+        }
+
+        bool checkNewScanSignalAndReset()
+        {
+            return _new_scan_ready.exchange(false);
+        }
+
+        // returns true if a new complete scan has been published by this node
+        // arrival_uS: when the bytes carrying the node were received, kept with the scan it completes
+        bool pushScanNodeData(_u64 currentSampleTsUs, const T* hqNode, _u64 arrival_uS = 0)
+        {
+            bool published;
+            pushScanNodeDataBatch(&currentSampleTsUs, hqNode, 1, published, arrival_uS);
+            return published;
+        }
+
+        // push several nodes with a single lock operation, the ranges between the SYNCBIT nodes are appended in bulk
+        // it stops right after a new complete scan has been published so the caller can handle it,
+        // returns the number of nodes consumed
+        size_t pushScanNodeDataBatch(const _u64* timestamps_uS, const T* hqNodes, size_t count, bool& scanPublished, _u64 arrival_uS = 0)
+        {
+            rp::hal::AutoLocker l(_locker);
+
+            scanPublished = false;
+            size_t pos = 0;
+            while (pos < count && !scanPublished) {
+                auto operationalBuf = &_slots[_operational_id].nodes;
+
+                if (hqNodes[pos].flag & RPLIDAR_RESP_HQ_FLAG_SYNCBIT) {
+                    if (operationalBuf->size()) {
+                        if (_finishCurrentScanAndSwap_locked(arrival_uS)) {
+                            // publish the available scan
+                            _new_scan_ready = true;
+                            _data_waiter.set();
+                            _history_waiter.set();
+                            scanPublished = true;
+                        }
+                        operationalBuf = &_slots[_operational_id].nodes;
+                    }
+
+                    assert(operationalBuf->size() == 0);
+
+                    //store the timestamp info
+                    _slots[_operational_id].timestamp_uS = timestamps_uS[pos];
+                }
+                else if (operationalBuf->size() == 0) {
+                    //discard the data, do not form partial scan
+                    ++pos;
+                    continue;
+                }
+
+                size_t rangeEnd = pos + 1;
+                while (rangeEnd < count && !(hqNodes[rangeEnd].flag & RPLIDAR_RESP_HQ_FLAG_SYNCBIT)) {
+                    ++rangeEnd;
+                }
+
+                _appendNodes_locked(*operationalBuf, hqNodes + pos, rangeEnd - pos);
+                _slots[_operational_id].end_timestamp_uS = timestamps_uS[rangeEnd - 1];
+                pos = rangeEnd;
+            }
+            return pos;
+        }
+
+        void rewindCurrentScanData() {
+            rp::hal::AutoLocker l(_locker);
+            _slots[_operational_id].nodes.clear();
+        }
+
+        // borrow the latest complete scan without copying it
+        // the returned scan stays valid and unchanged until releaseScan(slotID) is called
+        const scan_buffer_t* acquireAvailableScan(_u32 timeout, int& slotID, _u64 * out_timestamp_uS = nullptr, _u64 * out_arrival_uS = nullptr, _u64 * out_sequence = nullptr, _u64 * out_end_timestamp_uS = nullptr)
+        {
+            {
+                SL_TRACE_SCOPE(traceScope, "scan.grab_wait");
+                if (_data_waiter.wait(timeout) != rp::hal::Event::EVENT_OK) {
+                    return nullptr;
+                }
+            }
+
+            rp::hal::AutoLocker l(_locker);
+            if (_available_id < 0) {
+                // reset() has been called in between
+                return nullptr;
+            }
+
+            _new_scan_ready = false;
+            return _leaseSlot_locked(_available_id, slotID, out_timestamp_uS, out_arrival_uS, out_sequence, out_end_timestamp_uS);
+        }
+
+        // same as acquireAvailableScan but never waits and leaves the new scan signal untouched
+        const scan_buffer_t* acquireLatestScan(int& slotID, _u64 * out_timestamp_uS = nullptr, _u64 * out_arrival_uS = nullptr, _u64 * out_sequence = nullptr, _u64 * out_end_timestamp_uS = nullptr)
+        {
+            rp::hal::AutoLocker l(_locker);
+            if (_available_id < 0) {
+                return nullptr;
+            }
+            return _leaseSlot_locked(_available_id, slotID, out_timestamp_uS, out_arrival_uS, out_sequence, out_end_timestamp_uS);
+        }
+
+        // borrow the oldest scan of the history published after the given sequence number, wait for it if there is none
+        const scan_buffer_t* acquireScanAfter(_u64 afterSequence, _u32 timeout, int& slotID, _u64 * out_timestamp_uS = nullptr, _u64 * out_arrival_uS = nullptr, _u64 * out_sequence = nullptr, _u64 * out_end_timestamp_uS = nullptr)
+        {
+            _u32 startTs = getms();
+            for (;;) {
+                {
+                    rp::hal::AutoLocker l(_locker);
+                    int found = -1;
+                    for (size_t pos = 0; pos < _slots.size(); ++pos) {
+                        if (!_isInHistory_locked((int)pos) || _slots[pos].sequence <= afterSequence) continue;
+                        if (found < 0 || _slots[pos].sequence < _slots[found].sequence) found = (int)pos;
+                    }
+
+                    if (found >= 0) {
+                        // the event only wakes a single waiter, hand it over to the next one
+                        _history_waiter.set(false);
+                        _history_waiter.set();
+                        return _leaseSlot_locked(found, slotID, out_timestamp_uS, out_arrival_uS, out_sequence, out_end_timestamp_uS);
+                    }
+                    // cleared under the lock, a scan published from now on sets it again
+                    _history_waiter.set(false);
+                }
+
+                _u32 elapsed = getms() - startTs;
+                if (elapsed >= timeout) return nullptr;
+                SL_TRACE_SCOPE(traceScope, "scan.grab_wait");
+                _history_waiter.wait(timeout - elapsed);
+            }
+        }
+
+        // borrow up to maxCount of the latest scans of the history, the oldest first, returns the number of scans leased.
+        // Each one is handed to onLeased(index, slotID, nodes, timestamp_uS, end_timestamp_uS, sequence) under the lock,
+        // the nodes stay valid until the slot is released
+        template <class LeaseVisitor>
+        size_t acquireRecentScans(size_t maxCount, LeaseVisitor onLeased)
+        {
+            rp::hal::AutoLocker l(_locker);
+            std::vector<int>& ids = _sorted_ids;
+            ids.clear();
+            for (size_t pos = 0; pos < _slots.size(); ++pos) {
+                if (_isInHistory_locked((int)pos)) ids.push_back((int)pos);
+            }
+            std::sort(ids.begin(), ids.end(), [this](int a, int b) { return _slots[a].sequence < _slots[b].sequence; });
+
+            size_t skipped = ids.size() > maxCount ? ids.size() - maxCount : 0;
+            for (size_t pos = skipped; pos < ids.size(); ++pos) {
+                ScanSlot& slot = _slots[ids[pos]];
+                ++slot.refcount;
+                onLeased(pos - skipped, ids[pos], slot.nodes, slot.timestamp_uS, slot.end_timestamp_uS, slot.sequence);
+            }
+            return ids.size() - skipped;
+        }
+
+        size_t getLeasedScanCount() {
+            rp::hal::AutoLocker l(_locker);
+            size_t leased = 0;
+            for (size_t pos = 0; pos < _slots.size(); ++pos) {
+                if (_slots[pos].refcount) ++leased;
+            }
+            return leased;
+        }
+
+        void releaseScan(int slotID) {
+            rp::hal::AutoLocker l(_locker);
+            if (slotID < 0 || slotID >= (int)_slots.size()) return;
+
+            assert(_slots[slotID].refcount > 0);
+            if (_slots[slotID].refcount) {
+                --_slots[slotID].refcount;
+            }
+        }
+
+    protected:
+        struct ScanSlot {
+            scan_buffer_t  nodes;
+            _u64           timestamp_uS;
+            // timestamp of the last node appended
+            _u64           end_timestamp_uS;
+            // when the bytes completing the scan were received, 0 if the latency is not tracked
+            _u64           arrival_uS;
+            // counts the published scans from 1, 0 for an empty slot
+            _u64           sequence;
+            int            refcount;
+        };
+
+        void _allocSlots_locked(size_t slotCount)
+        {
+            T* storage = _external_storage;
+            if (storage) {
+                std::vector<T>().swap(_owned_storage);
+            }
+            else {
+                // a single allocation for all the slots
+                size_t nodeCount = _scan_node_buffer_size * slotCount;
+                if (_owned_storage.size() != nodeCount) std::vector<T>(nodeCount).swap(_owned_storage);
+                storage = _owned_storage.data();
+            }
+
+            _slots.resize(slotCount);
+            for (size_t pos = 0; pos < _slots.size(); ++pos) {
+                _slots[pos].nodes.attach(storage + pos * _scan_node_buffer_size, _scan_node_buffer_size);
+                _slots[pos].timestamp_uS = 0;
+                _slots[pos].end_timestamp_uS = 0;
+                _slots[pos].arrival_uS = 0;
+                _slots[pos].sequence = 0;
+                _slots[pos].refcount = 0;
+            }
+            _sorted_ids.reserve(slotCount);
+        }
+
+        bool _isInHistory_locked(int slotID) const
+        {
+            return slotID != _operational_id && _slots[slotID].sequence > _history_start_seq;
+        }
+
+        const scan_buffer_t* _leaseSlot_locked(int id, int& slotID, _u64 * out_timestamp_uS, _u64 * out_arrival_uS, _u64 * out_sequence, _u64 * out_end_timestamp_uS)
+        {
+            ScanSlot& slot = _slots[id];
+            ++slot.refcount;
+            slotID = id;
+            if (out_timestamp_uS) {
+                *out_timestamp_uS = slot.timestamp_uS;
+            }
+            if (out_arrival_uS) {
+                *out_arrival_uS = slot.arrival_uS;
+            }
+            if (out_sequence) {
+                *out_sequence = slot.sequence;
+            }
+            if (out_end_timestamp_uS) {
+                *out_end_timestamp_uS = slot.end_timestamp_uS;
+            }
+            return &slot.nodes;
+        }
+
+        void _appendNodes_locked(scan_buffer_t& buffer, const T* nodes, size_t count)
+        {
+            size_t room = (buffer.size() < _scan_node_buffer_size) ? (_scan_node_buffer_size - buffer.size()) : 0;
+
+            if (count <= room) {
+                buffer.append(nodes, count);
+            }
+            else {
+                buffer.append(nodes, room);
+                //replace the last entry if buffer is full
+                if (buffer.size()) buffer.back() = nodes[count - 1];
+                _truncated_node_count += count - room;
+            }
+        }
+
+        // returns false if the finished scan has to be dropped (no free slot to continue with)
+        bool _finishCurrentScanAndSwap_locked(_u64 arrival_uS) {
+            SL_TRACE_SCOPE_ARG(traceScope, "scan.swap", _slots[_operational_id].nodes.size());
+            int freeID = -1;
+            for (int pos = 0; pos < (int)_slots.size(); ++pos) {
+                if (pos == _operational_id || _slots[pos].refcount) continue;
+                // reuse the oldest scan of the history, the latest one only if there is no other choice
+                if (freeID < 0 || _slots[pos].sequence < _slots[freeID].sequence) freeID = pos;
+            }
+
+            if (freeID < 0) {
+                // never block the producer, drop the finished scan instead
+                ++_dropped_scan_count;
+                _slots[_operational_id].nodes.clear();
+                return false;
+            }
+
+            _slots[_operational_id].arrival_uS = arrival_uS;
+            _slots[_operational_id].sequence = ++_published_scan_count;
+            _available_id = _operational_id;
+            _operational_id = freeID;
+            _slots[freeID].nodes.clear();
+            _slots[freeID].sequence = 0;
+            return true;
+        }
+
+        rp::hal::Locker _locker;
+        rp::hal::Event  _data_waiter;
+        // manual reset, for acquireScanAfter
+        rp::hal::Event  _history_waiter;
+
+        size_t _scan_node_buffer_size;
+        // the storage of the slots when it is not owned, see configure
+        T*     _external_storage;
+        int    _operational_id;
+        int    _available_id;
+        std::atomic<bool>   _new_scan_ready;
+        std::atomic<_u32>   _dropped_scan_count;
+        std::atomic<_u64>   _published_scan_count;
+        std::atomic<_u64>   _truncated_node_count;
+        // the scans published up to this sequence number are not part of the history any more
+        _u64   _history_start_seq;
+
+        std::vector<ScanSlot> _slots;
+        std::vector<T>        _owned_storage;
+        std::vector<int>      _sorted_ids;
+    };
+
+}
@@ -40,10 +40,13 @@ namespace sl {
     class SerialPortChannel : public ISerialPortChannel
     {
     public:
-        SerialPortChannel(const std::string& device, int baudrate) :_rxtxSerial(rp::hal::serial_rxtx::CreateRxTx())
+        SerialPortChannel(const std::string& device, int baudrate, const SerialPortChannelOptions& options = SerialPortChannelOptions())
+            : _rxtxSerial(rp::hal::serial_rxtx::CreateRxTx())
+            , _options(options)
         {
             _device = device;
             _baudrate = baudrate;
+            _rxtxSerial->setRxBatchThreshold(_options.rxBatchThreshold);
         }
 
         ~SerialPortChannel()
@@ -55,7 +58,8 @@ namespace sl {
         bool bind(const std::string& device, sl_s32 baudrate)
         {
             _closePending = false;
-            return _rxtxSerial->bind(device.c_str(), baudrate);
+            _u32 flags = _options.lowLatency ? rp::hal::serial_rxtx::BIND_FLAG_LOW_LATENCY : 0;
+            return _rxtxSerial->bind(device.c_str(), baudrate, flags);
         }
 
         bool open()
@@ -98,6 +102,25 @@ namespace sl {
             return RESULT_OK;
         }
 
+        sl_result waitAndRead(void* buffer, size_t size, size_t& received, sl_u32 timeoutInMs)
+        {
+            received = 0;
+
+            if (_closePending) return  RESULT_OPERATION_TIMEOUT;
+
+            if (!_rxtxSerial->isOpened()) {
+                return RESULT_OPERATION_FAIL;
+            }
+
+            int result = _rxtxSerial->waitandrecv((sl_u8 *)buffer, size, timeoutInMs, &received);
+            if (result == rp::hal::serial_rxtx::ANS_DEV_ERR)
+                return RESULT_OPERATION_FAIL;
+            if (result == rp::hal::serial_rxtx::ANS_TIMEOUT)
+                return RESULT_OPERATION_TIMEOUT;
+
+            return RESULT_OK;
+        }
+
         bool waitForData(size_t size, sl_u32 timeoutInMs, size_t* actualReady)
         {
             if (_closePending) return false;
@@ -126,15 +149,25 @@ namespace sl {
             dtr ? _rxtxSerial->setDTR() : _rxtxSerial->clearDTR();
         }
 
+        void cancelOperation()
+        {
+            _rxtxSerial->cancelOperation();
+        }
+
         int getChannelType() {
             return CHANNEL_TYPE_SERIALPORT;
         }
 
+        int getPollableHandle() {
+            return _rxtxSerial->getPollableHandle();
+        }
+
     private:
         rp::hal::serial_rxtx  * _rxtxSerial;
         bool _closePending;
         std::string _device;
         int _baudrate;
+        SerialPortChannelOptions _options;
 
     };
 
@@ -143,4 +176,9 @@ namespace sl {
         return new  SerialPortChannel(device, baudrate);
     }
 
+    Result<IChannel*> createSerialPortChannel(const std::string& device, int baudrate, const SerialPortChannelOptions& options)
+    {
+        return new  SerialPortChannel(device, baudrate, options);
+    }
+
 }
\ No newline at end of file
@@ -55,12 +55,17 @@ namespace sl {
         {
             if(!bind(_ip, _port))
                 return false;
+
+            // the socket is disposed by close(), a new one is needed to open the channel again
+            if (!_binded_socket) _binded_socket = rp::net::StreamSocket::CreateSocket();
+            if (!_binded_socket) return false;
             return IS_OK(_binded_socket->connect(_socket));
             
         }
 
         void close()
         {
+            if (!_binded_socket) return;
             _binded_socket->dispose();
             _binded_socket = NULL;
         }
@@ -77,13 +82,31 @@ namespace sl {
 
             switch (ans) {
             case RESULT_OK:
-                size_hint = 1024; //dummy value
+                if (IS_FAIL(_binded_socket->getRxPendingSize(size_hint))) {
+                    size_hint = 1024; //dummy value
+                } else if (!size_hint) {
+                    // readable with nothing pending: the peer has closed the connection, let read() report it
+                    size_hint = 1;
+                }
                 break;
             }
 
             return ans;
         }
 
+        sl_result waitAndRead(void* buffer, size_t size, size_t& received, sl_u32 timeoutInMs)
+        {
+            received = 0;
+            u_result ans = _binded_socket->waitforData(timeoutInMs);
+            if (IS_FAIL(ans)) return ans;
+
+            // the socket never blocks here, it returns whatever has arrived up to the buffer size
+            ans = _binded_socket->recv(buffer, size, received);
+            if (IS_FAIL(ans)) return ans;
+            if (!received) return RESULT_OPERATION_FAIL;
+            return RESULT_OK;
+        }
+
         bool waitForData(size_t size, sl_u32 timeoutInMs, size_t* actualReady)
         {
             if (actualReady)
@@ -111,6 +134,10 @@ namespace sl {
         int getChannelType() {
             return CHANNEL_TYPE_TCP;
         }
+
+        int getPollableHandle() {
+            return _binded_socket ? _binded_socket->getPollableHandle() : -1;
+        }
     private:
         rp::net::StreamSocket * _binded_socket;
         rp::net::SocketAddress _socket;
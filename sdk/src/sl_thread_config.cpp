@@ -0,0 +1,90 @@
+/*
+ *  Slamtec LIDAR SDK
+ *
+ *  Copyright (c) 2014 - 2023 Shanghai Slamtec Co., Ltd.
+ *  http://www.slamtec.com
+ *
+ */
+ /*
+  * Redistribution and use in source and binary forms, with or without
+  * modification, are permitted provided that the following conditions are met:
+  *
+  * 1. Redistributions of source code must retain the above copyright notice,
+  *    this list of conditions and the following disclaimer.
+  *
+  * 2. Redistributions in binary form must reproduce the above copyright notice,
+  *    this list of conditions and the following disclaimer in the documentation
+  *    and/or other materials provided with the distribution.
+  *
+  * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+  * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+  * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+  * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+  * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+  * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+  * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+  * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+  * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+  * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+  * EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+  *
+  */
+
+#include "sdkcommon.h"
+#include "hal/thread.h"
+#include "hal/types.h"
+#include "sl_lidar_driver.h"
+#include "sl_thread_config.h"
+#include "sl_trace.h"
+
+namespace sl { namespace internal {
+
+u_result applyThreadConfig(const LidarThreadConfig& config, const char* defaultName, int index)
+{
+    u_result ans = RESULT_OK;
+    u_result stepAns;
+
+    switch (config.policy) {
+    case LIDAR_THREAD_SCHED_OTHER:
+        stepAns = rp::hal::Thread::SetSelfSchedPolicy(rp::hal::Thread::SCHED_POLICY_OTHER, config.priority);
+        break;
+    case LIDAR_THREAD_SCHED_FIFO:
+        stepAns = rp::hal::Thread::SetSelfSchedPolicy(rp::hal::Thread::SCHED_POLICY_FIFO, config.priority);
+        break;
+    case LIDAR_THREAD_SCHED_RR:
+        stepAns = rp::hal::Thread::SetSelfSchedPolicy(rp::hal::Thread::SCHED_POLICY_RR, config.priority);
+        break;
+    default:
+        // it is expected to fail without the permission, as it always did
+        rp::hal::Thread::SetSelfPriority(rp::hal::Thread::PRIORITY_HIGH);
+        stepAns = RESULT_OK;
+        break;
+    }
+    if (IS_FAIL(stepAns)) ans = stepAns;
+
+    if (config.cpuAffinityMask) {
+        stepAns = rp::hal::Thread::SetSelfAffinity(config.cpuAffinityMask);
+        if (IS_FAIL(stepAns) && IS_OK(ans)) ans = stepAns;
+    }
+
+    const char* name = config.name[0] ? config.name : defaultName;
+    if (name) {
+        char threadName[sizeof(config.name)];
+        if (index >= 0) {
+            // keep the index visible even if the name is truncated
+            char suffix[12];
+            snprintf(suffix, sizeof(suffix), "%d", index);
+            int nameLen = (int)(sizeof(threadName) - 1 - strlen(suffix));
+            snprintf(threadName, sizeof(threadName), "%.*s%s", nameLen, name, suffix);
+        }
+        else {
+            snprintf(threadName, sizeof(threadName), "%s", name);
+        }
+        SL_TRACE_THREAD_NAME(threadName);
+        stepAns = rp::hal::Thread::SetSelfName(threadName);
+        if (IS_FAIL(stepAns) && IS_OK(ans)) ans = stepAns;
+    }
+    return ans;
+}
+
+}}
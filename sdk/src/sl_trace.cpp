@@ -0,0 +1,340 @@
+/*
+ *  Slamtec LIDAR SDK
+ *
+ *  Copyright (c) 2014 - 2023 Shanghai Slamtec Co., Ltd.
+ *  http://www.slamtec.com
+ *
+ */
+ /*
+  * Redistribution and use in source and binary forms, with or without
+  * modification, are permitted provided that the following conditions are met:
+  *
+  * 1. Redistributions of source code must retain the above copyright notice,
+  *    this list of conditions and the following disclaimer.
+  *
+  * 2. Redistributions in binary form must reproduce the above copyright notice,
+  *    this list of conditions and the following disclaimer in the documentation
+  *    and/or other materials provided with the distribution.
+  *
+  * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+  * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+  * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+  * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+  * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+  * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+  * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+  * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+  * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+  * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+  * EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+  *
+  */
+
+#include "sdkcommon.h"
+#include "hal/locker.h"
+#include "sl_lidar_trace.h"
+#include "sl_trace.h"
+
+#include <stdio.h>
+#include <vector>
+#include <utility>
+#include <algorithm>
+
+#if defined(SL_LIDAR_TRACE) && !defined(_WIN32)
+#include <unistd.h>
+#endif
+
+namespace sl {
+
+#ifdef SL_LIDAR_TRACE
+
+    namespace internal {
+
+        std::atomic<bool> g_traceEnabled(false);
+
+        enum {
+            TRACE_RING_CAPACITY = 8192,
+            TRACE_RING_MASK = TRACE_RING_CAPACITY - 1,
+        };
+
+        struct TraceEvent
+        {
+            const char* name;
+            _u64        timestamp_uS;
+            _u32        duration_uS;
+            _u32        arg;
+            _u32        tid;
+            _u32        instant;
+        };
+
+        // written by a single thread at a time, the readers copy the events and drop the ones overwritten meanwhile
+        struct TraceRing
+        {
+            TraceEvent          events[TRACE_RING_CAPACITY];
+            // count of the events recorded, and of the ones discarded by clearLidarTrace
+            std::atomic<_u64>   head;
+            std::atomic<_u64>   tail;
+            // guarded by the registry locker, the ring of an exited thread is handed over to the next new thread
+            bool                inUse;
+
+            TraceRing()
+                : head(0)
+                , tail(0)
+                , inUse(true)
+            {
+            }
+        };
+
+        struct TraceRegistry
+        {
+            rp::hal::Locker         locker;
+            // the rings live as long as the process, the threads come and go
+            std::vector<TraceRing*> rings;
+            std::vector<std::pair<_u32, std::string> > threadNames;
+            _u32                    nextTid;
+
+            TraceRegistry()
+                : nextTid(1)
+            {
+            }
+        };
+
+        static TraceRegistry& getTraceRegistry()
+        {
+            // never destroyed, the threads still running at exit may record or release their rings
+            static TraceRegistry* registry = new TraceRegistry();
+            return *registry;
+        }
+
+        struct TraceThread
+        {
+            TraceRing*  ring;
+            _u32        tid;
+            char        name[16];
+
+            TraceThread()
+                : ring(NULL)
+                , tid(0)
+            {
+                name[0] = '\0';
+            }
+
+            ~TraceThread()
+            {
+                if (!ring) return;
+                TraceRegistry& registry = getTraceRegistry();
+                rp::hal::AutoLocker l(registry.locker);
+                ring->inUse = false;
+            }
+
+            void registerThread()
+            {
+                TraceRegistry& registry = getTraceRegistry();
+                rp::hal::AutoLocker l(registry.locker);
+                for (size_t pos = 0; pos < registry.rings.size() && !ring; ++pos) {
+                    if (!registry.rings[pos]->inUse) {
+                        ring = registry.rings[pos];
+                        ring->inUse = true;
+                    }
+                }
+                if (!ring) {
+                    ring = new TraceRing();
+                    registry.rings.push_back(ring);
+                }
+                tid = registry.nextTid++;
+                registry.threadNames.push_back(std::make_pair(tid, std::string(name)));
+            }
+        };
+
+        static thread_local TraceThread t_traceThread;
+
+        void traceRecord(const char* name, _u64 timestamp_uS, _u32 duration_uS, _u32 arg, bool instant)
+        {
+            TraceThread& thread = t_traceThread;
+            if (!thread.ring) thread.registerThread();
+
+            TraceRing& ring = *thread.ring;
+            _u64 head = ring.head.load(std::memory_order_relaxed);
+            TraceEvent& event = ring.events[head & TRACE_RING_MASK];
+            event.name = name;
+            event.timestamp_uS = timestamp_uS;
+            event.duration_uS = duration_uS;
+            event.arg = arg;
+            event.tid = thread.tid;
+            event.instant = instant ? 1 : 0;
+            ring.head.store(head + 1, std::memory_order_release);
+        }
+
+        void traceThreadName(const char* name)
+        {
+            TraceThread& thread = t_traceThread;
+            snprintf(thread.name, sizeof(thread.name), "%s", name);
+            if (!thread.tid) return;
+
+            TraceRegistry& registry = getTraceRegistry();
+            rp::hal::AutoLocker l(registry.locker);
+            for (size_t pos = 0; pos < registry.threadNames.size(); ++pos) {
+                if (registry.threadNames[pos].first == thread.tid) registry.threadNames[pos].second = thread.name;
+            }
+        }
+
+        static void appendJsonString(std::string& json, const char* text)
+        {
+            json += '"';
+            for (; *text; ++text) {
+                char c = *text;
+                if (c == '"' || c == '\\') {
+                    json += '\\';
+                    json += c;
+                }
+                else if ((unsigned char)c >= 0x20) {
+                    json += c;
+                }
+            }
+            json += '"';
+        }
+
+    }
+
+    bool isLidarTraceSupported()
+    {
+        return true;
+    }
+
+    void setLidarTraceEnabled(bool enabled)
+    {
+        internal::g_traceEnabled.store(enabled, std::memory_order_relaxed);
+    }
+
+    bool isLidarTraceEnabled()
+    {
+        return internal::isTraceEnabled();
+    }
+
+    void clearLidarTrace()
+    {
+        internal::TraceRegistry& registry = internal::getTraceRegistry();
+        rp::hal::AutoLocker l(registry.locker);
+        for (size_t pos = 0; pos < registry.rings.size(); ++pos) {
+            internal::TraceRing& ring = *registry.rings[pos];
+            ring.tail.store(ring.head.load(std::memory_order_acquire), std::memory_order_relaxed);
+        }
+    }
+
+    sl_result dumpLidarTrace(std::string& json)
+    {
+        using namespace internal;
+
+#ifdef _WIN32
+        int pid = 1;
+#else
+        int pid = (int)getpid();
+#endif
+        char buffer[256];
+
+        json.assign("{\"traceEvents\":[");
+        bool first = true;
+
+        TraceRegistry& registry = getTraceRegistry();
+        rp::hal::AutoLocker l(registry.locker);
+
+        for (size_t pos = 0; pos < registry.threadNames.size(); ++pos) {
+            const std::pair<_u32, std::string>& thread = registry.threadNames[pos];
+            if (thread.second.empty()) continue;
+            snprintf(buffer, sizeof(buffer), "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":%d,\"tid\":%u,\"args\":{\"name\":",
+                first ? "" : ",", pid, thread.first);
+            json += buffer;
+            appendJsonString(json, thread.second.c_str());
+            json += "}}";
+            first = false;
+        }
+
+        std::vector<TraceEvent> events;
+        for (size_t pos = 0; pos < registry.rings.size(); ++pos) {
+            TraceRing& ring = *registry.rings[pos];
+
+            _u64 head = ring.head.load(std::memory_order_acquire);
+            _u64 begin = ring.tail.load(std::memory_order_relaxed);
+            if (head > TRACE_RING_CAPACITY && begin < head - TRACE_RING_CAPACITY) begin = head - TRACE_RING_CAPACITY;
+
+            events.clear();
+            for (_u64 index = begin; index < head; ++index) {
+                events.push_back(ring.events[index & TRACE_RING_MASK]);
+            }
+
+            // the owner may have overwritten the oldest events during the copy, the one being written included
+            std::atomic_thread_fence(std::memory_order_acquire);
+            _u64 currentHead = ring.head.load(std::memory_order_relaxed);
+            size_t skipped = 0;
+            if (currentHead >= TRACE_RING_CAPACITY && currentHead - TRACE_RING_CAPACITY + 1 > begin) {
+                skipped = (size_t)std::min<_u64>(currentHead - TRACE_RING_CAPACITY + 1 - begin, events.size());
+            }
+
+            for (size_t index = skipped; index < events.size(); ++index) {
+                const TraceEvent& event = events[index];
+                if (event.instant) {
+                    snprintf(buffer, sizeof(buffer), "%s{\"name\":\"%s\",\"ph\":\"i\",\"s\":\"t\",\"ts\":%llu,\"pid\":%d,\"tid\":%u,\"args\":{\"value\":%u}}",
+                        first ? "" : ",", event.name, (unsigned long long)event.timestamp_uS, pid, event.tid, event.arg);
+                }
+                else {
+                    snprintf(buffer, sizeof(buffer), "%s{\"name\":\"%s\",\"ph\":\"X\",\"ts\":%llu,\"dur\":%u,\"pid\":%d,\"tid\":%u,\"args\":{\"value\":%u}}",
+                        first ? "" : ",", event.name, (unsigned long long)event.timestamp_uS, event.duration_uS, pid, event.tid, event.arg);
+                }
+                json += buffer;
+                first = false;
+            }
+        }
+
+        json += "],\"displayTimeUnit\":\"ms\"}\n";
+        return SL_RESULT_OK;
+    }
+
+    sl_result dumpLidarTrace(const char* path)
+    {
+        if (!path) return SL_RESULT_INVALID_DATA;
+
+        std::string json;
+        sl_result ans = dumpLidarTrace(json);
+        if (SL_IS_FAIL(ans)) return ans;
+
+        FILE* file = fopen(path, "wb");
+        if (!file) return SL_RESULT_OPERATION_FAIL;
+        bool written = fwrite(json.data(), 1, json.size(), file) == json.size();
+        if (fclose(file)) written = false;
+        return written ? SL_RESULT_OK : SL_RESULT_OPERATION_FAIL;
+    }
+
+#else
+
+    bool isLidarTraceSupported()
+    {
+        return false;
+    }
+
+    void setLidarTraceEnabled(bool enabled)
+    {
+    }
+
+    bool isLidarTraceEnabled()
+    {
+        return false;
+    }
+
+    void clearLidarTrace()
+    {
+    }
+
+    sl_result dumpLidarTrace(std::string& json)
+    {
+        json.clear();
+        return SL_RESULT_OPERATION_NOT_SUPPORT;
+    }
+
+    sl_result dumpLidarTrace(const char* path)
+    {
+        return SL_RESULT_OPERATION_NOT_SUPPORT;
+    }
+
+#endif
+
+}
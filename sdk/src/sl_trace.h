@@ -0,0 +1,98 @@
+/*
+ *  Slamtec LIDAR SDK
+ *
+ *  Copyright (c) 2014 - 2023 Shanghai Slamtec Co., Ltd.
+ *  http://www.slamtec.com
+ *
+ */
+ /*
+  * Redistribution and use in source and binary forms, with or without
+  * modification, are permitted provided that the following conditions are met:
+  *
+  * 1. Redistributions of source code must retain the above copyright notice,
+  *    this list of conditions and the following disclaimer.
+  *
+  * 2. Redistributions in binary form must reproduce the above copyright notice,
+  *    this list of conditions and the following disclaimer in the documentation
+  *    and/or other materials provided with the distribution.
+  *
+  * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+  * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+  * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+  * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+  * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+  * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+  * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+  * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+  * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+  * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+  * EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+  *
+  */
+
+#pragma once
+
+// trace points of the receiving pipeline, see sl_lidar_trace.h
+// they compile to nothing unless the SDK is built with SL_LIDAR_TRACE defined
+#ifdef SL_LIDAR_TRACE
+
+#include <atomic>
+
+namespace sl { namespace internal {
+
+extern std::atomic<bool> g_traceEnabled;
+
+inline bool isTraceEnabled()
+{
+    return g_traceEnabled.load(std::memory_order_relaxed);
+}
+
+// append an event to the ring of the calling thread, a zero duration makes an instant event
+void traceRecord(const char* name, _u64 timestamp_uS, _u32 duration_uS, _u32 arg, bool instant);
+
+// the name of the calling thread in the trace
+void traceThreadName(const char* name);
+
+// records the time from its construction to its destruction, the name must be a string literal
+class TraceScope
+{
+public:
+    explicit TraceScope(const char* name, _u32 arg = 0)
+        : _name(isTraceEnabled() ? name : NULL)
+        , _arg(arg)
+        , _start_uS(0)
+    {
+        if (_name) _start_uS = getus();
+    }
+
+    ~TraceScope()
+    {
+        if (_name) traceRecord(_name, _start_uS, (_u32)(getus() - _start_uS), _arg, false);
+    }
+
+    void setArg(_u32 arg) { _arg = arg; }
+
+private:
+    const char* _name;
+    _u32        _arg;
+    _u64        _start_uS;
+};
+
+}}
+
+#define SL_TRACE_SCOPE(var, name)           sl::internal::TraceScope var(name)
+#define SL_TRACE_SCOPE_ARG(var, name, arg)  sl::internal::TraceScope var(name, (_u32)(arg))
+#define SL_TRACE_SET_ARG(var, arg)          var.setArg((_u32)(arg))
+#define SL_TRACE_INSTANT(name, arg) \
+    do { if (sl::internal::isTraceEnabled()) sl::internal::traceRecord(name, getus(), 0, (_u32)(arg), true); } while (0)
+#define SL_TRACE_THREAD_NAME(name)          sl::internal::traceThreadName(name)
+
+#else
+
+#define SL_TRACE_SCOPE(var, name)
+#define SL_TRACE_SCOPE_ARG(var, name, arg)
+#define SL_TRACE_SET_ARG(var, arg)
+#define SL_TRACE_INSTANT(name, arg)         do {} while (0)
+#define SL_TRACE_THREAD_NAME(name)          do {} while (0)
+
+#endif
@@ -39,7 +39,11 @@ namespace sl {
 	class UdpChannel : public IChannel
 	{
 	public:
-		UdpChannel(const std::string& ip, int port) : _binded_socket(rp::net::DGramSocket::CreateSocket()) {
+		UdpChannel(const std::string& ip, int port, const UdpChannelOptions& options = UdpChannelOptions())
+            : _binded_socket(rp::net::DGramSocket::CreateSocket())
+            , _options(options)
+            , _lastRxTimestamp(0)
+        {
             _ip = ip;
             _port = port;
         }
@@ -54,11 +58,21 @@ namespace sl {
         {
             if(!bind(_ip, _port))
                 return false;
+
+            // the socket is disposed by close(), a new one is needed to open the channel again
+            if (!_binded_socket) _binded_socket = rp::net::DGramSocket::CreateSocket();
+            if (!_binded_socket) return false;
+
+            // both are best effort, the channel works without them
+            if (_options.rxBufferSize) _binded_socket->setRxBufferSize(_options.rxBufferSize);
+            if (_options.rxTimestamp) _binded_socket->enableRxTimestamp(true);
+
             return SL_IS_OK(_binded_socket->setPairAddress(&_socket));         
         }
 
         void close()
         {
+            if (!_binded_socket) return;
             _binded_socket->dispose();
             _binded_socket = NULL;
         }
@@ -75,13 +89,36 @@ namespace sl {
 
             switch (ans) {
             case RESULT_OK:
-                size_hint = 1024; //dummy value
+                // the size of the next datagram, so it is never read truncated
+                if (IS_FAIL(_binded_socket->getRxPendingSize(size_hint)) || !size_hint) {
+                    size_hint = 1024; //dummy value
+                }
                 break;
             }
 
             return ans;
         }
 
+        sl_result waitAndRead(void* buffer, size_t size, size_t& received, sl_u32 timeoutInMs)
+        {
+            received = 0;
+            _lastRxTimestamp = 0;
+            u_result ans = _binded_socket->waitforData(timeoutInMs);
+            if (IS_FAIL(ans)) return ans;
+
+            // drain all the pending datagrams at once,
+            // RESULT_INSUFFICIENT_MEMORY tells the next datagram needs a larger buffer
+            size_t datagramCount = 0;
+            ans = _binded_socket->recvFromBatch(buffer, size, _options.maxDatagramSize, received, datagramCount,
+                    _options.rxTimestamp ? &_lastRxTimestamp : NULL);
+            return ans;
+        }
+
+        sl_u64 getLastRxTimestamp()
+        {
+            return _lastRxTimestamp;
+        }
+
         bool waitForData(size_t size, sl_u32 timeoutInMs, size_t* actualReady)
         {
             if (actualReady)
@@ -115,9 +152,15 @@ namespace sl {
             return CHANNEL_TYPE_UDP;
         }
 
+        int getPollableHandle() {
+            return _binded_socket ? _binded_socket->getPollableHandle() : -1;
+        }
+
 	private:
 		rp::net::DGramSocket * _binded_socket;
 		rp::net::SocketAddress _socket;
+        UdpChannelOptions _options;
+        _u64 _lastRxTimestamp;
         std::string _ip;
         int _port;
 	};
@@ -126,4 +169,9 @@ namespace sl {
     {
         return new  UdpChannel(ip, port);
     }
+
+    Result<IChannel*> createUdpChannel(const std::string& ip, int port, const UdpChannelOptions& options)
+    {
+        return new  UdpChannel(ip, port, options);
+    }
 }
\ No newline at end of file
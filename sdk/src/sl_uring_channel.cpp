@@ -0,0 +1,515 @@
+/*
+ *  Slamtec LIDAR SDK
+ *
+ *  Copyright (c) 2014 - 2023 Shanghai Slamtec Co., Ltd.
+ *  http://www.slamtec.com
+ *
+ */
+ /*
+  * Redistribution and use in source and binary forms, with or without
+  * modification, are permitted provided that the following conditions are met:
+  *
+  * 1. Redistributions of source code must retain the above copyright notice,
+  *    this list of conditions and the following disclaimer.
+  *
+  * 2. Redistributions in binary form must reproduce the above copyright notice,
+  *    this list of conditions and the following disclaimer in the documentation
+  *    and/or other materials provided with the distribution.
+  *
+  * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+  * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+  * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+  * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+  * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+  * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+  * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+  * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+  * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+  * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+  * EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+  *
+  */
+
+#include "sdkcommon.h"
+#include "sl_lidar_driver.h"
+
+#if defined(SL_LIDAR_IO_URING) && defined(__linux__)
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/eventfd.h>
+#include <poll.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <errno.h>
+#define SL_URING_CHANNEL_SUPPORTED
+#endif
+
+
+namespace sl {
+
+#ifdef SL_URING_CHANNEL_SUPPORTED
+
+    // there is no liburing dependency, the rings are driven through the raw system calls
+    static int io_uring_setup(unsigned entries, io_uring_params* params)
+    {
+        return (int)syscall(__NR_io_uring_setup, entries, params);
+    }
+
+    static int io_uring_enter(int fd, unsigned toSubmit, unsigned minComplete, unsigned flags)
+    {
+        return (int)syscall(__NR_io_uring_enter, fd, toSubmit, minComplete, flags, NULL, 0);
+    }
+
+    static int io_uring_register(int fd, unsigned opcode, const void* arg, unsigned nrArgs)
+    {
+        return (int)syscall(__NR_io_uring_register, fd, opcode, arg, nrArgs);
+    }
+
+    class IoUringChannel : public ISerialPortChannel
+    {
+    public:
+        enum {
+            // a read chain of up to 3 requests, the poll of the cancellation event and 2 cancellations
+            RING_ENTRIES = 8,
+
+            USER_DATA_READ = 1,
+            USER_DATA_TIMEOUT = 2,
+            USER_DATA_POLL = 3,
+            USER_DATA_CANCEL_EVENT = 4,
+            USER_DATA_ASYNC_CANCEL = 5,
+        };
+
+        IoUringChannel()
+            : _channel(NULL)
+            , _ringFd(-1)
+            , _sqRing(NULL)
+            , _sqRingSize(0)
+            , _cqRing(NULL)
+            , _cqRingSize(0)
+            , _sqes(NULL)
+            , _sqesSize(0)
+            , _registeredBuffer(NULL)
+            , _registeredSize(0)
+            , _cancelFd(-1)
+            , _cancelPollArmed(false)
+            , _delegateReads(false)
+            , _lastRxTimestamp(0)
+        {
+        }
+
+        ~IoUringChannel()
+        {
+            _unregisterRxBuffer();
+            if (_sqes) munmap(_sqes, _sqesSize);
+            if (_cqRing && _cqRing != _sqRing) munmap(_cqRing, _cqRingSize);
+            if (_sqRing) munmap(_sqRing, _sqRingSize);
+            // the poll of the cancellation event goes with the ring
+            if (_ringFd >= 0) ::close(_ringFd);
+            if (_cancelFd >= 0) ::close(_cancelFd);
+            delete _channel;
+        }
+
+        sl_result init()
+        {
+            io_uring_params params;
+            memset(&params, 0, sizeof(params));
+
+            _ringFd = io_uring_setup(RING_ENTRIES, &params);
+            if (_ringFd < 0) return RESULT_OPERATION_NOT_SUPPORT; // ENOSYS, or disabled by the admin (EPERM)
+
+            _sqRingSize = params.sq_off.array + params.sq_entries * sizeof(__u32);
+            _cqRingSize = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+            _sqesSize = params.sq_entries * sizeof(io_uring_sqe);
+
+            bool singleMap = (params.features & IORING_FEAT_SINGLE_MMAP) != 0;
+            if (singleMap) {
+                if (_cqRingSize > _sqRingSize) _sqRingSize = _cqRingSize;
+                _cqRingSize = _sqRingSize;
+            }
+
+            void* sqRing = mmap(NULL, _sqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, _ringFd, IORING_OFF_SQ_RING);
+            if (sqRing == MAP_FAILED) return RESULT_OPERATION_NOT_SUPPORT;
+            _sqRing = (_u8*)sqRing;
+
+            if (singleMap) {
+                _cqRing = _sqRing;
+            } else {
+                void* cqRing = mmap(NULL, _cqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, _ringFd, IORING_OFF_CQ_RING);
+                if (cqRing == MAP_FAILED) return RESULT_OPERATION_NOT_SUPPORT;
+                _cqRing = (_u8*)cqRing;
+            }
+
+            void* sqes = mmap(NULL, _sqesSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, _ringFd, IORING_OFF_SQES);
+            if (sqes == MAP_FAILED) return RESULT_OPERATION_NOT_SUPPORT;
+            _sqes = (io_uring_sqe*)sqes;
+
+            _sqTail = (__u32*)(_sqRing + params.sq_off.tail);
+            _sqMask = *(__u32*)(_sqRing + params.sq_off.ring_mask);
+            _sqArray = (__u32*)(_sqRing + params.sq_off.array);
+            _cqHead = (__u32*)(_cqRing + params.cq_off.head);
+            _cqTail = (__u32*)(_cqRing + params.cq_off.tail);
+            _cqMask = *(__u32*)(_cqRing + params.cq_off.ring_mask);
+            _cqes = (io_uring_cqe*)(_cqRing + params.cq_off.cqes);
+
+            _cancelFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+            if (_cancelFd < 0) return RESULT_OPERATION_FAIL;
+
+            return _probeOps();
+        }
+
+        // takes the ownership of the channel
+        void attach(IChannel* channel)
+        {
+            _channel = channel;
+        }
+
+        bool open()
+        {
+            _delegateReads = false;
+            _drainCancelEvent();
+            return _channel->open();
+        }
+
+        void close()
+        {
+            cancelOperation();
+            _unregisterRxBuffer();
+            _channel->close();
+        }
+
+        void cancelOperation()
+        {
+            uint64_t counter = 1;
+            if (::write(_cancelFd, &counter, sizeof(counter)) == -1) {
+                // the counter is already set
+            }
+            // a read delegated to the channel
+            _channel->cancelOperation();
+        }
+
+        void flush()
+        {
+            _channel->flush();
+        }
+
+        bool waitForData(size_t size, sl_u32 timeoutInMs, size_t* actualReady)
+        {
+            return _channel->waitForData(size, timeoutInMs, actualReady);
+        }
+
+        sl_result waitForDataExt(size_t& size_hint, sl_u32 timeoutInMs)
+        {
+            return _channel->waitForDataExt(size_hint, timeoutInMs);
+        }
+
+        int write(const void* data, size_t size)
+        {
+            return _channel->write(data, size);
+        }
+
+        int read(void* buffer, size_t size)
+        {
+            return _channel->read(buffer, size);
+        }
+
+        sl_result waitAndRead(void* buffer, size_t size, size_t& received, sl_u32 timeoutInMs)
+        {
+            received = 0;
+            _lastRxTimestamp = 0;
+            if (_delegateReads) return _channel->waitAndRead(buffer, size, received, timeoutInMs);
+
+            int fd = _channel->getPollableHandle();
+            if (fd < 0) return RESULT_OPERATION_FAIL;
+
+            // the read is submitted together with a timeout linked to it, and the call waits for the whole chain to
+            // complete, so nothing is left in flight pointing into the buffer when returning.
+            // a serial port is set up to read 0 bytes instead of blocking (VMIN = 0), so a poll goes before the read there
+            bool serial = (_channel->getChannelType() == CHANNEL_TYPE_SERIALPORT);
+            __u32 base = *_sqTail;
+            unsigned count = 0;
+            io_uring_sqe* waitSqe = NULL;
+            if (serial) {
+                waitSqe = _prepSqe(base + count++, IORING_OP_POLL_ADD, fd, USER_DATA_POLL);
+                waitSqe->poll32_events = POLLIN;
+                waitSqe->flags |= IOSQE_IO_LINK;
+            }
+
+            __kernel_timespec ts;
+            if (timeoutInMs != (sl_u32)-1) {
+                // the timespec is copied when the timeout is prepared, before io_uring_enter returns
+                ts.tv_sec = timeoutInMs / 1000;
+                ts.tv_nsec = (long long)(timeoutInMs % 1000) * 1000000;
+
+                // it times the first request of the chain, the read follows a poll once that is done
+                if (!waitSqe) {
+                    waitSqe = _prepSqe(base + count++, IORING_OP_READ, fd, USER_DATA_READ);
+                    waitSqe->flags |= IOSQE_IO_LINK;
+                }
+                io_uring_sqe* timeoutSqe = _prepSqe(base + count++, IORING_OP_LINK_TIMEOUT, -1, USER_DATA_TIMEOUT);
+                timeoutSqe->addr = (__u64)(uintptr_t)&ts;
+                timeoutSqe->len = 1;
+                if (waitSqe->user_data != USER_DATA_READ) timeoutSqe->flags |= IOSQE_IO_LINK;
+            }
+
+            io_uring_sqe* readSqe = (waitSqe && waitSqe->user_data == USER_DATA_READ) ? waitSqe : _prepSqe(base + count++, IORING_OP_READ, fd, USER_DATA_READ);
+            readSqe->addr = (__u64)(uintptr_t)buffer;
+            readSqe->len = (__u32)(size > 0x7FFFFFFF ? 0x7FFFFFFF : size);
+
+            _u8* bufferEnd = (_u8*)buffer + size;
+            if (_registeredBuffer && (_u8*)buffer >= _registeredBuffer && bufferEnd <= _registeredBuffer + _registeredSize) {
+                readSqe->opcode = IORING_OP_READ_FIXED;
+                readSqe->buf_index = 0;
+            }
+
+            // cancelOperation wakes up the wait through a poll of its event, it stays armed across the calls
+            // as it does not point into any buffer
+            const unsigned chainCount = count;
+            bool cancelPollQueued = !_cancelPollArmed;
+            if (cancelPollQueued) {
+                io_uring_sqe* cancelSqe = _prepSqe(base + count++, IORING_OP_POLL_ADD, _cancelFd, USER_DATA_CANCEL_EVENT);
+                cancelSqe->poll32_events = POLLIN;
+            }
+
+            __atomic_store_n(_sqTail, base + count, __ATOMIC_RELEASE);
+
+            int readResult = 0;
+            unsigned submitted = 0;
+            // the requests of the chain taken by the kernel and not completed yet
+            unsigned chainPending = 0;
+            bool cancelled = false;
+            bool cancelIssued = false;
+            bool failed = false;
+            while (submitted < count || chainPending) {
+                if ((cancelled || failed) && chainPending && !cancelIssued) {
+                    // the chain has to be over before returning, whatever request of it is in flight
+                    if (serial) _prepSqe(base + count++, IORING_OP_ASYNC_CANCEL, -1, USER_DATA_ASYNC_CANCEL)->addr = USER_DATA_POLL;
+                    _prepSqe(base + count++, IORING_OP_ASYNC_CANCEL, -1, USER_DATA_ASYNC_CANCEL)->addr = USER_DATA_READ;
+                    __atomic_store_n(_sqTail, base + count, __ATOMIC_RELEASE);
+                    cancelIssued = true;
+                }
+
+                unsigned toSubmit = count - submitted;
+                int ans = io_uring_enter(_ringFd, toSubmit, 1, IORING_ENTER_GETEVENTS);
+                if (ans < 0) {
+                    // a call submitting anything reports the count even if the wait got interrupted,
+                    // so a failure means none of the requests left was taken
+                    if (errno == EINTR) continue;
+                    if (!toSubmit && errno != EAGAIN && errno != EBUSY) {
+                        // the ring itself is broken, there is no way to wait for the chain
+                        failed = true;
+                        break;
+                    }
+
+                    // the requests not taken are dropped, the cancellations only speed up the end of the chain
+                    __atomic_store_n(_sqTail, base + submitted, __ATOMIC_RELEASE);
+                    if (submitted <= chainCount) cancelPollQueued = false;
+                    count = submitted;
+                    failed = true;
+                    continue;
+                }
+
+                unsigned taken = ((unsigned)ans < toSubmit) ? (unsigned)ans : toSubmit;
+                if (submitted < chainCount) chainPending += std::min(submitted + taken, chainCount) - submitted;
+                // the poll of the cancellation event follows the chain
+                if (cancelPollQueued && submitted <= chainCount && submitted + taken > chainCount) _cancelPollArmed = true;
+                submitted += taken;
+
+                __u32 head = *_cqHead;
+                __u32 tail = __atomic_load_n(_cqTail, __ATOMIC_ACQUIRE);
+                for (; head != tail; ++head) {
+                    const io_uring_cqe& cqe = _cqes[head & _cqMask];
+                    switch (cqe.user_data) {
+                    case USER_DATA_READ:
+                        readResult = cqe.res;
+                        // the read completes as soon as the data arrives
+                        if (readResult > 0) _lastRxTimestamp = getus();
+                        // fall through
+                    case USER_DATA_POLL:
+                    case USER_DATA_TIMEOUT:
+                        if (chainPending) --chainPending;
+                        break;
+                    case USER_DATA_CANCEL_EVENT:
+                        _cancelPollArmed = false;
+                        _drainCancelEvent();
+                        cancelled = true;
+                        break;
+                    default:
+                        // the result of a cancellation, possibly of a previous call
+                        break;
+                    }
+                }
+                __atomic_store_n(_cqHead, head, __ATOMIC_RELEASE);
+            }
+            if (failed) return RESULT_OPERATION_FAIL;
+
+            if (readResult > 0) {
+                received = (size_t)readResult;
+                return RESULT_OK;
+            }
+            if (cancelled) return RESULT_OPERATION_TIMEOUT;
+
+            switch (-readResult) {
+            case 0:
+                // a closed connection reads 0 bytes, an idle serial port may do as well
+                return (_channel->getChannelType() == CHANNEL_TYPE_TCP) ? RESULT_OPERATION_FAIL : RESULT_OK;
+            case ECANCELED:
+            case EINTR:
+                return RESULT_OPERATION_TIMEOUT;
+            case EAGAIN:
+                // older kernels do not wait on the descriptors opened with O_NONBLOCK, use the channel's own wait
+                _delegateReads = true;
+                return _channel->waitAndRead(buffer, size, received, timeoutInMs);
+            default:
+                return RESULT_OPERATION_FAIL;
+            }
+        }
+
+        sl_u64 getLastRxTimestamp()
+        {
+            return _delegateReads ? _channel->getLastRxTimestamp() : _lastRxTimestamp;
+        }
+
+        void registerRxBuffer(void* buffer, size_t size)
+        {
+            if ((_u8*)buffer == _registeredBuffer && size == _registeredSize) return;
+            _unregisterRxBuffer();
+            if (!buffer || !size) return;
+
+            // pinning the pages may exceed RLIMIT_MEMLOCK, the reads just go without the registered buffer then
+            iovec iov;
+            iov.iov_base = buffer;
+            iov.iov_len = size;
+            if (io_uring_register(_ringFd, IORING_REGISTER_BUFFERS, &iov, 1) == 0) {
+                _registeredBuffer = (_u8*)buffer;
+                _registeredSize = size;
+            }
+        }
+
+        void clearReadCache()
+        {
+            _channel->clearReadCache();
+        }
+
+        void setDTR(bool dtr)
+        {
+            if (_channel->getChannelType() == CHANNEL_TYPE_SERIALPORT) {
+                static_cast<ISerialPortChannel*>(_channel)->setDTR(dtr);
+            }
+        }
+
+        int getChannelType()
+        {
+            return _channel->getChannelType();
+        }
+
+        int getPollableHandle()
+        {
+            // the reads go through the ring, a reactor reading the descriptor itself would bypass it
+            return -1;
+        }
+
+    private:
+        io_uring_sqe* _prepSqe(__u32 position, _u8 opcode, int fd, __u64 userData)
+        {
+            // the queue is empty between the calls, each call submits at most RING_ENTRIES requests
+            __u32 index = position & _sqMask;
+            _sqArray[index] = index;
+
+            io_uring_sqe* sqe = &_sqes[index];
+            memset(sqe, 0, sizeof(*sqe));
+            sqe->opcode = opcode;
+            sqe->fd = fd;
+            sqe->user_data = userData;
+            return sqe;
+        }
+
+        sl_result _probeOps()
+        {
+            const unsigned opCount = IORING_OP_READ + 1; // the highest one needed
+            size_t probeSize = sizeof(io_uring_probe) + opCount * sizeof(io_uring_probe_op);
+            std::vector<_u8> probeBuffer(probeSize, 0);
+            io_uring_probe* probe = (io_uring_probe*)&probeBuffer[0];
+
+            // the probe itself is there since 5.6, the first release with IORING_OP_READ
+            if (io_uring_register(_ringFd, IORING_REGISTER_PROBE, probe, opCount) < 0) return RESULT_OPERATION_NOT_SUPPORT;
+
+            const unsigned requiredOps[] = { IORING_OP_READ, IORING_OP_READ_FIXED, IORING_OP_POLL_ADD, IORING_OP_LINK_TIMEOUT, IORING_OP_ASYNC_CANCEL };
+            for (size_t pos = 0; pos < _countof(requiredOps); ++pos) {
+                unsigned op = requiredOps[pos];
+                if (op > probe->last_op || !(probe->ops[op].flags & IO_URING_OP_SUPPORTED)) return RESULT_OPERATION_NOT_SUPPORT;
+            }
+            return RESULT_OK;
+        }
+
+        void _drainCancelEvent()
+        {
+            uint64_t counter;
+            if (::read(_cancelFd, &counter, sizeof(counter)) == -1) {
+                // not set
+            }
+        }
+
+        void _unregisterRxBuffer()
+        {
+            if (!_registeredBuffer) return;
+            io_uring_register(_ringFd, IORING_UNREGISTER_BUFFERS, NULL, 0);
+            _registeredBuffer = NULL;
+            _registeredSize = 0;
+        }
+
+        IChannel* _channel;
+
+        int _ringFd;
+        _u8* _sqRing;
+        size_t _sqRingSize;
+        _u8* _cqRing;
+        size_t _cqRingSize;
+        io_uring_sqe* _sqes;
+        size_t _sqesSize;
+
+        __u32* _sqTail;
+        __u32 _sqMask;
+        __u32* _sqArray;
+        __u32* _cqHead;
+        __u32* _cqTail;
+        __u32 _cqMask;
+        io_uring_cqe* _cqes;
+
+        _u8* _registeredBuffer;
+        size_t _registeredSize;
+        int _cancelFd;
+        bool _cancelPollArmed;
+        bool _delegateReads;
+        sl_u64 _lastRxTimestamp;
+    };
+
+    Result<IChannel*> createIoUringChannel(IChannel* channel)
+    {
+        if (!channel) return RESULT_INVALID_DATA;
+
+        int type = channel->getChannelType();
+        if (type != CHANNEL_TYPE_SERIALPORT && type != CHANNEL_TYPE_TCP) {
+            // a datagram has to be read whole, and the replay channel has no descriptor to read
+            return RESULT_OPERATION_NOT_SUPPORT;
+        }
+
+        IoUringChannel* uringChannel = new IoUringChannel();
+        sl_result ans = uringChannel->init();
+        if (IS_FAIL(ans)) {
+            delete uringChannel;
+            return ans;
+        }
+        uringChannel->attach(channel);
+        return uringChannel;
+    }
+
+#else
+
+    Result<IChannel*> createIoUringChannel(IChannel* channel)
+    {
+        return RESULT_OPERATION_NOT_SUPPORT;
+    }
+
+#endif
+
+}